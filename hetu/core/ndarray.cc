@@ -764,10 +764,10 @@ NDArray NDArray::matmul4bit(const NDArray& x, const NDArray& y,
                   {x->shape(trans_left ? 1 : 0), y->shape(trans_right ? 0 : 1)},
                   x->device(), x->dtype(), stream_id);
   Stream stream(x->device(), stream_id);
-  HT_DISPATCH_KERNEL_CUDA_ONLY(x->device().type(), __FUNCTION__,
-                                hetu::impl::MatMul4Bit, x, trans_left, y,
-                                trans_right, absmax, datatype, 
-                                out, blocksize, stream);
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(x->device().type(), __FUNCTION__,
+                                  hetu::impl::MatMul4Bit, x, trans_left, y,
+                                  trans_right, absmax, datatype, 
+                                  out, blocksize, stream);
   return out;
 }
 
@@ -1196,9 +1196,9 @@ NDArray NDArray::dequantization(const NDArray& input,
   else 
     out = NDArray::empty(input->shape(), input->device(), dqtype, stream_id);
   Stream stream(input->device(), stream_id);
-  HT_DISPATCH_KERNEL_CUDA_ONLY(input->device().type(), __FUNCTION__,
-                               hetu::impl::DeQuantization, input, absmax, code,
-                               out, blocksize, stream);
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(input->device().type(), __FUNCTION__,
+                                  hetu::impl::DeQuantization, input, absmax, code,
+                                  out, blocksize, stream);
   return out;
 }
 
@@ -1495,7 +1495,8 @@ NDArrayList NDArray::quantization(const NDArray& input,
   if (absmax.is_defined()) 
     absmax_ = absmax;
   else {
-    HTShape absmax_shape = {int64_t(input->numel() / blocksize)};
+    HTShape absmax_shape = {
+      int64_t((input->numel() + blocksize - 1) / blocksize)};
     absmax_ = NDArray::empty(absmax_shape, input->device(), kFloat32, stream_id);
   }
   if (output.is_defined() && output->dtype() == qtype) 
@@ -1503,9 +1504,9 @@ NDArrayList NDArray::quantization(const NDArray& input,
   else 
     out = NDArray::empty(input->shape(), input->device(), qtype, stream_id);
   Stream stream(input->device(), stream_id);
-  HT_DISPATCH_KERNEL_CUDA_ONLY(input->device().type(), __FUNCTION__,
-                               hetu::impl::Quantization, input, absmax_, code,
-                               out, blocksize, stochastic, stream);
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(input->device().type(), __FUNCTION__,
+                                  hetu::impl::Quantization, input, absmax_, code,
+                                  out, blocksize, stochastic, stream);
   return {absmax_, out};
 }
 
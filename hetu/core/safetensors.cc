@@ -0,0 +1,351 @@
+#include "hetu/core/safetensors.h"
+#include "hetu/core/memory_pool.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include "hetu/impl/stream/CUDAStream.h"
+#include "hetu/utils/json/json.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <numeric>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hetu {
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr size_t kHeaderSizeBytes = sizeof(uint64_t);
+// Hard limit of the header size, the same as the reference implementation
+constexpr uint64_t kMaxHeaderBytes = 100000000;
+constexpr const char* kMetadataKey = "__metadata__";
+
+inline size_t NumBytes(const NDArrayMeta& meta) {
+  if (meta.dtype == kFloat4 || meta.dtype == kNFloat4)
+    return ((meta.numel() + 1) / 2) * DataType2Size(meta.dtype);
+  return meta.numel() * DataType2Size(meta.dtype);
+}
+
+// Alignment of the data of a tensor, so that it can be used in place
+inline size_t Alignment(const NDArrayMeta& meta) {
+  return std::max<size_t>(DataType2Size(meta.dtype), 1);
+}
+
+inline void WriteFully(int fd, const void* data, size_t num_bytes,
+                       const std::string& path) {
+  const auto* ptr = static_cast<const char*>(data);
+  while (num_bytes > 0) {
+    ssize_t written = write(fd, ptr, num_bytes);
+    if (written < 0 && errno == EINTR)
+      continue;
+    HT_RUNTIME_ERROR_IF(written <= 0)
+      << "Failed to write " << path << ": " << std::strerror(errno);
+    ptr += written;
+    num_bytes -= written;
+  }
+}
+
+} // namespace
+
+std::string DataType2SafeTensorsDType(DataType dtype) {
+  switch (dtype) {
+    case kUInt8: return "U8";
+    case kInt8: return "I8";
+    case kInt16: return "I16";
+    case kInt32: return "I32";
+    case kInt64: return "I64";
+    case kFloat16: return "F16";
+    case kFloat32: return "F32";
+    case kFloat64: return "F64";
+    case kBFloat16: return "BF16";
+    case kFloat4: return "F4";
+    case kNFloat4: return "NF4";
+    case kBool: return "BOOL";
+    default:
+      HT_VALUE_ERROR << "Data type " << dtype
+                     << " is not supported by safetensors";
+      __builtin_unreachable();
+  }
+}
+
+DataType SafeTensorsDType2DataType(const std::string& dtype) {
+  static const std::unordered_map<std::string, DataType> dtypes = {
+    {"U8", kUInt8},     {"I8", kInt8},       {"I16", kInt16},
+    {"I32", kInt32},    {"I64", kInt64},     {"F16", kFloat16},
+    {"F32", kFloat32},  {"F64", kFloat64},   {"BF16", kBFloat16},
+    {"F4", kFloat4},    {"NF4", kNFloat4},   {"BOOL", kBool}};
+  auto it = dtypes.find(dtype);
+  HT_VALUE_ERROR_IF(it == dtypes.end())
+    << "Data type " << dtype << " of safetensors is not supported";
+  return it->second;
+}
+
+std::string SafeTensorsShardPath(const std::string& dir, int rank,
+                                 int num_ranks) {
+  HT_VALUE_ERROR_IF(rank < 0 || rank >= num_ranks)
+    << "Invalid rank " << rank << " of " << num_ranks << " ranks";
+  std::string name = "hetu_pytorch_model-" + std::to_string(rank + 1) +
+    "-of-" + std::to_string(num_ranks) + ".safetensors";
+  if (dir.empty())
+    return name;
+  return dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+/******************************************************
+ * Writer
+ ******************************************************/
+
+void SafeTensorsWriter::Add(const std::string& name, const NDArray& array) {
+  HT_VALUE_ERROR_IF(name == kMetadataKey)
+    << "Tensors cannot be named " << kMetadataKey;
+  HT_VALUE_ERROR_IF(std::find(_names.begin(), _names.end(), name) !=
+                    _names.end())
+    << "Tensor " << name << " has been added";
+  HT_VALUE_ERROR_IF(!array->is_cpu() && !array->is_cuda())
+    << "Cannot save arrays on " << array->device();
+  // Fail early for unsupported data types
+  DataType2SafeTensorsDType(array->dtype());
+  _names.push_back(name);
+  _arrays.push_back(array);
+}
+
+void SafeTensorsWriter::SetMetadata(const std::string& key,
+                                    const std::string& value) {
+  _metadata[key] = value;
+}
+
+SafeTensorsWriter::Snapshot SafeTensorsWriter::_Stage(bool copy_all) const {
+  NDArrayList staged;
+  staged.reserve(_arrays.size());
+  std::unordered_map<Device, bool> used_devices;
+  for (const auto& array : _arrays) {
+    NDArray host;
+    if (array->is_cuda()) {
+      // The device-to-host copy is a snapshot by itself
+      auto contiguous =
+        array->is_contiguous() ? array : NDArray::contiguous(array);
+      host = NDArray::cpu(contiguous);
+    } else if (copy_all || !array->is_contiguous()) {
+      host = NDArray::contiguous(array);
+      if (host->storage() == array->storage())
+        host = NDArray::copy(array);
+    } else {
+      host = array;
+    }
+    used_devices[array->device()] = true;
+    staged.push_back(std::move(host));
+  }
+  // The copies are enqueued on the default streams of the devices
+  std::vector<std::shared_ptr<Event>> events;
+  for (const auto& kv : used_devices) {
+    Stream stream(kv.first, NDArray::DEFAULT_STREAM);
+    std::shared_ptr<Event> event;
+    if (kv.first.is_cuda())
+      event = std::make_shared<hetu::impl::CUDAEvent>(kv.first, false);
+    else
+      event = std::make_shared<hetu::impl::CPUEvent>(false);
+    event->Record(stream);
+    events.push_back(std::move(event));
+  }
+  return {std::move(staged), std::move(events)};
+}
+
+void SafeTensorsWriter::Save(const std::string& path) {
+  auto snapshot = _Stage(false);
+  for (auto& event : snapshot.second)
+    event->Sync();
+  _Write(path, _names, snapshot.first, _metadata);
+}
+
+void SafeTensorsWriter::SaveAsync(const std::string& path,
+                                  const Stream& stream) {
+  HT_VALUE_ERROR_IF(!stream.device().is_cpu() || stream.is_blocking())
+    << "Files must be written on a non-blocking CPU stream, got " << stream;
+  auto snapshot = _Stage(true);
+  hetu::impl::CPUStream(stream).PostTask(
+    [path, names = _names, snapshot = std::move(snapshot),
+     metadata = _metadata]() {
+      for (auto& event : snapshot.second)
+        event->Sync();
+      _Write(path, names, snapshot.first, metadata);
+    },
+    "SaveSafeTensors");
+}
+
+void SafeTensorsWriter::_Write(
+  const std::string& path, const std::vector<std::string>& names,
+  const NDArrayList& arrays,
+  const std::map<std::string, std::string>& metadata) {
+  // Safetensors does not allow gaps between tensors, so the tensors are
+  // ordered by decreasing alignment instead of being padded. The sizes of
+  // the data types are powers of two, hence every offset is then a multiple
+  // of the alignment of its tensor, as in the reference implementation.
+  std::vector<size_t> order(names.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return Alignment(arrays[a]->meta()) > Alignment(arrays[b]->meta());
+  });
+  json header = json::object();
+  size_t offset = 0;
+  for (size_t i : order) {
+    const auto& meta = arrays[i]->meta();
+    size_t num_bytes = NumBytes(meta);
+    header[names[i]] = {{"dtype", DataType2SafeTensorsDType(meta.dtype)},
+                        {"shape", meta.shape},
+                        {"data_offsets", {offset, offset + num_bytes}}};
+    offset += num_bytes;
+  }
+  if (!metadata.empty())
+    header[kMetadataKey] = metadata;
+  std::string header_str = header.dump();
+  // Pad the header with spaces so that the data starts at 8-byte alignment
+  header_str.append((8 - header_str.size() % 8) % 8, ' ');
+  uint64_t header_size = header_str.size();
+
+  // Write to a temporary file first so that a crash never leaves a
+  // truncated checkpoint behind
+  std::string tmp_path = path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  HT_RUNTIME_ERROR_IF(fd < 0)
+    << "Failed to open " << tmp_path << ": " << std::strerror(errno);
+  WriteFully(fd, &header_size, kHeaderSizeBytes, tmp_path);
+  WriteFully(fd, header_str.data(), header_str.size(), tmp_path);
+  for (size_t i : order)
+    WriteFully(fd, arrays[i]->raw_data_ptr(), NumBytes(arrays[i]->meta()),
+               tmp_path);
+  HT_RUNTIME_ERROR_IF(close(fd) != 0)
+    << "Failed to close " << tmp_path << ": " << std::strerror(errno);
+  HT_RUNTIME_ERROR_IF(std::rename(tmp_path.c_str(), path.c_str()) != 0)
+    << "Failed to rename " << tmp_path << " to " << path << ": "
+    << std::strerror(errno);
+  HT_LOG_DEBUG << "Saved " << names.size() << " tensor(s) of " << offset
+               << " bytes to " << path;
+}
+
+/******************************************************
+ * Reader
+ ******************************************************/
+
+struct SafeTensorsReader::Mapping {
+  Mapping(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    HT_RUNTIME_ERROR_IF(fd < 0)
+      << "Failed to open " << path << ": " << std::strerror(errno);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      HT_RUNTIME_ERROR << "Failed to stat " << path << ": "
+                       << std::strerror(errno);
+    }
+    size = st.st_size;
+    if (size > 0) {
+      // Private mappings are copy-on-write, so the arrays can be updated
+      // in place without touching the file
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    HT_RUNTIME_ERROR_IF(data == MAP_FAILED)
+      << "Failed to mmap " << path << ": " << std::strerror(errno);
+  }
+
+  ~Mapping() {
+    if (data != nullptr && data != MAP_FAILED)
+      munmap(data, size);
+  }
+
+  void* data{nullptr};
+  size_t size{0};
+};
+
+SafeTensorsReader::SafeTensorsReader(const std::string& path)
+: _path(path), _mapping(std::make_shared<Mapping>(path)) {
+  HT_RUNTIME_ERROR_IF(_mapping->size < kHeaderSizeBytes)
+    << "File " << path << " is too small to be a safetensors file";
+  const auto* base = static_cast<const char*>(_mapping->data);
+  uint64_t header_size;
+  std::memcpy(&header_size, base, kHeaderSizeBytes);
+  HT_RUNTIME_ERROR_IF(header_size > kMaxHeaderBytes ||
+                      kHeaderSizeBytes + header_size > _mapping->size)
+    << "Invalid header size " << header_size << " of " << path;
+  json header;
+  try {
+    header = json::parse(base + kHeaderSizeBytes,
+                         base + kHeaderSizeBytes + header_size);
+  } catch (const json::exception& e) {
+    HT_RUNTIME_ERROR << "Failed to parse the header of " << path << ": "
+                     << e.what();
+  }
+  size_t data_begin = kHeaderSizeBytes + header_size;
+  size_t data_size = _mapping->size - data_begin;
+  for (auto it = header.begin(); it != header.end(); ++it) {
+    if (it.key() == kMetadataKey) {
+      for (auto kv = it->begin(); kv != it->end(); ++kv)
+        _metadata[kv.key()] = kv->get<std::string>();
+      continue;
+    }
+    Entry entry;
+    entry.meta.set_dtype(SafeTensorsDType2DataType(it->at("dtype")))
+      .set_shape(it->at("shape").get<HTShape>())
+      .set_device(Device(kCPU));
+    const auto& offsets = it->at("data_offsets");
+    entry.begin = offsets.at(0).get<size_t>();
+    entry.end = offsets.at(1).get<size_t>();
+    HT_RUNTIME_ERROR_IF(entry.begin > entry.end || entry.end > data_size ||
+                        entry.end - entry.begin != NumBytes(entry.meta))
+      << "Invalid data offsets [" << entry.begin << ", " << entry.end
+      << ") of tensor " << it.key() << " in " << path;
+    entry.begin += data_begin;
+    entry.end += data_begin;
+    _entries.emplace(it.key(), std::move(entry));
+  }
+}
+
+std::vector<std::string> SafeTensorsReader::names() const {
+  std::vector<std::pair<size_t, std::string>> ordered;
+  ordered.reserve(_entries.size());
+  for (const auto& kv : _entries)
+    ordered.emplace_back(kv.second.begin, kv.first);
+  std::sort(ordered.begin(), ordered.end());
+  std::vector<std::string> ret;
+  ret.reserve(ordered.size());
+  for (auto& kv : ordered)
+    ret.push_back(std::move(kv.second));
+  return ret;
+}
+
+const NDArrayMeta& SafeTensorsReader::meta(const std::string& name) const {
+  auto it = _entries.find(name);
+  HT_VALUE_ERROR_IF(it == _entries.end())
+    << "Tensor " << name << " does not exist in " << _path;
+  return it->second.meta;
+}
+
+NDArray SafeTensorsReader::Get(const std::string& name) const {
+  auto it = _entries.find(name);
+  HT_VALUE_ERROR_IF(it == _entries.end())
+    << "Tensor " << name << " does not exist in " << _path;
+  const auto& entry = it->second;
+  if (entry.begin == entry.end)
+    return NDArray::empty(entry.meta.shape, Device(kCPU), entry.meta.dtype,
+                          kBlockingStream);
+  auto* ptr = static_cast<char*>(_mapping->data) + entry.begin;
+  if (reinterpret_cast<uintptr_t>(ptr) % Alignment(entry.meta) != 0) {
+    // Other writers may not align the data, which then cannot be borrowed
+    auto ret = NDArray::empty(entry.meta.shape, Device(kCPU),
+                              entry.meta.dtype, kBlockingStream);
+    std::memcpy(ret->raw_data_ptr(), ptr, entry.end - entry.begin);
+    return ret;
+  }
+  auto mapping = _mapping;
+  auto storage = std::make_shared<NDArrayStorage>(BorrowToMemoryPool(
+    Device(kCPU), ptr, entry.end - entry.begin,
+    [mapping](DataPtr) {}));
+  return NDArray(entry.meta, storage);
+}
+
+} // namespace hetu
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "hetu/core/ndarray.h"
+#include <map>
+
+namespace hetu {
+
+// Reading and writing NDArrays in the safetensors format
+// (https://github.com/huggingface/safetensors): an 8-byte little-endian
+// header size, a JSON header describing the dtype, shape and byte range of
+// each tensor, followed by the raw bytes of all tensors.
+
+// CPU stream on which `SafeTensorsWriter::SaveAsync` writes files by default
+constexpr StreamIndex kSafeTensorsStream = kOffloadStream;
+
+std::string DataType2SafeTensorsDType(DataType dtype);
+
+DataType SafeTensorsDType2DataType(const std::string& dtype);
+
+// File holding the tensors of `rank` among `num_ranks` ranks in a sharded
+// checkpoint under `dir`, following the naming of the Python checkpoints.
+std::string SafeTensorsShardPath(const std::string& dir, int rank,
+                                 int num_ranks);
+
+class SafeTensorsWriter {
+ public:
+  SafeTensorsWriter() = default;
+
+  // Tensors of the same alignment are written in the order they are added,
+  // those of larger data types first. Non-contiguous arrays and arrays on
+  // CUDA devices are staged to contiguous host arrays.
+  void Add(const std::string& name, const NDArray& array);
+
+  void SetMetadata(const std::string& key, const std::string& value);
+
+  // Writes the file and returns after it is closed.
+  void Save(const std::string& path);
+
+  // Snapshots the arrays and writes the file on the CPU stream `stream`, so
+  // that the arrays can be updated again as soon as this call returns.
+  // Call `stream.Sync()` to wait for the file to be written.
+  void SaveAsync(const std::string& path,
+                 const Stream& stream = Stream(Device(kCPU),
+                                               kSafeTensorsStream));
+
+  size_t num_tensors() const {
+    return _names.size();
+  }
+
+ private:
+  using Snapshot = std::pair<NDArrayList, std::vector<std::shared_ptr<Event>>>;
+
+  // Enqueues the copies of the arrays that cannot be written in place (or
+  // all arrays when `copy_all` is true) and records events after them.
+  Snapshot _Stage(bool copy_all) const;
+
+  static void _Write(const std::string& path,
+                     const std::vector<std::string>& names,
+                     const NDArrayList& arrays,
+                     const std::map<std::string, std::string>& metadata);
+
+  std::vector<std::string> _names;
+  NDArrayList _arrays;
+  std::map<std::string, std::string> _metadata;
+};
+
+// Maps a safetensors file into memory. Arrays returned by `Get` borrow the
+// mapped pages into the CPU memory pool without copying, unless their data
+// is not aligned to their data type, which is copied. The mapping is
+// private, so in-place updates of the arrays never reach the file, and it is
+// kept alive until both the reader and all arrays are released.
+class SafeTensorsReader {
+ public:
+  explicit SafeTensorsReader(const std::string& path);
+
+  bool contains(const std::string& name) const {
+    return _entries.find(name) != _entries.end();
+  }
+
+  std::vector<std::string> names() const;
+
+  const NDArrayMeta& meta(const std::string& name) const;
+
+  NDArray Get(const std::string& name) const;
+
+  const std::map<std::string, std::string>& metadata() const {
+    return _metadata;
+  }
+
+  const std::string& path() const {
+    return _path;
+  }
+
+ private:
+  struct Mapping;
+
+  struct Entry {
+    NDArrayMeta meta;
+    size_t begin;
+    size_t end;
+  };
+
+  const std::string _path;
+  std::shared_ptr<Mapping> _mapping;
+  std::unordered_map<std::string, Entry> _entries;
+  std::map<std::string, std::string> _metadata;
+};
+
+} // namespace hetu
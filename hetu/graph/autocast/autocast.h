@@ -30,6 +30,16 @@ public:
     return _cast_type;
   }
 
+  // The type ops placed on `device` are cast to. CPUs compute in bf16
+  // (through DNNL on AVX-512 BF16/AMX) as most of them have no fast fp16
+  // path, so fp16 and the default autocast both mean bf16 there.
+  DataType cast_type(const Device& device) const {
+    if (device.is_cpu() && (_cast_type == DataType::UNDETERMINED ||
+                            _cast_type == DataType::FLOAT16))
+      return DataType::BFLOAT16;
+    return _cast_type;
+  }
+
   AutoCastId id() const {
     return _id;
   }
@@ -27,8 +27,6 @@ TensorList GradScaler::scale(TensorList outputs) {
   }
   MultiDeviceTensor scales(_scale);
   for (auto& output: outputs) {
-    HT_ASSERT(output->device().is_cuda())
-    << "Cpu is not supported.";
     outputlist.push_back(MakeMulElewiseOp(output, scales.fetch(output->device())));
   }
   return outputlist;
@@ -0,0 +1,94 @@
+#include "hetu/graph/checkpoint/sharded_safetensors.h"
+#include "hetu/utils/json/json.hpp"
+
+namespace hetu {
+namespace graph {
+
+using json = nlohmann::json;
+
+std::string ShardedSafeTensorsDSKey(const std::string& name) {
+  return "ds." + name;
+}
+
+// Same fields as the `param_states` json files of the Python checkpoints
+std::string DistributedStates2Json(const DistributedStates& ds) {
+  HT_VALUE_ERROR_IF(!ds.is_valid())
+    << "Cannot serialize invalid distributed states";
+  json states = json::object();
+  for (const auto& kv : ds.get_states())
+    states[std::to_string(kv.first)] = kv.second;
+  json ret = {{"device_num", ds.get_device_num()},
+              {"order", ds.get_order()},
+              {"states", states},
+              {"zero", ds.zero()}};
+  return ret.dump();
+}
+
+DistributedStates Json2DistributedStates(const std::string& str) {
+  json ds_json;
+  try {
+    ds_json = json::parse(str);
+  } catch (const json::exception& e) {
+    HT_VALUE_ERROR << "Failed to parse distributed states " << str << ": "
+                   << e.what();
+  }
+  std::unordered_map<int32_t, int32_t> states;
+  for (auto it = ds_json.at("states").begin();
+       it != ds_json.at("states").end(); ++it)
+    states[std::stoi(it.key())] = it->get<int32_t>();
+  return DistributedStates(ds_json.at("device_num").get<int32_t>(), states,
+                           ds_json.at("order").get<std::vector<int32_t>>(),
+                           ds_json.value("zero", false));
+}
+
+void SaveShardedSafeTensors(const std::string& dir, int rank, int num_ranks,
+                            const std::vector<std::string>& names,
+                            const NDArrayList& shards,
+                            const DistributedStatesList& ds_list,
+                            bool non_blocking) {
+  HT_VALUE_ERROR_IF(names.size() != shards.size() ||
+                    names.size() != ds_list.size())
+    << "Got " << names.size() << " names, " << shards.size()
+    << " shards and " << ds_list.size() << " distributed states";
+  SafeTensorsWriter writer;
+  for (size_t i = 0; i < names.size(); i++) {
+    writer.Add(names[i], shards[i]);
+    writer.SetMetadata(ShardedSafeTensorsDSKey(names[i]),
+                       DistributedStates2Json(ds_list[i]));
+  }
+  writer.SetMetadata("rank", std::to_string(rank));
+  writer.SetMetadata("num_ranks", std::to_string(num_ranks));
+  auto path = SafeTensorsShardPath(dir, rank, num_ranks);
+  if (non_blocking)
+    writer.SaveAsync(path);
+  else
+    writer.Save(path);
+}
+
+void SyncShardedSafeTensors() {
+  Stream(Device(kCPU), kSafeTensorsStream).Sync();
+}
+
+ShardedTensorDict LoadShardedSafeTensors(const std::string& dir, int rank,
+                                         int num_ranks) {
+  SafeTensorsReader reader(SafeTensorsShardPath(dir, rank, num_ranks));
+  const auto& metadata = reader.metadata();
+  auto it = metadata.find("num_ranks");
+  HT_RUNTIME_ERROR_IF(it != metadata.end() &&
+                      it->second != std::to_string(num_ranks))
+    << reader.path() << " was saved with " << it->second
+    << " ranks, but " << num_ranks << " ranks are loading it";
+  ShardedTensorDict ret;
+  for (const auto& name : reader.names()) {
+    ShardedTensor tensor;
+    tensor.shard = reader.Get(name);
+    auto ds_it = metadata.find(ShardedSafeTensorsDSKey(name));
+    if (ds_it != metadata.end())
+      tensor.ds = Json2DistributedStates(ds_it->second);
+    ret.emplace(name, std::move(tensor));
+  }
+  return ret;
+}
+
+} // namespace graph
+} // namespace hetu
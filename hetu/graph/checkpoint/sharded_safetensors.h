@@ -0,0 +1,46 @@
+#pragma once
+
+#include "hetu/core/safetensors.h"
+#include "hetu/graph/distributed_states.h"
+
+namespace hetu {
+namespace graph {
+
+// A sharded checkpoint holds one safetensors file per rank (see
+// `SafeTensorsShardPath`), each with the local shards of the tensors placed
+// on that rank. The distributed states of every tensor are recorded in the
+// metadata of the file, so that the shards can be matched against the
+// distributed states of the model being loaded.
+
+struct ShardedTensor {
+  NDArray shard;
+  DistributedStates ds;
+};
+
+using ShardedTensorDict = std::unordered_map<std::string, ShardedTensor>;
+
+// Metadata key holding the distributed states of tensor `name`
+std::string ShardedSafeTensorsDSKey(const std::string& name);
+
+std::string DistributedStates2Json(const DistributedStates& ds);
+
+DistributedStates Json2DistributedStates(const std::string& str);
+
+// Writes the local shards of `rank`. With `non_blocking`, the shards are
+// snapshotted and written on the CPU stream `kSafeTensorsStream`.
+void SaveShardedSafeTensors(const std::string& dir, int rank, int num_ranks,
+                            const std::vector<std::string>& names,
+                            const NDArrayList& shards,
+                            const DistributedStatesList& ds_list,
+                            bool non_blocking = false);
+
+// Waits for the files written asynchronously.
+void SyncShardedSafeTensors();
+
+// Maps the file of `rank` and returns its shards, which borrow the mapped
+// pages without copying.
+ShardedTensorDict LoadShardedSafeTensors(const std::string& dir, int rank,
+                                         int num_ranks);
+
+} // namespace graph
+} // namespace hetu
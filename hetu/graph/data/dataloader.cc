@@ -11,12 +11,28 @@
 namespace hetu {
 namespace graph {
 
+namespace {
+// Each data parallel rank streams a contiguous range of the records
+inline std::pair<uint64_t, uint64_t>
+MmapRecordRange(uint64_t num_records, int dp_rank, int dp_nrank) {
+  if (dp_nrank == -1)
+    return {0, num_records};
+  return {num_records * dp_rank / dp_nrank,
+          num_records * (dp_rank + 1) / dp_nrank};
+}
+} // namespace
+
 void Dataloader::init_states() {
   auto& inst_ctx = instantiation_ctx();
   inst_ctx.placement = Device(kCPU, 0);
   inst_ctx.stream_index = 0;
   inst_ctx.start[0] = std::make_unique<hetu::impl::CPUEvent>();
   inst_ctx.stop[0] = std::make_unique<hetu::impl::CPUEvent>();
+  _prefetcher = nullptr;
+  if (is_mmap()) {
+    init_mmap_states();
+    return;
+  }
 
   if (_dp_nrank != -1) {
     int cur_size = _data->shape(0);
@@ -70,6 +86,41 @@ void Dataloader::init_states() {
   _batch_idx = 0;
 }
 
+void Dataloader::init_mmap_states() {
+  auto range = MmapRecordRange(_mmap_dataset->num_records(), _dp_rank,
+                               _dp_nrank);
+  _samples_num = range.second - range.first;
+  HT_ASSERT(_batch_size > 0) << "Invalid batch size.";
+  _batch_num = _drop_last ? (_samples_num / _batch_size)
+                          : std::ceil(double(_samples_num) / _batch_size);
+  HT_ASSERT(_batch_num > 0)
+    << "Dataloader " << _name << " cannot make a batch of " << _batch_size
+    << " from " << _samples_num << " samples.";
+  _shape = {_batch_size};
+  const auto& record_shape = _mmap_dataset->record_shape();
+  _shape.insert(_shape.end(), record_shape.begin(), record_shape.end());
+  // Batches are held by the prefetcher rather than the preloading queue
+  _queue_size = 0;
+  _arrs = {};
+  _arr_map = {};
+  processers = std::vector<std::future<void>>();
+  _index = 0;
+  _batch_idx = 0;
+}
+
+MmapBatchPrefetcher& Dataloader::prefetcher() {
+  // Created on first use, so that the temporaries copied around during
+  // construction never start prefetching
+  if (_prefetcher == nullptr) {
+    auto range = MmapRecordRange(_mmap_dataset->num_records(), _dp_rank,
+                                 _dp_nrank);
+    _prefetcher = std::make_unique<MmapBatchPrefetcher>(
+      _mmap_dataset, range.first, range.second, _batch_size, _shuffle,
+      _drop_last, _num_workers, _prefetch, _seed, _pin_memory);
+  }
+  return *_prefetcher;
+}
+
 void Dataloader::pre_load(int cur_index, int next_index, int temp_id) {
   if (next_index <= _samples_num) {
     _arrs[temp_id] = reshape_tensor(cur_index, next_index);
@@ -81,6 +132,13 @@ void Dataloader::pre_load(int cur_index, int next_index, int temp_id) {
 }
 
 NDArray Dataloader::_get_arr(int batch_idx) {
+  if (is_mmap()) {
+    // An undefined array marks the end of an epoch
+    NDArray res = prefetcher().Next();
+    if (!res.is_defined())
+      _batch_idx = 0;
+    return res;
+  }
   int temp_id = _arr_map[_min_key];
   // HT_LOG_INFO << batch_idx << "," << _min_key << "," << temp_id;
   if (processers[temp_id].valid())
@@ -114,9 +172,11 @@ NDArray Dataloader::_get_arr(int batch_idx) {
 }
 
 Tensor Dataloader::get_arr() {
-  if (_batch_idx == _batch_num)
+  if (_batch_idx == _batch_num && !is_mmap())
     return Tensor();
   NDArray res = _get_arr(_batch_idx);
+  if (!res.is_defined())
+    return Tensor();
   _last_batch_size = res->shape(0); 
   _batch_idx = (_batch_idx + 1) ;
   return MakeVariableOp(res, false, res->meta().dtype, false, DistributedStatesHierarchy(), OpMeta().set_eager_device(res->meta().device));
@@ -124,16 +184,21 @@ Tensor Dataloader::get_arr() {
 
 Tensor Dataloader::get_next_arr() {
   NDArray res = _get_arr(_batch_idx);
+  if (!res.is_defined())
+    res = _get_arr(_batch_idx);
   return MakeVariableOp(res, false, res->meta().dtype, false, DistributedStatesHierarchy(), OpMeta().set_eager_device(res->meta().device));
 }
 
 void Dataloader::set_dp_rank(int dp_rank, int dp_nrank) {
+  bool changed = dp_rank != _dp_rank || dp_nrank != _dp_nrank;
   if (_dp_nrank != -1) {
     HT_ASSERT(dp_rank == _dp_rank);
     HT_ASSERT(dp_nrank == _dp_nrank);
   }
   _dp_rank = dp_rank;
   _dp_nrank = dp_nrank;
+  if (is_mmap() && changed)
+    init_states();
 }
 
 void Dataloader::set_mp_parts(int cur_part, int parts) {
@@ -164,6 +229,8 @@ NDArray Dataloader::reshape_tensor(int begin_pos, int end_pos) {
 }
 
 HTShape Dataloader::get_cur_shape() {
+  if (is_mmap())
+    return prefetcher().next_shape();
   return _arrs[_arr_map[_batch_idx]]->shape();
 }
 
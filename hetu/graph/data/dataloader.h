@@ -5,6 +5,7 @@
 #include "hetu/common/macros.h"
 #include "hetu/utils/shared_ptr_wrapper.h"
 #include "hetu/graph/operator.h"
+#include "hetu/graph/data/mmap_dataset.h"
 #include "math.h"
 
 namespace hetu {
@@ -32,6 +33,28 @@ class Dataloader{
     init_states();
   }
 
+  // Streams fixed-width records from memory-mapped shard files (see
+  // `MmapShardHeader`) instead of holding the whole dataset in memory.
+  // Batches are gathered by `num_workers` background workers into (pinned)
+  // staging buffers, with at most `prefetch` batches in flight.
+  Dataloader(const std::vector<std::string>& shard_paths, int batch_size,
+             int num_workers = 0, DataloaderName name = "default",
+             bool shuffle = false, bool drop_last = true, int prefetch = 4,
+             bool pin_memory = true, uint64_t seed = 0):
+  _mmap_dataset(std::make_shared<MmapDataset>(shard_paths, shuffle)),
+  _num_workers(num_workers),
+  _batch_size(batch_size),
+  _name(name),
+  _shuffle(shuffle),
+  _drop_last(drop_last),
+  _dp_rank(-1),
+  _dp_nrank(-1),
+  _prefetch(prefetch),
+  _pin_memory(pin_memory),
+  _seed(seed) {
+    init_states();
+  }
+
   ~Dataloader() {
     int len = processers.size();
     for (int i = 0; i < len; ++i) {
@@ -43,6 +66,11 @@ class Dataloader{
 
   Dataloader(Dataloader&& resource) {
     _data = std::move(resource._data);
+    _mmap_dataset = std::move(resource._mmap_dataset);
+    _prefetcher = std::move(resource._prefetcher);
+    _prefetch = resource._prefetch;
+    _pin_memory = resource._pin_memory;
+    _seed = resource._seed;
     _num_workers = resource._num_workers;
     _batch_size = resource._batch_size;
     _name = resource._name;
@@ -81,6 +109,10 @@ class Dataloader{
 
   Dataloader(const Dataloader& resource) {
     _data = resource._data;
+    _mmap_dataset = resource._mmap_dataset;
+    _prefetch = resource._prefetch;
+    _pin_memory = resource._pin_memory;
+    _seed = resource._seed;
     _num_workers = resource._num_workers;
     _batch_size = resource._batch_size;
     _name = resource._name;
@@ -93,6 +125,10 @@ class Dataloader{
 
   Dataloader& operator=(const Dataloader& resource) {
     _data = resource._data;
+    _mmap_dataset = resource._mmap_dataset;
+    _prefetch = resource._prefetch;
+    _pin_memory = resource._pin_memory;
+    _seed = resource._seed;
     _num_workers = resource._num_workers;
     _batch_size = resource._batch_size;
     _name = resource._name;
@@ -101,6 +137,7 @@ class Dataloader{
     _dp_rank = -1;
     _dp_nrank = -1;
     init_states();
+    return *this;
   }
 
   void init_states();
@@ -138,7 +175,11 @@ class Dataloader{
   }
 
   DataType dtype() const {
-    return _data->dtype();
+    return is_mmap() ? _mmap_dataset->dtype() : _data->dtype();
+  }
+
+  bool is_mmap() const {
+    return _mmap_dataset != nullptr;
   }
 
   DataloaderName name() const {
@@ -214,6 +255,21 @@ class Dataloader{
   std::vector<std::future<void>> processers;
 
   std::vector<int> shuffled;
+
+  // States of the memory-mapped mode
+  void init_mmap_states();
+
+  MmapBatchPrefetcher& prefetcher();
+
+  std::shared_ptr<MmapDataset> _mmap_dataset;
+
+  std::unique_ptr<MmapBatchPrefetcher> _prefetcher;
+
+  int _prefetch{4};
+
+  bool _pin_memory{true};
+
+  uint64_t _seed{0};
 };
 
 
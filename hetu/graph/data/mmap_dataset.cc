@@ -0,0 +1,384 @@
+#include "hetu/graph/data/mmap_dataset.h"
+#include "hetu/core/memory_pool.h"
+#include "hetu/impl/stream/CUDAStream.h"
+#include "hetu/impl/utils/cuda_utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hetu {
+namespace graph {
+
+namespace {
+constexpr char kMmapShardMagic[8] = "HTSHARD";
+
+inline bool IsPackedDataType(DataType dtype) {
+  return dtype == kFloat4 || dtype == kNFloat4;
+}
+} // namespace
+
+/******************************************************
+ * Shards
+ ******************************************************/
+
+MmapShard::MmapShard(const std::string& path, bool random_access)
+: _path(path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  HT_RUNTIME_ERROR_IF(fd < 0)
+    << "Failed to open shard " << path << ": " << std::strerror(errno);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    HT_RUNTIME_ERROR << "Failed to stat shard " << path << ": "
+                     << std::strerror(errno);
+  }
+  _mapped_size = st.st_size;
+  if (_mapped_size < sizeof(MmapShardHeader)) {
+    close(fd);
+    HT_RUNTIME_ERROR << "Shard " << path << " is too small to hold a header";
+  }
+
+  // The mapping keeps the file open, so the descriptor is not needed after
+  // mapping it
+  void* mapped =
+    mmap(nullptr, _mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  HT_RUNTIME_ERROR_IF(mapped == MAP_FAILED)
+    << "Failed to mmap shard " << path << ": " << std::strerror(errno);
+  _mapped = static_cast<uint8_t*>(mapped);
+  // The destructor does not run if the constructor throws
+  try {
+    _CheckHeader();
+  } catch (...) {
+    munmap(_mapped, _mapped_size);
+    throw;
+  }
+
+  // Shuffled reads touch random pages, so read-ahead would only pollute
+  // the page cache
+  madvise(_mapped, _mapped_size,
+          random_access ? MADV_RANDOM : MADV_SEQUENTIAL);
+}
+
+MmapShard::~MmapShard() {
+  munmap(_mapped, _mapped_size);
+}
+
+void MmapShard::_CheckHeader() {
+  std::memcpy(&_header, _mapped, sizeof(MmapShardHeader));
+  HT_RUNTIME_ERROR_IF(std::memcmp(_header.magic, kMmapShardMagic,
+                                  sizeof(kMmapShardMagic)) != 0)
+    << "File " << _path << " is not a shard";
+  HT_RUNTIME_ERROR_IF(_header.version != kMmapShardVersion)
+    << "Unsupported version " << _header.version << " of shard " << _path;
+  HT_RUNTIME_ERROR_IF(_header.dtype < 0 || _header.dtype >= NUM_DATA_TYPES ||
+                      IsPackedDataType(static_cast<DataType>(_header.dtype)))
+    << "Invalid data type " << _header.dtype << " of shard " << _path;
+  HT_RUNTIME_ERROR_IF(_header.ndim > kMmapShardMaxDims)
+    << "Invalid number of dimensions " << _header.ndim << " of shard "
+    << _path;
+  size_t record_bytes = DataType2Size(static_cast<DataType>(_header.dtype));
+  for (uint32_t i = 0; i < _header.ndim; i++) {
+    HT_RUNTIME_ERROR_IF(_header.record_shape[i] <= 0)
+      << "Invalid record shape of shard " << _path;
+    record_bytes *= _header.record_shape[i];
+  }
+  HT_RUNTIME_ERROR_IF(_header.data_offset < sizeof(MmapShardHeader) ||
+                      _header.data_offset +
+                          _header.num_records * record_bytes >
+                        _mapped_size)
+    << "Shard " << _path << " is truncated: expected "
+    << _header.num_records << " records of " << record_bytes
+    << " bytes from offset " << _header.data_offset << ", got "
+    << _mapped_size << " bytes in total";
+}
+
+/******************************************************
+ * Datasets
+ ******************************************************/
+
+MmapDataset::MmapDataset(const std::vector<std::string>& paths,
+                         bool random_access) {
+  HT_VALUE_ERROR_IF(paths.empty()) << "No shards are provided";
+  _offsets.reserve(paths.size() + 1);
+  _offsets.push_back(0);
+  for (const auto& path : paths) {
+    _shards.emplace_back(new MmapShard(path, random_access));
+    const auto& header = _shards.back()->header();
+    HTShape record_shape(header.record_shape,
+                         header.record_shape + header.ndim);
+    if (_shards.size() == 1) {
+      _dtype = static_cast<DataType>(header.dtype);
+      _record_shape = record_shape;
+      _record_bytes = DataType2Size(_dtype) * NumEl(_record_shape);
+    } else {
+      HT_VALUE_ERROR_IF(static_cast<DataType>(header.dtype) != _dtype ||
+                        record_shape != _record_shape)
+        << "Shard " << path << " has records of "
+        << static_cast<DataType>(header.dtype) << record_shape
+        << ", which mismatches " << _dtype << _record_shape
+        << " of shard " << paths.front();
+    }
+    _offsets.push_back(_offsets.back() + header.num_records);
+  }
+  HT_LOG_DEBUG << "Mapped " << paths.size() << " shard(s) with "
+               << num_records() << " records of " << _dtype << _record_shape;
+}
+
+void MmapDataset::CopyRecords(const uint64_t* indices, size_t num_indices,
+                              void* dst) const {
+  auto* out = static_cast<uint8_t*>(dst);
+  size_t i = 0;
+  while (i < num_indices) {
+    uint64_t index = indices[i];
+    HT_VALUE_ERROR_IF(index >= num_records())
+      << "Record index " << index << " is out of range [0, "
+      << num_records() << ")";
+    size_t shard_id =
+      std::upper_bound(_offsets.begin(), _offsets.end(), index) -
+      _offsets.begin() - 1;
+    uint64_t shard_end = _offsets[shard_id + 1];
+    size_t run = 1;
+    while (i + run < num_indices && indices[i + run] == index + run &&
+           index + run < shard_end)
+      run++;
+    std::memcpy(out + i * _record_bytes,
+                _shards[shard_id]->records() +
+                  (index - _offsets[shard_id]) * _record_bytes,
+                run * _record_bytes);
+    i += run;
+  }
+}
+
+void MmapDataset::WriteShard(const std::string& path, const NDArray& data) {
+  HT_VALUE_ERROR_IF(!data->is_cpu() || !data->is_contiguous())
+    << "Shards can only be written from contiguous CPU arrays";
+  HT_VALUE_ERROR_IF(data->ndim() < 1 ||
+                    data->ndim() > kMmapShardMaxDims + 1)
+    << "Cannot write an array of " << data->ndim() << " dimensions as a "
+    << "shard";
+  HT_VALUE_ERROR_IF(IsPackedDataType(data->dtype()))
+    << "Cannot write arrays of " << data->dtype() << " as a shard";
+
+  MmapShardHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMmapShardMagic, sizeof(kMmapShardMagic));
+  header.version = kMmapShardVersion;
+  header.dtype = static_cast<int32_t>(data->dtype());
+  header.num_records = data->shape(0);
+  header.data_offset = kMmapShardDataOffset;
+  header.ndim = data->ndim() - 1;
+  for (uint32_t i = 0; i < header.ndim; i++)
+    header.record_shape[i] = data->shape(i + 1);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  HT_RUNTIME_ERROR_IF(!out) << "Failed to open " << path << " for writing";
+  std::vector<char> header_page(kMmapShardDataOffset, 0);
+  std::memcpy(header_page.data(), &header, sizeof(header));
+  out.write(header_page.data(), header_page.size());
+  out.write(static_cast<const char*>(data->raw_data_ptr()),
+            data->numel() * DataType2Size(data->dtype()));
+  out.flush();
+  HT_RUNTIME_ERROR_IF(!out) << "Failed to write shard " << path;
+}
+
+/******************************************************
+ * Staging buffers
+ ******************************************************/
+
+MmapStagingBufferPool::MmapStagingBufferPool(size_t buffer_bytes,
+                                             size_t max_cached, bool pinned)
+: _buffer_bytes(buffer_bytes), _max_cached(max_cached), _pinned(pinned) {
+  if (_pinned && hetu::impl::GetCUDADeiceCount() == 0) {
+    HT_LOG_DEBUG << "No CUDA devices found. "
+                 << "Staging buffers will not be page-locked.";
+    _pinned = false;
+  }
+}
+
+MmapStagingBufferPool::~MmapStagingBufferPool() {
+  for (void* ptr : _cached)
+    _Free(ptr);
+}
+
+NDArray MmapStagingBufferPool::Acquire(const NDArrayMeta& meta) {
+  size_t num_bytes = meta.numel() * DataType2Size(meta.dtype);
+  HT_ASSERT(num_bytes <= _buffer_bytes)
+    << "Requested " << num_bytes << " bytes from staging buffers of "
+    << _buffer_bytes << " bytes";
+  void* ptr = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (!_cached.empty()) {
+      ptr = _cached.back();
+      _cached.pop_back();
+    }
+  }
+  if (ptr == nullptr)
+    ptr = _Alloc();
+  auto pool = shared_from_this();
+  auto storage = std::make_shared<NDArrayStorage>(BorrowToMemoryPool(
+    Device(kCPU), ptr, num_bytes,
+    [pool, ptr](DataPtr) { pool->_Release(ptr); }));
+  return NDArray(meta, storage);
+}
+
+void* MmapStagingBufferPool::_Alloc() {
+  void* ptr = nullptr;
+  if (_pinned) {
+    CUDA_CALL(cudaHostAlloc(&ptr, _buffer_bytes, cudaHostAllocPortable));
+  } else {
+    int err = posix_memalign(&ptr, kMmapShardDataOffset, _buffer_bytes);
+    HT_BAD_ALLOC_IF(err != 0 || ptr == nullptr)
+      << "Failed to allocate a staging buffer of " << _buffer_bytes
+      << " bytes";
+  }
+  return ptr;
+}
+
+void MmapStagingBufferPool::_Free(void* ptr) {
+  if (_pinned) {
+    CUDA_CALL(cudaFreeHost(ptr));
+  } else {
+    free(ptr);
+  }
+}
+
+void MmapStagingBufferPool::_Release(void* ptr) {
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_cached.size() < _max_cached) {
+      _cached.push_back(ptr);
+      return;
+    }
+  }
+  _Free(ptr);
+}
+
+/******************************************************
+ * Prefetching
+ ******************************************************/
+
+MmapBatchPrefetcher::MmapBatchPrefetcher(
+  std::shared_ptr<MmapDataset> dataset, uint64_t begin, uint64_t end,
+  int batch_size, bool shuffle, bool drop_last, int num_workers,
+  int prefetch, uint64_t seed, bool pin_memory)
+: _dataset(std::move(dataset)),
+  _begin(begin),
+  _end(end),
+  _batch_size(batch_size),
+  _shuffle(shuffle),
+  _drop_last(drop_last),
+  _prefetch(std::max(prefetch, 1)),
+  _seed(seed) {
+  HT_VALUE_ERROR_IF(_begin >= _end || _end > _dataset->num_records())
+    << "Invalid range [" << _begin << ", " << _end << ") of "
+    << _dataset->num_records() << " records";
+  HT_VALUE_ERROR_IF(_batch_size <= 0) << "Invalid batch size " << _batch_size;
+  uint64_t num_records = _end - _begin;
+  _batch_num = _drop_last ? num_records / _batch_size
+                          : (num_records + _batch_size - 1) / _batch_size;
+  HT_VALUE_ERROR_IF(_batch_num == 0)
+    << "Cannot make a full batch of " << _batch_size << " from "
+    << num_records << " records";
+  _buffers = std::make_shared<MmapStagingBufferPool>(
+    _batch_size * _dataset->record_bytes(), _prefetch + 2, pin_memory);
+  _workers = std::make_unique<TaskQueue>(
+    "MmapPrefetch", std::max(num_workers, 1), _prefetch);
+  _Schedule();
+}
+
+MmapBatchPrefetcher::~MmapBatchPrefetcher() {
+  for (auto& future : _pending)
+    if (future.valid())
+      future.wait();
+}
+
+NDArray MmapBatchPrefetcher::Next() {
+  if (_cur_batch == _batch_num) {
+    _cur_epoch++;
+    _cur_batch = 0;
+    return NDArray();
+  }
+  HT_ASSERT(!_pending.empty()) << "No batches have been scheduled";
+  auto future = std::move(_pending.front());
+  _pending.pop_front();
+  _cur_batch++;
+  _Schedule();
+  return future.get();
+}
+
+HTShape MmapBatchPrefetcher::next_shape() const {
+  HTShape shape = {_BatchRecords(_cur_batch < _batch_num ? _cur_batch : 0)};
+  const auto& record_shape = _dataset->record_shape();
+  shape.insert(shape.end(), record_shape.begin(), record_shape.end());
+  return shape;
+}
+
+MmapBatchPrefetcher::Order MmapBatchPrefetcher::_GetOrder(uint64_t epoch) {
+  if (!_shuffle)
+    return nullptr;
+  if (_order == nullptr || _order_epoch != epoch) {
+    auto order = std::make_shared<std::vector<uint64_t>>(_end - _begin);
+    std::iota(order->begin(), order->end(), _begin);
+    std::mt19937_64 engine(_seed + epoch);
+    std::shuffle(order->begin(), order->end(), engine);
+    _order = std::move(order);
+    _order_epoch = epoch;
+  }
+  return _order;
+}
+
+int64_t MmapBatchPrefetcher::_BatchRecords(int batch_idx) const {
+  return std::min<int64_t>(_batch_size,
+                           (_end - _begin) - int64_t(batch_idx) * _batch_size);
+}
+
+void MmapBatchPrefetcher::_Schedule() {
+  while (static_cast<int>(_pending.size()) < _prefetch) {
+    if (_sched_batch == _batch_num) {
+      _sched_epoch++;
+      _sched_batch = 0;
+    }
+    auto order = _GetOrder(_sched_epoch);
+    uint64_t pos = uint64_t(_sched_batch) * _batch_size;
+    int64_t num_records = _BatchRecords(_sched_batch);
+    HTShape shape = {num_records};
+    const auto& record_shape = _dataset->record_shape();
+    shape.insert(shape.end(), record_shape.begin(), record_shape.end());
+    auto meta = NDArrayMeta()
+                  .set_dtype(_dataset->dtype())
+                  .set_shape(shape)
+                  .set_device(Device(kCPU));
+    // The task only holds shared states, so that it never refers to the
+    // prefetcher itself
+    std::packaged_task<NDArray()> task(
+      [dataset = _dataset, buffers = _buffers, order, meta,
+       first = _begin + pos, pos, num_records]() {
+        NDArray batch = buffers->Acquire(meta);
+        if (order != nullptr) {
+          dataset->CopyRecords(order->data() + pos, num_records,
+                               batch->raw_data_ptr());
+        } else {
+          std::vector<uint64_t> indices(num_records);
+          std::iota(indices.begin(), indices.end(), first);
+          dataset->CopyRecords(indices.data(), num_records,
+                               batch->raw_data_ptr());
+        }
+        return batch;
+      });
+    _pending.push_back(task.get_future());
+    _workers->Post(std::move(task), "MmapPrefetch");
+    _sched_batch++;
+  }
+}
+
+} // namespace graph
+} // namespace hetu
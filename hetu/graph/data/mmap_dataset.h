@@ -0,0 +1,211 @@
+#pragma once
+
+#include "hetu/core/ndarray.h"
+#include "hetu/utils/task_queue.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace hetu {
+namespace graph {
+
+constexpr uint32_t kMmapShardVersion = 1;
+constexpr uint32_t kMmapShardMaxDims = 8;
+constexpr uint64_t kMmapShardDataOffset = 4096;
+
+// On-disk header of a shard file. A shard consists of this header followed by
+// `num_records` fixed-width records starting at `data_offset` (page-aligned,
+// so that the records can be mapped without touching the header page).
+// Each record is a contiguous array of `dtype` with shape `record_shape`.
+struct MmapShardHeader {
+  char magic[8]; // "HTSHARD"
+  uint32_t version;
+  int32_t dtype;
+  uint64_t num_records;
+  uint64_t data_offset;
+  uint32_t ndim;
+  uint32_t reserved;
+  int64_t record_shape[kMmapShardMaxDims];
+  uint8_t padding[24];
+};
+static_assert(sizeof(MmapShardHeader) == 128,
+              "MmapShardHeader must be 128 bytes");
+
+// A read-only memory mapping of one shard file.
+class MmapShard {
+ public:
+  MmapShard(const std::string& path, bool random_access);
+
+  ~MmapShard();
+
+  MmapShard(const MmapShard&) = delete;
+  MmapShard& operator=(const MmapShard&) = delete;
+
+  const MmapShardHeader& header() const {
+    return _header;
+  }
+
+  const std::string& path() const {
+    return _path;
+  }
+
+  uint64_t num_records() const {
+    return _header.num_records;
+  }
+
+  const uint8_t* records() const {
+    return _mapped + _header.data_offset;
+  }
+
+ private:
+  void _CheckHeader();
+
+  const std::string _path;
+  MmapShardHeader _header;
+  uint8_t* _mapped{nullptr};
+  size_t _mapped_size{0};
+};
+
+// A dataset of fixed-width records spread over one or more shard files, which
+// are memory-mapped so that the page cache rather than the process holds the
+// data. All shards must share the same dtype and record shape.
+class MmapDataset {
+ public:
+  MmapDataset(const std::vector<std::string>& paths, bool random_access);
+
+  uint64_t num_records() const {
+    return _offsets.back();
+  }
+
+  DataType dtype() const {
+    return _dtype;
+  }
+
+  const HTShape& record_shape() const {
+    return _record_shape;
+  }
+
+  size_t record_bytes() const {
+    return _record_bytes;
+  }
+
+  // Gathers the records at the given global indices into `dst`, which must
+  // hold at least `num_indices * record_bytes()` bytes. Runs of consecutive
+  // indices in the same shard are copied at once.
+  void CopyRecords(const uint64_t* indices, size_t num_indices,
+                   void* dst) const;
+
+  // Writes a shard file whose records are the slices of `data` along its
+  // first dimension.
+  static void WriteShard(const std::string& path, const NDArray& data);
+
+ private:
+  std::vector<std::unique_ptr<MmapShard>> _shards;
+  // _offsets[i] is the global index of the first record of the i-th shard
+  std::vector<uint64_t> _offsets;
+  DataType _dtype;
+  HTShape _record_shape;
+  size_t _record_bytes;
+};
+
+// Host buffers of a fixed size which batches are gathered into. Buffers are
+// page-locked when requested (and CUDA devices exist) so that the
+// host-to-device copies of the batches can run asynchronously. Buffers of
+// released batches are kept for reuse.
+class MmapStagingBufferPool
+: public std::enable_shared_from_this<MmapStagingBufferPool> {
+ public:
+  MmapStagingBufferPool(size_t buffer_bytes, size_t max_cached, bool pinned);
+
+  ~MmapStagingBufferPool();
+
+  // Returns a CPU array backed by a staging buffer. The buffer goes back to
+  // the pool once the storage of the array is freed.
+  NDArray Acquire(const NDArrayMeta& meta);
+
+  bool pinned() const {
+    return _pinned;
+  }
+
+ private:
+  void* _Alloc();
+
+  void _Free(void* ptr);
+
+  void _Release(void* ptr);
+
+  const size_t _buffer_bytes;
+  const size_t _max_cached;
+  bool _pinned;
+  std::mutex _mtx;
+  std::vector<void*> _cached;
+};
+
+// Loads the batches of the records [begin, end) of a dataset in the
+// background. Batches of upcoming epochs are scheduled as soon as the
+// current epoch has no more batches to schedule, so that at most `prefetch`
+// batches are in flight at any time. With `shuffle`, each epoch visits the
+// records in a permutation determined by `seed` and the epoch number.
+class MmapBatchPrefetcher {
+ public:
+  MmapBatchPrefetcher(std::shared_ptr<MmapDataset> dataset, uint64_t begin,
+                      uint64_t end, int batch_size, bool shuffle,
+                      bool drop_last, int num_workers, int prefetch,
+                      uint64_t seed, bool pin_memory);
+
+  ~MmapBatchPrefetcher();
+
+  // Returns the next batch of the current epoch, or an undefined array at
+  // the end of the epoch, after which the next epoch begins.
+  NDArray Next();
+
+  // Shape of the batch to be returned by the next call to `Next`.
+  HTShape next_shape() const;
+
+  int batch_num() const {
+    return _batch_num;
+  }
+
+  uint64_t num_records() const {
+    return _end - _begin;
+  }
+
+  uint64_t epoch() const {
+    return _cur_epoch;
+  }
+
+ private:
+  using Order = std::shared_ptr<const std::vector<uint64_t>>;
+
+  Order _GetOrder(uint64_t epoch);
+
+  int64_t _BatchRecords(int batch_idx) const;
+
+  void _Schedule();
+
+  std::shared_ptr<MmapDataset> _dataset;
+  const uint64_t _begin;
+  const uint64_t _end;
+  const int _batch_size;
+  const bool _shuffle;
+  const bool _drop_last;
+  const int _prefetch;
+  const uint64_t _seed;
+  int _batch_num;
+  std::shared_ptr<MmapStagingBufferPool> _buffers;
+
+  uint64_t _cur_epoch{0};
+  int _cur_batch{0};
+  uint64_t _sched_epoch{0};
+  int _sched_batch{0};
+  uint64_t _order_epoch{0};
+  Order _order;
+  std::deque<std::future<NDArray>> _pending;
+
+  // Declared last so that the workers are joined before the states above
+  // are destructed
+  std::unique_ptr<TaskQueue> _workers;
+};
+
+} // namespace graph
+} // namespace hetu
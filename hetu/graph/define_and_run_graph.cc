@@ -265,6 +265,44 @@ void DefineAndRunGraph::DeducePipeline(size_t cur_strategy_id, int32_t pipeline_
   CUR_STRATEGY_ID = old_strategy_id;
 }
 
+void DefineAndRunGraph::SetShapeBuckets(const Tensor& tensor, int64_t dim,
+                                        std::vector<int64_t> buckets, double pad_value) {
+  HT_VALUE_ERROR_IF(buckets.empty())
+    << "Shape buckets of " << tensor << " should not be empty";
+  std::sort(buckets.begin(), buckets.end());
+  HT_VALUE_ERROR_IF(buckets.front() <= 0)
+    << "Shape buckets should be positive, got " << buckets;
+  buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+  _shape_buckets[tensor->id()] = {dim, std::move(buckets), pad_value};
+}
+
+// 将feed dict中配置了bucket的NDArray在对应维度上pad到最小的能容纳下的bucket
+// 超过最大bucket的保持原样
+FeedDict DefineAndRunGraph::BucketFeedDict(const FeedDict& feed_dict) {
+  FeedDict bucketed_feed_dict = feed_dict;
+  for (auto& kv : bucketed_feed_dict) {
+    auto bucket_it = _shape_buckets.find(kv.first);
+    if (bucket_it == _shape_buckets.end())
+      continue;
+    const auto& shape_buckets = bucket_it->second;
+    for (auto& data : kv.second) {
+      int64_t dim = NDArrayMeta::ParseAxis(shape_buckets.dim, data->ndim());
+      int64_t size = data->shape(dim);
+      auto bucket = std::lower_bound(shape_buckets.buckets.begin(), shape_buckets.buckets.end(), size);
+      if (bucket == shape_buckets.buckets.end() || *bucket == size)
+        continue;
+      HTShape padded_shape = data->shape();
+      padded_shape[dim] = *bucket;
+      auto padded = NDArray::full(padded_shape, shape_buckets.pad_value, data->device(),
+                                  data->dtype(), kBlockingStream);
+      auto padded_view = NDArray::slice(padded, HTShape(data->ndim(), 0), data->shape(), kBlockingStream);
+      NDArray::copy(data, kBlockingStream, padded_view);
+      data = padded;
+    }
+  }
+  return bucketed_feed_dict;
+}
+
 // 推导define graph的shape plan
 // 以及exec graph的exec shape plan
 // 请注意二者的区别
@@ -673,9 +711,7 @@ void DefineAndRunGraph::Instantiate(OpRefList&& global_topo,
     if (autocast_id != UINT64_MAX) {
       auto autocast = AutoCast::GetAutoCast(autocast_id);
       if (autocast.enabled()) {
-        DataType datatype = DataType::UNDETERMINED;
-        if (autocast.cast_type() != DataType::UNDETERMINED)
-          datatype = autocast.cast_type();
+        DataType datatype = autocast.cast_type(local_device);
         if (datatype != DataType::UNDETERMINED) {
           auto optype = op->type();
           if (is_optimizer_update_op(op) || is_host_to_device_op(op) || is_device_to_host_op(op) || is_data_transfer_op(op)) {
@@ -910,7 +946,7 @@ void DefineAndRunGraph::Instantiate(OpRefList&& global_topo,
 // 目前一个exec graph支持多个shape plan
 // 即允许feed_dict的shape（包括batch_size以及seq_len等）可变
 NDArrayList DefineAndRunGraph::Run(const Tensor& loss, const TensorList& fetches,
-                                   const FeedDict& feed_dict, const int num_micro_batches,
+                                   const FeedDict& origin_feed_dict, const int num_micro_batches,
                                    const int cur_strategy_id, RunLevel run_level,
                                    bool save_checkpoint, const double grad_scale) {
   _run_level = run_level;
@@ -918,6 +954,13 @@ NDArrayList DefineAndRunGraph::Run(const Tensor& loss, const TensorList& fetches
   auto local_device = hetu::impl::comm::GetLocalDevice(); // only for debug use
   HT_LOG_DEBUG << local_device << ": [Graph Plan] obtain exec graph begin...";
 
+  // 将feed dict的shape pad到bucket上以限制shape plan的数目
+  FeedDict bucketed_feed_dict;
+  if (!_shape_buckets.empty()) {
+    bucketed_feed_dict = BucketFeedDict(origin_feed_dict);
+  }
+  const FeedDict& feed_dict = _shape_buckets.empty() ? origin_feed_dict : bucketed_feed_dict;
+
   // get feed dict shape
   Tensor2ShapeMapList feed_dict_shape_list(num_micro_batches);
   for (const auto& kv : feed_dict) {
@@ -940,33 +983,33 @@ NDArrayList DefineAndRunGraph::Run(const Tensor& loss, const TensorList& fetches
   size_t next_active_exec_plan;
   std::vector<size_t> next_active_shape_plan_list(num_micro_batches);
   int64_t micro_batch_idx = 0;
-  size_t exec_plan_pool_size = _exec_graph_plan_pool.size();
   bool in_exec_plan_pool = false;
-  for (size_t i = 0; i < exec_plan_pool_size; i++)  {
+  // 先在hash表中查找(strategy, fetches)对应的exec plan
+  PlanKey exec_plan_key{static_cast<int64_t>(cur_strategy_id)};
+  for (const auto& fetch : fetches) {
+    exec_plan_key.push_back(static_cast<int64_t>(fetch->id()));
+  }
+  std::sort(exec_plan_key.begin() + 1, exec_plan_key.end());
+  exec_plan_key.erase(std::unique(exec_plan_key.begin() + 1, exec_plan_key.end()), exec_plan_key.end());
+  auto exec_plan_it = _exec_plan_indices.find(exec_plan_key);
+  if (exec_plan_it != _exec_plan_indices.end()) {
+    in_exec_plan_pool = true;
+    next_active_exec_plan = exec_plan_it->second;
+  }
+  // 未命中时再逐个比较(例如fetches中有重复的tensor)
+  size_t exec_plan_pool_size = _exec_graph_plan_pool.size();
+  for (size_t i = 0; i < exec_plan_pool_size && !in_exec_plan_pool; i++)  {
     const auto& exec_graph_plan = _exec_graph_plan_pool[i];
     bool exec_plan_matched = true;
     // 先看strategy匹配不
     if (static_cast<size_t>(cur_strategy_id) != exec_graph_plan.strategy_id) {
-      exec_plan_matched = false;
+      continue;
     }
     // 再看fetch匹配不
     if (fetches.size() < exec_graph_plan.fetches.size()) {
-      exec_plan_matched = false;
+      continue;
     }
-    // HT_LOG_INFO << i << "\n" << fetches << "\n" << exec_graph_plan.fetches
-    // << " " << exec_graph_plan.global_topo.size();
     for (const auto& fetch : fetches) {
-      bool find_fetch = false;
-      for (auto it = exec_graph_plan.fetches.begin(); it != exec_graph_plan.fetches.end(); ++it) {
-        if ((*it)->id() == fetch->id()) {
-          find_fetch = true;
-          break;
-        }
-      }
-      if (find_fetch == false) {
-        exec_plan_matched = false;
-        break;
-      }
       if (std::find(exec_graph_plan.fetches.begin(), exec_graph_plan.fetches.end(), fetch) == exec_graph_plan.fetches.end()) {
         HT_LOG_TRACE << local_device << ": exec_graph_plan fetches are " << exec_graph_plan.fetches 
           << " and the mismatch fetch is " << fetch;
@@ -978,15 +1021,33 @@ NDArrayList DefineAndRunGraph::Run(const Tensor& loss, const TensorList& fetches
       HT_LOG_TRACE << local_device << ": plan matched";
       in_exec_plan_pool = true;
       next_active_exec_plan = i;
-      break;
     }
   }
 
+  // 当前micro batch的feed dict shape作为shape plan的key
+  auto get_shape_plan_key = [&](const Tensor2ShapeMap& feed_dict_shape) -> PlanKey {
+    std::vector<TensorId> feed_ids;
+    for (const auto& kv : feed_dict) {
+      if (kv.second.size() == 0) continue;
+      feed_ids.push_back(kv.first);
+    }
+    std::sort(feed_ids.begin(), feed_ids.end());
+    PlanKey key;
+    for (auto feed_id : feed_ids) {
+      const auto& shape = feed_dict_shape.at(feed_id);
+      key.push_back(static_cast<int64_t>(feed_id));
+      key.push_back(static_cast<int64_t>(shape.size()));
+      key.insert(key.end(), shape.begin(), shape.end());
+    }
+    return key;
+  };
+
   // 需要创建一个新的exec graph
   // 用当前feed dict的shape先初始化一套shape plan
   // 作为该exec graph的shape plan pool里的第一个
   if (!in_exec_plan_pool) {
     HT_LOG_DEBUG << local_device << ": [Graph Plan] add a new exec graph to the pool begin...";
+    TIK(instantiate);
     Tensor2ShapeMap shape_plan;
     // 后续会由feed_dict的shape在MakeOp时推导出所有的shape
     for (const auto& kv : feed_dict) {
@@ -1017,15 +1078,31 @@ NDArrayList DefineAndRunGraph::Run(const Tensor& loss, const TensorList& fetches
     next_active_exec_plan = _exec_graph_plan_pool.size() - 1;
     // 新的shape plan就是shape plan pool中的第一个
     next_active_shape_plan_list[micro_batch_idx] = 0;
+    new_plan.shape_plan_indices[get_shape_plan_key(feed_dict_shape_list[micro_batch_idx])] = 0;
     micro_batch_idx++; 
+    TOK(instantiate);
+    _plan_cache_stats.exec_plan_misses++;
+    _plan_cache_stats.compile_time_ms += COST_MICROSEC(instantiate) / 1000.0;
     HT_LOG_DEBUG << local_device << ": [Graph Plan] add a new shape plan and an exec graph to the pool end...";
-  } 
+  } else {
+    _plan_cache_stats.exec_plan_hits++;
+  }
+  _exec_plan_indices[exec_plan_key] = next_active_exec_plan;
   // 命中pool中已有的exec graph
   // 但可能feed dict不一样
   // 这种情况下我们不需要生成新的exec graph
   // 但需要推导新的shape plan
   for (auto idx = micro_batch_idx; idx < num_micro_batches; idx++) {
     auto& exec_graph_plan = _exec_graph_plan_pool[next_active_exec_plan];
+    auto shape_plan_key = get_shape_plan_key(feed_dict_shape_list[idx]);
+    auto shape_plan_it = exec_graph_plan.shape_plan_indices.find(shape_plan_key);
+    if (shape_plan_it != exec_graph_plan.shape_plan_indices.end()) {
+      next_active_shape_plan_list[idx] = shape_plan_it->second;
+      _plan_cache_stats.shape_plan_hits++;
+      HT_LOG_DEBUG << next_active_shape_plan_list[idx] << "-th shape plan is matched for micro batch " << idx;
+      continue;
+    }
+    // shape plan是由其他feed dict推导出来的, 只能逐个比较
     auto shape_plan_pool_size = exec_graph_plan.shape_plan_pool.size();
     bool in_shape_plan_pool = false;
     for (size_t i = 0; i < shape_plan_pool_size; i++) {
@@ -1053,6 +1130,7 @@ NDArrayList DefineAndRunGraph::Run(const Tensor& loss, const TensorList& fetches
       if (shape_plan_matched) {
         in_shape_plan_pool = true;
         next_active_shape_plan_list[idx] = i;
+        _plan_cache_stats.shape_plan_hits++;
         HT_LOG_DEBUG << next_active_shape_plan_list[idx] << "-th shape plan is matched for micro batch " << idx;
         break;
       }
@@ -1061,11 +1139,21 @@ NDArrayList DefineAndRunGraph::Run(const Tensor& loss, const TensorList& fetches
     // 需要推导新的shape plan
     if (!in_shape_plan_pool) {
       HT_LOG_DEBUG << "DeduceShapePlan needed for micro batch " << idx;
+      TIK(deduce_shape_plan);
       DeduceShapePlan(exec_graph_plan, feed_dict, feed_dict_shape_list[idx]);
+      TOK(deduce_shape_plan);
+      _plan_cache_stats.shape_plan_misses++;
+      _plan_cache_stats.compile_time_ms += COST_MICROSEC(deduce_shape_plan) / 1000.0;
       // 新的shape plan就是shape plan pool中的最后一个
       next_active_shape_plan_list[idx] = exec_graph_plan.shape_plan_pool.size() - 1;
     }
+    exec_graph_plan.shape_plan_indices[shape_plan_key] = next_active_shape_plan_list[idx];
   }
+  HT_LOG_DEBUG << local_device << ": [Graph Plan] exec plan hits = " << _plan_cache_stats.exec_plan_hits
+    << ", misses = " << _plan_cache_stats.exec_plan_misses
+    << "; shape plan hits = " << _plan_cache_stats.shape_plan_hits
+    << ", misses = " << _plan_cache_stats.shape_plan_misses
+    << "; compile time = " << _plan_cache_stats.compile_time_ms << " ms";
 
   // 需要切换exec graph
   if (save_checkpoint) // 存储param时不需要热切换
@@ -20,6 +20,38 @@ struct hash<std::pair<size_t, size_t>> {
 namespace hetu {
 namespace graph {
 
+// Keys of the plan caches: the strategy id followed by the sorted fetch ids
+// for exec plans, and (id, ndim, dims...) of each fed tensor sorted by id
+// for shape plans.
+using PlanKey = std::vector<int64_t>;
+
+struct PlanKeyHash {
+  std::size_t operator()(const PlanKey& key) const noexcept {
+    // Following boost::hash_combine
+    std::size_t seed = key.size();
+    for (auto value : key)
+      seed ^= std::hash<int64_t>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+  }
+};
+
+struct PlanCacheStats {
+  uint64_t exec_plan_hits{0};
+  uint64_t exec_plan_misses{0};
+  uint64_t shape_plan_hits{0};
+  uint64_t shape_plan_misses{0};
+  // time spent on instantiating exec graphs and deducing shape plans
+  double compile_time_ms{0};
+};
+
+// Fed arrays are padded with `pad_value` along `dim` up to the smallest
+// bucket that fits, which bounds the number of distinct shape plans.
+struct ShapeBuckets {
+  int64_t dim;
+  std::vector<int64_t> buckets;
+  double pad_value;
+};
+
 class ExecGraphPlan {
  public:
   std::shared_ptr<ExecutableGraph> exec_graph;
@@ -29,6 +61,7 @@ class ExecGraphPlan {
   OpRefList global_topo; // cache the global topo to accelerate ineferring new shape plan
   std::vector<Tensor2ShapeMap> shape_plan_pool; // single exec graph with multi shape plan
   TensorList fetches; // most likey useless
+  std::unordered_map<PlanKey, size_t, PlanKeyHash> shape_plan_indices; // feed dict shapes to shape plan
 
   // forbid copy constructor to avoid high cost
   /*
@@ -107,12 +140,40 @@ class DefineAndRunGraph : public Graph {
 
   void MergeGraph(DefineAndRunGraph& another_graph);
 
+  void SetShapeBuckets(const Tensor& tensor, int64_t dim,
+                       std::vector<int64_t> buckets, double pad_value = 0);
+
+  void ClearShapeBuckets() {
+    _shape_buckets.clear();
+  }
+
+  const PlanCacheStats& plan_cache_stats() const {
+    return _plan_cache_stats;
+  }
+
+  // events elided by the last run of the active exec graph
+  uint64_t num_elided_events() const {
+    if (!_is_active)
+      return 0;
+    return _exec_graph_plan_pool[_active_exec_plan].exec_graph->NumElidedEvents();
+  }
+
+  // memory plan of the last run of the active exec graph, empty unless
+  // HETU_MEMORY_PLAN is ON
+  MemoryPlanStats memory_plan_stats() const {
+    if (!_is_active)
+      return {};
+    return _exec_graph_plan_pool[_active_exec_plan].exec_graph->GetMemoryPlanStats();
+  }
+
  protected:
   Operator& MakeOpInner(std::shared_ptr<OpInterface> body, TensorList inputs,
                         OpMeta op_meta);
 
   void DeducePipeline(size_t cur_strategy_id, int32_t pipeline_num);
 
+  FeedDict BucketFeedDict(const FeedDict& feed_dict);
+
   void DeduceShapePlan(ExecGraphPlan& exec_graph_plan,
                        const FeedDict& feed_dict,
                        Tensor2ShapeMap& feed_dict_shape);
@@ -147,6 +208,9 @@ class DefineAndRunGraph : public Graph {
     _param_switcher_pool.clear();
     _grad_switcher_pool.clear();
     _exec_graph_plan_pool.clear();
+    _exec_plan_indices.clear();
+    _shape_buckets.clear();
+    _plan_cache_stats = PlanCacheStats();
     Graph::Clear();
   }
   
@@ -177,6 +241,10 @@ class DefineAndRunGraph : public Graph {
   // std::vector<Tensor2ShapeMap> _shape_plan_pool; 
   size_t _active_exec_plan;
   bool _is_active = false;
+  // (strategy, fetches) to exec plan
+  std::unordered_map<PlanKey, size_t, PlanKeyHash> _exec_plan_indices;
+  std::unordered_map<TensorId, ShapeBuckets> _shape_buckets;
+  PlanCacheStats _plan_cache_stats;
 
   // 如果判断不需要进行grad的热切换
   // 此值为true时仍会进行grad热切换的topo计算
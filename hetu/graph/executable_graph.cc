@@ -4,6 +4,7 @@
 #include "hetu/graph/autocast/autocast.h"
 #include "hetu/graph/recompute/recompute.h"
 #include "hetu/graph/offload/activation_cpu_offload.h"
+#include "hetu/graph/memory/memory_planner.h"
 #include "hetu/impl/communication/comm_group.h"
 #include "hetu/impl/communication/nccl_comm_group.h"
 #include "hetu/impl/profiler/profiler.h"
@@ -494,307 +495,146 @@ void ExecutableGraph::AllocRuntimeBuffer(std::vector<RuntimeContext>& runtime_ct
   }
 }
 
-void ExecutableGraph::AllocMemory(size_t& memory_size, MemoryPlan& memory_plan,
-                                  MemoryBlockList& temporary_free_memory, MemoryBlockList& free_memory, MicroBatchTensorId tensor_id,
-                                  size_t alloc_memory_size) {
-  // Best Fit strategy
-  sort(temporary_free_memory.begin(), temporary_free_memory.end(),
-       [&](MemoryBlock a, MemoryBlock b) { return a.second < b.second; });
-
-  // 找temp free memory中最小的能容纳下的块
-  // 并进行split
-  for (auto block_iter = temporary_free_memory.begin(); block_iter != temporary_free_memory.end(); block_iter++) {
-    auto block_size = block_iter->second;
-    if (block_size >= alloc_memory_size) {
-      auto block_ptr = block_iter->first;
-      temporary_free_memory.erase(block_iter);
-      memory_plan[tensor_id] = {block_ptr, alloc_memory_size};
-      auto remain_size = block_size - alloc_memory_size;
-      if (remain_size > 0) {
-        temporary_free_memory.push_back({block_ptr + alloc_memory_size, remain_size});
-      }
-      return;
-    }
-  }
-
-  sort(free_memory.begin(), free_memory.end(),
-       [&](MemoryBlock a, MemoryBlock b) { return a.second < b.second; });
-
-  // 同上
-  // free memory更珍贵
-  for (auto block_iter = free_memory.begin(); block_iter != free_memory.end(); block_iter++) {
-    auto block_size = block_iter->second;
-    if (block_size >= alloc_memory_size) {
-      auto block_ptr = block_iter->first;
-      free_memory.erase(block_iter);
-      memory_plan[tensor_id] = {block_ptr, alloc_memory_size};
-      auto remain_size = block_size - alloc_memory_size;
-      if (remain_size > 0) {
-        free_memory.push_back({block_ptr + alloc_memory_size, remain_size});
-      }
-      return;
-    }
-  }
-
-  memory_plan[tensor_id] = {memory_size, alloc_memory_size};
-  memory_size += alloc_memory_size;
-}
-
-
-
-void ExecutableGraph::FreeMemory(MemoryPlan& memory_plan, MemoryBlockList& free_memory,
-                                 MicroBatchTensorId tensor_id) {
-  // free memory space and merge with adjacent free blocks
-  auto free_block_ptr = memory_plan[tensor_id].first;
-  auto free_block_size = memory_plan[tensor_id].second;
-  for (auto i = 0; i < free_memory.size(); i++) {
-    auto block_head = free_memory[i].first;
-    auto block_tail = block_head + free_memory[i].second;
-    if (block_tail == free_block_ptr) {
-      free_block_ptr = block_head;
-      free_block_size += free_memory[i].second;
-      free_memory.erase(free_memory.begin() + i);
-      i--;
-    } else if (free_block_ptr + free_block_size == block_head) {
-      free_block_size += free_memory[i].second;
-      free_memory.erase(free_memory.begin() + i);
-      i--;
-    }
+// 根据topo order和micro batch的schedule计算每个tensor的live range,
+// 再交给MemoryPlanner离线地分配offset, 不依赖于特定的block结构
+MemoryPlan ExecutableGraph::GenerateMemoryPlan(size_t& memory_size,
+                                               const std::vector<std::pair<int32_t, size_t>>& tasks,
+                                               const TensorList& fetches) {
+  const TensorIdSet& dtype_transfer_tensor = _execute_plan.dtype_transfer_tensor;
+  const TensorIdSet& shared_weight_tensor = _execute_plan.shared_weight_tensor;
+  const OpIdSet& shared_weight_p2p = _execute_plan.shared_weight_p2p;
+  const OpIdSet& accumulated_ops = _execute_plan.accumulated_ops;
+  TensorIdSet fetch_ids;
+  for (auto& fetch : fetches) {
+    fetch_ids.insert(fetch->id());
   }
-  free_memory.push_back({free_block_ptr, free_block_size});
-}
 
-
-
-MemoryPlan ExecutableGraph::GenerateMemoryPlan(size_t& memory_size, std::vector<std::pair<bool, size_t>> tasks,
-                                               std::vector<Tensor2IntMap> tensor2degrees_list,    
-                                               const FeedDict& feed_dict){
-  memory_size = 0;
-  MemoryPlan memory_plan;
-  MemoryBlockList temporary_free_memory[HT_NUM_STREAMS_PER_DEVICE];
-  MemoryBlockList free_memory;
-  std::map<MemoryBlock, int> storage_use_count;
-
-  auto& subgraphs = GetAllSubGraphs();
-  std::vector<OpList> block_ops;
-  std::vector<std::string> block_name = {"GPTBlock", "LLamaBlock"};
-  for (auto [name, subgraph] : subgraphs) {
-    std::function<OpList(std::shared_ptr<SubGraph>)> get_all_ops = [&](std::shared_ptr<SubGraph> subgraph){
-      OpList ops;
-      for (auto [name, op] : subgraph->ops()) 
-        ops.push_back(op);  
-      for (auto [name, child] : subgraph->subgraphs()) {
-        auto child_ops = get_all_ops(child);
-        for (auto op : child_ops) 
-          ops.push_back(op);
-      }
-      return ops;
-    };
-    for (auto bname : block_name) {
-      if (subgraph->subgraph_type() == bname) {
-        block_ops.push_back(get_all_ops(subgraph));
-      }
-    }
-  }
-  if (block_ops.size() <= 0) {
-    HT_LOG_WARN << "The topology graph only supports segmentation using GPTBlock or LLamaBlock as the block, but find none of them. If you define other types of block, please add the class name to the list above.";
-  }
-  std::set<OpId> fw_block_start_op, fw_block_end_op;
-  for (auto ops : block_ops) {
-    std::vector<int> in_degree(ops.size(), 0), out_degree(ops.size(), 0);
-    for (int i = 0; i < ops.size(); i++) {
-      for (auto& output : ops[i]->outputs()) {
-        for (auto consumer : output->consumers()) {
-          for (int j = 0; j < ops.size(); j++) {
-            if (consumer.get()->graph_id() == ops[j]->graph_id() && consumer.get()->id() == ops[j]->id()) {
-              in_degree[j]++;
-              out_degree[i]++;
-            }
-          }
-        }
-      }
-    }
-    int start_op_cnt = 0, end_op_cnt = 0;
-    for (int i = 0; i < ops.size(); i++) {
-      // workaround: comm op还会出现在subgraph中而被当成是block start/end op
-      // 后续应该将comm op单独处理成bridge subgraph中（python端定义会用户不友好）
-      if (is_comm_op(ops[i])) {
-        HT_RUNTIME_ERROR << "subgraphs should not consists of comm op";
-      }
-      if (in_degree[i] == 0) {
-        start_op_cnt++;
-        fw_block_start_op.insert(ops[i]->id());
-        HT_LOG_DEBUG << ops[i] << " is a block start op, the inputs are " << ops[i]->inputs();
-      }
-      if (out_degree[i] == 0) {
-        end_op_cnt++;
-        fw_block_end_op.insert(ops[i]->id());
-        HT_LOG_DEBUG << ops[i] << " is a block end op, the inputs are " << ops[i]->inputs();
-      }
-    }
-    HT_ASSERT(start_op_cnt == 1 && end_op_cnt == 1) 
-      << "Each block only has a start operator and an end operator.";
-  }
+  MemoryPlanner planner;
+  // 每个tensor对应的buffer, view或inplace的输出和输入共享同一个buffer
+  std::map<MicroBatchTensorId, size_t> tensor2buffer;
+  std::vector<MicroBatchTensorId> buffer_owners;
+  std::vector<size_t> persistent_buffers;
+  std::vector<int64_t> task_ends;
+  int64_t step = 0;
 
   for (size_t i = 0; i < tasks.size(); i++) {
     auto& task = tasks[i];
-    bool is_forward = task.first;
-    size_t& micro_batch_id = task.second;
-    auto& tensor2degrees = tensor2degrees_list[micro_batch_id];
+    // bubble
+    if (task.first == -1) {
+      continue;
+    }
+    bool is_forward = (task.first == 0);
+    size_t micro_batch_id = task.second;
     bool grad_accumulation_finished = ((i == tasks.size() - 1) && is_forward == false);
-    OpRefList &topo = is_forward ? _execute_plan.local_fw_topo : _execute_plan.local_bw_topo;
-    const TensorIdSet& dtype_transfer_tensor = _execute_plan.dtype_transfer_tensor;
-    const TensorIdSet& shared_weight_tensor = _execute_plan.shared_weight_tensor;
-    const OpIdSet& shared_weight_p2p = _execute_plan.shared_weight_p2p;
-    const OpIdSet& shared_weight_grad_p2p = _execute_plan.shared_weight_grad_p2p;
-    const TensorIdSet& accumulated_tensor = _execute_plan.accumulated_tensor;
-    const OpIdSet& accumulated_ops = _execute_plan.accumulated_ops;
-
-    OpRefList executable_topo;
+    const OpRefList& topo = is_forward ? _execute_plan.local_fw_topo : _execute_plan.local_bw_topo;
+    SetShapePlan(_active_shape_plan_list[micro_batch_id]);
+    // 跨stream或者pipeline p2p使用的buffer无法确定何时真正用完
+    // 只能等到当前task结束之后再复用
+    std::vector<size_t> deferred_buffers;
+
+    auto find_buffer = [&](const Tensor& tensor) -> int64_t {
+      auto it = tensor2buffer.find({micro_batch_id, tensor->id()});
+      // micro batch i>0复用micro batch 0的shared weight和dtype transfer结果
+      if (it == tensor2buffer.end() && micro_batch_id > 0 &&
+          (shared_weight_tensor.find(tensor->id()) != shared_weight_tensor.end() ||
+           dtype_transfer_tensor.find(tensor->id()) != dtype_transfer_tensor.end())) {
+        it = tensor2buffer.find({0, tensor->id()});
+      }
+      return it == tensor2buffer.end() ? -1 : static_cast<int64_t>(it->second);
+    };
+
     for (auto& op_ref : topo) {
       auto& op = op_ref.get();
-      bool computed = Operator::all_output_tensors_of(op, [&](Tensor& tensor) {
-        return feed_dict.find(tensor->id()) != feed_dict.end();
-      });
-      if (computed ||
-          op->num_outputs() > 0 && dtype_transfer_tensor.find(op->output(0)->id()) != dtype_transfer_tensor.end() && micro_batch_id > 0 ||
-          !shared_weight_p2p.empty() && shared_weight_p2p.find(op->id()) != shared_weight_p2p.end() && micro_batch_id > 0 || 
-          !grad_accumulation_finished && accumulated_ops.find(op->id()) != accumulated_ops.end()) {
+      // 被feed的tensor都是placeholder的输出, 下面不会为其分配buffer
+      if (op->num_outputs() > 0 && dtype_transfer_tensor.find(op->output(0)->id()) != dtype_transfer_tensor.end() && micro_batch_id > 0 ||
+          !shared_weight_p2p.empty() && shared_weight_p2p.find(op->id()) != shared_weight_p2p.end() && micro_batch_id > 0) {
         continue;
       }
-      executable_topo.push_back(op_ref);
-    }
+      int64_t cur_step = step++;
 
-    std::vector<MicroBatchTensorId> release_tensor;
-    for (auto& op_ref : executable_topo) {
-      auto& op = op_ref.get();
-      auto clear_tensor_and_merge_space = [&](){
-        for (auto& micro_tensor_id : release_tensor) {
-          FreeMemory(memory_plan, free_memory, micro_tensor_id);
-          storage_use_count[memory_plan[micro_tensor_id]] = 0;
-          storage_use_count.erase(memory_plan[micro_tensor_id]);
+      for (auto& input : op->inputs()) {
+        auto buffer = find_buffer(input);
+        if (buffer < 0) {
+          continue;
         }
-        release_tensor.clear();
-        // 将所有stream上的temp free memory全部放回到free memory
-        for (auto stream_id = 0; stream_id < HT_NUM_STREAMS_PER_DEVICE; stream_id++) {
-          for (auto& space : temporary_free_memory[stream_id]) {
-            auto free_block_ptr = space.first;
-            auto free_block_size = space.second;
-            for (auto i = 0; i < free_memory.size(); i++) {
-              auto block_head = free_memory[i].first;
-              auto block_tail = block_head + free_memory[i].second;
-              if (block_tail == free_block_ptr) {
-                free_block_ptr = block_head;
-                free_block_size += free_memory[i].second;
-                free_memory.erase(free_memory.begin() + i);
-                i--;
-              } else if (free_block_ptr + free_block_size == block_head) {
-                free_block_size += free_memory[i].second;
-                free_memory.erase(free_memory.begin() + i);
-                i--;
-              }
-            }
-            free_memory.push_back({free_block_ptr, free_block_size});
-          }
-          temporary_free_memory[stream_id].clear();
+        planner.ExtendBuffer(buffer, cur_step, cur_step);
+        if (input->producer()->stream_index() != op->stream_index() ||
+            is_pipeline_stage_recv_op(input->producer()) || is_pipeline_stage_send_op(op)) {
+          deferred_buffers.push_back(buffer);
         }
-      };
+      }
 
-      // fw block的开头和bw block的结尾
-      // 全部进行清空
-      if (is_forward && fw_block_start_op.find(op->id()) != fw_block_start_op.end() || !is_forward && fw_block_end_op.find(op->fw_op_id()) != fw_block_end_op.end()) {
-        clear_tensor_and_merge_space();
+      // 梯度累积的op此时只读取输入
+      if (!grad_accumulation_finished && accumulated_ops.find(op->id()) != accumulated_ops.end()) {
+        continue;
       }
-      if (is_optimizer_update_op(op) || is_data_transfer_op(op)) {
+      if (is_placeholder_op(op) || is_variable_op(op) ||
+          is_optimizer_update_op(op) || is_data_transfer_op(op)) {
         continue;
       }
-      // TODO: maybe too heuristic
-      // 可以reuse的会累积storage_use_count
+      // 输出复用输入的storage
       if (op->type() == "TransposeOp"|| is_slice_op(op) ||
           (op->type() == "ArrayReshapeOp" || op->type() == "ArrayReshapeGradientOp") && op->inputs().at(0)->is_contiguous() || 
           is_inplace_op(op) || is_all_reduce_op(op) || is_reduce_scatter_op(op)) {
-        auto input_id = op->inputs().at(0)->id();
-        auto output_id = op->outputs().at(0)->id();
-        if (memory_plan.find({micro_batch_id, input_id}) != memory_plan.end()
-            && storage_use_count.find(memory_plan[{micro_batch_id, input_id}]) != storage_use_count.end()
-            && storage_use_count[memory_plan[{micro_batch_id, input_id}]] > 0) {
-          memory_plan[{micro_batch_id, output_id}] = memory_plan[{micro_batch_id, input_id}];
-          storage_use_count[memory_plan[{micro_batch_id, input_id}]] += tensor2degrees[output_id];
-        }
-      } 
-      // 其余情况需要分配
-      else {
-        for (auto& output : op->outputs()) {
-          auto tensor_id = output->id();
-          int64_t numElem = output->numel();
-          numElem = DIVUP(numElem * DataType2Size(output->dtype()), 256) * 256 / DataType2Size(kInt64);
-          AllocMemory(memory_size, memory_plan, temporary_free_memory[op->stream_index()], free_memory, {micro_batch_id, tensor_id}, numElem);
-          storage_use_count[memory_plan[{micro_batch_id, tensor_id}]] = tensor2degrees[tensor_id];
-        }
-      }
-
-      for (size_t i = 0; i < op->num_outputs(); i++) {
-        auto tensor_id = op->output(i)->id();
-        if (memory_plan.find({micro_batch_id, tensor_id}) == memory_plan.end()) {
-          // HT_LOG_WARN << op << " output: micro batch " << micro_batch_id << " tensor " << op->output(i) << " is not in memory_plan";
-          continue;
-        }
-        if (storage_use_count.find(memory_plan[{micro_batch_id, tensor_id}]) == storage_use_count.end()) {
-          // HT_LOG_WARN << op << " output: micro batch " << micro_batch_id << " tensor " << op->output(i) << " is not in storage_use_count";
-          continue;
-        }
-        if (accumulated_tensor.find(tensor_id) != accumulated_tensor.end() 
-            || storage_use_count[memory_plan[{micro_batch_id, tensor_id}]] == 0) {
-          FreeMemory(memory_plan, temporary_free_memory[op->stream_index()], {micro_batch_id, tensor_id});
-          storage_use_count[memory_plan[{ micro_batch_id, tensor_id}]] = 0;
-          storage_use_count.erase(memory_plan[{ micro_batch_id, tensor_id}]);
-          // if (op->placement().index() == 0) std::cout << "tensor " << tensor_id << ' ' << "free" << ' ' << memory_plan[{micro_batch_id, tensor_id}].first << ' ' << memory_plan[{micro_batch_id, tensor_id}].second << std::endl;
-        }
-      }
-
-      for (const auto& input : op->inputs()) {
-        auto used_by_multi_stream = [&](const Tensor& tensor) {
-          for (auto &consumer_ref : tensor->consumers()) {
-            auto& consumer = consumer_ref.get();
-            if (consumer->stream_index() != tensor->producer()->stream_index()) {
-              return true;
-            }
-          }
-          return false;
-        };
-        if (memory_plan.find({micro_batch_id, input->id()}) == memory_plan.end()) {
-          // HT_LOG_WARN << op << " input: micro batch " << micro_batch_id << " tensor " << input << " is not in memory_plan";
-          continue;
-        }
-        if (storage_use_count.find(memory_plan[{micro_batch_id, input->id()}]) == storage_use_count.end()) {
-          // HT_LOG_WARN << op << " input: micro batch " << micro_batch_id << " tensor " << input << " is not in storage_use_count";
-          continue;
-        }
-        if (accumulated_tensor.find(input->id()) != accumulated_tensor.end()) {
-          continue;
-        }
-        if (--storage_use_count[memory_plan[{micro_batch_id, input->id()}]] == 0
-            && !is_pipeline_stage_recv_op(input->producer()) && !is_pipeline_stage_send_op(op)) {
-          if (used_by_multi_stream(input) == false) {
-            FreeMemory(memory_plan, temporary_free_memory[op->stream_index()], {micro_batch_id, input->id()});
-            storage_use_count[memory_plan[{micro_batch_id, input->id()}]] = 0;
-            storage_use_count.erase(memory_plan[{micro_batch_id, input->id()}]);
-            // if (op->placement().index() == 0) std::cout << "tensor " << input->id() << ' ' << "free" << ' ' << memory_plan[{micro_batch_id, input->id()}].first << ' ' << memory_plan[{micro_batch_id, input->id()}].second << std::endl;
-          }
-          // multi-stream的memory plan暂时无法处理
-          // 只能是下一个block再去全部free
-          else {
-            release_tensor.push_back({micro_batch_id, input->id()});
+        auto buffer = find_buffer(op->input(0));
+        if (buffer >= 0) {
+          tensor2buffer[{micro_batch_id, op->output(0)->id()}] = buffer;
+          if (fetch_ids.find(op->output(0)->id()) != fetch_ids.end()) {
+            persistent_buffers.push_back(buffer);
           }
         }
+        continue;
       }
-      // fw block的结尾或者bw block的开头
-      // 再次清空
-      if (is_forward && fw_block_end_op.find(op->id()) != fw_block_end_op.end() || !is_forward && fw_block_start_op.find(op->fw_op_id()) != fw_block_start_op.end()) {
-        clear_tensor_and_merge_space();
+      for (auto& output : op->outputs()) {
+        size_t size = DIVUP(NumEl(GetTensorShape(output)) * DataType2Size(output->dtype()), 256) * 256 / DataType2Size(kInt64);
+        auto buffer = planner.AddBuffer(size, cur_step, cur_step, cur_step, op->stream_index());
+        tensor2buffer[{micro_batch_id, output->id()}] = buffer;
+        buffer_owners.push_back({micro_batch_id, output->id()});
+        // fetch的结果在所有micro batch结束后才拼接
+        if (fetch_ids.find(output->id()) != fetch_ids.end() ||
+            shared_weight_tensor.find(output->id()) != shared_weight_tensor.end() ||
+            dtype_transfer_tensor.find(output->id()) != dtype_transfer_tensor.end()) {
+          persistent_buffers.push_back(buffer);
+        }
       }
     }
+    for (auto buffer : deferred_buffers) {
+      planner.ExtendBuffer(buffer, step - 1, step - 1);
+    }
+    task_ends.push_back(step - 1);
   }
+
+  memory_size = 0;
+  _memory_plan_stats = MemoryPlanStats();
+  MemoryPlan memory_plan;
+  if (step == 0) {
+    return memory_plan;
+  }
+  for (auto buffer : persistent_buffers) {
+    planner.ExtendBuffer(buffer, step - 1, step - 1);
+  }
+  // 其他stream只有在当前task结束之后才能复用
+  for (size_t buffer = 0; buffer < planner.num_buffers(); buffer++) {
+    auto end = planner.range(buffer).end;
+    auto task_end = *std::lower_bound(task_ends.begin(), task_ends.end(), end);
+    planner.ExtendBuffer(buffer, end, task_end);
+  }
+  planner.Plan();
+  for (size_t buffer = 0; buffer < planner.num_buffers(); buffer++) {
+    memory_plan[buffer_owners[buffer]] = {planner.offset(buffer), planner.range(buffer).size};
+  }
+  memory_size = planner.peak_size();
+  _memory_plan_stats.num_tensors = planner.num_buffers();
+  _memory_plan_stats.peak_size = planner.peak_size() * DataType2Size(kInt64);
+  _memory_plan_stats.live_size = planner.live_size() * DataType2Size(kInt64);
+  _memory_plan_stats.total_size = planner.total_size() * DataType2Size(kInt64);
+  auto to_mib = [](size_t size) {
+    return size * DataType2Size(kInt64) * 1.0 / (1024 * 1024);
+  };
+  HT_LOG_INFO << hetu::impl::comm::GetLocalDevice() << ": memory plan of "
+    << planner.num_buffers() << " tensors, planned peak = " << to_mib(planner.peak_size())
+    << " MiB, live peak = " << to_mib(planner.live_size())
+    << " MiB, sum of tensor sizes = " << to_mib(planner.total_size()) << " MiB";
   return memory_plan;
 }
 
@@ -1781,6 +1621,85 @@ void ExecutableGraph::GetExecEnvs() {
     // 默认不对parallel attn打log
     _parallel_attn_log_file_path = "";
   }
+
+  env = std::getenv("HETU_MEMORY_PLAN");
+  if (env != nullptr) {
+    if (std::string(env) == "ON") {
+      _use_memory_plan = true;
+    } else if (std::string(env) == "OFF") {
+      _use_memory_plan = false;
+    } else {
+      HT_RUNTIME_ERROR << "Unknown hetu memory plan setting: " + std::string(env);
+    }
+  } else {
+    // 默认由allocator动态分配
+    _use_memory_plan = false;
+  }
+
+  env = std::getenv("HETU_EVENT_ELISION");
+  if (env != nullptr) {
+    if (std::string(env) == "ON") {
+      _event_elision = true;
+    } else if (std::string(env) == "OFF") {
+      _event_elision = false;
+    } else {
+      HT_RUNTIME_ERROR << "Unknown hetu event elision setting: " + std::string(env);
+    }
+  } else {
+    // 默认省去不必要的event
+    _event_elision = true;
+  }
+}
+
+// 同一个stream上的op天然有序, 只有以下情况需要stop event:
+// 1. 同一device上不同stream的consumer需要block在该event上(见BlockOrSyncInput)
+// 2. op的输出被fetch, 需要在run结束时sync
+// 3. 通信算子, 其event可能被其他逻辑使用
+// start event只在profile计时的时候需要
+void ExecutableGraph::PlanEventRecords(const TensorList& fetches, bool timing) {
+  OpIdSet stop_event_ops;
+  for (auto& fetch : fetches) {
+    stop_event_ops.insert(fetch->producer()->id());
+  }
+  auto mark_cross_stream_input = [&](const Operator& op, const Tensor& input) {
+    if (!input.is_defined())
+      return;
+    const auto& input_ctx = input->producer()->instantiation_ctx();
+    const auto& op_ctx = op->instantiation_ctx();
+    if (!input_ctx.placement.is_undetermined() &&
+        input_ctx.placement == op_ctx.placement &&
+        input_ctx.stream_index != op_ctx.stream_index) {
+      stop_event_ops.insert(input->producer()->id());
+    }
+  };
+  for (auto& op_ref : _execute_plan.local_topo) {
+    auto& op = op_ref.get();
+    for (auto& input : op->inputs()) {
+      mark_cross_stream_input(op, input);
+    }
+    for (auto& in_dep : op->in_dep_linkers()) {
+      mark_cross_stream_input(op, in_dep);
+    }
+  }
+  for (auto& op_ref : _execute_plan.local_topo) {
+    auto& op = op_ref.get();
+    auto& inst_ctx = op->instantiation_ctx();
+    bool keep_all = !_event_elision || timing || is_communication_op(op) ||
+                    is_peer_to_peer_send_op(op) || is_peer_to_peer_recv_op(op) ||
+                    is_batched_isend_irecv_op(op);
+    inst_ctx.record_start_events = keep_all;
+    inst_ctx.record_stop_events =
+      keep_all || stop_event_ops.find(op->id()) != stop_event_ops.end();
+    inst_ctx.num_elided_events = 0;
+  }
+}
+
+uint64_t ExecutableGraph::CollectElidedEvents() {
+  uint64_t num_elided_events = 0;
+  for (auto& op_ref : _execute_plan.local_topo) {
+    num_elided_events += op_ref.get()->instantiation_ctx().num_elided_events;
+  }
+  return num_elided_events;
 }
 
 // 每次run都会经过的核心部分
@@ -1900,37 +1819,39 @@ NDArrayList ExecutableGraph::CrucialRun(const TensorList& fetches,
   }
   // ********************** Run Level Check Point **********************
 
-  /*
-  HT_LOG_DEBUG << local_device << ": 2-plus. memory plan[begin]";
+  // 预先为所有micro batch的中间结果规划一整块内存
   // TODO: cache memory plan
   size_t memory_size = 0;
-  auto memory_plan = GenerateMemoryPlan(memory_size, tasks, tensor2degrees_list, feed_dict);
-  auto memory_space = NDArray::empty({memory_size}, local_device, kInt64, kComputingStream);
-  HT_LOG_DEBUG << "Memory plan is generated and allocated";
-  if (_memory_profile_level == MEMORY_PROFILE_LEVEL::INFO)
-    GetCUDAProfiler(local_device)->PrintCurrMemoryInfo(name() + " alloc memory according to plan end");
-  for (auto& op_ref : _execute_plan.local_topo) {
-    auto& op = op_ref.get();
-    for (auto& tensor : op->outputs()) {
-      for (size_t micro_batch_id = 0; micro_batch_id < num_micro_batches; micro_batch_id++) {
-        auto it = memory_plan.find({micro_batch_id, tensor->id()});
-        if (it == memory_plan.end()) {
-          break;
+  NDArray memory_space;
+  if (_use_memory_plan) {
+    HT_LOG_DEBUG << local_device << ": 2-plus. memory plan[begin]";
+    auto memory_plan = GenerateMemoryPlan(memory_size, tasks, fetches);
+    memory_space = NDArray::empty({static_cast<int64_t>(memory_size)}, local_device, kInt64, kComputingStream);
+    if (_memory_profile_level == MEMORY_PROFILE_LEVEL::INFO)
+      GetCUDAProfiler(local_device)->PrintCurrMemoryInfo(name() + " alloc memory according to plan end");
+    for (auto& op_ref : _execute_plan.local_topo) {
+      auto& op = op_ref.get();
+      for (auto& tensor : op->outputs()) {
+        for (size_t micro_batch_id = 0; micro_batch_id < num_micro_batches; micro_batch_id++) {
+          auto it = memory_plan.find({micro_batch_id, tensor->id()});
+          if (it == memory_plan.end()) {
+            continue;
+          }
+          SetShapePlan(_active_shape_plan_list[micro_batch_id]);
+          auto begin_pos = it->second.first;
+          auto block_size = it->second.second;
+          auto raw_memory = NDArray::slice(memory_space, {static_cast<int64_t>(begin_pos)}, {static_cast<int64_t>(block_size)});
+          auto memory = NDArray(NDArrayMeta()
+                                .set_shape(GetTensorShape(tensor))
+                                .set_dtype(tensor->dtype())
+                                .set_device(tensor->producer()->instantiation_ctx().placement), 
+                                raw_memory->storage(), raw_memory->storage_offset() * DataType2Size(kInt64) / DataType2Size(tensor->dtype()));
+          runtime_ctx_list.at(micro_batch_id).add_runtime_allocation(tensor->id(), memory);
         }
-        auto begin_pos = it->second.first;
-        auto block_size = it->second.second;
-        auto raw_memory = NDArray::slice(memory_space, {begin_pos}, {block_size});
-        auto memory = NDArray(NDArrayMeta()
-                              .set_shape(GetTensorShape(tensor))
-                              .set_dtype(tensor->dtype())
-                              .set_device(tensor->producer()->instantiation_ctx().placement), 
-                              raw_memory->storage(), raw_memory->storage_offset() * DataType2Size(kInt64) / DataType2Size(tensor->dtype()));
-        runtime_ctx_list.at(micro_batch_id).add_runtime_allocation(tensor->id(), memory);
       }
     }
+    HT_LOG_DEBUG << local_device << ": 2-plus. memory plan[end]";
   }
-  HT_LOG_DEBUG << local_device << ": 2-plus. memory plan[end]";
-  */
   
   HT_LOG_DEBUG << local_device << ": 3. compute[begin]";
   bool is_continuous_p2p = false;
@@ -2712,11 +2633,12 @@ NDArrayList ExecutableGraph::Run(const Tensor& loss, const TensorList& fetches,
   HT_LOG_INFO << local_device << ": free mempool time = " << COST_MSEC(free_mempool) << " ms";
   */
 
+  auto profiler_optional = hetu::impl::Profile::get_cur_profile();
+  bool is_analysis_perf = false;
+  PlanEventRecords(fetches, is_analysis_perf || _straggler_flag || profiler_optional);
   TIK(crucial_run);
   // ****核心的exec graph执行部分****
   auto results = CrucialRun(fetches, feed_dict, num_micro_batches);
-  auto profiler_optional = hetu::impl::Profile::get_cur_profile();
-  bool is_analysis_perf = false;
   if (is_analysis_perf || _straggler_flag || profiler_optional) {
     if (_used_ranks.size() >= 2) {
       auto& comm_group = hetu::impl::comm::NCCLCommunicationGroup::GetOrCreate(_used_ranks, local_device);
@@ -2725,6 +2647,8 @@ NDArrayList ExecutableGraph::Run(const Tensor& loss, const TensorList& fetches,
   }
   TOK(crucial_run);
   HT_LOG_DEBUG << local_device << ": crucial run time = " << COST_MSEC(crucial_run) << " ms";
+  _num_elided_events = CollectElidedEvents();
+  HT_LOG_DEBUG << local_device << ": elided " << _num_elided_events << " events";
   
   // get all micro batches memory consumption
   if (_memory_profile_level == MEMORY_PROFILE_LEVEL::MICRO_BATCH && _memory_log_file_path != "") {
@@ -41,6 +41,17 @@ struct ExecutePlan {
   }
 };
 
+// Sizes in bytes of the last memory plan
+struct MemoryPlanStats {
+  size_t num_tensors{0};
+  // size of the planned arena
+  size_t peak_size{0};
+  // largest sum of tensors alive at the same step
+  size_t live_size{0};
+  // sum of tensor sizes, i.e., the size without any reuse
+  size_t total_size{0};
+};
+
 class ExecutableGraph : public Graph {
  protected:
   friend class Graph;
@@ -92,6 +103,15 @@ class ExecutableGraph : public Graph {
     return std::find(_used_ranks.begin(), _used_ranks.end(), rank) != _used_ranks.end();
   }
 
+  // number of start/stop events skipped by the last run
+  uint64_t NumElidedEvents() const {
+    return _num_elided_events;
+  }
+
+  const MemoryPlanStats& GetMemoryPlanStats() const {
+    return _memory_plan_stats;
+  }
+
   void SetRunLevel(RunLevel run_level) {
     _run_level = run_level;
   }
@@ -253,18 +273,15 @@ class ExecutableGraph : public Graph {
   void AllocRuntimeBuffer(std::vector<RuntimeContext>& runtime_ctx_list);
 
   void GetExecEnvs();
+
+  void PlanEventRecords(const TensorList& fetches, bool timing);
+
+  uint64_t CollectElidedEvents();
   
   // memory plan相关
-  void AllocMemory(size_t& memory_size, MemoryPlan& memory_plan,
-                            MemoryBlockList& temporary_free_memory, MemoryBlockList& free_memory, MicroBatchTensorId tensor_id,
-                            size_t alloc_memory_size);
-  
-  void FreeMemory(MemoryPlan& memory_plan, MemoryBlockList& free_memory,
-                  MicroBatchTensorId tensor_id);
-  
-  MemoryPlan GenerateMemoryPlan(size_t& memory_size, std::vector<std::pair<bool, size_t>> tasks,
-                                std::vector<Tensor2IntMap> tensor2degrees_list,
-                                const FeedDict& feed_dict);
+  MemoryPlan GenerateMemoryPlan(size_t& memory_size,
+                                const std::vector<std::pair<int32_t, size_t>>& tasks,
+                                const TensorList& fetches);
 
   // plan相关
   ExecutePlan _execute_plan;
@@ -322,6 +339,14 @@ class ExecutableGraph : public Graph {
   std::vector<std::shared_ptr<MicroBatchMemoryInfo>> _all_micro_batches_memory_info;
   int32_t _parallel_attn_flag;
   std::string _parallel_attn_log_file_path;
+
+  // memory plan相关
+  bool _use_memory_plan{false};
+  MemoryPlanStats _memory_plan_stats;
+
+  // event elision相关
+  bool _event_elision{true};
+  uint64_t _num_elided_events{0};
 };
 
 } // namespace graph
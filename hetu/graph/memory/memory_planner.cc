@@ -0,0 +1,157 @@
+#include "hetu/graph/memory/memory_planner.h"
+#include <map>
+#include <numeric>
+
+namespace hetu {
+namespace graph {
+
+namespace {
+
+// Segment tree over the (compressed) steps. An inserted range is stored at
+// the O(log n) nodes that cover it, so the ranges containing a step are
+// found on the path from the root to the leaf of that step.
+class StepIntervalTree {
+ public:
+  StepIntervalTree(size_t num_steps)
+  : _num_steps(num_steps), _nodes(4 * std::max<size_t>(num_steps, 1)) {}
+
+  void Insert(size_t lo, size_t hi, size_t value) {
+    _Insert(1, 0, _num_steps - 1, lo, hi, value);
+  }
+
+  template <typename Fn>
+  void ForEachContaining(size_t step, Fn&& fn) const {
+    size_t node = 1, l = 0, r = _num_steps - 1;
+    while (true) {
+      for (auto value : _nodes[node])
+        fn(value);
+      if (l == r)
+        break;
+      size_t mid = (l + r) / 2;
+      if (step <= mid) {
+        node = node * 2;
+        r = mid;
+      } else {
+        node = node * 2 + 1;
+        l = mid + 1;
+      }
+    }
+  }
+
+ private:
+  void _Insert(size_t node, size_t l, size_t r, size_t lo, size_t hi,
+               size_t value) {
+    if (lo <= l && r <= hi) {
+      _nodes[node].push_back(value);
+      return;
+    }
+    size_t mid = (l + r) / 2;
+    if (lo <= mid)
+      _Insert(node * 2, l, mid, lo, hi, value);
+    if (hi > mid)
+      _Insert(node * 2 + 1, mid + 1, r, lo, hi, value);
+  }
+
+  const size_t _num_steps;
+  std::vector<std::vector<size_t>> _nodes;
+};
+
+} // namespace
+
+bool MemoryPlanner::Conflict(size_t a, size_t b) const {
+  const auto* first = &_ranges.at(a);
+  const auto* second = &_ranges.at(b);
+  if (first->begin > second->begin)
+    std::swap(first, second);
+  int64_t release =
+    first->stream == second->stream ? first->end : first->sync_end;
+  return second->begin <= release;
+}
+
+void MemoryPlanner::Plan() {
+  size_t num_buffers = _ranges.size();
+  _offsets.assign(num_buffers, 0);
+  _peak_size = 0;
+  _total_size = 0;
+  _live_size = 0;
+
+  std::vector<size_t> order(num_buffers);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (_ranges[a].size != _ranges[b].size)
+      return _ranges[a].size > _ranges[b].size;
+    if (_ranges[a].begin != _ranges[b].begin)
+      return _ranges[a].begin < _ranges[b].begin;
+    return a < b;
+  });
+
+  // Placed buffers are indexed by their live ranges, so that each buffer
+  // only visits the placed buffers alive at the same time as itself.
+  std::vector<int64_t> steps;
+  steps.reserve(num_buffers * 2);
+  for (const auto& range : _ranges) {
+    steps.push_back(range.begin);
+    steps.push_back(range.sync_end);
+  }
+  std::sort(steps.begin(), steps.end());
+  steps.erase(std::unique(steps.begin(), steps.end()), steps.end());
+  auto step_index = [&steps](int64_t step) {
+    return std::lower_bound(steps.begin(), steps.end(), step) - steps.begin();
+  };
+  StepIntervalTree alive(steps.size());
+  std::multimap<int64_t, size_t> placed_by_begin;
+
+  std::vector<std::pair<size_t, size_t>> conflicts;
+  for (auto buffer : order) {
+    const auto& range = _ranges[buffer];
+    size_t size = range.size;
+    _total_size += size;
+    if (size == 0)
+      continue;
+    // A conflicting buffer either is alive at `begin` or starts in
+    // (begin, sync_end], since releases never come after `sync_end`.
+    conflicts.clear();
+    auto collect = [&](size_t other) {
+      if (Conflict(other, buffer))
+        conflicts.emplace_back(_offsets[other], other);
+    };
+    size_t lo = step_index(range.begin), hi = step_index(range.sync_end);
+    alive.ForEachContaining(lo, collect);
+    for (auto it = placed_by_begin.upper_bound(range.begin);
+         it != placed_by_begin.end() && it->first <= range.sync_end; ++it)
+      collect(it->second);
+    std::sort(conflicts.begin(), conflicts.end());
+
+    // gaps between the conflicting buffers, ordered by size and then offset
+    std::multimap<size_t, size_t> gaps;
+    size_t prev_end = 0;
+    for (const auto& kv : conflicts) {
+      if (kv.first > prev_end)
+        gaps.emplace(kv.first - prev_end, prev_end);
+      prev_end = std::max(prev_end, kv.first + _ranges[kv.second].size);
+    }
+    auto best_fit = gaps.lower_bound(size);
+    size_t offset = best_fit != gaps.end() ? best_fit->second : prev_end;
+    _offsets[buffer] = offset;
+    _peak_size = std::max(_peak_size, offset + size);
+    alive.Insert(lo, hi, buffer);
+    placed_by_begin.emplace(range.begin, buffer);
+  }
+
+  // sweep over the steps, releasing buffers before allocating new ones
+  std::vector<std::pair<int64_t, int64_t>> events;
+  events.reserve(num_buffers * 2);
+  for (const auto& range : _ranges) {
+    events.emplace_back(range.begin, static_cast<int64_t>(range.size));
+    events.emplace_back(range.end + 1, -static_cast<int64_t>(range.size));
+  }
+  std::sort(events.begin(), events.end());
+  int64_t live = 0;
+  for (const auto& event : events) {
+    live += event.second;
+    _live_size = std::max(_live_size, static_cast<size_t>(live));
+  }
+}
+
+} // namespace graph
+} // namespace hetu
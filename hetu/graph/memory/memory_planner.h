@@ -0,0 +1,87 @@
+#pragma once
+
+#include "hetu/common/macros.h"
+#include "hetu/core/stream.h"
+#include <algorithm>
+#include <vector>
+
+namespace hetu {
+namespace graph {
+
+// Offline planner that places buffers with known live ranges into a single
+// arena. Steps are positions in the execution order of the whole schedule.
+// A buffer occupies its slot from `begin` to `end` (both inclusive) for
+// buffers on the same stream. Other streams are not ordered with its last
+// use, so they may only reuse the slot after `sync_end`.
+struct MemoryLiveRange {
+  size_t size;
+  int64_t begin;
+  int64_t end;
+  int64_t sync_end;
+  StreamIndex stream;
+};
+
+class MemoryPlanner {
+ public:
+  MemoryPlanner() = default;
+
+  size_t AddBuffer(size_t size, int64_t begin, int64_t end, int64_t sync_end,
+                   StreamIndex stream) {
+    HT_ASSERT(begin <= end && end <= sync_end)
+      << "Invalid live range [" << begin << ", " << end << "] (synced at "
+      << sync_end << ")";
+    _ranges.push_back({size, begin, end, sync_end, stream});
+    return _ranges.size() - 1;
+  }
+
+  // Extends the live range of a buffer, e.g., when a view of it is used.
+  void ExtendBuffer(size_t buffer, int64_t end, int64_t sync_end) {
+    auto& range = _ranges.at(buffer);
+    range.end = std::max(range.end, end);
+    range.sync_end = std::max(range.sync_end, std::max(sync_end, range.end));
+  }
+
+  // Greedy-by-size packing: buffers are placed from the largest to the
+  // smallest, each into the best-fitting gap left by the already placed
+  // buffers whose live ranges conflict with it.
+  void Plan();
+
+  bool Conflict(size_t a, size_t b) const;
+
+  const MemoryLiveRange& range(size_t buffer) const {
+    return _ranges.at(buffer);
+  }
+
+  size_t offset(size_t buffer) const {
+    return _offsets.at(buffer);
+  }
+
+  size_t num_buffers() const {
+    return _ranges.size();
+  }
+
+  // size of the arena, i.e., the planned peak
+  size_t peak_size() const {
+    return _peak_size;
+  }
+
+  // size without any reuse
+  size_t total_size() const {
+    return _total_size;
+  }
+
+  // largest sum of buffers alive at the same step, a lower bound of the peak
+  size_t live_size() const {
+    return _live_size;
+  }
+
+ protected:
+  std::vector<MemoryLiveRange> _ranges;
+  std::vector<size_t> _offsets;
+  size_t _peak_size{0};
+  size_t _total_size{0};
+  size_t _live_size{0};
+};
+
+} // namespace graph
+} // namespace hetu
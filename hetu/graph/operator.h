@@ -294,6 +294,13 @@ struct OpInstantiationContext {
   StreamIndex stream_index;
   std::unique_ptr<Event> start[HT_MAX_NUM_MICRO_BATCHES];
   std::unique_ptr<Event> stop[HT_MAX_NUM_MICRO_BATCHES];
+  // The start events are only used for timing, and the stop events only
+  // when a consumer on another stream blocks on them or the outputs are
+  // fetched. Executable graphs turn off the ones they do not need before
+  // each run, which saves a queued task per event on CPU streams.
+  bool record_start_events{true};
+  bool record_stop_events{true};
+  uint64_t num_elided_events{0};
 
   Stream stream() const {
     // Question: create stream inside kernels?
@@ -544,9 +551,9 @@ class OpDef : public shared_ptr_target {
       << ", the input vals are (may not sync) " << input_sums;
     */
     // if(instantiation_ctx().placement.index() == 0) std::cout << "start_operator_compute" << std::endl;
-    instantiation_ctx().start[micro_batch_id]->Record(stream());
+    RecordStartEvent(micro_batch_id);
     _body->Compute(get_self(), inputs, outputs, runtime_ctx);
-    instantiation_ctx().stop[micro_batch_id]->Record(stream());
+    RecordStopEvent(micro_batch_id);
     // precision debug
     /*
     // stream().Sync();
@@ -582,9 +589,9 @@ class OpDef : public shared_ptr_target {
     HT_LOG_INFO << hetu::impl::comm::GetLocalDevice() << " micro batch: " << micro_batch_id << ", compute op: " << name()
       << ", the input vals are " << input_sums;
     */
-    instantiation_ctx().start[micro_batch_id]->Record(stream());
+    RecordStartEvent(micro_batch_id);
     auto rets = _body->Compute(get_self(), inputs, runtime_ctx);
-    instantiation_ctx().stop[micro_batch_id]->Record(stream());
+    RecordStopEvent(micro_batch_id);
     // stream().Sync();
     // precision debug
     /*
@@ -624,6 +631,20 @@ class OpDef : public shared_ptr_target {
     return rets;
   }
 
+  void RecordStartEvent(size_t micro_batch_id = 0) {
+    if (instantiation_ctx().record_start_events)
+      instantiation_ctx().start[micro_batch_id]->Record(stream());
+    else
+      instantiation_ctx().num_elided_events++;
+  }
+
+  void RecordStopEvent(size_t micro_batch_id = 0) {
+    if (instantiation_ctx().record_stop_events)
+      instantiation_ctx().stop[micro_batch_id]->Record(stream());
+    else
+      instantiation_ctx().num_elided_events++;
+  }
+
   void Sync(size_t micro_batch_id = 0) {
     instantiation_ctx().stop[micro_batch_id]->Sync();
   }
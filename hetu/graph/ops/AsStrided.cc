@@ -69,10 +69,10 @@ void AsStridedGradientOpImpl::DoCompute(Operator& op,
   HTShape in_shape = inputs.at(1)->shape();
   HTStride in_stride = inputs.at(1)->stride();
 
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(),
-                               hetu::impl::AsStridedGradient, inputs.at(0),
-                               outputs.at(0), outshape(), stride(), in_shape, in_stride,
-                               in_offset, out_offset, op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(),
+                                  hetu::impl::AsStridedGradient, inputs.at(0),
+                                  outputs.at(0), outshape(), stride(), in_shape, in_stride,
+                                  in_offset, out_offset, op->instantiation_ctx().stream());
 }
 
 NDArrayList
@@ -12,11 +12,11 @@ void AttentionOpImpl::DoCompute(Operator& op,
                                 RuntimeContext& ctx) const {
   
   double softmax_scale_ = softmax_scale() >= 0 ? softmax_scale() : std::pow(inputs.at(0)->shape(3), -0.5);
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(), hetu::impl::FlashAttn,
-                               inputs.at(0), inputs.at(1), inputs.at(2), outputs.at(0), outputs.at(1),
-                               outputs.at(2), outputs.at(3), outputs.at(4), outputs.at(5),
-                               outputs.at(6), outputs.at(7), p_dropout(), softmax_scale_,
-                               is_causal(), return_softmax(), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(), hetu::impl::FlashAttn,
+                                  inputs.at(0), inputs.at(1), inputs.at(2), outputs.at(0), outputs.at(1),
+                                  outputs.at(2), outputs.at(3), outputs.at(4), outputs.at(5),
+                                  outputs.at(6), outputs.at(7), p_dropout(), softmax_scale_,
+                                  is_causal(), return_softmax(), op->instantiation_ctx().stream());
 }
 
 TensorList AttentionOpImpl::DoGradient(Operator& op, const TensorList& grad_outputs) const {
@@ -66,12 +66,12 @@ HTShapeList AttentionOpImpl::DoInferShape(Operator& op,
 void AttentionGradientOpImpl::DoCompute(Operator& op, const NDArrayList& inputs,
                                         NDArrayList& outputs, RuntimeContext& ctx) const {
   double softmax_scale_ = softmax_scale() >= 0 ? softmax_scale() : std::pow(inputs.at(1)->shape(3), -0.5);
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(),
-                               hetu::impl::FlashAttnGradient, inputs.at(0),
-                               inputs.at(1), inputs.at(2), inputs.at(3), const_cast<NDArray&>(inputs.at(4)),
-                               const_cast<NDArray&>(inputs.at(5)), const_cast<NDArray&>(inputs.at(6)), 
-                               outputs.at(0), outputs.at(1), outputs.at(2), p_dropout(), softmax_scale_,
-                               is_causal(), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(),
+                                  hetu::impl::FlashAttnGradient, inputs.at(0),
+                                  inputs.at(1), inputs.at(2), inputs.at(3), const_cast<NDArray&>(inputs.at(4)),
+                                  const_cast<NDArray&>(inputs.at(5)), const_cast<NDArray&>(inputs.at(6)), 
+                                  outputs.at(0), outputs.at(1), outputs.at(2), p_dropout(), softmax_scale_,
+                                  is_causal(), op->instantiation_ctx().stream());
 }
 
 HTShapeList AttentionGradientOpImpl::DoInferShape(Operator& op, 
@@ -84,14 +84,14 @@ void AttentionVarlenOpImpl::DoCompute(Operator& op,
                                       const NDArrayList& inputs, NDArrayList& outputs,
                                       RuntimeContext& ctx) const {
   
-  double softmax_scale_ = softmax_scale() >= 0 ? softmax_scale() : std::pow(inputs.at(0)->shape(3), -0.5);
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(), hetu::impl::FlashAttnVarlen,
-                               inputs.at(0), inputs.at(1), inputs.at(2), inputs.at(3), inputs.at(4),
-                               outputs.at(0), outputs.at(1),
-                               outputs.at(2), outputs.at(3), outputs.at(4), outputs.at(5),
-                               outputs.at(6), outputs.at(7), max_seqlen_q(), max_seqlen_k(),
-                               p_dropout(), softmax_scale_, zero_tensors(),
-                               is_causal(), return_softmax(), op->instantiation_ctx().stream());
+  double softmax_scale_ = softmax_scale() >= 0 ? softmax_scale() : std::pow(inputs.at(0)->shape(2), -0.5);
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(), hetu::impl::FlashAttnVarlen,
+                                  inputs.at(0), inputs.at(1), inputs.at(2), inputs.at(3), inputs.at(4),
+                                  outputs.at(0), outputs.at(1),
+                                  outputs.at(2), outputs.at(3), outputs.at(4), outputs.at(5),
+                                  outputs.at(6), outputs.at(7), max_seqlen_q(), max_seqlen_k(),
+                                  p_dropout(), softmax_scale_, zero_tensors(),
+                                  is_causal(), return_softmax(), op->instantiation_ctx().stream());
 }
 
 TensorList AttentionVarlenOpImpl::DoGradient(Operator& op, const TensorList& grad_outputs) const {
@@ -144,15 +144,15 @@ HTShapeList AttentionVarlenOpImpl::DoInferShape(Operator& op,
 
 void AttentionVarlenGradientOpImpl::DoCompute(Operator& op,const NDArrayList& inputs,
                                         NDArrayList& outputs, RuntimeContext& ctx) const {
-  double softmax_scale_ = softmax_scale() >= 0 ? softmax_scale() : std::pow(inputs.at(1)->shape(3), -0.5);
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(),
-                               hetu::impl::FlashAttnVarlenGradient, inputs.at(0),
-                               inputs.at(1), inputs.at(2), inputs.at(3), inputs.at(4), 
-                               inputs.at(5), const_cast<NDArray&>(inputs.at(6)),
-                               const_cast<NDArray&>(inputs.at(7)), const_cast<NDArray&>(inputs.at(8)), 
-                               outputs.at(0), outputs.at(1), outputs.at(2), max_seqlen_q(), max_seqlen_k(), 
-                               p_dropout(), softmax_scale_, zero_tensors(),
-                               is_causal(), op->instantiation_ctx().stream());
+  double softmax_scale_ = softmax_scale() >= 0 ? softmax_scale() : std::pow(inputs.at(1)->shape(2), -0.5);
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(),
+                                  hetu::impl::FlashAttnVarlenGradient, inputs.at(0),
+                                  inputs.at(1), inputs.at(2), inputs.at(3), inputs.at(4), 
+                                  inputs.at(5), const_cast<NDArray&>(inputs.at(6)),
+                                  const_cast<NDArray&>(inputs.at(7)), const_cast<NDArray&>(inputs.at(8)), 
+                                  outputs.at(0), outputs.at(1), outputs.at(2), max_seqlen_q(), max_seqlen_k(), 
+                                  p_dropout(), softmax_scale_, zero_tensors(),
+                                  is_causal(), op->instantiation_ctx().stream());
 }
 
 HTShapeList AttentionVarlenGradientOpImpl::DoInferShape(Operator& op, 
@@ -8,8 +8,8 @@ namespace graph {
 void CheckFiniteOpImpl::DoCompute(Operator& op, 
                                   const NDArrayList& inputs, NDArrayList& outputs,
                                   RuntimeContext& ctx) const {
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(), hetu::impl::CheckFinite,
-                               inputs.at(0), outputs.at(0), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(), hetu::impl::CheckFinite,
+                                  inputs.at(0), outputs.at(0), op->instantiation_ctx().stream());
 }
 
 TensorList CheckFiniteOpImpl::DoGradient(Operator& op, const TensorList& grad_outputs) const {
@@ -33,8 +33,8 @@ Tensor MakeCheckFiniteOp(Tensor input, OpMeta op_meta) {
 void CheckNumericOpImpl::DoCompute(Operator& op, 
                                   const NDArrayList& inputs, NDArrayList& outputs,
                                   RuntimeContext& ctx) const {
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(), hetu::impl::CheckNumeric,
-                               inputs.at(0), outputs.at(0), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(), hetu::impl::CheckNumeric,
+                                  inputs.at(0), outputs.at(0), op->instantiation_ctx().stream());
 }
 
 TensorList CheckNumericOpImpl::DoGradient(Operator& op, const TensorList& grad_outputs) const {
@@ -18,9 +18,9 @@ void DropoutOpImpl::DoCompute(Operator& op, const NDArrayList& inputs,
   if (op->op_meta().origin_op_id != -1) {
     seed = ctx.get(op->op_meta().origin_op_id).get_uint64("seed");
   }
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(),
-                               hetu::impl::Dropout, inputs.at(0), 1 - keep_prob(),
-                               seed, outputs.at(0), outputs.at(1), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(),
+                                  hetu::impl::Dropout, inputs.at(0), 1 - keep_prob(),
+                                  seed, outputs.at(0), outputs.at(1), op->instantiation_ctx().stream());
 };
 
 NDArrayList DropoutOpImpl::DoCompute(Operator& op,
@@ -47,7 +47,7 @@ TensorList DropoutOpImpl::DoGradient(Operator& op, const TensorList& grad_output
 void DropoutGradientOpImpl::DoCompute(Operator& op, const NDArrayList& inputs,
                                       NDArrayList& outputs,
                                       RuntimeContext& ctx) const {
-  HT_DISPATCH_KERNEL_CUDA_ONLY(
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(
     op->instantiation_ctx().placement.type(), type(), hetu::impl::DropoutGradient, inputs.at(0),
     inputs.at(1), 1 - keep_prob(), outputs.at(0), op->instantiation_ctx().stream());
 };
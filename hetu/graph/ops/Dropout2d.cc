@@ -18,9 +18,9 @@ void Dropout2dOpImpl::DoCompute(Operator& op, const NDArrayList& inputs,
   if (op->op_meta().origin_op_id != -1) {
     seed = ctx.get(op->op_meta().origin_op_id).get_uint64("seed");
   }
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(),
-                                hetu::impl::Dropout2d, inputs.at(0), 1 - keep_prob(),
-                                seed, outputs.at(0), outputs.at(1), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(),
+                                  hetu::impl::Dropout2d, inputs.at(0), 1 - keep_prob(),
+                                  seed, outputs.at(0), outputs.at(1), op->instantiation_ctx().stream());
 };
 
 NDArrayList Dropout2dOpImpl::DoCompute(Operator& op,
@@ -39,7 +39,7 @@ NDArrayList Dropout2dOpImpl::DoCompute(Operator& op,
 
 TensorList Dropout2dOpImpl::DoGradient(Operator& op, const TensorList& grad_outputs) const {
   return {op->requires_grad(0) ? MakeDropout2dGradientOp(grad_outputs.at(0),
-                                  op->output(0), keep_prob(), inplace(),
+                                  op->output(1), keep_prob(), inplace(),
                                   op->grad_op_meta().set_name(op->grad_name()))
                                : Tensor()};
 }
@@ -59,7 +59,7 @@ void Dropout2dOpImpl::DoDeduceStates(const TensorList& inputs, TensorList& outpu
 void Dropout2dGradientOpImpl::DoCompute(Operator& op, const NDArrayList& inputs,
                                         NDArrayList& outputs,
                                         RuntimeContext& ctx) const {
-  HT_DISPATCH_KERNEL_CUDA_ONLY(
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(
     op->instantiation_ctx().placement.type(), type(), hetu::impl::Dropout2dGradient,
     inputs.at(0), inputs.at(1), 1 - keep_prob(), outputs.at(0), op->instantiation_ctx().stream());
 }
@@ -32,7 +32,7 @@ HTShapeList QuantizationOpImpl::DoInferShape(Operator& op,
   int64_t numel_ = 1;
   for (auto& item: input_shapes[0])
     numel_ *= item;
-  HTShape absmax_shape = {numel_ / blocksize()};
+  HTShape absmax_shape = {(numel_ + blocksize() - 1) / blocksize()};
   return {input_shapes.at(0), absmax_shape};
 }
 
@@ -31,10 +31,10 @@ void RMSNormOpImpl::DoCompute(Operator& op,
   NDArray rowscalemat = rowscale_.is_defined() ? NDArray::view(rowscale_, {-1}) : rowscale_;
   NDArray x0_subsetmat = x0_subset_.is_defined() ? NDArray::view(x0_subset_, {-1}) : x0_subset_;
   NDArray out_subsetmet = z_subset_.is_defined() ? NDArray::view(z_subset_, {-1}) : z_subset_;
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(), hetu::impl::DropoutAddLnFwd,
-                               x0mat, residualmat, gamma, beta_, rowscalemat, colscale_, x0_subsetmat, out_subsetmet,
-                               z, x, dmask, mu, rsigma, dropout_p(), epsilon(), rowscale_const(), z_numrows(),
-                               residual_in_fp32(), is_rms_norm(), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(), hetu::impl::DropoutAddLnFwd,
+                                  x0mat, residualmat, gamma, beta_, rowscalemat, colscale_, x0_subsetmat, out_subsetmet,
+                                  z, x, dmask, mu, rsigma, dropout_p(), epsilon(), rowscale_const(), z_numrows(),
+                                  residual_in_fp32(), is_rms_norm(), op->instantiation_ctx().stream());
 }
 
 TensorList RMSNormOpImpl::DoGradient(Operator& op, const TensorList& grad_outputs) const {
@@ -45,7 +45,8 @@ TensorList RMSNormOpImpl::DoGradient(Operator& op, const TensorList& grad_output
   } 
   TensorList grads = MakeRMSNormGradientOp(grad_outputs.at(0),
                                            grad_outputs.at(1),
-                                           output_indexs(1) >= 0 ? op->output(output_indexs(1)) : Tensor(),
+                                           // x equals x0 when it is not saved
+                                           output_indexs(1) >= 0 ? op->output(output_indexs(1)) : op->input(input_indexs(0)),
                                            input_indexs(5) >= 0 ? op->input(input_indexs(0)) : Tensor(),
                                            output_indexs(2) >= 0 ? op->output(output_indexs(2)) : Tensor(),
                                            output_indexs(3) >= 0 ? op->output(output_indexs(3)) : Tensor(),
@@ -157,12 +158,12 @@ void RMSNormGradientOpImpl::DoCompute(Operator& op,const NDArrayList& inputs,
   NDArray dbeta_part = NDArray(); 
   NDArray dcolscale_part = NDArray();
 
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(), type(),
-                               hetu::impl::DropoutAddLnBwd, dzmat, dxmat, xmat, x0mat, dmask_, mu,
-                               rsigma, gamma, rowscalemat, colscale_, x0_subsetmat, out_subsetmat,
-                               dx0, dresidual, dgamma, dbeta, dgamma_part, dbeta_part, dcolscale,
-                               dcolscale_part, dropout_p(), rowscale_const(), x0_numrows(),
-                               has_residual(), is_rms_norm(), op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(), type(),
+                                  hetu::impl::DropoutAddLnBwd, dzmat, dxmat, xmat, x0mat, dmask_, mu,
+                                  rsigma, gamma, rowscalemat, colscale_, x0_subsetmat, out_subsetmat,
+                                  dx0, dresidual, dgamma, dbeta, dgamma_part, dbeta_part, dcolscale,
+                                  dcolscale_part, dropout_p(), rowscale_const(), x0_numrows(),
+                                  has_residual(), is_rms_norm(), op->instantiation_ctx().stream());
 }
 
 // workaround: need to care about all input cases
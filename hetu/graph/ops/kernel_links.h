@@ -34,8 +34,9 @@ DECLARE_KERNEL_CPU_AND_CUDA(AsStrided, const NDArray&, NDArray&,
                             const HTStride&, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(AsStridedGradient, const NDArray&, NDArray&,
                             const HTStride&, const Stream&);
-DECLARE_KERNEL_CUDA(AsStridedGradient, const NDArray&, NDArray&, const HTShape&, const HTStride&,
-                    const HTShape&, const HTStride&, int64_t, int64_t, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(AsStridedGradient, const NDArray&, NDArray&,
+                            const HTShape&, const HTStride&, const HTShape&,
+                            const HTStride&, int64_t, int64_t, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(AvgPool, const NDArray&, const size_t, const size_t,
                             NDArray&, const size_t, const size_t,
                             const Stream&);
@@ -125,17 +126,17 @@ DECLARE_KERNEL_CPU_AND_CUDA(Dot, const NDArray&, const NDArray&,
                             NDArray&, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(Dropout, const NDArray&, double, uint64_t, NDArray&,
                             NDArray&, const Stream&);
-DECLARE_KERNEL_CUDA(DropoutAddLnFwd, const NDArray&, const NDArray&, const NDArray&,
-                    const NDArray&, const NDArray& , const NDArray&, const NDArray&,
-                    const NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,
-                    const float, const float, const float, const int64_t, 
-                    bool, bool, const Stream&);
-DECLARE_KERNEL_CUDA(DropoutAddLnBwd, const NDArray&, const NDArray&, const NDArray&,
-                    const NDArray&, const NDArray& , const NDArray&, const NDArray&,
-                    const NDArray&, const NDArray& , const NDArray&, const NDArray&,
-                    const NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,
-                    NDArray&, NDArray&, NDArray&, const float, const float, 
-                    const int64_t, const bool, bool, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(DropoutAddLnFwd, const NDArray&, const NDArray&, const NDArray&,
+                            const NDArray&, const NDArray& , const NDArray&, const NDArray&,
+                            const NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,
+                            const float, const float, const float, const int64_t, 
+                            bool, bool, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(DropoutAddLnBwd, const NDArray&, const NDArray&, const NDArray&,
+                            const NDArray&, const NDArray& , const NDArray&, const NDArray&,
+                            const NDArray&, const NDArray& , const NDArray&, const NDArray&,
+                            const NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,
+                            NDArray&, NDArray&, NDArray&, const float, const float, 
+                            const int64_t, const bool, bool, const Stream&);
 DECLARE_KERNEL_CUDA(DropoutAddLnParallelResidualFwd, const NDArray&, const NDArray&,
                     const NDArray&, const NDArray& , const NDArray&, const NDArray&,
                     const NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,
@@ -160,23 +161,23 @@ DECLARE_KERNEL_CPU_AND_CUDA(EmbeddingLookupGradient, const NDArray&,
                             const NDArray&, NDArray&, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(Exp, const NDArray&, NDArray&, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(Eye, NDArray&, const Stream&);
-DECLARE_KERNEL_CUDA(FlashAttn, const NDArray&, const NDArray&, const NDArray&,        
-                    NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,     
-                    NDArray&, NDArray&, const float, const float,
-                    const bool, const bool, const Stream&);
-DECLARE_KERNEL_CUDA(FlashAttnGradient, const NDArray&, const NDArray&, const NDArray&,        
-                    const NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,     
-                    NDArray&, const float, const float, const bool, const Stream&);
-DECLARE_KERNEL_CUDA(FlashAttnVarlen, const NDArray&, const NDArray&,const NDArray&,
-                    const NDArray&, const NDArray&, NDArray&, NDArray&, NDArray&, 
-                    NDArray&, NDArray&, NDArray&, NDArray&, NDArray& rng_state,
-                    const int, const int, const float, const float, const bool, 
-                    const bool, const bool, const Stream&);
-DECLARE_KERNEL_CUDA(FlashAttnVarlenGradient, const NDArray&, const NDArray&, const NDArray&,        
-                    const NDArray&, const NDArray&, const NDArray&, 
-                    NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,     
-                    NDArray&, const int, const int, const float, const float, 
-                    const bool, const bool, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(FlashAttn, const NDArray&, const NDArray&, const NDArray&,        
+                            NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,     
+                            NDArray&, NDArray&, const float, const float,
+                            const bool, const bool, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(FlashAttnGradient, const NDArray&, const NDArray&, const NDArray&,        
+                            const NDArray&, NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,     
+                            NDArray&, const float, const float, const bool, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(FlashAttnVarlen, const NDArray&, const NDArray&,const NDArray&,
+                            const NDArray&, const NDArray&, NDArray&, NDArray&, NDArray&, 
+                            NDArray&, NDArray&, NDArray&, NDArray&, NDArray& rng_state,
+                            const int, const int, const float, const float, const bool, 
+                            const bool, const bool, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(FlashAttnVarlenGradient, const NDArray&, const NDArray&, const NDArray&,        
+                            const NDArray&, const NDArray&, const NDArray&, 
+                            NDArray&, NDArray&, NDArray&, NDArray&, NDArray&,     
+                            NDArray&, const int, const int, const float, const float, 
+                            const bool, const bool, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(Floor, const NDArray&, NDArray&, const Stream&);
 DECLARE_KERNEL_CUDA(FusedLayerNorm, const NDArray&, const NDArray&,
                     const NDArray&, NDArray&, NDArray&, NDArray&,
@@ -231,9 +232,9 @@ DECLARE_KERNEL_CPU_AND_CUDA(MatDot, const NDArray&, const NDArray&, NDArray&,
                             const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(MatMul, const NDArray& a, bool trans_a, const NDArray& b,
                             bool trans_b, NDArray& output, const Stream&);
-DECLARE_KERNEL_CUDA(MatMul4Bit, const NDArray&, bool, const NDArray&, bool,
-                    const NDArray&, const NDArray&, NDArray&,
-                    int blocksize, const Stream&);
+DECLARE_KERNEL_CPU_AND_CUDA(MatMul4Bit, const NDArray&, bool, const NDArray&,
+                            bool, const NDArray&, const NDArray&, NDArray&,
+                            int blocksize, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(MatVecMul, const NDArray&, bool, const NDArray&,
                             NDArray&, const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(MaxPool, const NDArray&, const size_t, const size_t,
@@ -358,6 +359,15 @@ DECLARE_KERNEL_CPU_AND_CUDA(UniformInits, NDArray&, double, double, uint64_t,
                             const Stream&);
 DECLARE_KERNEL_CPU_AND_CUDA(TruncatedNormalInits, NDArray&, double, double,
                             double, double, uint64_t, const Stream&);
+// Shard-consistent variants: `data` holds the slice of a tensor of
+// `global_shape` starting at `global_begin`.
+DECLARE_KERNEL_CPU(NormalInits, NDArray&, double, double, uint64_t,
+                   const HTShape&, const HTShape&, const Stream&);
+DECLARE_KERNEL_CPU(UniformInits, NDArray&, double, double, uint64_t,
+                   const HTShape&, const HTShape&, const Stream&);
+DECLARE_KERNEL_CPU(TruncatedNormalInits, NDArray&, double, double, double,
+                   double, uint64_t, const HTShape&, const HTShape&,
+                   const Stream&);
 
 // Communication kernels
 DECLARE_KERNEL_CPU_AND_CUDA(AllReduce, const NDArray&, NDArray&, ReductionType,
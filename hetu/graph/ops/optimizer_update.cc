@@ -37,10 +37,10 @@ void SGDUpdateWithGradScalerOpImpl::DoCompute(Operator& op, const NDArrayList& i
   const NDArray& grad = inputs.at(1);
   const NDArray& infinite_count = inputs.at(2);
   NDArray velocity;
-  HT_DISPATCH_KERNEL_CUDA_ONLY(op->instantiation_ctx().placement.type(),
-                               type(), hetu::impl::SGDUpdateWithGradScaler, grad, infinite_count, 
-                               param, velocity, learning_rate(), 0, false,
-                               op->instantiation_ctx().stream());
+  HT_DISPATCH_KERNEL_CPU_AND_CUDA(op->instantiation_ctx().placement.type(),
+                                  type(), hetu::impl::SGDUpdateWithGradScaler, grad, infinite_count, 
+                                  param, velocity, learning_rate(), 0, false,
+                                  op->instantiation_ctx().stream());
 }
 
 void MomentumUpdateOpImpl::DoCompute(Operator& op, const NDArrayList& inputs,
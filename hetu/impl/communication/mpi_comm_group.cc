@@ -1,8 +1,12 @@
 #include "hetu/impl/communication/mpi_comm_group.h"
 #include "hetu/impl/stream/CPUStream.h"
 #include "hetu/impl/utils/ndarray_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <numeric>
 #include <mutex>
+#include <thread>
 
 namespace hetu {
 namespace impl {
@@ -19,12 +23,25 @@ DECLARE_HT_EXCEPTION(mpi_error);
 
 namespace {
 
-inline MPI_Op to_MPI_Op(ReductionType red_type) {
+// MPI has no built-in types for half precision, so we register 2-byte
+// datatypes and reduction ops that accumulate in fp32 by ourselves.
+// They are created along with MPI_Init and freed before MPI_Finalize.
+static MPI_Datatype mpi_float16_type = MPI_DATATYPE_NULL;
+static MPI_Datatype mpi_bfloat16_type = MPI_DATATYPE_NULL;
+static std::vector<MPI_Op> mpi_float16_ops(NUM_REDUCTION_TYPES, MPI_OP_NULL);
+static std::vector<MPI_Op> mpi_bfloat16_ops(NUM_REDUCTION_TYPES, MPI_OP_NULL);
+
+inline MPI_Op to_MPI_Op(ReductionType red_type, DataType dtype) {
   switch (red_type) {
-    case kSUM: return MPI_SUM;
-    case kPROD: return MPI_PROD;
-    case kMAX: return MPI_MAX;
-    case kMIN: return MPI_MIN;
+    case kSUM:
+    case kPROD:
+    case kMAX:
+    case kMIN:
+      if (dtype == kFloat16)
+        return mpi_float16_ops[static_cast<int>(red_type)];
+      if (dtype == kBFloat16)
+        return mpi_bfloat16_ops[static_cast<int>(red_type)];
+      break;
     case kNONE:
       HT_NOT_IMPLEMENTED << "Reduction type cannot be none";
       __builtin_unreachable();
@@ -33,6 +50,12 @@ inline MPI_Op to_MPI_Op(ReductionType red_type) {
                          << " is not supported for MPI.";
       __builtin_unreachable();
   }
+  switch (red_type) {
+    case kSUM: return MPI_SUM;
+    case kPROD: return MPI_PROD;
+    case kMAX: return MPI_MAX;
+    default: return MPI_MIN;
+  }
 }
 
 inline MPI_Datatype to_MPI_Datatype(DataType dtype) {
@@ -42,6 +65,8 @@ inline MPI_Datatype to_MPI_Datatype(DataType dtype) {
     case kInt16: return MPI_SHORT;
     case kInt32: return MPI_INT;
     case kInt64: return MPI_LONG;
+    case kFloat16: return mpi_float16_type;
+    case kBFloat16: return mpi_bfloat16_type;
     case kFloat32: return MPI_FLOAT;
     case kFloat64: return MPI_DOUBLE;
     default:
@@ -58,6 +83,8 @@ inline int to_num_bytes(DataType dtype) {
     case kInt16: return 2;
     case kInt32: return 4;
     case kInt64: return 8;
+    case kFloat16: return 2;
+    case kBFloat16: return 2;
     case kFloat32: return 4;
     case kFloat64: return 8;
     default:
@@ -67,6 +94,79 @@ inline int to_num_bytes(DataType dtype) {
   }
 }
 
+template <typename spec_t, ReductionType red_type>
+void HalfReduceFn(void* in, void* inout, int* len, MPI_Datatype* dtype) {
+  auto* in_ptr = reinterpret_cast<const spec_t*>(in);
+  auto* inout_ptr = reinterpret_cast<spec_t*>(inout);
+  for (int i = 0; i < *len; i++) {
+    float a = static_cast<float>(in_ptr[i]);
+    float b = static_cast<float>(inout_ptr[i]);
+    float c;
+    switch (red_type) {
+      case kSUM: c = a + b; break;
+      case kPROD: c = a * b; break;
+      case kMAX: c = std::max(a, b); break;
+      default: c = std::min(a, b); break;
+    }
+    inout_ptr[i] = spec_t(c);
+  }
+}
+
+template <typename spec_t>
+void CreateHalfTypeAndOps(MPI_Datatype& mpi_dtype, std::vector<MPI_Op>& ops) {
+  MPI_CALL(MPI_Type_contiguous(sizeof(spec_t), MPI_BYTE, &mpi_dtype));
+  MPI_CALL(MPI_Type_commit(&mpi_dtype));
+  // all reductions on floating points are commutative
+  MPI_CALL(MPI_Op_create(&HalfReduceFn<spec_t, kSUM>, 1,
+                         &ops[static_cast<int>(kSUM)]));
+  MPI_CALL(MPI_Op_create(&HalfReduceFn<spec_t, kPROD>, 1,
+                         &ops[static_cast<int>(kPROD)]));
+  MPI_CALL(MPI_Op_create(&HalfReduceFn<spec_t, kMAX>, 1,
+                         &ops[static_cast<int>(kMAX)]));
+  MPI_CALL(MPI_Op_create(&HalfReduceFn<spec_t, kMIN>, 1,
+                         &ops[static_cast<int>(kMIN)]));
+}
+
+void FreeHalfTypeAndOps(MPI_Datatype& mpi_dtype, std::vector<MPI_Op>& ops) {
+  for (auto& op : ops)
+    if (op != MPI_OP_NULL)
+      MPI_CALL(MPI_Op_free(&op));
+  if (mpi_dtype != MPI_DATATYPE_NULL)
+    MPI_CALL(MPI_Type_free(&mpi_dtype));
+}
+
+static size_t ParseBucketSize() {
+  const char* bucket_size_str = std::getenv("HETU_MPI_BUCKET_SIZE_MB");
+  size_t bucket_size_mb = 25; // 默认设置为25MiB
+  if (bucket_size_str != NULL) {
+    try {
+      bucket_size_mb = std::stoul(bucket_size_str);
+    } catch (const std::exception& e) {
+      HT_LOG_WARN
+        << "Invalid HETU_MPI_BUCKET_SIZE_MB: " << bucket_size_str << " is set"
+        << ", please provide an integer"
+        << ", default value will be used in this process.";
+    }
+  }
+  // The elements of a bucket are counted with an int in MPI calls
+  size_t max_bucket_size_mb =
+    static_cast<size_t>(std::numeric_limits<int>::max()) / (1024 * 1024);
+  if (bucket_size_mb > max_bucket_size_mb) {
+    HT_LOG_WARN << "HETU_MPI_BUCKET_SIZE_MB is lowered from " << bucket_size_mb
+                << " to " << max_bucket_size_mb
+                << " so that the count of a bucket fits in an int.";
+    bucket_size_mb = max_bucket_size_mb;
+  }
+  return bucket_size_mb * 1024 * 1024;
+}
+
+// MPI calls take the number of elements as an int
+inline void CheckMPICount(size_t numel) {
+  HT_ASSERT(numel <= static_cast<size_t>(std::numeric_limits<int>::max()))
+    << "Cannot communicate " << numel << " elements in one MPI call, "
+    << "which takes at most " << std::numeric_limits<int>::max() << ".";
+}
+
 static std::once_flag mpi_init_flag;
 static int mpi_world_rank = -1;
 static int mpi_world_size = -1;
@@ -104,12 +204,17 @@ static void MPI_Init_Once() {
       << "Failed to get the world rank and/or size. "
       << "(Got rank " << mpi_world_rank << " and size " << mpi_world_size
       << ".)";
+    // create datatypes and ops for half precision
+    CreateHalfTypeAndOps<hetu::float16>(mpi_float16_type, mpi_float16_ops);
+    CreateHalfTypeAndOps<hetu::bfloat16>(mpi_bfloat16_type, mpi_bfloat16_ops);
     // register exit handler
     HT_ASSERT(std::atexit([]() {
                 MPICallGuard guard;
                 HT_LOG_DEBUG << "Destructing MPI comm groups...";
                 mpi_comm_groups.clear();
                 worldwide_mpi_comm_groups.clear();
+                FreeHalfTypeAndOps(mpi_float16_type, mpi_float16_ops);
+                FreeHalfTypeAndOps(mpi_bfloat16_type, mpi_bfloat16_ops);
                 MPI_CALL(MPI_Finalize());
                 HT_LOG_DEBUG << "Destructed MPI comm groups";
               }) == 0)
@@ -187,6 +292,8 @@ MPICommunicationGroupDef::MPICommunicationGroupDef(
     << "Failed to get rank and/or size. "
     << "(Got rank " << _rank << " and size " << _size << ".)";
 
+  _bucket_size = ParseBucketSize();
+
   HT_LOG_DEBUG << "Initialized MPI comm group for " << _world_ranks
                << " with stream " << _stream << ".";
 }
@@ -220,13 +327,19 @@ void MPICommunicationGroupDef::AllReduce(const NDArray& input, NDArray& output,
   void* send_buf = input->raw_data_ptr();
   void* recv_buf = output->raw_data_ptr();
   auto numel = input->numel();
+  CheckMPICount(numel);
   auto mpi_dtype = to_MPI_Datatype(input->dtype());
-  auto mpi_red_op = to_MPI_Op(red_type);
+  auto mpi_red_op = to_MPI_Op(red_type, input->dtype());
   _latest_future = CPUStream(_stream).EnqueueTask(
     [send_buf, recv_buf, numel, mpi_dtype, mpi_red_op, this]() {
-      MPICallGuard mpi_guard;
-      MPI_CALL(MPI_Allreduce(send_buf == recv_buf ? MPI_IN_PLACE : send_buf,
-                             recv_buf, numel, mpi_dtype, mpi_red_op, _comm));
+      MPI_Request request;
+      {
+        MPICallGuard mpi_guard;
+        MPI_CALL(MPI_Iallreduce(send_buf == recv_buf ? MPI_IN_PLACE : send_buf,
+                                recv_buf, numel, mpi_dtype, mpi_red_op, _comm,
+                                &request));
+      }
+      PollRequest(request);
     },
     "MPI_AllReduce(reduction=" + ReductionType2Str(red_type) + ")");
   NDArray::MarkUsedBy({input, output}, _stream);
@@ -241,49 +354,107 @@ void MPICommunicationGroupDef::AllReduceCoalesce(const NDArrayList& inputs,
     HT_ASSERT_CPU_DEVICE(inputs[i]);
     HT_ASSERT_CPU_DEVICE(outputs[i]);
     HT_ASSERT_EXCHANGABLE(inputs[i], outputs[i]);
+    // Packed buckets are bounded by the bucket size, but a tensor larger
+    // than that is reduced by itself.
+    CheckMPICount(inputs[i]->numel());
     n_bytes += inputs[i]->numel();
   }
   HT_ASSERT(contiguous_buffers->numel() >= n_bytes);
   auto mpi_dtype = to_MPI_Datatype(inputs[0]->dtype());
-  auto mpi_red_op = to_MPI_Op(red_type);
+  auto mpi_red_op = to_MPI_Op(red_type, inputs[0]->dtype());
 
   if (contiguous_buffers->numel() > 0) {
-    void* buffer_ptr = contiguous_buffers->raw_data_ptr();
+    auto* buffer_ptr =
+      reinterpret_cast<char*>(contiguous_buffers->raw_data_ptr());
+    size_t bucket_size = _bucket_size;
     _latest_future = CPUStream(_stream).EnqueueTask(
-      [inputs, outputs, buffer_ptr, mpi_dtype, mpi_red_op, this]() {
-        int offset = 0;
+      [inputs, outputs, buffer_ptr, bucket_size, mpi_dtype, mpi_red_op,
+       this]() {
+        // Split the tensors into buckets of at most `bucket_size` bytes
+        // (a tensor larger than that takes a bucket by itself). Each bucket
+        // is reduced by a non-blocking call as soon as it is packed, so the
+        // communication of a bucket overlaps the packing of the next ones.
+        // A bucket with a single tensor is reduced without packing.
+        // Note: This task only starts once all the inputs are ready, so it
+        // does not overlap the computation of the inputs themselves. To
+        // overlap backward compute, reduce the gradients by separate
+        // AllReduce calls as they are produced.
         int num_bytes_per_element = to_num_bytes(inputs[0]->dtype());
+        std::vector<size_t> bucket_ends;
+        size_t offset = 0, bucket_begin = 0;
         for (size_t i = 0; i < inputs.size(); i++) {
-          void* send_buf = inputs[i]->raw_data_ptr();
-          int num_bytes = inputs[i]->numel() * num_bytes_per_element;
-          std::memcpy(buffer_ptr + offset, send_buf, num_bytes);
+          size_t num_bytes = inputs[i]->numel() * num_bytes_per_element;
+          if (offset > bucket_begin &&
+              offset + num_bytes - bucket_begin > bucket_size) {
+            bucket_ends.push_back(i);
+            bucket_begin = offset;
+          }
           offset += num_bytes;
         }
-        MPICallGuard mpi_guard;
-        MPI_CALL(MPI_Allreduce(MPI_IN_PLACE, buffer_ptr,
-                               int(offset / num_bytes_per_element), mpi_dtype,
-                               mpi_red_op, _comm));
+        bucket_ends.push_back(inputs.size());
+
+        std::vector<MPI_Request> requests(bucket_ends.size());
+        size_t i = 0;
         offset = 0;
-        for (size_t i = 0; i < outputs.size(); i++) {
-          void* recv_buf = outputs[i]->raw_data_ptr();
-          int num_bytes = outputs[i]->numel() * num_bytes_per_element;
-          std::memcpy(recv_buf, buffer_ptr + offset, num_bytes);
-          offset += num_bytes;
+        for (size_t b = 0; b < bucket_ends.size(); b++) {
+          void* send_buf;
+          void* recv_buf;
+          size_t numel = 0;
+          if (bucket_ends[b] == i + 1) {
+            send_buf = inputs[i]->raw_data_ptr();
+            recv_buf = outputs[i]->raw_data_ptr();
+            send_buf = send_buf == recv_buf ? MPI_IN_PLACE : send_buf;
+            numel = inputs[i++]->numel();
+          } else {
+            send_buf = MPI_IN_PLACE;
+            recv_buf = buffer_ptr + offset;
+            for (; i < bucket_ends[b]; i++) {
+              size_t num_bytes = inputs[i]->numel() * num_bytes_per_element;
+              std::memcpy(buffer_ptr + offset, inputs[i]->raw_data_ptr(),
+                          num_bytes);
+              offset += num_bytes;
+              numel += inputs[i]->numel();
+            }
+          }
+          MPICallGuard mpi_guard;
+          MPI_CALL(MPI_Iallreduce(send_buf, recv_buf, numel, mpi_dtype,
+                                  mpi_red_op, _comm, &requests[b]));
+        }
+
+        i = 0;
+        offset = 0;
+        for (size_t b = 0; b < bucket_ends.size(); b++) {
+          PollRequest(requests[b]);
+          if (bucket_ends[b] == i + 1) {
+            i++;
+            continue;
+          }
+          for (; i < bucket_ends[b]; i++) {
+            size_t num_bytes = outputs[i]->numel() * num_bytes_per_element;
+            std::memcpy(outputs[i]->raw_data_ptr(), buffer_ptr + offset,
+                        num_bytes);
+            offset += num_bytes;
+          }
         }
       },
       "AllReduceCoalesce(reduction=" + ReductionType2Str(red_type) + ")");
   } else {
     _latest_future = CPUStream(_stream).EnqueueTask(
       [inputs, outputs, mpi_dtype, mpi_red_op, this]() {
-        MPICallGuard mpi_guard;
-        for (size_t i = 0; i < inputs.size(); i++) {
-          void* send_buf = inputs[i]->raw_data_ptr();
-          void* recv_buf = outputs[i]->raw_data_ptr();
-          auto numel = inputs[i]->numel();
-          MPI_CALL(MPI_Allreduce(send_buf == recv_buf ? MPI_IN_PLACE : send_buf,
-                                 recv_buf, numel, mpi_dtype, mpi_red_op,
-                                 _comm));
+        std::vector<MPI_Request> requests(inputs.size());
+        {
+          MPICallGuard mpi_guard;
+          for (size_t i = 0; i < inputs.size(); i++) {
+            void* send_buf = inputs[i]->raw_data_ptr();
+            void* recv_buf = outputs[i]->raw_data_ptr();
+            auto numel = inputs[i]->numel();
+            MPI_CALL(MPI_Iallreduce(
+              send_buf == recv_buf ? MPI_IN_PLACE : send_buf, recv_buf, numel,
+              mpi_dtype, mpi_red_op, _comm, &requests[i]));
+          }
         }
+        for (auto& request : requests)
+          PollRequest(request);
       },
       "MPI_AllReduce(reduction=" + ReductionType2Str(red_type) + ")");
   }
@@ -324,7 +495,7 @@ void MPICommunicationGroupDef::Reduce(const NDArray& input, NDArray& output,
   }
   auto numel = input->numel();
   auto mpi_dtype = to_MPI_Datatype(input->dtype());
-  auto mpi_red_op = to_MPI_Op(red_type);
+  auto mpi_red_op = to_MPI_Op(red_type, input->dtype());
   _latest_future = CPUStream(_stream).EnqueueTask(
     [send_buf, recv_buf, numel, mpi_dtype, mpi_red_op, root, this]() {
       MPICallGuard mpi_guard;
@@ -376,7 +547,7 @@ void MPICommunicationGroupDef::ReduceScatter(const NDArray& input,
   void* send_buf = input->raw_data_ptr();
   void* recv_buf = output->raw_data_ptr();
   auto mpi_dtype = to_MPI_Datatype(input->dtype());
-  auto mpi_red_op = to_MPI_Op(red_type);
+  auto mpi_red_op = to_MPI_Op(red_type, input->dtype());
   _latest_future = CPUStream(_stream).EnqueueTask(
     [send_buf, recv_buf, output_size, mpi_dtype, mpi_red_op, this]() {
       MPICallGuard mpi_guard;
@@ -563,6 +734,32 @@ void MPICommunicationGroupDef::WaitRequest(MPI_Request request) {
     << "Failed to wait for the MPI request.";
 }
 
+void MPICommunicationGroupDef::PollRequest(MPI_Request& request) {
+  // Test the request instead of waiting on it, so that the global lock is
+  // released in between and other groups (e.g., the P2P ones of pipelines)
+  // can make their MPI calls while the non-blocking one is in flight.
+  // Short requests are caught by the first few tests, longer ones are
+  // tested with exponential backoff so that they do not occupy a core.
+  constexpr int kNumSpins = 16;
+  constexpr auto kMaxBackoff = std::chrono::microseconds(200);
+  auto backoff = std::chrono::microseconds(1);
+  int done = 0;
+  for (int i = 0;; i++) {
+    {
+      MPICallGuard mpi_guard;
+      MPI_CALL(MPI_Test(&request, &done, MPI_STATUS_IGNORE));
+    }
+    if (done)
+      break;
+    if (i < kNumSpins) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(backoff);
+      backoff = std::min(backoff * 2, kMaxBackoff);
+    }
+  }
+}
+
 MPICommunicationGroup&
 MPICommunicationGroup::GetOrCreate(const std::vector<int>& world_ranks,
                                    const Stream& stream) {
@@ -77,8 +77,12 @@ class MPICommunicationGroupDef : public CommunicationGroupDef {
  protected:
   static void WaitRequest(MPI_Request request);
 
+  static void PollRequest(MPI_Request& request);
+
   MPI_Comm _comm{MPI_COMM_NULL};
   std::future<void> _latest_future;
+  // max bytes of a bucket in AllReduceCoalesce (HETU_MPI_BUCKET_SIZE_MB)
+  size_t _bucket_size{0};
 };
 
 class MPICommunicationGroup final
@@ -90,7 +90,7 @@
 
 //   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
 //     input->dtype(), spec_t, "GeluCpu", [&]() {
-//       auto _future = cpu_stream.EnqueueTask(
+//       cpu_stream.PostTask(
 //       [input, output, size]() {
 //         if (input->is_contiguous() && output->is_contiguous()) {
 //           gelu_cpu<spec_t>(input->data_ptr<spec_t>(), size,
@@ -121,7 +121,7 @@
 //     return;
 //   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
 //     input->dtype(), spec_t, "GeluGradientCpu", [&]() {
-//       auto _future = cpu_stream.EnqueueTask(
+//       cpu_stream.PostTask(
 //       [input, output_grad, input_grad, size]() {
 //         if (input->is_contiguous() && output_grad->is_contiguous() && input_grad->is_contiguous()) {
 //           gelu_gradient_cpu<spec_t>(input->data_ptr<spec_t>(), output_grad->data_ptr<spec_t>(),
@@ -18,7 +18,7 @@ void ArangeCpu(double start, double step, NDArray& output, const Stream& stream)
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     output->dtype(), spec_t, "RangeCpu", [&]() {
-      auto _range_future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [start, step, output, size]() {
       range_cpu<spec_t>(
         static_cast<spec_t>(start), static_cast<spec_t>(step), size, output->data_ptr<spec_t>());
@@ -23,7 +23,7 @@ void ArraySetCpu(NDArray& data, double value, const Stream& stream) {
   }
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     data->dtype(), spec_t, "ArraySetCpu", [&]() {
-      auto _arrayset_future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [data, value, size]() {
         array_set_cpu<spec_t>(data->data_ptr<spec_t>(),
                               static_cast<spec_t>(value), size);
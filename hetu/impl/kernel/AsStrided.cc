@@ -1,98 +1,129 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/StridedCopy.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
 
 namespace hetu {
 namespace impl {
 
-template <typename spec_t>
-void asstrided_cpu(const spec_t *input, spec_t *output, size_t size,
-                   const int64_t *stride_in, const int64_t *stride_out, int ndim) {
-  for (size_t idx = 0; idx < size; ++idx) {
-    int index = 0;
-    size_t ind = idx;
-    for (int i = 0; i < ndim; i++) {
-      int tmp_index = ind / stride_out[i];
-      index += tmp_index * stride_in[i];
-      ind = ind % stride_out[i];
+namespace {
+
+inline bool maybe_overlapping_memory(const HTShape& shape, const HTStride& stride) {
+  if (!shape.empty()) {
+    std::vector<size_t> argsort(shape.size());
+    std::iota(argsort.begin(), argsort.end(), 0);
+    std::sort(
+        argsort.begin(), argsort.end(), [&](size_t i, size_t j) {
+          return stride[i] < stride[j];
+        });
+    auto max_index_in_slice = 0;
+    for (auto& i : argsort) {
+      const auto& stride_i = stride[i];
+      if (stride_i <= max_index_in_slice) {
+        return true;
+      }
+      max_index_in_slice += stride_i * (shape[i] - 1);
     }
-    output[idx] = input[index];
   }
+  return false;
 }
 
+} // namespace
+
 void AsStridedCpu(const NDArray& input, NDArray& output, const HTShape& stride,
                   const Stream& stream) {
   HT_ASSERT_CPU_DEVICE(input);
   HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT(input->dtype() == output->dtype());
   CPUStream cpu_stream(stream);
 
   size_t size = output->numel();
-  int ndim = output->ndim();
-
   if (size == 0)
     return;
-  HT_DISPATCH_FLOATING_TYPES(
-    input->dtype(), spec_t, "AsStridedCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [input, output, stride, size, ndim]() {
-        asstrided_cpu<spec_t>(
-          input->data_ptr<spec_t>(), output->data_ptr<spec_t>(), size, 
-          stride.data(), output->stride().data(), ndim);
-      },"AsStrided");     
-    });
+  cpu_stream.PostTask(
+    [input, output, stride]() {
+      StridedCopy(input->raw_data_ptr(), stride, output->raw_data_ptr(),
+                  output->stride(), output->shape(),
+                  DataType2Size(input->dtype()));
+    },"AsStrided");
   NDArray::MarkUsedBy({input, output}, stream);
 }
 
-template <typename spec_t>
-void array_zero_set_cpu(spec_t* input, size_t size) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-  for (size_t idx = 0; idx < size; ++idx) {
-    input[idx] = 0;
-  }
-}
-
-template <typename spec_t>
-void asstrided_gradient_cpu(const spec_t *input, spec_t *output, size_t size,
-                            const int64_t *stride_in, const int64_t *stride_out, int ndim) {
-  for (size_t idx = 0; idx < size; ++idx) {
-    int index = 0;
-    size_t ind = idx;
-    for (int i = 0; i < ndim; i++) {
-      int tmp_index = ind / stride_out[i];
-      index += tmp_index * stride_in[i];
-      ind = ind % stride_out[i];
-    }
-    output[index] += input[idx];
-  }
-}
-
 void AsStridedGradientCpu(const NDArray& output, NDArray& input,
                           const HTShape& stride, const Stream& stream) {
   HT_ASSERT_CPU_DEVICE(input);
   HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT(input->is_contiguous());
 
   CPUStream cpu_stream(stream);
   size_t size = output->numel();
-  int ndim = output->ndim();
-
   if (size == 0)
     return;
+  cpu_stream.PostTask(
+    [input, output, stride]() {
+      std::memset(input->raw_data_ptr(), 0,
+                  input->numel() * DataType2Size(input->dtype()));
+      // elements of input may be viewed more than once
+      StridedAccumulate(input->dtype(), output->raw_data_ptr(),
+                        output->stride(), input->raw_data_ptr(), stride,
+                        output->shape());
+    },
+    "AsStridedGradient");
+  NDArray::MarkUsedBy({output, input}, stream);
+}
+
+// In-place version of as_strided gradient: grad_input is the zero-filled
+// storage shared by the input and output views.
+void AsStridedGradientCpu(const NDArray& grad_output, NDArray& grad_input,
+                          const HTShape& out_shape, const HTStride& out_stride,
+                          const HTShape& in_shape, const HTStride& in_stride,
+                          int64_t in_storage_offset, int64_t out_storage_offset,
+                          const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(grad_input);
+  HT_ASSERT_SAME_DEVICE(grad_input, grad_output);
+  HT_ASSERT(grad_input->is_contiguous());
+  HT_ASSERT(grad_output->shape() == out_shape);
+
+  size_t out_size = numel(out_shape);
+  if (out_size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  bool in_maybe_overlap = maybe_overlapping_memory(in_shape, in_stride);
   HT_DISPATCH_FLOATING_TYPES(
-    input->dtype(), spec_t, "AsStridedGradientCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [input, output, stride, size, ndim]() {
-        array_zero_set_cpu<spec_t>(
-          input->data_ptr<spec_t>(), input->numel());
-        asstrided_gradient_cpu<spec_t>(
-          output->data_ptr<spec_t>(), input->data_ptr<spec_t>(), size, 
-          stride.data(), output->stride().data(), ndim);
-      },
-      "AsStridedGradient");     
+    grad_input->dtype(), spec_t, "AsStridedGradientCpu", [&]() {
+      cpu_stream.PostTask(
+        [grad_output, grad_input, out_shape, out_stride, in_shape, in_stride,
+         in_storage_offset, out_storage_offset, in_maybe_overlap]() {
+          spec_t* base = grad_input->data_ptr<spec_t>();
+          StridedAccumulate(grad_input->dtype(), grad_output->raw_data_ptr(),
+                            grad_output->stride(), base + out_storage_offset,
+                            out_stride, out_shape);
+          if (in_maybe_overlap) {
+            // average over the input elements sharing a storage location
+            std::vector<spec_t> count(grad_input->numel(), spec_t(0));
+            spec_t one = 1;
+            StridedAccumulate(grad_input->dtype(), &one,
+                              HTStride(in_shape.size(), 0),
+                              count.data() + in_storage_offset, in_stride,
+                              in_shape);
+            for (size_t i = 0; i < count.size(); ++i)
+              if (static_cast<float>(count[i]) > 0)
+                base[i] = base[i] / count[i];
+          }
+        },
+        "AsStridedGradient");
     });
-  NDArray::MarkUsedBy({output, input}, stream);
+  NDArray::MarkUsedBy({grad_input, grad_output}, stream);
+
+  auto output_meta = NDArrayMeta().set_dtype(grad_input->dtype())
+                                  .set_shape(in_shape)
+                                  .set_stride(in_stride)
+                                  .set_device(grad_input->device());
+  grad_input = NDArray(output_meta, grad_input->storage(), in_storage_offset);
 }
 
 } // namespace impl
@@ -22,13 +22,13 @@ void BatchNormCpu(const NDArray& input_X, const NDArray& bn_scale,
   HT_ASSERT_SAME_DEVICE(input_X, save_var);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
 
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_X->dtype(), spec_t, "BatchNormCuda", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
-        [eng, input_X, bn_scale, bn_bias,
+        cpu_stream.PostTask(
+        [stream, input_X, bn_scale, bn_bias,
          output_Y, save_mean, save_var, momentum, eps]() {
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_X->dtype());
         auto src_md = dnnl::memory::desc(input_X->shape(), dnnltype, input_X->stride());
         auto dst_md = dnnl::memory::desc(output_Y->shape(), dnnltype, output_Y->stride());
@@ -39,15 +39,20 @@ void BatchNormCpu(const NDArray& input_X, const NDArray& bn_scale,
         auto scale_mem = dnnl::memory(scaleshift_md, eng, bn_scale->data_ptr<spec_t>());
         auto shift_mem = dnnl::memory(scaleshift_md, eng, bn_bias->data_ptr<spec_t>());
 
-        auto bnorm_pd = dnnl::batch_normalization_forward::primitive_desc(eng,
-                dnnl::prop_kind::forward_training, src_md, dst_md, float(eps),
-                dnnl::normalization_flags::use_scale | dnnl::normalization_flags::use_shift);
-
-        auto mean_mem = dnnl::memory(bnorm_pd.mean_desc(), eng, save_mean->data_ptr<spec_t>());
-        auto variance_mem = dnnl::memory(bnorm_pd.variance_desc(), eng, save_var->data_ptr<spec_t>());
-        auto workspace_mem = dnnl::memory(bnorm_pd.workspace_desc(), eng);
-
-        auto bnorm_prim = dnnl::batch_normalization_forward(bnorm_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("BatchNorm")
+                     .Add(src_md, dst_md, float(eps));
+        auto bnorm_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::batch_normalization_forward::primitive_desc(eng,
+                  dnnl::prop_kind::forward_training, src_md, dst_md, float(eps),
+                  dnnl::normalization_flags::use_scale | dnnl::normalization_flags::use_shift);
+        });
+
+        // Mean and variance are the 2nd and 3rd outputs of batch normalization.
+        auto mean_md = bnorm_prim.pd.query_md(dnnl::query::dst_md, 1);
+        auto variance_md = bnorm_prim.pd.query_md(dnnl::query::dst_md, 2);
+        auto mean_mem = dnnl::memory(mean_md, eng, save_mean->data_ptr<spec_t>());
+        auto variance_mem = dnnl::memory(variance_md, eng, save_var->data_ptr<spec_t>());
+        auto workspace_mem = dnnl::memory(bnorm_prim.pd.workspace_desc(), eng);
 
         std::unordered_map<int, dnnl::memory> bnorm_args;
         bnorm_args.insert({DNNL_ARG_SRC, src_mem});
@@ -58,7 +63,7 @@ void BatchNormCpu(const NDArray& input_X, const NDArray& bn_scale,
         bnorm_args.insert({DNNL_ARG_WORKSPACE, workspace_mem});
         bnorm_args.insert({DNNL_ARG_DST, dst_mem});
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         bnorm_prim.execute(engine_stream, bnorm_args);
         engine_stream.wait();
       },
@@ -85,12 +90,12 @@ void BatchNormGradientCpu(const NDArray& gradient_Y, const NDArray& input_X,
   HT_ASSERT_SAME_DEVICE(gradient_Y, save_var);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_X->dtype(), spec_t, "BatchNormGradientCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
-        [eng, gradient_Y, input_X, bn_scale, gradient_X,
+        cpu_stream.PostTask(
+        [stream, gradient_Y, input_X, bn_scale, gradient_X,
          gradient_bn_scale, gradient_bn_bias, save_mean, save_var, eps]() {
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_X->dtype());
         auto src_md = dnnl::memory::desc(input_X->shape(), dnnltype, dnnl::memory::format_tag::nchw);
         auto gdst_md = dnnl::memory::desc(gradient_Y->shape(), dnnltype, dnnl::memory::format_tag::nchw);
@@ -108,17 +113,18 @@ void BatchNormGradientCpu(const NDArray& gradient_Y, const NDArray& input_X,
         auto gbias_mem = dnnl::memory(scaleshift_md, eng, gradient_bn_bias->data_ptr<spec_t>());
 
         // Create primitive descriptor.
-        auto bnorm_pd = dnnl::batch_normalization_forward::primitive_desc(eng,
-                dnnl::prop_kind::forward_training, src_md, gdst_md, float(eps),
-                dnnl::normalization_flags::use_scale | dnnl::normalization_flags::use_shift);
-
-        auto bnorm_bwd_pd = dnnl::batch_normalization_backward::primitive_desc(eng,
-                dnnl::prop_kind::backward, src_md, gdst_md, src_md, float(eps),
-                dnnl::normalization_flags::use_scale | dnnl::normalization_flags::use_shift, bnorm_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("BatchNormGradient")
+                     .Add(src_md, gdst_md, float(eps));
+        auto bnorm_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          auto bnorm_pd = dnnl::batch_normalization_forward::primitive_desc(eng,
+                  dnnl::prop_kind::forward_training, src_md, gdst_md, float(eps),
+                  dnnl::normalization_flags::use_scale | dnnl::normalization_flags::use_shift);
+          return dnnl::batch_normalization_backward::primitive_desc(eng,
+                  dnnl::prop_kind::backward, src_md, gdst_md, src_md, float(eps),
+                  dnnl::normalization_flags::use_scale | dnnl::normalization_flags::use_shift, bnorm_pd);
+        });
         
-        auto workspace_mem = dnnl::memory(bnorm_bwd_pd.workspace_desc(), eng);
-
-        auto bnorm_prim = dnnl::batch_normalization_backward(bnorm_bwd_pd);
+        auto workspace_mem = dnnl::memory(bnorm_prim.pd.workspace_desc(), eng);
 
         std::unordered_map<int, dnnl::memory> bnorm_args;
         bnorm_args.insert({DNNL_ARG_SRC, src_mem});
@@ -131,7 +137,7 @@ void BatchNormGradientCpu(const NDArray& gradient_Y, const NDArray& input_X,
         bnorm_args.insert({DNNL_ARG_DIFF_DST, gdst_mem});
         bnorm_args.insert({DNNL_ARG_DIFF_SRC, gsrc_mem});
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         bnorm_prim.execute(engine_stream, bnorm_args);
         engine_stream.wait();
       },
@@ -1,5 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
 #include "hetu/impl/stream/CPUStream.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/dnnl_utils.h"
@@ -18,6 +19,9 @@ void binary_const_cpu(const spec_t* input, spec_t value, size_t size,
 template <typename spec_t>
 void add_const_cpu(const spec_t* input, spec_t value, size_t size,
                    spec_t* output) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (size_t idx = 0; idx < size; idx++)
     output[idx] = value + input[idx];
 }
@@ -25,6 +29,9 @@ void add_const_cpu(const spec_t* input, spec_t value, size_t size,
 template <typename spec_t>
 void sub_const_cpu(const spec_t* input, spec_t value, size_t size,
                    spec_t* output) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (size_t idx = 0; idx < size; idx++)
     output[idx] = input[idx] - value;
 }
@@ -32,6 +39,9 @@ void sub_const_cpu(const spec_t* input, spec_t value, size_t size,
 template <typename spec_t>
 void mul_const_cpu(const spec_t* input, spec_t value, size_t size,
                    spec_t* output) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (size_t idx = 0; idx < size; idx++)
     output[idx] = value * input[idx];
 }
@@ -39,6 +49,9 @@ void mul_const_cpu(const spec_t* input, spec_t value, size_t size,
 template <typename spec_t>
 void div_const_cpu(const spec_t* input, spec_t value, size_t size,
                    spec_t* output) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
   for (size_t idx = 0; idx < size; idx++)
     output[idx] = input[idx] / value;
 }
@@ -64,11 +77,18 @@ void AddConstCpu(const NDArray& input, double value,
   size_t size = input->numel();
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
   input->dtype(), spec_t, "AddConstCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
       [stream, input, output, value, size]() {
-        add_const_cpu<spec_t>(
-          input->data_ptr<spec_t>(), static_cast<spec_t>(value), size, 
-          output->data_ptr<spec_t>());
+        if (IsVectorizedFloatingType(input->dtype())) {
+          GetVectorizedKernels().add_const(
+            input->dtype(), input->data_ptr<spec_t>(),
+            static_cast<float>(static_cast<spec_t>(value)),
+            output->data_ptr<spec_t>(), size);
+        } else {
+          add_const_cpu<spec_t>(
+            input->data_ptr<spec_t>(), static_cast<spec_t>(value), size,
+            output->data_ptr<spec_t>());
+        }
     },
     "AddConst");
   });
@@ -82,11 +102,18 @@ void SubConstCpu(const NDArray& input, double value,
   size_t size = input->numel();
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
   input->dtype(), spec_t, "SubConstCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
       [stream, input, output, value, size]() {
-        sub_const_cpu<spec_t>(
-          input->data_ptr<spec_t>(), static_cast<spec_t>(value), size, 
-          output->data_ptr<spec_t>());
+        if (IsVectorizedFloatingType(input->dtype())) {
+          GetVectorizedKernels().add_const(
+            input->dtype(), input->data_ptr<spec_t>(),
+            -static_cast<float>(static_cast<spec_t>(value)),
+            output->data_ptr<spec_t>(), size);
+        } else {
+          sub_const_cpu<spec_t>(
+            input->data_ptr<spec_t>(), static_cast<spec_t>(value), size,
+            output->data_ptr<spec_t>());
+        }
     },
     "SubConst");
   });
@@ -100,11 +127,18 @@ void MulConstCpu(const NDArray& input, double value,
   size_t size = input->numel();
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
   input->dtype(), spec_t, "MulConstCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
       [stream, input, output, value, size]() {
-        mul_const_cpu<spec_t>(
-          input->data_ptr<spec_t>(), static_cast<spec_t>(value), size, 
-          output->data_ptr<spec_t>());
+        if (IsVectorizedFloatingType(input->dtype())) {
+          GetVectorizedKernels().mul_const(
+            input->dtype(), input->data_ptr<spec_t>(),
+            static_cast<float>(static_cast<spec_t>(value)),
+            output->data_ptr<spec_t>(), size);
+        } else {
+          mul_const_cpu<spec_t>(
+            input->data_ptr<spec_t>(), static_cast<spec_t>(value), size,
+            output->data_ptr<spec_t>());
+        }
     },
     "MulConst");
   });
@@ -118,11 +152,18 @@ void DivConstCpu(const NDArray& input, double value,
   size_t size = input->numel();
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
   input->dtype(), spec_t, "DivConstCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
       [stream, input, output, value, size]() {
-        div_const_cpu<spec_t>(
-          input->data_ptr<spec_t>(), static_cast<spec_t>(value), size, 
-          output->data_ptr<spec_t>());
+        if (IsVectorizedFloatingType(input->dtype())) {
+          GetVectorizedKernels().div_const(
+            input->dtype(), input->data_ptr<spec_t>(),
+            static_cast<float>(static_cast<spec_t>(value)),
+            output->data_ptr<spec_t>(), size);
+        } else {
+          div_const_cpu<spec_t>(
+            input->data_ptr<spec_t>(), static_cast<spec_t>(value), size,
+            output->data_ptr<spec_t>());
+        }
     },
     "DivConst");
   });
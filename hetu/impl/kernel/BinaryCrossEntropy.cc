@@ -89,7 +89,7 @@ void BinaryCrossEntropyCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "BinaryCrossEntropyCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, loss, n_rows]() {
       if (pred->is_contiguous() && label->is_contiguous() && loss->is_contiguous()) {
         binary_cross_entropy_cpu(pred->data_ptr<spec_t>(),
@@ -129,7 +129,7 @@ void BinaryCrossEntropyGradientCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "BinaryCrossEntropyGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, grad_loss, output, n_rows]() {
       if (pred->is_contiguous() && label->is_contiguous() && grad_loss->is_contiguous()) {
         binary_cross_entropy_gradient_cpu(
@@ -51,10 +51,10 @@ void BinaryElewiseToolCpu(const NDArray& inputA, const NDArray& inputB,
 
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     inputA->dtype(), spec_t, "BinaryElewiseCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-        [inputA, inputB, output, A_dims, A_stride,
+      cpu_stream.PostTask(
+        [stream, inputA, inputB, output, A_dims, A_stride,
          B_dims, B_stride, out_strides, op]() {
-          dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+          auto& eng = hetu::cpu::GetDNNLEngine();
           auto dnnltype = hetu::cpu::dtype_to_dnnltype(inputA->dtype());
           auto src_A_md = dnnl::memory::desc(A_dims, dnnltype, A_stride);
           auto src_B_md = dnnl::memory::desc(B_dims, dnnltype, B_stride);
@@ -65,18 +65,19 @@ void BinaryElewiseToolCpu(const NDArray& inputA, const NDArray& inputB,
           auto src_B_mem = dnnl::memory(src_B_md, eng, inputB->data_ptr<spec_t>());
           auto dst_mem = dnnl::memory(dst_md, eng, output->data_ptr<spec_t>());
 
-          auto binary_pd = dnnl::binary::primitive_desc(eng, op,
-                  src_A_md, src_B_md, dst_md);
-
-          // Create the primitive.
-          auto binary_prim = dnnl::binary(binary_pd);
+          auto key = hetu::cpu::DNNLPrimitiveKey("Binary")
+                     .Add(op, src_A_md, src_B_md, dst_md);
+          auto binary_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+            return dnnl::binary::primitive_desc(eng, op,
+                    src_A_md, src_B_md, dst_md);
+          });
 
           // Primitive arguments. Set up in-place execution by assigning src_0 as DST.
           std::unordered_map<int, dnnl::memory> binary_args;
           binary_args.insert({DNNL_ARG_SRC_0, src_A_mem});
           binary_args.insert({DNNL_ARG_SRC_1, src_B_mem});
           binary_args.insert({DNNL_ARG_DST, dst_mem});
-          dnnl::stream engine_stream(eng);
+          auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
           binary_prim.execute(engine_stream, binary_args);
           engine_stream.wait();
         },
@@ -61,7 +61,7 @@ void BoolCpu(const NDArray& input, NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "BoolCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, size]() {
       if (input->is_contiguous() && output->is_contiguous()) {
         bool_cpu<spec_t>(
@@ -33,7 +33,6 @@ void BroadcastCpu(const NDArray& input, NDArray& output, const Stream& stream) {
   HT_ASSERT_SAME_DEVICE(input, output);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
 
   size_t size = output->numel();
   size_t input_size = input->numel();
@@ -41,7 +40,7 @@ void BroadcastCpu(const NDArray& input, NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "BroadcastCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, input_size, size]() {
       broadcast_cpu<spec_t>(input->data_ptr<spec_t>(), input_size, size,
                             output->data_ptr<spec_t>());
@@ -57,7 +56,6 @@ void BroadcastGradientCpu(const NDArray& input, NDArray& output,
   HT_ASSERT_SAME_DEVICE(input, output);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
 
   size_t size = output->numel();
   size_t input_size = input->numel();
@@ -65,7 +63,7 @@ void BroadcastGradientCpu(const NDArray& input, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "BroadcastGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, input_size, size]() {
       broadcast_gradient_cpu<spec_t>(input->data_ptr<spec_t>(), input_size,
                                      size, output->data_ptr<spec_t>());
@@ -66,7 +66,7 @@ void BroadcastShapeCpu(const NDArray& input, NDArray& output,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "BroadcastShapeCpu", [&]() {
-      cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, output, out_strides, in_dims, output_dim, size]() {
           broadcast_shape_cpu<spec_t>(
             input->data_ptr<spec_t>(), output->data_ptr<spec_t>(),
@@ -138,7 +138,7 @@ void BroadcastShapeMulCpu(const NDArray& input, double const_value,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "BroadcastShapeMulCpu", [&]() {
-      cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, output, out_strides, const_value, in_dims, output_dim, size]() {
           broadcast_shape_mul_cpu<spec_t>(
             input->data_ptr<spec_t>(), static_cast<spec_t>(const_value),
@@ -0,0 +1,124 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/core/stream.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include "hetu/impl/utils/common_utils.h"
+#include <atomic>
+#include <cmath>
+
+namespace hetu {
+namespace impl {
+
+namespace {
+
+inline bool is_finite_value(double x) {
+  return std::isfinite(x);
+}
+
+template <typename spec_t>
+inline bool is_finite_value(spec_t x) {
+  return std::isfinite(static_cast<float>(x));
+}
+
+// Flags of CheckNumeric, in the order of its output.
+constexpr int kFoundNaN = 1;
+constexpr int kFoundNegInf = 2;
+constexpr int kFoundPosInf = 4;
+
+template <typename spec_t>
+inline int numeric_flags(spec_t x) {
+  if (is_finite_value(x))
+    return 0;
+  float value = static_cast<float>(x);
+  if (std::isnan(value))
+    return kFoundNaN;
+  return value < 0 ? kFoundNegInf : kFoundPosInf;
+}
+
+// ORs `flags(x)` over all elements of `input`. Chunks stop early once
+// every flag in `stop_mask` has been found.
+template <typename spec_t, typename Flags>
+int reduce_flags_cpu(const NDArray& input, Flags&& flags, int stop_mask) {
+  const spec_t* ptr = input->data_ptr<spec_t>();
+  const bool contiguous = input->is_contiguous();
+  const int64_t ndim = input->ndim();
+  const int64_t* stride = input->stride().data();
+  const int64_t* shape = input->shape().data();
+  std::atomic<int> found{0};
+  CPUParallelFor(0, input->numel(), kCPUParallelGrainSize,
+                 [&](int64_t begin, int64_t end) {
+    if ((found.load(std::memory_order_relaxed) & stop_mask) == stop_mask)
+      return;
+    int local = 0;
+    if (contiguous) {
+      for (int64_t idx = begin; idx < end; idx++)
+        local |= flags(ptr[idx]);
+    } else {
+      for (int64_t idx = begin; idx < end; idx++)
+        local |= flags(ptr[get_index(idx, ndim, stride, shape)]);
+    }
+    found.fetch_or(local, std::memory_order_relaxed);
+  });
+  return found.load();
+}
+
+} // namespace
+
+// Writes 1 to output[0] if any element of input is NaN or infinite, and 0
+// otherwise.
+void CheckFiniteCpu(const NDArray& input, NDArray& output,
+                    const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(input);
+  HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT(output->dtype() == kFloat32)
+    << "Output of CheckFinite must be float32, got " << output->dtype();
+
+  size_t size = input->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
+    input->dtype(), spec_t, "CheckFiniteCpu", [&]() {
+      cpu_stream.PostTask(
+        [input, output]() {
+          int found = reduce_flags_cpu<spec_t>(
+            input, [](spec_t x) { return is_finite_value(x) ? 0 : 1; }, 1);
+          output->data_ptr<float>()[0] = found ? 1.f : 0.f;
+        },
+        "CheckFinite");
+    });
+  NDArray::MarkUsedBy({input, output}, stream);
+}
+
+// Writes whether input contains NaN, -inf and +inf to output[0], output[1]
+// and output[2], respectively.
+void CheckNumericCpu(const NDArray& input, NDArray& output,
+                     const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(input);
+  HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT(output->dtype() == kFloat32 && output->numel() == 3)
+    << "Output of CheckNumeric must be 3 float32 values, got "
+    << output->dtype() << " of shape " << output->shape();
+
+  size_t size = input->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
+    input->dtype(), spec_t, "CheckNumericCpu", [&]() {
+      cpu_stream.PostTask(
+        [input, output]() {
+          int found = reduce_flags_cpu<spec_t>(
+            input, [](spec_t x) { return numeric_flags(x); },
+            kFoundNaN | kFoundNegInf | kFoundPosInf);
+          float* out = output->data_ptr<float>();
+          out[0] = (found & kFoundNaN) ? 1.f : 0.f;
+          out[1] = (found & kFoundNegInf) ? 1.f : 0.f;
+          out[2] = (found & kFoundPosInf) ? 1.f : 0.f;
+        },
+        "CheckNumeric");
+    });
+  NDArray::MarkUsedBy({input, output}, stream);
+}
+
+} // namespace impl
+} // namespace hetu
@@ -15,10 +15,9 @@ __global__ void check_finite_kernel(const spec_t* input, size_t size, float* out
   if (idx >= size)
     return;
   auto in_offset = in_offset_calculator->get(idx);
+  // only report found values, other threads may have found one
   if (!isfinite(float(input[in_offset])))
     output[0] = 1.f;
-  else 
-    output[0] = 0.f;
 }
 
 void CheckFiniteCuda(const NDArray& input, NDArray& output, const Stream& stream) {
@@ -41,6 +40,10 @@ void CheckFiniteCuda(const NDArray& input, NDArray& output, const Stream& stream
     AllocOffsetCalculator(output, stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "CheckFiniteCuda", [&]() {
+      launch_loop_kernel<float>(output, 1, stream,
+                                [=] __device__ (int /*idx*/) -> float {
+                                  return 0.f;
+                                });
       check_finite_kernel<spec_t><<<blocks, threads, 0, cuda_stream>>>(
         input->data_ptr<spec_t>(), size, output->data_ptr<float>(),
         in_offset_calculator);
@@ -58,7 +58,6 @@ void ConcatCpu(const NDArray& inputA, const NDArray& inputB, NDArray& output,
   HT_ASSERT_SAME_DEVICE(inputA, output);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
 
   size_t size = output->numel();
   size_t offset1 = inputA->shape(axis);
@@ -74,26 +73,29 @@ void ConcatCpu(const NDArray& inputA, const NDArray& inputB, NDArray& output,
 
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     inputA->dtype(), spec_t, "ConcatCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [inputA, inputB, output, axis, eng]() {
+      cpu_stream.PostTask(
+      [stream, inputA, inputB, output, axis]() {
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(inputA->dtype());
         auto srcA_md = dnnl::memory::desc(inputA->shape(), dnnltype, inputA->stride());
         auto srcB_md = dnnl::memory::desc(inputB->shape(), dnnltype, inputB->stride());
         auto srcA_mem = dnnl::memory(srcA_md, eng, inputA->data_ptr<spec_t>());
         auto srcB_mem = dnnl::memory(srcB_md, eng, inputB->data_ptr<spec_t>());
       
-        auto concat_pd = dnnl::concat::primitive_desc(eng, axis, {srcA_md, srcB_md});
+        auto key = hetu::cpu::DNNLPrimitiveKey("Concat")
+                   .Add(axis, srcA_md, srcB_md);
+        auto concat_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::concat::primitive_desc(eng, axis, {srcA_md, srcB_md});
+        });
 
-        auto dst_mem = dnnl::memory(concat_pd.dst_desc(), eng, output->data_ptr<spec_t>());
-
-        auto concat_prim = dnnl::concat(concat_pd);
+        auto dst_mem = dnnl::memory(concat_prim.pd.dst_desc(), eng, output->data_ptr<spec_t>());
 
         std::unordered_map<int, dnnl::memory> concat_args;
         concat_args.insert({DNNL_ARG_MULTIPLE_SRC, srcA_mem});
         concat_args.insert({DNNL_ARG_MULTIPLE_SRC + 1, srcB_mem});
         concat_args.insert({DNNL_ARG_DST, dst_mem});
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         concat_prim.execute(engine_stream, concat_args);
         engine_stream.wait();
       },
@@ -109,7 +111,6 @@ void ConcatGradientCpu(const NDArray& output_grad, NDArray& input_grad,
   HT_ASSERT_SAME_DEVICE(output_grad, input_grad);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
 
   size_t size = input_grad->numel();
   size_t big_offset = output_grad->shape(axis);
@@ -126,7 +127,7 @@ void ConcatGradientCpu(const NDArray& output_grad, NDArray& input_grad,
 
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_grad->dtype(), spec_t, "ConcatGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [output_grad, input_grad, size, concat_size, concat_offset, small_offset, big_offset]() {
       Concat_gradient_cpu<spec_t>(output_grad->data_ptr<spec_t>(), size,
                                   concat_size, concat_offset, small_offset,
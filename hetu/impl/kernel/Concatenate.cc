@@ -47,7 +47,7 @@ void ConcatenateCpu(const NDArrayList& inputs, NDArray& output, size_t axis,
   HT_ASSERT_CPU_DEVICE(output);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+  auto& eng = hetu::cpu::GetDNNLEngine();
 
   for (size_t i = 0; i < inputs.size(); ++i)
     HT_ASSERT_SAME_DEVICE(inputs[i], output);
@@ -67,23 +67,25 @@ void ConcatenateCpu(const NDArrayList& inputs, NDArray& output, size_t axis,
       }
 
       // Create primitive descriptor.
-      auto concat_pd = dnnl::concat::primitive_desc(eng, axis, src_mds);
+      auto key = hetu::cpu::DNNLPrimitiveKey("Concatenate")
+                 .Add(axis, src_mds);
+      auto concat_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        return dnnl::concat::primitive_desc(eng, axis, src_mds);
+      });
 
       // Create destination (dst) memory object using the memory descriptor
       // created by the primitive.
-      auto dst_mem = dnnl::memory(concat_pd.dst_desc(), eng, output->data_ptr<spec_t>());
+      auto dst_mem = dnnl::memory(concat_prim.pd.dst_desc(), eng, output->data_ptr<spec_t>());
 
-      // Create the primitive.
-      auto concat_prim = dnnl::concat(concat_pd);
 
       // Primitive arguments.
       std::unordered_map<int, dnnl::memory> concat_args;
       for (size_t i = 0; i < inputs.size(); ++i)
           concat_args.insert({DNNL_ARG_MULTIPLE_SRC + i, src_mems[i]});
       concat_args.insert({DNNL_ARG_DST, dst_mem});
-      auto _future = cpu_stream.EnqueueTask(
-      [concat_prim, concat_args, eng]() {
-        dnnl::stream engine_stream(eng);
+      cpu_stream.PostTask(
+      [stream, concat_prim, concat_args]() {
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         concat_prim.execute(engine_stream, concat_args);
         engine_stream.wait();
       },
@@ -99,7 +101,6 @@ void ConcatenateGradientCpu(const NDArray& output_grad, NDArray& input_grad,
   HT_ASSERT_SAME_DEVICE(output_grad, input_grad);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
 
   size_t size = input_grad->numel();
   size_t now_ndim = output_grad->ndim();
@@ -122,7 +123,7 @@ void ConcatenateGradientCpu(const NDArray& output_grad, NDArray& input_grad,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_grad->dtype(), spec_t, "ConcatenateGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [output_grad, input_grad, input_width, output_width, offset, concat_size, size]() {
       concatenate_gradient_cpu<spec_t>(
         output_grad->data_ptr<spec_t>(), input_grad->data_ptr<spec_t>(),
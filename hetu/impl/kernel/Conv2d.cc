@@ -15,13 +15,13 @@ void Conv2dCpu(const NDArray& input_x, const NDArray& input_f, NDArray& output,
   HT_ASSERT_SAME_DEVICE(input_x, output);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
 
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_x->dtype(), spec_t, "Conv2dCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [input_x, input_f, output, eng, 
-      padding_h, padding_w, stride_h, stride_w]() {
+      cpu_stream.PostTask(
+      [input_x, input_f, output,
+      stream, padding_h, padding_w, stride_h, stride_w]() {
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_x->dtype());
         auto conv_src_md = dnnl::memory::desc(input_x->shape(), dnnltype, 
                                               dnnl::memory::format_tag::nchw);
@@ -40,13 +40,15 @@ void Conv2dCpu(const NDArray& input_x, const NDArray& input_f, NDArray& output,
         dnnl::memory::dims padding_dims_r = {int(padding_h), int(padding_w)};
 
         // Create primitive descriptor.
-        auto conv_pd = dnnl::convolution_forward::primitive_desc(eng,
-                dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
-                conv_src_md, conv_weights_md, conv_dst_md,
-                strides_dims, padding_dims_l, padding_dims_r);
-
-        // Create the primitive.
-        auto conv_prim = dnnl::convolution_forward(conv_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Conv2d")
+                   .Add(conv_src_md, conv_weights_md, conv_dst_md,
+                        strides_dims, padding_dims_l, padding_dims_r);
+        auto conv_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::convolution_forward::primitive_desc(eng,
+                  dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
+                  conv_src_md, conv_weights_md, conv_dst_md,
+                  strides_dims, padding_dims_l, padding_dims_r);
+        });
 
         // Primitive arguments.
         std::unordered_map<int, dnnl::memory> conv_args;
@@ -54,7 +56,7 @@ void Conv2dCpu(const NDArray& input_x, const NDArray& input_f, NDArray& output,
         conv_args.insert({DNNL_ARG_WEIGHTS, conv_weights_mem});
         conv_args.insert({DNNL_ARG_DST, conv_dst_mem});
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         conv_prim.execute(engine_stream, conv_args);
         engine_stream.wait();
       },
@@ -73,12 +75,12 @@ void Conv2dGradientofFilterCpu(const NDArray& input_x,
   HT_ASSERT_SAME_DEVICE(input_x, gradient_f);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0); 
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_x->dtype(), spec_t, "Conv2dGradientofFilterCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [input_x, gradient_y, gradient_f, eng,
-      padding_h, padding_w, stride_h, stride_w]() {
+      cpu_stream.PostTask(
+      [input_x, gradient_y, gradient_f,
+      stream, padding_h, padding_w, stride_h, stride_w]() {
+      auto& eng = hetu::cpu::GetDNNLEngine();
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_x->dtype());
       auto conv_src_md = dnnl::memory::desc(input_x->shape(), dnnltype, 
                                             dnnl::memory::format_tag::nchw);
@@ -96,18 +98,19 @@ void Conv2dGradientofFilterCpu(const NDArray& input_x,
       dnnl::memory::dims padding_dims_r = {int(padding_h), int(padding_w)};
 
       // Create primitive descriptor.
-      auto conv_pd = dnnl::convolution_forward::primitive_desc(eng,
-              dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
-              conv_src_md, conv_weights_md, conv_dst_md,
-              strides_dims, padding_dims_l, padding_dims_r);
-      
-      auto conv_bwd_pd = dnnl::convolution_backward_weights::primitive_desc(eng,
-              dnnl::algorithm::convolution_direct,
-              conv_src_md, conv_dst_md, conv_weights_md,
-              strides_dims, padding_dims_l, padding_dims_r, conv_pd);
-
-      // Create the primitive.
-      auto conv_prim = dnnl::convolution_backward_weights(conv_bwd_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("Conv2dGradientofFilter")
+                 .Add(conv_src_md, conv_weights_md, conv_dst_md,
+                      strides_dims, padding_dims_l, padding_dims_r);
+      auto conv_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        auto conv_pd = dnnl::convolution_forward::primitive_desc(eng,
+                dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
+                conv_src_md, conv_weights_md, conv_dst_md,
+                strides_dims, padding_dims_l, padding_dims_r);
+        return dnnl::convolution_backward_weights::primitive_desc(eng,
+                dnnl::algorithm::convolution_direct,
+                conv_src_md, conv_dst_md, conv_weights_md,
+                strides_dims, padding_dims_l, padding_dims_r, conv_pd);
+      });
 
       // Primitive arguments.
       std::unordered_map<int, dnnl::memory> conv_args;
@@ -115,7 +118,7 @@ void Conv2dGradientofFilterCpu(const NDArray& input_x,
       conv_args.insert({DNNL_ARG_DIFF_WEIGHTS, conv_weights_mem});
       conv_args.insert({DNNL_ARG_DIFF_DST, conv_dst_mem});
 
-      dnnl::stream engine_stream(eng);
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       conv_prim.execute(engine_stream, conv_args);   
       engine_stream.wait();      
       },
@@ -133,12 +136,12 @@ void Conv2dGradientofDataCpu(const NDArray& input_f, const NDArray& gradient_y,
   HT_ASSERT_SAME_DEVICE(input_f, gradient_x);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_f->dtype(), spec_t, "Conv2dGradientofDataCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
-      [input_f, gradient_y, gradient_x, eng,
-      padding_h, padding_w, stride_h, stride_w]() {
+    cpu_stream.PostTask(
+      [input_f, gradient_y, gradient_x,
+      stream, padding_h, padding_w, stride_h, stride_w]() {
+      auto& eng = hetu::cpu::GetDNNLEngine();
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_f->dtype());
       auto conv_src_md = dnnl::memory::desc(gradient_x->shape(), dnnltype, 
                                             dnnl::memory::format_tag::nchw);
@@ -156,18 +159,19 @@ void Conv2dGradientofDataCpu(const NDArray& input_f, const NDArray& gradient_y,
       dnnl::memory::dims padding_dims_r = {int(padding_h), int(padding_w)};
 
       // Create primitive descriptor.
-      auto conv_pd = dnnl::convolution_forward::primitive_desc(eng,
-              dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
-              conv_src_md, conv_weights_md, conv_dst_md,
-              strides_dims, padding_dims_l, padding_dims_r);
-      
-      auto conv_bwd_pd = dnnl::convolution_backward_data::primitive_desc(eng,
-              dnnl::algorithm::convolution_direct,
-              conv_src_md, conv_weights_md, conv_dst_md,
-              strides_dims, padding_dims_l, padding_dims_r, conv_pd);
-
-      // Create the primitive.
-      auto conv_prim = dnnl::convolution_backward_data(conv_bwd_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("Conv2dGradientofData")
+                 .Add(conv_src_md, conv_weights_md, conv_dst_md,
+                      strides_dims, padding_dims_l, padding_dims_r);
+      auto conv_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        auto conv_pd = dnnl::convolution_forward::primitive_desc(eng,
+                dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
+                conv_src_md, conv_weights_md, conv_dst_md,
+                strides_dims, padding_dims_l, padding_dims_r);
+        return dnnl::convolution_backward_data::primitive_desc(eng,
+                dnnl::algorithm::convolution_direct,
+                conv_src_md, conv_weights_md, conv_dst_md,
+                strides_dims, padding_dims_l, padding_dims_r, conv_pd);
+      });
 
       // Primitive arguments.
       std::unordered_map<int, dnnl::memory> conv_args;
@@ -175,7 +179,7 @@ void Conv2dGradientofDataCpu(const NDArray& input_f, const NDArray& gradient_y,
       conv_args.insert({DNNL_ARG_WEIGHTS, conv_weights_mem});
       conv_args.insert({DNNL_ARG_DIFF_DST, conv_dst_mem});
 
-      dnnl::stream engine_stream(eng);
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       conv_prim.execute(engine_stream, conv_args);         
       },
       "Conv2dData");
@@ -194,12 +198,12 @@ void Conv2dAddBiasCpu(const NDArray& input_x, const NDArray& input_f,
   HT_ASSERT_SAME_DEVICE(input_x, output);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_x->dtype(), spec_t, "Conv2dAddBiasCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
-      [input_x, input_f, output, bias, eng, 
-      padding_h, padding_w, stride_h, stride_w]() {
+    cpu_stream.PostTask(
+      [input_x, input_f, output, bias,
+      stream, padding_h, padding_w, stride_h, stride_w]() {
+      auto& eng = hetu::cpu::GetDNNLEngine();
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_x->dtype());
       auto conv_src_md = dnnl::memory::desc(input_x->shape(), dnnltype, 
                                             dnnl::memory::format_tag::nchw);
@@ -220,13 +224,15 @@ void Conv2dAddBiasCpu(const NDArray& input_x, const NDArray& input_f,
       dnnl::memory::dims padding_dims_r = {int(padding_h), int(padding_w)};
 
       // Create primitive descriptor.
-      auto conv_pd = dnnl::convolution_forward::primitive_desc(eng,
-              dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
-              conv_src_md, conv_weights_md, conv_bias_md, conv_dst_md,
-              strides_dims, padding_dims_l, padding_dims_r);
-
-      // Create the primitive.
-      auto conv_prim = dnnl::convolution_forward(conv_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("Conv2dAddBias")
+                 .Add(conv_src_md, conv_weights_md, conv_bias_md, conv_dst_md,
+                      strides_dims, padding_dims_l, padding_dims_r);
+      auto conv_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        return dnnl::convolution_forward::primitive_desc(eng,
+                dnnl::prop_kind::forward_training, dnnl::algorithm::convolution_direct,
+                conv_src_md, conv_weights_md, conv_bias_md, conv_dst_md,
+                strides_dims, padding_dims_l, padding_dims_r);
+      });
 
       // Primitive arguments.
       std::unordered_map<int, dnnl::memory> conv_args;
@@ -235,7 +241,7 @@ void Conv2dAddBiasCpu(const NDArray& input_x, const NDArray& input_f,
       conv_args.insert({DNNL_ARG_BIAS, conv_bias_mem});
       conv_args.insert({DNNL_ARG_DST, conv_dst_mem});
 
-      dnnl::stream engine_stream(eng);
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       conv_prim.execute(engine_stream, conv_args); 
       },
       "Conv2dBias");
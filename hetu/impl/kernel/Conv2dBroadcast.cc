@@ -35,7 +35,7 @@ void Conv2dBroadcastCpu(const NDArray& input, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "Conv2dBroadcastCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, input_size, output_size, size]() {
       conv2d_broadcast_cpu<spec_t>(input->data_ptr<spec_t>(),
                                    output->data_ptr<spec_t>(), input_size,
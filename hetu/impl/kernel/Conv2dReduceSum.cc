@@ -40,7 +40,7 @@ void Conv2dReduceSumCpu(const NDArray& input, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "Conv2dReduceCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, input_size, output_size, batch_size]() {
       conv2d_reduce_cpu<spec_t>(input->data_ptr<spec_t>(),
                                 output->data_ptr<spec_t>(), input_size,
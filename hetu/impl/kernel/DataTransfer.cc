@@ -1,5 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/StridedCopy.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/ndarray_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
@@ -21,19 +22,44 @@ void DataTransferCpu(const NDArray& from, NDArray& to, const Stream& stream) {
     return;
   }
   CPUStream cpu_stream(stream);
-  auto _future = cpu_stream.EnqueueTask(
+  cpu_stream.PostTask(
   [from, to, to_ptr, from_ptr, numel]() {
+    bool packed = from->dtype() == kFloat4 || from->dtype() == kNFloat4;
+    bool contiguous = from->is_contiguous() && to->is_contiguous();
     if (from->dtype() == to->dtype()) {
-      memcpy(to_ptr, from_ptr, (from->dtype() == kFloat4 || from->dtype() == kNFloat4)
-                               ? ((numel + 1) / 2) * DataType2Size(from->dtype())
-                               : numel * DataType2Size(from->dtype()));
+      if (contiguous || packed) {
+        memcpy(to_ptr, from_ptr, packed
+                                 ? ((numel + 1) / 2) * DataType2Size(from->dtype())
+                                 : numel * DataType2Size(from->dtype()));
+      } else {
+        StridedCopy(from_ptr, from->stride(), to_ptr, to->stride(),
+                    from->shape(), DataType2Size(from->dtype()));
+      }
     } else {
+      // convert between contiguous buffers, staging strided sides
+      std::vector<uint8_t> from_buf, to_buf;
+      const void* src = from_ptr;
+      void* dst = to_ptr;
+      if (!from->is_contiguous()) {
+        from_buf.resize(numel * DataType2Size(from->dtype()));
+        StridedCopy(from_ptr, from->stride(), from_buf.data(),
+                    Shape2Stride(from->shape()), from->shape(),
+                    DataType2Size(from->dtype()));
+        src = from_buf.data();
+      }
+      if (!to->is_contiguous()) {
+        to_buf.resize(numel * DataType2Size(to->dtype()));
+        dst = to_buf.data();
+      }
       HT_DISPATCH_PAIRED_SIGNED_INTEGER_AND_FLOATING_TYPES(
         from->dtype(), to->dtype(), spec_a_t, spec_b_t, "DataTransferCpu", [&]() {
-          auto* typed_from_ptr = reinterpret_cast<spec_a_t*>(from_ptr);
-          auto* typed_to_ptr = reinterpret_cast<spec_b_t*>(to_ptr);
+          auto* typed_from_ptr = reinterpret_cast<const spec_a_t*>(src);
+          auto* typed_to_ptr = reinterpret_cast<spec_b_t*>(dst);
           std::copy(typed_from_ptr, typed_from_ptr + numel, typed_to_ptr);
         });
+      if (!to->is_contiguous())
+        StridedCopy(to_buf.data(), Shape2Stride(to->shape()), to_ptr,
+                    to->stride(), to->shape(), DataType2Size(to->dtype()));
     }
   },
   "DataTransfer");
@@ -61,7 +61,7 @@ void DiagonalCpu(const NDArray& input, NDArray& output, int dim1, int dim2,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "DiagonalCpu", [&]() {
-    auto _binary_future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
       [input, output, size, strideA, strideB,
         strideC, dim1, dim2, dim_len, offset]() {
         diagonal_cpu<spec_t>(input->data_ptr<spec_t>(), size, strideA, strideB,
@@ -131,7 +131,7 @@ void DiagonalGradientCpu(const NDArray& input, NDArray& output, int dim1,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "DiagonalGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, size, strideA, strideB, strideC, dim_len]() {
               diagonal_gradient_cpu<spec_t>(input->data_ptr<spec_t>(), size, strideA,
                                     strideB, strideC, dim_len,
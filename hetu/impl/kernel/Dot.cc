@@ -35,7 +35,7 @@ void DotCpu(const NDArray& inputA, const NDArray& inputB, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     inputA->dtype(), spec_t, "DotCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [inputA, inputB, output, size]() {
       dot_cpu<spec_t>(inputA->data_ptr<spec_t>(), inputB->data_ptr<spec_t>(),
                       size, output->data_ptr<spec_t>());
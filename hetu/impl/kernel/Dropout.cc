@@ -0,0 +1,151 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/core/stream.h"
+#include "hetu/impl/random/CPURandomState.h"
+#include "hetu/impl/random/Philox.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include "hetu/impl/utils/common_utils.h"
+
+namespace hetu {
+namespace impl {
+
+namespace {
+
+inline int64_t element_offset(bool contiguous, const NDArray& arr,
+                              int64_t idx) {
+  return contiguous
+    ? idx
+    : get_index(idx, arr->ndim(), arr->stride().data(), arr->shape().data());
+}
+
+// Calls `f(idx, keep)` for every element. Element `idx` is kept iff the
+// uniform value at `idx` of the Philox stream is no less than `drop_rate`,
+// so the mask can be recomputed from the random state alone.
+template <typename F>
+void dropout_mask_cpu(size_t size, float drop_rate, CPURandomState rand_state,
+                      F&& f) {
+  Philox4x32 philox(rand_state.seed, rand_state.offset);
+  CPUParallelFor(0, size, kCPUParallelGrainSize,
+                 [&](int64_t begin, int64_t end) {
+    PhiloxForRange(
+      begin, end, [&](uint64_t block) { return PhiloxUniform4(philox(block)); },
+      [&](uint64_t idx, float value) { f(idx, value >= drop_rate); });
+  });
+}
+
+inline double dropout_scale(double drop_rate) {
+  return drop_rate < 1 ? 1.0 / (1 - drop_rate) : 0.0;
+}
+
+} // namespace
+
+void DropoutCpu(const NDArray& input, double drop_rate, uint64_t seed,
+                NDArray& output, NDArray& mask, const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(input);
+  HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT_SAME_DEVICE(input, mask);
+  HT_ASSERT_SAME_SHAPE(input, output);
+  HT_ASSERT_SAME_SHAPE(input, mask);
+  HT_ASSERT(mask->dtype() == kBool)
+    << "Dropout mask must be bool, got " << mask->dtype();
+  size_t size = input->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  CPURandomState rand_state = GetCPURandomState(seed, 4);
+  HT_DISPATCH_FLOATING_TYPES(input->dtype(), spec_t, "DropoutCpu", [&]() {
+    cpu_stream.PostTask(
+      [input, output, mask, size, drop_rate, rand_state]() {
+        const spec_t* in = input->data_ptr<spec_t>();
+        spec_t* out = output->data_ptr<spec_t>();
+        bool* mask_ptr = mask->data_ptr<bool>();
+        const spec_t scale = static_cast<spec_t>(dropout_scale(drop_rate));
+        const bool contiguous = input->is_contiguous() &&
+          output->is_contiguous() && mask->is_contiguous();
+        dropout_mask_cpu(size, drop_rate, rand_state,
+                         [&](int64_t idx, bool keep) {
+          out[element_offset(contiguous, output, idx)] =
+            keep ? in[element_offset(contiguous, input, idx)] * scale
+                 : spec_t(0);
+          mask_ptr[element_offset(contiguous, mask, idx)] = keep;
+        });
+      },
+      "Dropout");
+  });
+  NDArray::MarkUsedBy({input, output, mask}, stream);
+}
+
+void DropoutGradientCpu(const NDArray& grad, const NDArray& fw_mask,
+                        double drop_rate, NDArray& output,
+                        const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(grad);
+  HT_ASSERT_SAME_DEVICE(grad, fw_mask);
+  HT_ASSERT_SAME_DEVICE(grad, output);
+  HT_ASSERT_SAME_SHAPE(grad, fw_mask);
+  HT_ASSERT_SAME_SHAPE(grad, output);
+  HT_ASSERT(fw_mask->dtype() == kBool)
+    << "Dropout mask must be bool, got " << fw_mask->dtype();
+  size_t size = grad->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_FLOATING_TYPES(grad->dtype(), spec_t, "DropoutGradientCpu", [&]() {
+    cpu_stream.PostTask(
+      [grad, fw_mask, output, size, drop_rate]() {
+        const spec_t* grad_ptr = grad->data_ptr<spec_t>();
+        const bool* mask_ptr = fw_mask->data_ptr<bool>();
+        spec_t* out = output->data_ptr<spec_t>();
+        const spec_t scale = static_cast<spec_t>(dropout_scale(drop_rate));
+        const bool contiguous = grad->is_contiguous() &&
+          fw_mask->is_contiguous() && output->is_contiguous();
+        CPUParallelFor(0, size, kCPUParallelGrainSize,
+                       [&](int64_t begin, int64_t end) {
+          for (int64_t idx = begin; idx < end; idx++)
+            out[element_offset(contiguous, output, idx)] =
+              mask_ptr[element_offset(contiguous, fw_mask, idx)]
+              ? grad_ptr[element_offset(contiguous, grad, idx)] * scale
+              : spec_t(0);
+        });
+      },
+      "DropoutGradient");
+  });
+  NDArray::MarkUsedBy({grad, fw_mask, output}, stream);
+}
+
+// Recomputes the mask of DropoutCpu called with the same seed instead of
+// keeping it alive until the backward pass.
+void DropoutGradientWithRecomputationCpu(const NDArray& grad, double drop_rate,
+                                         uint64_t seed, NDArray& output,
+                                         const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(grad);
+  HT_ASSERT_SAME_DEVICE(grad, output);
+  HT_ASSERT_SAME_SHAPE(grad, output);
+  HT_ASSERT(seed != 0)
+    << "Dropout mask can only be recomputed from the seed of the forward pass";
+  size_t size = grad->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  CPURandomState rand_state = GetCPURandomState(seed, 4);
+  HT_DISPATCH_FLOATING_TYPES(
+    grad->dtype(), spec_t, "DropoutGradientWithRecomputationCpu", [&]() {
+      cpu_stream.PostTask(
+        [grad, output, size, drop_rate, rand_state]() {
+          const spec_t* grad_ptr = grad->data_ptr<spec_t>();
+          spec_t* out = output->data_ptr<spec_t>();
+          const spec_t scale = static_cast<spec_t>(dropout_scale(drop_rate));
+          const bool contiguous =
+            grad->is_contiguous() && output->is_contiguous();
+          dropout_mask_cpu(size, drop_rate, rand_state,
+                           [&](int64_t idx, bool keep) {
+            out[element_offset(contiguous, output, idx)] =
+              keep ? grad_ptr[element_offset(contiguous, grad, idx)] * scale
+                   : spec_t(0);
+          });
+        },
+        "DropoutGradientWithRecomputation");
+    });
+  NDArray::MarkUsedBy({grad, output}, stream);
+}
+
+} // namespace impl
+} // namespace hetu
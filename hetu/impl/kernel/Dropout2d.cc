@@ -0,0 +1,121 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/core/stream.h"
+#include "hetu/impl/random/CPURandomState.h"
+#include "hetu/impl/random/Philox.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include "hetu/impl/utils/common_utils.h"
+#include <algorithm>
+
+namespace hetu {
+namespace impl {
+
+namespace {
+
+inline int64_t element_offset(bool contiguous, const NDArray& arr,
+                              int64_t idx) {
+  return contiguous
+    ? idx
+    : get_index(idx, arr->ndim(), arr->stride().data(), arr->shape().data());
+}
+
+inline double dropout_scale(double drop_rate) {
+  return drop_rate < 1 ? 1.0 / (1 - drop_rate) : 0.0;
+}
+
+} // namespace
+
+// Drops whole channels of an [N, C, H, W] input: channel `c` (in N * C
+// order) is kept iff the uniform value at `c` of the Philox stream is no
+// less than `drop_rate`.
+void Dropout2dCpu(const NDArray& input, double drop_rate, uint64_t seed,
+                  NDArray& output, NDArray& mask, const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(input);
+  HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT_SAME_DEVICE(input, mask);
+  HT_ASSERT_SAME_SHAPE(input, output);
+  HT_ASSERT_SAME_SHAPE(input, mask);
+  HT_ASSERT(input->ndim() == 4)
+    << "Dropout2d requires a 4-D input, got " << input->shape();
+  HT_ASSERT(mask->dtype() == kBool)
+    << "Dropout mask must be bool, got " << mask->dtype();
+  size_t size = input->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  CPURandomState rand_state = GetCPURandomState(seed, 4);
+  HT_DISPATCH_FLOATING_TYPES(input->dtype(), spec_t, "Dropout2dCpu", [&]() {
+    cpu_stream.PostTask(
+      [input, output, mask, drop_rate, rand_state]() {
+        const spec_t* in = input->data_ptr<spec_t>();
+        spec_t* out = output->data_ptr<spec_t>();
+        bool* mask_ptr = mask->data_ptr<bool>();
+        const spec_t scale = static_cast<spec_t>(dropout_scale(drop_rate));
+        const bool contiguous = input->is_contiguous() &&
+          output->is_contiguous() && mask->is_contiguous();
+        const int64_t channels = input->shape(0) * input->shape(1);
+        const int64_t channel_size = input->shape(2) * input->shape(3);
+        Philox4x32 philox(rand_state.seed, rand_state.offset);
+        CPUParallelFor(
+          0, channels,
+          std::max<int64_t>(1, kCPUParallelGrainSize / channel_size),
+          [&](int64_t begin, int64_t end) {
+            PhiloxForRange(
+              begin, end,
+              [&](uint64_t block) { return PhiloxUniform4(philox(block)); },
+              [&](uint64_t channel, float value) {
+                bool keep = value >= drop_rate;
+                for (int64_t idx = channel * channel_size;
+                     idx < static_cast<int64_t>(channel + 1) * channel_size;
+                     idx++) {
+                  out[element_offset(contiguous, output, idx)] =
+                    keep ? in[element_offset(contiguous, input, idx)] * scale
+                         : spec_t(0);
+                  mask_ptr[element_offset(contiguous, mask, idx)] = keep;
+                }
+              });
+          });
+      },
+      "Dropout2d");
+  });
+  NDArray::MarkUsedBy({input, output, mask}, stream);
+}
+
+void Dropout2dGradientCpu(const NDArray& grad, const NDArray& fw_mask,
+                          double drop_rate, NDArray& output,
+                          const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(grad);
+  HT_ASSERT_SAME_DEVICE(grad, output);
+  HT_ASSERT_SAME_DEVICE(grad, fw_mask);
+  HT_ASSERT_SAME_SHAPE(grad, output);
+  HT_ASSERT_SAME_SHAPE(grad, fw_mask);
+  HT_ASSERT(fw_mask->dtype() == kBool)
+    << "Dropout mask must be bool, got " << fw_mask->dtype();
+  size_t size = grad->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_FLOATING_TYPES(grad->dtype(), spec_t, "Dropout2dGradientCpu", [&]() {
+    cpu_stream.PostTask(
+      [grad, fw_mask, output, size, drop_rate]() {
+        const spec_t* grad_ptr = grad->data_ptr<spec_t>();
+        const bool* mask_ptr = fw_mask->data_ptr<bool>();
+        spec_t* out = output->data_ptr<spec_t>();
+        const spec_t scale = static_cast<spec_t>(dropout_scale(drop_rate));
+        const bool contiguous = grad->is_contiguous() &&
+          fw_mask->is_contiguous() && output->is_contiguous();
+        CPUParallelFor(0, size, kCPUParallelGrainSize,
+                       [&](int64_t begin, int64_t end) {
+          for (int64_t idx = begin; idx < end; idx++)
+            out[element_offset(contiguous, output, idx)] =
+              mask_ptr[element_offset(contiguous, fw_mask, idx)]
+              ? grad_ptr[element_offset(contiguous, grad, idx)] * scale
+              : spec_t(0);
+        });
+      },
+      "Dropout2dGradient");
+  });
+  NDArray::MarkUsedBy({grad, fw_mask, output}, stream);
+}
+
+} // namespace impl
+} // namespace hetu
@@ -119,8 +119,8 @@ void Dropout2dGradientCuda(const NDArray& grad, const NDArray& fw_mask,
   std::tie(out_offset_calculator_arr, out_offset_calculator) = 
     AllocOffsetCalculator(output, stream);
   HT_DISPATCH_FLOATING_TYPES(grad->dtype(), spec_t, "Dropout2dGradientCuda", [&]() {
-    dropout2d_gradient_kernel<spec_t><<<blocks, threads, 0, cuda_stream>>>(
-      grad->data_ptr<spec_t>(), fw_mask->data_ptr<spec_t>(),
+    dropout2d_gradient_kernel<spec_t, bool><<<blocks, threads, 0, cuda_stream>>>(
+      grad->data_ptr<spec_t>(), fw_mask->data_ptr<bool>(),
       output->data_ptr<spec_t>(), static_cast<float>(drop_rate), size,
       grad_offset_calculator, fw_mask_offset_calculator,
       out_offset_calculator);
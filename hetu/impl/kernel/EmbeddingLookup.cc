@@ -3,6 +3,8 @@
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/omp_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
+#include <algorithm>
+#include <vector>
 
 namespace hetu {
 namespace impl {
@@ -27,29 +29,153 @@ void embedding_lookup_cpu(const spec_t* input, const int64_t* ids, size_t size,
   }
 }
 
+// Sorts `order` with `cmp`, which must be a strict total order so that the
+// result does not depend on the number of threads. Chunks are sorted in
+// parallel and then merged pairwise.
+template <typename Compare>
+static void parallel_sort_cpu(std::vector<size_t>& order, Compare cmp) {
+  constexpr size_t kMinChunkSize = 16384;
+  size_t num_chunks = std::min<size_t>(omp::OMP_GET_NUM_THREADS(),
+                                       order.size() / kMinChunkSize);
+  if (num_chunks <= 1) {
+    std::sort(order.begin(), order.end(), cmp);
+    return;
+  }
+  std::vector<size_t> bounds(num_chunks + 1);
+  for (size_t c = 0; c <= num_chunks; ++c)
+    bounds[c] = order.size() * c / num_chunks;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (size_t c = 0; c < num_chunks; ++c)
+    std::sort(order.begin() + bounds[c], order.begin() + bounds[c + 1], cmp);
+  for (size_t width = 1; width < num_chunks; width *= 2) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (size_t c = 0; c < num_chunks; c += 2 * width) {
+      size_t mid = std::min(c + width, num_chunks);
+      size_t end = std::min(c + 2 * width, num_chunks);
+      std::inplace_merge(order.begin() + bounds[c], order.begin() + bounds[mid],
+                         order.begin() + bounds[end], cmp);
+    }
+  }
+}
+
+// Groups the valid ids by value. `order` holds the positions of the valid ids
+// sorted by (id, position), so that the rows of each id are always reduced in
+// the same order, and `segments` holds the offset in `order` at which each
+// unique id starts, followed by the size of `order`.
+static void group_ids_cpu(const int64_t* ids, size_t num_ids, size_t input_row,
+                          std::vector<size_t>& order,
+                          std::vector<size_t>& segments) {
+  order.clear();
+  order.reserve(num_ids);
+  for (size_t idx = 0; idx < num_ids; ++idx) {
+    if (ids[idx] >= 0 && ids[idx] < (int64_t) input_row)
+      order.push_back(idx);
+  }
+  parallel_sort_cpu(order, [ids](size_t a, size_t b) {
+    return ids[a] < ids[b] || (ids[a] == ids[b] && a < b);
+  });
+  segments.clear();
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || ids[order[i]] != ids[order[i - 1]])
+      segments.push_back(i);
+  }
+  segments.push_back(order.size());
+}
+
+// Segments with more rows than this are reduced with the columns split across
+// threads, so that a few hot ids do not leave the other threads idle.
+constexpr size_t kHeavySegmentRows = 1024;
+constexpr size_t kSegmentColumnBlock = 16;
+
+template <typename spec_t>
+void reduce_segment_cpu(const spec_t* output_grad, const size_t* positions,
+                        size_t num_positions, size_t length, size_t col_begin,
+                        size_t col_end, spec_t* dst) {
+  const spec_t* src = output_grad + length * positions[0];
+  for (size_t i = col_begin; i < col_end; i++)
+    dst[i] = src[i];
+  for (size_t p = 1; p < num_positions; p++) {
+    src = output_grad + length * positions[p];
+    for (size_t i = col_begin; i < col_end; i++)
+      dst[i] += src[i];
+  }
+}
+
+// Writes the sum of the rows of each unique id to its row of `input_grad`.
 template <typename spec_t>
-void array_zero_set_cpu(spec_t* input, size_t size) {
+void reduce_segments_cpu(const spec_t* output_grad, const int64_t* ids,
+                         const std::vector<size_t>& order,
+                         const std::vector<size_t>& segments, size_t length,
+                         spec_t* input_grad) {
+  size_t num_unique = segments.size() - 1;
+  auto dst_row = [&](size_t s) {
+    return input_grad + length * ids[order[segments[s]]];
+  };
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+  for (size_t s = 0; s < num_unique; ++s) {
+    size_t num_positions = segments[s + 1] - segments[s];
+    if (num_positions > kHeavySegmentRows)
+      continue;
+    reduce_segment_cpu(output_grad, order.data() + segments[s], num_positions,
+                       length, 0, length, dst_row(s));
+  }
+  size_t num_blocks = DIVUP(length, kSegmentColumnBlock);
+  for (size_t s = 0; s < num_unique; ++s) {
+    size_t num_positions = segments[s + 1] - segments[s];
+    if (num_positions <= kHeavySegmentRows)
+      continue;
 #ifdef _OPENMP
 #pragma omp parallel for schedule(static)
 #endif
-  for (size_t idx = 0; idx < size; ++idx) {
-    input[idx] = 0;
+    for (size_t b = 0; b < num_blocks; ++b) {
+      reduce_segment_cpu(output_grad, order.data() + segments[s],
+                         num_positions, length, b * kSegmentColumnBlock,
+                         std::min(length, (b + 1) * kSegmentColumnBlock),
+                         dst_row(s));
+    }
   }
 }
 
+// Duplicate ids are reduced per unique id before being written, so the
+// gradient is race-free and does not depend on the number of threads.
+// Every row of `input_grad` is written exactly once: rows of the ids are
+// set to their sums and the others to zero.
 template <typename spec_t>
 void embedding_lookup_gradient_cpu(const spec_t* output_grad, const int64_t* ids,
-                                   size_t size, size_t length,
-                                   spec_t* input_grad) {
+                                   size_t num_ids, size_t length,
+                                   size_t input_row, spec_t* input_grad) {
+  std::vector<size_t> order, segments;
+  group_ids_cpu(ids, num_ids, input_row, order, segments);
+  size_t num_unique = segments.size() - 1;
+  std::vector<int64_t> unique_ids(num_unique);
+  for (size_t s = 0; s < num_unique; ++s)
+    unique_ids[s] = ids[order[segments[s]]];
+
+  constexpr size_t kZeroBlockRows = 4096;
+  size_t num_blocks = DIVUP(input_row, kZeroBlockRows);
 #ifdef _OPENMP
 #pragma omp parallel for schedule(static)
 #endif
-  for (size_t idx = 0; idx < size / length; ++idx) {
-    int id = int(ids[idx]);
-    for (size_t i = 0; i < length; i++) {
-      input_grad[length * id + i] +=  output_grad[length * idx + i];
+  for (size_t b = 0; b < num_blocks; ++b) {
+    int64_t row = b * kZeroBlockRows;
+    int64_t row_end = std::min(input_row, (b + 1) * kZeroBlockRows);
+    auto it = std::lower_bound(unique_ids.begin(), unique_ids.end(), row);
+    for (; row < row_end; ++row) {
+      if (it != unique_ids.end() && *it == row) {
+        ++it;
+        continue;
+      }
+      std::fill(input_grad + length * row, input_grad + length * (row + 1),
+                spec_t(0));
     }
   }
+  reduce_segments_cpu(output_grad, ids, order, segments, length, input_grad);
 }
 
 void EmbeddingLookupCpu(const NDArray& input, const NDArray& id,
@@ -76,7 +202,7 @@ void EmbeddingLookupCpu(const NDArray& input, const NDArray& id,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "EmbbedingLookupCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, id, output, size, length, input_row]() {
       embedding_lookup_cpu(input->data_ptr<spec_t>(), id->data_ptr<int64_t>(),
                            size, length, input_row, output->data_ptr<spec_t>());
@@ -103,17 +229,18 @@ void EmbeddingLookupGradientCpu(const NDArray& output_grad, const NDArray& id,
       HT_ASSERT(input_grad->shape(1) == output_grad->shape(i));
     }
   }
+  size_t input_row = input_grad->shape(0);
   size_t length = input_grad->shape(1);
   size_t size = input_grad->numel();
   if (size == 0 || length == 0)
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
-    input_grad->dtype(), spec_t, "EmbeddingLookupGradientCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [input_grad, output_grad, id, size, length]() {
-      array_zero_set_cpu(input_grad->data_ptr<spec_t>(), size);
+    input_grad->dtype(), spec_t, "EmbeddingLookupGradientCpu", [&]() {
+      cpu_stream.PostTask(
+      [input_grad, output_grad, id, input_row, length]() {
       embedding_lookup_gradient_cpu(output_grad->data_ptr<spec_t>(),
-                                    id->data_ptr<int64_t>(), output_grad->numel(), length,
+                                    id->data_ptr<int64_t>(), id->numel(),
+                                    length, input_row,
                                     input_grad->data_ptr<spec_t>());
       },
       "EmbbedingLookupGradient");  
@@ -1,7 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
 #include "hetu/impl/utils/common_utils.h"
-#include "hetu/impl/utils/omp_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
 #include <cmath>
 
@@ -10,37 +9,37 @@ namespace impl {
 
 template <typename spec_t>
 void exp_cpu(const spec_t* input, size_t size, spec_t* output) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-  for (size_t idx = 0; idx < size; idx++)
-    output[idx] = std::exp(input[idx]);
+  CPUParallelFor(0, size, kCPUParallelGrainSize,
+                 [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; idx++)
+      output[idx] = std::exp(input[idx]);
+  });
 }
 
 template <typename spec_t>
 void exp_cpu(const spec_t* input, size_t size, spec_t* output,
                           int64_t ndims, const int64_t* stride, const int64_t* c_shape) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-  for (size_t idx = 0; idx < size; idx++) {
-    int64_t i_idx = hetu::impl::get_index(idx, ndims, stride, c_shape);
-    output[i_idx] = std::exp(input[i_idx]);
-  }
+  CPUParallelFor(0, size, kCPUParallelGrainSize,
+                 [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; idx++) {
+      int64_t i_idx = hetu::impl::get_index(idx, ndims, stride, c_shape);
+      output[i_idx] = std::exp(input[i_idx]);
+    }
+  });
 }
 
 template <typename spec_t>
 void exp_cpu(const spec_t* input, size_t size, spec_t* output,
              int64_t ndims, const int64_t* stride, const int64_t* stride_out,
              const int64_t* c_shape) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-  for (size_t idx = 0; idx < size; idx++) {
-    int64_t i_idx = hetu::impl::get_index(idx, ndims, stride, c_shape);
-    int64_t o_idx = hetu::impl::get_index(idx, ndims, stride_out, c_shape);
-    output[o_idx] = std::exp(input[i_idx]);
-  }
+  CPUParallelFor(0, size, kCPUParallelGrainSize,
+                 [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; idx++) {
+      int64_t i_idx = hetu::impl::get_index(idx, ndims, stride, c_shape);
+      int64_t o_idx = hetu::impl::get_index(idx, ndims, stride_out, c_shape);
+      output[o_idx] = std::exp(input[i_idx]);
+    }
+  });
 }
 
 void ExpCpu(const NDArray& input, NDArray& output, const Stream& stream) {
@@ -55,7 +54,7 @@ void ExpCpu(const NDArray& input, NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "ExpCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, size]() {
       if (input->is_contiguous() && output->is_contiguous()) {
         exp_cpu<spec_t>(input->data_ptr<spec_t>(), size,
@@ -30,7 +30,7 @@ void EyeCpu(NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     output->dtype(), spec_t, "EyeCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [output, size, ncols]() {
       eye_cpu<spec_t>(
         output->data_ptr<spec_t>(), size, ncols);
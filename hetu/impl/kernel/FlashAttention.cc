@@ -0,0 +1,583 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/core/stream.h"
+#include "hetu/impl/utils/common_utils.h"
+#include "hetu/impl/utils/omp_utils.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace hetu {
+namespace impl {
+
+/******************************************************
+ * Memory-efficient attention on CPU.
+ *
+ * Queries are processed in blocks of kAttnBlockQ rows against blocks of
+ * kAttnBlockK keys with an online softmax, so that only one block of scores
+ * per thread is alive at a time, never the seqlen_q x seqlen_k matrix. Like
+ * FlashAttention, the forward pass saves the log-sum-exp of each row, from
+ * which the backward pass recomputes the probabilities block by block.
+ *
+ * Inputs are [batch_size, seqlen, num_heads, head_dim], or packed
+ * [total, num_heads, head_dim] with cu_seqlens for the varlen kernels. Causal
+ * masks are aligned to the bottom right corner, i.e. query i of a sequence
+ * attends to keys j <= i + seqlen_k - seqlen_q. All math is done in float.
+ ******************************************************/
+
+constexpr int64_t kAttnBlockQ = 64;
+constexpr int64_t kAttnBlockK = 64;
+
+struct AttnShape {
+  int64_t batch_size;
+  int64_t num_heads;
+  int64_t num_heads_k;
+  int64_t head_dim;
+  // the (maximum) sequence lengths, the former is also the row stride of
+  // softmax_lse
+  int64_t seqlen_q;
+  int64_t seqlen_k;
+  // prefix sums of the sequence lengths, nullptr if not packed
+  const int* cu_seqlens_q;
+  const int* cu_seqlens_k;
+  float softmax_scale;
+  bool is_causal;
+
+  // first token and length of the queries and keys of a sequence
+  inline void seq(int64_t b, int64_t& q_begin, int64_t& len_q,
+                  int64_t& k_begin, int64_t& len_k) const {
+    if (cu_seqlens_q == nullptr) {
+      q_begin = b * seqlen_q;
+      len_q = seqlen_q;
+      k_begin = b * seqlen_k;
+      len_k = seqlen_k;
+    } else {
+      q_begin = cu_seqlens_q[b];
+      len_q = cu_seqlens_q[b + 1] - q_begin;
+      k_begin = cu_seqlens_k[b];
+      len_k = cu_seqlens_k[b + 1] - k_begin;
+    }
+  }
+
+  // number of leading keys that query i of a sequence attends to
+  inline int64_t visible_keys(int64_t i, int64_t len_q, int64_t len_k) const {
+    if (!is_causal)
+      return len_k;
+    return std::max<int64_t>(0, std::min(len_k, i + len_k - len_q + 1));
+  }
+};
+
+// y[0, n) += a * x[0, n)
+static inline void axpy(float a, const float* x, float* y, int64_t n) {
+  for (int64_t i = 0; i < n; ++i)
+    y[i] += a * x[i];
+}
+
+// Loads `rows` rows of one head into float, as [rows, head_dim] or as the
+// transposed [head_dim, ld] when `transpose` is set.
+template <typename spec_t>
+static inline void load_head_rows(const spec_t* base, int64_t row_stride,
+                                  int64_t rows, int64_t head_dim, float scale,
+                                  bool transpose, int64_t ld, float* dst) {
+  for (int64_t r = 0; r < rows; ++r) {
+    const spec_t* src = base + r * row_stride;
+    if (transpose) {
+      for (int64_t d = 0; d < head_dim; ++d)
+        dst[d * ld + r] = static_cast<float>(src[d]) * scale;
+    } else {
+      for (int64_t d = 0; d < head_dim; ++d)
+        dst[r * head_dim + d] = static_cast<float>(src[d]) * scale;
+    }
+  }
+}
+
+template <typename spec_t>
+void flash_attn_fwd_cpu(const spec_t* q, const spec_t* k, const spec_t* v,
+                        spec_t* out, float* softmax_lse, const AttnShape& s) {
+  const int64_t D = s.head_dim;
+  const int64_t q_row = s.num_heads * D, k_row = s.num_heads_k * D;
+  const int64_t group = s.num_heads / s.num_heads_k;
+  const int64_t num_q_blocks = (s.seqlen_q + kAttnBlockQ - 1) / kAttnBlockQ;
+  const int64_t num_tasks = s.batch_size * s.num_heads * num_q_blocks;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<float> q_block(kAttnBlockQ * D), k_block(D * kAttnBlockK),
+      v_block(kAttnBlockK * D), acc(kAttnBlockQ * D), scores(kAttnBlockK),
+      row_max(kAttnBlockQ), row_sum(kAttnBlockQ);
+    // causal blocks differ in cost, hence the dynamic schedule
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int64_t task = 0; task < num_tasks; ++task) {
+      const int64_t qb = task % num_q_blocks;
+      const int64_t h = (task / num_q_blocks) % s.num_heads;
+      const int64_t b = task / num_q_blocks / s.num_heads;
+      int64_t q_begin, len_q, k_begin, len_k;
+      s.seq(b, q_begin, len_q, k_begin, len_k);
+      const int64_t q0 = qb * kAttnBlockQ;
+      if (q0 >= len_q)
+        continue;
+      const int64_t nq = std::min(kAttnBlockQ, len_q - q0);
+      const int64_t kv_offset = (h / group) * D;
+      load_head_rows(q + (q_begin + q0) * q_row + h * D, q_row, nq, D,
+                     s.softmax_scale, false, 0, q_block.data());
+      std::fill(acc.begin(), acc.end(), 0.f);
+      std::fill(row_max.begin(), row_max.end(),
+                -std::numeric_limits<float>::infinity());
+      std::fill(row_sum.begin(), row_sum.end(), 0.f);
+
+      const int64_t k_end = s.visible_keys(q0 + nq - 1, len_q, len_k);
+      for (int64_t k0 = 0; k0 < k_end; k0 += kAttnBlockK) {
+        const int64_t nk = std::min(kAttnBlockK, k_end - k0);
+        load_head_rows(k + (k_begin + k0) * k_row + kv_offset, k_row, nk, D,
+                       1.f, true, kAttnBlockK, k_block.data());
+        load_head_rows(v + (k_begin + k0) * k_row + kv_offset, k_row, nk, D,
+                       1.f, false, 0, v_block.data());
+        for (int64_t i = 0; i < nq; ++i) {
+          const int64_t n =
+            std::min(nk, s.visible_keys(q0 + i, len_q, len_k) - k0);
+          if (n <= 0)
+            continue;
+          std::fill(scores.begin(), scores.begin() + n, 0.f);
+          for (int64_t d = 0; d < D; ++d)
+            axpy(q_block[i * D + d], k_block.data() + d * kAttnBlockK,
+                 scores.data(), n);
+          float new_max = row_max[i];
+          for (int64_t j = 0; j < n; ++j)
+            new_max = std::max(new_max, scores[j]);
+          // rescale what was accumulated under the previous maximum
+          float correction = std::exp(row_max[i] - new_max);
+          float* acc_row = acc.data() + i * D;
+          row_sum[i] *= correction;
+          for (int64_t d = 0; d < D; ++d)
+            acc_row[d] *= correction;
+          for (int64_t j = 0; j < n; ++j) {
+            float p = std::exp(scores[j] - new_max);
+            row_sum[i] += p;
+            axpy(p, v_block.data() + j * D, acc_row, D);
+          }
+          row_max[i] = new_max;
+        }
+      }
+
+      for (int64_t i = 0; i < nq; ++i) {
+        // rows without any visible key produce zeros
+        float inv_sum = row_sum[i] > 0 ? 1.f / row_sum[i] : 0.f;
+        spec_t* out_row = out + (q_begin + q0 + i) * q_row + h * D;
+        for (int64_t d = 0; d < D; ++d)
+          out_row[d] = spec_t(acc[i * D + d] * inv_sum);
+        softmax_lse[(b * s.num_heads + h) * s.seqlen_q + q0 + i] =
+          row_sum[i] > 0 ? row_max[i] + std::log(row_sum[i])
+                         : std::numeric_limits<float>::infinity();
+      }
+    }
+  }
+}
+
+// The backward pass is split in two sweeps so that every output block is
+// owned by a single task and no atomics are needed: one over query blocks
+// for dq, one over key blocks for dk and dv. Both recompute the
+// probabilities P = exp(S - lse) and dS = P * (dO V^T - rowsum(dO * O)).
+template <typename spec_t>
+void flash_attn_bwd_cpu(const spec_t* dout, const spec_t* q, const spec_t* k,
+                        const spec_t* v, const spec_t* out,
+                        const float* softmax_lse, spec_t* dq, spec_t* dk,
+                        spec_t* dv, const AttnShape& s) {
+  const int64_t D = s.head_dim;
+  const int64_t q_row = s.num_heads * D, k_row = s.num_heads_k * D;
+  const int64_t group = s.num_heads / s.num_heads_k;
+  const int64_t lse_size = s.batch_size * s.num_heads * s.seqlen_q;
+
+  // rowsum(dO * O), laid out as softmax_lse
+  std::vector<float> delta(lse_size, 0.f);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int64_t bh = 0; bh < s.batch_size * s.num_heads; ++bh) {
+    const int64_t b = bh / s.num_heads, h = bh % s.num_heads;
+    int64_t q_begin, len_q, k_begin, len_k;
+    s.seq(b, q_begin, len_q, k_begin, len_k);
+    for (int64_t i = 0; i < len_q; ++i) {
+      const spec_t* o = out + (q_begin + i) * q_row + h * D;
+      const spec_t* g = dout + (q_begin + i) * q_row + h * D;
+      float sum = 0;
+      for (int64_t d = 0; d < D; ++d)
+        sum += static_cast<float>(o[d]) * static_cast<float>(g[d]);
+      delta[bh * s.seqlen_q + i] = sum;
+    }
+  }
+
+  // dq = scale * dS K
+  const int64_t num_q_blocks = (s.seqlen_q + kAttnBlockQ - 1) / kAttnBlockQ;
+  const int64_t num_q_tasks = s.batch_size * s.num_heads * num_q_blocks;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<float> q_block(kAttnBlockQ * D), dout_block(kAttnBlockQ * D),
+      k_block(kAttnBlockK * D), kt_block(D * kAttnBlockK),
+      vt_block(D * kAttnBlockK), acc(kAttnBlockQ * D), scores(kAttnBlockK),
+      dscores(kAttnBlockK);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int64_t task = 0; task < num_q_tasks; ++task) {
+      const int64_t qb = task % num_q_blocks;
+      const int64_t h = (task / num_q_blocks) % s.num_heads;
+      const int64_t b = task / num_q_blocks / s.num_heads;
+      int64_t q_begin, len_q, k_begin, len_k;
+      s.seq(b, q_begin, len_q, k_begin, len_k);
+      const int64_t q0 = qb * kAttnBlockQ;
+      if (q0 >= len_q)
+        continue;
+      const int64_t nq = std::min(kAttnBlockQ, len_q - q0);
+      const int64_t kv_offset = (h / group) * D;
+      const int64_t lse_offset = (b * s.num_heads + h) * s.seqlen_q + q0;
+      load_head_rows(q + (q_begin + q0) * q_row + h * D, q_row, nq, D,
+                     s.softmax_scale, false, 0, q_block.data());
+      load_head_rows(dout + (q_begin + q0) * q_row + h * D, q_row, nq, D, 1.f,
+                     false, 0, dout_block.data());
+      std::fill(acc.begin(), acc.end(), 0.f);
+
+      const int64_t k_end = s.visible_keys(q0 + nq - 1, len_q, len_k);
+      for (int64_t k0 = 0; k0 < k_end; k0 += kAttnBlockK) {
+        const int64_t nk = std::min(kAttnBlockK, k_end - k0);
+        const spec_t* k_ptr = k + (k_begin + k0) * k_row + kv_offset;
+        const spec_t* v_ptr = v + (k_begin + k0) * k_row + kv_offset;
+        load_head_rows(k_ptr, k_row, nk, D, 1.f, false, 0, k_block.data());
+        load_head_rows(k_ptr, k_row, nk, D, 1.f, true, kAttnBlockK,
+                       kt_block.data());
+        load_head_rows(v_ptr, k_row, nk, D, 1.f, true, kAttnBlockK,
+                       vt_block.data());
+        for (int64_t i = 0; i < nq; ++i) {
+          const int64_t n =
+            std::min(nk, s.visible_keys(q0 + i, len_q, len_k) - k0);
+          if (n <= 0)
+            continue;
+          std::fill(scores.begin(), scores.begin() + n, 0.f);
+          std::fill(dscores.begin(), dscores.begin() + n, 0.f);
+          for (int64_t d = 0; d < D; ++d) {
+            axpy(q_block[i * D + d], kt_block.data() + d * kAttnBlockK,
+                 scores.data(), n);
+            axpy(dout_block[i * D + d], vt_block.data() + d * kAttnBlockK,
+                 dscores.data(), n);
+          }
+          const float lse = softmax_lse[lse_offset + i];
+          const float row_delta = delta[lse_offset + i];
+          float* acc_row = acc.data() + i * D;
+          for (int64_t j = 0; j < n; ++j) {
+            float p = std::exp(scores[j] - lse);
+            axpy(p * (dscores[j] - row_delta), k_block.data() + j * D,
+                 acc_row, D);
+          }
+        }
+      }
+
+      for (int64_t i = 0; i < nq; ++i) {
+        spec_t* dq_row = dq + (q_begin + q0 + i) * q_row + h * D;
+        for (int64_t d = 0; d < D; ++d)
+          dq_row[d] = spec_t(acc[i * D + d] * s.softmax_scale);
+      }
+    }
+  }
+
+  // dv = P^T dO and dk = scale * dS^T Q, summed over the query heads sharing
+  // a key head
+  const int64_t num_k_blocks = (s.seqlen_k + kAttnBlockK - 1) / kAttnBlockK;
+  const int64_t num_k_tasks = s.batch_size * s.num_heads_k * num_k_blocks;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<float> kt_block(D * kAttnBlockK), vt_block(D * kAttnBlockK),
+      dk_acc(kAttnBlockK * D), dv_acc(kAttnBlockK * D), q_row_f(D),
+      dout_row_f(D), scores(kAttnBlockK), dscores(kAttnBlockK);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int64_t task = 0; task < num_k_tasks; ++task) {
+      const int64_t kb = task % num_k_blocks;
+      const int64_t kvh = (task / num_k_blocks) % s.num_heads_k;
+      const int64_t b = task / num_k_blocks / s.num_heads_k;
+      int64_t q_begin, len_q, k_begin, len_k;
+      s.seq(b, q_begin, len_q, k_begin, len_k);
+      const int64_t k0 = kb * kAttnBlockK;
+      if (k0 >= len_k)
+        continue;
+      const int64_t nk = std::min(kAttnBlockK, len_k - k0);
+      const int64_t kv_offset = kvh * D;
+      load_head_rows(k + (k_begin + k0) * k_row + kv_offset, k_row, nk, D,
+                     1.f, true, kAttnBlockK, kt_block.data());
+      load_head_rows(v + (k_begin + k0) * k_row + kv_offset, k_row, nk, D,
+                     1.f, true, kAttnBlockK, vt_block.data());
+      std::fill(dk_acc.begin(), dk_acc.end(), 0.f);
+      std::fill(dv_acc.begin(), dv_acc.end(), 0.f);
+
+      // the first query that sees key k0 under the causal mask
+      const int64_t i_begin =
+        s.is_causal ? std::max<int64_t>(0, k0 - (len_k - len_q)) : 0;
+      for (int64_t h = kvh * group; h < (kvh + 1) * group; ++h) {
+        const int64_t lse_offset = (b * s.num_heads + h) * s.seqlen_q;
+        for (int64_t i = i_begin; i < len_q; ++i) {
+          const int64_t n =
+            std::min(nk, s.visible_keys(i, len_q, len_k) - k0);
+          if (n <= 0)
+            continue;
+          load_head_rows(q + (q_begin + i) * q_row + h * D, q_row, 1, D,
+                         s.softmax_scale, false, 0, q_row_f.data());
+          load_head_rows(dout + (q_begin + i) * q_row + h * D, q_row, 1, D,
+                         1.f, false, 0, dout_row_f.data());
+          std::fill(scores.begin(), scores.begin() + n, 0.f);
+          std::fill(dscores.begin(), dscores.begin() + n, 0.f);
+          for (int64_t d = 0; d < D; ++d) {
+            axpy(q_row_f[d], kt_block.data() + d * kAttnBlockK, scores.data(),
+                 n);
+            axpy(dout_row_f[d], vt_block.data() + d * kAttnBlockK,
+                 dscores.data(), n);
+          }
+          const float lse = softmax_lse[lse_offset + i];
+          const float row_delta = delta[lse_offset + i];
+          for (int64_t j = 0; j < n; ++j) {
+            float p = std::exp(scores[j] - lse);
+            axpy(p, dout_row_f.data(), dv_acc.data() + j * D, D);
+            axpy(p * (dscores[j] - row_delta), q_row_f.data(),
+                 dk_acc.data() + j * D, D);
+          }
+        }
+      }
+
+      for (int64_t j = 0; j < nk; ++j) {
+        spec_t* dk_row = dk + (k_begin + k0 + j) * k_row + kv_offset;
+        spec_t* dv_row = dv + (k_begin + k0 + j) * k_row + kv_offset;
+        for (int64_t d = 0; d < D; ++d) {
+          dk_row[d] = spec_t(dk_acc[j * D + d]);
+          dv_row[d] = spec_t(dv_acc[j * D + d]);
+        }
+      }
+    }
+  }
+}
+
+static inline NDArray contiguous_or_self(const NDArray& arr,
+                                         const Stream& stream) {
+  return arr->is_contiguous() ? arr
+                              : NDArray::contiguous(arr, stream.stream_index());
+}
+
+// Fills the padded copies the CUDA kernels produce for head dims that are
+// not multiples of 8, so that the op outputs look alike on both devices.
+static void pad_head_dim(const NDArray& q, const NDArray& k, const NDArray& v,
+                         const NDArray& out, NDArray& q_padded,
+                         NDArray& k_padded, NDArray& v_padded,
+                         NDArray& out_padded, const Stream& stream) {
+  const int64_t head_size_og = q->shape(q->ndim() - 1);
+  if (head_size_og % 8 != 0) {
+    HTShape pad_shape = {0, 8 - head_size_og % 8};
+    NDArray::pad(q, pad_shape, "constant", 0, stream.stream_index(), q_padded);
+    NDArray::pad(k, pad_shape, "constant", 0, stream.stream_index(), k_padded);
+    NDArray::pad(v, pad_shape, "constant", 0, stream.stream_index(), v_padded);
+    NDArray::pad(out, pad_shape, "constant", 0, stream.stream_index(),
+                 out_padded);
+  } else {
+    q_padded = q;
+    k_padded = k;
+    v_padded = v;
+    out_padded = out;
+  }
+}
+
+static void CheckAttnInputs(const NDArray& q, const NDArray& k,
+                            const NDArray& v, int64_t num_heads,
+                            int64_t num_heads_k, float p_dropout) {
+  HT_ASSERT_CPU_DEVICE(q);
+  HT_ASSERT_SAME_DEVICE(q, k);
+  HT_ASSERT_SAME_DEVICE(q, v);
+  HT_ASSERT(k->dtype() == q->dtype() && v->dtype() == q->dtype())
+    << "query, key and value must have the same dtype";
+  HT_ASSERT(num_heads % num_heads_k == 0)
+    << "Number of heads in key/value must divide number of heads in query";
+  HT_NOT_IMPLEMENTED_IF(p_dropout > 0.f)
+    << "Attention dropout is not supported on CPU yet.";
+}
+
+static void FlashAttnFwdCpuImpl(const NDArray& q, const NDArray& k,
+                                const NDArray& v, NDArray& out,
+                                NDArray& softmax_lse, const AttnShape& shape,
+                                const NDArray& cu_seqlens_q,
+                                const NDArray& cu_seqlens_k,
+                                const Stream& stream) {
+  HT_ASSERT(out->is_contiguous() && out->dtype() == q->dtype());
+  HT_ASSERT(softmax_lse->is_contiguous() && softmax_lse->dtype() == kFloat32);
+  auto q_ = contiguous_or_self(q, stream);
+  auto k_ = contiguous_or_self(k, stream);
+  auto v_ = contiguous_or_self(v, stream);
+
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_FLOATING_TYPES(q->dtype(), spec_t, "FlashAttnCpu", [&]() {
+    cpu_stream.PostTask(
+      [q_, k_, v_, out, softmax_lse, shape, cu_seqlens_q, cu_seqlens_k]() {
+        AttnShape s = shape;
+        if (cu_seqlens_q.is_defined()) {
+          s.cu_seqlens_q = cu_seqlens_q->data_ptr<int>();
+          s.cu_seqlens_k = cu_seqlens_k->data_ptr<int>();
+        }
+        flash_attn_fwd_cpu<spec_t>(
+          q_->data_ptr<spec_t>(), k_->data_ptr<spec_t>(),
+          v_->data_ptr<spec_t>(), out->data_ptr<spec_t>(),
+          softmax_lse->data_ptr<float>(), s);
+      },
+      "FlashAttn");
+  });
+  NDArray::MarkUsedBy(
+    {q_, k_, v_, out, softmax_lse, cu_seqlens_q, cu_seqlens_k}, stream);
+}
+
+static void FlashAttnBwdCpuImpl(const NDArray& dout, const NDArray& q,
+                                const NDArray& k, const NDArray& v,
+                                const NDArray& out,
+                                const NDArray& softmax_lse, NDArray& dq,
+                                NDArray& dk, NDArray& dv,
+                                const AttnShape& shape,
+                                const NDArray& cu_seqlens_q,
+                                const NDArray& cu_seqlens_k,
+                                const Stream& stream) {
+  HT_ASSERT(dout->dtype() == q->dtype() && out->dtype() == q->dtype());
+  HT_ASSERT(softmax_lse->dtype() == kFloat32);
+  HT_ASSERT(dq->is_contiguous() && dk->is_contiguous() && dv->is_contiguous())
+    << "FlashAttnGradientCpu expects contiguous gradients.";
+  auto dout_ = contiguous_or_self(dout, stream);
+  auto q_ = contiguous_or_self(q, stream);
+  auto k_ = contiguous_or_self(k, stream);
+  auto v_ = contiguous_or_self(v, stream);
+  auto out_ = contiguous_or_self(out, stream);
+  auto lse_ = contiguous_or_self(softmax_lse, stream);
+
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_FLOATING_TYPES(q->dtype(), spec_t, "FlashAttnGradientCpu", [&]() {
+    cpu_stream.PostTask(
+      [dout_, q_, k_, v_, out_, lse_, dq, dk, dv, shape, cu_seqlens_q,
+       cu_seqlens_k]() {
+        AttnShape s = shape;
+        if (cu_seqlens_q.is_defined()) {
+          s.cu_seqlens_q = cu_seqlens_q->data_ptr<int>();
+          s.cu_seqlens_k = cu_seqlens_k->data_ptr<int>();
+        }
+        flash_attn_bwd_cpu<spec_t>(
+          dout_->data_ptr<spec_t>(), q_->data_ptr<spec_t>(),
+          k_->data_ptr<spec_t>(), v_->data_ptr<spec_t>(),
+          out_->data_ptr<spec_t>(), lse_->data_ptr<float>(),
+          dq->data_ptr<spec_t>(), dk->data_ptr<spec_t>(),
+          dv->data_ptr<spec_t>(), s);
+      },
+      "FlashAttnGradient");
+  });
+  NDArray::MarkUsedBy({dout_, q_, k_, v_, out_, lse_, dq, dk, dv,
+                       cu_seqlens_q, cu_seqlens_k},
+                      stream);
+}
+
+void FlashAttnCpu(const NDArray& q, const NDArray& k, const NDArray& v,
+                  NDArray& out_, NDArray& q_padded, NDArray& k_padded,
+                  NDArray& v_padded, NDArray& out_padded,
+                  NDArray& softmax_lse, NDArray& p, NDArray& rng_state,
+                  const float p_dropout, const float softmax_scale,
+                  const bool is_causal, const bool return_softmax,
+                  const Stream& stream) {
+  HT_ASSERT(q->ndim() == 4 && k->ndim() == 4 && v->ndim() == 4)
+    << "FlashAttnCpu expects [batch_size, seqlen, num_heads, head_dim] inputs";
+  CheckAttnInputs(q, k, v, q->shape(2), k->shape(2), p_dropout);
+  HT_ASSERT(!return_softmax)
+    << "return_softmax is only supported when p_dropout > 0.0";
+  AttnShape shape{q->shape(0), q->shape(2), k->shape(2), q->shape(3),
+                  q->shape(1), k->shape(1), nullptr, nullptr, softmax_scale,
+                  is_causal};
+  HT_ASSERT(k->shape(0) == shape.batch_size && v->shape() == k->shape() &&
+            k->shape(3) == shape.head_dim);
+  FlashAttnFwdCpuImpl(q, k, v, out_, softmax_lse, shape, NDArray(), NDArray(),
+                      stream);
+  pad_head_dim(q, k, v, out_, q_padded, k_padded, v_padded, out_padded,
+               stream);
+}
+
+void FlashAttnGradientCpu(const NDArray& dout, const NDArray& q,
+                          const NDArray& k, const NDArray& v, NDArray& out,
+                          NDArray& softmax_lse, NDArray& rng_state,
+                          NDArray& dq_, NDArray& dk_, NDArray& dv_,
+                          const float p_dropout, const float softmax_scale,
+                          const bool is_causal, const Stream& stream) {
+  HT_ASSERT(q->ndim() == 4 && k->ndim() == 4 && v->ndim() == 4)
+    << "FlashAttnGradientCpu expects [batch_size, seqlen, num_heads, "
+    << "head_dim] inputs";
+  CheckAttnInputs(q, k, v, q->shape(2), k->shape(2), p_dropout);
+  AttnShape shape{q->shape(0), q->shape(2), k->shape(2), q->shape(3),
+                  q->shape(1), k->shape(1), nullptr, nullptr, softmax_scale,
+                  is_causal};
+  FlashAttnBwdCpuImpl(dout, q, k, v, out, softmax_lse, dq_, dk_, dv_, shape,
+                      NDArray(), NDArray(), stream);
+}
+
+void FlashAttnVarlenCpu(const NDArray& q, const NDArray& k, const NDArray& v,
+                        const NDArray& cu_seqlens_q,
+                        const NDArray& cu_seqlens_k, NDArray& out_,
+                        NDArray& q_padded, NDArray& k_padded,
+                        NDArray& v_padded, NDArray& out_padded,
+                        NDArray& softmax_lse, NDArray& p, NDArray& rng_state,
+                        const int max_seqlen_q, const int max_seqlen_k,
+                        const float p_dropout, const float softmax_scale,
+                        const bool zero_tensors, const bool is_causal,
+                        const bool return_softmax, const Stream& stream) {
+  HT_ASSERT(q->ndim() == 3 && k->ndim() == 3 && v->ndim() == 3)
+    << "FlashAttnVarlenCpu expects [total, num_heads, head_dim] inputs";
+  CheckAttnInputs(q, k, v, q->shape(1), k->shape(1), p_dropout);
+  HT_ASSERT(!return_softmax)
+    << "return_softmax is only supported when p_dropout > 0.0";
+  HT_ASSERT(cu_seqlens_q->dtype() == kInt32 && cu_seqlens_k->dtype() == kInt32)
+    << "cu_seqlens must have dtype int32";
+  HT_ASSERT(cu_seqlens_q->is_cpu() && cu_seqlens_k->is_cpu() &&
+            cu_seqlens_q->is_contiguous() && cu_seqlens_k->is_contiguous());
+  HT_ASSERT(cu_seqlens_q->numel() == cu_seqlens_k->numel());
+  AttnShape shape{cu_seqlens_q->numel() - 1, q->shape(1), k->shape(1),
+                  q->shape(2), max_seqlen_q, max_seqlen_k, nullptr, nullptr,
+                  softmax_scale, is_causal};
+  if (zero_tensors) {
+    NDArray::zeros_(out_, stream.stream_index());
+    NDArray::full_(softmax_lse, -std::numeric_limits<float>::infinity(),
+                   stream.stream_index());
+  }
+  FlashAttnFwdCpuImpl(q, k, v, out_, softmax_lse, shape, cu_seqlens_q,
+                      cu_seqlens_k, stream);
+  pad_head_dim(q, k, v, out_, q_padded, k_padded, v_padded, out_padded,
+               stream);
+}
+
+void FlashAttnVarlenGradientCpu(
+  const NDArray& dout, const NDArray& q, const NDArray& k, const NDArray& v,
+  const NDArray& cu_seqlens_q, const NDArray& cu_seqlens_k, NDArray& out,
+  NDArray& softmax_lse, NDArray& rng_state, NDArray& dq_, NDArray& dk_,
+  NDArray& dv_, const int max_seqlen_q, const int max_seqlen_k,
+  const float p_dropout, const float softmax_scale, const bool zero_tensors,
+  const bool is_causal, const Stream& stream) {
+  HT_ASSERT(q->ndim() == 3 && k->ndim() == 3 && v->ndim() == 3)
+    << "FlashAttnVarlenGradientCpu expects [total, num_heads, head_dim] inputs";
+  CheckAttnInputs(q, k, v, q->shape(1), k->shape(1), p_dropout);
+  HT_ASSERT(cu_seqlens_q->dtype() == kInt32 && cu_seqlens_k->dtype() == kInt32)
+    << "cu_seqlens must have dtype int32";
+  HT_ASSERT(cu_seqlens_q->is_cpu() && cu_seqlens_k->is_cpu() &&
+            cu_seqlens_q->is_contiguous() && cu_seqlens_k->is_contiguous());
+  AttnShape shape{cu_seqlens_q->numel() - 1, q->shape(1), k->shape(1),
+                  q->shape(2), max_seqlen_q, max_seqlen_k, nullptr, nullptr,
+                  softmax_scale, is_causal};
+  if (zero_tensors) {
+    // keys outside of every sequence get no gradient
+    NDArray::zeros_(dk_, stream.stream_index());
+    NDArray::zeros_(dv_, stream.stream_index());
+  }
+  FlashAttnBwdCpuImpl(dout, q, k, v, out, softmax_lse, dq_, dk_, dv_, shape,
+                      cu_seqlens_q, cu_seqlens_k, stream);
+}
+
+} // namespace impl
+} // namespace hetu
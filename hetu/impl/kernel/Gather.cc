@@ -73,7 +73,7 @@ void GatherCpu(const NDArray& input, const NDArray& id, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "GatherCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, id, output, size, after_stride, cur_stride, after_stride_out, cur_stride_out]() {
         gather_cpu<spec_t>(
         input->data_ptr<spec_t>(), id->data_ptr<int64_t>(), size,
@@ -104,7 +104,7 @@ void GatherGradientCpu(const NDArray& grad_output, const NDArray& id, NDArray& g
     return;
   HT_DISPATCH_FLOATING_TYPES(
     grad_output->dtype(), spec_t, "GatherGradientCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [grad_output, id, grad_input, size, after_stride, cur_stride, after_stride_out, cur_stride_out]() {
         array_zero_set_cpu<spec_t>(
         grad_input->data_ptr<spec_t>(), grad_input->numel());
@@ -1,5 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/omp_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
@@ -90,9 +91,14 @@ void GeluCpu(const NDArray& input, NDArray& output, const Stream& stream) {
 
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "GeluCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, size]() {
-        if (input->is_contiguous() && output->is_contiguous()) {
+        if (input->is_contiguous() && output->is_contiguous() &&
+            IsVectorizedFloatingType(input->dtype())) {
+          GetVectorizedKernels().gelu(input->dtype(), input->data_ptr<spec_t>(),
+                                      output->data_ptr<spec_t>(), size);
+        }
+        else if (input->is_contiguous() && output->is_contiguous()) {
           gelu_cpu<spec_t>(input->data_ptr<spec_t>(), size,
                            output->data_ptr<spec_t>());
         }
@@ -121,9 +127,17 @@ void GeluGradientCpu(const NDArray& input, const NDArray& output_grad,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "GeluGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output_grad, input_grad, size]() {
-        if (input->is_contiguous() && output_grad->is_contiguous() && input_grad->is_contiguous()) {
+        if (input->is_contiguous() && output_grad->is_contiguous() &&
+            input_grad->is_contiguous() &&
+            IsVectorizedFloatingType(input->dtype())) {
+          GetVectorizedKernels().gelu_gradient(
+            input->dtype(), input->data_ptr<spec_t>(),
+            output_grad->data_ptr<spec_t>(), input_grad->data_ptr<spec_t>(),
+            size);
+        }
+        else if (input->is_contiguous() && output_grad->is_contiguous() && input_grad->is_contiguous()) {
           gelu_gradient_cpu<spec_t>(input->data_ptr<spec_t>(), output_grad->data_ptr<spec_t>(),
                                     size, input_grad->data_ptr<spec_t>());
         }
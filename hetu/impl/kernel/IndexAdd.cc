@@ -53,7 +53,7 @@ void IndexAddCpu(const NDArray& input, const NDArray& id, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "IndexAddCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, id, output, size, before_stride, after_stride, cur_stride]() {
       index_add_cpu<spec_t>(input->data_ptr<spec_t>(), id->data_ptr<spec_t>(),
                             size, before_stride, after_stride, cur_stride,
@@ -1,46 +1,123 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
 #include "hetu/impl/random/CPURandomState.h"
+#include "hetu/impl/random/Philox.h"
 #include "hetu/impl/utils/common_utils.h"
-#include "hetu/impl/utils/omp_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
-#include <random>
+#include <algorithm>
 
 namespace hetu {
 namespace impl {
 
+namespace {
+
+// Each element draws from the Philox stream at its row-major index in the
+// global tensor, so a shard initialized with its `global_begin` holds
+// exactly the values of the corresponding slice of the whole tensor.
+// Calls `fill(local_index, global_index, length)` on runs that are
+// contiguous in both.
+template <typename F>
+void for_each_global_run(const HTShape& shape, const HTShape& global_shape,
+                         const HTShape& global_begin, F&& fill) {
+  const int64_t ndim = shape.size();
+  HT_ASSERT(static_cast<int64_t>(global_shape.size()) == ndim &&
+            static_cast<int64_t>(global_begin.size()) == ndim)
+    << "Local shape " << shape << " does not match the global shape "
+    << global_shape << " at " << global_begin;
+  bool whole = true;
+  for (int64_t i = 0; i < ndim; ++i) {
+    HT_ASSERT(global_begin[i] >= 0 &&
+              global_begin[i] + shape[i] <= global_shape[i])
+      << "Local shape " << shape << " at " << global_begin
+      << " is out of the global shape " << global_shape;
+    whole = whole && shape[i] == global_shape[i];
+  }
+  const int64_t size = NumEl(shape);
+  if (whole || ndim <= 1) {
+    const int64_t global_offset = ndim == 1 ? global_begin[0] : 0;
+    CPUParallelFor(0, size, kCPUParallelGrainSize,
+                   [&](int64_t begin, int64_t end) {
+      fill(begin, global_offset + begin, end - begin);
+    });
+    return;
+  }
+  const int64_t inner = shape[ndim - 1];
+  const int64_t rows = size / inner;
+  const auto global_stride = Shape2Stride(global_shape);
+  CPUParallelFor(0, rows, std::max<int64_t>(1, kCPUParallelGrainSize / inner),
+                 [&](int64_t begin, int64_t end) {
+    for (int64_t row = begin; row < end; ++row) {
+      int64_t global_offset = global_begin[ndim - 1];
+      for (int64_t i = ndim - 2, t = row; i >= 0; --i) {
+        global_offset += (global_begin[i] + t % shape[i]) * global_stride[i];
+        t /= shape[i];
+      }
+      fill(row * inner, global_offset, inner);
+    }
+  });
+}
+
+} // namespace
+
 template <typename spec_t>
-void init_normal_cpu(spec_t* arr, size_t size, spec_t mean, spec_t stddev,
-                     uint64_t seed) {
-  std::mt19937 engine(seed);
-  std::normal_distribution<double> dist(mean, stddev);
-  for (size_t i = 0; i < size; i++)
-    arr[i] = spec_t(dist(engine));
+void init_normal_cpu(spec_t* arr, const HTShape& shape,
+                     const HTShape& global_shape, const HTShape& global_begin,
+                     double mean, double stddev, CPURandomState rand_state) {
+  Philox4x32 philox(rand_state.seed, rand_state.offset);
+  for_each_global_run(shape, global_shape, global_begin,
+                      [&](int64_t local, int64_t global, int64_t len) {
+    spec_t* out = arr + local;
+    PhiloxForRange(
+      global, global + len,
+      [&](uint64_t block) { return PhiloxNormal4(philox(block)); },
+      [&](uint64_t i, float value) {
+        out[i - global] = spec_t(value * stddev + mean);
+      });
+  });
 }
 
 template <typename spec_t>
-void init_uniform_cpu(spec_t* arr, size_t size, spec_t lb, spec_t ub,
-                      uint64_t seed) {
-  std::mt19937 engine(seed);
-  std::uniform_real_distribution<double> dist(lb, ub);
-  for (size_t i = 0; i < size; i++)
-    arr[i] = spec_t(dist(engine));
+void init_uniform_cpu(spec_t* arr, const HTShape& shape,
+                      const HTShape& global_shape, const HTShape& global_begin,
+                      double lb, double ub, CPURandomState rand_state) {
+  Philox4x32 philox(rand_state.seed, rand_state.offset);
+  for_each_global_run(shape, global_shape, global_begin,
+                      [&](int64_t local, int64_t global, int64_t len) {
+    spec_t* out = arr + local;
+    PhiloxForRange(
+      global, global + len,
+      [&](uint64_t block) { return PhiloxUniform4(philox(block)); },
+      [&](uint64_t i, float value) {
+        out[i - global] = spec_t(value * (ub - lb) + lb);
+      });
+  });
 }
 
 template <typename spec_t>
-void init_truncated_normal_cpu(spec_t* arr, size_t size, spec_t mean,
-                               spec_t stddev, spec_t lb, spec_t ub,
-                               uint64_t seed) {
-  std::mt19937 engine(seed);
-  std::normal_distribution<double> dist(mean, stddev);
-  for (size_t i = 0; i < size; i++) {
-    do {
-      arr[i] = spec_t(dist(engine));
-    } while (arr[i] < lb || arr[i] > ub);
-  }
+void init_truncated_normal_cpu(spec_t* arr, const HTShape& shape,
+                               const HTShape& global_shape,
+                               const HTShape& global_begin, double mean,
+                               double stddev, double lb, double ub,
+                               CPURandomState rand_state) {
+  Philox4x32 philox(rand_state.seed, rand_state.offset);
+  for_each_global_run(shape, global_shape, global_begin,
+                      [&](int64_t local, int64_t global, int64_t len) {
+    spec_t* out = arr + local;
+    PhiloxForRange(
+      global, global + len,
+      [&](uint64_t block) { return PhiloxNormal4(philox(block)); },
+      [&](uint64_t i, float value) {
+        double sample = value * stddev + mean;
+        // rejected samples are redrawn from a separate stream
+        for (uint64_t attempt = 0; sample < lb || sample > ub; ++attempt)
+          sample = PhiloxNormal4(philox.redraw(i, attempt))[0] * stddev + mean;
+        out[i - global] = spec_t(sample);
+      });
+  });
 }
 
 void NormalInitsCpu(NDArray& data, double mean, double stddev, uint64_t seed,
+                    const HTShape& global_shape, const HTShape& global_begin,
                     const Stream& stream) {
   HT_ASSERT_CPU_DEVICE(data);
   CPUStream cpu_stream(stream);
@@ -52,20 +129,26 @@ void NormalInitsCpu(NDArray& data, double mean, double stddev, uint64_t seed,
     NDArray::MarkUsedBy({data}, stream);
     return;
   }
-  if (seed == 0)
-    seed = GenNextRandomSeed();
+  CPURandomState rand_state = GetCPURandomState(seed, 4);
   HT_DISPATCH_FLOATING_TYPES(data->dtype(), spec_t, "NormalInitsCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [data, size, mean, stddev, seed]() {
-      init_normal_cpu<spec_t>(data->data_ptr<spec_t>(), size,
-                              static_cast<spec_t>(mean),
-                              static_cast<spec_t>(stddev), seed);
-      },"NormalInits");    
+      cpu_stream.PostTask(
+      [data, global_shape, global_begin, mean, stddev, rand_state]() {
+      init_normal_cpu<spec_t>(data->data_ptr<spec_t>(), data->shape(),
+                              global_shape, global_begin, mean, stddev,
+                              rand_state);
+      },"NormalInits");
   });
   NDArray::MarkUsedBy({data}, stream);
 }
 
+void NormalInitsCpu(NDArray& data, double mean, double stddev, uint64_t seed,
+                    const Stream& stream) {
+  NormalInitsCpu(data, mean, stddev, seed, data->shape(),
+                 HTShape(data->ndim(), 0), stream);
+}
+
 void UniformInitsCpu(NDArray& data, double lb, double ub, uint64_t seed,
+                     const HTShape& global_shape, const HTShape& global_begin,
                      const Stream& stream) {
   HT_ASSERT_CPU_DEVICE(data);
   HT_ASSERT(lb < ub) << "Invalid range for uniform random init: "
@@ -79,21 +162,28 @@ void UniformInitsCpu(NDArray& data, double lb, double ub, uint64_t seed,
     NDArray::MarkUsedBy({data}, stream);
     return;
   }
-  if (seed == 0)
-    seed = GenNextRandomSeed();
+  CPURandomState rand_state = GetCPURandomState(seed, 4);
   HT_DISPATCH_FLOATING_TYPES(data->dtype(), spec_t, "UniformInitCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
-      [data, size, lb, ub, seed]() {
-      init_uniform_cpu<spec_t>(data->data_ptr<spec_t>(), size,
-                               static_cast<spec_t>(lb), static_cast<spec_t>(ub),
-                               seed);
-      },"UniformInit");   
+    cpu_stream.PostTask(
+      [data, global_shape, global_begin, lb, ub, rand_state]() {
+      init_uniform_cpu<spec_t>(data->data_ptr<spec_t>(), data->shape(),
+                               global_shape, global_begin, lb, ub,
+                               rand_state);
+      },"UniformInit");
   });
   NDArray::MarkUsedBy({data}, stream);
 }
 
+void UniformInitsCpu(NDArray& data, double lb, double ub, uint64_t seed,
+                     const Stream& stream) {
+  UniformInitsCpu(data, lb, ub, seed, data->shape(),
+                  HTShape(data->ndim(), 0), stream);
+}
+
 void TruncatedNormalInitsCpu(NDArray& data, double mean, double stddev,
                              double lb, double ub, uint64_t seed,
+                             const HTShape& global_shape,
+                             const HTShape& global_begin,
                              const Stream& stream) {
   HT_ASSERT_CPU_DEVICE(data);
   CPUStream cpu_stream(stream);
@@ -105,20 +195,25 @@ void TruncatedNormalInitsCpu(NDArray& data, double mean, double stddev,
     NDArray::MarkUsedBy({data}, stream);
     return;
   }
-  if (seed == 0)
-    seed = GenNextRandomSeed();
+  CPURandomState rand_state = GetCPURandomState(seed, 32);
   HT_DISPATCH_FLOATING_TYPES(
     data->dtype(), spec_t, "TruncatedNormalInitsCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
-      [data, size, mean, stddev, lb, ub, seed]() {
+    cpu_stream.PostTask(
+      [data, global_shape, global_begin, mean, stddev, lb, ub, rand_state]() {
       init_truncated_normal_cpu<spec_t>(
-        data->data_ptr<spec_t>(), size, static_cast<spec_t>(mean),
-        static_cast<spec_t>(stddev), static_cast<spec_t>(lb),
-        static_cast<spec_t>(ub), seed);
-      },"TruncatedNormalInits");    
+        data->data_ptr<spec_t>(), data->shape(), global_shape, global_begin,
+        mean, stddev, lb, ub, rand_state);
+      },"TruncatedNormalInits");
   });
   NDArray::MarkUsedBy({data}, stream);
 }
 
+void TruncatedNormalInitsCpu(NDArray& data, double mean, double stddev,
+                             double lb, double ub, uint64_t seed,
+                             const Stream& stream) {
+  TruncatedNormalInitsCpu(data, mean, stddev, lb, ub, seed, data->shape(),
+                          HTShape(data->ndim(), 0), stream);
+}
+
 } // namespace impl
 } // namespace hetu
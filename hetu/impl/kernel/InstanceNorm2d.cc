@@ -45,10 +45,10 @@ void InstanceNormCpu(const NDArray& in_arr, NDArray& mean_arr, NDArray& var_arr,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     in_arr->dtype(), spec_t, "InstanceNormCpu", [&]() {
-      cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [stream, in_arr, mean_arr, var_arr, out_arr, eps, last_2dim, ndim]() {
-      dnnl::engine eng(dnnl::engine::kind::cpu, 0);
-      dnnl::stream engine_stream(eng); 
+      auto& eng = hetu::cpu::GetDNNLEngine();
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(in_arr->dtype());
       auto src_md = dnnl::memory::desc(in_arr->shape(), dnnltype, in_arr->stride());
       auto dst_md = dnnl::memory::desc(mean_arr->shape(), dnnltype, mean_arr->stride());
@@ -61,11 +61,12 @@ void InstanceNormCpu(const NDArray& in_arr, NDArray& mean_arr, NDArray& var_arr,
       else {
 
         // Create primitive descriptor.
-        auto reduction_pd = dnnl::reduction::primitive_desc(
-                eng, dnnl::algorithm::reduction_mean, src_md, dst_md, float(0.f), float(0.f));
-
-        // Create the primitive.
-        auto reduction_prim = dnnl::reduction(reduction_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Reduction")
+                   .Add(dnnl::algorithm::reduction_mean, src_md, dst_md, float(0.f), float(0.f));
+        auto reduction_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::reduction::primitive_desc(
+                  eng, dnnl::algorithm::reduction_mean, src_md, dst_md, float(0.f), float(0.f));
+        });
 
         // Primitive arguments.
         std::unordered_map<int, dnnl::memory> reduction_args;
@@ -90,11 +91,12 @@ void InstanceNormCpu(const NDArray& in_arr, NDArray& mean_arr, NDArray& var_arr,
       else {
 
         // Create primitive descriptor.
-        auto reduction_pd = dnnl::reduction::primitive_desc(
-                eng, dnnl::algorithm::reduction_mean, src_md, dst_md, float(0.f), float(0.f));
-
-        // Create the primitive.
-        auto reduction_prim = dnnl::reduction(reduction_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Reduction")
+                   .Add(dnnl::algorithm::reduction_mean, src_md, dst_md, float(0.f), float(0.f));
+        auto reduction_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::reduction::primitive_desc(
+                  eng, dnnl::algorithm::reduction_mean, src_md, dst_md, float(0.f), float(0.f));
+        });
 
         // Primitive arguments.
         std::unordered_map<int, dnnl::memory> reduction_args;
@@ -161,15 +163,15 @@ void InstanceNormGradientCpu(const NDArray& out_grads, const NDArray& in_arr,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_FLOATING_TYPES(
     in_arr->dtype(), spec_t, "InstanceNormGradientCpu", [&]() {
-      cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [stream, out_grads, in_arr, grad_arr, mean_arr, var_arr, 
       dscale_arr, dbias_arr, dy_mul_x_arr, eps, ndim, last2dim, size]() {
       spec_t* dscale = dscale_arr->data_ptr<spec_t>();
       spec_t* dbias = dbias_arr->data_ptr<spec_t>();
       spec_t* dy_mul_x = dy_mul_x_arr->data_ptr<spec_t>();
       
-      dnnl::engine eng(dnnl::engine::kind::cpu, 0);
-      dnnl::stream engine_stream(eng); 
+      auto& eng = hetu::cpu::GetDNNLEngine();
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(in_arr->dtype());
       auto src_md = dnnl::memory::desc(in_arr->shape(), dnnltype, in_arr->stride());
       auto dst_md = dnnl::memory::desc(mean_arr->shape(), dnnltype, mean_arr->stride());
@@ -182,11 +184,12 @@ void InstanceNormGradientCpu(const NDArray& out_grads, const NDArray& in_arr,
       else {
 
         // Create primitive descriptor.
-        auto reduction_pd = dnnl::reduction::primitive_desc(
-                eng, dnnl::algorithm::reduction_sum, src_md, dst_md, float(0.f), float(0.f));
-
-        // Create the primitive.
-        auto reduction_prim = dnnl::reduction(reduction_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Reduction")
+                   .Add(dnnl::algorithm::reduction_sum, src_md, dst_md, float(0.f), float(0.f));
+        auto reduction_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::reduction::primitive_desc(
+                  eng, dnnl::algorithm::reduction_sum, src_md, dst_md, float(0.f), float(0.f));
+        });
 
         // Primitive arguments.
         std::unordered_map<int, dnnl::memory> reduction_args;
@@ -202,11 +205,12 @@ void InstanceNormGradientCpu(const NDArray& out_grads, const NDArray& in_arr,
       auto src_B_mem = dnnl::memory(src_md, eng, in_arr->data_ptr<spec_t>());
       auto dymulx_mem = dnnl::memory(src_md, eng, dy_mul_x);
 
-      auto binary_pd = dnnl::binary::primitive_desc(eng, dnnl::algorithm::binary_mul,
-                                                    src_md, src_md, src_md);
-
-      // Create the primitive.
-      auto binary_prim = dnnl::binary(binary_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("Binary")
+                 .Add(dnnl::algorithm::binary_mul, src_md, src_md, src_md);
+      auto binary_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        return dnnl::binary::primitive_desc(eng, dnnl::algorithm::binary_mul,
+                                            src_md, src_md, src_md);
+      });
 
       // Primitive arguments. Set up in-place execution by assigning src_0 as DST.
       std::unordered_map<int, dnnl::memory> binary_args;
@@ -225,11 +229,12 @@ void InstanceNormGradientCpu(const NDArray& out_grads, const NDArray& in_arr,
       else {
 
         // Create primitive descriptor.
-        auto reduction_pd = dnnl::reduction::primitive_desc(
-                eng, dnnl::algorithm::reduction_sum, src_md, dst_md, float(0.f), float(0.f));
-
-        // Create the primitive.
-        auto reduction_prim = dnnl::reduction(reduction_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Reduction")
+                   .Add(dnnl::algorithm::reduction_sum, src_md, dst_md, float(0.f), float(0.f));
+        auto reduction_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::reduction::primitive_desc(
+                  eng, dnnl::algorithm::reduction_sum, src_md, dst_md, float(0.f), float(0.f));
+        });
 
         // Primitive arguments.
         std::unordered_map<int, dnnl::memory> reduction_args;
@@ -177,7 +177,7 @@ void InterpolateCpu(const NDArray& input, NDArray& output,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     input->dtype(), spec_t, "InterpolateCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, input_N, input_C, input_H, input_W,
       output_H, output_W, ratio_h, ratio_w, align_corners, size]() {
       interpolate_cpu<spec_t>(
@@ -217,7 +217,7 @@ void InterpolateGradientCpu(const NDArray& output, NDArray& input,
 
   HT_DISPATCH_FLOATING_TYPES(
     input->dtype(), spec_t, "InterpolateGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, input_N, input_C, input_H, input_W,
       output_H, output_W, ratio_h, ratio_w, align_corners, size]() {
       array_zero_set_cpu<spec_t>(
@@ -77,7 +77,7 @@ void KLDivLossCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "KLDivLossCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, loss, n_rows]() {
       if (pred->is_contiguous() && label->is_contiguous() && loss->is_contiguous()) {
         kldivloss_cpu<spec_t>(
@@ -116,7 +116,7 @@ void KLDivLossGradientCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "KLDivLossGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, grad_loss, output, n_rows]() {
       if (pred->is_contiguous() && label->is_contiguous() && grad_loss->is_contiguous()) {
         kldivloss_gradient_cpu<spec_t>(
@@ -95,18 +95,21 @@ void LeakyReluCpu(const NDArray& input, double alpha, NDArray& output,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "LeakyReluCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [stream, input, output, alpha]() {
-      dnnl::engine eng(dnnl::engine::kind::cpu, 0);
-      dnnl::stream engine_stream(eng);
+      auto& eng = hetu::cpu::GetDNNLEngine();
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
       auto mat_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
       auto src_mem = dnnl::memory(mat_md, eng, input->data_ptr<spec_t>());
       auto dst_mem = dnnl::memory(mat_md, eng, output->data_ptr<spec_t>());
 
-      auto LeakyRelu_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                           dnnl::algorithm::eltwise_relu, mat_md, mat_md, float(alpha), float(0.0));
-      auto LeakyRelu = dnnl::eltwise_forward(LeakyRelu_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("Eltwise")
+                 .Add(dnnl::algorithm::eltwise_relu, mat_md, mat_md, float(alpha), float(0.0));
+      auto LeakyRelu = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        return dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                dnnl::algorithm::eltwise_relu, mat_md, mat_md, float(alpha), float(0.0));
+      });
 
       LeakyRelu.execute(engine_stream,
                         {{DNNL_ARG_SRC, src_mem}, {DNNL_ARG_DST, dst_mem}});
@@ -131,24 +134,25 @@ void LeakyReluGradientCpu(const NDArray& input, const NDArray& output_grad,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "LeakyReluGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [stream, output_grad, input, input_grad, alpha]() {
-      dnnl::engine eng(dnnl::engine::kind::cpu, 0);
-      dnnl::stream engine_stream(eng);
+      auto& eng = hetu::cpu::GetDNNLEngine();
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
       auto mat_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
       auto src_mem = dnnl::memory(mat_md, eng, input->data_ptr<spec_t>());
       auto g_dst_mem = dnnl::memory(mat_md, eng, output_grad->data_ptr<spec_t>());
       auto g_src_mem = dnnl::memory(mat_md, eng, input_grad->data_ptr<spec_t>());
 
-      auto LeakyRelu_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                           dnnl::algorithm::eltwise_relu, mat_md, mat_md, float(alpha), float(0.0));
-
-      auto LeakyRelu_bwd_pd = dnnl::eltwise_backward::primitive_desc(eng,
-            dnnl::algorithm::eltwise_relu, mat_md, mat_md,
-            mat_md, float(alpha), float(0.0), LeakyRelu_pd);
-      
-      auto LeakyRelu_bwd = dnnl::eltwise_backward(LeakyRelu_bwd_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("EltwiseGradient")
+                 .Add(dnnl::algorithm::eltwise_relu, mat_md, mat_md, float(alpha), float(0.0));
+      auto LeakyRelu_bwd = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        auto LeakyRelu_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                             dnnl::algorithm::eltwise_relu, mat_md, mat_md, float(alpha), float(0.0));
+        return dnnl::eltwise_backward::primitive_desc(eng,
+              dnnl::algorithm::eltwise_relu, mat_md, mat_md,
+              mat_md, float(alpha), float(0.0), LeakyRelu_pd);
+      });
 
       LeakyRelu_bwd.execute(engine_stream,
                       {{DNNL_ARG_SRC, src_mem}, 
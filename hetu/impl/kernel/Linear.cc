@@ -31,11 +31,10 @@ void LinearCpu(const NDArray& a, bool trans_a, const NDArray& b, bool trans_b,
   int32_t k = trans_a ? a->shape(0) : a->shape(1);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
   HT_DISPATCH_FLOATING_TYPES(output->dtype(), spec_t, "Linear", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
     [stream, a, b, bias, trans_a, trans_b, output, m, n, k]() {
-      dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+      auto& eng = hetu::cpu::GetDNNLEngine();
       dnnl::memory::desc srcA_md, srcB_md, bias_md, dst_md;
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(output->dtype());
       if (!trans_a)
@@ -60,8 +59,11 @@ void LinearCpu(const NDArray& a, bool trans_a, const NDArray& b, bool trans_b,
       auto bias_mem = dnnl::memory(bias_md, eng, bias->data_ptr<spec_t>());
       auto dst_mem = dnnl::memory(dst_md, eng, output->data_ptr<spec_t>());
 
-      auto Matmul_pd = dnnl::matmul::primitive_desc(eng, srcA_md, srcB_md, bias_md, dst_md);
-      auto Matmul = dnnl::matmul(Matmul_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("MatMul")
+                 .Add(srcA_md, srcB_md, bias_md, dst_md);
+      auto Matmul = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        return dnnl::matmul::primitive_desc(eng, srcA_md, srcB_md, bias_md, dst_md);
+      });
 
       std::unordered_map<int, dnnl::memory> matmul_args;
       matmul_args.insert({DNNL_ARG_SRC, srcA_mem});
@@ -69,7 +71,7 @@ void LinearCpu(const NDArray& a, bool trans_a, const NDArray& b, bool trans_b,
       matmul_args.insert({DNNL_ARG_BIAS, bias_mem});
       matmul_args.insert({DNNL_ARG_DST, dst_mem});
 
-      dnnl::stream engine_stream(eng);
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       Matmul.execute(engine_stream, matmul_args);
       engine_stream.wait();
     },"Linear");
@@ -82,7 +82,7 @@ void MSELossCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "MSELossCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, loss, n_rows]() {
       if (pred->is_contiguous() && label->is_contiguous() && loss->is_contiguous()) {
         mseloss_cpu(pred->data_ptr<spec_t>(),
@@ -121,7 +121,7 @@ void MSELossGradientCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "MSELossGradientCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, grad_loss, output, n_rows]() {
       if (pred->is_contiguous() && label->is_contiguous() && grad_loss->is_contiguous() && output->is_contiguous()) {
         mseloss_gradient_cpu(
@@ -27,7 +27,7 @@ void MaskedfillCpu(const NDArray& input, const NDArray& mask,
   size_t size = input->numel();
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "MaskfillCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, mask, output, val, size]() {
         maskedfill_cpu<spec_t>(
         input->data_ptr<spec_t>(), mask->data_ptr<int64_t>(),
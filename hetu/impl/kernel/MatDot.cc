@@ -32,7 +32,7 @@ void MatDotCpu(const NDArray& inputA, const NDArray& inputB, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     inputA->dtype(), spec_t, "MatDotCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [inputA, inputB, output, size, size2]() {
       dot_cpu<spec_t>(inputA->data_ptr<spec_t>(), inputB->data_ptr<spec_t>(),
                       size, size2, output->data_ptr<spec_t>());
@@ -25,9 +25,9 @@ void MatMulCpu(const NDArray& a, bool trans_a, const NDArray& b, bool trans_b,
 
   CPUStream cpu_stream(stream);
   HT_DISPATCH_FLOATING_TYPES(output->dtype(), spec_t, "MatMul", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
     [stream, a, b, trans_a, trans_b, output, m, n, k]() {
-      dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+      auto& eng = hetu::cpu::GetDNNLEngine();
       dnnl::memory::desc srcA_md, srcB_md, dst_md;
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(output->dtype());
       if (!trans_a)
@@ -49,15 +49,18 @@ void MatMulCpu(const NDArray& a, bool trans_a, const NDArray& b, bool trans_b,
       auto srcB_mem = dnnl::memory(srcB_md, eng, b->data_ptr<spec_t>());
       auto dst_mem = dnnl::memory(dst_md, eng, output->data_ptr<spec_t>());
 
-      auto Matmul_pd = dnnl::matmul::primitive_desc(eng, srcA_md, srcB_md, dst_md);
-      auto Matmul = dnnl::matmul(Matmul_pd);
+      auto key = hetu::cpu::DNNLPrimitiveKey("MatMul")
+                   .Add(dnnltype, m, n, k, trans_a, trans_b);
+      auto Matmul = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+        return dnnl::matmul::primitive_desc(eng, srcA_md, srcB_md, dst_md);
+      });
 
       std::unordered_map<int, dnnl::memory> matmul_args;
       matmul_args.insert({DNNL_ARG_SRC, srcA_mem});
       matmul_args.insert({DNNL_ARG_WEIGHTS, srcB_mem});
       matmul_args.insert({DNNL_ARG_DST, dst_mem});
 
-      dnnl::stream engine_stream(eng);
+      auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
       Matmul.execute(engine_stream, matmul_args);
       engine_stream.wait();
     },"Matmul");
@@ -48,7 +48,7 @@ void MatVecMulCpu(const NDArray& a, bool trans, const NDArray& x,
 
   CPUStream cpu_stream(stream);
   HT_DISPATCH_FLOATING_TYPES(output->dtype(), spec_t, "MatVecMul", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
     [a, x, trans, output, m, n]() {
       matvecmul_cpu<spec_t>(a->data_ptr<spec_t>(), x->data_ptr<spec_t>(),
                             trans, m, n, output->data_ptr<spec_t>());
@@ -89,15 +89,14 @@ void MaxPoolCpu(const NDArray& input, const size_t kernel_H,
   size_t output_size = input_N * input_C * output_H * output_W;
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
-  dnnl::stream engine_stream(eng);
   if (output_size == 0)
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "MaxPoolCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-        [eng, input, output, kernel_H, kernel_W,
+      cpu_stream.PostTask(
+        [stream, input, output, kernel_H, kernel_W,
         padding, stride]() {
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
         auto src_md = dnnl::memory::desc(input->shape(), dnnltype, dnnl::memory::format_tag::nchw);
         auto src_mem = dnnl::memory(src_md, eng, input->data_ptr<spec_t>());
@@ -112,14 +111,17 @@ void MaxPoolCpu(const NDArray& input, const size_t kernel_H,
         dnnl::memory::dims padding_dims_l = {int(padding), int(padding)};
         dnnl::memory::dims padding_dims_r = {int(padding), int(padding)};
         // HT_LOG_INFO << strides_dims << " " << kernel_dims << " " << padding_dims_l;
-        auto pooling_pd = dnnl::pooling_forward::primitive_desc(eng,
-                dnnl::prop_kind::forward_inference, dnnl::algorithm::pooling_max, 
-                src_md, dst_md, strides_dims, kernel_dims, dilation, padding_dims_l, padding_dims_r);
-
-        auto workspace_mem = dnnl::memory(pooling_pd.workspace_desc(), eng);
-
-        // Create the primitive.
-        auto pooling_prim = dnnl::pooling_forward(pooling_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Pooling")
+                   .Add(dnnl::algorithm::pooling_max, src_md, dst_md)
+                   .Add(strides_dims, kernel_dims, dilation,
+                        padding_dims_l, padding_dims_r);
+        auto pooling_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::pooling_forward::primitive_desc(eng,
+                  dnnl::prop_kind::forward_inference, dnnl::algorithm::pooling_max, 
+                  src_md, dst_md, strides_dims, kernel_dims, dilation, padding_dims_l, padding_dims_r);
+        });
+
+        auto workspace_mem = dnnl::memory(pooling_prim.pd.workspace_desc(), eng);
 
         // Primitive arguments. Set up in-place execution by assigning src as DST.
         std::unordered_map<int, dnnl::memory> pooling_args;
@@ -127,7 +129,7 @@ void MaxPoolCpu(const NDArray& input, const size_t kernel_H,
         pooling_args.insert({DNNL_ARG_DST, dst_mem});
         pooling_args.insert({DNNL_ARG_WORKSPACE, workspace_mem});
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         pooling_prim.execute(engine_stream, pooling_args);
         engine_stream.wait();
       },"MaxPool");     
@@ -146,14 +148,13 @@ void MaxPoolGradientCpu(const NDArray& output_Y, const NDArray& gradient_Y,
   HT_ASSERT_SAME_DEVICE(output_Y, gradient_X);
 
   CPUStream cpu_stream(stream);
-  dnnl::engine eng(dnnl::engine::kind::cpu, 0);
-  dnnl::stream engine_stream(eng);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_X->dtype(), spec_t, "MaxPoolGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
-      [eng, output_Y, gradient_Y,
+      cpu_stream.PostTask(
+      [stream, output_Y, gradient_Y,
        input_X, gradient_X, kernel_H, kernel_W,
        padding, stride]() {
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_X->dtype());
         auto src_md = dnnl::memory::desc(input_X->shape(), dnnltype, dnnl::memory::format_tag::nchw);
         auto src_mem = dnnl::memory(src_md, eng, input_X->data_ptr<spec_t>());
@@ -176,20 +177,27 @@ void MaxPoolGradientCpu(const NDArray& output_Y, const NDArray& gradient_Y,
         dnnl::memory::dims dilation = {0, 0};
         dnnl::memory::dims padding_dims_l = {int(padding), int(padding)};
         dnnl::memory::dims padding_dims_r = {int(padding), int(padding)};
-        auto pooling_pd = dnnl::pooling_forward::primitive_desc(eng,
-                dnnl::prop_kind::forward, dnnl::algorithm::pooling_max, 
-                src_md, dst_md, strides_dims, kernel_dims, dilation, padding_dims_l, padding_dims_r);
-        
-        auto pooling_bwd_pd = dnnl::pooling_backward::primitive_desc(eng,
-                dnnl::algorithm::pooling_max, 
-                gsrc_md, gdst_md, strides_dims, kernel_dims, dilation, 
-                padding_dims_l, padding_dims_r, pooling_pd);
-
-        auto workspace_mem = dnnl::memory(pooling_pd.workspace_desc(), eng);
-
-        // Create the primitive.
-        auto pooling_fwd = dnnl::pooling_forward(pooling_pd);
-        auto pooling_prim = dnnl::pooling_backward(pooling_bwd_pd);
+        auto fwd_key = hetu::cpu::DNNLPrimitiveKey("PoolingTraining")
+                       .Add(dnnl::algorithm::pooling_max, src_md, dst_md)
+                       .Add(strides_dims, kernel_dims, dilation,
+                            padding_dims_l, padding_dims_r);
+        auto pooling_fwd = hetu::cpu::GetOrCreateDNNLPrimitive(fwd_key, [&]() {
+          return dnnl::pooling_forward::primitive_desc(eng,
+                  dnnl::prop_kind::forward, dnnl::algorithm::pooling_max, 
+                  src_md, dst_md, strides_dims, kernel_dims, dilation, padding_dims_l, padding_dims_r);
+        });
+        auto key = hetu::cpu::DNNLPrimitiveKey("PoolingGradient")
+                   .Add(dnnl::algorithm::pooling_max, src_md, dst_md, gsrc_md, gdst_md)
+                   .Add(strides_dims, kernel_dims, dilation,
+                        padding_dims_l, padding_dims_r);
+        auto pooling_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::pooling_backward::primitive_desc(eng,
+                  dnnl::algorithm::pooling_max, 
+                  gsrc_md, gdst_md, strides_dims, kernel_dims, dilation, 
+                  padding_dims_l, padding_dims_r, pooling_fwd.pd);
+        });
+
+        auto workspace_mem = dnnl::memory(pooling_fwd.pd.workspace_desc(), eng);
 
         // Primitive arguments. Set up in-place execution by assigning src as DST.
         std::unordered_map<int, dnnl::memory> pooling_fwd_args;
@@ -205,7 +213,7 @@ void MaxPoolGradientCpu(const NDArray& output_Y, const NDArray& gradient_Y,
         pooling_args.insert({DNNL_ARG_WORKSPACE, workspace_mem});
 
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         pooling_fwd.execute(engine_stream, pooling_fwd_args);    
         pooling_prim.execute(engine_stream, pooling_args);
         engine_stream.wait();
@@ -61,7 +61,7 @@ void NLLLossCpu(const NDArray& pred, const NDArray& label,
 
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "NLLLossCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, loss, n_rows, n_cols]() {
       nllloss_cpu(
         pred->data_ptr<spec_t>(), label->data_ptr<int64_t>(), n_rows, n_cols,
@@ -95,7 +95,7 @@ void NLLLossGradientCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "NLLLossGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [pred, label, grad_loss, output, n_rows, n_cols]() {
       array_zero_set_cpu(output->data_ptr<spec_t>(), output->numel());
       nllloss_gradient_cpu(
@@ -16,9 +16,9 @@ void NormCpu(const NDArray& input, NDArray& output, int64_t dim, int64_t p, cons
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
   input->dtype(), spec_t, "NormCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
     [stream, input, output, dim, p]() {
-      dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+      auto& eng = hetu::cpu::GetDNNLEngine();
       auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
       dnnl::memory::dims in_shape = input->shape();
       dnnl::memory::dims in_stride = input->stride();
@@ -41,18 +41,19 @@ void NormCpu(const NDArray& input, NDArray& output, int64_t dim, int64_t p, cons
       else {
 
         // Create primitive descriptor.
-        auto reduction_pd = dnnl::reduction::primitive_desc(
-                eng, dnnl::algorithm::reduction_norm_lp_sum, src_md, dst_md, float(p), float(0.f));
-
-        // Create the primitive.
-        auto reduction_prim = dnnl::reduction(reduction_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Reduction")
+                   .Add(dnnl::algorithm::reduction_norm_lp_sum, src_md, dst_md, float(p), float(0.f));
+        auto reduction_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::reduction::primitive_desc(
+                  eng, dnnl::algorithm::reduction_norm_lp_sum, src_md, dst_md, float(p), float(0.f));
+        });
 
         // Primitive arguments.
         std::unordered_map<int, dnnl::memory> reduction_args;
         reduction_args.insert({DNNL_ARG_SRC, src_mem});
         reduction_args.insert({DNNL_ARG_DST, dst_mem});
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         reduction_prim.execute(engine_stream, reduction_args);
         engine_stream.wait();
     }
@@ -124,7 +125,7 @@ void NormGradientCpu(const NDArray& input, const NDArray& output, const NDArray&
 
   HT_DISPATCH_FLOATING_TYPES(
     input->dtype(), spec_t, "NormGradientCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, output_grad, input_grad, p, reduce_dim_size, after_dim_size, size]() {
       norm_gradient_cpu<spec_t>(
       input->data_ptr<spec_t>(), output->data_ptr<spec_t>(), output_grad->data_ptr<spec_t>(), 
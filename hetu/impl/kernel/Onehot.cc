@@ -40,7 +40,7 @@ void OnehotCpu(const NDArray& input, size_t num_classes, NDArray& output,
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "OnehotCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, size, last_dim]() {
       onehot_cpu<spec_t>(input->data_ptr<spec_t>(), size, last_dim,
                          output->data_ptr<spec_t>());
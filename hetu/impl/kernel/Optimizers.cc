@@ -1,5 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/ndarray_utils.h"
 #include "hetu/impl/utils/omp_utils.h"
@@ -53,6 +54,28 @@ void nesterov_momentum_update_cpu(const spec_t* grad, spec_t* param,
   }
 }
 
+template <typename spec_t>
+void sgd_update_any_cpu(const NDArray& grad, NDArray& param, NDArray& velocity,
+                        float lr, float momentum, bool nesterov, size_t size) {
+  if (IsVectorizedFloatingType(grad->dtype())) {
+    GetVectorizedKernels().sgd_update(
+      grad->dtype(), grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(),
+      momentum == 0 ? nullptr : velocity->data_ptr<spec_t>(), lr,
+      momentum, nesterov, size);
+  } else if (momentum == 0) {
+    sgd_update_cpu<spec_t>(grad->data_ptr<spec_t>(),
+                          param->data_ptr<spec_t>(), lr, size);
+  } else if (!nesterov) {
+    momentum_update_cpu<spec_t>(
+      grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(),
+      velocity->data_ptr<spec_t>(), lr, momentum, size);
+  } else {
+    nesterov_momentum_update_cpu<spec_t>(
+      grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(),
+      velocity->data_ptr<spec_t>(), lr, momentum, size);
+  }
+}
+
 void SGDUpdateCpu(const NDArray& grad, NDArray& param, NDArray& velocity,
                   float lr, float momentum, bool nesterov,
                   const Stream& stream) {
@@ -69,25 +92,55 @@ void SGDUpdateCpu(const NDArray& grad, NDArray& param, NDArray& velocity,
   if (size == 0)
     return;
   HT_DISPATCH_FLOATING_TYPES(grad->dtype(), spec_t, "SGDUpdateCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
-    [momentum, grad, param, velocity, lr, nesterov, size]() {
-      if (momentum == 0) {
-        sgd_update_cpu<spec_t>(grad->data_ptr<spec_t>(),
-                              param->data_ptr<spec_t>(), lr, size);
-      } else if (!nesterov) {
-        momentum_update_cpu<spec_t>(
-          grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(),
-          velocity->data_ptr<spec_t>(), lr, momentum, size);
-      } else {
-        nesterov_momentum_update_cpu<spec_t>(
-          grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(),
-          velocity->data_ptr<spec_t>(), lr, momentum, size);
-      }
+    cpu_stream.PostTask(
+    [momentum, grad, param, velocity, lr, nesterov, size]() mutable {
+      sgd_update_any_cpu<spec_t>(grad, param, velocity, lr, momentum,
+                                 nesterov, size);
     },"SGDUpdate");
   });
  NDArray::MarkUsedBy({grad, param, velocity}, stream);
 }
 
+// Skips the update when the scaled gradients of this step overflowed,
+// i.e., `infinite_count` (the sum of CheckFinite results) is non-zero.
+// Gradients computed in lower precision are applied to the fp32 master
+// parameters.
+void SGDUpdateWithGradScalerCpu(const NDArray& grad,
+                                const NDArray& infinite_count, NDArray& param,
+                                NDArray& velocity, float lr, float momentum,
+                                bool nesterov, const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(grad);
+  HT_ASSERT_CPU_DEVICE(param);
+  HT_ASSERT_CPU_DEVICE(infinite_count);
+  HT_ASSERT_SAME_SHAPE(grad, param);
+  HT_ASSERT(infinite_count->dtype() == kFloat32)
+    << "Infinite count must be float32, got " << infinite_count->dtype();
+  CPUStream cpu_stream(stream);
+
+  if (momentum != 0) {
+    HT_ASSERT_CPU_DEVICE(velocity);
+    HT_ASSERT_EXCHANGABLE(velocity, param);
+  }
+  size_t size = grad->numel();
+  if (size == 0)
+    return;
+  NDArray grad_ = grad->dtype() == param->dtype()
+    ? grad
+    : NDArray::to(grad, param->device(), param->dtype(), stream.stream_index());
+  HT_DISPATCH_FLOATING_TYPES(
+    param->dtype(), spec_t, "SGDUpdateWithGradScalerCpu", [&]() {
+    cpu_stream.PostTask(
+    [momentum, grad_, infinite_count, param, velocity, lr, nesterov,
+     size]() mutable {
+      if (infinite_count->data_ptr<float>()[0] != 0)
+        return;
+      sgd_update_any_cpu<spec_t>(grad_, param, velocity, lr, momentum,
+                                 nesterov, size);
+    },"SGDUpdateWithGradScaler");
+  });
+  NDArray::MarkUsedBy({grad_, infinite_count, param, velocity}, stream);
+}
+
 template <typename spec_t>
 void adam_update_cpu(const spec_t* grad, spec_t* param, spec_t* mean,
                      spec_t* variance, int64_t step, float lr, float beta1, 
@@ -97,7 +150,7 @@ void adam_update_cpu(const spec_t* grad, spec_t* param, spec_t* mean,
 #endif
   for (size_t idx = 0; idx < size; idx++) {
     mean[idx] = mean[idx] * beta1 + grad[idx] * (1 - beta1);
-    variance[idx] = variance[idx] * beta2 + grad[idx] * (1 - beta2);
+    variance[idx] = variance[idx] * beta2 + grad[idx] * grad[idx] * (1 - beta2);
     spec_t bias1 = spec_t(1 - std::pow(beta1, float(step)));
     spec_t bias2 = std::sqrt(spec_t(1 - std::pow(beta2, float(step))));
     param[idx] -= lr * (mean[idx] / bias1) / 
@@ -125,12 +178,22 @@ void AdamCpu(const NDArray& grad, NDArray& param, NDArray& mean,
     return;
   CPUStream cpu_stream(stream);
   HT_DISPATCH_FLOATING_TYPES(grad->dtype(), spec_t, "AdamUpdateCpu", [&]() {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
     [grad, param, mean, variance, lr, beta1, beta2, weight_decay, eps, step, size]() {
-      adam_update_cpu<spec_t>(
-            grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(), 
-            mean->data_ptr<spec_t>(), variance->data_ptr<spec_t>(), 
-            step->data_ptr<int64_t>()[0], lr, beta1, beta2, eps, weight_decay, size);      
+      int64_t cur_step = step->data_ptr<int64_t>()[0];
+      if (IsVectorizedFloatingType(grad->dtype())) {
+        float bias1 = 1 - std::pow(beta1, float(cur_step));
+        float bias2 = std::sqrt(1 - std::pow(beta2, float(cur_step)));
+        GetVectorizedKernels().adam_update(
+          grad->dtype(), grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(),
+          mean->data_ptr<spec_t>(), variance->data_ptr<spec_t>(), lr, beta1,
+          beta2, eps, bias1, bias2, size);
+      } else {
+        adam_update_cpu<spec_t>(
+              grad->data_ptr<spec_t>(), param->data_ptr<spec_t>(), 
+              mean->data_ptr<spec_t>(), variance->data_ptr<spec_t>(), 
+              cur_step, lr, beta1, beta2, eps, weight_decay, size);
+      }
     },"Adam");
   });
   if (update_step)
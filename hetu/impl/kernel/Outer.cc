@@ -29,7 +29,7 @@ void OuterCpu(const NDArray& inputA, const NDArray& inputB, NDArray& output, con
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     inputA->dtype(), spec_t, "OuterCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [inputA, inputB, output, sizeB, size]() {
       outer_cpu<spec_t>(
         inputA->data_ptr<spec_t>(), inputB->data_ptr<spec_t>(), sizeB, size, output->data_ptr<spec_t>());
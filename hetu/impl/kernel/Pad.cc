@@ -90,7 +90,7 @@ void PadCpu(const NDArray& input, NDArray& output, const HTShape& paddings,
   if (mode == "constant") {
     HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
       input->dtype(), spec_t, "PadCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
+        cpu_stream.PostTask(
         [input, output, endpoint, constant_values]() {
         pad_cpu<spec_t>(input->data_ptr<spec_t>(), output->data_ptr<spec_t>(),
                         endpoint[0], endpoint[1], output->shape(0), endpoint[2],
@@ -139,7 +139,7 @@ void PadGradientCpu(const NDArray& output_grad, NDArray& input_grad,
   if (mode == "constant") {
     HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
       input_grad->dtype(), spec_t, "PadGradientCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
+        cpu_stream.PostTask(
         [input_grad, output_grad, N, C, H, W,
           begin_p, out_N, out_C, out_H, out_W]() {
         pad_gradient_cpu<spec_t>(output_grad->data_ptr<spec_t>(),
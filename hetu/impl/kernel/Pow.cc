@@ -58,23 +58,26 @@ void PowCpu(const NDArray& input, double exponent, NDArray& output,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "PowCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [stream, input, output, exponent]() {
-        dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
         auto mat_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
         auto src_mem = dnnl::memory(mat_md, eng, input->data_ptr<spec_t>());
         auto dst_mem = dnnl::memory(mat_md, eng, output->data_ptr<spec_t>());
 
-        auto Pow_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                      dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(exponent));
-        auto Pow = dnnl::eltwise_forward(Pow_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Eltwise")
+                   .Add(dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(exponent));
+        auto Pow = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                 dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(exponent));
+        });
 
         std::unordered_map<int, dnnl::memory> pow_args;
         pow_args.insert({DNNL_ARG_SRC, src_mem});
         pow_args.insert({DNNL_ARG_DST, dst_mem});      
 
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         Pow.execute(engine_stream, pow_args);
         engine_stream.wait();
       },"Pow");
@@ -0,0 +1,312 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/RowNorm.h"
+#include "hetu/impl/utils/common_utils.h"
+#include "hetu/impl/utils/omp_utils.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include <cmath>
+#include <vector>
+
+namespace hetu {
+namespace impl {
+
+// The per-column parameters (gamma, beta, colscale) may be stored in a wider
+// type than the activations, so they are read and written through float.
+static std::vector<float> to_float_vector(const NDArray& arr) {
+  std::vector<float> values;
+  if (!arr.is_defined())
+    return values;
+  values.resize(arr->numel());
+  HT_DISPATCH_FLOATING_TYPES(arr->dtype(), spec_t, "ToFloatVector", [&]() {
+    const spec_t* ptr = arr->data_ptr<spec_t>();
+    for (size_t i = 0; i < values.size(); ++i)
+      values[i] = static_cast<float>(ptr[i]);
+  });
+  return values;
+}
+
+static void from_float_vector(const std::vector<float>& values,
+                              NDArray& arr) {
+  HT_DISPATCH_FLOATING_TYPES(arr->dtype(), spec_t, "FromFloatVector", [&]() {
+    spec_t* ptr = arr->data_ptr<spec_t>();
+    for (size_t i = 0; i < values.size(); ++i)
+      ptr[i] = spec_t(values[i]);
+  });
+}
+
+// x = x0 * rowscale * colscale + residual, normalized by its mean and
+// variance (LayerNorm) or by its root mean square (RMSNorm).
+template <typename spec_t, typename res_t>
+void dropout_add_ln_fwd_cpu(const spec_t* x0, const res_t* residual,
+                            const spec_t* rowscale, const float* gamma,
+                            const float* beta, const float* colscale,
+                            spec_t* z, res_t* x, float* mu, float* rsigma,
+                            float epsilon, bool is_rms_norm, int64_t rows,
+                            int64_t cols) {
+#ifdef _OPENMP
+#pragma omp parallel if (rows * cols >= kNormParallelGrain)
+#endif
+  {
+    std::vector<float> buffer(cols);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int64_t row = 0; row < rows; ++row) {
+      const int64_t offset = row * cols;
+      const float row_scale =
+        rowscale != nullptr ? static_cast<float>(rowscale[row]) : 1.f;
+      for (int64_t i = 0; i < cols; ++i) {
+        float value = static_cast<float>(x0[offset + i]) * row_scale;
+        if (colscale != nullptr)
+          value *= colscale[i];
+        if (residual != nullptr)
+          value += static_cast<float>(residual[offset + i]);
+        buffer[i] = value;
+        if (x != nullptr)
+          x[offset + i] = res_t(value);
+      }
+      float mean, var;
+      row_moments(buffer.data(), cols, mean, var);
+      // the mean square is var + mean^2
+      float rs =
+        1.f / std::sqrt(var + epsilon + (is_rms_norm ? mean * mean : 0.f));
+      float shift = is_rms_norm ? 0.f : mean;
+      for (int64_t i = 0; i < cols; ++i) {
+        float value = (buffer[i] - shift) * rs * gamma[i];
+        if (beta != nullptr)
+          value += beta[i];
+        z[offset + i] = spec_t(value);
+      }
+      mu[row] = mean;
+      rsigma[row] = rs;
+    }
+  }
+}
+
+void DropoutAddLnFwdCpu(const NDArray& x0, const NDArray& residual_,
+                        const NDArray& gamma, const NDArray& beta_,
+                        const NDArray& rowscale_, const NDArray& colscale_,
+                        const NDArray& x0_subset_, const NDArray& z_subset_,
+                        NDArray& z, NDArray& x, NDArray& dmask, NDArray& mu,
+                        NDArray& rsigma, const float dropout_p,
+                        const float epsilon, const float rowscale_const,
+                        const int64_t z_numrows, bool residual_in_fp32,
+                        bool is_rms_norm, const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(x0);
+  HT_ASSERT_SAME_DEVICE(x0, gamma);
+  HT_ASSERT_SAME_DEVICE(x0, z);
+  HT_ASSERT(x0->ndim() == 2 && x0->is_contiguous());
+  HT_ASSERT(z->is_contiguous() && z->dtype() == x0->dtype());
+  HT_ASSERT(mu->dtype() == kFloat32 && rsigma->dtype() == kFloat32);
+  HT_NOT_IMPLEMENTED_IF(dropout_p > 0.f)
+    << "DropoutAddLnFwdCpu does not support dropout yet.";
+  HT_NOT_IMPLEMENTED_IF(x0_subset_.is_defined() || z_subset_.is_defined())
+    << "DropoutAddLnFwdCpu does not support row subsets.";
+
+  const int64_t rows = x0->shape(0);
+  const int64_t cols = x0->shape(1);
+  HT_ASSERT(gamma->numel() == cols && gamma->is_contiguous());
+  HT_ASSERT(mu->numel() == rows && rsigma->numel() == rows);
+  HT_ASSERT(epsilon >= 0.f);
+  auto rtype = residual_.is_defined()
+    ? residual_->dtype()
+    : (residual_in_fp32 ? kFloat32 : x0->dtype());
+  if (residual_.is_defined()) {
+    HT_ASSERT(residual_->is_contiguous());
+    HT_ASSERT(residual_->shape() == x0->shape());
+  }
+  if (beta_.is_defined())
+    HT_ASSERT(beta_->is_contiguous() && beta_->shape() == gamma->shape());
+  if (rowscale_.is_defined()) {
+    HT_ASSERT(rowscale_->is_contiguous() && rowscale_->numel() == rows);
+    HT_ASSERT(rowscale_->dtype() == x0->dtype());
+  }
+  if (colscale_.is_defined())
+    HT_ASSERT(colscale_->is_contiguous() && colscale_->numel() == cols);
+  if (x.is_defined()) {
+    HT_ASSERT(x->is_contiguous() && x->dtype() == rtype);
+    HT_ASSERT(x->numel() == x0->numel());
+  }
+  if (rows == 0)
+    return;
+
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_FLOATING_TYPES(x0->dtype(), spec_t, "DropoutAddLnFwdCpu", [&]() {
+    HT_DISPATCH_FLOATING_TYPES(rtype, res_t, "DropoutAddLnFwdCpu", [&]() {
+      cpu_stream.PostTask(
+        [x0, residual_, gamma, beta_, rowscale_, colscale_, z, x, mu, rsigma,
+         epsilon, is_rms_norm, rows, cols]() {
+          auto gamma_f = to_float_vector(gamma);
+          auto beta_f = to_float_vector(beta_);
+          auto colscale_f = to_float_vector(colscale_);
+          dropout_add_ln_fwd_cpu<spec_t, res_t>(
+            x0->data_ptr<spec_t>(),
+            residual_.is_defined() ? residual_->data_ptr<res_t>() : nullptr,
+            rowscale_.is_defined() ? rowscale_->data_ptr<spec_t>() : nullptr,
+            gamma_f.data(), beta_.is_defined() ? beta_f.data() : nullptr,
+            colscale_.is_defined() ? colscale_f.data() : nullptr,
+            z->data_ptr<spec_t>(),
+            x.is_defined() ? x->data_ptr<res_t>() : nullptr,
+            mu->data_ptr<float>(), rsigma->data_ptr<float>(), epsilon,
+            is_rms_norm, rows, cols);
+        },
+        "DropoutAddLnFwd");
+    });
+  });
+  NDArray::MarkUsedBy({x0, residual_, gamma, beta_, rowscale_, colscale_, z,
+                       x, mu, rsigma},
+                      stream);
+}
+
+// With y = (x - mu) * rsigma (mu taken as 0 for RMSNorm) and dy = dz * gamma,
+//   dx = rsigma * (dy - y * mean(dy * y) - mean(dy)) + dx_,
+// the mean(dy) term again being dropped for RMSNorm. The gradient then flows
+// back through the residual add, the dropout mask and the scales to x0.
+template <typename spec_t, typename res_t>
+void dropout_add_ln_bwd_cpu(const spec_t* dz, const res_t* dx_,
+                            const res_t* x, const spec_t* x0,
+                            const uint8_t* dmask, const float* mu,
+                            const float* rsigma, const float* gamma,
+                            const spec_t* rowscale, const float* colscale,
+                            spec_t* dx0, res_t* dresidual, float* dgamma,
+                            float* dbeta, float* dcolscale, float dropout_p,
+                            bool is_rms_norm, int64_t rows, int64_t cols) {
+  const float dropout_scale = dropout_p > 0.f ? 1.f / (1.f - dropout_p) : 1.f;
+  const int64_t width = colscale != nullptr ? 3 * cols : 2 * cols;
+  auto sums = parallel_rows_with_column_sums<float>(
+    rows, width, [=](int64_t row, float* partial) {
+      const int64_t offset = row * cols;
+      const float shift = is_rms_norm ? 0.f : mu[row];
+      const float rs = rsigma[row];
+      float sum_dy = 0, sum_dy_y = 0;
+      for (int64_t i = 0; i < cols; ++i) {
+        float grad = static_cast<float>(dz[offset + i]);
+        float y = (static_cast<float>(x[offset + i]) - shift) * rs;
+        float dy = grad * gamma[i];
+        sum_dy += dy;
+        sum_dy_y += dy * y;
+        partial[i] += grad * y;
+        partial[cols + i] += grad;
+      }
+      const float mean_dy = is_rms_norm ? 0.f : sum_dy / cols;
+      const float mean_dy_y = sum_dy_y / cols;
+      const float row_scale =
+        rowscale != nullptr ? static_cast<float>(rowscale[row]) : 1.f;
+      for (int64_t i = 0; i < cols; ++i) {
+        float y = (static_cast<float>(x[offset + i]) - shift) * rs;
+        float dy = static_cast<float>(dz[offset + i]) * gamma[i];
+        float grad = rs * (dy - y * mean_dy_y - mean_dy);
+        if (dx_ != nullptr)
+          grad += static_cast<float>(dx_[offset + i]);
+        if (dresidual != nullptr)
+          dresidual[offset + i] = res_t(grad);
+        if (dmask != nullptr)
+          grad = dmask[offset + i] ? grad * dropout_scale : 0.f;
+        grad *= row_scale;
+        if (colscale != nullptr) {
+          partial[2 * cols + i] += grad * static_cast<float>(x0[offset + i]);
+          grad *= colscale[i];
+        }
+        dx0[offset + i] = spec_t(grad);
+      }
+    });
+  for (int64_t i = 0; i < cols; ++i) {
+    dgamma[i] = sums[i];
+    dbeta[i] = sums[cols + i];
+    if (dcolscale != nullptr)
+      dcolscale[i] = sums[2 * cols + i];
+  }
+}
+
+void DropoutAddLnBwdCpu(const NDArray& dz, const NDArray& dx_,
+                        const NDArray& x, const NDArray& x0_,
+                        const NDArray& dmask_, const NDArray& mu,
+                        const NDArray& rsigma, const NDArray& gamma,
+                        const NDArray& rowscale_, const NDArray& colscale_,
+                        const NDArray& x0_subset_, const NDArray& z_subset_,
+                        NDArray& dx0, NDArray& dresidual, NDArray& dgamma,
+                        NDArray& dbeta, NDArray& dgamma_part,
+                        NDArray& dbeta_part, NDArray& dcolscale,
+                        NDArray& dcolscale_part, const float dropout_p,
+                        const float rowscale_const, const int64_t x0_numrows,
+                        const bool has_residual, bool is_rms_norm,
+                        const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(dz);
+  HT_ASSERT_SAME_DEVICE(dz, gamma);
+  HT_ASSERT_SAME_DEVICE(dz, dx0);
+  HT_ASSERT(x.is_defined())
+    << "DropoutAddLnBwdCpu needs the normalized input x.";
+  HT_ASSERT_SAME_DEVICE(dz, x);
+  HT_ASSERT(dz->ndim() == 2 && dz->is_contiguous());
+  HT_ASSERT(x->is_contiguous() && x->shape() == dz->shape());
+  HT_ASSERT(mu->dtype() == kFloat32 && rsigma->dtype() == kFloat32);
+  HT_NOT_IMPLEMENTED_IF(x0_subset_.is_defined() || z_subset_.is_defined())
+    << "DropoutAddLnBwdCpu does not support row subsets.";
+  if (dropout_p > 0.f)
+    HT_ASSERT(dmask_.is_defined() && dmask_->dtype() == kUInt8 &&
+              dmask_->numel() == dz->numel());
+
+  const int64_t rows = dz->shape(0);
+  const int64_t cols = dz->shape(1);
+  HT_ASSERT(gamma->numel() == cols && gamma->is_contiguous());
+  HT_ASSERT(mu->numel() == rows && rsigma->numel() == rows);
+  HT_ASSERT(dx0->is_contiguous() && dx0->dtype() == dz->dtype());
+  HT_ASSERT(dgamma->numel() == cols && dbeta->numel() == cols);
+  if (dx_.is_defined()) {
+    HT_ASSERT(dx_->is_contiguous() && dx_->dtype() == x->dtype());
+    HT_ASSERT(dx_->shape() == x->shape());
+  }
+  if (has_residual)
+    HT_ASSERT(dresidual->is_contiguous() && dresidual->dtype() == x->dtype());
+  if (rowscale_.is_defined())
+    HT_ASSERT(rowscale_->is_contiguous() && rowscale_->numel() == rows &&
+              rowscale_->dtype() == dz->dtype());
+  if (colscale_.is_defined()) {
+    HT_ASSERT(colscale_->is_contiguous() && colscale_->numel() == cols);
+    HT_ASSERT(x0_.is_defined() && x0_->is_contiguous() &&
+              x0_->dtype() == dz->dtype() && x0_->numel() == dz->numel());
+  }
+  if (rows == 0)
+    return;
+
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_FLOATING_TYPES(dz->dtype(), spec_t, "DropoutAddLnBwdCpu", [&]() {
+    HT_DISPATCH_FLOATING_TYPES(x->dtype(), res_t, "DropoutAddLnBwdCpu", [&]() {
+      cpu_stream.PostTask(
+        [dz, dx_, x, x0_, dmask_, mu, rsigma, gamma, rowscale_, colscale_, dx0,
+         dresidual, dgamma, dbeta, dcolscale, dropout_p, has_residual,
+         is_rms_norm, rows, cols]() mutable {
+          auto gamma_f = to_float_vector(gamma);
+          auto colscale_f = to_float_vector(colscale_);
+          std::vector<float> dgamma_f(cols), dbeta_f(cols), dcolscale_f;
+          if (colscale_.is_defined())
+            dcolscale_f.resize(cols);
+          dropout_add_ln_bwd_cpu<spec_t, res_t>(
+            dz->data_ptr<spec_t>(),
+            dx_.is_defined() ? dx_->data_ptr<res_t>() : nullptr,
+            x->data_ptr<res_t>(),
+            x0_.is_defined() ? x0_->data_ptr<spec_t>() : nullptr,
+            dropout_p > 0.f ? dmask_->data_ptr<uint8_t>() : nullptr,
+            mu->data_ptr<float>(), rsigma->data_ptr<float>(), gamma_f.data(),
+            rowscale_.is_defined() ? rowscale_->data_ptr<spec_t>() : nullptr,
+            colscale_.is_defined() ? colscale_f.data() : nullptr,
+            dx0->data_ptr<spec_t>(),
+            has_residual ? dresidual->data_ptr<res_t>() : nullptr,
+            dgamma_f.data(), dbeta_f.data(),
+            colscale_.is_defined() ? dcolscale_f.data() : nullptr, dropout_p,
+            is_rms_norm, rows, cols);
+          from_float_vector(dgamma_f, dgamma);
+          from_float_vector(dbeta_f, dbeta);
+          if (colscale_.is_defined())
+            from_float_vector(dcolscale_f, dcolscale);
+        },
+        "DropoutAddLnBwd");
+    });
+  });
+  NDArray::MarkUsedBy({dz, dx_, x, x0_, dmask_, mu, rsigma, gamma, rowscale_,
+                       colscale_, dx0, dresidual, dgamma, dbeta, dcolscale},
+                      stream);
+}
+
+} // namespace impl
+} // namespace hetu
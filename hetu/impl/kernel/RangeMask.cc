@@ -24,7 +24,7 @@ void RangeMaskCpu(const NDArray& input, int64_t min, int64_t max,
   size_t size = input->numel();
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "RangeMaskCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, min, max, output, size]() {
         rangemask_cpu<spec_t>(
         input->data_ptr<spec_t>(), min, max, 
@@ -29,23 +29,26 @@ void ReciprocalCpu(const NDArray& input, NDArray& output,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "ReciprocalCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [stream, input, output]() {
-        dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
         auto mat_md = dnnl::memory::desc(input->shape(), dnnl::memory::data_type::f32, input->stride());
         auto src_mem = dnnl::memory(mat_md, eng, input->data_ptr<spec_t>());
         auto dst_mem = dnnl::memory(mat_md, eng, output->data_ptr<spec_t>());
 
-        auto Reciprocal_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                            dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(-1.f));
-        auto Reciprocal = dnnl::eltwise_forward(Reciprocal_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Eltwise")
+                   .Add(dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(-1.f));
+        auto Reciprocal = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(-1.f));
+        });
 
         std::unordered_map<int, dnnl::memory> reciprocal_args;
         reciprocal_args.insert({DNNL_ARG_SRC, src_mem});
         reciprocal_args.insert({DNNL_ARG_DST, dst_mem});      
 
-          dnnl::stream engine_stream(eng);
+          auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
           Reciprocal.execute(engine_stream, reciprocal_args);
           engine_stream.wait();
         },"Reciprocal");
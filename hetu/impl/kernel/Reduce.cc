@@ -28,9 +28,10 @@ void ReduceCpu(const NDArray& input, NDArray& output, const HTAxes& axes,
       out_stride[i] = stride_size;
       stride_size *= out_shape[i];
     }
-    auto _future = cpu_stream.EnqueueTask(
-      [input, output, in_shape, in_stride, out_shape, out_stride, red_type]() {
-        dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+    cpu_stream.PostTask(
+      [stream, input, output, in_shape, in_stride, out_shape, out_stride,
+       red_type]() {
+        auto& eng = hetu::cpu::GetDNNLEngine();
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
         auto src_md = dnnl::memory::desc(in_shape, dnnltype, in_stride);
         auto dst_md = dnnl::memory::desc(out_shape, dnnltype, out_stride);
@@ -51,11 +52,12 @@ void ReduceCpu(const NDArray& input, NDArray& output, const HTAxes& axes,
         }
         else {
           // Create primitive descriptor.
-          auto reduction_pd = dnnl::reduction::primitive_desc(
-                  eng, algo, src_md, dst_md, float(0.f), float(0.f));
-
-          // Create the primitive.
-          auto reduction_prim = dnnl::reduction(reduction_pd);
+          auto key = hetu::cpu::DNNLPrimitiveKey("Reduction")
+                     .Add(algo, src_md, dst_md, float(0.f), float(0.f));
+          auto reduction_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+            return dnnl::reduction::primitive_desc(
+                    eng, algo, src_md, dst_md, float(0.f), float(0.f));
+          });
 
           // Primitive arguments.
           std::unordered_map<int, dnnl::memory> reduction_args;
@@ -63,7 +65,7 @@ void ReduceCpu(const NDArray& input, NDArray& output, const HTAxes& axes,
           reduction_args.insert({DNNL_ARG_DST, dst_mem});
 
           // Primitive execution: Reduction (Sum).
-          dnnl::stream engine_stream(eng);
+          auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
           reduction_prim.execute(engine_stream, reduction_args);
           engine_stream.wait();
         } 
@@ -47,7 +47,7 @@ void RepeatCpu(const NDArray& input, NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_FLOATING_TYPES(
     input->dtype(), spec_t, "RepeatCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, output, size, stride_tmp, shape_tmp, ndim]() {
         repeat_cpu<spec_t>(
         input->data_ptr<spec_t>(), output->data_ptr<spec_t>(), size, stride_tmp.data(), 
@@ -103,7 +103,7 @@ void RepeatGradientCpu(const NDArray& output, NDArray& input, const Stream& stre
 
   HT_DISPATCH_FLOATING_TYPES(
     input->dtype(), spec_t, "RepeatGradientCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, output, size, stride_tmp, shape_tmp, ndim]() {
         array_zero_set_cpu<spec_t>(
                 input->data_ptr<spec_t>(), input->numel());
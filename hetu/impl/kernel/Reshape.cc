@@ -45,7 +45,7 @@ void ReshapeCpu(const NDArray& input, NDArray& output, const Stream& stream) {
   if (input->is_contiguous() && output->is_contiguous()) {
     HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
       input->dtype(), spec_t, "ReshapeCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
+        cpu_stream.PostTask(
           [input, output, size]() {
           memory_copy_cpu<spec_t>(input->data_ptr<spec_t>(),
                                   output->data_ptr<spec_t>(), size);
@@ -55,7 +55,7 @@ void ReshapeCpu(const NDArray& input, NDArray& output, const Stream& stream) {
   else {
     HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
       input->dtype(), spec_t, "ReshapeCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
+        cpu_stream.PostTask(
           [input, output, size]() {
           memory_copy_cpu<spec_t>(input->data_ptr<spec_t>(), output->data_ptr<spec_t>(), 
                                   size, input->ndim(),
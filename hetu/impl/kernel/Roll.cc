@@ -69,7 +69,7 @@ void RollCpu(const NDArray& input, const HTShape& shift, const HTAxes& axis,
 
   HT_DISPATCH_FLOATING_TYPES(
     input->dtype(), spec_t, "RollCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, output, len, nums, shifts, strides, sizes]() {
         roll_cpu<spec_t>(
           input->data_ptr<spec_t>(), output->data_ptr<spec_t>(), 
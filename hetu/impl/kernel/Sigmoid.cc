@@ -1,5 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/dnnl_utils.h"
 #include "hetu/impl/utils/omp_utils.h"
@@ -57,22 +58,25 @@ void SigmoidCpu(const NDArray& input, NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "SigmoidCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [stream, input, output]() {
-          dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+          auto& eng = hetu::cpu::GetDNNLEngine();
           auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
           auto mat_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
           auto src_mem = dnnl::memory(mat_md, eng, input->data_ptr<spec_t>());
           auto dst_mem = dnnl::memory(mat_md, eng, output->data_ptr<spec_t>());
 
-          auto Sigmoid_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                              dnnl::algorithm::eltwise_logistic, mat_md, mat_md, float(0.0), float(0.0));
-          auto Sigmoid = dnnl::eltwise_forward(Sigmoid_pd);
+          auto key = hetu::cpu::DNNLPrimitiveKey("Eltwise")
+                     .Add(dnnl::algorithm::eltwise_logistic, mat_md, mat_md, float(0.0), float(0.0));
+          auto Sigmoid = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+            return dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                     dnnl::algorithm::eltwise_logistic, mat_md, mat_md, float(0.0), float(0.0));
+          });
 
           std::unordered_map<int, dnnl::memory> sigmoid_args;
           sigmoid_args.insert({DNNL_ARG_SRC, src_mem});
           sigmoid_args.insert({DNNL_ARG_DST, dst_mem});
-          dnnl::stream engine_stream(eng);
+          auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
           Sigmoid.execute(engine_stream, sigmoid_args);
           engine_stream.wait();
       }, "Sigmoid");   
@@ -120,9 +124,16 @@ void SigmoidGradientCpu(const NDArray& out_grad, const NDArray& output, NDArray&
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     output->dtype(), spec_t, "SigmoidGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [output, out_grad, in_grad, size]() {
-        if (out_grad->is_contiguous() && output->is_contiguous() && in_grad->is_contiguous()) {
+        if (out_grad->is_contiguous() && output->is_contiguous() &&
+            in_grad->is_contiguous() &&
+            IsVectorizedFloatingType(output->dtype())) {
+          GetVectorizedKernels().sigmoid_gradient(
+            output->dtype(), output->data_ptr<spec_t>(),
+            out_grad->data_ptr<spec_t>(), in_grad->data_ptr<spec_t>(), size);
+        }
+        else if (out_grad->is_contiguous() && output->is_contiguous() && in_grad->is_contiguous()) {
           sigmoid_grad_cpu<spec_t>(
             out_grad->data_ptr<spec_t>(), output->data_ptr<spec_t>(),
             size, in_grad->data_ptr<spec_t>());
@@ -56,7 +56,7 @@ void SinCpu(const NDArray& input, NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "SinCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, size]() {
       if (input->is_contiguous() && output->is_contiguous()) {
         sin_cpu<spec_t>(input->data_ptr<spec_t>(), size,
@@ -121,7 +121,7 @@ void CosCpu(const NDArray& input, NDArray& output, const Stream& stream) {
     return;
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "CosCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output, size]() {
       if (input->is_contiguous() && output->is_contiguous()) {
         cos_cpu<spec_t>(input->data_ptr<spec_t>(), size,
@@ -206,7 +206,7 @@ void SinGradientCpu(const NDArray& input, const NDArray& output_grad,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "SinGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output_grad, input_grad, size]() {
       if (input->is_contiguous() && output_grad->is_contiguous() && input_grad->is_contiguous()) {
         sin_gradient_cpu<spec_t>(
@@ -239,7 +239,7 @@ void CosGradientCpu(const NDArray& input, const NDArray& output_grad,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "CosGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
       [input, output_grad, input_grad, size]() {
       if (input->is_contiguous() && output_grad->is_contiguous() && input_grad->is_contiguous()) {
         cos_gradient_cpu<spec_t>(
@@ -1,35 +1,14 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/StridedCopy.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/omp_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
+#include <cstring>
 
 namespace hetu {
 namespace impl {
 
-// Out-of-place version of slice and its gradient
-/* It is replaced with in-place version. */
-template <typename spec_t>
-void slice_cpu(const spec_t* input, spec_t* output, const int64_t* output_shape,
-               const int64_t* input_shape, const int64_t* begin_pos,
-               size_t ndim, size_t size) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-  for (size_t idx = 0; idx < size; ++idx) {
-    size_t tmp_index = idx;
-    size_t i_index = 0;
-    int64_t i_mat = 1;
-    for (int i = ndim - 1; i >= 0; --i) {
-      int64_t offset = begin_pos[i] + tmp_index % output_shape[i];
-      tmp_index /= output_shape[i];
-      i_index += offset * i_mat;
-      i_mat *= input_shape[i];
-    }
-    output[idx] = input[i_index];
-  }
-}
-
 void slice_quantization(const uint8_t* input, uint8_t* output, const int64_t* output_shape,
                         const int64_t* input_shape, const int64_t* begin_pos,
                         size_t ndim, size_t size) {
@@ -61,29 +40,6 @@ void slice_quantization(const uint8_t* input, uint8_t* output, const int64_t* ou
   }
 }
 
-template <typename spec_t>
-void slice_gradient_cpu(const spec_t* input, spec_t* output,
-                        const int64_t* output_shape, const int64_t* input_shape,
-                        const int64_t* begin_pos, size_t ndim, size_t size) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-  for (size_t idx = 0; idx < size; ++idx) {
-    output[idx] = 0;
-    size_t tmp_index = idx;
-    size_t i_index = 0;
-    int64_t i_mat = 1;
-    for (int i = ndim - 1; i >= 0; --i) {
-      int64_t offset = tmp_index % output_shape[i];
-      if (offset < begin_pos[i] || offset >= begin_pos[i] + input_shape[i]) {}
-      tmp_index /= output_shape[i];
-      i_index += (offset - begin_pos[i]) * i_mat;
-      i_mat *= input_shape[i];
-    }
-    output[idx] = input[i_index];
-  }
-}
-
 void SliceCpu(const NDArray& input, NDArray& output, const HTShape& begin_pos,
               const Stream& stream) {
   HT_ASSERT(input->is_cpu()) << "Input is not on a host device.";
@@ -112,21 +68,24 @@ void SliceCpu(const NDArray& input, NDArray& output, const HTShape& begin_pos,
   HTShape i_shape = input->shape();
   HTShape o_shape = output->shape();
   if (input->dtype() == kFloat4 || input->dtype() == kNFloat4) {
-    auto _future = cpu_stream.EnqueueTask(
+    cpu_stream.PostTask(
         [input, output, o_shape, i_shape, pos, ndim, size]() {
         slice_quantization(input->data_ptr<uint8_t>(), output->data_ptr<uint8_t>(),
                           o_shape.data(), i_shape.data(), pos.data(), ndim, size);
         }, "Slice");
   }
   else {
-    HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
-      input->dtype(), spec_t, "SliceCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
-        [input, output, o_shape, i_shape, pos, ndim, size]() {
-        slice_cpu<spec_t>(input->data_ptr<spec_t>(), output->data_ptr<spec_t>(),
-                          o_shape.data(), i_shape.data(), pos.data(), ndim, size);
-        }, "Slice");
-      });
+    int64_t offset = 0;
+    for (size_t i = 0; i < ndim; ++i)
+      offset += begin_pos[i] * input->stride(i);
+    cpu_stream.PostTask(
+      [input, output, offset]() {
+        const auto* src = static_cast<const uint8_t*>(input->raw_data_ptr()) +
+          offset * DataType2Size(input->dtype());
+        StridedCopy(src, input->stride(), output->raw_data_ptr(),
+                    output->stride(), output->shape(),
+                    DataType2Size(input->dtype()));
+      }, "Slice");
   }
   NDArray::MarkUsedBy({input, output}, stream);
 }
@@ -155,18 +114,27 @@ void SliceGradientCpu(const NDArray& output_grad, NDArray& input_grad,
   if (size == 0)
     return;
   
-  HTShape pos = begin_pos;
-  HTShape i_shape = output_grad->shape();
-  HTShape o_shape = input_grad->shape();
-  HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
-    output_grad->dtype(), spec_t, "SliceGradientCuda", [&]() {
-      cpu_stream.EnqueueTask(
-      [input_grad, output_grad, o_shape, i_shape, pos, ndim, size]() {
-      slice_gradient_cpu<spec_t>(
-        output_grad->data_ptr<spec_t>(), input_grad->data_ptr<spec_t>(),
-        o_shape.data(), i_shape.data(), pos.data(), ndim, size);
-      }, "SliceGradient");
-    });
+  int64_t offset = 0;
+  for (size_t i = 0; i < ndim; ++i)
+    offset += begin_pos[i] * input_grad->stride(i);
+  cpu_stream.PostTask(
+    [input_grad, output_grad, offset]() {
+      auto elem_size = DataType2Size(input_grad->dtype());
+      auto* dst = static_cast<uint8_t*>(input_grad->raw_data_ptr());
+      // positions outside of the slice get no gradient
+      if (input_grad->is_contiguous())
+        std::memset(dst, 0, input_grad->numel() * elem_size);
+      else
+        HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
+          input_grad->dtype(), spec_t, "SliceGradientCpu", [&]() {
+            spec_t zero = 0;
+            StridedCopy(&zero, HTStride(input_grad->ndim(), 0), dst,
+                        input_grad->stride(), input_grad->shape(), elem_size);
+          });
+      StridedCopy(output_grad->raw_data_ptr(), output_grad->stride(),
+                  dst + offset * elem_size, input_grad->stride(),
+                  output_grad->shape(), elem_size);
+    }, "SliceGradient");
   NDArray::MarkUsedBy({output_grad, input_grad}, stream);
 }
 
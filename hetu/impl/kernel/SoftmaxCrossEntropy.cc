@@ -36,11 +36,11 @@ void SoftmaxCrossEntropyCpu(const NDArray& input, const NDArray& label,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "SoftmaxCrossEntropyCuda", [&]() {
-      cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, label, output, workspace, stream, size]() {
-        dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+        auto& eng = hetu::cpu::GetDNNLEngine();
         void* workspace_ptr = workspace->raw_data_ptr();
-        dnnl::stream engine_stream(eng);
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
         auto src_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
         auto dst_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
@@ -49,12 +49,14 @@ void SoftmaxCrossEntropyCpu(const NDArray& input, const NDArray& label,
 
         // Softmax axis.
         const int axis = 1;
-        auto softmax_pd = dnnl::softmax_forward::primitive_desc(eng,
-                          dnnl::prop_kind::forward_training, 
-                          dnnl::algorithm::softmax_log, 
-                          src_md, dst_md, axis);
-
-        auto softmax_prim = dnnl::softmax_forward(softmax_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Softmax")
+                   .Add(dnnl::algorithm::softmax_log, src_md, dst_md, axis);
+        auto softmax_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::softmax_forward::primitive_desc(eng,
+                 dnnl::prop_kind::forward_training, 
+                 dnnl::algorithm::softmax_log, 
+                 src_md, dst_md, axis);
+        });
 
         std::unordered_map<int, dnnl::memory> softmax_args;
         softmax_args.insert({DNNL_ARG_SRC, src_mem});
@@ -81,11 +83,12 @@ void SoftmaxCrossEntropyCpu(const NDArray& input, const NDArray& label,
           hetu::cpu::read_from_dnnl_memory(output->data_ptr<spec_t>(), rsrc_mem);
         else {
           // Create primitive descriptor.
-          auto reduction_pd = dnnl::reduction::primitive_desc(
-                  eng, dnnl::algorithm::reduction_sum, rsrc_md, rdst_md, float(0.f), float(0.f));
-
-          // Create the primitive.
-          auto reduction_prim = dnnl::reduction(reduction_pd);
+          auto key = hetu::cpu::DNNLPrimitiveKey("Reduction")
+                     .Add(dnnl::algorithm::reduction_sum, rsrc_md, rdst_md, float(0.f), float(0.f));
+          auto reduction_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+            return dnnl::reduction::primitive_desc(
+                    eng, dnnl::algorithm::reduction_sum, rsrc_md, rdst_md, float(0.f), float(0.f));
+          });
 
           // Primitive arguments.
           std::unordered_map<int, dnnl::memory> reduction_args;
@@ -129,12 +132,12 @@ void SoftmaxCrossEntropyGradientCpu(const NDArray& input_y,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_y->dtype(), spec_t, "SoftmaxCrossEntropyCuda", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input_y, label, grad, output, workspace, stream, c_, size]() {
         void* workspace_ptr = workspace->raw_data_ptr();
         
-        dnnl::engine eng(dnnl::engine::kind::cpu, 0);
-        dnnl::stream engine_stream(eng);
+        auto& eng = hetu::cpu::GetDNNLEngine();
+        auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
         
         auto src_md = dnnl::memory::desc(input_y->shape(), dnnl::memory::data_type::f32, input_y->stride());
         auto dst_md = dnnl::memory::desc(input_y->shape(), dnnl::memory::data_type::f32, input_y->stride());
@@ -143,12 +146,14 @@ void SoftmaxCrossEntropyGradientCpu(const NDArray& input_y,
 
         // Softmax axis.
         const int axis = 1;
-        auto softmax_pd = dnnl::softmax_forward::primitive_desc(eng,
-                          dnnl::prop_kind::forward_training, 
-                          dnnl::algorithm::softmax_accurate, 
-                          src_md, dst_md, axis);
-
-        auto softmax_prim = dnnl::softmax_forward(softmax_pd);
+        auto key = hetu::cpu::DNNLPrimitiveKey("Softmax")
+                   .Add(dnnl::algorithm::softmax_accurate, src_md, dst_md, axis);
+        auto softmax_prim = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+          return dnnl::softmax_forward::primitive_desc(eng,
+                 dnnl::prop_kind::forward_training, 
+                 dnnl::algorithm::softmax_accurate, 
+                 src_md, dst_md, axis);
+        });
 
         std::unordered_map<int, dnnl::memory> softmax_args;
         softmax_args.insert({DNNL_ARG_SRC, src_mem});
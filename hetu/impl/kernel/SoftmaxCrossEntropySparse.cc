@@ -88,7 +88,7 @@ void SoftmaxCrossEntropySparseCpu(const NDArray& pred, const NDArray& label,
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "SoftmaxCrossEntropySparseCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [pred, label, loss, n_rows, n_cols, ignored_index]() {
         softmax_cross_entropy_sparse_cpu(
           pred->data_ptr<spec_t>(), label->data_ptr<int64_t>(), n_rows, n_cols,
@@ -114,7 +114,7 @@ void SoftmaxCrossEntropySparseGradientCpu(const NDArray& pred, const NDArray& la
     return;
   HT_DISPATCH_FLOATING_TYPES(
     pred->dtype(), spec_t, "SoftmaxCrossEntropySparseGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [pred, label, grad_loss, output, n_rows, n_cols, ignored_index]() {
         softmax_cross_entropy_sparse_gradient_cpu(
           pred->data_ptr<spec_t>(), label->data_ptr<int64_t>(),
@@ -67,23 +67,26 @@ void SqrtCpu(const NDArray& input, NDArray& output, const Stream& stream) {
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "SqrtCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [stream, input, output, size]() {
-          dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+          auto& eng = hetu::cpu::GetDNNLEngine();
           auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
           auto mat_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
           auto src_mem = dnnl::memory(mat_md, eng, input->data_ptr<spec_t>());
           auto dst_mem = dnnl::memory(mat_md, eng, output->data_ptr<spec_t>());
 
-          auto Sqrt_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                              dnnl::algorithm::eltwise_sqrt, mat_md, mat_md);
-          auto Sqrt = dnnl::eltwise_forward(Sqrt_pd);
+          auto key = hetu::cpu::DNNLPrimitiveKey("Eltwise")
+                     .Add(dnnl::algorithm::eltwise_sqrt, mat_md, mat_md);
+          auto Sqrt = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+            return dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                        dnnl::algorithm::eltwise_sqrt, mat_md, mat_md);
+          });
 
           std::unordered_map<int, dnnl::memory> sqrt_args;
           sqrt_args.insert({DNNL_ARG_SRC, src_mem});
           sqrt_args.insert({DNNL_ARG_DST, dst_mem});      
 
-          dnnl::stream engine_stream(eng);
+          auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
           Sqrt.execute(engine_stream, sqrt_args);
           engine_stream.wait();
         },"Sqrt");
@@ -103,23 +106,26 @@ void ReciprocalSqrtCpu(const NDArray& output_grad, NDArray& input_grad,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input_grad->dtype(), spec_t, "ReciprocalSqrtCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [stream, input_grad, output_grad, size]() {
-          dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+          auto& eng = hetu::cpu::GetDNNLEngine();
           auto dnnltype = hetu::cpu::dtype_to_dnnltype(input_grad->dtype());
           auto mat_md = dnnl::memory::desc(input_grad->shape(), dnnltype, input_grad->stride());
           auto src_mem = dnnl::memory(mat_md, eng, output_grad->data_ptr<spec_t>());
           auto dst_mem = dnnl::memory(mat_md, eng, input_grad->data_ptr<spec_t>());
 
-          auto Reciprocal_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                              dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(-0.5));
-          auto Reciprocal = dnnl::eltwise_forward(Reciprocal_pd);
+          auto key = hetu::cpu::DNNLPrimitiveKey("Eltwise")
+                     .Add(dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(-0.5));
+          auto Reciprocal = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+            return dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                  dnnl::algorithm::eltwise_pow, mat_md, mat_md, float(1.0), float(-0.5));
+          });
 
           std::unordered_map<int, dnnl::memory> sqrt_args;
           sqrt_args.insert({DNNL_ARG_SRC, src_mem});
           sqrt_args.insert({DNNL_ARG_DST, dst_mem});      
 
-          dnnl::stream engine_stream(eng);
+          auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
           Reciprocal.execute(engine_stream, sqrt_args);
           engine_stream.wait();
         },"ReciprocalSqrt");
@@ -53,7 +53,7 @@ void SwigluCpu(const NDArray& input, NDArray& output, const Stream& stream) {
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "SwigluCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, output, size, d_size]() {
           if (input->is_contiguous() && output->is_contiguous()) {
             swiglu_cpu<spec_t>(input->data_ptr<spec_t>(), size, d_size,
@@ -129,7 +129,7 @@ void SwigluGradientCpu(const NDArray& input, const NDArray& output_grad,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "SwigluGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, input_grad, output_grad, size, d_size]() {
           if (input->is_contiguous() && input_grad->is_contiguous() 
                   && output_grad->is_contiguous()) {
@@ -1,5 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/dnnl_utils.h"
 #include "hetu/impl/utils/omp_utils.h"
@@ -68,7 +69,7 @@ void tanh_gradient_cpu(const spec_t* input, const spec_t* output_grad,
     int64_t o_idx = hetu::impl::get_index(idx, ndims, stride, c_shape);
     int64_t og_idx = hetu::impl::get_index(idx, ndims, stride_out, c_shape);
     int64_t ig_idx = hetu::impl::get_index(idx, ndims, stride_in, c_shape);
-    output[idx] = (1 - input[idx] * input[idx]) * output_grad[idx];
+    output[ig_idx] = (1 - input[o_idx] * input[o_idx]) * output_grad[og_idx];
   }
 }
 
@@ -83,23 +84,26 @@ void TanhCpu(const NDArray& input, NDArray& output, const Stream& stream) {
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "TanhCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [stream, input, output, size]() {
-          dnnl::engine eng(dnnl::engine::kind::cpu, 0);
+          auto& eng = hetu::cpu::GetDNNLEngine();
           auto dnnltype = hetu::cpu::dtype_to_dnnltype(input->dtype());
           auto mat_md = dnnl::memory::desc(input->shape(), dnnltype, input->stride());
           auto src_mem = dnnl::memory(mat_md, eng, input->data_ptr<spec_t>());
           auto dst_mem = dnnl::memory(mat_md, eng, output->data_ptr<spec_t>());
 
-          auto Tanh_pd = dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
-                              dnnl::algorithm::eltwise_tanh, mat_md, mat_md, float(0.0), float(0.0));
-          auto Tanh = dnnl::eltwise_forward(Tanh_pd);
+          auto key = hetu::cpu::DNNLPrimitiveKey("Eltwise")
+                     .Add(dnnl::algorithm::eltwise_tanh, mat_md, mat_md, float(0.0), float(0.0));
+          auto Tanh = hetu::cpu::GetOrCreateDNNLPrimitive(key, [&]() {
+            return dnnl::eltwise_forward::primitive_desc(eng, dnnl::prop_kind::forward_training,
+                        dnnl::algorithm::eltwise_tanh, mat_md, mat_md, float(0.0), float(0.0));
+          });
 
           std::unordered_map<int, dnnl::memory> tanh_args;
           tanh_args.insert({DNNL_ARG_SRC, src_mem});
           tanh_args.insert({DNNL_ARG_DST, dst_mem});      
 
-          dnnl::stream engine_stream(eng);
+          auto& engine_stream = hetu::cpu::GetDNNLStream(stream);
           Tanh.execute(engine_stream, tanh_args);
           engine_stream.wait();
           engine_stream.wait();
@@ -123,9 +127,17 @@ void TanhGradientCpu(const NDArray& input, const NDArray& output_grad,
   CPUStream cpu_stream(stream);
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     input->dtype(), spec_t, "TanhGradientCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [input, output_grad, input_grad, size]() {
-        if (input->is_contiguous() && output_grad->is_contiguous() && input_grad->is_contiguous()) {
+        if (input->is_contiguous() && output_grad->is_contiguous() &&
+            input_grad->is_contiguous() &&
+            IsVectorizedFloatingType(input->dtype())) {
+          GetVectorizedKernels().tanh_gradient(
+            input->dtype(), input->data_ptr<spec_t>(),
+            output_grad->data_ptr<spec_t>(), input_grad->data_ptr<spec_t>(),
+            size);
+        }
+        else if (input->is_contiguous() && output_grad->is_contiguous() && input_grad->is_contiguous()) {
           tanh_gradient_cpu<spec_t>(input->data_ptr<spec_t>(),
                                     output_grad->data_ptr<spec_t>(), size,
                                     input_grad->data_ptr<spec_t>());
@@ -1,5 +1,6 @@
 #include "hetu/core/ndarray.h"
 #include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/StridedCopy.h"
 #include "hetu/impl/utils/common_utils.h"
 #include "hetu/impl/utils/omp_utils.h"
 #include "hetu/impl/stream/CPUStream.h"
@@ -7,29 +8,6 @@
 namespace hetu {
 namespace impl {
 
-// Out-of-place version of transpose and its gradient
-/* It is replaced with in-place version. */
-template <typename spec_t>
-void transpose_cpu(const spec_t* input, spec_t* output, const int64_t* buf,
-                   uint32_t ndims, size_t size) {
-#ifdef _OPENMP
-#pragma omp parallel for schedule(static)
-#endif
-  for (size_t idx = 0; idx < size; ++idx) {
-    const auto* in_strides = buf;
-    const auto* out_strides = buf + ndims;
-    const auto* perm = buf + ndims * 2;
-    uint32_t i_idx = 0;
-    uint32_t t = idx;
-    for (uint32_t i = 0; i < ndims; ++i) {
-      const uint32_t ratio = t / out_strides[i];
-      t -= ratio * out_strides[i];
-      i_idx += ratio * in_strides[perm[i]];
-    }
-    output[idx] = input[i_idx];
-  }
-}
-
 void transpose_quantization(const uint8_t* input, uint8_t* output, const int64_t* buf,
                             uint32_t ndims, size_t size) {
 #ifdef _OPENMP
@@ -71,36 +49,42 @@ void TransposeCpu(const NDArray& input, NDArray& output, const HTAxes& perm,
   auto ndim = static_cast<uint32_t>(input->ndim());
   auto ndim_ = static_cast<uint32_t>(output->ndim());
   HT_ASSERT(ndim == ndim_);
-  HTShape buf(3 * ndim);
-  int64_t in_stride = 1;
-  int64_t out_stride = 1;
-  for (int i = ndim - 1; i >= 0; --i) {
-    buf[i] = in_stride;
-    buf[ndim + i] = out_stride;
-    buf[ndim * 2 + i] = perm[i];
-    in_stride *= input->shape(i);
-    out_stride *= output->shape(i);
-  }
-  HT_ASSERT(in_stride == out_stride);
-  size_t size = in_stride;
+  HT_ASSERT(perm.size() == ndim);
+  for (uint32_t i = 0; i < ndim; ++i)
+    HT_ASSERT(output->shape(i) == input->shape(perm[i]))
+      << "Cannot transpose " << input->shape() << " into " << output->shape()
+      << " with perm " << perm;
+  size_t size = input->numel();
   if (size == 0)
     return;
   if (input->dtype() == kFloat4 || input->dtype() == kNFloat4) {
-    auto _future = cpu_stream.EnqueueTask(
+    HTShape buf(3 * ndim);
+    int64_t in_stride = 1;
+    int64_t out_stride = 1;
+    for (int i = ndim - 1; i >= 0; --i) {
+      buf[i] = in_stride;
+      buf[ndim + i] = out_stride;
+      buf[ndim * 2 + i] = perm[i];
+      in_stride *= input->shape(i);
+      out_stride *= output->shape(i);
+    }
+    cpu_stream.PostTask(
         [input, output, buf, ndim ,size]() {
         transpose_quantization(input->data_ptr<uint8_t>(), output->data_ptr<uint8_t>(),
                                buf.data(), ndim, size);
         }, "Transpose");
   }
   else {
-    HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
-      input->dtype(), spec_t, "TransposeCpu", [&]() {
-        cpu_stream.EnqueueTask(
-          [input, output, buf, ndim ,size]() {
-          transpose_cpu<spec_t>(input->data_ptr<spec_t>(),
-                                output->data_ptr<spec_t>(), buf.data(), ndim, size);
-          },"Transpose");
-      });
+    // output dim i walks input dim perm[i]
+    HTStride in_stride(ndim);
+    for (uint32_t i = 0; i < ndim; ++i)
+      in_stride[i] = input->stride(perm[i]);
+    cpu_stream.PostTask(
+      [input, output, in_stride]() {
+        StridedCopy(input->raw_data_ptr(), in_stride, output->raw_data_ptr(),
+                    output->stride(), output->shape(),
+                    DataType2Size(input->dtype()));
+      },"Transpose");
   }
   NDArray::MarkUsedBy({input, output}, stream);
 }
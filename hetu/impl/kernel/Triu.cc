@@ -52,7 +52,7 @@ void TriuTrilCpu(const NDArray& input, NDArray& output, bool lower,
   if (input->is_contiguous() && output->is_contiguous()) {
     HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
       input->dtype(), spec_t, "TriuTrilCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
+        cpu_stream.PostTask(
           [input, output, lower, H, W, diagonal, size]() {
           triutril_cpu<spec_t>(
             input->data_ptr<spec_t>(), output->data_ptr<spec_t>(), 
@@ -63,7 +63,7 @@ void TriuTrilCpu(const NDArray& input, NDArray& output, bool lower,
   else {
     HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
       input->dtype(), spec_t, "TriuTrilCpu", [&]() {
-        auto _future = cpu_stream.EnqueueTask(
+        cpu_stream.PostTask(
           [input, output, lower, H, W, diagonal, size]() {
           triutril_cpu<spec_t>(
             input->data_ptr<spec_t>(), output->data_ptr<spec_t>(), 
@@ -0,0 +1,54 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/core/stream.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include "hetu/impl/utils/common_utils.h"
+
+namespace hetu {
+namespace impl {
+
+// Dynamic loss scaling: backs off the scale when this step found inf/nan
+// gradients, and grows it after `growth_interval` successful steps.
+void UpdateScaleCpu(NDArray& scale, NDArray& growth_tracker,
+                    const NDArray& found_inf, double growth_factor,
+                    double backoff_factor, int growth_interval,
+                    const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(scale);
+  HT_ASSERT_SAME_DEVICE(scale, growth_tracker);
+  HT_ASSERT_SAME_DEVICE(scale, found_inf);
+  HT_ASSERT(growth_tracker->dtype() == kInt32 &&
+            found_inf->dtype() == kFloat32)
+    << "UpdateScale expects an int32 growth tracker and a float32 "
+    << "inf count, got " << growth_tracker->dtype() << " and "
+    << found_inf->dtype();
+
+  size_t size = scale->numel();
+  if (size == 0)
+    return;
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
+    scale->dtype(), spec_t, "UpdateScaleCpu", [&]() {
+      cpu_stream.PostTask(
+        [scale, growth_tracker, found_inf, growth_factor, backoff_factor,
+         growth_interval]() {
+          spec_t* scale_ptr = scale->data_ptr<spec_t>();
+          int* tracker = growth_tracker->data_ptr<int>();
+          if (found_inf->data_ptr<float>()[0]) {
+            *scale_ptr = static_cast<spec_t>(*scale_ptr * backoff_factor);
+            *tracker = 0;
+          } else {
+            int successful = *tracker + 1;
+            if (successful == growth_interval) {
+              *scale_ptr = static_cast<spec_t>(*scale_ptr * growth_factor);
+              *tracker = 0;
+            } else {
+              *tracker = successful;
+            }
+          }
+        },
+        "UpdateScale");
+    });
+  NDArray::MarkUsedBy({scale, growth_tracker, found_inf}, stream);
+}
+
+} // namespace impl
+} // namespace hetu
@@ -31,7 +31,7 @@ void WhereCpu(const NDArray& cond, const NDArray& inputA, const NDArray& inputB,
   size_t size = cond->numel();
   HT_DISPATCH_INTEGER_AND_FLOATING_TYPES(
     inputA->dtype(), spec_t, "WhereCpu", [&]() {
-      auto _future = cpu_stream.EnqueueTask(
+      cpu_stream.PostTask(
         [cond, inputA, inputB, output, size]() {
         where_cpu<spec_t>(cond->data_ptr<int64_t>(), inputA->data_ptr<spec_t>(),
                           inputB->data_ptr<spec_t>(), output->data_ptr<spec_t>(),
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "hetu/impl/utils/omp_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace hetu {
+namespace impl {
+
+/******************************************************
+ * Helpers shared by the row-wise normalization kernels on CPU (LayerNorm,
+ * DropoutAddLn). A tensor is viewed as [rows, cols] with the normalized dims
+ * flattened into cols, and rows are processed independently by the threads.
+ ******************************************************/
+
+// Half and single precision rows are accumulated in float.
+template <typename spec_t>
+using norm_acc_t =
+  typename std::conditional<std::is_same<spec_t, double>::value, double,
+                            float>::type;
+
+// Below this many elements forking the OpenMP team costs more than it saves.
+constexpr int64_t kNormParallelGrain = 32768;
+
+// Computes the mean and the biased variance of a row in one pass.
+//
+// Welford's update is inherently serial, so the row is split over kLanes
+// interleaved streams that advance in lockstep (and vectorize), which are
+// merged with Chan's formula before the tail is folded in.
+template <typename spec_t, typename acc_t = norm_acc_t<spec_t>>
+inline void row_moments(const spec_t* x, int64_t n, acc_t& mean, acc_t& var) {
+  constexpr int kLanes = 16;
+  acc_t lane_mean[kLanes] = {0}, lane_m2[kLanes] = {0};
+  const int64_t chunks = n / kLanes;
+  for (int64_t c = 0; c < chunks; c++) {
+    const acc_t inv_count = acc_t(1) / acc_t(c + 1);
+    const spec_t* ptr = x + c * kLanes;
+    for (int l = 0; l < kLanes; l++) {
+      acc_t v = static_cast<acc_t>(ptr[l]);
+      acc_t delta = v - lane_mean[l];
+      lane_mean[l] += delta * inv_count;
+      lane_m2[l] += delta * (v - lane_mean[l]);
+    }
+  }
+  // all lanes hold the same count, so pairs merge with equal weights
+  acc_t count = acc_t(chunks);
+  for (int width = kLanes / 2; width > 0; width /= 2) {
+    for (int l = 0; l < width; l++) {
+      acc_t delta = lane_mean[l + width] - lane_mean[l];
+      lane_mean[l] += delta * acc_t(0.5);
+      lane_m2[l] += lane_m2[l + width] + delta * delta * count * acc_t(0.5);
+    }
+    count *= 2;
+  }
+  mean = lane_mean[0];
+  acc_t m2 = lane_m2[0];
+  for (int64_t i = chunks * kLanes; i < n; i++) {
+    acc_t v = static_cast<acc_t>(x[i]);
+    count += 1;
+    acc_t delta = v - mean;
+    mean += delta / count;
+    m2 += delta * (v - mean);
+  }
+  var = n > 0 ? m2 / acc_t(n) : acc_t(0);
+}
+
+// Runs f(row, partial) for every row in [0, rows), in parallel over the rows,
+// where `partial` points to `width` zero-initialized accumulators private to
+// the calling thread. Returns the sums of the accumulators over the threads,
+// which is how the kernels reduce the gradients of per-column parameters
+// without atomics.
+template <typename acc_t, typename F>
+std::vector<acc_t> parallel_rows_with_column_sums(int64_t rows, int64_t width,
+                                                  const F& f) {
+  int num_threads = 1;
+#ifdef _OPENMP
+  if (rows * width >= kNormParallelGrain)
+    num_threads = std::max(1, std::min<int>(omp_get_max_threads(), rows));
+#endif
+  std::vector<acc_t> partials(static_cast<size_t>(num_threads) * width, 0);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+  {
+    acc_t* partial = partials.data() + hetu::omp::OMP_GET_THREAD_ID() * width;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int64_t row = 0; row < rows; row++)
+      f(row, partial);
+  }
+  for (int t = 1; t < num_threads; t++) {
+    const acc_t* partial = partials.data() + t * width;
+    for (int64_t i = 0; i < width; i++)
+      partials[i] += partial[i];
+  }
+  partials.resize(width);
+  return partials;
+}
+
+} // namespace impl
+} // namespace hetu
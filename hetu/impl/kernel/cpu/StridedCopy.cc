@@ -0,0 +1,261 @@
+#include "hetu/impl/kernel/cpu/StridedCopy.h"
+#include "hetu/impl/utils/dispatch.h"
+#include "hetu/impl/utils/omp_utils.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace hetu {
+namespace impl {
+
+namespace {
+
+// Side of the square tiles used for transposed pairs of dims, small enough
+// for a tile of each side to stay in L1.
+constexpr int64_t kStridedCopyTile = 32;
+constexpr int64_t kStridedCopyParallelGrain = 32768;
+
+// A copy after coalescing, outermost dim first. When `tiled` is set, the
+// last two dims are copied in 2D tiles.
+struct CopyLayout {
+  HTShape shape;
+  HTStride src_stride;
+  HTStride dst_stride;
+  bool tiled = false;
+
+  int64_t ndim() const {
+    return shape.size();
+  }
+};
+
+CopyLayout MakeCopyLayout(const HTShape& shape, const HTStride& src_stride,
+                          const HTStride& dst_stride) {
+  const int64_t ndim = shape.size();
+  HT_ASSERT(static_cast<int64_t>(src_stride.size()) == ndim &&
+            static_cast<int64_t>(dst_stride.size()) == ndim)
+    << "Strides " << src_stride << " and " << dst_stride
+    << " do not match shape " << shape;
+  HTAxes dims;
+  for (int64_t i = 0; i < ndim; ++i)
+    if (shape[i] != 1)
+      dims.push_back(i);
+  // walk the destination in memory order
+  std::stable_sort(dims.begin(), dims.end(), [&](int64_t a, int64_t b) {
+    if (dst_stride[a] != dst_stride[b])
+      return dst_stride[a] > dst_stride[b];
+    return src_stride[a] > src_stride[b];
+  });
+
+  CopyLayout layout;
+  for (auto d : dims) {
+    if (!layout.shape.empty() &&
+        layout.src_stride.back() == src_stride[d] * shape[d] &&
+        layout.dst_stride.back() == dst_stride[d] * shape[d]) {
+      layout.shape.back() *= shape[d];
+      layout.src_stride.back() = src_stride[d];
+      layout.dst_stride.back() = dst_stride[d];
+    } else {
+      layout.shape.push_back(shape[d]);
+      layout.src_stride.push_back(src_stride[d]);
+      layout.dst_stride.push_back(dst_stride[d]);
+    }
+  }
+  if (layout.shape.empty()) {
+    layout.shape = {1};
+    layout.src_stride = {1};
+    layout.dst_stride = {1};
+  }
+
+  // If some outer dim is denser than the innermost one on the source side,
+  // move it next to the innermost dim and copy the pair in tiles.
+  const int64_t last = layout.ndim() - 1;
+  int64_t best = -1;
+  for (int64_t i = 0; i < last; ++i)
+    if (best < 0 || layout.src_stride[i] < layout.src_stride[best])
+      best = i;
+  if (best >= 0 && layout.src_stride[best] < layout.src_stride[last]) {
+    for (auto* v : {&layout.shape, &layout.src_stride, &layout.dst_stride})
+      std::rotate(v->begin() + best, v->begin() + best + 1,
+                  v->begin() + last);
+    layout.tiled = true;
+  }
+  return layout;
+}
+
+struct CopyOp {
+  static constexpr bool kMemcpy = true;
+  template <typename spec_t>
+  inline void operator()(spec_t& dst, const spec_t& src) const {
+    dst = src;
+  }
+};
+
+struct AccumulateOp {
+  static constexpr bool kMemcpy = false;
+  template <typename spec_t>
+  inline void operator()(spec_t& dst, const spec_t& src) const {
+    dst += src;
+  }
+};
+
+template <typename spec_t, typename Op>
+void strided_apply(const CopyLayout& layout, const spec_t* src, spec_t* dst,
+                   Op op, bool parallel) {
+  const int64_t ndim = layout.ndim();
+  const int64_t inner = layout.shape[ndim - 1];
+  const int64_t src_inner = layout.src_stride[ndim - 1];
+  const int64_t dst_inner = layout.dst_stride[ndim - 1];
+
+  // The loop dims are all dims but the innermost one. In tiled mode the
+  // second innermost dim is walked block by block.
+  const int64_t num_loops = ndim - 1;
+  HTShape loop_shape(layout.shape.begin(), layout.shape.end() - 1);
+  HTStride src_loop(layout.src_stride.begin(), layout.src_stride.end() - 1);
+  HTStride dst_loop(layout.dst_stride.begin(), layout.dst_stride.end() - 1);
+  int64_t tile_rows = 0, src_row = 0, dst_row = 0;
+  if (layout.tiled) {
+    tile_rows = loop_shape[num_loops - 1];
+    src_row = src_loop[num_loops - 1];
+    dst_row = dst_loop[num_loops - 1];
+    loop_shape[num_loops - 1] =
+      (tile_rows + kStridedCopyTile - 1) / kStridedCopyTile;
+    src_loop[num_loops - 1] *= kStridedCopyTile;
+    dst_loop[num_loops - 1] *= kStridedCopyTile;
+  }
+  const int64_t num_tasks = std::accumulate(
+    loop_shape.begin(), loop_shape.end(), int64_t(1), std::multiplies<int64_t>());
+
+  auto run = [&](int64_t begin, int64_t end) {
+    if (begin >= end)
+      return;
+    HTShape index(num_loops);
+    int64_t src_offset = 0, dst_offset = 0;
+    for (int64_t i = num_loops - 1, t = begin; i >= 0; --i) {
+      index[i] = t % loop_shape[i];
+      t /= loop_shape[i];
+      src_offset += index[i] * src_loop[i];
+      dst_offset += index[i] * dst_loop[i];
+    }
+    for (int64_t task = begin; task < end; ++task) {
+      const spec_t* s = src + src_offset;
+      spec_t* d = dst + dst_offset;
+      if (layout.tiled) {
+        const int64_t rows = std::min(
+          kStridedCopyTile, tile_rows - index[num_loops - 1] * kStridedCopyTile);
+        for (int64_t j0 = 0; j0 < inner; j0 += kStridedCopyTile) {
+          const int64_t cols = std::min(kStridedCopyTile, inner - j0);
+          for (int64_t i = 0; i < rows; ++i) {
+            const spec_t* s_row = s + i * src_row + j0 * src_inner;
+            spec_t* d_row = d + i * dst_row + j0 * dst_inner;
+            for (int64_t j = 0; j < cols; ++j)
+              op(d_row[j * dst_inner], s_row[j * src_inner]);
+          }
+        }
+      } else if (src_inner == 1 && dst_inner == 1) {
+        if (Op::kMemcpy) {
+          std::memcpy(d, s, inner * sizeof(spec_t));
+        } else {
+          for (int64_t j = 0; j < inner; ++j)
+            op(d[j], s[j]);
+        }
+      } else {
+        for (int64_t j = 0; j < inner; ++j)
+          op(d[j * dst_inner], s[j * src_inner]);
+      }
+      // advance the odometer
+      for (int64_t i = num_loops - 1; i >= 0; --i) {
+        src_offset += src_loop[i];
+        dst_offset += dst_loop[i];
+        if (++index[i] < loop_shape[i])
+          break;
+        src_offset -= src_loop[i] * loop_shape[i];
+        dst_offset -= dst_loop[i] * loop_shape[i];
+        index[i] = 0;
+      }
+    }
+  };
+
+#ifdef _OPENMP
+  const int64_t numel = num_tasks * inner *
+    (layout.tiled ? std::min(tile_rows, kStridedCopyTile) : 1);
+  if (parallel && numel >= kStridedCopyParallelGrain) {
+    if (num_tasks == 1 && ndim == 1 && src_inner == 1 && dst_inner == 1) {
+      // a single contiguous run, split it instead
+#pragma omp parallel
+      {
+        const int64_t chunk =
+          (inner + omp_get_num_threads() - 1) / omp_get_num_threads();
+        const int64_t begin = std::min(inner, chunk * omp_get_thread_num());
+        const int64_t end = std::min(inner, begin + chunk);
+        for (int64_t j = begin; j < end; j += kStridedCopyParallelGrain) {
+          const int64_t n = std::min(kStridedCopyParallelGrain, end - j);
+          if (Op::kMemcpy) {
+            std::memcpy(dst + j, src + j, n * sizeof(spec_t));
+          } else {
+            for (int64_t k = j; k < j + n; ++k)
+              op(dst[k], src[k]);
+          }
+        }
+      }
+      return;
+    }
+#pragma omp parallel
+    {
+      const int64_t chunk =
+        (num_tasks + omp_get_num_threads() - 1) / omp_get_num_threads();
+      const int64_t begin = std::min(num_tasks, chunk * omp_get_thread_num());
+      run(begin, std::min(num_tasks, begin + chunk));
+    }
+    return;
+  }
+#endif
+  run(0, num_tasks);
+}
+
+} // namespace
+
+void StridedCopy(const void* src, const HTStride& src_stride, void* dst,
+                 const HTStride& dst_stride, const HTShape& shape,
+                 size_t elem_size) {
+  for (auto n : shape)
+    if (n == 0)
+      return;
+  auto layout = MakeCopyLayout(shape, src_stride, dst_stride);
+  switch (elem_size) {
+    case 1:
+      strided_apply(layout, static_cast<const uint8_t*>(src),
+                    static_cast<uint8_t*>(dst), CopyOp(), true);
+      break;
+    case 2:
+      strided_apply(layout, static_cast<const uint16_t*>(src),
+                    static_cast<uint16_t*>(dst), CopyOp(), true);
+      break;
+    case 4:
+      strided_apply(layout, static_cast<const uint32_t*>(src),
+                    static_cast<uint32_t*>(dst), CopyOp(), true);
+      break;
+    case 8:
+      strided_apply(layout, static_cast<const uint64_t*>(src),
+                    static_cast<uint64_t*>(dst), CopyOp(), true);
+      break;
+    default:
+      HT_VALUE_ERROR << "StridedCopy does not support elements of "
+                     << elem_size << " bytes";
+  }
+}
+
+void StridedAccumulate(DataType dtype, const void* src,
+                       const HTStride& src_stride, void* dst,
+                       const HTStride& dst_stride, const HTShape& shape) {
+  for (auto n : shape)
+    if (n == 0)
+      return;
+  auto layout = MakeCopyLayout(shape, src_stride, dst_stride);
+  HT_DISPATCH_FLOATING_TYPES(dtype, spec_t, "StridedAccumulate", [&]() {
+    strided_apply(layout, static_cast<const spec_t*>(src),
+                  static_cast<spec_t*>(dst), AccumulateOp(), false);
+  });
+}
+
+} // namespace impl
+} // namespace hetu
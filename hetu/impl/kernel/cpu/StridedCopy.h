@@ -0,0 +1,36 @@
+#pragma once
+
+#include "hetu/core/dtype.h"
+#include "hetu/core/ndarray_meta.h"
+
+namespace hetu {
+namespace impl {
+
+/******************************************************
+ * Strided copies on CPU, shared by the layout kernels (Transpose,
+ * Contiguous, AsStrided, Slice and their gradients).
+ *
+ * Both sides are views of `shape` elements with their own strides, given in
+ * elements. Before copying, size-1 dims are dropped, dims are ordered by the
+ * destination strides and neighbours that are contiguous on both sides are
+ * merged. Then
+ *   - runs contiguous on both sides are copied with memcpy,
+ *   - if the destination walks the innermost dim while the source walks
+ *     another one, that pair is copied in cache-sized 2D tiles,
+ *   - everything outside the innermost run (or tile) is split across
+ *     OpenMP threads.
+ ******************************************************/
+
+// dst = src. The destination must not overlap itself or the source.
+void StridedCopy(const void* src, const HTStride& src_stride, void* dst,
+                 const HTStride& dst_stride, const HTShape& shape,
+                 size_t elem_size);
+
+// dst += src, for the gradients of views whose elements may alias
+// (e.g., zero strides). Runs serially.
+void StridedAccumulate(DataType dtype, const void* src,
+                       const HTStride& src_stride, void* dst,
+                       const HTStride& dst_stride, const HTShape& shape);
+
+} // namespace impl
+} // namespace hetu
@@ -0,0 +1,35 @@
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
+
+namespace hetu {
+namespace impl {
+
+// defined in VectorizedKernels{Default,AVX2,AVX512}.cc
+const VectorizedKernels* GetVectorizedKernelsDefault();
+const VectorizedKernels* GetVectorizedKernelsAVX2();
+const VectorizedKernels* GetVectorizedKernelsAVX512();
+
+const VectorizedKernels* GetVectorizedKernels(CPUCapability capability) {
+  switch (capability) {
+    case CPUCapability::DEFAULT: return GetVectorizedKernelsDefault();
+    case CPUCapability::AVX2: return GetVectorizedKernelsAVX2();
+    case CPUCapability::AVX512: return GetVectorizedKernelsAVX512();
+    default: return nullptr;
+  }
+}
+
+const VectorizedKernels& GetVectorizedKernels() {
+  static const VectorizedKernels* kernels = []() {
+    CPUCapability capability = GetCPUCapability();
+    const VectorizedKernels* ret = GetVectorizedKernels(capability);
+    while (ret == nullptr) {
+      capability = static_cast<CPUCapability>(static_cast<int>(capability) - 1);
+      ret = GetVectorizedKernels(capability);
+    }
+    HT_LOG_DEBUG << "Using " << capability << " CPU vectorized kernels";
+    return ret;
+  }();
+  return *kernels;
+}
+
+} // namespace impl
+} // namespace hetu
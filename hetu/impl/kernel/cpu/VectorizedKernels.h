@@ -0,0 +1,87 @@
+#pragma once
+
+#include "hetu/core/dtype.h"
+#include "hetu/impl/utils/cpu_capability.h"
+
+namespace hetu {
+namespace impl {
+
+/******************************************************
+ * Contiguous elementwise and blockwise-quantized CPU kernels built on
+ * Vectorized<float>.
+ *
+ * Each translation unit in this directory compiles the kernels in
+ * VectorizedKernelsImpl.h for one CPUCapability and exports a table of them.
+ * The table matching GetCPUCapability() is picked at the first call.
+ *
+ * All kernels accept kFloat32, kFloat16 and kBFloat16 buffers (half
+ * precision is computed in float), callers should check
+ * IsVectorizedFloatingType() and fall back to their scalar loops otherwise.
+ * Inputs and outputs may alias.
+ ******************************************************/
+struct VectorizedKernels {
+  // output = input + value
+  void (*add_const)(DataType dtype, const void* input, float value,
+                    void* output, size_t size);
+  // output = input * value
+  void (*mul_const)(DataType dtype, const void* input, float value,
+                    void* output, size_t size);
+  // output = input / value
+  void (*div_const)(DataType dtype, const void* input, float value,
+                    void* output, size_t size);
+  void (*gelu)(DataType dtype, const void* input, void* output, size_t size);
+  void (*gelu_gradient)(DataType dtype, const void* input,
+                        const void* output_grad, void* input_grad,
+                        size_t size);
+  // input_grad = output_grad * output * (1 - output)
+  void (*sigmoid_gradient)(DataType dtype, const void* output,
+                           const void* output_grad, void* input_grad,
+                           size_t size);
+  // input_grad = output_grad * (1 - output * output)
+  void (*tanh_gradient)(DataType dtype, const void* output,
+                        const void* output_grad, void* input_grad,
+                        size_t size);
+  // plain SGD when momentum is 0 (velocity is not touched)
+  void (*sgd_update)(DataType dtype, const void* grad, void* param,
+                     void* velocity, float lr, float momentum, bool nesterov,
+                     size_t size);
+  // bias1 = 1 - beta1^t, bias2 = sqrt(1 - beta2^t)
+  void (*adam_update)(DataType dtype, const void* grad, void* param,
+                      void* mean, void* variance, float lr, float beta1,
+                      float beta2, float eps, float bias1, float bias2,
+                      size_t size);
+  // Blockwise dequantization, output[i] = table[code(i)] * absmax[i /
+  // blocksize]. code(i) is byte i of `codes` when bits is 8, or nibble i
+  // (high nibble first) when bits is 4, in which case `table` has 16 entries.
+  void (*dequantize_blockwise)(DataType dtype, const uint8_t* codes,
+                               const float* absmax, const float* table,
+                               int bits, int64_t blocksize, void* output,
+                               size_t size);
+  // output[M, N] = a[M, K] x w, with w quantized as in dequantize_blockwise
+  // and laid out as [N, K] if trans_b else [K, N]. `a` is always fp32, the
+  // weights are dequantized in L1-sized tiles and never materialized.
+  // Meant for at most kQuantizedMatMulMaxRows rows of a, larger M is
+  // computed in chunks of that many rows.
+  void (*quantized_matmul)(DataType dtype, const float* a,
+                           const uint8_t* codes, const float* absmax,
+                           const float* table, int bits, int64_t blocksize,
+                           int64_t M, int64_t N, int64_t K, bool trans_b,
+                           void* output);
+};
+
+// Rows of the activations up to which MatMul4Bit dequantizes the weights
+// tile by tile. Beyond it the GEMM is compute bound and it is cheaper to
+// dequantize the weights once for DNNL.
+constexpr int64_t kQuantizedMatMulMaxRows = 16;
+
+const VectorizedKernels& GetVectorizedKernels();
+
+// The table of one capability, or nullptr if it was not built.
+const VectorizedKernels* GetVectorizedKernels(CPUCapability capability);
+
+inline bool IsVectorizedFloatingType(DataType dtype) {
+  return dtype == kFloat32 || dtype == kFloat16 || dtype == kBFloat16;
+}
+
+} // namespace impl
+} // namespace hetu
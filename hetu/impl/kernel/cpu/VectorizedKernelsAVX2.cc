@@ -0,0 +1,53 @@
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+// Headers included before the target region are compiled for the baseline
+// instruction set, only the kernels below may use AVX2.
+#include "hetu/impl/utils/dispatch.h"
+#include "hetu/impl/utils/omp_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+#endif
+
+#define HETU_CPU_CAPABILITY_AVX2
+#include "hetu/impl/kernel/cpu/VectorizedKernelsImpl.h"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+namespace hetu {
+namespace impl {
+
+const VectorizedKernels* GetVectorizedKernelsAVX2() {
+  return &vec::AVX2::kVectorizedKernels;
+}
+
+} // namespace impl
+} // namespace hetu
+
+#else
+
+namespace hetu {
+namespace impl {
+
+const VectorizedKernels* GetVectorizedKernelsAVX2() {
+  return nullptr;
+}
+
+} // namespace impl
+} // namespace hetu
+
+#endif
@@ -0,0 +1,11 @@
+#include "hetu/impl/kernel/cpu/VectorizedKernelsImpl.h"
+
+namespace hetu {
+namespace impl {
+
+const VectorizedKernels* GetVectorizedKernelsDefault() {
+  return &vec::DEFAULT::kVectorizedKernels;
+}
+
+} // namespace impl
+} // namespace hetu
@@ -0,0 +1,425 @@
+#pragma once
+
+// Kernel bodies of VectorizedKernels. This header is compiled once per
+// capability by VectorizedKernels{Default,AVX2,AVX512}.cc, which define
+// HETU_CPU_CAPABILITY_* and enable the matching instruction set beforehand.
+// Keep its includes limited to headers that those files have already
+// included outside of the target region.
+
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
+#include "hetu/impl/utils/cpu_vectorized.h"
+#include "hetu/impl/utils/dispatch.h"
+#include "hetu/impl/utils/omp_utils.h"
+
+namespace hetu {
+namespace impl {
+namespace vec {
+inline namespace HETU_CPU_CAPABILITY {
+
+#define HT_DISPATCH_VECTORIZED_TYPES(DTYPE, SPEC_TYPE, NAME, ...)              \
+  HT_DISPATH_SWITCH(                                                           \
+    DTYPE, NAME,                                                               \
+    HT_DISPATH_CASE(hetu::DataType::FLOAT32, SPEC_TYPE, __VA_ARGS__)           \
+    HT_DISPATH_CASE(hetu::DataType::FLOAT16, SPEC_TYPE, __VA_ARGS__)           \
+    HT_DISPATH_CASE(hetu::DataType::BFLOAT16, SPEC_TYPE, __VA_ARGS__))
+
+// Below this many elements forking the OpenMP team costs more than it saves.
+constexpr size_t kParallelGrain = 32768;
+
+// Calls f(offset, count) for each vector of [0, size), the last one may be
+// partial.
+template <typename F>
+inline void vectorized_loop(size_t size, const F& f) {
+  const int64_t vec_size = VecF::size();
+  const int64_t num_vecs = (size + vec_size - 1) / vec_size;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (size >= kParallelGrain)
+#endif
+  for (int64_t v = 0; v < num_vecs; v++) {
+    size_t offset = v * vec_size;
+    f(offset, std::min<int64_t>(vec_size, size - offset));
+  }
+}
+
+template <typename spec_t>
+void add_const_kernel(const spec_t* input, float value, spec_t* output,
+                      size_t size) {
+  const VecF v(value);
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    store(loadu(input + i, n) + v, output + i, n);
+  });
+}
+
+template <typename spec_t>
+void mul_const_kernel(const spec_t* input, float value, spec_t* output,
+                      size_t size) {
+  const VecF v(value);
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    store(loadu(input + i, n) * v, output + i, n);
+  });
+}
+
+template <typename spec_t>
+void div_const_kernel(const spec_t* input, float value, spec_t* output,
+                      size_t size) {
+  const VecF v(value);
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    store(loadu(input + i, n) / v, output + i, n);
+  });
+}
+
+template <typename spec_t>
+void gelu_kernel(const spec_t* input, spec_t* output, size_t size) {
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    VecF x = loadu(input + i, n);
+    VecF y = x * VecF(0.5f) *
+      (VecF(1.0f) + erf(x * VecF(0.70710678118654757274f)));
+    store(y, output + i, n);
+  });
+}
+
+template <typename spec_t>
+void gelu_gradient_kernel(const spec_t* input, const spec_t* output_grad,
+                          spec_t* input_grad, size_t size) {
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    VecF x = loadu(input + i, n);
+    VecF cdf = VecF(0.5f) *
+      (VecF(1.0f) + erf(x * VecF(0.70710678118654757274f)));
+    // x * pdf(x), pdf(x) = exp(-x^2 / 2) / sqrt(2 * pi)
+    VecF pdf = (x * x * VecF(-0.5f)).exp() * VecF(0.39894228040143267794f);
+    store(loadu(output_grad + i, n) * fmadd(x, pdf, cdf), input_grad + i, n);
+  });
+}
+
+template <typename spec_t>
+void sigmoid_gradient_kernel(const spec_t* output, const spec_t* output_grad,
+                             spec_t* input_grad, size_t size) {
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    VecF y = loadu(output + i, n);
+    store(loadu(output_grad + i, n) * y * (VecF(1.0f) - y), input_grad + i, n);
+  });
+}
+
+template <typename spec_t>
+void tanh_gradient_kernel(const spec_t* output, const spec_t* output_grad,
+                          spec_t* input_grad, size_t size) {
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    VecF y = loadu(output + i, n);
+    store((VecF(1.0f) - y * y) * loadu(output_grad + i, n), input_grad + i,
+          n);
+  });
+}
+
+template <typename spec_t>
+void sgd_update_kernel(const spec_t* grad, spec_t* param, spec_t* velocity,
+                       float lr, float momentum, bool nesterov, size_t size) {
+  const VecF vlr(lr), vmomentum(momentum);
+  if (momentum == 0) {
+    vectorized_loop(size, [=](size_t i, int64_t n) {
+      VecF p = loadu(param + i, n) - vlr * loadu(grad + i, n);
+      store(p, param + i, n);
+    });
+  } else if (!nesterov) {
+    vectorized_loop(size, [=](size_t i, int64_t n) {
+      VecF v = vmomentum * loadu(velocity + i, n) - vlr * loadu(grad + i, n);
+      store(v, velocity + i, n);
+      store(loadu(param + i, n) + v, param + i, n);
+    });
+  } else {
+    vectorized_loop(size, [=](size_t i, int64_t n) {
+      VecF temp = vlr * loadu(grad + i, n);
+      VecF v = vmomentum * (loadu(velocity + i, n) - temp);
+      store(v, velocity + i, n);
+      store(loadu(param + i, n) + v - temp, param + i, n);
+    });
+  }
+}
+
+template <typename spec_t>
+void adam_update_kernel(const spec_t* grad, spec_t* param, spec_t* mean,
+                        spec_t* variance, float lr, float beta1, float beta2,
+                        float eps, float bias1, float bias2, size_t size) {
+  const VecF vbeta1(beta1), vbeta2(beta2), vbeta1c(1 - beta1),
+    vbeta2c(1 - beta2);
+  const VecF vlr(lr), veps(eps), vbias1(bias1), vbias2(bias2);
+  vectorized_loop(size, [=](size_t i, int64_t n) {
+    VecF g = loadu(grad + i, n);
+    VecF m = loadu(mean + i, n) * vbeta1 + g * vbeta1c;
+    VecF v = loadu(variance + i, n) * vbeta2 + g * g * vbeta2c;
+    store(m, mean + i, n);
+    store(v, variance + i, n);
+    VecF p = loadu(param + i, n) -
+      vlr * (m / vbias1) / (v.sqrt() / vbias2 + veps);
+    store(p, param + i, n);
+  });
+}
+
+// Elements dequantized at a time, small enough for the codes and the
+// dequantized values to stay in L1.
+constexpr int64_t kQuantizedTile = 256;
+
+// Unpacks the codes of elements [begin, begin + size): bytes for 8 bits,
+// nibbles (high nibble first) for 4 bits.
+template <int kBits>
+inline void unpack_codes(const uint8_t* codes, int64_t begin, int64_t size,
+                         uint8_t* output) {
+  if (kBits == 8) {
+    std::memcpy(output, codes + begin, size);
+    return;
+  }
+  for (int64_t i = 0; i < size; i++) {
+    uint8_t byte = codes[(begin + i) >> 1];
+    output[i] = ((begin + i) & 1) ? (byte & 0x0F) : (byte >> 4);
+  }
+}
+
+// Dequantizes elements [begin, begin + size) into `output`, element i being
+// table[code(i)] * absmax[i / blocksize].
+template <int kBits, typename spec_t>
+void dequantize_range(const uint8_t* codes, const float* absmax,
+                      const float* table, int64_t blocksize, int64_t begin,
+                      int64_t size, spec_t* output) {
+  // the padding keeps full-width lookups at the tail in bounds
+  uint8_t buf[kQuantizedTile + VecF::size()] = {0};
+  for (int64_t t = 0; t < size; t += kQuantizedTile) {
+    int64_t tile = std::min(kQuantizedTile, size - t);
+    unpack_codes<kBits>(codes, begin + t, tile, buf);
+    // split the tile where the scale changes
+    for (int64_t i = 0; i < tile;) {
+      int64_t idx = begin + t + i;
+      int64_t end = std::min(tile, i + blocksize - idx % blocksize);
+      const VecF scale(absmax[idx / blocksize]);
+      for (int64_t j = i; j < end; j += VecF::size()) {
+        VecF v = kBits == 4 ? lookup16(table, buf + j) : lookup(table, buf + j);
+        store(v * scale, output + t + j,
+              std::min<int64_t>(VecF::size(), end - j));
+      }
+      i = end;
+    }
+  }
+}
+
+template <int kBits, typename spec_t>
+void dequantize_blockwise_kernel(const uint8_t* codes, const float* absmax,
+                                 const float* table, int64_t blocksize,
+                                 spec_t* output, size_t size) {
+  const int64_t num_tiles = (size + kQuantizedTile - 1) / kQuantizedTile;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (size >= kParallelGrain)
+#endif
+  for (int64_t t = 0; t < num_tiles; t++) {
+    int64_t begin = t * kQuantizedTile;
+    dequantize_range<kBits>(
+      codes, absmax, table, blocksize, begin,
+      std::min<int64_t>(kQuantizedTile, size - begin), output + begin);
+  }
+}
+
+// output[M, N] = a[M, K] x w, where w is dequantized tile by tile right
+// before use, so the weights are read from memory in their compressed form
+// only once. w is [N, K] if trans_b else [K, N].
+template <int kBits, typename spec_t>
+void quantized_matmul_kernel(const float* a, const uint8_t* codes,
+                             const float* absmax, const float* table,
+                             int64_t blocksize, int64_t M, int64_t N,
+                             int64_t K, bool trans_b, spec_t* output) {
+  const bool parallel = N * K >= static_cast<int64_t>(kParallelGrain);
+  if (trans_b) {
+    // one row of w per iteration, dotted with every row of a. The
+    // accumulators stay on the stack: std::vector does not honor the
+    // alignment of the SIMD registers, so rows are taken in chunks of
+    // kQuantizedMatMulMaxRows and w is dequantized once per chunk.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (parallel)
+#endif
+    for (int64_t n = 0; n < N; n++) {
+      float w[kQuantizedTile];
+      for (int64_t m0 = 0; m0 < M; m0 += kQuantizedMatMulMaxRows) {
+        int64_t rows = std::min(kQuantizedMatMulMaxRows, M - m0);
+        VecF acc[kQuantizedMatMulMaxRows];
+        for (int64_t m = 0; m < rows; m++)
+          acc[m] = VecF(0.0f);
+        for (int64_t k0 = 0; k0 < K; k0 += kQuantizedTile) {
+          int64_t tile = std::min(kQuantizedTile, K - k0);
+          dequantize_range<kBits>(codes, absmax, table, blocksize, n * K + k0,
+                                  tile, w);
+          for (int64_t m = 0; m < rows; m++) {
+            const float* a_row = a + (m0 + m) * K + k0;
+            for (int64_t j = 0; j < tile; j += VecF::size()) {
+              int64_t cnt = std::min<int64_t>(VecF::size(), tile - j);
+              acc[m] =
+                fmadd(loadu(a_row + j, cnt), loadu(w + j, cnt), acc[m]);
+            }
+          }
+        }
+        for (int64_t m = 0; m < rows; m++)
+          output[(m0 + m) * N + n] = static_cast<spec_t>(reduce_add(acc[m]));
+      }
+    }
+  } else {
+    // one tile of columns per iteration, accumulating the rows of w scaled
+    // by the matching column of a
+    const int64_t num_tiles = (N + kQuantizedTile - 1) / kQuantizedTile;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (parallel)
+#endif
+    for (int64_t t = 0; t < num_tiles; t++) {
+      int64_t n0 = t * kQuantizedTile;
+      int64_t tile = std::min(kQuantizedTile, N - n0);
+      float w[kQuantizedTile];
+      std::vector<float> acc(M * tile, 0.0f);
+      for (int64_t k = 0; k < K; k++) {
+        dequantize_range<kBits>(codes, absmax, table, blocksize, k * N + n0,
+                                tile, w);
+        for (int64_t m = 0; m < M; m++) {
+          const VecF a_mk(a[m * K + k]);
+          float* acc_row = acc.data() + m * tile;
+          for (int64_t j = 0; j < tile; j += VecF::size()) {
+            int64_t cnt = std::min<int64_t>(VecF::size(), tile - j);
+            store(fmadd(a_mk, loadu(w + j, cnt), loadu(acc_row + j, cnt)),
+                  acc_row + j, cnt);
+          }
+        }
+      }
+      for (int64_t m = 0; m < M; m++)
+        for (int64_t j = 0; j < tile; j++)
+          output[m * N + n0 + j] = static_cast<spec_t>(acc[m * tile + j]);
+    }
+  }
+}
+
+#define HT_DISPATCH_QUANTIZED_BITS(BITS, NAME, ...)                            \
+  do {                                                                         \
+    if ((BITS) == 4) {                                                         \
+      constexpr int kBits = 4;                                                 \
+      __VA_ARGS__();                                                           \
+    } else if ((BITS) == 8) {                                                  \
+      constexpr int kBits = 8;                                                 \
+      __VA_ARGS__();                                                           \
+    } else {                                                                   \
+      HT_NOT_IMPLEMENTED << "\"" << NAME << "\" is not implemented for "       \
+                         << (BITS) << " bits";                                 \
+    }                                                                          \
+  } while (0)
+
+const VectorizedKernels kVectorizedKernels = {
+  // add_const
+  [](DataType dtype, const void* input, float value, void* output,
+     size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(dtype, spec_t, "AddConstVectorized", [&]() {
+      add_const_kernel(static_cast<const spec_t*>(input), value,
+                       static_cast<spec_t*>(output), size);
+    });
+  },
+  // mul_const
+  [](DataType dtype, const void* input, float value, void* output,
+     size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(dtype, spec_t, "MulConstVectorized", [&]() {
+      mul_const_kernel(static_cast<const spec_t*>(input), value,
+                       static_cast<spec_t*>(output), size);
+    });
+  },
+  // div_const
+  [](DataType dtype, const void* input, float value, void* output,
+     size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(dtype, spec_t, "DivConstVectorized", [&]() {
+      div_const_kernel(static_cast<const spec_t*>(input), value,
+                       static_cast<spec_t*>(output), size);
+    });
+  },
+  // gelu
+  [](DataType dtype, const void* input, void* output, size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(dtype, spec_t, "GeluVectorized", [&]() {
+      gelu_kernel(static_cast<const spec_t*>(input),
+                  static_cast<spec_t*>(output), size);
+    });
+  },
+  // gelu_gradient
+  [](DataType dtype, const void* input, const void* output_grad,
+     void* input_grad, size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(
+      dtype, spec_t, "GeluGradientVectorized", [&]() {
+        gelu_gradient_kernel(static_cast<const spec_t*>(input),
+                             static_cast<const spec_t*>(output_grad),
+                             static_cast<spec_t*>(input_grad), size);
+      });
+  },
+  // sigmoid_gradient
+  [](DataType dtype, const void* output, const void* output_grad,
+     void* input_grad, size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(
+      dtype, spec_t, "SigmoidGradientVectorized", [&]() {
+        sigmoid_gradient_kernel(static_cast<const spec_t*>(output),
+                                static_cast<const spec_t*>(output_grad),
+                                static_cast<spec_t*>(input_grad), size);
+      });
+  },
+  // tanh_gradient
+  [](DataType dtype, const void* output, const void* output_grad,
+     void* input_grad, size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(
+      dtype, spec_t, "TanhGradientVectorized", [&]() {
+        tanh_gradient_kernel(static_cast<const spec_t*>(output),
+                             static_cast<const spec_t*>(output_grad),
+                             static_cast<spec_t*>(input_grad), size);
+      });
+  },
+  // sgd_update
+  [](DataType dtype, const void* grad, void* param, void* velocity, float lr,
+     float momentum, bool nesterov, size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(dtype, spec_t, "SGDUpdateVectorized", [&]() {
+      sgd_update_kernel(static_cast<const spec_t*>(grad),
+                        static_cast<spec_t*>(param),
+                        static_cast<spec_t*>(velocity), lr, momentum,
+                        nesterov, size);
+    });
+  },
+  // adam_update
+  [](DataType dtype, const void* grad, void* param, void* mean,
+     void* variance, float lr, float beta1, float beta2, float eps,
+     float bias1, float bias2, size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(dtype, spec_t, "AdamUpdateVectorized", [&]() {
+      adam_update_kernel(static_cast<const spec_t*>(grad),
+                         static_cast<spec_t*>(param),
+                         static_cast<spec_t*>(mean),
+                         static_cast<spec_t*>(variance), lr, beta1, beta2,
+                         eps, bias1, bias2, size);
+    });
+  },
+  // dequantize_blockwise
+  [](DataType dtype, const uint8_t* codes, const float* absmax,
+     const float* table, int bits, int64_t blocksize, void* output,
+     size_t size) {
+    HT_DISPATCH_VECTORIZED_TYPES(
+      dtype, spec_t, "DequantizeBlockwiseVectorized", [&]() {
+        HT_DISPATCH_QUANTIZED_BITS(
+          bits, "DequantizeBlockwiseVectorized", [&]() {
+            dequantize_blockwise_kernel<kBits>(codes, absmax, table,
+                                               blocksize,
+                                               static_cast<spec_t*>(output),
+                                               size);
+          });
+      });
+  },
+  // quantized_matmul
+  [](DataType dtype, const float* a, const uint8_t* codes,
+     const float* absmax, const float* table, int bits, int64_t blocksize,
+     int64_t M, int64_t N, int64_t K, bool trans_b, void* output) {
+    HT_DISPATCH_VECTORIZED_TYPES(
+      dtype, spec_t, "QuantizedMatMulVectorized", [&]() {
+        HT_DISPATCH_QUANTIZED_BITS(bits, "QuantizedMatMulVectorized", [&]() {
+          quantized_matmul_kernel<kBits>(a, codes, absmax, table, blocksize,
+                                         M, N, K, trans_b,
+                                         static_cast<spec_t*>(output));
+        });
+      });
+  },
+};
+
+#undef HT_DISPATCH_QUANTIZED_BITS
+#undef HT_DISPATCH_VECTORIZED_TYPES
+
+} // inline namespace HETU_CPU_CAPABILITY
+} // namespace vec
+} // namespace impl
+} // namespace hetu
@@ -0,0 +1,247 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/core/stream.h"
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
+#include "hetu/impl/random/CPURandomState.h"
+#include "hetu/impl/random/Philox.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include "hetu/impl/utils/common_utils.h"
+
+namespace hetu {
+namespace impl {
+
+namespace {
+
+// The 4-bit data types of the CUDA kernels (bitsandbytes layout), indexed by
+// code. The sign of FP4 is the highest bit of the code.
+constexpr float kFP4Table[16] = {
+  0.0f,          0.0052083333f,  0.66666667f,  1.0f,
+  0.33333333f,   0.5f,           0.16666667f,  0.25f,
+  -0.0f,         -0.0052083333f, -0.66666667f, -1.0f,
+  -0.33333333f,  -0.5f,          -0.16666667f, -0.25f};
+constexpr float kNF4Table[16] = {
+  -1.0f,        -0.69619280f, -0.52507305f, -0.39491749f,
+  -0.28444138f, -0.18477343f, -0.09105004f, 0.0f,
+  0.07958030f,  0.16093020f,  0.24611230f,  0.33791524f,
+  0.44070983f,  0.56261700f,  0.72295684f,  1.0f};
+
+inline int quantized_bits(DataType qtype) {
+  switch (qtype) {
+    case DataType::INT8: return 8;
+    case DataType::FLOAT4:
+    case DataType::NFLOAT4: return 4;
+    default:
+      HT_NOT_IMPLEMENTED << "Not support this quantization type:" << qtype;
+      __builtin_unreachable();
+  }
+}
+
+// The value of each code. 8-bit data must come with its code, 4-bit data
+// uses the built-in tables unless a table of 16 entries is provided.
+inline const float* quantization_table(DataType qtype, const NDArray& code) {
+  bool has_code = code.is_defined() && code->numel() > 0;
+  if (has_code) {
+    HT_ASSERT(code->dtype() == kFloat32 &&
+              code->numel() == (size_t(1) << quantized_bits(qtype)))
+      << "Invalid code for " << qtype << ": " << code->dtype() << " "
+      << code->shape();
+    return code->data_ptr<float>();
+  }
+  HT_ASSERT(qtype != DataType::INT8) << "INT8 quantization requires a code";
+  return qtype == DataType::FLOAT4 ? kFP4Table : kNF4Table;
+}
+
+// Codes sorted by value, so that the nearest ones can be binary searched.
+struct SortedCodes {
+  SortedCodes(const float* table, int num_codes) {
+    for (int i = 0; i < num_codes; i++)
+      entries.emplace_back(table[i], static_cast<uint8_t>(i));
+    std::sort(entries.begin(), entries.end());
+  }
+
+  // The nearest code of `value`. With `rand` in (0, 1), rounds to one of the
+  // two neighbours with probabilities proportional to the distances instead.
+  uint8_t quantize(float value, float rand = -1) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(),
+                               std::make_pair(value, uint8_t(0)));
+    if (it == entries.begin())
+      return it->second;
+    if (it == entries.end())
+      return entries.back().second;
+    auto lo = std::prev(it);
+    float span = it->first - lo->first;
+    if (rand >= 0 && span > 0)
+      return rand < (value - lo->first) / span ? it->second : lo->second;
+    return value - lo->first < it->first - value ? lo->second : it->second;
+  }
+
+  std::vector<std::pair<float, uint8_t>> entries;
+};
+
+template <typename spec_t>
+void quantize_blockwise_cpu(const spec_t* input, float* absmax,
+                            uint8_t* output, const SortedCodes& codes,
+                            int bits, int64_t blocksize, size_t size,
+                            bool stochastic, CPURandomState rand_state) {
+  const int64_t num_blocks = (size + blocksize - 1) / blocksize;
+  Philox4x32 philox(rand_state.seed, rand_state.offset);
+  CPUParallelFor(0, num_blocks, std::max<int64_t>(1, 4096 / blocksize),
+                 [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; b++) {
+      int64_t lo = b * blocksize;
+      int64_t hi = std::min<int64_t>(lo + blocksize, size);
+      float block_max = 0;
+      for (int64_t i = lo; i < hi; i++)
+        block_max = std::max(block_max, std::abs(static_cast<float>(input[i])));
+      absmax[b] = block_max;
+      float scale = block_max > 0 ? 1.0f / block_max : 0.0f;
+      for (int64_t i = lo; i < hi; i++) {
+        float rand = stochastic ? PhiloxUniform(philox(i >> 2)[i & 3]) : -1;
+        uint8_t q = codes.quantize(static_cast<float>(input[i]) * scale, rand);
+        if (bits == 8)
+          output[i] = q;
+        else if (i & 1)
+          output[i >> 1] = (output[i >> 1] & 0xF0) | q;
+        else
+          output[i >> 1] = (output[i >> 1] & 0x0F) | (q << 4);
+      }
+    }
+  });
+}
+
+} // namespace
+
+void QuantizationCpu(const NDArray& input, NDArray& absmax,
+                     const NDArray& code, NDArray& output,
+                     int64_t blocksize, bool stochastic, const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(input);
+  HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT_SAME_DEVICE(input, absmax);
+  HT_ASSERT_SAME_SHAPE(input, output);
+  HT_ASSERT_CONTIGUOUS(input);
+  HT_ASSERT_CONTIGUOUS(output);
+  HT_ASSERT(absmax->dtype() == kFloat32)
+    << "Absmax must be float32, got " << absmax->dtype();
+
+  size_t size = input->numel();
+  if (size == 0)
+    return;
+  int bits = quantized_bits(output->dtype());
+  HT_ASSERT(blocksize > 0 && (bits == 8 || blocksize % 2 == 0))
+    << "Invalid blocksize:" << blocksize;
+  HT_ASSERT(absmax->numel() * blocksize >= size)
+    << "Absmax of " << absmax->numel() << " blocks cannot cover " << size
+    << " elements with blocksize " << blocksize;
+  const float* table = quantization_table(output->dtype(), code);
+  CPUStream cpu_stream(stream);
+  CPURandomState rand_state =
+    stochastic ? GetCPURandomState(0, (size + 3) / 4) : CPURandomState();
+  HT_DISPATCH_FLOATING_TYPES(input->dtype(), spec_t, "QuantizationCpu", [&]() {
+    cpu_stream.PostTask(
+      [input, absmax, code, output, table, bits, blocksize, size, stochastic,
+       rand_state]() {
+        SortedCodes codes(table, 1 << bits);
+        quantize_blockwise_cpu(
+          input->data_ptr<spec_t>(), absmax->data_ptr<float>(),
+          reinterpret_cast<uint8_t*>(output->raw_data_ptr()), codes, bits,
+          blocksize, size, stochastic, rand_state);
+      },
+      "Quantization");
+  });
+  NDArray::MarkUsedBy({input, absmax, code, output}, stream);
+}
+
+void DeQuantizationCpu(const NDArray& input, NDArray& absmax,
+                       const NDArray& code, NDArray& output,
+                       int64_t blocksize, const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(input);
+  HT_ASSERT_SAME_DEVICE(input, output);
+  HT_ASSERT_SAME_DEVICE(input, absmax);
+  HT_ASSERT_SAME_SHAPE(input, output);
+  HT_ASSERT_CONTIGUOUS(input);
+  HT_ASSERT_CONTIGUOUS(output);
+  HT_ASSERT(IsVectorizedFloatingType(output->dtype()))
+    << "Not support dequantization to this type:" << output->dtype();
+
+  size_t size = output->numel();
+  if (size == 0)
+    return;
+  int bits = quantized_bits(input->dtype());
+  HT_ASSERT(absmax->numel() * blocksize >= size)
+    << "Absmax of " << absmax->numel() << " blocks cannot cover " << size
+    << " elements with blocksize " << blocksize;
+  const float* table = quantization_table(input->dtype(), code);
+  CPUStream cpu_stream(stream);
+  cpu_stream.PostTask(
+    [input, absmax, code, output, table, bits, blocksize, size]() {
+      GetVectorizedKernels().dequantize_blockwise(
+        output->dtype(),
+        reinterpret_cast<const uint8_t*>(input->raw_data_ptr()),
+        absmax->data_ptr<float>(), table, bits, blocksize,
+        output->raw_data_ptr(), size);
+    },
+    "DeQuantization");
+  NDArray::MarkUsedBy({input, absmax, code, output}, stream);
+}
+
+void MatMul4BitCpu(const NDArray& A, bool trans_a, const NDArray& B,
+                   bool trans_b, const NDArray& absmax,
+                   const NDArray& datatype, NDArray& out, int blocksize,
+                   const Stream& stream) {
+  HT_ASSERT_CPU_DEVICE(A);
+  HT_ASSERT_SAME_DEVICE(A, B);
+  HT_ASSERT_SAME_DEVICE(A, out);
+  HT_ASSERT_NDIM(A, 2);
+  HT_ASSERT_NDIM(B, 2);
+  HT_ASSERT_SAME_DTYPE(A, out);
+  HT_ASSERT_CONTIGUOUS(B);
+  HT_ASSERT_CONTIGUOUS(out);
+  HT_ASSERT(IsVectorizedFloatingType(A->dtype()))
+    << "Not support for this type:" << A->dtype();
+
+  int64_t M = trans_a ? A->shape(1) : A->shape(0);
+  int64_t K = trans_a ? A->shape(0) : A->shape(1);
+  int64_t N = trans_b ? B->shape(0) : B->shape(1);
+  if (out->numel() == 0)
+    return;
+
+  if (M > kQuantizedMatMulMaxRows) {
+    NDArray absmax_ = absmax;
+    NDArray weight =
+      NDArray::dequantization(B, absmax_, A->dtype(), blocksize,
+                              stream.stream_index(), datatype);
+    NDArray::matmul(A, weight, trans_a, trans_b, stream.stream_index(), out);
+    return;
+  }
+
+  int bits = quantized_bits(B->dtype());
+  HT_ASSERT(absmax->numel() * blocksize >= B->numel())
+    << "Absmax of " << absmax->numel() << " blocks cannot cover "
+    << B->numel() << " elements with blocksize " << blocksize;
+  const float* table = quantization_table(B->dtype(), datatype);
+  CPUStream cpu_stream(stream);
+  HT_DISPATCH_FLOATING_TYPES(A->dtype(), spec_t, "MatMul4BitCpu", [&]() {
+    cpu_stream.PostTask(
+      [A, B, absmax, datatype, out, trans_a, trans_b, table, bits, blocksize,
+       M, N, K]() {
+        // the activations are small, widen them to a row-major fp32 copy
+        const spec_t* a_ptr = A->data_ptr<spec_t>();
+        int64_t stride_m = trans_a ? A->stride(1) : A->stride(0);
+        int64_t stride_k = trans_a ? A->stride(0) : A->stride(1);
+        std::vector<float> a(M * K);
+        for (int64_t m = 0; m < M; m++)
+          for (int64_t k = 0; k < K; k++)
+            a[m * K + k] =
+              static_cast<float>(a_ptr[m * stride_m + k * stride_k]);
+        GetVectorizedKernels().quantized_matmul(
+          out->dtype(), a.data(),
+          reinterpret_cast<const uint8_t*>(B->raw_data_ptr()),
+          absmax->data_ptr<float>(), table, bits, blocksize, M, N, K, trans_b,
+          out->raw_data_ptr());
+      },
+      "MatMul4Bit");
+  });
+  NDArray::MarkUsedBy({A, B, absmax, datatype, out}, stream);
+}
+
+} // namespace impl
+} // namespace hetu
@@ -14,9 +14,31 @@ inline static void batch_sync_dependent_events(
     kv.second->Sync();
 }
 
+// Requests no larger than `kSmallSize` are rounded up to power-of-two bins
+// (at least `kMinBlockSize`) and never split. Larger requests are rounded up
+// to `kMinBlockSize` and carved out of segments rounded up to
+// `kLargeSegmentRound`.
+constexpr size_t kMinBlockSize = 512;
+constexpr size_t kSmallSize = 1048576;
+constexpr size_t kLargeSegmentRound = 2097152;
+
+inline static size_t round_block_size(size_t num_bytes) {
+  if (num_bytes <= kMinBlockSize)
+    return kMinBlockSize;
+  if (num_bytes <= kSmallSize) {
+    size_t block_size = kMinBlockSize;
+    while (block_size < num_bytes)
+      block_size <<= 1;
+    return block_size;
+  }
+  return DIVUP(num_bytes, kMinBlockSize) * kMinBlockSize;
+}
+
 } // namespace
 
-CPUMemoryPool::CPUMemoryPool() : MemoryPool(Device(kCPU), "CPUMemPool") {
+CPUMemoryPool::CPUMemoryPool(bool caching)
+: MemoryPool(Device(kCPU), caching ? "CPUCachingMemPool" : "CPUMemPool"),
+  _caching(caching) {
   _data_ptr_info.reserve(8192);
   _free_on_alloc_stream_fn =
     std::bind(CPUMemoryPool::_FreeOnAllocStream, this, std::placeholders::_1);
@@ -27,6 +49,8 @@ CPUMemoryPool::CPUMemoryPool() : MemoryPool(Device(kCPU), "CPUMemPool") {
 CPUMemoryPool::~CPUMemoryPool() {
   std::lock_guard<std::mutex> lock(_mtx);
   CPUStream(Stream(Device(kCPU), kJoinStream)).Sync();
+  if (_caching)
+    _ReleaseFreeSegments();
 }
 
 DataPtr CPUMemoryPool::AllocDataSpace(size_t num_bytes, const Stream& stream) {
@@ -36,20 +60,6 @@ DataPtr CPUMemoryPool::AllocDataSpace(size_t num_bytes, const Stream& stream) {
   std::lock_guard<std::mutex> lock(_mtx);
   auto alignment = get_data_alignment();
   size_t aligned_num_bytes = DIVUP(num_bytes, alignment) * alignment;
-  
-  // Currently the allocation on host memory is blocking. Remember to check for
-  // the synchronization of allocation stream when freeing or waiting 
-  // if the allocation becomes non-blocking.
-  void* ptr;
-  int err = posix_memalign(&ptr, alignment, aligned_num_bytes);
-  HT_BAD_ALLOC_IF(err != 0)
-    << "Failed to allocate " << aligned_num_bytes
-    << " bytes of host memory. Error: " << strerror(err);
-  DataPtr data_ptr{ptr, aligned_num_bytes, Device(kCPU), next_id()};
-  data_ptr.is_new_malloc = true;
-  _allocated += aligned_num_bytes;
-  _peak_allocated = MAX(_peak_allocated, _allocated);
-  _alloc_cnt++;
 
   // Note: The `stream` argument might be a non-CPU stream
   // (e.g., allocated for device to host copy).
@@ -59,11 +69,38 @@ DataPtr CPUMemoryPool::AllocDataSpace(size_t num_bytes, const Stream& stream) {
   // before the join stream can deallocate the memory.
   Stream alloc_stream =
     stream.device().is_cpu() ? stream : Stream(Device(kCPU), kJoinStream);
+  
+  // Currently the allocation on host memory is blocking. Remember to check for
+  // the synchronization of allocation stream when freeing or waiting 
+  // if the allocation becomes non-blocking.
+  DataPtr data_ptr;
+  CPUBlock* block = nullptr;
+  if (_caching) {
+    auto malloc_cnt = _malloc_cnt;
+    block = _AllocBlock(aligned_num_bytes, alloc_stream);
+    data_ptr = DataPtr{block->ptr, aligned_num_bytes, Device(kCPU), next_id()};
+    data_ptr.is_new_malloc = _malloc_cnt != malloc_cnt;
+    _allocated += block->size;
+    _requested += aligned_num_bytes;
+  } else {
+    void* ptr;
+    int err = posix_memalign(&ptr, alignment, aligned_num_bytes);
+    HT_BAD_ALLOC_IF(err != 0)
+      << "Failed to allocate " << aligned_num_bytes
+      << " bytes of host memory. Error: " << strerror(err);
+    data_ptr = DataPtr{ptr, aligned_num_bytes, Device(kCPU), next_id()};
+    data_ptr.is_new_malloc = true;
+    _allocated += aligned_num_bytes;
+  }
+  _peak_allocated = MAX(_peak_allocated, _allocated);
+  _alloc_cnt++;
+
   auto insertion = _data_ptr_info.emplace(
     data_ptr.id, 
     CPUDataPtrInfo(data_ptr.ptr, aligned_num_bytes, alloc_stream));
   HT_RUNTIME_ERROR_IF(!insertion.second)
     << "Failed to insert data " << data_ptr << " to info";
+  insertion.first->second.block = block;
 
   return data_ptr;
 }
@@ -99,7 +136,7 @@ void CPUMemoryPool::FreeDataSpace(DataPtr data_ptr) {
   if (data_ptr.ptr == nullptr || data_ptr.size == 0)
     return;
 
-  std::lock_guard<std::mutex> lock(_mtx);
+  std::unique_lock<std::mutex> lock(_mtx);
 
   auto it = _data_ptr_info.find(data_ptr.id);
   HT_RUNTIME_ERROR_IF(it == _data_ptr_info.end())
@@ -117,18 +154,43 @@ void CPUMemoryPool::FreeDataSpace(DataPtr data_ptr) {
   if (dependent_events.empty() ||
       (dependent_events.size() == 1 &&
         dependent_events.begin()->first == alloc_stream)) {
-    // If we do not ignore the blocking stream, it will immediately call the 
-    // `_free_on_alloc_stream_fn` and try to acquire the mutex, 
-    // leading to deadlock.
-    if (!alloc_stream.is_blocking()) {
+    if (it->second.block != nullptr) {
+      // Caching mode: later allocations on the allocation stream are ordered
+      // after all pending work on it, so the block can be reused by them
+      // right away. It is handed back to other streams once the allocation
+      // stream reaches this point.
+      CPUBlock* block = it->second.block;
+      _allocated -= block->size;
+      _requested -= it->second.num_bytes;
+      _free_cnt++;
+      Stream stash_stream = alloc_stream;
+      _data_ptr_info.erase(it);
+      if (stash_stream.is_blocking()) {
+        _ReleaseBlock(block);
+      } else {
+        _StashBlock(block, stash_stream);
+        uint64_t stash_id = block->stash_id;
+        CPUStream(stash_stream)
+          .PostTask(
+            [this, stash_id]() { _UnstashOnAllocStream(this, stash_id); },
+            "UnstashOnAllocStream");
+      }
+      return;
+    }
+    if (alloc_stream.is_blocking()) {
+      // Borrowed data is ready once it is freed, so it is released right
+      // away. The free fn acquires the mutex by itself.
+      lock.unlock();
+      _free_on_alloc_stream_fn(data_ptr);
+    } else {
       CPUStream(alloc_stream)
-        .EnqueueTask(
+        .PostTask(
           [this, data_ptr]() { this->_free_on_alloc_stream_fn(data_ptr); },
           "FreeOnAllocStream");
     }
   } else {
     CPUStream(Stream(Device(kCPU), kJoinStream))
-      .EnqueueTask(
+      .PostTask(
         [this, data_ptr]() { this->_free_on_join_stream_fn(data_ptr); },
         "FreeOnJoinStream");
   }
@@ -136,18 +198,25 @@ void CPUMemoryPool::FreeDataSpace(DataPtr data_ptr) {
 
 void CPUMemoryPool::_FreeOnAllocStream(CPUMemoryPool* const pool,
                                        DataPtr data_ptr) {
-  std::lock_guard<std::mutex> lock(pool->_mtx);
-  auto it = pool->_data_ptr_info.find(data_ptr.id);
-  HT_RUNTIME_ERROR_IF(it == pool->_data_ptr_info.end())
-    << "Cannot find data " << data_ptr << " in from info";
-  if (it->second.deleter) {
-    it->second.deleter(data_ptr);
-  } else {
-    free(data_ptr.ptr);
+  DataPtrDeleter deleter;
+  {
+    std::lock_guard<std::mutex> lock(pool->_mtx);
+    auto it = pool->_data_ptr_info.find(data_ptr.id);
+    HT_RUNTIME_ERROR_IF(it == pool->_data_ptr_info.end())
+      << "Cannot find data " << data_ptr << " in from info";
+    deleter = std::move(it->second.deleter);
+    // Borrowed data is not counted as allocated
+    if (!deleter)
+      pool->_allocated -= data_ptr.size;
+    pool->_data_ptr_info.erase(it);
+    pool->_free_cnt++;
   }
-  pool->_allocated -= data_ptr.size;
-  pool->_data_ptr_info.erase(it);
-  pool->_free_cnt++;
+  // The deleter may free other data of this pool or take other locks
+  // (e.g., the GIL), so it runs without holding the mutex.
+  if (deleter)
+    deleter(data_ptr);
+  else
+    free(data_ptr.ptr);
 }
 
 void CPUMemoryPool::_FreeOnJoinStream(CPUMemoryPool* const pool,
@@ -159,20 +228,224 @@ void CPUMemoryPool::_FreeOnJoinStream(CPUMemoryPool* const pool,
   // Note: Currently the allocation on host memory is blocking, 
   // so it is ok if the allocation stream is not marked.
   auto& dependent_events = it->second.dependent_events;
+  CPUBlock* block = it->second.block;
   // We do not need to lock the memory pool when waiting for the events
   lock.unlock();
   batch_sync_dependent_events(dependent_events);
-  if (it->second.deleter) {
-    it->second.deleter(data_ptr);
-  } else {
-    free(data_ptr.ptr);
+  if (block == nullptr) {
+    if (it->second.deleter) {
+      it->second.deleter(data_ptr);
+    } else {
+      free(data_ptr.ptr);
+    }
   }
   lock.lock();
-  pool->_allocated -= data_ptr.size;
+  if (block != nullptr) {
+    pool->_allocated -= block->size;
+    pool->_requested -= it->second.num_bytes;
+    pool->_ReleaseBlock(block);
+  } else if (!it->second.deleter) {
+    pool->_allocated -= data_ptr.size;
+  }
   pool->_data_ptr_info.erase(it);
   pool->_free_cnt++;
 }
 
+void CPUMemoryPool::_UnstashOnAllocStream(CPUMemoryPool* const pool,
+                                          uint64_t stash_id) {
+  std::lock_guard<std::mutex> lock(pool->_mtx);
+  auto it = pool->_stash_lookup.find(stash_id);
+  // The block has been reused by its allocation stream in the meantime
+  if (it == pool->_stash_lookup.end())
+    return;
+  CPUBlock* block = it->second;
+  pool->_stash_lookup.erase(it);
+  pool->_stashed_blocks[block->stash_stream].erase(block);
+  pool->_ReleaseBlock(block);
+}
+
+CPUMemoryPool::CPUBlock* CPUMemoryPool::_AllocBlock(size_t num_bytes,
+                                                    const Stream& stream) {
+  bool is_small = num_bytes <= kSmallSize;
+  size_t block_size = round_block_size(num_bytes);
+  CPUBlock* block = _GetStashedBlock(block_size, is_small, stream);
+  if (block != nullptr) {
+    _stream_reuse_cnt++;
+    return block;
+  }
+  block = _GetFreeBlock(block_size, is_small);
+  if (block != nullptr)
+    _reuse_cnt++;
+  else
+    block = _MallocSegment(block_size, is_small);
+  // Only large blocks are split, and the remainder must be large as well.
+  if (!is_small && block->size - block_size > kSmallSize)
+    _SplitBlock(block, block_size);
+  return block;
+}
+
+CPUMemoryPool::CPUBlock* CPUMemoryPool::_GetStashedBlock(size_t block_size,
+                                                         bool is_small,
+                                                         const Stream& stream) {
+  if (stream.is_blocking())
+    return nullptr;
+  auto it = _stashed_blocks.find(stream);
+  if (it == _stashed_blocks.end() || it->second.empty())
+    return nullptr;
+  auto& blocks = it->second;
+  CPUBlock key(nullptr, block_size, is_small, CPUBlockStatus::FREE);
+  auto block_it = blocks.lower_bound(&key);
+  if (block_it == blocks.end())
+    return nullptr;
+  CPUBlock* block = *block_it;
+  // Stashed blocks are not split, so avoid handing out much larger ones.
+  if (block->is_small != is_small ||
+      (is_small && block->size != block_size) ||
+      (!is_small && block->size - block_size > kSmallSize))
+    return nullptr;
+  blocks.erase(block_it);
+  _stash_lookup.erase(block->stash_id);
+  block->stash_id = 0;
+  block->status = CPUBlockStatus::ALLOCATED;
+  return block;
+}
+
+CPUMemoryPool::CPUBlock* CPUMemoryPool::_GetFreeBlock(size_t block_size,
+                                                      bool is_small) {
+  auto& blocks = is_small ? _small_free_blocks : _large_free_blocks;
+  CPUBlock key(nullptr, block_size, is_small, CPUBlockStatus::FREE);
+  auto block_it = blocks.lower_bound(&key);
+  if (block_it == blocks.end() ||
+      (is_small && (*block_it)->size != block_size))
+    return nullptr;
+  CPUBlock* block = *block_it;
+  blocks.erase(block_it);
+  block->status = CPUBlockStatus::ALLOCATED;
+  return block;
+}
+
+CPUMemoryPool::CPUBlock* CPUMemoryPool::_MallocSegment(size_t block_size,
+                                                       bool is_small) {
+  size_t segment_size = is_small
+    ? block_size
+    : DIVUP(block_size, kLargeSegmentRound) * kLargeSegmentRound;
+  void* ptr;
+  int err = posix_memalign(&ptr, get_data_alignment(), segment_size);
+  if (err != 0) {
+    // Give the cached segments back to the system and retry
+    if (_ReleaseFreeSegments() > 0)
+      err = posix_memalign(&ptr, get_data_alignment(), segment_size);
+  }
+  HT_BAD_ALLOC_IF(err != 0)
+    << "Failed to allocate " << segment_size
+    << " bytes of host memory. Error: " << strerror(err);
+  CPUBlock* block =
+    new CPUBlock(ptr, segment_size, is_small, CPUBlockStatus::ALLOCATED);
+  _segments.insert(block);
+  _reserved += segment_size;
+  _peak_reserved = MAX(_peak_reserved, _reserved);
+  _malloc_cnt++;
+  return block;
+}
+
+void CPUMemoryPool::_SplitBlock(CPUBlock* block, size_t block_size) {
+  HT_ASSERT(!block->is_small && block->size > block_size)
+    << "Cannot split block of " << block->size << " bytes into "
+    << block_size << " bytes";
+  CPUBlock* remaining =
+    new CPUBlock(static_cast<char*>(block->ptr) + block_size,
+                 block->size - block_size, false, CPUBlockStatus::FREE);
+  remaining->prev = block;
+  remaining->next = block->next;
+  if (block->next)
+    block->next->prev = remaining;
+  block->next = remaining;
+  block->size = block_size;
+  _large_free_blocks.insert(remaining);
+  _split_cnt++;
+}
+
+void CPUMemoryPool::_StashBlock(CPUBlock* block, const Stream& stream) {
+  block->status = CPUBlockStatus::STASHED;
+  block->stash_id = _next_stash_id++;
+  block->stash_stream = stream;
+  _stashed_blocks[stream].insert(block);
+  _stash_lookup[block->stash_id] = block;
+}
+
+void CPUMemoryPool::_ReleaseBlock(CPUBlock* block) {
+  block->status = CPUBlockStatus::FREE;
+  block->stash_id = 0;
+  if (block->is_small) {
+    _small_free_blocks.insert(block);
+    return;
+  }
+  // Coalesce with free neighbours in the same segment
+  CPUBlock* prev = block->prev;
+  if (prev != nullptr && prev->status == CPUBlockStatus::FREE) {
+    _large_free_blocks.erase(prev);
+    prev->size += block->size;
+    prev->next = block->next;
+    if (block->next)
+      block->next->prev = prev;
+    delete block;
+    block = prev;
+  }
+  CPUBlock* next = block->next;
+  if (next != nullptr && next->status == CPUBlockStatus::FREE) {
+    _large_free_blocks.erase(next);
+    block->size += next->size;
+    block->next = next->next;
+    if (next->next)
+      next->next->prev = block;
+    delete next;
+  }
+  _large_free_blocks.insert(block);
+}
+
+size_t CPUMemoryPool::_ReleaseFreeSegments() {
+  size_t released = 0;
+  for (auto it = _segments.begin(); it != _segments.end();) {
+    CPUBlock* block = *it;
+    if (block->status != CPUBlockStatus::FREE || block->next != nullptr) {
+      it++;
+      continue;
+    }
+    if (block->is_small)
+      _small_free_blocks.erase(block);
+    else
+      _large_free_blocks.erase(block);
+    free(block->ptr);
+    released += block->size;
+    _reserved -= block->size;
+    _release_cnt++;
+    delete block;
+    it = _segments.erase(it);
+  }
+  return released;
+}
+
+void CPUMemoryPool::EmptyCache() {
+  if (!_caching)
+    return;
+  // Let the pending frees finish so that stashed blocks can be released.
+  std::vector<Stream> stash_streams;
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    for (auto& kv : _stashed_blocks)
+      if (!kv.second.empty())
+        stash_streams.push_back(kv.first);
+  }
+  for (auto& stream : stash_streams)
+    CPUStream(stream).Sync();
+  CPUStream(Stream(Device(kCPU), kJoinStream)).Sync();
+
+  std::lock_guard<std::mutex> lock(_mtx);
+  size_t released = _ReleaseFreeSegments();
+  HT_LOG_DEBUG << name() << ": released " << released
+    << " bytes of cached host memory";
+}
+
 void CPUMemoryPool::MarkDataSpaceUsedByStream(DataPtr data_ptr,
                                               const Stream& stream) {
   if (data_ptr.ptr == nullptr || data_ptr.size == 0 || stream.is_blocking())
@@ -271,6 +544,21 @@ std::future<void> CPUMemoryPool::WaitDataSpace(DataPtr data_ptr, bool async) {
   return future;
 }
 
+CPUMemoryPoolStats CPUMemoryPool::GetStats() {
+  std::lock_guard<std::mutex> lock(_mtx);
+  CPUMemoryPoolStats stats;
+  stats.allocated = _allocated;
+  stats.reserved = _reserved;
+  stats.num_segments = _segments.size();
+  stats.num_stashed_blocks = _stash_lookup.size();
+  stats.malloc_cnt = _malloc_cnt;
+  stats.reuse_cnt = _reuse_cnt;
+  stats.stream_reuse_cnt = _stream_reuse_cnt;
+  stats.split_cnt = _split_cnt;
+  stats.release_cnt = _release_cnt;
+  return stats;
+}
+
 void CPUMemoryPool::PrintSummary() {
   HT_LOG_INFO << name() << ": alloc=" << _allocated << " bytes, "
     << "peak_alloc=" << _peak_allocated << " bytes, "
@@ -278,18 +566,60 @@ void CPUMemoryPool::PrintSummary() {
     << "borrow_cnt=" << _borrow_cnt << ", "
     << "free_cnt=" << _free_cnt << ", "
     << "mark_cnt=" << _mark_cnt;
+  if (!_caching)
+    return;
+  std::lock_guard<std::mutex> lock(_mtx);
+  size_t free_bytes = 0, largest_free = 0;
+  for (auto* blocks : {&_small_free_blocks, &_large_free_blocks}) {
+    for (auto* block : *blocks)
+      free_bytes += block->size;
+    if (!blocks->empty())
+      largest_free = MAX(largest_free, (*blocks->rbegin())->size);
+  }
+  size_t stashed = _stash_lookup.size();
+  double fragmentation = free_bytes == 0 ? 0.0 :
+    1.0 - static_cast<double>(largest_free) / free_bytes;
+  HT_LOG_INFO << name() << ": reserved=" << _reserved << " bytes, "
+    << "peak_reserved=" << _peak_reserved << " bytes, "
+    << "cached=" << _reserved - _allocated << " bytes, "
+    << "internal_waste=" << _allocated - _requested << " bytes, "
+    << "segments=" << _segments.size() << ", "
+    << "stashed_blocks=" << stashed << ", "
+    << "malloc_cnt=" << _malloc_cnt << ", "
+    << "reuse_cnt=" << _reuse_cnt << ", "
+    << "stream_reuse_cnt=" << _stream_reuse_cnt << ", "
+    << "split_cnt=" << _split_cnt << ", "
+    << "release_cnt=" << _release_cnt << ", "
+    << "fragmentation=" << fragmentation;
 }
 
 namespace {
 
 static std::once_flag cpu_memory_pool_register_flag;
 
+static bool ParseCPUCaching() {
+  const char* pool_str = std::getenv("HETU_CPU_MEMORY_POOL");
+  if (pool_str == NULL)
+    return false;
+  std::string pool_type(pool_str);
+  if (pool_type == "caching")
+    return true;
+  if (pool_type != "default") {
+    HT_LOG_WARN
+      << "Invalid HETU_CPU_MEMORY_POOL: " << pool_str << " is set"
+      << ", please provide \"default\" or \"caching\""
+      << ", default value will be used in this process.";
+  }
+  return false;
+}
+
 struct CPUMemoryPoolRegister {
   CPUMemoryPoolRegister() {
     std::call_once(cpu_memory_pool_register_flag, []() {
+      bool caching = ParseCPUCaching();
       RegisterMemoryPoolCtor(
-          Device(kCPU), []() -> std::shared_ptr<MemoryPool> {
-            return std::make_shared<CPUMemoryPool>();
+          Device(kCPU), [caching]() -> std::shared_ptr<MemoryPool> {
+            return std::make_shared<CPUMemoryPool>(caching);
           });
     });
   }
@@ -3,16 +3,35 @@
 #include "hetu/core/memory_pool.h"
 #include "hetu/utils/task_queue.h"
 #include <functional>
+#include <set>
+#include <unordered_set>
 
 namespace hetu {
 namespace impl {
 
+// Counters of a CPUMemoryPool, the block counters are zero unless caching.
+struct CPUMemoryPoolStats {
+  size_t allocated{0};
+  size_t reserved{0};
+  size_t num_segments{0};
+  size_t num_stashed_blocks{0};
+  uint64_t malloc_cnt{0};
+  uint64_t reuse_cnt{0};
+  uint64_t stream_reuse_cnt{0};
+  uint64_t split_cnt{0};
+  uint64_t release_cnt{0};
+};
+
 class CPUMemoryPool final : public MemoryPool {
  public:
-  CPUMemoryPool();
+  CPUMemoryPool(bool caching = false);
 
   ~CPUMemoryPool();
 
+  inline bool is_caching() const noexcept {
+    return _caching;
+  }
+
   DataPtr AllocDataSpace(size_t num_bytes, const Stream& stream = Stream());
 
   DataPtr BorrowDataSpace(void* ptr, size_t num_bytes, DataPtrDeleter deleter, const Stream& stream = Stream());
@@ -27,16 +46,62 @@ class CPUMemoryPool final : public MemoryPool {
 
   void PrintSummary();
 
+  CPUMemoryPoolStats GetStats();
+
+  void EmptyCache();
+
   inline size_t get_data_alignment() const noexcept {
     return 16;
   }
 
  private:
+  // Caching mode keeps host memory in segments obtained from posix_memalign.
+  // A segment is a doubly linked list of blocks. Small requests are rounded
+  // up to power-of-two bins and served from exact-size segments, while large
+  // requests are served from 2 MiB-rounded segments that can be split and
+  // coalesced.
+  // Status of a block:
+  // (1) ALLOCATED: owned by a data ptr;
+  // (2) STASHED: freed but only used by its allocation stream, so it can be
+  //     reused by later allocations on the same stream;
+  // (3) FREE: no pending work refers to it, so it can be reused by any
+  //     stream, merged with neighbours or released to the system.
+  enum class CPUBlockStatus : int8_t {
+    ALLOCATED = 0,
+    STASHED,
+    FREE
+  };
+
+  struct CPUBlock {
+    void* ptr;
+    size_t size;
+    bool is_small;
+    CPUBlockStatus status;
+    CPUBlock* prev{nullptr};
+    CPUBlock* next{nullptr};
+    uint64_t stash_id{0};
+    Stream stash_stream;
+
+    CPUBlock(void* ptr_, size_t size_, bool is_small_, CPUBlockStatus status_)
+    : ptr(ptr_), size(size_), is_small(is_small_), status(status_) {}
+  };
+
+  struct CPUBlockComparator {
+    bool operator()(const CPUBlock* a, const CPUBlock* b) const {
+      if (a->size != b->size)
+        return a->size < b->size;
+      return a->ptr < b->ptr;
+    }
+  };
+
+  using CPUBlockSet = std::set<CPUBlock*, CPUBlockComparator>;
+
   struct CPUDataPtrInfo {
     void* ptr;
     size_t num_bytes;
     Stream alloc_stream;
     DataPtrDeleter deleter;
+    CPUBlock* block{nullptr};
     std::unordered_map<Stream, std::shared_ptr<Event>> dependent_events;
 
     CPUDataPtrInfo(void* ptr_, size_t num_bytes_, Stream alloc_stream_,
@@ -49,7 +114,22 @@ class CPUMemoryPool final : public MemoryPool {
 
   static void _FreeOnAllocStream(CPUMemoryPool* const pool, DataPtr ptr);
   static void _FreeOnJoinStream(CPUMemoryPool* const pool, DataPtr ptr);
-
+  static void _UnstashOnAllocStream(CPUMemoryPool* const pool,
+                                    uint64_t stash_id);
+
+  // The following helpers are used in caching mode and the caller should
+  // hold the mutex.
+  CPUBlock* _AllocBlock(size_t num_bytes, const Stream& stream);
+  CPUBlock* _GetStashedBlock(size_t block_size, bool is_small,
+                             const Stream& stream);
+  CPUBlock* _GetFreeBlock(size_t block_size, bool is_small);
+  CPUBlock* _MallocSegment(size_t block_size, bool is_small);
+  void _SplitBlock(CPUBlock* block, size_t block_size);
+  void _StashBlock(CPUBlock* block, const Stream& stream);
+  void _ReleaseBlock(CPUBlock* block);
+  size_t _ReleaseFreeSegments();
+
+  const bool _caching;
   std::unordered_map<uint64_t, CPUDataPtrInfo> _data_ptr_info;
   std::function<void(DataPtr)> _free_on_alloc_stream_fn;
   std::function<void(DataPtr)> _free_on_join_stream_fn;
@@ -60,6 +140,22 @@ class CPUMemoryPool final : public MemoryPool {
   uint64_t _borrow_cnt{0};
   uint64_t _free_cnt{0};
   uint64_t _mark_cnt{0};
+
+  // Caching mode only
+  CPUBlockSet _small_free_blocks;
+  CPUBlockSet _large_free_blocks;
+  std::unordered_map<Stream, CPUBlockSet> _stashed_blocks;
+  std::unordered_map<uint64_t, CPUBlock*> _stash_lookup;
+  std::unordered_set<CPUBlock*> _segments;
+  uint64_t _next_stash_id{1};
+  size_t _reserved{0};
+  size_t _peak_reserved{0};
+  size_t _requested{0};
+  uint64_t _malloc_cnt{0};
+  uint64_t _reuse_cnt{0};
+  uint64_t _stream_reuse_cnt{0};
+  uint64_t _split_cnt{0};
+  uint64_t _release_cnt{0};
 };
 
 } // namespace impl
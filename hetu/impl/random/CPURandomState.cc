@@ -6,6 +6,7 @@ namespace impl {
 
 namespace {
 uint64_t cpu_random_seed = 0;
+uint64_t cpu_random_offset = 0;
 std::mt19937_64 cpu_random_engine;
 std::mutex cpu_random_state_mutex;
 } // namespace
@@ -13,7 +14,9 @@ std::mutex cpu_random_state_mutex;
 void SetCPURandomSeed(uint64_t seed) {
   if (seed == 0)
     return;
+  std::lock_guard<std::mutex> lock(cpu_random_state_mutex);
   cpu_random_seed = seed;
+  cpu_random_offset = 0;
   cpu_random_engine.seed(seed);
 }
 
@@ -28,5 +31,27 @@ uint64_t GenNextRandomSeed() {
   }
 }
 
+CPURandomState GetCPURandomState(uint64_t seed, uint64_t num_minimum_calls) {
+  if (seed != 0) {
+    // Case 1: Kernel called with a provided seed.
+    // Use it for once.
+    return CPURandomState(seed);
+  } else if (cpu_random_seed != 0) {
+    // Case 2: Kernel called without a provided seed
+    // while the CPU has been manually seeded.
+    // Share the random state.
+    std::lock_guard<std::mutex> lock(cpu_random_state_mutex);
+    CPURandomState ret(cpu_random_seed, cpu_random_offset);
+    cpu_random_offset += num_minimum_calls;
+    return ret;
+  } else {
+    // Case 3: Kernel called without a provided seed
+    // and the CPU has not been manually seeded.
+    // Generate a random seed and use it for once.
+    seed = std::chrono::system_clock::now().time_since_epoch().count();
+    return CPURandomState(seed);
+  }
+}
+
 } // namespace impl
 } // namespace hetu
@@ -6,8 +6,18 @@
 namespace hetu {
 namespace impl {
 
+struct CPURandomState {
+  CPURandomState(uint64_t seed_ = 0, uint64_t offset_ = 0)
+  : seed(seed_), offset(offset_) {}
+  uint64_t seed;
+  uint64_t offset;
+};
+
 void SetCPURandomSeed(uint64_t seed);
 uint64_t GenNextRandomSeed();
+// Random state for the Philox-based CPU kernels, following the same rules
+// as GetCUDARandomState.
+CPURandomState GetCPURandomState(uint64_t seed, uint64_t num_minimum_calls);
 
 } // namespace impl
 } // namespace hetu
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "hetu/common/macros.h"
+#include <array>
+#include <cmath>
+
+namespace hetu {
+namespace impl {
+
+/******************************************************
+ * Philox4x32-10 counter-based generator for CPU kernels.
+ *
+ * The key is the 64-bit seed and the 128-bit counter holds the index of a
+ * block of four values (low 64 bits) and the offset of the random state
+ * (high 64 bits), the same (seed, subsequence, offset) split as curand.
+ * Since each block is a pure function of (seed, offset, index), kernels
+ * can fill any range of elements in any order and from any number of
+ * threads and still get identical values. Element `i` takes lane `i % 4`
+ * of block `i / 4`.
+ ******************************************************/
+
+class Philox4x32 {
+ public:
+  using Block = std::array<uint32_t, 4>;
+
+  Philox4x32(uint64_t seed, uint64_t offset)
+  : _key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+    _offset(offset) {}
+
+  inline Block operator()(uint64_t index) const {
+    return generate(index, _offset);
+  }
+
+  // An independent stream for values that have to be redrawn, e.g., the
+  // rejected samples of truncated normal distributions. `index` is the
+  // element index rather than the block index.
+  inline Block redraw(uint64_t index, uint64_t attempt) const {
+    return generate(index | kRedrawBit, _offset + attempt);
+  }
+
+ private:
+  static constexpr uint64_t kRedrawBit = uint64_t(1) << 63;
+  static constexpr uint32_t kMul0 = 0xD2511F53;
+  static constexpr uint32_t kMul1 = 0xCD9E8D57;
+  static constexpr uint32_t kWeyl0 = 0x9E3779B9;
+  static constexpr uint32_t kWeyl1 = 0xBB67AE85;
+
+  inline Block generate(uint64_t index, uint64_t offset) const {
+    Block ctr = {static_cast<uint32_t>(index),
+                 static_cast<uint32_t>(index >> 32),
+                 static_cast<uint32_t>(offset),
+                 static_cast<uint32_t>(offset >> 32)};
+    uint32_t k0 = _key[0], k1 = _key[1];
+    for (int round = 0; round < 10; ++round) {
+      uint64_t p0 = static_cast<uint64_t>(kMul0) * ctr[0];
+      uint64_t p1 = static_cast<uint64_t>(kMul1) * ctr[2];
+      ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ k0,
+             static_cast<uint32_t>(p1),
+             static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ k1,
+             static_cast<uint32_t>(p0)};
+      k0 += kWeyl0;
+      k1 += kWeyl1;
+    }
+    return ctr;
+  }
+
+  uint32_t _key[2];
+  uint64_t _offset;
+};
+
+// Maps 32 random bits to a float uniformly distributed in (0, 1).
+inline float PhiloxUniform(uint32_t x) {
+  return ((x >> 8) + 0.5f) * (1.0f / 16777216.0f);
+}
+
+// Four uniform values in (0, 1).
+inline std::array<float, 4> PhiloxUniform4(const Philox4x32::Block& bits) {
+  return {PhiloxUniform(bits[0]), PhiloxUniform(bits[1]),
+          PhiloxUniform(bits[2]), PhiloxUniform(bits[3])};
+}
+
+// Four standard normal values, with Box-Muller on lanes (0, 1) and (2, 3).
+inline std::array<float, 4> PhiloxNormal4(const Philox4x32::Block& bits) {
+  std::array<float, 4> ret;
+  for (int i = 0; i < 4; i += 2) {
+    float radius = std::sqrt(-2.0f * std::log(PhiloxUniform(bits[i])));
+    float theta = 6.2831853071795864f * PhiloxUniform(bits[i + 1]);
+    ret[i] = radius * std::cos(theta);
+    ret[i + 1] = radius * std::sin(theta);
+  }
+  return ret;
+}
+
+// Calls `f(i, lane_value)` for elements [begin, end) with `block_fn(index)`
+// producing the four values of each block.
+template <typename BlockFn, typename F>
+inline void PhiloxForRange(uint64_t begin, uint64_t end, BlockFn&& block_fn,
+                           F&& f) {
+  uint64_t i = begin;
+  while (i < end) {
+    auto values = block_fn(i / 4);
+    for (uint64_t lane = i % 4; lane < 4 && i < end; ++lane, ++i)
+      f(i, values[lane]);
+  }
+}
+
+} // namespace impl
+} // namespace hetu
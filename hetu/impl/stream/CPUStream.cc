@@ -1,5 +1,6 @@
 #include "hetu/impl/stream/CPUStream.h"
 #include "hetu/utils/task_queue.h"
+#include "hetu/utils/thread_pool.h"
 #include <mutex>
 
 namespace hetu {
@@ -7,17 +8,85 @@ namespace impl {
 
 namespace {
 
+// Two executors are supported for CPU streams:
+// (1) "thread" (default): each stream owns a single-worker TaskQueue;
+// (2) "pool": all streams share a work-stealing thread pool and each stream
+//     is a SerialExecutor on it, which preserves the per-stream FIFO order.
+// The shared pool also serves intra-op parallelism (CPUParallelFor) in both
+// modes.
+static bool ParseUseThreadPool() {
+  const char* executor_str = std::getenv("HETU_CPU_STREAM_EXECUTOR");
+  if (executor_str == NULL)
+    return false;
+  std::string executor(executor_str);
+  if (executor == "pool")
+    return true;
+  if (executor != "thread") {
+    HT_LOG_WARN
+      << "Invalid HETU_CPU_STREAM_EXECUTOR: " << executor_str << " is set"
+      << ", please provide \"thread\" or \"pool\""
+      << ", default value will be used in this process.";
+  }
+  return false;
+}
+
+static size_t ParseNumPoolThreads() {
+  // Each stream occupies at most one worker at a time. Keeping at least one
+  // worker per stream ensures that a stream blocked on an event of another
+  // stream can never starve the latter.
+  size_t min_num_threads = HT_NUM_STREAMS_PER_DEVICE;
+  size_t num_threads =
+    MAX(static_cast<size_t>(std::thread::hardware_concurrency()),
+        min_num_threads);
+  const char* num_threads_str = std::getenv("HETU_CPU_STREAM_NUM_THREADS");
+  if (num_threads_str != NULL) {
+    try {
+      num_threads = std::stoi(num_threads_str);
+      if (num_threads < min_num_threads) {
+        HT_LOG_WARN << "HETU_CPU_STREAM_NUM_THREADS is raised from "
+                    << num_threads << " to " << min_num_threads
+                    << " to avoid starvation among CPU streams.";
+        num_threads = min_num_threads;
+      }
+    } catch (const std::exception& e) {
+      HT_LOG_WARN
+        << "Invalid HETU_CPU_STREAM_NUM_THREADS: " << num_threads_str
+        << " is set, please provide an integer"
+        << ", default value will be used in this process.";
+    }
+  }
+  return num_threads;
+}
+
+static bool UseCPUThreadPool() {
+  static const bool use_cpu_thread_pool = ParseUseThreadPool();
+  return use_cpu_thread_pool;
+}
+
+static WorkStealingThreadPool& GetCPUThreadPool() {
+  static WorkStealingThreadPool cpu_thread_pool("CPUThreadPool",
+                                                ParseNumPoolThreads());
+  return cpu_thread_pool;
+}
+
 static std::once_flag
   cpu_stream_task_queue_init_flags[HT_NUM_STREAMS_PER_DEVICE];
 static std::vector<std::unique_ptr<TaskQueue>>
   cpu_stream_task_queues(HT_NUM_STREAMS_PER_DEVICE);
+static std::vector<std::unique_ptr<SerialExecutor>>
+  cpu_stream_executors(HT_NUM_STREAMS_PER_DEVICE);
 
 static void InitTaskQueueForCPUStream(StreamIndex stream_index) {
-  HT_ASSERT(cpu_stream_task_queues[stream_index] == nullptr)
+  HT_ASSERT(cpu_stream_task_queues[stream_index] == nullptr &&
+            cpu_stream_executors[stream_index] == nullptr)
     << "CPUStream task queues must be initialized by calling "
     << "InitTaskQueueForCPUStreamOnce";
-  cpu_stream_task_queues[stream_index].reset(
-    new TaskQueue("CPUStream(" + std::to_string(stream_index) + ")", 1));
+  const std::string name = "CPUStream(" + std::to_string(stream_index) + ")";
+  if (UseCPUThreadPool())
+    cpu_stream_executors[stream_index].reset(
+      new SerialExecutor(name, GetCPUThreadPool()));
+  else
+    cpu_stream_task_queues[stream_index].reset(new TaskQueue(name, 1));
 }
 
 static void InitTaskQueueForCPUStreamOnce(StreamIndex stream_index) {
@@ -25,6 +94,14 @@ static void InitTaskQueueForCPUStreamOnce(StreamIndex stream_index) {
                  InitTaskQueueForCPUStream, stream_index);
 }
 
+static bool IsCPUStreamRunning(StreamIndex stream_index) {
+  if (UseCPUThreadPool())
+    return cpu_stream_executors[stream_index] != nullptr &&
+      cpu_stream_executors[stream_index]->running();
+  return cpu_stream_task_queues[stream_index] != nullptr &&
+    cpu_stream_task_queues[stream_index]->running();
+}
+
 } // namespace
 
 CPUStream::CPUStream(const Stream& stream) : _stream_id{stream.stream_index()} {
@@ -43,14 +120,26 @@ std::future<void> CPUStream::EnqueueTask(std::function<void()> f,
     return std::future<void>();
   } else {
     InitTaskQueueForCPUStreamOnce(_stream_id);
-    return cpu_stream_task_queues[_stream_id]->Enqueue(f, name);
+    if (UseCPUThreadPool())
+      return cpu_stream_executors[_stream_id]->Enqueue(std::move(f), name);
+    return cpu_stream_task_queues[_stream_id]->Enqueue(std::move(f), name);
+  }
+}
+
+void CPUStream::PostTask(InlineFunction<64> f, const std::string& name) {
+  if (_stream_id == kBlockingStream) {
+    f();
+  } else {
+    InitTaskQueueForCPUStreamOnce(_stream_id);
+    if (UseCPUThreadPool())
+      cpu_stream_executors[_stream_id]->Post(std::move(f), name);
+    else
+      cpu_stream_task_queues[_stream_id]->Post(std::move(f), name);
   }
 }
 
 void CPUStream::Sync() {
-  if (_stream_id == kBlockingStream ||
-      cpu_stream_task_queues[_stream_id] == nullptr ||
-      !cpu_stream_task_queues[_stream_id]->running())
+  if (_stream_id == kBlockingStream || !IsCPUStreamRunning(_stream_id))
     return;
   // Walkaround: Instead of blocking the task queues,
   // we create an event for simplicity.
@@ -64,5 +153,10 @@ void SynchronizeAllCPUStreams() {
     CPUStream(Stream(kCPU, i)).Sync();
 }
 
+void CPUParallelFor(int64_t begin, int64_t end, int64_t grain_size,
+                    const std::function<void(int64_t, int64_t)>& f) {
+  GetCPUThreadPool().ParallelFor(begin, end, grain_size, f);
+}
+
 } // namespace impl
 } // namespace hetu
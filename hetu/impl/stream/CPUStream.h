@@ -1,6 +1,7 @@
 #pragma once
 
 #include "hetu/core/stream.h"
+#include "hetu/utils/inline_function.h"
 #include <functional>
 #include <chrono>
 #include <condition_variable>
@@ -16,6 +17,10 @@ class CPUStream final {
   std::future<void> EnqueueTask(std::function<void()> f,
                                 const std::string& name = "");
 
+  // Same as `EnqueueTask` but skips creating a future, which is cheaper
+  // for the common case where the caller never waits on the task.
+  void PostTask(InlineFunction<64> f, const std::string& name = "");
+
   void Sync();
 
   inline StreamIndex stream_id() const noexcept {
@@ -36,6 +41,15 @@ inline CPUStream GetCPUComputingStream() {
 
 void SynchronizeAllCPUStreams();
 
+// Default number of iterations per chunk for element-wise kernels
+constexpr int64_t kCPUParallelGrainSize = 32768;
+
+// Run `f(chunk_begin, chunk_end)` over [begin, end) on the shared CPU thread
+// pool, with chunks of at least `grain_size` iterations. Kernels running in
+// CPU stream tasks can use it instead of nested OpenMP regions.
+void CPUParallelFor(int64_t begin, int64_t end, int64_t grain_size,
+                    const std::function<void(int64_t, int64_t)>& f);
+
 class CPUEvent final : public Event {
  public:
   CPUEvent(bool enable_timing = true) : Event(Device(kCPU), enable_timing) {
@@ -61,7 +75,7 @@ class CPUEvent final : public Event {
 
   inline void Block(const Stream& stream) {
     HT_ASSERT(_recorded) << "Event has not been recorded";
-    CPUStream(stream).EnqueueTask(_block_fn, "Event_Block");
+    CPUStream(stream).PostTask(_block_fn, "Event_Block");
   }
 
   inline int64_t TimeSince(const Event& event) const {
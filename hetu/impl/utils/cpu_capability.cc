@@ -0,0 +1,78 @@
+#include "hetu/impl/utils/cpu_capability.h"
+#include <algorithm>
+#include <cctype>
+
+namespace hetu {
+namespace impl {
+
+namespace {
+
+static CPUCapability DetectCPUCapability() {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq"))
+    return CPUCapability::AVX512;
+  // F16C is implied by AVX2 on all the processors we know of.
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return CPUCapability::AVX2;
+#endif
+  return CPUCapability::DEFAULT;
+}
+
+static CPUCapability ParseCPUCapability() {
+  CPUCapability capability = DetectCPUCapability();
+  const char* env = std::getenv("HETU_CPU_CAPABILITY");
+  if (env == nullptr)
+    return capability;
+  std::string str(env);
+  std::transform(str.begin(), str.end(), str.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  CPUCapability requested;
+  if (str == "default") {
+    requested = CPUCapability::DEFAULT;
+  } else if (str == "avx2") {
+    requested = CPUCapability::AVX2;
+  } else if (str == "avx512") {
+    requested = CPUCapability::AVX512;
+  } else {
+    HT_LOG_WARN << "Invalid HETU_CPU_CAPABILITY: " << env
+                << ", please provide \"default\", \"avx2\" or \"avx512\""
+                << ", " << capability << " will be used in this process.";
+    return capability;
+  }
+  if (requested > capability) {
+    HT_LOG_WARN << "HETU_CPU_CAPABILITY " << requested
+                << " is not supported by the CPU, " << capability
+                << " will be used in this process.";
+    return capability;
+  }
+  return requested;
+}
+
+} // namespace
+
+CPUCapability GetCPUCapability() {
+  static CPUCapability capability = ParseCPUCapability();
+  return capability;
+}
+
+std::string CPUCapabilityToString(CPUCapability capability) {
+  switch (capability) {
+    case CPUCapability::DEFAULT: return "DEFAULT";
+    case CPUCapability::AVX2: return "AVX2";
+    case CPUCapability::AVX512: return "AVX512";
+    default:
+      HT_VALUE_ERROR << "Unknown CPU capability: "
+                     << static_cast<int>(capability);
+      __builtin_unreachable();
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const CPUCapability& capability) {
+  os << CPUCapabilityToString(capability);
+  return os;
+}
+
+} // namespace impl
+} // namespace hetu
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "hetu/common/macros.h"
+
+namespace hetu {
+namespace impl {
+
+// Instruction sets that the CPU kernels are specialized for, in increasing
+// order. Each vectorized kernel is compiled once per capability and the
+// best one supported by the running CPU is picked at runtime.
+enum class CPUCapability : int8_t {
+  DEFAULT = 0,
+  AVX2, // AVX2 + FMA + F16C
+  AVX512, // AVX-512 F/BW/VL/DQ
+  NUM_CAPABILITIES
+};
+
+// The highest capability supported by both the CPU and the build. It can be
+// lowered with the environment variable HETU_CPU_CAPABILITY
+// ("default", "avx2" or "avx512").
+CPUCapability GetCPUCapability();
+
+std::string CPUCapabilityToString(CPUCapability capability);
+
+std::ostream& operator<<(std::ostream&, const CPUCapability&);
+
+} // namespace impl
+} // namespace hetu
@@ -0,0 +1,482 @@
+#pragma once
+
+#include "hetu/core/float16.h"
+#include "hetu/core/bfloat16.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/******************************************************
+ * Vectorized<T>: a fixed-width SIMD register of T for CPU kernels, the
+ * counterpart of the aligned vectors in hetu/impl/kernel/Vectorized.cuh.
+ *
+ * The instruction set is picked at compile time by defining
+ * HETU_CPU_CAPABILITY_AVX512 or HETU_CPU_CAPABILITY_AVX2 before including
+ * this header (see hetu/impl/kernel/cpu/ for the translation units that are
+ * built once per capability). Everything lives in an inline namespace named
+ * after the capability, so that the copies never collide at link time.
+ *
+ * Only float is specialized: half-precision data is widened to float on load
+ * and narrowed (round to nearest even) on store, and double/integer kernels
+ * keep using their scalar paths.
+ ******************************************************/
+
+#if defined(HETU_CPU_CAPABILITY_AVX512)
+#define HETU_CPU_CAPABILITY AVX512
+#include <immintrin.h>
+#elif defined(HETU_CPU_CAPABILITY_AVX2)
+#define HETU_CPU_CAPABILITY AVX2
+#include <immintrin.h>
+#else
+#define HETU_CPU_CAPABILITY DEFAULT
+#endif
+
+namespace hetu {
+namespace impl {
+namespace vec {
+inline namespace HETU_CPU_CAPABILITY {
+
+template <typename T>
+class Vectorized;
+
+#if defined(HETU_CPU_CAPABILITY_AVX512)
+
+template <>
+class Vectorized<float> {
+ private:
+  __m512 values;
+
+ public:
+  using value_type = float;
+  static constexpr int64_t size() {
+    return 16;
+  }
+
+  Vectorized() : values(_mm512_setzero_ps()) {}
+  Vectorized(__m512 v) : values(v) {}
+  Vectorized(float v) : values(_mm512_set1_ps(v)) {}
+  operator __m512() const {
+    return values;
+  }
+
+  static Vectorized loadu(const float* ptr) {
+    return _mm512_loadu_ps(ptr);
+  }
+  static Vectorized loadu(const float16* ptr) {
+    return _mm512_cvtph_ps(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+  }
+  static Vectorized loadu(const bfloat16* ptr) {
+    __m512i bits = _mm512_cvtepu16_epi32(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(bits, 16));
+  }
+  void store(float* ptr) const {
+    _mm512_storeu_ps(ptr, values);
+  }
+  void store(float16* ptr) const {
+    _mm256_storeu_si256(
+      reinterpret_cast<__m256i*>(ptr),
+      _mm512_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+  }
+  void store(bfloat16* ptr) const {
+    __m512i bits = _mm512_castps_si512(values);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16),
+                                   _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_srli_epi32(
+      _mm512_add_epi32(bits, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7FFF))),
+      16);
+    __mmask16 nan = _mm512_cmp_ps_mask(values, values, _CMP_UNORD_Q);
+    rounded = _mm512_mask_mov_epi32(rounded, nan, _mm512_set1_epi32(0x7FC0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr),
+                        _mm512_cvtepi32_epi16(rounded));
+  }
+
+  Vectorized operator+(const Vectorized& o) const {
+    return _mm512_add_ps(values, o);
+  }
+  Vectorized operator-(const Vectorized& o) const {
+    return _mm512_sub_ps(values, o);
+  }
+  Vectorized operator*(const Vectorized& o) const {
+    return _mm512_mul_ps(values, o);
+  }
+  Vectorized operator/(const Vectorized& o) const {
+    return _mm512_div_ps(values, o);
+  }
+  Vectorized operator-() const {
+    return _mm512_castsi512_ps(_mm512_xor_si512(
+      _mm512_castps_si512(values), _mm512_set1_epi32(0x80000000)));
+  }
+  Vectorized abs() const {
+    return _mm512_castsi512_ps(_mm512_and_si512(
+      _mm512_castps_si512(values), _mm512_set1_epi32(0x7FFFFFFF)));
+  }
+  // magnitude of this, sign of `sign`
+  Vectorized copysign(const Vectorized& sign) const {
+    __m512i mask = _mm512_set1_epi32(0x80000000);
+    return _mm512_castsi512_ps(_mm512_or_si512(
+      _mm512_andnot_si512(mask, _mm512_castps_si512(values)),
+      _mm512_and_si512(mask, _mm512_castps_si512(sign))));
+  }
+  Vectorized sqrt() const {
+    return _mm512_sqrt_ps(values);
+  }
+  Vectorized exp() const {
+    // Cephes expf: exp(x) = 2^n * exp(r) with |r| <= ln(2)/2
+    __m512 x = _mm512_min_ps(values, _mm512_set1_ps(88.3762626647949f));
+    x = _mm512_max_ps(x, _mm512_set1_ps(-87.3365447504019f));
+    __m512 n = _mm512_roundscale_ps(
+      _mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f)),
+      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+    x = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), x);
+    __m512 y = _mm512_set1_ps(1.9875691500E-4f);
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.3981999507E-3f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(8.3334519073E-3f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(4.1665795894E-2f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.6666665459E-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(5.0000001201E-1f));
+    y = _mm512_fmadd_ps(y, _mm512_mul_ps(x, x),
+                        _mm512_add_ps(x, _mm512_set1_ps(1.0f)));
+    __m512i pow2n = _mm512_slli_epi32(
+      _mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+    __m512 res = _mm512_mul_ps(y, _mm512_castsi512_ps(pow2n));
+    // flush the underflowed lanes instead of returning FLT_MIN
+    __mmask16 tiny = _mm512_cmp_ps_mask(
+      values, _mm512_set1_ps(-87.3365447504019f), _CMP_LT_OQ);
+    return _mm512_mask_mov_ps(res, tiny, _mm512_setzero_ps());
+  }
+};
+
+inline Vectorized<float> fmadd(const Vectorized<float>& a,
+                               const Vectorized<float>& b,
+                               const Vectorized<float>& c) {
+  return _mm512_fmadd_ps(a, b, c);
+}
+inline Vectorized<float> maximum(const Vectorized<float>& a,
+                                 const Vectorized<float>& b) {
+  return _mm512_max_ps(a, b);
+}
+inline Vectorized<float> minimum(const Vectorized<float>& a,
+                                 const Vectorized<float>& b) {
+  return _mm512_min_ps(a, b);
+}
+
+#elif defined(HETU_CPU_CAPABILITY_AVX2)
+
+template <>
+class Vectorized<float> {
+ private:
+  __m256 values;
+
+ public:
+  using value_type = float;
+  static constexpr int64_t size() {
+    return 8;
+  }
+
+  Vectorized() : values(_mm256_setzero_ps()) {}
+  Vectorized(__m256 v) : values(v) {}
+  Vectorized(float v) : values(_mm256_set1_ps(v)) {}
+  operator __m256() const {
+    return values;
+  }
+
+  static Vectorized loadu(const float* ptr) {
+    return _mm256_loadu_ps(ptr);
+  }
+  static Vectorized loadu(const float16* ptr) {
+    return _mm256_cvtph_ps(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+  }
+  static Vectorized loadu(const bfloat16* ptr) {
+    __m256i bits = _mm256_cvtepu16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 16));
+  }
+  void store(float* ptr) const {
+    _mm256_storeu_ps(ptr, values);
+  }
+  void store(float16* ptr) const {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr),
+                     _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+  }
+  void store(bfloat16* ptr) const {
+    __m256i bits = _mm256_castps_si256(values);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16),
+                                   _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_srli_epi32(
+      _mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF))),
+      16);
+    __m256 nan = _mm256_cmp_ps(values, values, _CMP_UNORD_Q);
+    rounded = _mm256_castps_si256(
+      _mm256_blendv_ps(_mm256_castsi256_ps(rounded),
+                       _mm256_castsi256_ps(_mm256_set1_epi32(0x7FC0)), nan));
+    // all lanes fit in 16 bits, so the saturating pack is exact
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(rounded),
+                                      _mm256_extracti128_si256(rounded, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), packed);
+  }
+
+  Vectorized operator+(const Vectorized& o) const {
+    return _mm256_add_ps(values, o);
+  }
+  Vectorized operator-(const Vectorized& o) const {
+    return _mm256_sub_ps(values, o);
+  }
+  Vectorized operator*(const Vectorized& o) const {
+    return _mm256_mul_ps(values, o);
+  }
+  Vectorized operator/(const Vectorized& o) const {
+    return _mm256_div_ps(values, o);
+  }
+  Vectorized operator-() const {
+    return _mm256_xor_ps(values, _mm256_set1_ps(-0.0f));
+  }
+  Vectorized abs() const {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), values);
+  }
+  // magnitude of this, sign of `sign`
+  Vectorized copysign(const Vectorized& sign) const {
+    __m256 mask = _mm256_set1_ps(-0.0f);
+    return _mm256_or_ps(_mm256_andnot_ps(mask, values),
+                        _mm256_and_ps(mask, sign));
+  }
+  Vectorized sqrt() const {
+    return _mm256_sqrt_ps(values);
+  }
+  Vectorized exp() const {
+    // Cephes expf: exp(x) = 2^n * exp(r) with |r| <= ln(2)/2
+    __m256 x = _mm256_min_ps(values, _mm256_set1_ps(88.3762626647949f));
+    x = _mm256_max_ps(x, _mm256_set1_ps(-87.3365447504019f));
+    __m256 n = _mm256_round_ps(
+      _mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), x);
+    __m256 y = _mm256_set1_ps(1.9875691500E-4f);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507E-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073E-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894E-2f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459E-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201E-1f));
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x),
+                        _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+    __m256i pow2n = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    __m256 res = _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+    // flush the underflowed lanes instead of returning FLT_MIN
+    __m256 tiny = _mm256_cmp_ps(
+      values, _mm256_set1_ps(-87.3365447504019f), _CMP_LT_OQ);
+    return _mm256_andnot_ps(tiny, res);
+  }
+};
+
+inline Vectorized<float> fmadd(const Vectorized<float>& a,
+                               const Vectorized<float>& b,
+                               const Vectorized<float>& c) {
+  return _mm256_fmadd_ps(a, b, c);
+}
+inline Vectorized<float> maximum(const Vectorized<float>& a,
+                                 const Vectorized<float>& b) {
+  return _mm256_max_ps(a, b);
+}
+inline Vectorized<float> minimum(const Vectorized<float>& a,
+                                 const Vectorized<float>& b) {
+  return _mm256_min_ps(a, b);
+}
+
+#else
+
+// Portable fallback, a plain array that the compiler may still
+// auto-vectorize with the baseline instruction set.
+template <>
+class Vectorized<float> {
+ private:
+  float values[8];
+
+ public:
+  using value_type = float;
+  static constexpr int64_t size() {
+    return 8;
+  }
+
+  Vectorized() : Vectorized(0.0f) {}
+  Vectorized(float v) {
+    std::fill(values, values + size(), v);
+  }
+  float operator[](int64_t i) const {
+    return values[i];
+  }
+  float& operator[](int64_t i) {
+    return values[i];
+  }
+
+  template <typename T>
+  static Vectorized loadu(const T* ptr) {
+    Vectorized ret;
+    for (int64_t i = 0; i < size(); i++)
+      ret.values[i] = static_cast<float>(ptr[i]);
+    return ret;
+  }
+  template <typename T>
+  void store(T* ptr) const {
+    for (int64_t i = 0; i < size(); i++)
+      ptr[i] = static_cast<T>(values[i]);
+  }
+
+  template <typename Op>
+  Vectorized map(Op op) const {
+    Vectorized ret;
+    for (int64_t i = 0; i < size(); i++)
+      ret.values[i] = op(values[i]);
+    return ret;
+  }
+  template <typename Op>
+  Vectorized map(const Vectorized& o, Op op) const {
+    Vectorized ret;
+    for (int64_t i = 0; i < size(); i++)
+      ret.values[i] = op(values[i], o.values[i]);
+    return ret;
+  }
+
+  Vectorized operator+(const Vectorized& o) const {
+    return map(o, [](float a, float b) { return a + b; });
+  }
+  Vectorized operator-(const Vectorized& o) const {
+    return map(o, [](float a, float b) { return a - b; });
+  }
+  Vectorized operator*(const Vectorized& o) const {
+    return map(o, [](float a, float b) { return a * b; });
+  }
+  Vectorized operator/(const Vectorized& o) const {
+    return map(o, [](float a, float b) { return a / b; });
+  }
+  Vectorized operator-() const {
+    return map([](float a) { return -a; });
+  }
+  Vectorized abs() const {
+    return map([](float a) { return std::abs(a); });
+  }
+  Vectorized copysign(const Vectorized& sign) const {
+    return map(sign, [](float a, float b) { return std::copysign(a, b); });
+  }
+  Vectorized sqrt() const {
+    return map([](float a) { return std::sqrt(a); });
+  }
+  Vectorized exp() const {
+    return map([](float a) { return std::exp(a); });
+  }
+};
+
+inline Vectorized<float> fmadd(const Vectorized<float>& a,
+                               const Vectorized<float>& b,
+                               const Vectorized<float>& c) {
+  return a * b + c;
+}
+inline Vectorized<float> maximum(const Vectorized<float>& a,
+                                 const Vectorized<float>& b) {
+  return a.map(b, [](float x, float y) { return std::max(x, y); });
+}
+inline Vectorized<float> minimum(const Vectorized<float>& a,
+                                 const Vectorized<float>& b) {
+  return a.map(b, [](float x, float y) { return std::min(x, y); });
+}
+
+#endif
+
+using VecF = Vectorized<float>;
+
+// Loads `count` (<= VecF::size()) elements and zero-fills the rest.
+template <typename T>
+inline VecF loadu(const T* ptr, int64_t count = VecF::size()) {
+  if (count == VecF::size())
+    return VecF::loadu(ptr);
+  T buf[VecF::size()];
+  std::memset(static_cast<void*>(buf), 0, sizeof(buf));
+  std::memcpy(static_cast<void*>(buf), ptr, count * sizeof(T));
+  return VecF::loadu(buf);
+}
+
+// Stores the first `count` (<= VecF::size()) elements.
+template <typename T>
+inline void store(const VecF& v, T* ptr, int64_t count = VecF::size()) {
+  if (count == VecF::size()) {
+    v.store(ptr);
+    return;
+  }
+  T buf[VecF::size()];
+  v.store(buf);
+  std::memcpy(static_cast<void*>(ptr), buf, count * sizeof(T));
+}
+
+// Sum of all lanes.
+inline float reduce_add(const VecF& v) {
+  float buf[VecF::size()];
+  v.store(buf);
+  float sum = 0;
+  for (int64_t i = 0; i < VecF::size(); i++)
+    sum += buf[i];
+  return sum;
+}
+
+// Gathers table[codes[i]] for the next VecF::size() byte codes.
+inline VecF lookup(const float* table, const uint8_t* codes) {
+#if defined(HETU_CPU_CAPABILITY_AVX512)
+  __m512i idx = _mm512_cvtepu8_epi32(
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes)));
+  return _mm512_i32gather_ps(idx, table, 4);
+#elif defined(HETU_CPU_CAPABILITY_AVX2)
+  __m256i idx = _mm256_cvtepu8_epi32(
+    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes)));
+  return _mm256_i32gather_ps(table, idx, 4);
+#else
+  float buf[VecF::size()];
+  for (int64_t i = 0; i < VecF::size(); i++)
+    buf[i] = table[codes[i]];
+  return VecF::loadu(buf);
+#endif
+}
+
+// Same as lookup() for a table of 16 entries (codes must be below 16), which
+// stays in registers and is indexed with permutes instead of gathers.
+inline VecF lookup16(const float* table, const uint8_t* codes) {
+#if defined(HETU_CPU_CAPABILITY_AVX512)
+  __m512i idx = _mm512_cvtepu8_epi32(
+    _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes)));
+  return _mm512_permutexvar_ps(idx, _mm512_loadu_ps(table));
+#elif defined(HETU_CPU_CAPABILITY_AVX2)
+  __m256i idx = _mm256_cvtepu8_epi32(
+    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes)));
+  __m256 lo = _mm256_permutevar8x32_ps(_mm256_loadu_ps(table), idx);
+  __m256 hi = _mm256_permutevar8x32_ps(_mm256_loadu_ps(table + 8), idx);
+  __m256i upper = _mm256_cmpgt_epi32(idx, _mm256_set1_epi32(7));
+  return _mm256_blendv_ps(lo, hi, _mm256_castsi256_ps(upper));
+#else
+  return lookup(table, codes);
+#endif
+}
+
+// Abramowitz & Stegun 7.1.26, absolute error below 1.5e-7.
+inline VecF erf(const VecF& x) {
+#if defined(HETU_CPU_CAPABILITY_AVX512) || defined(HETU_CPU_CAPABILITY_AVX2)
+  VecF ax = x.abs();
+  VecF t = VecF(1.0f) / fmadd(ax, VecF(0.3275911f), VecF(1.0f));
+  VecF poly = VecF(1.061405429f);
+  poly = fmadd(poly, t, VecF(-1.453152027f));
+  poly = fmadd(poly, t, VecF(1.421413741f));
+  poly = fmadd(poly, t, VecF(-0.284496736f));
+  poly = fmadd(poly, t, VecF(0.254829592f));
+  VecF y = VecF(1.0f) - poly * t * (-(ax * ax)).exp();
+  return y.copysign(x);
+#else
+  return x.map([](float a) { return std::erf(a); });
+#endif
+}
+
+} // inline namespace HETU_CPU_CAPABILITY
+} // namespace vec
+} // namespace impl
+} // namespace hetu
@@ -0,0 +1,125 @@
+#include "hetu/impl/utils/dnnl_utils.h"
+#include "hetu/common/logging.h"
+#include <array>
+
+namespace hetu {
+namespace cpu {
+
+namespace {
+
+static size_t GetDNNLPrimitiveCacheCapacity() {
+  size_t capacity = 1024;
+  const char* env = std::getenv("HETU_DNNL_PRIMITIVE_CACHE_CAPACITY");
+  if (env != nullptr) {
+    try {
+      capacity = std::stoull(env);
+    } catch (const std::exception& e) {
+      HT_LOG_WARN << "Invalid HETU_DNNL_PRIMITIVE_CACHE_CAPACITY: " << env
+                  << ", use default capacity " << capacity << " instead.";
+    }
+  }
+  return capacity;
+}
+
+static std::once_flag dnnl_stream_init_flags[HT_NUM_STREAMS_PER_DEVICE];
+static std::array<std::unique_ptr<dnnl::stream>, HT_NUM_STREAMS_PER_DEVICE>
+  dnnl_streams;
+
+} // namespace
+
+const dnnl::engine& GetDNNLEngine() {
+  static dnnl::engine engine(dnnl::engine::kind::cpu, 0);
+  return engine;
+}
+
+dnnl::stream& GetDNNLStream(StreamIndex stream_id) {
+  if (stream_id == kBlockingStream) {
+    // Tasks on the blocking stream run on the caller threads.
+    thread_local dnnl::stream blocking_stream(GetDNNLEngine());
+    return blocking_stream;
+  }
+  HT_ASSERT(stream_id > kBlockingStream &&
+            stream_id < HT_NUM_STREAMS_PER_DEVICE)
+    << "Invalid stream id: " << stream_id;
+  std::call_once(dnnl_stream_init_flags[stream_id], [stream_id]() {
+    dnnl_streams[stream_id].reset(new dnnl::stream(GetDNNLEngine()));
+  });
+  return *dnnl_streams[stream_id];
+}
+
+DNNLPrimitiveCache& DNNLPrimitiveCache::GetInstance() {
+  static DNNLPrimitiveCache cache(GetDNNLPrimitiveCacheCapacity());
+  return cache;
+}
+
+DNNLPrimitive DNNLPrimitiveCache::GetOrCreate(const DNNLPrimitiveKey& key,
+                                              const PrimitiveDescCtor& ctor) {
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    auto it = _table.find(key);
+    if (it != _table.end()) {
+      _lru.splice(_lru.begin(), _lru, it->second);
+      _hits++;
+      return it->second->second;
+    }
+    _misses++;
+  }
+
+  // Compile the primitive without holding the lock. If another thread
+  // races on the same key, the first inserted primitive wins.
+  auto pd = ctor();
+  DNNLPrimitive prim{pd, dnnl::primitive(pd)};
+  if (_capacity == 0)
+    return prim;
+
+  std::lock_guard<std::mutex> lock(_mtx);
+  auto it = _table.find(key);
+  if (it != _table.end()) {
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return it->second->second;
+  }
+  _lru.emplace_front(key, prim);
+  _table.emplace(key, _lru.begin());
+  while (_lru.size() > _capacity) {
+    _table.erase(_lru.back().first);
+    _lru.pop_back();
+    _evictions++;
+  }
+  return prim;
+}
+
+DNNLPrimitiveCacheStats DNNLPrimitiveCache::GetStats() {
+  std::lock_guard<std::mutex> lock(_mtx);
+  DNNLPrimitiveCacheStats stats;
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.evictions = _evictions;
+  stats.size = _lru.size();
+  stats.capacity = _capacity;
+  return stats;
+}
+
+void DNNLPrimitiveCache::ResetStats() {
+  std::lock_guard<std::mutex> lock(_mtx);
+  _hits = 0;
+  _misses = 0;
+  _evictions = 0;
+}
+
+void DNNLPrimitiveCache::Clear() {
+  std::lock_guard<std::mutex> lock(_mtx);
+  _table.clear();
+  _lru.clear();
+}
+
+void DNNLPrimitiveCache::PrintSummary() {
+  auto stats = GetStats();
+  HT_LOG_INFO << "DNNLPrimitiveCache: size=" << stats.size << ", "
+    << "capacity=" << stats.capacity << ", "
+    << "hits=" << stats.hits << ", "
+    << "misses=" << stats.misses << ", "
+    << "evictions=" << stats.evictions;
+}
+
+} // namespace cpu
+} // namespace hetu
@@ -2,7 +2,13 @@
 
 #include "hetu/common/macros.h"
 #include "hetu/core/device.h"
+#include "hetu/core/stream.h"
 #include "oneapi/dnnl/dnnl.hpp"
+#include <cstring>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace hetu {
 namespace cpu {
@@ -138,5 +144,169 @@ inline dnnl::memory::data_type dtype_to_dnnltype(DataType dtype) {
   } 
 }
 
+/******************************************************
+ * Shared engine, streams and primitive cache
+ ******************************************************/
+
+// The CPU engine shared by all DNNL-backed kernels.
+const dnnl::engine& GetDNNLEngine();
+
+// The DNNL stream bound to a CPU stream. Tasks of a (non-blocking) CPU stream
+// are executed by its own task queue, so the returned stream is never used
+// concurrently. Kernels running on the blocking stream get a thread-local one.
+dnnl::stream& GetDNNLStream(StreamIndex stream_id);
+
+inline dnnl::stream& GetDNNLStream(const Stream& stream) {
+  return GetDNNLStream(stream.stream_index());
+}
+
+// Key of a compiled primitive. Kernels describe everything that affects the
+// primitive descriptor (op kind, algorithm, dtype, shapes, strides and attrs)
+// by appending fields to the key.
+class DNNLPrimitiveKey {
+ public:
+  explicit DNNLPrimitiveKey(std::string op) : _op(std::move(op)) {
+    _hash = std::hash<std::string>()(_op);
+  }
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_integral<T>::value ||
+                                        std::is_enum<T>::value>>
+  DNNLPrimitiveKey& Add(T value) {
+    return _Append(static_cast<int64_t>(value));
+  }
+
+  DNNLPrimitiveKey& Add(float value) {
+    int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return _Append(static_cast<int64_t>(bits));
+  }
+
+  DNNLPrimitiveKey& Add(double value) {
+    int64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return _Append(bits);
+  }
+
+  DNNLPrimitiveKey& Add(const std::vector<int64_t>& values) {
+    _Append(static_cast<int64_t>(values.size()));
+    for (auto v : values)
+      _Append(v);
+    return *this;
+  }
+
+  DNNLPrimitiveKey& Add(const dnnl::memory::desc& md) {
+    Add(static_cast<int64_t>(md.get_data_type()));
+    Add(md.get_dims());
+    return Add(md.get_strides());
+  }
+
+  DNNLPrimitiveKey& Add(const std::vector<dnnl::memory::desc>& mds) {
+    _Append(static_cast<int64_t>(mds.size()));
+    for (const auto& md : mds)
+      Add(md);
+    return *this;
+  }
+
+  template <typename T, typename... Args>
+  DNNLPrimitiveKey& Add(const T& value, const Args&... args) {
+    Add(value);
+    return Add(args...);
+  }
+
+  inline size_t hash() const noexcept {
+    return _hash;
+  }
+
+  inline bool operator==(const DNNLPrimitiveKey& other) const {
+    return _hash == other._hash && _op == other._op &&
+      _fields == other._fields;
+  }
+
+ private:
+  DNNLPrimitiveKey& _Append(int64_t value) {
+    _fields.push_back(value);
+    // boost::hash_combine
+    _hash ^= std::hash<int64_t>()(value) + 0x9e3779b9 + (_hash << 6) +
+      (_hash >> 2);
+    return *this;
+  }
+
+  std::string _op;
+  std::vector<int64_t> _fields;
+  size_t _hash;
+};
+
+struct DNNLPrimitiveKeyHash {
+  inline size_t operator()(const DNNLPrimitiveKey& key) const noexcept {
+    return key.hash();
+  }
+};
+
+struct DNNLPrimitiveCacheStats {
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t evictions{0};
+  size_t size{0};
+  size_t capacity{0};
+};
+
+// A compiled primitive together with its descriptor, which is kept for
+// querying the workspace or scratchpad descriptors.
+struct DNNLPrimitive {
+  dnnl::primitive_desc pd;
+  dnnl::primitive primitive;
+
+  inline void execute(const dnnl::stream& stream,
+                      const std::unordered_map<int, dnnl::memory>& args) const {
+    primitive.execute(stream, args);
+  }
+};
+
+// A process-wide, thread-safe LRU cache of compiled primitives.
+// Primitives are immutable after creation and oneDNN allows executing
+// the same primitive from multiple threads, so cached primitives can be
+// shared by all CPU streams.
+// The capacity can be set by the `HETU_DNNL_PRIMITIVE_CACHE_CAPACITY`
+// environment variable (0 disables caching).
+class DNNLPrimitiveCache final {
+ public:
+  using PrimitiveDescCtor = std::function<dnnl::primitive_desc()>;
+
+  static DNNLPrimitiveCache& GetInstance();
+
+  DNNLPrimitive GetOrCreate(const DNNLPrimitiveKey& key,
+                            const PrimitiveDescCtor& ctor);
+
+  DNNLPrimitiveCacheStats GetStats();
+
+  void ResetStats();
+
+  void Clear();
+
+  void PrintSummary();
+
+ private:
+  using Entry = std::pair<DNNLPrimitiveKey, DNNLPrimitive>;
+
+  DNNLPrimitiveCache(size_t capacity) : _capacity(capacity) {}
+
+  std::mutex _mtx;
+  size_t _capacity;
+  std::list<Entry> _lru;
+  std::unordered_map<DNNLPrimitiveKey, std::list<Entry>::iterator,
+                     DNNLPrimitiveKeyHash>
+    _table;
+  uint64_t _hits{0};
+  uint64_t _misses{0};
+  uint64_t _evictions{0};
+};
+
+inline DNNLPrimitive
+GetOrCreateDNNLPrimitive(const DNNLPrimitiveKey& key,
+                         const DNNLPrimitiveCache::PrimitiveDescCtor& ctor) {
+  return DNNLPrimitiveCache::GetInstance().GetOrCreate(key, ctor);
+}
+
 } // namespace cpu
 } // namespace hetu
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "hetu/common/macros.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace hetu {
+
+// A move-only, type-erased `void()` callable. Callables no larger than
+// `Capacity` bytes are stored inline, and larger ones fall back to the heap.
+// Unlike std::function, it does not require the callable to be copyable,
+// so it can hold a std::packaged_task directly.
+template <size_t Capacity = 64>
+class InlineFunction final {
+ public:
+  InlineFunction() = default;
+
+  InlineFunction(std::nullptr_t) {}
+
+  template <typename F,
+            typename = std::enable_if_t<
+              !std::is_same<std::decay_t<F>, InlineFunction>::value>>
+  InlineFunction(F&& f) {
+    using Fn = std::decay_t<F>;
+    if (fits_inline<Fn>()) {
+      new (_storage) Fn(std::forward<F>(f));
+      _ops = _GetInlineOps<Fn>();
+    } else {
+      *reinterpret_cast<Fn**>(_storage) = new Fn(std::forward<F>(f));
+      _ops = _GetHeapOps<Fn>();
+    }
+  }
+
+  InlineFunction(InlineFunction&& other) noexcept {
+    _MoveFrom(other);
+  }
+
+  InlineFunction& operator=(InlineFunction&& other) noexcept {
+    if (this != &other) {
+      _Reset();
+      _MoveFrom(other);
+    }
+    return *this;
+  }
+
+  InlineFunction& operator=(std::nullptr_t) noexcept {
+    _Reset();
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction&) = delete;
+  InlineFunction& operator=(const InlineFunction&) = delete;
+
+  ~InlineFunction() {
+    _Reset();
+  }
+
+  void operator()() {
+    HT_ASSERT(_ops != nullptr) << "Calling an empty InlineFunction";
+    _ops->invoke(_storage);
+  }
+
+  explicit operator bool() const noexcept {
+    return _ops != nullptr;
+  }
+
+  bool is_inline() const noexcept {
+    return _ops != nullptr && _ops->is_inline;
+  }
+
+  template <typename F>
+  static constexpr bool fits_inline() {
+    return sizeof(F) <= Capacity &&
+      alignof(F) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible<F>::value;
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void*);
+    // Move-construct into `dst` and destroy `src`
+    void (*relocate)(void* dst, void* src);
+    void (*destroy)(void*);
+    bool is_inline;
+  };
+
+  template <typename Fn>
+  static void _InvokeInline(void* p) {
+    (*reinterpret_cast<Fn*>(p))();
+  }
+
+  template <typename Fn>
+  static void _RelocateInline(void* dst, void* src) {
+    new (dst) Fn(std::move(*reinterpret_cast<Fn*>(src)));
+    reinterpret_cast<Fn*>(src)->~Fn();
+  }
+
+  template <typename Fn>
+  static void _DestroyInline(void* p) {
+    reinterpret_cast<Fn*>(p)->~Fn();
+  }
+
+  template <typename Fn>
+  static void _InvokeHeap(void* p) {
+    (**reinterpret_cast<Fn**>(p))();
+  }
+
+  static void _RelocateHeap(void* dst, void* src) {
+    *reinterpret_cast<void**>(dst) = *reinterpret_cast<void**>(src);
+  }
+
+  template <typename Fn>
+  static void _DestroyHeap(void* p) {
+    delete *reinterpret_cast<Fn**>(p);
+  }
+
+  template <typename Fn>
+  static const Ops* _GetInlineOps() {
+    static constexpr Ops ops = {&_InvokeInline<Fn>, &_RelocateInline<Fn>,
+                                &_DestroyInline<Fn>, true};
+    return &ops;
+  }
+
+  template <typename Fn>
+  static const Ops* _GetHeapOps() {
+    static constexpr Ops ops = {&_InvokeHeap<Fn>, &_RelocateHeap,
+                                &_DestroyHeap<Fn>, false};
+    return &ops;
+  }
+
+  void _MoveFrom(InlineFunction& other) noexcept {
+    _ops = other._ops;
+    if (_ops != nullptr) {
+      _ops->relocate(_storage, other._storage);
+      other._ops = nullptr;
+    }
+  }
+
+  void _Reset() noexcept {
+    if (_ops != nullptr) {
+      _ops->destroy(_storage);
+      _ops = nullptr;
+    }
+  }
+
+  static_assert(Capacity >= sizeof(void*),
+                "InlineFunction must be able to hold a pointer");
+
+  alignas(std::max_align_t) unsigned char _storage[Capacity];
+  const Ops* _ops{nullptr};
+};
+
+} // namespace hetu
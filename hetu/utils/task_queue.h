@@ -1,6 +1,7 @@
 #pragma once
 
 #include "hetu/common/macros.h"
+#include "hetu/utils/inline_function.h"
 #include <type_traits>
 #include <functional>
 #include <queue>
@@ -9,12 +10,31 @@
 #include <atomic>
 #include <thread>
 #include <future>
+#include <exception>
 
 namespace hetu {
 
-// A lightweight task queue
+// A lightweight task queue.
+// Tasks are kept in a bounded ring buffer (Vyukov's bounded MPMC queue), so
+// enqueueing a task from any thread only takes a CAS on the tail. Workers
+// spin for a while when the queue is empty before parking on a condition
+// variable, and producers only touch the mutex when some worker is parked.
+// Small tasks are stored inline in the ring buffer.
 class TaskQueue final {
-  using Task = std::tuple<std::function<void()>, uint64_t, std::string>;
+  using TaskFn = InlineFunction<64>;
+
+  struct Task {
+    TaskFn fn;
+    uint64_t id;
+    std::string name;
+  };
+
+  struct alignas(64) Cell {
+    std::atomic<uint64_t> sequence;
+    Task task;
+  };
+
+  static constexpr int kNumSpins = 1024;
 
  public:
   TaskQueue(const std::string& queue_name, size_t num_workers,
@@ -22,6 +42,14 @@ class TaskQueue final {
   : _queue_name(queue_name), _max_pending_tasks(max_pending_tasks) {
     HT_ASSERT(num_workers > 0) << "Number of workers must be positive.";
     HT_ASSERT(max_pending_tasks > 0) << "Max pending tasks must be positive.";
+    // The capacity of the ring buffer is rounded up to a power of two
+    uint64_t capacity = 1;
+    while (capacity < max_pending_tasks)
+      capacity <<= 1;
+    _mask = capacity - 1;
+    _cells.reset(new Cell[capacity]);
+    for (uint64_t i = 0; i < capacity; i++)
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
     _workers.reserve(num_workers);
     for (size_t i = 0; i < num_workers; i++)
       _workers.emplace_back(&TaskQueue::_RunWorker, this, i);
@@ -36,25 +64,18 @@ class TaskQueue final {
 
   std::future<void> Enqueue(std::function<void()> f,
                             const std::string& name = "") {
-    HT_ASSERT(!_shutdowned) << "The task queue has been shutdowned.";
-
-    auto task_f = std::make_shared<std::packaged_task<void()>>(std::move(f));
-    auto future = task_f->get_future();
-
-    {
-      std::unique_lock<std::mutex> lock(_mutex);
-      while (_tasks.size() >= _max_pending_tasks) {
-        _dequeue_signal.wait(lock);
-        HT_ASSERT(!_shutdowned) << "The task queue has been shutdowned.";
-      }
-      auto task_id = _num_enqueued_tasks++;
-      _tasks.push_back({[task_f] { (*task_f)(); }, task_id, name});
-      _enqueue_signal.notify_one();
-    }
-
+    std::packaged_task<void()> task_f(std::move(f));
+    auto future = task_f.get_future();
+    _Push(TaskFn(std::move(task_f)), name);
     return future;
   }
 
+  // Enqueue a task without creating a future for it
+  template <typename F>
+  void Post(F&& f, const std::string& name = "") {
+    _Push(TaskFn(std::forward<F>(f)), name);
+  }
+
   void Shutdown() {
     std::unique_lock<std::mutex> lock(_mutex);
     _shutdowned = true;
@@ -71,7 +92,13 @@ class TaskQueue final {
   }
 
   uint64_t num_enqueued_tasks() const {
-    return _num_enqueued_tasks;
+    return _tail.load(std::memory_order_relaxed);
+  }
+
+  uint64_t num_pending_tasks() const {
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
   }
 
   int num_workers() const {
@@ -83,33 +110,131 @@ class TaskQueue final {
   }
 
  private:
+  bool _TryPush(TaskFn& fn, const std::string& name) {
+    uint64_t pos = _tail.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &_cells[pos & _mask];
+      uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+      if (diff == 0) {
+        if (_tail.compare_exchange_weak(pos, pos + 1))
+          break;
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = _tail.load(std::memory_order_relaxed);
+      }
+    }
+    cell->task.fn = std::move(fn);
+    cell->task.id = pos;
+    cell->task.name = name;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool _TryPop(Task& task) {
+    uint64_t pos = _head.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &_cells[pos & _mask];
+      uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+      if (diff == 0) {
+        if (_head.compare_exchange_weak(pos, pos + 1))
+          break;
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = _head.load(std::memory_order_relaxed);
+      }
+    }
+    task.fn = std::move(cell->task.fn);
+    task.id = cell->task.id;
+    task.name.swap(cell->task.name);
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool _Empty() const {
+    return _head.load() >= _tail.load();
+  }
+
+  bool _Full() const {
+    return _tail.load() - _head.load() > _mask;
+  }
+
+  void _Push(TaskFn fn, const std::string& name) {
+    HT_ASSERT(!_shutdowned) << "The task queue has been shutdowned.";
+    int spins = 0;
+    while (!_TryPush(fn, name)) {
+      if (spins++ < kNumSpins) {
+        std::this_thread::yield();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(_mutex);
+      _num_waiting_producers++;
+      _dequeue_signal.wait(lock, [this] { return _shutdowned || !_Full(); });
+      _num_waiting_producers--;
+      HT_ASSERT(!_shutdowned) << "The task queue has been shutdowned.";
+    }
+    // `_tail` has been advanced before checking the parked workers, and a
+    // worker checks `_tail` after registering itself as parked, so at least
+    // one of them sees the other.
+    if (_num_parked_workers.load() > 0) {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _enqueue_signal.notify_one();
+    }
+  }
+
   static void _RunWorker(TaskQueue* const task_queue, int worker_id) {
     uint64_t num_processed = 0;
     const std::string worker_name = "TaskQueue[" + task_queue->name() +
       "] Worker[" + std::to_string(worker_id) + "]";
+    Task task;
+    int spins = 0;
     while (true) {
-      std::unique_lock<std::mutex> lock(task_queue->_mutex);
-      if (task_queue->_tasks.empty()) {
-        task_queue->_enqueue_signal.wait(lock, [&task_queue] {
-          return task_queue->_shutdowned || !task_queue->_tasks.empty();
-        });
-        if (task_queue->_shutdowned && task_queue->_tasks.empty())
-          break;
-      } else {
-        auto task = std::move(task_queue->_tasks.front());
-        task_queue->_tasks.pop_front();
-        task_queue->_dequeue_signal.notify_one();
-        lock.unlock();
-
-        auto& task_id = std::get<1>(task);
-        auto& task_name = std::get<2>(task);
-        HT_LOG_TRACE << worker_name << " Processing task " << task_id << " \""
-                     << task_name << "\"...";
-        std::get<0>(task)();
-        HT_LOG_TRACE << worker_name << " Processed task " << task_id << " \""
-                     << task_name << "\" successfully.";
+      if (task_queue->_TryPop(task)) {
+        spins = 0;
+        if (task_queue->_num_waiting_producers.load() > 0) {
+          std::lock_guard<std::mutex> lock(task_queue->_mutex);
+          task_queue->_dequeue_signal.notify_one();
+        }
+
+        HT_LOG_TRACE << worker_name << " Processing task " << task.id << " \""
+                     << task.name << "\"...";
+        // Exceptions of enqueued tasks are kept in their futures. Those of
+        // posted tasks have nowhere to go, so they are logged and the worker
+        // moves on to the next task.
+        try {
+          task.fn();
+          HT_LOG_TRACE << worker_name << " Processed task " << task.id
+                       << " \"" << task.name << "\" successfully.";
+        } catch (const std::exception& e) {
+          HT_LOG_ERROR << worker_name << " Task " << task.id << " \""
+                       << task.name << "\" failed: " << e.what();
+        } catch (...) {
+          HT_LOG_ERROR << worker_name << " Task " << task.id << " \""
+                       << task.name << "\" failed with an unknown exception.";
+        }
+        task.fn = nullptr;
         num_processed++;
+        continue;
       }
+      if (!task_queue->_Empty() || spins++ < kNumSpins) {
+        // Either a producer is publishing a task or we are still spinning
+        std::this_thread::yield();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(task_queue->_mutex);
+      task_queue->_num_parked_workers++;
+      task_queue->_enqueue_signal.wait(lock, [&task_queue] {
+        return task_queue->_shutdowned || !task_queue->_Empty();
+      });
+      task_queue->_num_parked_workers--;
+      if (task_queue->_shutdowned && task_queue->_Empty())
+        break;
+      spins = 0;
     }
     if (num_processed > 0)
       HT_LOG_DEBUG << worker_name << " Summary: " << num_processed
@@ -118,14 +243,18 @@ class TaskQueue final {
 
   const std::string _queue_name;
   uint64_t _max_pending_tasks;
-  std::atomic<uint64_t> _num_enqueued_tasks{0};
-  std::deque<Task> _tasks;
+  std::unique_ptr<Cell[]> _cells;
+  uint64_t _mask;
+  alignas(64) std::atomic<uint64_t> _tail{0};
+  alignas(64) std::atomic<uint64_t> _head{0};
+  alignas(64) std::atomic<int> _num_parked_workers{0};
+  std::atomic<int> _num_waiting_producers{0};
 
   std::mutex _mutex;
   std::condition_variable _enqueue_signal;
   std::condition_variable _dequeue_signal;
   std::vector<std::thread> _workers;
-  bool _shutdowned{false};
+  std::atomic<bool> _shutdowned{false};
 };
 
 } // namespace hetu
@@ -0,0 +1,399 @@
+#pragma once
+
+#include "hetu/common/macros.h"
+#include "hetu/utils/inline_function.h"
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <memory>
+#include <exception>
+#include <tuple>
+
+namespace hetu {
+
+// A work-stealing thread pool. Each worker owns a deque of tasks. Tasks
+// submitted by a worker are pushed to its own deque and popped in LIFO order,
+// while idle workers steal from the front of the others' deques. Tasks
+// submitted by other threads are distributed in a round-robin manner.
+class WorkStealingThreadPool final {
+ public:
+  using Task = std::function<void()>;
+
+  WorkStealingThreadPool(const std::string& pool_name, size_t num_workers)
+  : _pool_name(pool_name) {
+    HT_ASSERT(num_workers > 0) << "Number of workers must be positive.";
+    _queues.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; i++)
+      _queues.emplace_back(new WorkerQueue());
+    _workers.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; i++)
+      _workers.emplace_back(&WorkStealingThreadPool::_RunWorker, this, i);
+  }
+
+  ~WorkStealingThreadPool() {
+    if (!_shutdowned)
+      Shutdown();
+    for (auto& worker : _workers)
+      worker.join();
+  }
+
+  void Submit(Task task) {
+    // Workers drain the pending tasks before exiting, so they are still
+    // allowed to submit follow-up tasks during shutdown.
+    HT_ASSERT(!_shutdowned || in_worker())
+      << "The thread pool has been shutdowned.";
+    size_t queue_id;
+    if (_current_pool() == this)
+      queue_id = _current_worker_id();
+    else
+      queue_id = _next_queue.fetch_add(1, std::memory_order_relaxed) %
+        _queues.size();
+    // Count the task before publishing it so that `_num_pending` never
+    // underflows when it is taken right away.
+    _num_pending.fetch_add(1);
+    {
+      auto& queue = *_queues[queue_id];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    _num_submitted.fetch_add(1, std::memory_order_relaxed);
+    if (_num_idle.load() > 0) {
+      std::lock_guard<std::mutex> lock(_idle_mutex);
+      _wakeup_signal.notify_one();
+    }
+  }
+
+  // Split [begin, end) into chunks of at least `grain_size` and run
+  // `f(chunk_begin, chunk_end)` on the pool. The caller takes part in the
+  // computation and returns after all chunks are done. Chunks are claimed
+  // from a shared counter, so the caller never waits on tasks queued
+  // behind it and nested calls are safe.
+  void ParallelFor(int64_t begin, int64_t end, int64_t grain_size,
+                   const std::function<void(int64_t, int64_t)>& f) {
+    if (end <= begin)
+      return;
+    grain_size = MAX(grain_size, static_cast<int64_t>(1));
+    int64_t num_chunks = MIN(DIVUP(end - begin, grain_size),
+                             static_cast<int64_t>(_workers.size() + 1));
+    if (num_chunks <= 1) {
+      f(begin, end);
+      return;
+    }
+    int64_t chunk_size = DIVUP(end - begin, num_chunks);
+    auto state = std::make_shared<ParallelForState>(begin, end, chunk_size,
+                                                    num_chunks, f);
+    for (int64_t i = 1; i < num_chunks; i++)
+      Submit([state]() { state->Run(); });
+    state->Run();
+    while (state->num_done.load(std::memory_order_acquire) < num_chunks)
+      std::this_thread::yield();
+    if (state->error)
+      std::rethrow_exception(state->error);
+  }
+
+  void Shutdown() {
+    std::lock_guard<std::mutex> lock(_idle_mutex);
+    _shutdowned = true;
+    _wakeup_signal.notify_all();
+  }
+
+  const std::string& name() const {
+    return _pool_name;
+  }
+
+  int num_workers() const {
+    return _workers.size();
+  }
+
+  uint64_t num_submitted_tasks() const {
+    return _num_submitted.load(std::memory_order_relaxed);
+  }
+
+  uint64_t num_executed_tasks() const {
+    return _num_executed.load(std::memory_order_relaxed);
+  }
+
+  uint64_t num_steals() const {
+    return _num_steals.load(std::memory_order_relaxed);
+  }
+
+  uint64_t num_pending_tasks() const {
+    return _num_pending.load(std::memory_order_relaxed);
+  }
+
+  bool running() const {
+    return !_shutdowned;
+  }
+
+  // Whether the calling thread is a worker of this pool
+  bool in_worker() const {
+    return _current_pool() == this;
+  }
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  struct ParallelForState {
+    const int64_t begin;
+    const int64_t end;
+    const int64_t chunk_size;
+    const int64_t num_chunks;
+    const std::function<void(int64_t, int64_t)> fn;
+    std::atomic<int64_t> next_chunk{0};
+    std::atomic<int64_t> num_done{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    ParallelForState(int64_t begin_, int64_t end_, int64_t chunk_size_,
+                     int64_t num_chunks_,
+                     const std::function<void(int64_t, int64_t)>& fn_)
+    : begin(begin_),
+      end(end_),
+      chunk_size(chunk_size_),
+      num_chunks(num_chunks_),
+      fn(fn_) {}
+
+    void Run() {
+      while (true) {
+        int64_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= num_chunks)
+          break;
+        int64_t chunk_begin = begin + chunk * chunk_size;
+        int64_t chunk_end = MIN(chunk_begin + chunk_size, end);
+        try {
+          if (chunk_begin < chunk_end)
+            fn(chunk_begin, chunk_end);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error)
+            error = std::current_exception();
+        }
+        num_done.fetch_add(1, std::memory_order_release);
+      }
+    }
+  };
+
+  static WorkStealingThreadPool*& _current_pool() {
+    static thread_local WorkStealingThreadPool* pool = nullptr;
+    return pool;
+  }
+
+  static size_t& _current_worker_id() {
+    static thread_local size_t worker_id = 0;
+    return worker_id;
+  }
+
+  bool _PopLocal(size_t worker_id, Task& task) {
+    auto& queue = *_queues[worker_id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+  }
+
+  bool _Steal(size_t worker_id, Task& task) {
+    for (size_t i = 1; i < _queues.size(); i++) {
+      auto& queue = *_queues[(worker_id + i) % _queues.size()];
+      std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+      if (!lock.owns_lock() || queue.tasks.empty())
+        continue;
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      _num_steals.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  static void _RunWorker(WorkStealingThreadPool* const pool, size_t worker_id) {
+    _current_pool() = pool;
+    _current_worker_id() = worker_id;
+    uint64_t num_processed = 0;
+    const std::string worker_name = "ThreadPool[" + pool->name() +
+      "] Worker[" + std::to_string(worker_id) + "]";
+    Task task;
+    while (true) {
+      if (pool->_PopLocal(worker_id, task) || pool->_Steal(worker_id, task)) {
+        pool->_num_pending.fetch_sub(1);
+        try {
+          task();
+        } catch (const std::exception& e) {
+          HT_LOG_ERROR << worker_name << " Task failed: " << e.what();
+        } catch (...) {
+          HT_LOG_ERROR << worker_name
+                       << " Task failed with an unknown exception.";
+        }
+        task = nullptr;
+        pool->_num_executed.fetch_add(1, std::memory_order_relaxed);
+        num_processed++;
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(pool->_idle_mutex);
+      if (pool->_num_pending.load() > 0)
+        continue;
+      if (pool->_shutdowned)
+        break;
+      pool->_num_idle.fetch_add(1);
+      // `Submit` increments `_num_pending` before checking `_num_idle`,
+      // so a task published after the check above still wakes us up.
+      pool->_wakeup_signal.wait(lock, [pool] {
+        return pool->_shutdowned || pool->_num_pending.load() > 0;
+      });
+      pool->_num_idle.fetch_sub(1);
+    }
+    _current_pool() = nullptr;
+    if (num_processed > 0)
+      HT_LOG_DEBUG << worker_name << " Summary: " << num_processed
+                   << " processed task(s).";
+  }
+
+  const std::string _pool_name;
+  std::vector<std::unique_ptr<WorkerQueue>> _queues;
+  std::vector<std::thread> _workers;
+  std::atomic<size_t> _next_queue{0};
+  std::atomic<uint64_t> _num_submitted{0};
+  std::atomic<uint64_t> _num_executed{0};
+  std::atomic<uint64_t> _num_steals{0};
+  std::atomic<uint64_t> _num_pending{0};
+  std::atomic<int> _num_idle{0};
+
+  std::mutex _idle_mutex;
+  std::condition_variable _wakeup_signal;
+  std::atomic<bool> _shutdowned{false};
+};
+
+// Runs tasks one at a time and in FIFO order on a shared thread pool.
+// At most one task of an executor is in flight, so it can replace a
+// single-worker TaskQueue without changing the ordering semantics.
+class SerialExecutor final {
+  using TaskFn = InlineFunction<64>;
+  using Task = std::tuple<TaskFn, uint64_t, std::string>;
+
+ public:
+  SerialExecutor(const std::string& name, WorkStealingThreadPool& pool,
+                 uint64_t max_pending_tasks = 10240UL,
+                 size_t max_tasks_per_run = 64)
+  : _name(name),
+    _pool(pool),
+    _max_pending_tasks(max_pending_tasks),
+    _max_tasks_per_run(max_tasks_per_run) {
+    HT_ASSERT(max_pending_tasks > 0) << "Max pending tasks must be positive.";
+    HT_ASSERT(max_tasks_per_run > 0) << "Max tasks per run must be positive.";
+  }
+
+  ~SerialExecutor() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle_signal.wait(lock, [this] { return !_scheduled; });
+  }
+
+  std::future<void> Enqueue(std::function<void()> f,
+                            const std::string& name = "") {
+    std::packaged_task<void()> task_f(std::move(f));
+    auto future = task_f.get_future();
+    _Push(TaskFn(std::move(task_f)), name);
+    return future;
+  }
+
+  // Enqueue a task without creating a future for it
+  template <typename F>
+  void Post(F&& f, const std::string& name = "") {
+    _Push(TaskFn(std::forward<F>(f)), name);
+  }
+
+  const std::string& name() const {
+    return _name;
+  }
+
+  uint64_t num_enqueued_tasks() const {
+    return _num_enqueued_tasks;
+  }
+
+  bool running() const {
+    return _pool.running();
+  }
+
+ private:
+  void _Push(TaskFn fn, const std::string& name) {
+    bool schedule = false;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (_tasks.size() >= _max_pending_tasks)
+        _dequeue_signal.wait(lock);
+      auto task_id = _num_enqueued_tasks++;
+      _tasks.emplace_back(std::move(fn), task_id, name);
+      if (!_scheduled) {
+        _scheduled = true;
+        schedule = true;
+      }
+    }
+    if (schedule)
+      _pool.Submit([this]() { _Run(); });
+  }
+
+  // Process a batch of tasks and yield the worker to other executors
+  // before continuing.
+  void _Run() {
+    for (size_t i = 0; i < _max_tasks_per_run; i++) {
+      Task task;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_tasks.empty()) {
+          _scheduled = false;
+          _idle_signal.notify_all();
+          return;
+        }
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+        _dequeue_signal.notify_one();
+      }
+      HT_LOG_TRACE << "SerialExecutor[" << _name << "] Processing task "
+                   << std::get<1>(task) << " \"" << std::get<2>(task)
+                   << "\"...";
+      // As in TaskQueue, exceptions of posted tasks are logged so that they
+      // neither kill the worker nor leave the executor scheduled forever.
+      try {
+        std::get<0>(task)();
+      } catch (const std::exception& e) {
+        HT_LOG_ERROR << "SerialExecutor[" << _name << "] Task "
+                     << std::get<1>(task) << " \"" << std::get<2>(task)
+                     << "\" failed: " << e.what();
+      } catch (...) {
+        HT_LOG_ERROR << "SerialExecutor[" << _name << "] Task "
+                     << std::get<1>(task) << " \"" << std::get<2>(task)
+                     << "\" failed with an unknown exception.";
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_tasks.empty()) {
+        _scheduled = false;
+        _idle_signal.notify_all();
+        return;
+      }
+    }
+    _pool.Submit([this]() { _Run(); });
+  }
+
+  const std::string _name;
+  WorkStealingThreadPool& _pool;
+  const uint64_t _max_pending_tasks;
+  const size_t _max_tasks_per_run;
+  std::atomic<uint64_t> _num_enqueued_tasks{0};
+  std::deque<Task> _tasks;
+  bool _scheduled{false};
+
+  std::mutex _mutex;
+  std::condition_variable _dequeue_signal;
+  std::condition_variable _idle_signal;
+};
+
+} // namespace hetu
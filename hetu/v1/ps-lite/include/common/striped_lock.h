@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <thread>
+
+#ifndef LEVEL1_DCACHE_LINESIZE
+#define LEVEL1_DCACHE_LINESIZE 64
+#endif
+
+namespace ps {
+/*
+  striped_lock
+  N spin locks on separate cache lines, row i is guarded by lock i % N.
+  Critical sections are expected to be short (one row update), so waiters
+  spin and yield instead of sleeping.
+*/
+template <size_t N>
+class striped_lock {
+    static_assert((N & (N - 1)) == 0, "N must be a power of 2");
+
+    struct stripe {
+        std::atomic<bool> locked;
+
+        stripe() : locked(false) {
+        }
+    } __attribute__((aligned(LEVEL1_DCACHE_LINESIZE)));
+    std::array<stripe, N> stripes_;
+
+public:
+    striped_lock() {
+    }
+
+    void lock(size_t i) {
+        auto &s = stripes_[i & (N - 1)];
+        while (true) {
+            if (!s.locked.exchange(true, std::memory_order_acquire))
+                return;
+            while (s.locked.load(std::memory_order_relaxed))
+                std::this_thread::yield();
+        }
+    }
+
+    void unlock(size_t i) {
+        stripes_[i & (N - 1)].locked.store(false, std::memory_order_release);
+    }
+};
+
+// utility class for RAII lock of one stripe
+template <size_t N>
+class stripe_guard {
+    striped_lock<N> &sl_;
+    size_t i_;
+    bool owns_;
+
+public:
+    stripe_guard(striped_lock<N> &sl, size_t i) : sl_(sl), i_(i), owns_(true) {
+        sl_.lock(i_);
+    }
+
+    stripe_guard(const stripe_guard &) = delete;
+
+    stripe_guard(stripe_guard &&other) :
+        sl_(other.sl_), i_(other.i_), owns_(other.owns_) {
+        other.owns_ = false;
+    }
+
+    ~stripe_guard() {
+        if (owns_)
+            sl_.unlock(i_);
+    }
+};
+} // namespace ps
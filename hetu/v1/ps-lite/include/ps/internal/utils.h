@@ -5,6 +5,7 @@
 #define PS_INTERNAL_UTILS_H_
 #include "common/logging.h"
 #include "ps/internal/env.h"
+#include <algorithm>
 namespace ps {
 
 #ifdef _MSC_VER
@@ -45,6 +46,24 @@ inline int GetEnv(const char *key, int default_val) {
     }
 }
 
+/*!
+ * \brief Number of OpenMP threads a server uses for one request, read from
+ *  PS_SERVER_THREADS.
+ */
+inline int GetServerThreads() {
+    static const int num_threads = std::max(GetEnv("PS_SERVER_THREADS", 4), 1);
+    return num_threads;
+}
+
+/*!
+ * \brief Number of OpenMP threads a worker uses to deduplicate and aggregate
+ *  one sparse request, read from PS_WORKER_THREADS.
+ */
+inline int GetWorkerThreads() {
+    static const int num_threads = std::max(GetEnv("PS_WORKER_THREADS", 4), 1);
+    return num_threads;
+}
+
 #ifndef DISALLOW_COPY_AND_ASSIGN
 #define DISALLOW_COPY_AND_ASSIGN(TypeName)                                     \
     TypeName(const TypeName &);                                                \
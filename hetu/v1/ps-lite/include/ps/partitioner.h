@@ -1,9 +1,73 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 namespace ps {
 
+/*
+  RowPermutation
+  A bijection of the rows [0, length) of a sparse table: id is stored at row
+  Map(id) of the concatenated partitions. Multiplying by a unit close to
+  length / golden ratio sends consecutive ids, which are the hottest ones of
+  frequency sorted vocabularies, far apart, so that every partition gets its
+  share of them. The default one is the identity.
+*/
+class RowPermutation {
+public:
+    RowPermutation() {
+    }
+    explicit RowPermutation(size_t length) {
+        CHECK_LE(length, 0xFFFFFFFFull) << "too many rows to permute";
+        if (length < 3)
+            return;
+        size_t mul = length * 0.6180339887498949;
+        while (gcd(mul, length) != 1)
+            ++mul;
+        _length = length;
+        _mul = mul;
+        _inv = inverse(mul, length);
+    }
+
+    bool identity() const {
+        return _length == 0;
+    }
+    size_t Map(size_t id) const {
+        return identity() ? id : id * _mul % _length;
+    }
+    size_t Unmap(size_t row) const {
+        return identity() ? row : row * _inv % _length;
+    }
+
+private:
+    static size_t gcd(size_t a, size_t b) {
+        while (b != 0) {
+            size_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    // inverse of a modulo m, by the extended Euclidean algorithm
+    static size_t inverse(size_t a, size_t m) {
+        int64_t t = 0, new_t = 1, r = m, new_r = a;
+        while (new_r != 0) {
+            int64_t q = r / new_r, tmp = t - q * new_t;
+            t = new_t;
+            new_t = tmp;
+            tmp = r - q * new_r;
+            r = new_r;
+            new_r = tmp;
+        }
+        return t < 0 ? t + m : t;
+    }
+
+    size_t _length = 0;
+    size_t _mul = 1;
+    size_t _inv = 1;
+};
+
 class Partitioner {
 protected:
     const std::vector<Range> &server_range;
@@ -25,6 +89,19 @@ public:
     virtual int queryServer(Key key) {
         return 0;
     }
+    /* where the rows of a sparse table are stored in its partitions */
+    virtual RowPermutation permuteSparse(size_t length) {
+        return RowPermutation();
+    }
+    /* the PS_PARTITIONER value, recorded in checkpoints */
+    virtual const char *name() const = 0;
+
+    size_t numServers() const {
+        return server_num;
+    }
+
+    /* PS_PARTITIONER=average|hash|block, average by default */
+    static Partitioner *Create();
 };
 
 /* Naive partitioner, average partition into servers */
@@ -61,6 +138,10 @@ public:
         partitionDense(length, keys, parts);
     }
 
+    const char *name() const {
+        return "average";
+    }
+
     int queryServer(Key key) {
         size_t server_id = 0;
         while (server_id < server_num
@@ -71,6 +152,22 @@ public:
     }
 };
 
+/*
+  Average partitioner whose sparse tables are permuted, so that the hot rows
+  of power-law distributed ids are spread over the servers instead of all
+  landing in the first partition. Dense tensors are not affected.
+*/
+class HashPartitioner : public AveragePartitioner {
+public:
+    RowPermutation permuteSparse(size_t length) {
+        return RowPermutation(length);
+    }
+
+    const char *name() const {
+        return "hash";
+    }
+};
+
 /* Use blocks to partition, intuition from BytePS */
 class BlockPartitioner : public Partitioner {
 private:
@@ -112,6 +209,10 @@ public:
         }
     }
 
+    const char *name() const {
+        return "block";
+    }
+
     int queryServer(Key key) {
         size_t server_id = 0;
         while (server_id < server_num
@@ -122,4 +223,14 @@ public:
     }
 };
 
+inline Partitioner *Partitioner::Create() {
+    std::string type = GetEnv("PS_PARTITIONER", std::string("average"));
+    if (type == "hash")
+        return new HashPartitioner();
+    if (type == "block")
+        return new BlockPartitioner();
+    CHECK(type == "average") << "unknown PS_PARTITIONER " << type;
+    return new AveragePartitioner();
+}
+
 } // namespace ps
@@ -49,6 +49,12 @@ enum PsfType {
     kSyncEmbedding,
     kPushEmbedding,
     kPushSyncEmbedding,
+    /* hot row replicas */
+    kHotPush,
+    kHotPull,
+    kHotPushPull,
+    kHotDrain,
+    kHotInstall,
     /* SSP support */
     kSSPInit,
     kSSPSync,
@@ -98,5 +104,6 @@ namespace std {
 #include "sparse.h"
 #include "misc.h"
 #include "cachetable.h"
+#include "hot.h"
 #include "ssp.h"
 #include "preduce.h"
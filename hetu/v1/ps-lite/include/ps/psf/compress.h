@@ -0,0 +1,291 @@
+#pragma once
+
+#include "common/sarray.h"
+#include "ps/internal/utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ps {
+
+/*
+  Wire compression of pushed values.
+  Every push request carries the CompressType of its data, so the server
+  decodes each request on its own and workers may choose per tensor:
+  - kFloat16 / kBFloat16: down-cast to 16 bits, round to nearest even
+  - kInt8: int8 with one float scale per row (per kInt8DenseBlock values for
+    dense tensors), round to nearest
+  - kTopK: only the largest `ratio` of the values by magnitude, as (index,
+    value) pairs. The worker keeps the values it did not send in a residual
+    that is added to the next push of the same tensor (error feedback).
+*/
+enum CompressType {
+    kNoCompress,
+    kFloat16,
+    kBFloat16,
+    kInt8,
+    kTopK,
+};
+
+struct PushCompress {
+    CompressType type = kNoCompress;
+    float ratio = 0.01; // kept fraction for kTopK
+
+    // PS_PUSH_COMPRESS=none|fp16|bf16|int8|topk, PS_PUSH_TOPK_RATIO
+    static PushCompress FromEnv() {
+        static const PushCompress compress = [] {
+            PushCompress c;
+            std::string type = GetEnv("PS_PUSH_COMPRESS", std::string("none"));
+            if (type == "fp16")
+                c.type = kFloat16;
+            else if (type == "bf16")
+                c.type = kBFloat16;
+            else if (type == "int8")
+                c.type = kInt8;
+            else if (type == "topk")
+                c.type = kTopK;
+            else
+                CHECK(type == "none") << "unknown PS_PUSH_COMPRESS " << type;
+            c.ratio = atof(GetEnv("PS_PUSH_TOPK_RATIO", std::string("0.01"))
+                               .c_str());
+            CHECK(c.ratio > 0 && c.ratio <= 1)
+                << "PS_PUSH_TOPK_RATIO must be in (0, 1]";
+            return c;
+        }();
+        return compress;
+    }
+};
+
+namespace compress {
+
+// values of a dense tensor sharing one int8 scale
+constexpr size_t kInt8DenseBlock = 256;
+// below this many values the threads cost more than they save
+constexpr size_t kParallelGrain = 65536;
+
+inline int NumThreads(size_t size, int max_threads) {
+    return (int)std::max<size_t>(
+        1, std::min<size_t>(max_threads, size / kParallelGrain));
+}
+
+inline uint32_t FloatBits(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    return x;
+}
+
+inline float BitsFloat(uint32_t x) {
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+inline uint16_t FloatToHalf(float f) {
+    uint32_t x = FloatBits(f);
+    uint16_t sign = (x >> 16) & 0x8000;
+    uint32_t abs = x & 0x7FFFFFFF;
+    if (abs >= 0x7F800000) // inf or nan
+        return sign | (abs > 0x7F800000 ? 0x7E00 : 0x7C00);
+    if (abs >= 0x477FF000) // rounds beyond the largest half
+        return sign | 0x7C00;
+    if (abs < 0x38800000) // subnormal half, in units of 2^-24
+        return sign | (uint16_t)std::nearbyint(BitsFloat(abs) * 16777216.0f);
+    // rebias the exponent and round the mantissa to nearest even
+    abs += 0xC8000FFF + ((abs >> 13) & 1);
+    return sign | (uint16_t)(abs >> 13);
+}
+
+inline float HalfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+    if (exp == 0)
+        return BitsFloat(sign | FloatBits(mant / 16777216.0f));
+    if (exp == 31)
+        return BitsFloat(sign | 0x7F800000 | (mant << 13));
+    return BitsFloat(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+inline uint16_t FloatToBFloat16(float f) {
+    uint32_t x = FloatBits(f);
+    if ((x & 0x7FFFFFFF) > 0x7F800000) // keep nan a nan
+        return (x >> 16) | 0x40;
+    return (x + 0x7FFF + ((x >> 16) & 1)) >> 16;
+}
+
+inline float BFloat16ToFloat(uint16_t b) {
+    return BitsFloat((uint32_t)b << 16);
+}
+
+} // namespace compress
+
+/*
+  Encodes `size` pushed values made of rows of `width` into `out`, and
+  returns the CompressType of `out`, which is kNoCompress when compression
+  would not pay off. Uncompressed values are not copied, so `vals` must
+  outlive the request as before.
+  With kTopK and a `residual` of `size`, the values are added to the residual
+  first, and the residual keeps what is not sent.
+*/
+inline CompressType EncodePush(const PushCompress &compress, const float *vals,
+                               size_t size, size_t width, float *residual,
+                               SArray<char> &out, int num_threads = 1) {
+    using namespace compress;
+    num_threads = NumThreads(size, num_threads);
+    CompressType type = size == 0 ? kNoCompress : compress.type;
+    switch (type) {
+    case kNoCompress:
+        out = SArray<char>(SArray<float>(const_cast<float *>(vals), size));
+        break;
+    case kFloat16:
+    case kBFloat16: {
+        SArray<uint16_t> half(size);
+        if (type == kFloat16) {
+#pragma omp parallel for num_threads(num_threads)
+            for (size_t i = 0; i < size; ++i)
+                half[i] = FloatToHalf(vals[i]);
+        } else {
+#pragma omp parallel for num_threads(num_threads)
+            for (size_t i = 0; i < size; ++i)
+                half[i] = FloatToBFloat16(vals[i]);
+        }
+        out = SArray<char>(half);
+        break;
+    }
+    case kInt8: {
+        // [uint32 block][float scale per block][int8 per value]
+        uint32_t block = width > 1 ? width : kInt8DenseBlock;
+        size_t num_blocks = (size + block - 1) / block;
+        size_t head = sizeof(uint32_t) + num_blocks * sizeof(float);
+        out = SArray<char>(head + size);
+        memcpy(out.data(), &block, sizeof(block));
+        float *scales = reinterpret_cast<float *>(out.data() + sizeof(block));
+        int8_t *q = reinterpret_cast<int8_t *>(out.data() + head);
+#pragma omp parallel for num_threads(num_threads)
+        for (size_t b = 0; b < num_blocks; ++b) {
+            size_t lo = b * block, hi = std::min(lo + block, size);
+            float absmax = 0;
+            for (size_t i = lo; i < hi; ++i)
+                absmax = std::max(absmax, std::abs(vals[i]));
+            scales[b] = absmax / 127;
+            float inv = absmax > 0 ? 127 / absmax : 0;
+            for (size_t i = lo; i < hi; ++i)
+                q[i] = (int8_t)std::lround(vals[i] * inv);
+        }
+        break;
+    }
+    case kTopK: {
+        // [uint32 index * k][float value * k]
+        size_t k = std::max<size_t>(1, std::ceil(compress.ratio * size));
+        const float *src = vals;
+        if (residual != nullptr) {
+#pragma omp parallel for num_threads(num_threads)
+            for (size_t i = 0; i < size; ++i)
+                residual[i] += vals[i];
+            src = residual;
+        }
+        if (k * 2 >= size) {
+            // the pairs are no smaller than the values
+            SArray<float> all;
+            all.CopyFrom(src, size);
+            if (residual != nullptr)
+                std::fill(residual, residual + size, 0.f);
+            out = SArray<char>(all);
+            type = kNoCompress;
+            break;
+        }
+        CHECK_LE(size, 0xFFFFFFFFull) << "too many values to push";
+        std::vector<uint32_t> order(size);
+        for (size_t i = 0; i < size; ++i)
+            order[i] = i;
+        std::nth_element(order.begin(), order.begin() + k, order.end(),
+                         [src](uint32_t a, uint32_t b) {
+                             return std::abs(src[a]) > std::abs(src[b]);
+                         });
+        std::sort(order.begin(), order.begin() + k);
+        out = SArray<char>(k * (sizeof(uint32_t) + sizeof(float)));
+        uint32_t *index = reinterpret_cast<uint32_t *>(out.data());
+        float *value = reinterpret_cast<float *>(index + k);
+        for (size_t i = 0; i < k; ++i) {
+            index[i] = order[i];
+            value[i] = src[order[i]];
+            if (residual != nullptr)
+                residual[order[i]] = 0;
+        }
+        break;
+    }
+    default:
+        LOG(FATAL) << "unknown compress type " << type;
+    }
+    return type;
+}
+
+/*
+  Decodes the `size` values of a push encoded by EncodePush. Uncompressed
+  data is not copied.
+*/
+inline SArray<float> DecodePush(int type, const SArray<char> &data,
+                                size_t size, int num_threads = 1) {
+    using namespace compress;
+    num_threads = NumThreads(size, num_threads);
+    SArray<float> vals;
+    switch (type) {
+    case kNoCompress:
+        vals = SArray<float>(data);
+        CHECK_EQ(vals.size(), size) << "size mismatch of pushed values";
+        break;
+    case kFloat16:
+    case kBFloat16: {
+        SArray<uint16_t> half(data);
+        CHECK_EQ(half.size(), size) << "size mismatch of pushed values";
+        vals.resize(size);
+        if (type == kFloat16) {
+#pragma omp parallel for num_threads(num_threads)
+            for (size_t i = 0; i < size; ++i)
+                vals[i] = HalfToFloat(half[i]);
+        } else {
+#pragma omp parallel for num_threads(num_threads)
+            for (size_t i = 0; i < size; ++i)
+                vals[i] = BFloat16ToFloat(half[i]);
+        }
+        break;
+    }
+    case kInt8: {
+        CHECK_GE(data.size(), sizeof(uint32_t)) << "truncated int8 push";
+        uint32_t block;
+        memcpy(&block, data.data(), sizeof(block));
+        CHECK_GT(block, 0) << "invalid int8 block";
+        size_t num_blocks = (size + block - 1) / block;
+        size_t head = sizeof(uint32_t) + num_blocks * sizeof(float);
+        CHECK_EQ(data.size(), head + size) << "size mismatch of pushed values";
+        const float *scales =
+            reinterpret_cast<const float *>(data.data() + sizeof(block));
+        const int8_t *q = reinterpret_cast<const int8_t *>(data.data() + head);
+        vals.resize(size);
+#pragma omp parallel for num_threads(num_threads)
+        for (size_t i = 0; i < size; ++i)
+            vals[i] = q[i] * scales[i / block];
+        break;
+    }
+    case kTopK: {
+        size_t pair = sizeof(uint32_t) + sizeof(float);
+        CHECK_EQ(data.size() % pair, 0) << "truncated top-k push";
+        size_t k = data.size() / pair;
+        const uint32_t *index = reinterpret_cast<const uint32_t *>(data.data());
+        const float *value = reinterpret_cast<const float *>(index + k);
+        vals.resize(size, 0);
+        for (size_t i = 0; i < k; ++i) {
+            CHECK_LT(index[i], size) << "top-k index out of range";
+            vals[index[i]] = value[i];
+        }
+        break;
+    }
+    default:
+        LOG(FATAL) << "unknown compress type " << type;
+    }
+    return vals;
+}
+
+} // namespace ps
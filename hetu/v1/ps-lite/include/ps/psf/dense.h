@@ -1,6 +1,7 @@
 #pragma once
 
 #include "PSFunc.h"
+#include "compress.h"
 
 namespace ps {
 
@@ -26,7 +27,8 @@ struct PSFData<DensePush> {
     static constexpr const char* name = "DensePush";
     using Request = tuple<Key,          // key
                           size_t,       // len
-                          SArray<float> // data
+                          SArray<char>, // data, encoded by EncodePush
+                          int           // compress type of data
                           >;
     using Response = tuple<>;
     static void _callback(const Response &response) {
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "PSFunc.h"
+#include "sparse.h"
+
+namespace ps {
+
+/*
+  Hot row replicas of sparse tables, see HotRowState.
+  Rows are addressed by their row in the whole (permuted) table, the key is
+  any key of the table held by the server of the replica. Requests carry the
+  width of the table, which the server checks against the replica.
+*/
+template <>
+struct PSFData<kHotPush> {
+    static constexpr PsfGroup group = PsfGroup::kParameterServer;
+    static constexpr const char* name = "HotPush";
+    using Request = tuple<Key,            // key
+                          SArray<size_t>, // rows
+                          SArray<char>,   // data, encoded by EncodePush
+                          int,            // compress type of data
+                          size_t          // width
+                          >;
+    using Response = PSFData<SparsePush>::Response;
+    static void _callback(const Response &response) {
+    }
+};
+
+template <>
+struct PSFData<kHotPull> {
+    static constexpr PsfGroup group = PsfGroup::kParameterServer;
+    static constexpr const char* name = "HotPull";
+    using Request = tuple<Key,            // key
+                          SArray<size_t>, // rows
+                          size_t          // width
+                          >;
+    using Response = PSFData<SparsePull>::Response;
+    static void _callback(const Response &response, SArray<float> tgt,
+                          std::shared_ptr<const SparseIndex> index,
+                          size_t begin, size_t end, size_t width) {
+        PSFData<SparsePull>::_callback(response, tgt, index, begin, end,
+                                       width);
+    }
+};
+
+template <>
+struct PSFData<kHotPushPull> {
+    static constexpr PsfGroup group = PsfGroup::kParameterServer;
+    static constexpr const char* name = "HotPushPull";
+    using Request = tuple<Key,            // key
+                          SArray<size_t>, // push rows
+                          SArray<char>,   // data, encoded by EncodePush
+                          int,            // compress type of data
+                          SArray<size_t>, // pull rows
+                          size_t          // width
+                          >;
+    using Response = PSFData<SSPushPull>::Response;
+    static void _callback(const Response &response, SArray<float> tgt,
+                          std::shared_ptr<const SparseIndex> index,
+                          size_t begin, size_t end, size_t width) {
+        PSFData<SSPushPull>::_callback(response, tgt, index, begin, end,
+                                       width);
+    }
+};
+
+// takes the deltas pushed to the replicas of a server since the last drain
+template <>
+struct PSFData<kHotDrain> {
+    static constexpr PsfGroup group = PsfGroup::kParameterServer;
+    static constexpr const char* name = "HotDrain";
+    using Request = tuple<Key // key
+                          >;
+    using Response = tuple<SArray<size_t>, // rows
+                           SArray<float>   // deltas
+                           >;
+};
+
+// sets the values of the replicas to those of the owners, deltas pushed
+// since the last drain are kept
+template <>
+struct PSFData<kHotInstall> {
+    static constexpr PsfGroup group = PsfGroup::kParameterServer;
+    static constexpr const char* name = "HotInstall";
+    using Request = tuple<Key,            // key
+                          SArray<size_t>, // rows
+                          SArray<float>   // values
+                          >;
+    using Response = tuple<>;
+    static void _callback(const Response &response) {
+    }
+};
+
+} // namespace ps
@@ -48,7 +48,8 @@ struct PSFData<ParamSave> {
     static constexpr const char* name = "ParamSave";
     using Request = tuple<Key,
                           SArray<char>, // address
-                          bool          // different from load
+                          bool,         // different from load
+                          SArray<char>  // partitioner
                           >;
     using Response = tuple<>;
     static void _callback(const Response &response) {
@@ -60,7 +61,8 @@ struct PSFData<ParamLoad> {
     static constexpr PsfGroup group = PsfGroup::kParameterServer;
     static constexpr const char* name = "ParamLoad";
     using Request = tuple<Key,
-                          SArray<char> // address
+                          SArray<char>, // address
+                          SArray<char>  // partitioner
                           >;
     using Response = tuple<>;
     static void _callback(const Response &response) {
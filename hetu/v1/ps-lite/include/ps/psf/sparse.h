@@ -2,6 +2,9 @@
 
 #include "PSFunc.h"
 #include "dense.h"
+#include "ps/worker/sparse_index.h"
+
+#include <memory>
 
 namespace ps {
 
@@ -14,20 +17,15 @@ struct PSFData<SparsePull> {
                           >;
     using Response = tuple<SArray<float> // data
                            >;
-    static void
-    _callback(const Response &response, SArray<float> tgt,
-              std::vector<std::pair<size_t, std::vector<size_t>>> mapping,
-              size_t offset, size_t width) {
+    // copies the rows of ids [begin, end) of the index to all their
+    // positions in tgt
+    static void _callback(const Response &response, SArray<float> tgt,
+                          std::shared_ptr<const SparseIndex> index,
+                          size_t begin, size_t end, size_t width) {
         auto val = get<0>(response);
-        CHECK_EQ(val.size(), mapping.size() * width)
-            << val.size() << " " << mapping.size() << " " << width;
-        for (size_t i = 0; i < mapping.size(); ++i) {
-            auto begin_iter = val.begin() + i * width;
-            auto end_iter = begin_iter + width;
-            for (auto idx : mapping[i].second) {
-                std::copy(begin_iter, end_iter, tgt.begin() + idx * width);
-            }
-        }
+        CHECK_EQ(val.size(), (end - begin) * width)
+            << val.size() << " " << end - begin << " " << width;
+        index->Scatter(val.data(), begin, end, width, tgt.data());
     }
 };
 
@@ -37,7 +35,8 @@ struct PSFData<SparsePush> {
     static constexpr const char* name = "SparsePush";
     using Request = tuple<Key,            // key
                           SArray<size_t>, // offset
-                          SArray<float>   // data
+                          SArray<char>,   // data, encoded by EncodePush
+                          int             // compress type of data
                           >;
     using Response = tuple<>;
     static void _callback(const Response &response) {
@@ -50,7 +49,8 @@ struct PSFData<SDPushPull> {
     static constexpr const char* name = "SDPushPull";
     using Request = tuple<Key,            // key
                           SArray<size_t>, // offset
-                          SArray<float>,  // data
+                          SArray<char>,   // data, encoded by EncodePush
+                          int,            // compress type of data
                           size_t          // len for densepull
                           >;
     using Response = PSFData<DensePull>::Response;
@@ -68,26 +68,20 @@ struct PSFData<SSPushPull> {
     static constexpr const char* name = "SSPushPull";
     using Request = tuple<Key,            // key
                           SArray<size_t>, // push offset
-                          SArray<float>,  // data
+                          SArray<char>,   // data, encoded by EncodePush
+                          int,            // compress type of data
                           SArray<size_t>  // pull offset
                           >;
     using Response = PSFData<SparsePull>::Response;
 
-    static void
-    _callback(const Response &response, SArray<float> tgt,
-              std::vector<std::pair<size_t, std::vector<size_t>>> mapping,
-              size_t offset, size_t width) {
+    static void _callback(const Response &response, SArray<float> tgt,
+                          std::shared_ptr<const SparseIndex> index,
+                          size_t begin, size_t end, size_t width) {
         auto val = get<0>(response);
         if (val.size() > 0) {
-            CHECK_EQ(val.size(), mapping.size() * width)
-                << val.size() << " " << mapping.size() << " " << width;
-            for (size_t i = 0; i < mapping.size(); ++i) {
-                auto begin_iter = val.begin() + i * width;
-                auto end_iter = begin_iter + width;
-                for (auto idx : mapping[i].second) {
-                    std::copy(begin_iter, end_iter, tgt.begin() + idx * width);
-                }
-            }
+            CHECK_EQ(val.size(), (end - begin) * width)
+                << val.size() << " " << end - begin << " " << width;
+            index->Scatter(val.data(), begin, end, width, tgt.data());
         }
     }
 };
@@ -4,6 +4,7 @@
 
 #include "common/thread_safe_hash_map.h"
 #include "param.h"
+#include "hot_replica.h"
 #include <algorithm>
 #include <utility>
 #include <mutex>
@@ -47,7 +48,9 @@ public:
                PSFData<DensePush>::Response &response) {
         Key k = get<0>(request);
         size_t len = get<1>(request);
-        SArray<float> vals = get<2>(request);
+        SArray<float> vals =
+            DecodePush(get<3>(request), get<2>(request), len,
+                       GetServerThreads());
 
         if (const_store.find(k) == const_store.end()) {
             store[k] = std::make_shared<Param<float>>(len, OptType::None,
@@ -62,7 +65,7 @@ public:
             auto &value_set_ =
                 *const_cast<typename tmap::mapped_type &>(iter->second);
             auto write_lock = value_set_.write_guard();
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
             for (size_t j = 0; j < value_set_.size(); j++)
                 value_set_[j] += vals[j];
         } else {
@@ -76,7 +79,9 @@ public:
         // with response result
         Key k = get<0>(request);
         size_t len = get<1>(request);
-        SArray<float> vals = get<2>(request);
+        SArray<float> vals =
+            DecodePush(get<3>(request), get<2>(request), len,
+                       GetServerThreads());
         SArray<float> &pull_vals = get<0>(response);
 
         auto iter = const_store.find(k);
@@ -88,7 +93,7 @@ public:
                 << " size mismatch in DDPushPull " << len << " " << data_size;
             pull_vals.resize(data_size);
             auto write_lock = value_set_.write_guard();
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
             for (size_t j = 0; j < data_size; j++) {
                 value_set_[j] += vals[j];
                 pull_vals[j] = value_set_[j];
@@ -113,8 +118,9 @@ public:
             size_t width = value_set_.width;
             pull_vals.resize(offset.size() * width);
             auto read_lock = value_set_.read_guard();
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
             for (size_t j = 0; j < offset.size(); ++j) {
+                auto row_lock = value_set_.row_guard(offset[j]);
                 auto value_begin = value_set_.data() + offset[j] * width;
                 auto value_end = value_begin + width;
                 auto dst_begin = pull_vals.data() + j * width;
@@ -133,23 +139,26 @@ public:
         // no response result
         Key k = get<0>(request);
         SArray<size_t> offsets = get<1>(request);
-        SArray<float> vals = get<2>(request);
 
         auto iter = const_store.find(k);
         if (iter != const_store.end()) {
             auto &value_set_ =
                 *std::dynamic_pointer_cast<Param2D<float>>(iter->second);
             size_t width = value_set_.width;
+            SArray<float> vals =
+                DecodePush(get<3>(request), get<2>(request),
+                           offsets.size() * width, GetServerThreads());
 
             CHECK_EQ(vals.size(), offsets.size() * width)
                 << " in Psf::SparsePush check failed,"
                 << " size of vals is " << vals.size() << " size of lens is "
                 << offsets.size() << " size of width is " << width;
 
-            // write, discard const qualifier
-            auto write_lock = value_set_.write_guard();
-#pragma omp parallel for num_threads(4)
+            // rows are locked one by one, the table is only locked shared
+            auto read_lock = value_set_.read_guard();
+#pragma omp parallel for num_threads(GetServerThreads())
             for (size_t j = 0; j < offsets.size(); ++j) {
+                auto row_lock = value_set_.row_guard(offsets[j]);
                 size_t src_offset = j * width;
                 size_t dst_offset = offsets[j] * width;
                 for (size_t k = 0; k < width; ++k) {
@@ -167,8 +176,7 @@ public:
                PSFData<SDPushPull>::Response &response) {
         Key k = get<0>(request);
         SArray<size_t> offsets = get<1>(request);
-        SArray<float> vals = get<2>(request);
-        size_t len = get<3>(request);
+        size_t len = get<4>(request);
         SArray<float> &pull_vals = get<0>(response);
 
         auto iter = const_store.find(k);
@@ -176,10 +184,15 @@ public:
             auto &value_set_ =
                 *std::dynamic_pointer_cast<Param2D<float>>(iter->second);
             size_t width = value_set_.width;
+            SArray<float> vals =
+                DecodePush(get<3>(request), get<2>(request),
+                           offsets.size() * width, GetServerThreads());
             CHECK_EQ(len, value_set_.size())
                 << " size mismatch in SDPushPull " << k << " " << len << " "
                 << value_set_.size();
 
+            // the dense pull reads every row, so lock the whole table
+            auto write_lock = value_set_.write_guard();
             // sparsepush phase
             if (vals.size() > 0) {
                 CHECK_EQ(vals.size(), offsets.size() * width)
@@ -187,9 +200,7 @@ public:
                     << " size of vals is " << vals.size() << " size of lens is "
                     << offsets.size() << " size of width is " << width;
 
-                // write, discard const qualifier
-                auto write_lock = value_set_.write_guard();
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
                 for (size_t j = 0; j < offsets.size(); ++j) {
                     size_t src_offset = j * width;
                     size_t dst_offset = offsets[j] * width;
@@ -200,7 +211,6 @@ public:
             }
             // densepull phase
             pull_vals.resize(value_set_.size());
-            auto read_lock = value_set_.read_guard();
             std::copy(value_set_.begin(), value_set_.end(), pull_vals.begin());
         } else {
             // error, the key does not exist on PS.
@@ -213,8 +223,7 @@ public:
                PSFData<SSPushPull>::Response &response) {
         Key k = get<0>(request);
         SArray<size_t> push_offsets = get<1>(request);
-        SArray<float> vals = get<2>(request);
-        SArray<size_t> pull_offsets = get<3>(request);
+        SArray<size_t> pull_offsets = get<4>(request);
         SArray<float> &pull_vals = get<0>(response);
 
         auto iter = const_store.find(k);
@@ -222,6 +231,9 @@ public:
             auto &value_set_ =
                 *std::dynamic_pointer_cast<Param2D<float>>(iter->second);
             size_t width = value_set_.width;
+            SArray<float> vals =
+                DecodePush(get<3>(request), get<2>(request),
+                           push_offsets.size() * width, GetServerThreads());
 
             // sparsepush phase
             if (vals.size() > 0) {
@@ -230,10 +242,11 @@ public:
                     << " size of vals is " << vals.size() << " size of lens is "
                     << push_offsets.size() << " size of width is " << width;
 
-                // write, discard const qualifier
-                auto write_lock = value_set_.write_guard();
-#pragma omp parallel for num_threads(4)
+                // rows are locked one by one, the table is only locked shared
+                auto read_lock = value_set_.read_guard();
+#pragma omp parallel for num_threads(GetServerThreads())
                 for (size_t j = 0; j < push_offsets.size(); ++j) {
+                    auto row_lock = value_set_.row_guard(push_offsets[j]);
                     size_t src_offset = j * width;
                     size_t dst_offset = push_offsets[j] * width;
                     for (size_t k = 0; k < width; ++k) {
@@ -246,8 +259,9 @@ public:
             if (pull_offsets.size() > 0) {
                 pull_vals.resize(pull_offsets.size() * width);
                 auto read_lock = value_set_.read_guard();
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
                 for (size_t j = 0; j < pull_offsets.size(); ++j) {
+                    auto row_lock = value_set_.row_guard(pull_offsets[j]);
                     auto val_begin =
                         value_set_.begin() + pull_offsets[j] * width;
                     auto val_end = val_begin + width;
@@ -269,6 +283,17 @@ public:
     void serve(const PSFData<kPushSyncEmbedding>::Request &request,
                PSFData<kPushSyncEmbedding>::Response &response);
 
+    void serve(const PSFData<kHotPush>::Request &request,
+               PSFData<kHotPush>::Response &response);
+    void serve(const PSFData<kHotPull>::Request &request,
+               PSFData<kHotPull>::Response &response);
+    void serve(const PSFData<kHotPushPull>::Request &request,
+               PSFData<kHotPushPull>::Response &response);
+    void serve(const PSFData<kHotDrain>::Request &request,
+               PSFData<kHotDrain>::Response &response);
+    void serve(const PSFData<kHotInstall>::Request &request,
+               PSFData<kHotInstall>::Response &response);
+
     void serve(const PSFData<ParamInit>::Request &request,
                PSFData<ParamInit>::Response &response) {
         // one key per request.
@@ -313,7 +338,7 @@ public:
             n_threads = 16;
         if (init_type == InitType::Constant) {
             float filled_value = static_cast<float>(init_a);
-            // #pragma omp parallel for num_threads(4)
+            // #pragma omp parallel for num_threads(GetServerThreads())
             for (size_t j = 0; j < value_set_.size(); j++)
                 value_set_[j] = filled_value;
         } else if (init_type == InitType::Uniform) {
@@ -376,6 +401,10 @@ public:
     void serve(const PSFData<ParamClear>::Request &request,
                PSFData<ParamClear>::Response &response) {
         Key k = get<0>(request);
+        {
+            std::lock_guard<std::mutex> lock(hot_mtx);
+            hot_store.erase(k);
+        }
         auto iter = store.find(k);
         if (iter != store.end()) {
             store.erase(iter);
@@ -393,12 +422,16 @@ public:
         auto iter = store.find(k);
         if (iter != store.end()) {
             auto &value_set_ = *iter->second;
-            auto read_lock = value_set_.read_guard();
-            std::ofstream fout(
-                std::string(address.data(), address.size()).c_str(),
-                std::ios::binary);
+            // sparse pushes only hold the table lock shared
+            auto write_lock = value_set_.write_guard();
+            std::string path(address.data(), address.size());
+            std::ofstream fout(path.c_str(), std::ios::binary);
             fout.write((char *)value_set_.data(),
                        value_set_.size() * sizeof(float));
+            // the row order of sparse partitions depends on the partitioner
+            SArray<char> partitioner = get<3>(request);
+            std::ofstream(path + ".partitioner")
+                << std::string(partitioner.data(), partitioner.size());
         } else {
             // error, the key does not exist on PS.
             LF << "[Error] The pushed key: " << k
@@ -413,10 +446,17 @@ public:
         auto iter = store.find(k);
         if (iter != store.end()) {
             auto &value_set_ = *iter->second;
+            std::string path(address.data(), address.size());
+            SArray<char> partitioner = get<2>(request);
+            // checkpoints without a record were saved by the average one
+            std::string saved = "average";
+            std::ifstream(path + ".partitioner") >> saved;
+            CHECK_EQ(saved,
+                     std::string(partitioner.data(), partitioner.size()))
+                << "ParamLoad: " << path << " was saved with PS_PARTITIONER="
+                << saved << ", load it with the same partitioner";
             auto write_lock = value_set_.write_guard();
-            std::ifstream fin(
-                std::string(address.data(), address.size()).c_str(),
-                std::ios::binary);
+            std::ifstream fin(path.c_str(), std::ios::binary);
             fin.read((char *)value_set_.data(),
                      value_set_.size() * sizeof(float));
         } else {
@@ -442,6 +482,12 @@ private:
     tmap store;
     const tmap &const_store =
         store; // const reference to force compiler to use read lock
+
+    // the hot row replica of key, created with width if it does not exist
+    std::shared_ptr<HotReplica> hot_replica(Key k, size_t width = 0);
+    // hot row replicas, by a key of the table on this server
+    std::unordered_map<Key, std::shared_ptr<HotReplica>> hot_store;
+    std::mutex hot_mtx;
 };
 
 } // namespace ps
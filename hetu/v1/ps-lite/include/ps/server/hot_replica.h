@@ -0,0 +1,105 @@
+#pragma once
+
+#include "common/sarray.h"
+#include "ps/internal/utils.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ps {
+
+/*
+  HotReplica
+  The replicas of hot rows of a sparse table kept by one server. Each row
+  holds the value of its owner at the last install, and the deltas pushed to
+  this replica since the last drain; reads see their sum. Rows are only
+  installed by workers, and stay until the table is cleared, so that a worker
+  may keep using the rows it installed while others change their hot sets.
+*/
+class HotReplica {
+public:
+    explicit HotReplica(size_t width) : width(width) {
+    }
+
+    void Install(const SArray<size_t> &rows, const SArray<float> &vals) {
+        CHECK_EQ(vals.size(), rows.size() * width)
+            << "size mismatch in HotInstall";
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            auto it = slots.find(rows[i]);
+            if (it == slots.end()) {
+                it = slots.emplace(rows[i], row_of_slot.size()).first;
+                row_of_slot.push_back(rows[i]);
+                base.resize(row_of_slot.size() * width);
+                delta.resize(row_of_slot.size() * width, 0);
+            }
+            std::copy(vals.data() + i * width, vals.data() + (i + 1) * width,
+                      base.data() + it->second * width);
+        }
+    }
+
+    void Push(const SArray<size_t> &rows, const SArray<float> &vals) {
+        CHECK_EQ(vals.size(), rows.size() * width)
+            << "size mismatch in HotPush";
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            float *dst = delta.data() + slot(rows[i]) * width;
+            const float *src = vals.data() + i * width;
+            for (size_t k = 0; k < width; ++k)
+                dst[k] += src[k];
+        }
+    }
+
+    void Pull(const SArray<size_t> &rows, SArray<float> &vals) {
+        vals.resize(rows.size() * width);
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            size_t offset = slot(rows[i]) * width;
+            float *dst = vals.data() + i * width;
+            for (size_t k = 0; k < width; ++k)
+                dst[k] = base[offset + k] + delta[offset + k];
+        }
+    }
+
+    // takes the rows with nonzero deltas, the deltas are reset
+    void Drain(SArray<size_t> &rows, SArray<float> &deltas) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::vector<size_t> drained;
+        for (size_t s = 0; s < row_of_slot.size(); ++s) {
+            const float *d = delta.data() + s * width;
+            if (std::any_of(d, d + width, [](float v) { return v != 0; }))
+                drained.push_back(s);
+        }
+        rows.resize(drained.size());
+        deltas.resize(drained.size() * width);
+        for (size_t i = 0; i < drained.size(); ++i) {
+            size_t offset = drained[i] * width;
+            rows[i] = row_of_slot[drained[i]];
+            // the owner applies the deltas, so move them into the base
+            for (size_t k = 0; k < width; ++k) {
+                deltas[i * width + k] = delta[offset + k];
+                base[offset + k] += delta[offset + k];
+                delta[offset + k] = 0;
+            }
+        }
+    }
+
+    const size_t width;
+
+private:
+    size_t slot(size_t row) const {
+        auto it = slots.find(row);
+        CHECK(it != slots.end()) << "hot row " << row << " is not installed";
+        return it->second;
+    }
+
+    std::mutex mtx;
+    std::unordered_map<size_t, size_t> slots;
+    std::vector<size_t> row_of_slot;
+    std::vector<float> base;
+    std::vector<float> delta;
+};
+
+} // namespace ps
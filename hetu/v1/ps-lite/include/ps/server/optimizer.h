@@ -39,7 +39,7 @@ public:
     }
 
     void ApplyDense(Param<V> &param, SArray<V> &grads) {
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < param.size(); ++j) {
             param[j] -= lr * grads[j];
         }
@@ -48,7 +48,7 @@ public:
     void ApplySparse(Param2D<V> &param, SArray<size_t> &offsets,
                      SArray<V> &grads) {
         size_t width = param.width;
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             size_t src_offset = j * width;
             size_t dst_offset = offsets[j] * width;
@@ -61,7 +61,7 @@ public:
     void ApplyCache(CacheTable<V> &param, SArray<version_t> &updates,
                     SArray<size_t> &offsets, SArray<V> &grads) {
         size_t width = param.width;
-        // #pragma omp parallel for num_threads(4)
+        // #pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             param.ver[offsets[j]] += updates[j];
             size_t src_offset = j * width;
@@ -88,7 +88,7 @@ public:
     }
 
     void ApplyDense(Param<V> &param, SArray<V> &grads) {
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < param.size(); ++j) {
             velocity[j] = moment * velocity[j] - lr * grads[j];
             param[j] = param[j] + velocity[j];
@@ -98,7 +98,7 @@ public:
     void ApplySparse(Param2D<V> &param, SArray<size_t> &offsets,
                      SArray<V> &grads) {
         size_t width = param.width;
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             size_t src_offset = j * width;
             size_t dst_offset = offsets[j] * width;
@@ -115,7 +115,7 @@ public:
     void ApplyCache(CacheTable<V> &param, SArray<version_t> &updates,
                     SArray<size_t> &offsets, SArray<V> &grads) {
         size_t width = param.width;
-        // #pragma omp parallel for num_threads(4)
+        // #pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             param.ver[offsets[j]] += updates[j];
             size_t src_offset = j * width;
@@ -148,7 +148,7 @@ public:
     }
 
     void ApplyDense(Param<V> &param, SArray<V> &grads) {
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < param.size(); ++j) {
             V temp = -lr * grads[j];
             velocity[j] = moment * (velocity[j] + temp);
@@ -159,7 +159,7 @@ public:
     void ApplySparse(Param2D<V> &param, SArray<size_t> &offsets,
                      SArray<V> &grads) {
         size_t width = param.width;
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             size_t src_offset = j * width;
             size_t dst_offset = offsets[j] * width;
@@ -176,7 +176,7 @@ public:
     void ApplyCache(CacheTable<V> &param, SArray<version_t> &updates,
                     SArray<size_t> &offsets, SArray<V> &grads) {
         size_t width = param.width;
-        // #pragma omp parallel for num_threads(4)
+        // #pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             param.ver[offsets[j]] += updates[j];
             size_t src_offset = j * width;
@@ -211,7 +211,7 @@ public:
     }
 
     void ApplyDense(Param<V> &param, SArray<V> &grads) {
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < param.size(); ++j) {
             accum[j] = accum[j] + grads[j] * grads[j];
             param[j] = param[j] - lr * grads[j] / (sqrt(accum[j]) + eps);
@@ -221,7 +221,7 @@ public:
     void ApplySparse(Param2D<V> &param, SArray<size_t> &offsets,
                      SArray<V> &grads) {
         size_t width = param.width;
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             size_t src_offset = j * width;
             size_t dst_offset = offsets[j] * width;
@@ -240,7 +240,7 @@ public:
     void ApplyCache(CacheTable<V> &param, SArray<version_t> &updates,
                     SArray<size_t> &offsets, SArray<V> &grads) {
         size_t width = param.width;
-        // #pragma omp parallel for num_threads(4)
+        // #pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             param.ver[offsets[j]] += updates[j];
             size_t src_offset = j * width;
@@ -259,7 +259,7 @@ public:
 
     void InitStates(size_t size) {
         accum = new V[size];
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < size; ++j)
             accum[j] = init;
     }
@@ -285,7 +285,7 @@ public:
     void ApplyDense(Param<V> &param, SArray<V> &grads) {
         b1t = b1t * b1;
         b2t = b2t * b2;
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < param.size(); ++j) {
             marr[j] = b1 * marr[j] + (1 - b1) * grads[j];
             varr[j] = b2 * varr[j] + (1 - b2) * grads[j] * grads[j];
@@ -298,7 +298,7 @@ public:
     void ApplySparse(Param2D<V> &param, SArray<size_t> &offsets,
                      SArray<V> &grads) {
         size_t width = param.width;
-#pragma omp parallel for num_threads(4)
+#pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             size_t src_offset = j * width;
             size_t dst_offset = offsets[j] * width;
@@ -319,7 +319,7 @@ public:
     void ApplyCache(CacheTable<V> &param, SArray<version_t> &updates,
                     SArray<size_t> &offsets, SArray<V> &grads) {
         size_t width = param.width;
-        // #pragma omp parallel for num_threads(4)
+        // #pragma omp parallel for num_threads(GetServerThreads())
         for (size_t j = 0; j < offsets.size(); ++j) {
             param.ver[offsets[j]] += updates[j];
             size_t src_offset = j * width;
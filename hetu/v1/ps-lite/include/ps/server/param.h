@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "common/shared_mutex.h"
+#include "common/striped_lock.h"
 #include "ps/psf/PSFunc.h"
 #include "ps/server/optimizer.h"
 
@@ -97,9 +98,18 @@ protected:
     Optimizer<V> *opt;
 };
 
+/*
+  Param2D with row locks
+  Sparse requests only hold the table lock in shared mode and lock the rows
+  they touch, so that concurrent updates of different rows do not serialize.
+  Requests that read or write the whole table still take the table lock
+  exclusively to see consistent rows.
+*/
 template <typename V>
 class Param2D : public Param<V> {
 public:
+    const static size_t kRowStripes = 1024;
+
     explicit Param2D(size_t len, size_t wid, OptType otype, SArray<float> lrs) :
         Param<V>(len * wid, otype, lrs) {
         length = len;
@@ -112,7 +122,13 @@ public:
     ParamType type() {
         return kParam2D;
     }
+    stripe_guard<kRowStripes> row_guard(size_t row) noexcept {
+        return stripe_guard<kRowStripes>(row_mtx, row);
+    }
     size_t length, width;
+
+private:
+    striped_lock<kRowStripes> row_mtx;
 };
 
 template <typename V>
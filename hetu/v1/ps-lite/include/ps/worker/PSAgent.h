@@ -4,6 +4,8 @@
 #include "ps/worker/kvworker.h"
 #include "ps/psf/PSFunc.h"
 #include "ps/server/param.h"
+#include "ps/worker/sparse_index.h"
+#include "ps/worker/hot_rows.h"
 #include "common/logging.h"
 
 #include <algorithm>
@@ -16,6 +18,7 @@
 #include <chrono>
 #include <numeric>
 #include <map>
+#include <memory>
 #include <mutex>
 
 namespace ps {
@@ -30,14 +33,35 @@ struct TensorMeta {
     /* [node_name --> timestamp to be waited] */
     std::vector<int> ts;
     std::vector<size_t> part;
+    /* wire compression of pushes */
+    PushCompress compress;
+    /* values not sent by top-k pushes of a dense tensor */
+    std::vector<float> residual;
+    /* rows of the ids of a sparse table */
+    RowPermutation perm;
+    /* a key on each server holding the hot row replicas of a sparse table */
+    std::vector<Key> hot_keys;
 };
 
 struct SparseInfos {
-    // store structures used in sparse operations to avoid memory leak
-    // if using C++17 can changed to shared_ptr (which supports dynamic arrays)
-    size_t *in_offset;
-    size_t *out_offset;
-    float *in_data;
+    // buffers of sparse operations, reused across calls on the same tensor.
+    // the indices are shared with the pull callbacks, a new one is made if
+    // the last request has not finished yet.
+    std::shared_ptr<SparseIndex> in_index;
+    std::shared_ptr<SparseIndex> out_index;
+    std::vector<size_t> in_offset;
+    std::vector<size_t> out_offset;
+    std::vector<float> in_data;
+    // values not sent by top-k pushes, by row, with the push that left them
+    struct Residual {
+        std::vector<float> values;
+        size_t step;
+    };
+    std::unordered_map<size_t, Residual> residual;
+    std::vector<float> push_residual;
+    size_t push_steps = 0;
+    // hot row replication, null if disabled
+    std::shared_ptr<HotRowState> hot_state;
 };
 
 /*
@@ -83,6 +107,8 @@ public:
 
     void clearOnServer(int name) {
         TensorMeta &meta = _id2meta[name];
+        if (_id2sparseinfo.count(name))
+            dropHotRows(_id2sparseinfo[name]);
         for (size_t i = 0; i < meta.keys.size(); i++) {
             PSFData<ParamClear>::Request request(meta.keys[i]);
             auto cb = getCallBack<ParamClear>();
@@ -100,85 +126,91 @@ public:
      *        the meta data is stored on each worker.
      * \param name the name of the input data
      * \param cols the #columns of the data, the data are partitioned by cols.
+     * \param compress the wire compression of pushes, every push request
+     *        carries its compress type for the server to decode.
+     *        the rows of a sparse table are permuted by the partitioner, and
+     *        its PS_HOT_ROWS hottest rows are replicated on all its servers.
      */
-    void registerTensor(const int name, const ParamType ptype,
-                        const size_t length, const size_t width = 1) {
+    void
+    registerTensor(const int name, const ParamType ptype, const size_t length,
+                   const size_t width = 1,
+                   const PushCompress &compress = PushCompress::FromEnv()) {
         assert(!_id2meta.count(name));
         TensorMeta tm;
         tm.ptype = ptype;
         tm.length = length;
+        tm.compress = compress;
         if (ptype == kParam) {
             _par->partitionDense(length, tm.keys, tm.part);
         } else {
             tm.width = width;
             _par->partitionSparse(length, width, tm.keys, tm.part);
-            SparseInfos sp;
-            sp.in_offset = nullptr;
-            sp.out_offset = nullptr;
-            sp.in_data = nullptr;
-            _id2sparseinfo[name] = sp;
+            _id2sparseinfo[name] = SparseInfos();
+            if (ptype == kParam2D) {
+                tm.perm = _par->permuteSparse(length);
+                initHotRows(tm, _id2sparseinfo[name]);
+            }
         }
         _id2meta[name] = tm;
     }
 
+    void setPushCompress(const int name, const PushCompress &compress) {
+        auto it = _id2meta.find(name);
+        CHECK(it != _id2meta.end()) << "tensor " << name
+                                    << " is not registered";
+        TensorMeta &meta = it->second;
+        meta.compress = compress;
+        meta.residual.clear();
+        auto sp = _id2sparseinfo.find(name);
+        if (sp != _id2sparseinfo.end())
+            sp->second.residual.clear();
+    }
+
     void vecPushSparse(const int name, float *dup_index, float *vals,
                        const size_t dup_index_size, int priority = 0) {
         TensorMeta &meta = _id2meta[name];
         const std::vector<Key> &keys = meta.keys;
-        const std::vector<size_t> &lens = meta.part;
         size_t width = meta.width;
         SparseInfos &sp = _id2sparseinfo[name];
-        delete[] sp.in_offset;
-        delete[] sp.in_data;
 
-        std::map<size_t, std::vector<size_t>> idx2map;
-        for (size_t i = 0; i < dup_index_size; ++i) {
-            size_t idx = (size_t)dup_index[i];
-            idx2map[idx].emplace_back(i);
-        }
-
-        size_t index_size = idx2map.size();
-        size_t num_all = index_size * width;
-        size_t *cp_offset = sp.in_offset = new size_t[index_size];
-        float *cp_val = sp.in_data = new float[num_all]();
+        ageResiduals(meta, sp);
+        auto hot = hotRows(meta, sp, dup_index, dup_index_size);
+        auto index = acquireIndex(sp.in_index);
+        buildIndex(meta, hot.get(), *index, dup_index, dup_index_size);
+        sp.in_data.resize(index->size() * width);
+        index->Aggregate(vals, width, sp.in_data.data());
+        std::vector<size_t> bounds;
+        splitSparse(meta, hot.get(), *index, sp.in_offset, bounds);
 
-        size_t cur_index = 0;
-        size_t cur_offset = 0;
         size_t cur_len = 0;
-        auto iter = idx2map.begin();
-        std::vector<std::pair<bool, int>> ts(keys.size());
-
         for (size_t i = 0; i < keys.size(); ++i) {
-            size_t st_index = cur_index;
-            size_t st_offset = cur_offset;
-            while (iter != idx2map.end() && iter->first < cur_len + lens[i]) {
-                cp_offset[cur_index++] = iter->first - cur_len;
-                for (auto j : iter->second) {
-                    size_t ori_offset = j * width;
-                    for (size_t k = 0; k < width; ++k) {
-                        cp_val[cur_offset + k] += vals[ori_offset + k];
-                    }
-                }
-                cur_offset += width;
-                ++iter;
-            }
-            if (cur_index > st_index) {
-                ts[i].first = true;
-                PSFData<SparsePush>::Request request(
-                    keys[i],
-                    SArray<size_t>(cp_offset + st_index, cur_index - st_index),
-                    SArray<float>(cp_val + st_offset, cur_offset - st_offset));
-                auto cb = getCallBack<SparsePush>();
-                ts[i].second = _kvworker.Request<SparsePush>(request, cb);
-            } else {
-                ts[i].first = false;
-            }
-            cur_len += lens[i];
+            size_t st = bounds[i], en = bounds[i + 1];
+            size_t row_base = cur_len;
+            cur_len += meta.part[i];
+            if (en == st)
+                continue;
+            SArray<char> data;
+            int ctype = encodeSparse(meta, sp, st, en, row_base, data);
+            PSFData<SparsePush>::Request request(
+                keys[i], SArray<size_t>(sp.in_offset.data() + st, en - st),
+                data, ctype);
+            auto cb = getCallBack<SparsePush>();
+            meta.ts.push_back(_kvworker.Request<SparsePush>(request, cb));
+        }
+        // the hot rows, to their replicas
+        for (size_t i = keys.size(); i + 1 < bounds.size(); ++i) {
+            size_t st = bounds[i], en = bounds[i + 1];
+            if (en == st)
+                continue;
+            SArray<char> data;
+            int ctype = encodeSparse(meta, sp, st, en, 0, data);
+            PSFData<kHotPush>::Request request(
+                meta.hot_keys[i - keys.size()],
+                SArray<size_t>(sp.in_offset.data() + st, en - st), data,
+                ctype, width);
+            auto cb = getCallBack<kHotPush>();
+            meta.ts.push_back(_kvworker.Request<kHotPush>(request, cb));
         }
-
-        for (auto &t : ts)
-            if (t.first)
-                meta.ts.push_back(t.second);
         return;
     }
 
@@ -186,53 +218,39 @@ public:
                        const size_t dup_index_size, int priority = 0) {
         TensorMeta &meta = _id2meta[name];
         const std::vector<Key> &keys = meta.keys;
-        const std::vector<size_t> &lens = meta.part;
         size_t width = meta.width;
         SparseInfos &sp = _id2sparseinfo[name];
-        delete[] sp.out_offset;
-
-        std::map<size_t, std::vector<size_t>> idx2map;
-        for (size_t i = 0; i < dup_index_size; ++i) {
-            size_t idx = (size_t)dup_index[i];
-            idx2map[idx].emplace_back(i);
-        }
-
-        size_t index_size = idx2map.size();
-        size_t *cp_offset = sp.out_offset = new size_t[index_size];
 
-        size_t cur_index = 0;
-        size_t cur_len = 0;
-        auto iter = idx2map.begin();
-        std::vector<std::pair<bool, int>> ts(keys.size());
+        auto hot = hotRows(meta, sp, dup_index, dup_index_size);
+        auto index = acquireIndex(sp.out_index);
+        buildIndex(meta, hot.get(), *index, dup_index, dup_index_size);
+        std::vector<size_t> bounds;
+        splitSparse(meta, hot.get(), *index, sp.out_offset, bounds);
 
         for (size_t i = 0; i < keys.size(); ++i) {
-            size_t st_index = cur_index;
-            auto st_iter = iter;
-            while (iter != idx2map.end() && iter->first < cur_len + lens[i]) {
-                cp_offset[cur_index++] = iter->first - cur_len;
-                ++iter;
-            }
-            if (cur_index > st_index) {
-                ts[i].first = true;
-                PSFData<SparsePull>::Request request(
-                    keys[i],
-                    SArray<size_t>(cp_offset + st_index, cur_index - st_index));
-                auto cb = getCallBack<SparsePull>(
-                    SArray<float>(vals, dup_index_size * width),
-                    std::move(
-                        std::vector<std::pair<size_t, std::vector<size_t>>>(
-                            st_iter, iter)),
-                    cur_len, width);
-                ts[i].second = _kvworker.Request<SparsePull>(request, cb);
-            } else {
-                ts[i].first = false;
-            }
-            cur_len += lens[i];
+            size_t st = bounds[i], en = bounds[i + 1];
+            if (en == st)
+                continue;
+            PSFData<SparsePull>::Request request(
+                keys[i], SArray<size_t>(sp.out_offset.data() + st, en - st));
+            auto cb = getCallBack<SparsePull>(
+                SArray<float>(vals, dup_index_size * width),
+                std::shared_ptr<const SparseIndex>(index), st, en, width);
+            meta.ts.push_back(_kvworker.Request<SparsePull>(request, cb));
+        }
+        // the hot rows, from their replicas
+        for (size_t i = keys.size(); i + 1 < bounds.size(); ++i) {
+            size_t st = bounds[i], en = bounds[i + 1];
+            if (en == st)
+                continue;
+            PSFData<kHotPull>::Request request(
+                meta.hot_keys[i - keys.size()],
+                SArray<size_t>(sp.out_offset.data() + st, en - st), width);
+            auto cb = getCallBack<kHotPull>(
+                SArray<float>(vals, dup_index_size * width),
+                std::shared_ptr<const SparseIndex>(index), st, en, width);
+            meta.ts.push_back(_kvworker.Request<kHotPull>(request, cb));
         }
-
-        for (auto &t : ts)
-            if (t.first)
-                meta.ts.push_back(t.second);
         return;
     }
 
@@ -244,51 +262,29 @@ public:
         const std::vector<size_t> &lens = meta.part;
         size_t width = meta.width;
         SparseInfos &sp = _id2sparseinfo[name];
-        delete[] sp.in_offset;
-        delete[] sp.in_data;
 
-        std::map<size_t, std::vector<size_t>> idx2map;
-        for (size_t i = 0; i < dup_index_size; ++i) {
-            size_t idx = (size_t)dup_index[i];
-            idx2map[idx].emplace_back(i);
-        }
-
-        size_t index_size = idx2map.size();
-        size_t num_all = index_size * width;
-        size_t *cp_offset = sp.in_offset = new size_t[index_size];
-        float *cp_val = sp.in_data = new float[num_all]();
+        // the whole table is pulled, from the owners of the rows
+        flushHotRows(meta, sp);
+        ageResiduals(meta, sp);
+        auto index = acquireIndex(sp.in_index);
+        buildIndex(meta, nullptr, *index, dup_index, dup_index_size);
+        sp.in_data.resize(index->size() * width);
+        index->Aggregate(vals, width, sp.in_data.data());
+        std::vector<size_t> bounds;
+        splitSparse(meta, nullptr, *index, sp.in_offset, bounds);
 
-        size_t cur_index = 0;
-        size_t cur_offset = 0;
         size_t cur_len = 0;
-        size_t pull_offset = 0;
-        auto iter = idx2map.begin();
-
         for (size_t i = 0; i < keys.size(); ++i) {
-            size_t st_index = cur_index;
-            size_t st_offset = cur_offset;
+            size_t st = bounds[i], en = bounds[i + 1];
             size_t local_length = lens[i] * width;
-            while (iter != idx2map.end() && iter->first < cur_len + lens[i]) {
-                cp_offset[cur_index++] = iter->first - cur_len;
-                for (auto j : iter->second) {
-                    size_t ori_offset = j * width;
-                    for (size_t k = 0; k < width; ++k) {
-                        cp_val[cur_offset + k] += vals[ori_offset + k];
-                    }
-                }
-                cur_offset += width;
-                ++iter;
-            }
+            SArray<char> data;
+            int ctype = encodeSparse(meta, sp, st, en, cur_len, data);
             PSFData<SDPushPull>::Request request(
-                keys[i],
-                SArray<size_t>(cp_offset + st_index, cur_index - st_index),
-                SArray<float>(cp_val + st_offset, cur_offset - st_offset),
-                local_length);
-            auto cb = getCallBack<SDPushPull>(
-                SArray<float>(out_vals + pull_offset, local_length));
+                keys[i], SArray<size_t>(sp.in_offset.data() + st, en - st),
+                data, ctype, local_length);
+            auto cb = pullRowsCallBack(meta, out_vals, cur_len, lens[i]);
             meta.ts.push_back(_kvworker.Request<SDPushPull>(request, cb));
             cur_len += lens[i];
-            pull_offset += local_length;
         }
         return;
     }
@@ -298,87 +294,67 @@ public:
                        const size_t dup_index_size, int priority = 0) {
         TensorMeta &meta = _id2meta[name];
         const std::vector<Key> &keys = meta.keys;
-        const std::vector<size_t> &lens = meta.part;
         size_t width = meta.width;
         SparseInfos &sp = _id2sparseinfo[name];
-        delete[] sp.in_offset;
-        delete[] sp.out_offset;
-        delete[] sp.in_data;
-
-        std::map<size_t, std::vector<size_t>> in_idx2map;
-        std::map<size_t, std::vector<size_t>> out_idx2map;
-        for (size_t i = 0; i < dup_index_size; ++i) {
-            size_t idx = (size_t)in_index[i];
-            in_idx2map[idx].emplace_back(i);
-            idx = (size_t)out_index[i];
-            out_idx2map[idx].emplace_back(i);
-        }
-
-        size_t in_index_size = in_idx2map.size();
-        size_t out_index_size = out_idx2map.size();
-        size_t in_num_all = in_index_size * width;
-        size_t *in_cp_offset = sp.in_offset = new size_t[in_index_size];
-        size_t *out_cp_offset = sp.out_offset = new size_t[out_index_size];
-        float *in_cp_val = sp.in_data = new float[in_num_all]();
-
-        size_t in_cur_index = 0;
-        size_t in_cur_offset = 0;
-        size_t cur_len = 0;
-        size_t out_cur_index = 0;
-        auto in_iter = in_idx2map.begin();
-        auto out_iter = out_idx2map.begin();
-        std::vector<std::pair<bool, int>> ts(keys.size());
-
-        for (size_t i = 0; i < keys.size(); ++i) {
-            size_t in_st_index = in_cur_index;
-            size_t st_offset = in_cur_offset;
-            while (in_iter != in_idx2map.end()
-                   && in_iter->first < cur_len + lens[i]) {
-                in_cp_offset[in_cur_index++] = in_iter->first - cur_len;
-                for (auto j : in_iter->second) {
-                    size_t ori_offset = j * width;
-                    for (size_t k = 0; k < width; ++k) {
-                        in_cp_val[in_cur_offset + k] += in_vals[ori_offset + k];
-                    }
-                }
-                in_cur_offset += width;
-                ++in_iter;
-            }
 
-            size_t out_st_index = out_cur_index;
-            auto st_iter = out_iter;
-            while (out_iter != out_idx2map.end()
-                   && out_iter->first < cur_len + lens[i]) {
-                out_cp_offset[out_cur_index++] = out_iter->first - cur_len;
-                ++out_iter;
-            }
+        ageResiduals(meta, sp);
+        // pushes and pulls of a step see the same hot rows
+        auto hot = hotRows(meta, sp, out_index, dup_index_size);
+        auto push_index = acquireIndex(sp.in_index);
+        buildIndex(meta, hot.get(), *push_index, in_index, dup_index_size);
+        sp.in_data.resize(push_index->size() * width);
+        push_index->Aggregate(in_vals, width, sp.in_data.data());
+        std::vector<size_t> in_bounds;
+        splitSparse(meta, hot.get(), *push_index, sp.in_offset, in_bounds);
+
+        auto pull_index = acquireIndex(sp.out_index);
+        buildIndex(meta, hot.get(), *pull_index, out_index, dup_index_size);
+        std::vector<size_t> out_bounds;
+        splitSparse(meta, hot.get(), *pull_index, sp.out_offset, out_bounds);
 
-            if (in_cur_index > in_st_index || out_cur_index > out_st_index) {
-                ts[i].first = true;
-                PSFData<SSPushPull>::Request request(
-                    keys[i],
-                    SArray<size_t>(in_cp_offset + in_st_index,
-                                   in_cur_index - in_st_index),
-                    SArray<float>(in_cp_val + st_offset,
-                                  in_cur_offset - st_offset),
-                    SArray<size_t>(out_cp_offset + out_st_index,
-                                   out_cur_index - out_st_index));
-                auto cb = getCallBack<SparsePull>(
-                    SArray<float>(out_vals, dup_index_size * width),
-                    std::move(
-                        std::vector<std::pair<size_t, std::vector<size_t>>>(
-                            st_iter, out_iter)),
-                    cur_len, width);
-                ts[i].second = _kvworker.Request<SSPushPull>(request, cb);
-            } else {
-                ts[i].first = false;
-            }
-            cur_len += lens[i];
+        size_t cur_len = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            size_t in_st = in_bounds[i], in_en = in_bounds[i + 1];
+            size_t out_st = out_bounds[i], out_en = out_bounds[i + 1];
+            size_t row_base = cur_len;
+            cur_len += meta.part[i];
+            if (in_en == in_st && out_en == out_st)
+                continue;
+            SArray<char> data;
+            int ctype = encodeSparse(meta, sp, in_st, in_en, row_base, data);
+            PSFData<SSPushPull>::Request request(
+                keys[i],
+                SArray<size_t>(sp.in_offset.data() + in_st, in_en - in_st),
+                data, ctype,
+                SArray<size_t>(sp.out_offset.data() + out_st,
+                               out_en - out_st));
+            auto cb = getCallBack<SSPushPull>(
+                SArray<float>(out_vals, dup_index_size * width),
+                std::shared_ptr<const SparseIndex>(pull_index), out_st,
+                out_en, width);
+            meta.ts.push_back(_kvworker.Request<SSPushPull>(request, cb));
+        }
+        // the hot rows, to and from their replicas
+        for (size_t i = keys.size(); i + 1 < in_bounds.size(); ++i) {
+            size_t in_st = in_bounds[i], in_en = in_bounds[i + 1];
+            size_t out_st = out_bounds[i], out_en = out_bounds[i + 1];
+            if (in_en == in_st && out_en == out_st)
+                continue;
+            SArray<char> data;
+            int ctype = encodeSparse(meta, sp, in_st, in_en, 0, data);
+            PSFData<kHotPushPull>::Request request(
+                meta.hot_keys[i - keys.size()],
+                SArray<size_t>(sp.in_offset.data() + in_st, in_en - in_st),
+                data, ctype,
+                SArray<size_t>(sp.out_offset.data() + out_st,
+                               out_en - out_st),
+                width);
+            auto cb = getCallBack<kHotPushPull>(
+                SArray<float>(out_vals, dup_index_size * width),
+                std::shared_ptr<const SparseIndex>(pull_index), out_st,
+                out_en, width);
+            meta.ts.push_back(_kvworker.Request<kHotPushPull>(request, cb));
         }
-
-        for (auto &t : ts)
-            if (t.first)
-                meta.ts.push_back(t.second);
         return;
     }
 
@@ -393,9 +369,10 @@ public:
         /* send push request to each partition according to the offsets. */
         size_t cur_len = 0;
         for (size_t i = 0; i < meta.keys.size(); i++) {
-            PSFData<DensePush>::Request request(
-                meta.keys[i], meta.part[i],
-                SArray<float>(vals + cur_len, meta.part[i]));
+            SArray<char> data;
+            int ctype = encodeDense(meta, vals, cur_len, meta.part[i], data);
+            PSFData<DensePush>::Request request(meta.keys[i], meta.part[i],
+                                                data, ctype);
             meta.ts.push_back(_kvworker.Request<DensePush>(request, cb));
             cur_len += meta.part[i];
         }
@@ -403,14 +380,15 @@ public:
 
     void vecDensePull(const int name, float *vals, int priority = 0) {
         TensorMeta &meta = _id2meta[name];
-        size_t cur_offset = 0;
+        if (_id2sparseinfo.count(name))
+            flushHotRows(meta, _id2sparseinfo[name]);
+        size_t cur_len = 0;
         for (size_t i = 0; i < meta.keys.size(); i++) {
             size_t cur_length = meta.part[i] * meta.width;
             PSFData<DensePull>::Request request(meta.keys[i], cur_length);
-            auto cb = getCallBack<DensePull>(
-                SArray<float>(vals + cur_offset, cur_length));
+            auto cb = pullRowsCallBack(meta, vals, cur_len, meta.part[i]);
             meta.ts.push_back(_kvworker.Request<DensePull>(request, cb));
-            cur_offset += cur_length;
+            cur_len += meta.part[i];
         }
     }
 
@@ -420,9 +398,11 @@ public:
         size_t cur_len = 0;
         /* send pull request to each partition */
         for (size_t i = 0; i < meta.keys.size(); i++) {
-            PSFData<DDPushPull>::Request request(
-                meta.keys[i], meta.part[i],
-                SArray<float>(in_vals + cur_len, meta.part[i]));
+            SArray<char> data;
+            int ctype =
+                encodeDense(meta, in_vals, cur_len, meta.part[i], data);
+            PSFData<DDPushPull>::Request request(meta.keys[i], meta.part[i],
+                                                 data, ctype);
             auto cb = getCallBack<DDPushPull>(
                 SArray<float>(out_vals + cur_len, meta.part[i]));
             meta.ts.push_back(_kvworker.Request<DDPushPull>(request, cb));
@@ -446,8 +426,12 @@ public:
 
     void ParameterSave(const int name, char *address) {
         TensorMeta &meta = _id2meta[name];
+        if (_id2sparseinfo.count(name))
+            flushHotRows(meta, _id2sparseinfo[name]);
         /* send pull request to each partition */
         auto cb = getCallBack<ParamSave>();
+        SArray<char> partitioner;
+        partitioner.CopyFrom(_par->name(), strlen(_par->name()));
         for (size_t i = 0; i < meta.keys.size(); i++) {
             std::string local_address = std::string(address) + "/"
                                         + std::to_string(name) + "_"
@@ -455,22 +439,30 @@ public:
             SArray<char> temp_array;
             temp_array.CopyFrom(local_address.c_str(), local_address.size());
             PSFData<ParamSave>::Request request(meta.keys[i], temp_array,
-                                                false);
+                                                false, partitioner);
             meta.ts.push_back(_kvworker.Request<ParamSave>(request, cb));
         }
     }
 
     void ParameterLoad(const int name, char *address) {
         TensorMeta &meta = _id2meta[name];
+        // the replicas are installed again from the loaded values
+        if (_id2sparseinfo.count(name)) {
+            flushHotRows(meta, _id2sparseinfo[name]);
+            dropHotRows(_id2sparseinfo[name]);
+        }
         /* send pull request to each partition */
         auto cb = getCallBack<ParamLoad>();
+        SArray<char> partitioner;
+        partitioner.CopyFrom(_par->name(), strlen(_par->name()));
         for (size_t i = 0; i < meta.keys.size(); i++) {
             std::string local_address = std::string(address) + "/"
                                         + std::to_string(name) + "_"
                                         + std::to_string(i) + ".dat";
             SArray<char> temp_array;
             temp_array.CopyFrom(local_address.c_str(), local_address.size());
-            PSFData<ParamLoad>::Request request(meta.keys[i], temp_array);
+            PSFData<ParamLoad>::Request request(meta.keys[i], temp_array,
+                                                partitioner);
             meta.ts.push_back(_kvworker.Request<ParamLoad>(request, cb));
         }
     }
@@ -483,6 +475,12 @@ public:
         _kvworker.recordLoads();
     }
 
+    /* [server --> #requests, bytes sent, bytes received] */
+    void getServerLoads(long long *loads) {
+        for (size_t i = 0; i < _par->numServers(); ++i)
+            _kvworker.getServerLoads(i, loads + 3 * i);
+    }
+
     void SSPSync(Key key, ssp_version_t version) {
         PSFData<kSSPSync>::Request request(key, Postoffice::Get()->my_rank(), version);
         bool success = false;
@@ -520,8 +518,9 @@ public:
     */
     void PushData(Key idx, float *vals, int len, std::vector<int> &timestamp) {
         auto cb = getCallBack<DensePush>();
-        PSFData<DensePush>::Request request(mapWkeyToSkey(idx), len,
-                                            SArray<float>(vals, len));
+        PSFData<DensePush>::Request request(
+            mapWkeyToSkey(idx), len, SArray<char>(SArray<float>(vals, len)),
+            kNoCompress);
         int ts = _kvworker.Request<DensePush>(request, cb);
         timestamp.push_back(ts);
     }
@@ -625,6 +624,333 @@ public:
             cur_len += meta.part[i];
         }
     }
+
+private:
+    /*
+      Encodes the pushed values [offset, offset + len) of a dense tensor,
+      returns the compress type of data.
+    */
+    static int encodeDense(TensorMeta &meta, const float *vals, size_t offset,
+                           size_t len, SArray<char> &data) {
+        float *residual = nullptr;
+        if (meta.compress.type == kTopK) {
+            meta.residual.resize(meta.length, 0);
+            residual = meta.residual.data() + offset;
+        }
+        return EncodePush(meta.compress, vals + offset, len, 1, residual, data,
+                          GetWorkerThreads());
+    }
+
+    /*
+      Encodes the aggregated rows of ids [st, en) of a sparse push, which are
+      the rows sp.in_offset + row_base, returns the compress type of data.
+      Top-k keeps the values it does not send of each row until the row is
+      pushed again, see ageResiduals.
+    */
+    static int encodeSparse(TensorMeta &meta, SparseInfos &sp, size_t st,
+                            size_t en, size_t row_base, SArray<char> &data) {
+        size_t width = meta.width, size = (en - st) * width;
+        const float *vals = sp.in_data.data() + st * width;
+        if (meta.compress.type != kTopK)
+            return EncodePush(meta.compress, vals, size, width, nullptr, data,
+                              GetWorkerThreads());
+        auto row_of = [&](size_t j) { return sp.in_offset[j] + row_base; };
+        std::vector<float> &residual = sp.push_residual;
+        residual.assign(size, 0);
+        for (size_t j = st; j < en; ++j) {
+            auto it = sp.residual.find(row_of(j));
+            if (it != sp.residual.end())
+                std::copy(it->second.values.begin(), it->second.values.end(),
+                          residual.begin() + (j - st) * width);
+        }
+        int ctype = EncodePush(meta.compress, vals, size, width,
+                               residual.data(), data, GetWorkerThreads());
+        for (size_t j = st; j < en; ++j) {
+            auto row = residual.begin() + (j - st) * width;
+            if (std::all_of(row, row + width, [](float v) { return v == 0; }))
+                sp.residual.erase(row_of(j));
+            else
+                sp.residual[row_of(j)] = {std::vector<float>(row, row + width),
+                                          sp.push_steps};
+        }
+        return ctype;
+    }
+
+    /*
+      Counts a top-k push of a sparse table, and every
+      PS_PUSH_TOPK_RESIDUAL_STEPS pushes drops the residuals of the rows that
+      were not pushed during the last that many pushes. This bounds the
+      residuals by the rows pushed in 2 * PS_PUSH_TOPK_RESIDUAL_STEPS pushes
+      instead of every row ever pushed, the dropped values are lost.
+    */
+    static void ageResiduals(const TensorMeta &meta, SparseInfos &sp) {
+        if (meta.compress.type != kTopK)
+            return;
+        static const size_t max_age =
+            std::max(GetEnv("PS_PUSH_TOPK_RESIDUAL_STEPS", 100), 1);
+        if (++sp.push_steps % max_age != 0)
+            return;
+        for (auto it = sp.residual.begin(); it != sp.residual.end();) {
+            if (sp.push_steps - it->second.step >= max_age)
+                it = sp.residual.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    static std::shared_ptr<SparseIndex>
+    acquireIndex(std::shared_ptr<SparseIndex> &index) {
+        if (!index || index.use_count() > 1)
+            index = std::make_shared<SparseIndex>();
+        return index;
+    }
+
+    /*
+      Splits the distinct ids of a sparse request by partition: the ids
+      of key i are [bounds[i], bounds[i + 1]) and offset holds each id
+      relative to the start of its partition. With hot rows, the ids of
+      hot_keys[s] follow those of the partitions and offset holds their rows
+      in the table.
+    */
+    static void splitSparse(const TensorMeta &meta, const HotRows *hot,
+                            const SparseIndex &index,
+                            std::vector<size_t> &offset,
+                            std::vector<size_t> &bounds) {
+        const std::vector<size_t> &ids = index.ids();
+        offset.resize(ids.size());
+        bounds.assign(1, 0);
+        size_t cur_len = 0;
+        for (size_t i = 0; i < meta.keys.size(); ++i) {
+            size_t st = bounds.back();
+            size_t en = index.LowerBound(cur_len + meta.part[i]);
+            for (size_t j = st; j < en; ++j)
+                offset[j] = ids[j] - cur_len;
+            bounds.push_back(en);
+            cur_len += meta.part[i];
+        }
+        if (!hot)
+            return;
+        for (size_t s = 0; s < meta.hot_keys.size(); ++s) {
+            size_t st = bounds.back();
+            size_t en = index.LowerBound(cur_len + (s + 1) * hot->capacity);
+            for (size_t j = st; j < en; ++j)
+                offset[j] = hot->rows[(ids[j] - cur_len) % hot->capacity];
+            bounds.push_back(en);
+        }
+    }
+
+    /*
+      Indexes the rows of dup_index, the ids of hot (if any) are indexed by
+      their virtual ids.
+    */
+    static void buildIndex(const TensorMeta &meta, const HotRows *hot,
+                           SparseIndex &index, const float *dup_index,
+                           size_t size) {
+        const RowPermutation &perm = meta.perm;
+        if (!hot) {
+            if (perm.identity())
+                index.Build(dup_index, size);
+            else
+                index.Build(dup_index, size,
+                            [&perm](size_t id) { return perm.Map(id); });
+            return;
+        }
+        size_t length = meta.length;
+        index.Build(dup_index, size, [&perm, hot, length](size_t id) {
+            auto it = hot->virtual_ids.find(id);
+            return it == hot->virtual_ids.end() ? perm.Map(id)
+                                                : length + it->second;
+        });
+    }
+
+    /*
+      Callback of a pull of the rows [row, row + rows) of a sparse table, it
+      stores each row at the position of its id in vals.
+    */
+    static std::function<void(const PSFData<DensePull>::Response &)>
+    pullRowsCallBack(const TensorMeta &meta, float *vals, size_t row,
+                     size_t rows) {
+        size_t width = meta.width;
+        if (meta.perm.identity())
+            return getCallBack<DensePull>(
+                SArray<float>(vals + row * width, rows * width));
+        RowPermutation perm = meta.perm;
+        return [perm, vals, row, rows,
+                width](const PSFData<DensePull>::Response &response) {
+            auto val = get<0>(response);
+            CHECK_EQ(val.size(), rows * width) << val.size();
+            for (size_t j = 0; j < rows; ++j)
+                std::copy(val.begin() + j * width,
+                          val.begin() + (j + 1) * width,
+                          vals + perm.Unmap(row + j) * width);
+        };
+    }
+
+    void initHotRows(TensorMeta &meta, SparseInfos &sp) {
+        size_t capacity = GetEnv("PS_HOT_ROWS", 0);
+        if (capacity == 0)
+            return;
+        std::set<int> servers;
+        for (Key key : meta.keys) {
+            if (servers.insert(_par->queryServer(key)).second)
+                meta.hot_keys.push_back(key);
+        }
+        // a single server holds every row already
+        if (meta.hot_keys.size() < 2) {
+            meta.hot_keys.clear();
+            return;
+        }
+        sp.hot_state = std::make_shared<HotRowState>(
+            capacity, GetEnv("PS_HOT_SAMPLE", 16));
+    }
+
+    /*
+      Samples the ids of a request and returns the hot rows to route it with,
+      null if there are none. Every PS_HOT_SYNC_STEPS requests the hot set is
+      recomputed and synced, see HotRowState.
+    */
+    std::shared_ptr<const HotRows> hotRows(TensorMeta &meta, SparseInfos &sp,
+                                           const float *dup_index,
+                                           size_t size) {
+        if (!sp.hot_state)
+            return nullptr;
+        static const size_t sync_steps =
+            std::max(GetEnv("PS_HOT_SYNC_STEPS", 100), 1);
+        HotRowState &state = *sp.hot_state;
+        std::lock_guard<std::mutex> lock(state.mu);
+        state.counter.Sample(dup_index, size);
+        if (++state.steps % sync_steps != 0)
+            return state.rows;
+        auto hot = std::make_shared<HotRows>();
+        hot->capacity = state.capacity;
+        hot->ids = state.counter.Top(state.capacity);
+        size_t num_replicas = meta.hot_keys.size();
+        size_t rank = Postoffice::Get()->my_rank();
+        for (size_t h = 0; h < hot->ids.size(); ++h) {
+            size_t s = (h + rank) % num_replicas;
+            hot->virtual_ids[hot->ids[h]] = s * hot->capacity + h;
+            hot->rows.push_back(meta.perm.Map(hot->ids[h]));
+        }
+        syncHotRows(meta, hot.get());
+        state.rows = hot;
+        return state.rows;
+    }
+
+    /* moves the deltas pushed to the replicas to the owners of the rows */
+    void flushHotRows(TensorMeta &meta, SparseInfos &sp) {
+        if (!sp.hot_state)
+            return;
+        std::lock_guard<std::mutex> lock(sp.hot_state->mu);
+        syncHotRows(meta, nullptr);
+    }
+
+    /* routes the requests to the owners until the next sync */
+    static void dropHotRows(SparseInfos &sp) {
+        if (!sp.hot_state)
+            return;
+        std::lock_guard<std::mutex> lock(sp.hot_state->mu);
+        sp.hot_state->rows = nullptr;
+    }
+
+    /*
+      Drains the replicas and pushes the deltas to the owners of the rows,
+      then installs hot (if not null) on every replica with the values of the
+      owners. Blocks until done.
+    */
+    void syncHotRows(TensorMeta &meta, const HotRows *hot) {
+        size_t width = meta.width;
+        std::vector<int> ts;
+        auto wait_all = [this, &ts]() {
+            for (int t : ts)
+                _kvworker.Wait(t);
+            ts.clear();
+        };
+
+        // the deltas of each row, summed over the replicas
+        std::mutex mu;
+        std::map<size_t, std::vector<float>> deltas;
+        for (Key key : meta.hot_keys) {
+            PSFData<kHotDrain>::Request request(key);
+            auto cb = [&mu, &deltas,
+                       width](const PSFData<kHotDrain>::Response &response) {
+                auto rows = get<0>(response);
+                auto vals = get<1>(response);
+                std::lock_guard<std::mutex> lock(mu);
+                for (size_t i = 0; i < rows.size(); ++i) {
+                    std::vector<float> &delta = deltas[rows[i]];
+                    delta.resize(width, 0);
+                    for (size_t k = 0; k < width; ++k)
+                        delta[k] += vals[i * width + k];
+                }
+            };
+            ts.push_back(_kvworker.Request<kHotDrain>(request, cb));
+        }
+        wait_all();
+
+        auto it = deltas.begin();
+        size_t cur_len = 0;
+        for (size_t i = 0; i < meta.keys.size(); ++i) {
+            SArray<size_t> offsets;
+            SArray<float> vals;
+            for (; it != deltas.end() && it->first < cur_len + meta.part[i];
+                 ++it) {
+                offsets.push_back(it->first - cur_len);
+                for (float v : it->second)
+                    vals.push_back(v);
+            }
+            cur_len += meta.part[i];
+            if (offsets.empty())
+                continue;
+            PSFData<SparsePush>::Request request(meta.keys[i], offsets,
+                                                 SArray<char>(vals),
+                                                 kNoCompress);
+            auto cb = getCallBack<SparsePush>();
+            ts.push_back(_kvworker.Request<SparsePush>(request, cb));
+        }
+        wait_all();
+        if (!hot || hot->rows.empty())
+            return;
+
+        // pull the hot rows from their owners, in the order of the rows
+        std::vector<size_t> order(hot->rows.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [hot](size_t a, size_t b) {
+            return hot->rows[a] < hot->rows[b];
+        });
+        SArray<float> values(hot->rows.size() * width);
+        size_t next = 0;
+        cur_len = 0;
+        for (size_t i = 0; i < meta.keys.size(); ++i) {
+            size_t st = next;
+            SArray<size_t> offsets;
+            for (; next < order.size()
+                   && hot->rows[order[next]] < cur_len + meta.part[i];
+                 ++next)
+                offsets.push_back(hot->rows[order[next]] - cur_len);
+            cur_len += meta.part[i];
+            if (offsets.empty())
+                continue;
+            PSFData<SparsePull>::Request request(meta.keys[i], offsets);
+            auto cb = [&order, &values, st,
+                       width](const PSFData<SparsePull>::Response &response) {
+                auto val = get<0>(response);
+                for (size_t j = 0; j * width < val.size(); ++j)
+                    std::copy(val.begin() + j * width,
+                              val.begin() + (j + 1) * width,
+                              values.begin() + order[st + j] * width);
+            };
+            ts.push_back(_kvworker.Request<SparsePull>(request, cb));
+        }
+        wait_all();
+
+        SArray<size_t> rows(hot->rows);
+        auto cb = getCallBack<kHotInstall>();
+        for (Key key : meta.hot_keys) {
+            PSFData<kHotInstall>::Request request(key, rows, values);
+            ts.push_back(_kvworker.Request<kHotInstall>(request, cb));
+        }
+        wait_all();
+    }
 };
 
 } // namespace ps
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ps/internal/utils.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ps {
+
+/*
+  HotRowCounter
+  Counts a sample of the ids of sparse requests to find the most frequent
+  ones. Every rate-th id is counted, continuing across requests so that the
+  sample does not depend on the batch size. The counts are halved whenever
+  more than kMaxTracked ids are tracked, which also forgets ids that went
+  cold.
+*/
+class HotRowCounter {
+    static constexpr size_t kMaxTracked = 1 << 16;
+
+public:
+    explicit HotRowCounter(size_t rate) : _rate(std::max<size_t>(rate, 1)) {
+    }
+
+    void Sample(const float *ids, size_t size) {
+        size_t i = _next;
+        for (; i < size; i += _rate)
+            ++_counts[(size_t)ids[i]];
+        _next = i - size;
+        if (_counts.size() > kMaxTracked)
+            Decay();
+    }
+
+    // the k most frequent ids, the hottest first
+    std::vector<size_t> Top(size_t k) const {
+        std::vector<std::pair<size_t, size_t>> ranked; // (count, id)
+        ranked.reserve(_counts.size());
+        for (auto &kv : _counts)
+            ranked.emplace_back(kv.second, kv.first);
+        k = std::min(k, ranked.size());
+        auto hotter = [](const std::pair<size_t, size_t> &a,
+                         const std::pair<size_t, size_t> &b) {
+            return a.first > b.first
+                   || (a.first == b.first && a.second < b.second);
+        };
+        std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(),
+                          hotter);
+        std::vector<size_t> top(k);
+        for (size_t i = 0; i < k; ++i)
+            top[i] = ranked[i].second;
+        return top;
+    }
+
+private:
+    void Decay() {
+        for (auto it = _counts.begin(); it != _counts.end();) {
+            it->second /= 2;
+            if (it->second == 0)
+                it = _counts.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    size_t _rate;
+    size_t _next = 0;
+    std::unordered_map<size_t, size_t> _counts;
+};
+
+/*
+  HotRows
+  A hot set of a sparse table: its rows are replicated on every server that
+  holds a partition of the table, and this worker sends the requests of the
+  hot row of slot h to replica (h + rank) % #replicas, so that the hottest
+  rows and the workers are spread over the servers.
+  When indexing a request, an id of slot h on replica s becomes the virtual
+  id length + s * capacity + h. These sort after the ids of the partitions
+  and are grouped by replica, so the requests to the replicas are split like
+  those to the partitions.
+*/
+struct HotRows {
+    size_t capacity;
+    // by slot: the id and its row in the (permuted) table
+    std::vector<size_t> ids;
+    std::vector<size_t> rows;
+    // id to its virtual id minus the length of the table
+    std::unordered_map<size_t, size_t> virtual_ids;
+};
+
+/*
+  HotRowState
+  The hot rows of a sparse table on this worker. Every PS_HOT_SYNC_STEPS
+  requests, the deltas pushed to the replicas are moved to the owners of the
+  rows, and the new hot set is installed with the values of the owners, so
+  the replicas lag behind the owners by at most that many steps.
+*/
+struct HotRowState {
+    HotRowState(size_t capacity, size_t rate) :
+        capacity(capacity), counter(rate) {
+    }
+
+    size_t capacity;
+    HotRowCounter counter;
+    size_t steps = 0;
+    // immutable, replaced by each sync, null before the first one
+    std::shared_ptr<const HotRows> rows;
+    std::mutex mu;
+};
+
+} // namespace ps
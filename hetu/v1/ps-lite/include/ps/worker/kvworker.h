@@ -5,6 +5,7 @@
 #include "callback_store.h"
 #include "ps/kvapp.h"
 #include "ps/partitioner.h"
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <fstream>
@@ -27,7 +28,9 @@ public:
      */
     explicit KVWorker(int app_id, int customer_id) : KVApp(app_id) {
         KVAppRegisterHelper<PsfType(0), KVWorker>::init(this);
-        par = new AveragePartitioner(); // now use naive partitioner
+        par = Partitioner::Create();
+        server_loads.reset(
+            new std::atomic<long long>[kLoadFields * par->numServers()]());
     }
 
     ~KVWorker() {
@@ -46,10 +49,25 @@ public:
             logOut << getPSFunctionName(iter->first) << ": " << (iter->second).first
                    << ' ' << (iter->second).second << std::endl;
         }
+        for (size_t i = 0; i < par->numServers(); ++i) {
+            long long counts[kLoadFields];
+            getServerLoads(i, counts);
+            logOut << "server " << i << ": " << counts[0] << ' ' << counts[1]
+                   << ' ' << counts[2] << std::endl;
+        }
         logOut << std::endl;
         loads.clear();
     }
 
+    /**
+     * \brief the #requests sent to a server and the bytes sent to and received
+     *        from it since this worker started, always counted
+     */
+    void getServerLoads(size_t server, long long *out) const {
+        for (size_t i = 0; i < kLoadFields; ++i)
+            out[i] = server_loads[server * kLoadFields + i].load();
+    }
+
     /**
      * \brief Waits until a Request has been finished
      *
@@ -84,11 +102,13 @@ public:
         // Create message
         Message msg;
         tupleEncode(request, msg.data);
-        if (logOut.is_open()) {
-            for (auto x : msg.data) {
-                loads[ftype].first += x.size();
-            }
-        }
+        long long bytes = 0;
+        for (auto x : msg.data)
+            bytes += x.size();
+        if (logOut.is_open())
+            loads[ftype].first += bytes;
+        server_loads[target_server_id * kLoadFields] += 1;
+        server_loads[target_server_id * kLoadFields + 1] += bytes;
         msg.meta.app_id = obj_->app_id();
         msg.meta.customer_id = obj_->customer_id();
         msg.meta.timestamp = timestamp;
@@ -103,11 +123,13 @@ private:
     template <PsfType ftype>
     void onReceive(const Message &msg) {
         typename PSFData<ftype>::Response response;
-        if (logOut.is_open()) {
-            for (auto x : msg.data) {
-                loads[ftype].second += x.size();
-            }
-        }
+        long long bytes = 0;
+        for (auto x : msg.data)
+            bytes += x.size();
+        if (logOut.is_open())
+            loads[ftype].second += bytes;
+        server_loads[Postoffice::IDtoRank(msg.meta.sender) * kLoadFields + 2] +=
+            bytes;
         tupleDecode(response, msg.data);
         int timestamp = msg.meta.timestamp;
         CallbackStore<ftype>::Get()->run(timestamp, response);
@@ -116,6 +138,9 @@ private:
     friend struct KVAppRegisterHelper;
     std::unordered_map<PsfType, std::pair<long long, long long>> loads;
     std::ofstream logOut;
+    /* [server --> requests, bytes sent, bytes received] */
+    static constexpr size_t kLoadFields = 3;
+    std::unique_ptr<std::atomic<long long>[]> server_loads;
 };
 
 } // namespace ps
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "ps/internal/utils.h"
+#include "common/logging.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace ps {
+
+/*
+  SparseIndex
+  The deduplicated indices of one sparse request, in CSR form: ids() holds
+  the distinct ids in ascending order, and the positions of id i in the
+  original index array are positions()[offsets()[i] .. offsets()[i + 1]),
+  in ascending order as well.
+
+  Build() sorts (id, position) pairs with a parallel LSD radix sort, so the
+  cost is linear in the batch and only as many 11-bit passes are made as the
+  largest id needs. The buffers are kept across calls, so that each tensor
+  reuses its own index without reallocating.
+
+  Setting PS_SPARSE_DEDUP=map falls back to the former std::map grouping and
+  single-threaded aggregation and copy-out, for comparison. Build() also
+  groups with the std::map when an id does not fit in 32 bits.
+*/
+class SparseIndex {
+    static constexpr int kRadixBits = 11;
+    static constexpr size_t kRadix = size_t(1) << kRadixBits;
+    static constexpr uint64_t kPositionMask = 0xFFFFFFFFull;
+    // below this many indices the threads cost more than they save
+    static constexpr size_t kParallelGrain = 16384;
+
+public:
+    void Build(const float *dup_index, size_t size) {
+        Build(dup_index, size, [](size_t id) { return id; });
+    }
+
+    // Indexes map(id) instead of each id, `map` is called concurrently.
+    template <typename Map>
+    void Build(const float *dup_index, size_t size, Map map) {
+        _ids.clear();
+        _offsets.assign(1, 0);
+        _positions.resize(size);
+        if (size == 0)
+            return;
+        if (UseMap()) {
+            BuildWithMap(dup_index, size, map);
+            return;
+        }
+        CHECK_LE(size, kPositionMask) << "too many indices in one request";
+        int num_chunks = NumChunks(size);
+
+        // pack (id, position) so that a stable sort on the id keeps the
+        // positions of each id ascending
+        _keys.resize(size);
+        _tmp.resize(size);
+        uint64_t max_id = 0;
+#pragma omp parallel for num_threads(num_chunks) reduction(max : max_id)
+        for (size_t i = 0; i < size; ++i) {
+            uint64_t id = map((size_t)dup_index[i]);
+            _keys[i] = (id << 32) | i;
+            max_id = std::max(max_id, id);
+        }
+        if (max_id > kPositionMask) {
+            // the ids do not fit in the upper half of the keys
+            BuildWithMap(dup_index, size, map);
+            return;
+        }
+        int id_bits = 0;
+        while (id_bits < 32 && (max_id >> id_bits) > 0)
+            ++id_bits;
+        uint64_t *src = _keys.data(), *dst = _tmp.data();
+        for (int shift = 0; shift < id_bits; shift += kRadixBits) {
+            RadixPass(src, dst, size, 32 + shift, num_chunks);
+            std::swap(src, dst);
+        }
+
+        // split into runs of equal ids
+#pragma omp parallel for num_threads(num_chunks)
+        for (size_t i = 0; i < size; ++i)
+            _positions[i] = src[i] & kPositionMask;
+        for (size_t i = 0; i < size; ++i) {
+            size_t id = src[i] >> 32;
+            if (i == 0 || id != _ids.back()) {
+                if (i > 0)
+                    _offsets.push_back(i);
+                _ids.push_back(id);
+            }
+        }
+        _offsets.push_back(size);
+    }
+
+    // Sums the rows of `vals` ([#positions, width]) that share an id into
+    // `out` ([#ids, width]).
+    void Aggregate(const float *vals, size_t width, float *out) const {
+        size_t num_ids = _ids.size();
+        int num_chunks = UseMap() ? 1 : NumChunks(_positions.size());
+#pragma omp parallel for num_threads(num_chunks) schedule(dynamic, 64)
+        for (size_t i = 0; i < num_ids; ++i) {
+            float *row = out + i * width;
+            const float *first = vals + _positions[_offsets[i]] * width;
+            std::copy(first, first + width, row);
+            for (size_t j = _offsets[i] + 1; j < _offsets[i + 1]; ++j) {
+                const float *src = vals + _positions[j] * width;
+                for (size_t k = 0; k < width; ++k)
+                    row[k] += src[k];
+            }
+        }
+    }
+
+    // Copies row i - begin of `rows` to every position of id i in `out`, for
+    // the ids in [begin, end).
+    void Scatter(const float *rows, size_t begin, size_t end, size_t width,
+                 float *out) const {
+        int num_chunks =
+            UseMap() ? 1 : NumChunks(_offsets[end] - _offsets[begin]);
+#pragma omp parallel for num_threads(num_chunks) schedule(dynamic, 64)
+        for (size_t i = begin; i < end; ++i) {
+            const float *row = rows + (i - begin) * width;
+            for (size_t j = _offsets[i]; j < _offsets[i + 1]; ++j)
+                std::copy(row, row + width, out + _positions[j] * width);
+        }
+    }
+
+    // The first distinct id that is no less than `id`.
+    size_t LowerBound(size_t id) const {
+        return std::lower_bound(_ids.begin(), _ids.end(), id) - _ids.begin();
+    }
+
+    size_t size() const {
+        return _ids.size();
+    }
+    const std::vector<size_t> &ids() const {
+        return _ids;
+    }
+    const std::vector<size_t> &offsets() const {
+        return _offsets;
+    }
+    const std::vector<size_t> &positions() const {
+        return _positions;
+    }
+
+private:
+    static bool UseMap() {
+        static const bool use_map =
+            GetEnv("PS_SPARSE_DEDUP", std::string("radix")) == "map";
+        return use_map;
+    }
+
+    static int NumChunks(size_t size) {
+        return (int)std::max<size_t>(
+            1, std::min<size_t>(GetWorkerThreads(), size / kParallelGrain));
+    }
+
+    // One stable counting pass on the digit at `shift`, each chunk
+    // scattering its elements behind those of the previous chunks.
+    void RadixPass(const uint64_t *src, uint64_t *dst, size_t size,
+                   int shift, int num_chunks) {
+        _hist.assign(num_chunks * kRadix, 0);
+#pragma omp parallel for num_threads(num_chunks)
+        for (int c = 0; c < num_chunks; ++c) {
+            size_t *hist = _hist.data() + c * kRadix;
+            for (size_t i = size * c / num_chunks;
+                 i < size * (c + 1) / num_chunks; ++i)
+                ++hist[(src[i] >> shift) & (kRadix - 1)];
+        }
+        size_t sum = 0;
+        for (size_t d = 0; d < kRadix; ++d) {
+            for (int c = 0; c < num_chunks; ++c) {
+                size_t count = _hist[c * kRadix + d];
+                _hist[c * kRadix + d] = sum;
+                sum += count;
+            }
+        }
+#pragma omp parallel for num_threads(num_chunks)
+        for (int c = 0; c < num_chunks; ++c) {
+            size_t *hist = _hist.data() + c * kRadix;
+            for (size_t i = size * c / num_chunks;
+                 i < size * (c + 1) / num_chunks; ++i)
+                dst[hist[(src[i] >> shift) & (kRadix - 1)]++] = src[i];
+        }
+    }
+
+    template <typename Map>
+    void BuildWithMap(const float *dup_index, size_t size, Map map) {
+        std::map<size_t, std::vector<size_t>> idx2map;
+        for (size_t i = 0; i < size; ++i)
+            idx2map[map((size_t)dup_index[i])].emplace_back(i);
+        size_t cur = 0;
+        for (auto &kv : idx2map) {
+            _ids.push_back(kv.first);
+            std::copy(kv.second.begin(), kv.second.end(),
+                      _positions.begin() + cur);
+            cur += kv.second.size();
+            _offsets.push_back(cur);
+        }
+    }
+
+    std::vector<size_t> _ids;
+    std::vector<size_t> _offsets;
+    std::vector<size_t> _positions;
+    // scratch of Build
+    std::vector<uint64_t> _keys;
+    std::vector<uint64_t> _tmp;
+    std::vector<size_t> _hist;
+};
+
+} // namespace ps
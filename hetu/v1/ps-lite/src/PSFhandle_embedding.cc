@@ -19,8 +19,10 @@ void PSHandler<PsfGroup::kParameterServer>::serve(
         << "PushEmbedding updates size mismatch";
     CHECK_EQ(data.size(), rows.size() * width)
         << "PushEmbedding data size mismatch";
-    auto write_lock = value_set.write_guard();
+    auto read_lock = value_set.read_guard();
+#pragma omp parallel for num_threads(GetServerThreads())
     for (size_t i = 0; i < rows.size(); i++) {
+        auto row_lock = value_set.row_guard(rows[i]);
         value_set.ver[rows[i]] += updates[i];
         for (size_t j = 0; j < width; j++)
             value_set[rows[i] * width + j] += data[i * width + j];
@@ -44,22 +46,25 @@ void PSHandler<PsfGroup::kParameterServer>::serve(
         *std::dynamic_pointer_cast<CacheTable<float>>(iter->second);
     size_t width = value_set.width;
     auto read_lock = value_set.read_guard();
-    size_t count = 0;
-    for (size_t i = 0; i < rows.size(); i++)
-        if (ver[i] == -1 || value_set.ver[rows[i]] - ver[i] > bound)
-            count++;
-    idx.resize(count);
-    ret_ver.resize(count);
-    data.resize(count * width);
-    count = 0;
+    // Rows may be pushed concurrently, so select the stale rows once and
+    // copy each selected row with its version under the row lock
+    std::vector<size_t> stale;
     for (size_t i = 0; i < rows.size(); i++) {
-        if (ver[i] == -1 || value_set.ver[rows[i]] - ver[i] > bound) {
-            idx[count] = i;
-            ret_ver[count] = value_set.ver[rows[i]];
-            std::copy(&value_set[rows[i] * width],
-                      &value_set[(rows[i] + 1) * width], &data[count * width]);
-            count++;
-        }
+        auto row_lock = value_set.row_guard(rows[i]);
+        if (ver[i] == -1 || value_set.ver[rows[i]] - ver[i] > bound)
+            stale.push_back(i);
+    }
+    idx.resize(stale.size());
+    ret_ver.resize(stale.size());
+    data.resize(stale.size() * width);
+#pragma omp parallel for num_threads(GetServerThreads())
+    for (size_t count = 0; count < stale.size(); count++) {
+        size_t i = stale[count];
+        auto row_lock = value_set.row_guard(rows[i]);
+        idx[count] = i;
+        ret_ver[count] = value_set.ver[rows[i]];
+        std::copy(&value_set[rows[i] * width],
+                  &value_set[(rows[i] + 1) * width], &data[count * width]);
     }
 }
 
@@ -0,0 +1,86 @@
+#include "ps/server/PSFHandle.h"
+
+namespace ps {
+
+std::shared_ptr<HotReplica>
+PSHandler<PsfGroup::kParameterServer>::hot_replica(Key k, size_t width) {
+    std::lock_guard<std::mutex> lock(hot_mtx);
+    auto iter = hot_store.find(k);
+    if (iter != hot_store.end())
+        return iter->second;
+    CHECK_GT(width, 0) << "hot rows of key " << k << " are not installed";
+    auto replica = std::make_shared<HotReplica>(width);
+    hot_store[k] = replica;
+    return replica;
+}
+
+void PSHandler<PsfGroup::kParameterServer>::serve(
+    const PSFData<kHotPush>::Request &request,
+    PSFData<kHotPush>::Response &response) {
+    Key k = get<0>(request);
+    SArray<size_t> rows = get<1>(request);
+    auto replica = hot_replica(k);
+    CHECK_EQ(replica->width, get<4>(request)) << "width mismatch in HotPush";
+    SArray<float> vals =
+        DecodePush(get<3>(request), get<2>(request),
+                   rows.size() * replica->width, GetServerThreads());
+    replica->Push(rows, vals);
+}
+
+void PSHandler<PsfGroup::kParameterServer>::serve(
+    const PSFData<kHotPull>::Request &request,
+    PSFData<kHotPull>::Response &response) {
+    Key k = get<0>(request);
+    SArray<size_t> rows = get<1>(request);
+    auto replica = hot_replica(k);
+    CHECK_EQ(replica->width, get<2>(request)) << "width mismatch in HotPull";
+    replica->Pull(rows, get<0>(response));
+}
+
+void PSHandler<PsfGroup::kParameterServer>::serve(
+    const PSFData<kHotPushPull>::Request &request,
+    PSFData<kHotPushPull>::Response &response) {
+    Key k = get<0>(request);
+    SArray<size_t> push_rows = get<1>(request);
+    SArray<size_t> pull_rows = get<4>(request);
+    auto replica = hot_replica(k);
+    CHECK_EQ(replica->width, get<5>(request))
+        << "width mismatch in HotPushPull";
+    if (push_rows.size() > 0) {
+        SArray<float> vals =
+            DecodePush(get<3>(request), get<2>(request),
+                       push_rows.size() * replica->width, GetServerThreads());
+        replica->Push(push_rows, vals);
+    }
+    if (pull_rows.size() > 0)
+        replica->Pull(pull_rows, get<0>(response));
+}
+
+void PSHandler<PsfGroup::kParameterServer>::serve(
+    const PSFData<kHotDrain>::Request &request,
+    PSFData<kHotDrain>::Response &response) {
+    Key k = get<0>(request);
+    std::shared_ptr<HotReplica> replica;
+    {
+        std::lock_guard<std::mutex> lock(hot_mtx);
+        auto iter = hot_store.find(k);
+        if (iter != hot_store.end())
+            replica = iter->second;
+    }
+    // nothing was installed here yet
+    if (replica)
+        replica->Drain(get<0>(response), get<1>(response));
+}
+
+void PSHandler<PsfGroup::kParameterServer>::serve(
+    const PSFData<kHotInstall>::Request &request,
+    PSFData<kHotInstall>::Response &response) {
+    Key k = get<0>(request);
+    SArray<size_t> rows = get<1>(request);
+    SArray<float> vals = get<2>(request);
+    if (rows.size() == 0)
+        return;
+    hot_replica(k, vals.size() / rows.size())->Install(rows, vals);
+}
+
+} // namespace ps
@@ -108,6 +108,22 @@ void ClearOnServer(int node_name) {
     worker.clear_on_server(node_name);
 }
 
+/**
+ * \brief change the wire compression of the pushes of a tensor, which is
+ *        PS_PUSH_COMPRESS by default.
+ * \param ctype 0 none, 1 fp16, 2 bf16, 3 int8, 4 top-k
+ * \param ratio the fraction of values kept by top-k
+ */
+void SetPushCompression(int node_name, int ctype, float ratio) {
+    CHECK(ctype >= kNoCompress && ctype <= kTopK)
+        << "unknown compress type " << ctype;
+    CHECK(ratio > 0 && ratio <= 1) << "top-k ratio must be in (0, 1]";
+    PushCompress compress;
+    compress.type = static_cast<CompressType>(ctype);
+    compress.ratio = ratio;
+    PSAgent::Get()->setPushCompress(node_name, compress);
+}
+
 void SaveParam(int node_name, char *address) {
     worker.parameter_save(node_name, address);
 }
@@ -124,6 +140,11 @@ void getLoads() {
     PSAgent::Get()->getLoads();
 }
 
+// fills 3 values per server: #requests, bytes sent and bytes received
+void GetServerLoads(long long *loads) {
+    PSAgent::Get()->getServerLoads(loads);
+}
+
 void ssp_init(Key key, size_t group_size, ssp_version_t tolerance) {
     PSAgent::Get()->SSPInit(key, group_size, tolerance);
 }
@@ -0,0 +1,315 @@
+/**
+ *  Copyright (c) 2015 by Contributors
+ */
+#ifndef PS_SHM_VAN_H_
+#define PS_SHM_VAN_H_
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+namespace ps {
+
+/**
+ * \brief a ring of variable sized blocks in a shared memory segment.
+ *
+ * The segment is created by the receiving node, any co-located sender may
+ * allocate blocks in it under the process-shared mutex. The receiver frees a
+ * block by setting its flag once the received SArray is released, the space
+ * is reclaimed in order by the next allocation.
+ */
+class ShmRing {
+    struct Header {
+        pthread_mutex_t mu;
+        uint64_t capacity;
+        // monotonic byte counters, guarded by mu
+        uint64_t head;
+        uint64_t tail;
+    };
+    struct Block {
+        uint64_t size; // including this header and the padding
+        std::atomic<uint32_t> freed;
+    };
+    static constexpr uint64_t kAlign = 64;
+    static constexpr uint64_t kDataOffset = 4096;
+
+public:
+    static std::string Name(const Node &node) {
+        return "/ps-shm-" + node.hostname + "-" + std::to_string(node.port);
+    }
+
+    /** \brief create the receiving ring of this node */
+    static ShmRing *Create(const std::string &name, uint64_t capacity) {
+        capacity = capacity / kAlign * kAlign;
+        shm_unlink(name.c_str()); // left by a crashed run
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            LOG(WARNING) << "failed to create " << name << ": "
+                         << strerror(errno);
+            return nullptr;
+        }
+        ShmRing *ring = nullptr;
+        if (ftruncate(fd, kDataOffset + capacity) == 0)
+            ring = Map(fd, kDataOffset + capacity);
+        else
+            LOG(WARNING) << "failed to resize " << name << ": "
+                         << strerror(errno);
+        close(fd);
+        if (ring == nullptr)
+            return nullptr;
+        Header *header = ring->header_;
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&header->mu, &attr);
+        pthread_mutexattr_destroy(&attr);
+        header->capacity = capacity;
+        header->head = header->tail = 0;
+        ring->name_ = name;
+        return ring;
+    }
+
+    /** \brief open the ring of a co-located node, nullptr if it has none */
+    static ShmRing *Open(const std::string &name) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            return nullptr;
+        struct stat st;
+        ShmRing *ring = nullptr;
+        if (fstat(fd, &st) == 0 && st.st_size > (off_t)kDataOffset)
+            ring = Map(fd, st.st_size);
+        close(fd);
+        return ring;
+    }
+
+    /** \brief remove the segment, mappings stay valid until unmapped */
+    void Unlink() {
+        if (!name_.empty())
+            shm_unlink(name_.c_str());
+        name_.clear();
+    }
+
+    void Unmap() {
+        munmap(header_, size_);
+        header_ = nullptr;
+    }
+
+    /**
+     * \brief reserve `size` bytes
+     * \return the offset of the bytes in the segment, 0 if the ring is full
+     */
+    uint64_t Alloc(size_t size) {
+        uint64_t need = (sizeof(Block) + size + kAlign - 1) / kAlign * kAlign;
+        uint64_t capacity = header_->capacity;
+        if (need > capacity)
+            return 0;
+        pthread_mutex_lock(&header_->mu);
+        uint64_t &head = header_->head, &tail = header_->tail;
+        while (tail < head) {
+            Block *block = BlockAt(tail);
+            if (!block->freed.load(std::memory_order_acquire))
+                break;
+            tail += block->size;
+        }
+        // a block never wraps around, skip the end of the ring instead
+        uint64_t pad = head % capacity + need > capacity
+                           ? capacity - head % capacity
+                           : 0;
+        uint64_t offset = 0;
+        if (capacity - (head - tail) >= pad + need) {
+            if (pad > 0) {
+                NewBlock(head, pad, true);
+                head += pad;
+            }
+            offset = kDataOffset + head % capacity + sizeof(Block);
+            NewBlock(head, need, false);
+            head += need;
+        }
+        pthread_mutex_unlock(&header_->mu);
+        return offset;
+    }
+
+    /** \brief release the block at `offset`, called by the receiver */
+    void Free(uint64_t offset) {
+        Block *block = reinterpret_cast<Block *>(base() + offset
+                                                 - sizeof(Block));
+        block->freed.store(1, std::memory_order_release);
+    }
+
+    char *base() {
+        return reinterpret_cast<char *>(header_);
+    }
+
+private:
+    static ShmRing *Map(int fd, size_t size) {
+        void *addr =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            LOG(WARNING) << "failed to map shared memory: " << strerror(errno);
+            return nullptr;
+        }
+        ShmRing *ring = new ShmRing();
+        ring->header_ = static_cast<Header *>(addr);
+        ring->size_ = size;
+        return ring;
+    }
+
+    Block *BlockAt(uint64_t pos) {
+        return reinterpret_cast<Block *>(base() + kDataOffset
+                                         + pos % header_->capacity);
+    }
+
+    void NewBlock(uint64_t pos, uint64_t size, bool freed) {
+        Block *block = BlockAt(pos);
+        block->size = size;
+        block->freed.store(freed, std::memory_order_relaxed);
+    }
+
+    Header *header_ = nullptr;
+    size_t size_ = 0;
+    std::string name_;
+};
+
+/**
+ * \brief ZMQ van that passes large payloads of co-located nodes through
+ * shared memory.
+ *
+ * Every worker and server creates a ring in a shared memory segment to
+ * receive data. A sender on the same host copies each payload of at least
+ * PS_SHM_MIN_BYTES into the ring of the receiver, and only sends the meta and
+ * a small descriptor of the payloads through ZMQ. The receiver hands out
+ * zero-copy SArray views of the ring, whose blocks are freed once released.
+ * Payloads to other hosts, or which do not fit in the ring at the moment, go
+ * inline through ZMQ. The ring is PS_SHM_SIZE_MB (256 by default) large.
+ */
+class SHMVan : public ZMQVan {
+    // the first data frame of a message holds a pair of uint64 per payload:
+    // (size, offset in the receiver's ring or kInline)
+    static constexpr uint64_t kInline = ~0ull;
+
+public:
+    SHMVan() {
+    }
+    virtual ~SHMVan() {
+    }
+
+protected:
+    void Stop() override {
+        ZMQVan::Stop();
+        std::lock_guard<std::mutex> lk(shm_mu_);
+        for (auto &it : peers_) {
+            it.second->Unmap();
+            delete it.second;
+        }
+        peers_.clear();
+        // arrays received from the ring may outlive the van, so keep it
+        // mapped and only remove the name
+        if (ring_ != nullptr)
+            ring_->Unlink();
+    }
+
+    int Bind(const Node &node, int max_retry) override {
+        int port = ZMQVan::Bind(node, max_retry);
+        if (port != -1 && node.role != Node::SCHEDULER) {
+            Node bound = node;
+            bound.port = port;
+            uint64_t capacity = (uint64_t)GetEnv("PS_SHM_SIZE_MB", 256) << 20;
+            ring_ = ShmRing::Create(ShmRing::Name(bound), capacity);
+        }
+        return port;
+    }
+
+    void Connect(const Node &node) override {
+        ZMQVan::Connect(node);
+        if (node.role == Node::SCHEDULER || node.role == my_node_.role
+            || node.hostname != my_node_.hostname)
+            return;
+        ShmRing *ring = ShmRing::Open(ShmRing::Name(node));
+        std::lock_guard<std::mutex> lk(shm_mu_);
+        auto it = peers_.find(node.id);
+        if (it != peers_.end()) {
+            it->second->Unmap();
+            delete it->second;
+            peers_.erase(it);
+        }
+        if (ring != nullptr)
+            peers_[node.id] = ring;
+    }
+
+    int SendMsg(const Message &msg) override {
+        size_t n = msg.data.size();
+        if (n == 0)
+            return ZMQVan::SendMsg(msg);
+        ShmRing *ring = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(shm_mu_);
+            auto it = peers_.find(msg.meta.recver);
+            if (it != peers_.end())
+                ring = it->second;
+        }
+        static const size_t min_bytes = GetEnv("PS_SHM_MIN_BYTES", 4096);
+        Message out;
+        out.meta = msg.meta;
+        SArray<uint64_t> desc(2 * n);
+        int shm_bytes = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const SArray<char> &data = msg.data[i];
+            uint64_t offset = 0;
+            if (ring != nullptr && data.size() >= min_bytes)
+                offset = ring->Alloc(data.size());
+            if (offset != 0) {
+                memcpy(ring->base() + offset, data.data(), data.size());
+                shm_bytes += data.size();
+            } else {
+                offset = kInline;
+                out.data.push_back(data);
+            }
+            desc[2 * i] = data.size();
+            desc[2 * i + 1] = offset;
+        }
+        out.data.insert(out.data.begin(), SArray<char>(desc));
+        int send_bytes = ZMQVan::SendMsg(out);
+        return send_bytes < 0 ? send_bytes : send_bytes + shm_bytes;
+    }
+
+    int RecvMsg(Message *msg) override {
+        int recv_bytes = ZMQVan::RecvMsg(msg);
+        if (recv_bytes < 0 || msg->data.empty())
+            return recv_bytes;
+        SArray<uint64_t> desc(msg->data[0]);
+        CHECK_EQ(desc.size() % 2, 0);
+        std::vector<SArray<char>> data;
+        size_t next_inline = 1;
+        for (size_t i = 0; i < desc.size(); i += 2) {
+            uint64_t size = desc[i], offset = desc[i + 1];
+            if (offset == kInline) {
+                CHECK_LT(next_inline, msg->data.size());
+                data.push_back(msg->data[next_inline++]);
+                continue;
+            }
+            CHECK(ring_ != nullptr) << "received shared memory without a ring";
+            ShmRing *ring = ring_;
+            SArray<char> view;
+            view.reset(ring->base() + offset, size,
+                       [ring, offset](char *) { ring->Free(offset); });
+            data.push_back(view);
+            recv_bytes += size;
+        }
+        msg->data = std::move(data);
+        return recv_bytes;
+    }
+
+private:
+    /** \brief the ring receiving from co-located nodes */
+    ShmRing *ring_ = nullptr;
+    /** \brief node_id to the ring of this co-located node */
+    std::unordered_map<int, ShmRing *> peers_;
+    std::mutex shm_mu_;
+};
+} // namespace ps
+
+#endif // PS_SHM_VAN_H_
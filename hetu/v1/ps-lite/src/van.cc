@@ -17,6 +17,7 @@
 #include "./resender.h"
 #include "./zmq_van.h"
 #include "./p3_van.h"
+#include "./shm_van.h"
 
 namespace ps {
 
@@ -31,6 +32,8 @@ Van *Van::Create(const std::string &type) {
         return new ZMQVan();
     } else if (type == "p3") {
         return new P3Van();
+    } else if (type == "shm") {
+        return new SHMVan();
 #ifdef DMLC_USE_IBVERBS
     } else if (type == "ibverbs") {
         return new IBVerbsVan();
@@ -13,22 +13,28 @@ from functools import partial
         limit: the max number of embedding lines stored in cache
         node_id: the unique node_id in the model
         policy: cache policy, LRU or LFU
+        num_shards: the cache is split into independently locked shards by
+            key hash, each running the policy on its part of the limit, one
+            shard (the default) keeps the exact policy over the whole cache
 """
 
 
 class CacheSparseTable:
-    def __init__(self, limit, length, width, node_id, policy="LRU", bound=100):
+    def __init__(self, limit, length, width, node_id, policy="LRU", bound=100, num_shards=1):
         # make sure we open libps.so first
         comm = get_worker_communicate()
         sys.path.append(os.path.dirname(__file__)+"/../../build/lib")
         import hetu_cache
         policy = policy.lower()
         if policy == "lru":
-            self.cache = hetu_cache.LRUCache(limit, length, width, node_id)
+            self.cache = hetu_cache.LRUCache(
+                limit, length, width, node_id, num_shards)
         elif policy == "lfu":
-            self.cache = hetu_cache.LFUCache(limit, length, width, node_id)
+            self.cache = hetu_cache.LFUCache(
+                limit, length, width, node_id, num_shards)
         elif policy == "lfuopt":
-            self.cache = hetu_cache.LFUOptCache(limit, length, width, node_id)
+            self.cache = hetu_cache.LFUOptCache(
+                limit, length, width, node_id, num_shards)
         else:
             raise NotImplementedError(policy)
         self.cache.pull_bound = bound
@@ -63,6 +69,28 @@ class CacheSparseTable:
             wait.wait()
         else:
             return wait
+    """
+        embedding_prefetch:
+            keys: the keys of an upcoming batch
+            pulls them into the cache while the current batch trains,
+            the same rules for sync and keys lifetime as embedding_lookup apply
+    """
+
+    def embedding_prefetch(self, keys, sync=False):
+        wait = None
+        if type(keys) is np.ndarray:
+            assert keys.dtype == np.uint64
+            wait = self.cache.embedding_prefetch(keys)
+        elif type(keys) is ndarray.NDArray:
+            assert not ndarray.is_gpu_ctx(keys.ctx)
+            wait = self.cache.embedding_prefetch_raw(
+                keys.handle.contents.data, np.prod(keys.shape))
+        else:
+            raise TypeError
+        if sync:
+            wait.wait()
+        else:
+            return wait
     """
         embedding_lookup:
             keys: a list of keys to update
@@ -123,6 +151,10 @@ class CacheSparseTable:
     def limit(self):
         return self.cache.limit
 
+    @property
+    def num_shards(self):
+        return self.cache.num_shards
+
     def perf_enabled(self, enable=True):
         self.cache.perf_enabled = enable
 
@@ -4,6 +4,8 @@
 #include "binding.h"
 #include "common/sarray.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <future>
 #include <vector>
 using std::vector;
@@ -12,9 +14,42 @@ namespace hetu {
 
 typedef std::shared_future<void> wait_t;
 
+// Threads to visit the shards and to copy or accumulate rows, read from
+// PS_WORKER_THREADS as the sparse operations of the worker
+inline int getCacheThreads() {
+    static const int num_threads = [] {
+        const char *val = getenv("PS_WORKER_THREADS");
+        return val ? std::max(atoi(val), 1) : 4;
+    }();
+    return num_threads;
+}
+
+/*
+  CachePolicy:
+    CachePolicy is the Base class of all cache Policy, one instance manages
+    one shard of a cache and is not thread-safe by itself
+    args:
+      limit: the number of embedding in this shard will not exceed limit
+*/
+class CachePolicy {
+protected:
+    size_t limit_, width_;
+    // evicted embeddings with pending updates, to be pushed
+    vector<EmbeddingPT> evict_;
+
+public:
+    CachePolicy(size_t limit, size_t width) : limit_(limit), width_(width) {
+    }
+    vector<EmbeddingPT> takeEvicted() {
+        vector<EmbeddingPT> result;
+        result.swap(evict_);
+        return result;
+    }
+}; // class CachePolicy
+
 /*
   CacheBase:
-    CacheBase is the Base class of all cache Policy
+    CacheBase is the Base class of all caches, see ShardedCache
     args:
       limit: the number of embedding will not exceed limit
 */
@@ -26,8 +61,7 @@ protected:
     version_t push_bound_ = 5;
     int node_id_;
     bool bypass_cache_ = false;
-    vector<EmbeddingPT> evict_;
-    std::mutex mtx;
+    shared_ptr<EmbeddingArena> arena_;
     bool perf_enabled_ = false;
     py::list perf_;
 
@@ -50,10 +84,14 @@ public:
     virtual int count(cache_key_t k) = 0;
     virtual void insert(EmbeddingPT e) = 0;
     virtual EmbeddingPT lookup(cache_key_t k) = 0;
+    virtual size_t numShards() = 0;
     //------------------------- implement tools ---------------------
     // Used to lookup/insert many keys together
-    vector<EmbeddingPT> batchedLookup(const cache_key_t *, size_t len);
-    void batchedInsert(vector<EmbeddingPT> &ptrs);
+    virtual vector<EmbeddingPT> batchedLookup(const cache_key_t *,
+                                              size_t len) = 0;
+    virtual void batchedInsert(vector<EmbeddingPT> &ptrs) = 0;
+    // Evicted embeddings with pending updates of all shards, sorted by key
+    virtual vector<EmbeddingPT> takeEvicted() = 0;
     //------------------------- implement main python API ---------------------
     version_t getPullBound() {
         return pull_bound_;
@@ -64,6 +102,13 @@ public:
     size_t getWidth() {
         return width_;
     }
+    // Bytes of the embedding rows and grads held by this cache
+    size_t getMemoryUsage() {
+        return arena_->bytesInUse();
+    }
+    size_t getMemoryReserved() {
+        return arena_->bytesReserved();
+    }
     void setPullBound(version_t bound) {
         pull_bound_ = bound;
     }
@@ -90,11 +135,18 @@ public:
     wait_t embeddingLookup(py::array_t<cache_key_t> keys,
                            py::array_t<embed_t> dest);
     wait_t embeddingLookupRaw(uint64_t _keys, uint64_t dest, size_t num_keys);
+    // with a null dest, only brings the keys into the cache
     void _embeddingLookup(SArray<cache_key_t> keys, embed_t *dest);
     wait_t embeddingUpdate(py::array_t<cache_key_t> keys,
                            py::array_t<embed_t> grads);
     wait_t embeddingUpdateRaw(uint64_t _keys, uint64_t grads, size_t num_keys);
     void _embeddingUpdate(SArray<cache_key_t> keys, const embed_t *grads);
+    /*
+      embeddingPrefetch pulls the keys of an upcoming batch into the cache
+      while the current batch trains, so that its embeddingLookup hits
+    */
+    wait_t embeddingPrefetch(py::array_t<cache_key_t> keys);
+    wait_t embeddingPrefetchRaw(uint64_t _keys, size_t num_keys);
     wait_t embeddingPushPullRaw(uint64_t _pullkeys, uint64_t _dest,
                                 size_t num_pull_keys, uint64_t _pushkeys,
                                 uint64_t _grads, size_t num_push_keys);
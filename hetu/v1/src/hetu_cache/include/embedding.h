@@ -4,6 +4,7 @@
 #include <memory>
 #include <sstream>
 #include "binding.h"
+#include "line_arena.h"
 
 using std::default_delete;
 using std::make_shared;
@@ -24,11 +25,25 @@ private:
     const cache_key_t key_;
     T *data_;
     T *grad_;
+    // Lines created by a cache take their data and grad from its arena
+    const shared_ptr<LineArena<T>> arena_;
+
+    T *_alloc() {
+        return arena_ ? arena_->allocate() : new T[len_]();
+    }
+    void _free(T *ptr) {
+        if (!ptr)
+            return;
+        if (arena_)
+            arena_->deallocate(ptr);
+        else
+            delete[] ptr;
+    }
 
 public:
     typedef T dtype;
     Line(cache_key_t key, const T *in_vec, size_t len) : len_(len), key_(key) {
-        data_ = new T[len]();
+        data_ = _alloc();
         grad_ = nullptr;
         std::copy(in_vec, in_vec + len, data_);
         updates_ = 0;
@@ -36,15 +51,23 @@ public:
     }
     Line(cache_key_t key, size_t len, bool init_data = true) :
         len_(len), key_(key) {
-        data_ = init_data ? new T[len]() : nullptr;
+        data_ = init_data ? _alloc() : nullptr;
+        grad_ = nullptr;
+        updates_ = 0;
+        version_ = -1;
+    }
+    Line(cache_key_t key, shared_ptr<LineArena<T>> arena,
+         bool init_data = true) :
+        len_(arena->width()), key_(key), arena_(std::move(arena)) {
+        data_ = init_data ? _alloc() : nullptr;
         grad_ = nullptr;
         updates_ = 0;
         version_ = -1;
     }
     Line(const Line &other) = delete;
     ~Line() {
-        delete[] data_;
-        delete[] grad_;
+        _free(data_);
+        _free(grad_);
     }
     //-------------------------- setter getter ---------------------------------
     T &operator[](size_t i) {
@@ -119,7 +142,7 @@ public:
 
     void _maybeInitGrad() {
         if (grad_ == nullptr)
-            grad_ = new T[len_]();
+            grad_ = _alloc();
     }
 
     //------------------------ python api starts here ------------------------
@@ -153,6 +176,8 @@ typedef float embed_t;
 typedef Line<embed_t> Embedding;
 // EmbeddingPT is the smart pointer type of Embedding
 typedef shared_ptr<Embedding> EmbeddingPT;
+// EmbeddingArena stores the embeddings of a cache
+typedef LineArena<embed_t> EmbeddingArena;
 
 // Factory function
 EmbeddingPT makeEmbedding(cache_key_t, version_t, py::array_t<embed_t>);
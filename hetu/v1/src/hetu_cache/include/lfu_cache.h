@@ -1,20 +1,20 @@
 #pragma once
 
-#include "cache.h"
+#include "sharded_cache.h"
+#include "open_hash_map.h"
 
 #include <list>
-#include <unordered_map>
 
 namespace hetu {
 
 /*
-  LFUCache:
+  LFUPolicy:
     use LFU policy
     Implemented with hashmap and a 2-D list ordered by frequency
     O(1) insert and lookup
 */
 
-class LFUCache : public CacheBase {
+class LFUPolicy : public CachePolicy {
 private:
     struct CountList;
     struct Block {
@@ -26,7 +26,7 @@ private:
         size_t use;
     };
     std::list<CountList> list_;
-    std::unordered_map<cache_key_t, std::list<Block>::iterator> hash_;
+    OpenHashMap<cache_key_t, std::list<Block>::iterator> hash_;
 
     // helper function
     std::list<Block>::iterator _increase(std::list<Block>::iterator);
@@ -34,16 +34,16 @@ private:
     void _evict();
 
 public:
-    using CacheBase::CacheBase;
-    size_t size() final {
+    using CachePolicy::CachePolicy;
+    size_t size() {
         return hash_.size();
     }
-    int count(cache_key_t k) final;
-    void insert(EmbeddingPT e) final;
-    EmbeddingPT lookup(cache_key_t k) final;
+    int count(cache_key_t k);
+    void insert(EmbeddingPT e);
+    EmbeddingPT lookup(cache_key_t k);
+    void keys(vector<cache_key_t> &keys);
+}; // class LFUPolicy
 
-    // python debug function
-    py::array_t<cache_key_t> PyAPI_keys();
-}; // class LFUCache
+typedef ShardedCache<LFUPolicy> LFUCache;
 
 } // namespace hetu
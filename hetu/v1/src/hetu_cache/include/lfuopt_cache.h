@@ -1,21 +1,20 @@
 #pragma once
 
-#include "cache.h"
+#include "sharded_cache.h"
+#include "open_hash_map.h"
 
 #include <list>
-#include <unordered_map>
-#include <map>
 
 namespace hetu {
 
 /*
-  LFUOptCache:
+  LFUOptPolicy:
     use LFU policy, move to permanent store when freq reach n
     Implemented with hashmap and a 2-D list ordered by frequency
     O(1) insert and lookup
 */
 
-class LFUOptCache : public CacheBase {
+class LFUOptPolicy : public CachePolicy {
 private:
     struct Block {
         EmbeddingPT ptr;
@@ -24,26 +23,26 @@ private:
     typedef std::list<Block> CountList;
     const static int kUseCntMax = 10;
     CountList clist[kUseCntMax];
-    std::unordered_map<cache_key_t, std::list<Block>::iterator> hash_;
+    OpenHashMap<cache_key_t, std::list<Block>::iterator> hash_;
 
     // helper function
     std::list<Block>::iterator _increase(std::list<Block>::iterator);
     std::list<Block>::iterator _create(EmbeddingPT);
     void _evict();
 
-    std::unordered_map<cache_key_t, EmbeddingPT> store_;
+    OpenHashMap<cache_key_t, EmbeddingPT> store_;
 
 public:
-    using CacheBase::CacheBase;
-    size_t size() final {
+    using CachePolicy::CachePolicy;
+    size_t size() {
         return store_.size() + hash_.size();
     }
-    int count(cache_key_t k) final;
-    void insert(EmbeddingPT e) final;
-    EmbeddingPT lookup(cache_key_t k) final;
+    int count(cache_key_t k);
+    void insert(EmbeddingPT e);
+    EmbeddingPT lookup(cache_key_t k);
+    void keys(vector<cache_key_t> &keys);
+}; // class LFUOptPolicy
 
-    // python debug function
-    py::array_t<cache_key_t> PyAPI_keys();
-}; // class LFUCache
+typedef ShardedCache<LFUOptPolicy> LFUOptCache;
 
 } // namespace hetu
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace hetu {
+
+/*
+  LineArena:
+    slab allocator for cache lines of a fixed width
+    Rows are carved out of large slabs (about one huge page each) in slots
+    padded to a cache line, so that millions of cached rows stay contiguous
+    instead of being scattered over the heap. Released slots are recycled
+    LIFO so that the next allocation reuses a warm slot.
+    args:
+      width: number of elements of each line
+*/
+template <typename T>
+class LineArena {
+private:
+    const static size_t kAlignment = 64;
+    const static size_t kSlabBytes = 2 << 20;
+
+    const size_t width_;
+    const size_t stride_;
+    const size_t slots_per_slab_;
+    std::vector<T *> slabs_;
+    std::vector<T *> free_;
+    size_t in_use_ = 0;
+    std::mutex mtx_;
+
+    void _newSlab() {
+        size_t bytes = stride_ * slots_per_slab_;
+        void *ptr = nullptr;
+        if (posix_memalign(&ptr, kAlignment, bytes) != 0)
+            throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        if (bytes >= kSlabBytes)
+            madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+        T *slab = static_cast<T *>(ptr);
+        slabs_.push_back(slab);
+        // Pushed in reverse so that slots are handed out in address order
+        size_t elems = stride_ / sizeof(T);
+        for (size_t i = slots_per_slab_; i > 0; i--)
+            free_.push_back(slab + (i - 1) * elems);
+    }
+
+public:
+    explicit LineArena(size_t width) :
+        width_(width),
+        stride_((width * sizeof(T) + kAlignment - 1) / kAlignment
+                * kAlignment),
+        slots_per_slab_(std::max<size_t>(1, kSlabBytes / stride_)) {
+    }
+    LineArena(const LineArena &other) = delete;
+    ~LineArena() {
+        for (auto slab : slabs_)
+            free(slab);
+    }
+
+    // Returns a zero-initialized slot of `width` elements
+    T *allocate() {
+        T *ptr;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (free_.empty())
+                _newSlab();
+            ptr = free_.back();
+            free_.pop_back();
+            in_use_++;
+        }
+        std::fill(ptr, ptr + width_, T());
+        return ptr;
+    }
+
+    void deallocate(T *ptr) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        free_.push_back(ptr);
+        in_use_--;
+    }
+
+    //-------------------------- memory accounting -----------------------------
+    size_t width() const {
+        return width_;
+    }
+    size_t slotsInUse() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return in_use_;
+    }
+    size_t bytesInUse() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return in_use_ * stride_;
+    }
+    size_t bytesReserved() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return slabs_.size() * slots_per_slab_ * stride_;
+    }
+}; // class LineArena
+
+} // namespace hetu
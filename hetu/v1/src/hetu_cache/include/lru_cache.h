@@ -1,35 +1,47 @@
 #pragma once
 
-#include "cache.h"
-
-#include <list>
-#include <unordered_map>
+#include "sharded_cache.h"
+#include "open_hash_map.h"
 
 namespace hetu {
 
 /*
-  LRUCache:
+  LRUPolicy:
     use LRU policy
     Implemented with a double-linked list and a hash map
+    The list nodes live in a flat pool linked by indices and the hash map
+    uses open addressing, so no memory is allocated per cached line.
     O(1) insert, lookup
 */
 
-class LRUCache : public CacheBase {
+class LRUPolicy : public CachePolicy {
 private:
-    std::unordered_map<cache_key_t, std::list<EmbeddingPT>::iterator> hash_;
-    std::list<EmbeddingPT> list_;
+    typedef uint32_t node_t;
+    struct Node {
+        EmbeddingPT ptr;
+        node_t prev, next;
+    };
+    // nodes_[0] is the sentinel, its next is the most recently used
+    vector<Node> nodes_;
+    vector<node_t> free_nodes_;
+    OpenHashMap<cache_key_t, node_t> hash_;
+
+    // helper function
+    void _unlink(node_t n);
+    void _pushFront(node_t n);
+    node_t _newNode(EmbeddingPT e);
 
 public:
-    using CacheBase::CacheBase;
-    size_t size() final {
+    LRUPolicy(size_t limit, size_t width);
+    size_t size() {
         return hash_.size();
     }
-    int count(cache_key_t k) final;
-    void insert(EmbeddingPT e) final;
-    EmbeddingPT lookup(cache_key_t k) final;
+    int count(cache_key_t k);
+    void insert(EmbeddingPT e);
+    EmbeddingPT lookup(cache_key_t k);
+    void keys(vector<cache_key_t> &keys);
+}; // class LRUPolicy
 
-    // python debug function
-    py::array_t<cache_key_t> PyAPI_keys();
-}; // class LRUCache
+typedef ShardedCache<LRUPolicy> LRUCache;
 
 } // namespace hetu
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace hetu {
+
+/*
+  OpenHashMap:
+    hash map from integer keys to small values with open addressing
+    Linear probing over a flat power-of-two bucket array and backward-shift
+    deletion (no tombstones), so a lookup touches one or two cache lines
+    and no node is allocated per entry.
+    Pointers returned by find are invalidated by insertion and erasure.
+*/
+template <typename K, typename V>
+class OpenHashMap {
+private:
+    struct Bucket {
+        K key;
+        V value;
+        bool used;
+    };
+    std::vector<Bucket> buckets_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+
+    size_t _slot(const K &k) const {
+        // Fibonacci hashing, keys are usually consecutive integers
+        return (static_cast<uint64_t>(k) * 0x9E3779B97F4A7C15ULL) >> 20
+               & mask_;
+    }
+
+    size_t _probe(const K &k) const {
+        size_t i = _slot(k);
+        while (buckets_[i].used && buckets_[i].key != k)
+            i = (i + 1) & mask_;
+        return i;
+    }
+
+    void _rehash(size_t capacity) {
+        std::vector<Bucket> old(capacity, Bucket{K(), V(), false});
+        old.swap(buckets_);
+        mask_ = capacity - 1;
+        for (auto &b : old) {
+            if (b.used) {
+                size_t i = _probe(b.key);
+                buckets_[i].key = b.key;
+                buckets_[i].value = std::move(b.value);
+                buckets_[i].used = true;
+            }
+        }
+    }
+
+public:
+    explicit OpenHashMap(size_t capacity = 0) {
+        reserve(capacity);
+    }
+
+    // Keeps the load factor under 1/2 for up to n entries
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity < 2 * n)
+            capacity <<= 1;
+        if (capacity > buckets_.size())
+            _rehash(capacity);
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    size_t count(const K &k) const {
+        return buckets_[_probe(k)].used ? 1 : 0;
+    }
+
+    V *find(const K &k) {
+        auto &b = buckets_[_probe(k)];
+        return b.used ? &b.value : nullptr;
+    }
+
+    V &operator[](const K &k) {
+        size_t i = _probe(k);
+        if (!buckets_[i].used) {
+            if (2 * (size_ + 1) > buckets_.size()) {
+                _rehash(buckets_.size() * 2);
+                i = _probe(k);
+            }
+            buckets_[i] = {k, V(), true};
+            size_++;
+        }
+        return buckets_[i].value;
+    }
+
+    bool erase(const K &k) {
+        size_t i = _probe(k);
+        if (!buckets_[i].used)
+            return false;
+        // Shift back the following entries of the probe chain into the hole
+        for (size_t j = (i + 1) & mask_; buckets_[j].used;
+             j = (j + 1) & mask_) {
+            size_t home = _slot(buckets_[j].key);
+            if (((j - home) & mask_) >= ((j - i) & mask_)) {
+                buckets_[i] = std::move(buckets_[j]);
+                i = j;
+            }
+        }
+        buckets_[i].used = false;
+        buckets_[i].value = V();
+        size_--;
+        return true;
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (auto &b : buckets_)
+            if (b.used)
+                f(b.key, b.value);
+    }
+
+    size_t memoryUsage() const {
+        return buckets_.size() * sizeof(Bucket);
+    }
+}; // class OpenHashMap
+
+} // namespace hetu
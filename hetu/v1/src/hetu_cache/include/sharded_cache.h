@@ -0,0 +1,151 @@
+#pragma once
+
+#include "cache.h"
+
+#include <memory>
+#include <mutex>
+
+namespace hetu {
+
+/*
+  ShardedCache:
+    splits a cache into independently locked shards by key hash, each shard
+    running its own Policy (a CachePolicy) over a part of the limit
+    Batched lookups and inserts lock each shard once and visit the shards in
+    parallel, keys of the same shard keep their order.
+    args:
+      num_shards: number of shards, one shard gives the exact policy
+*/
+template <typename Policy>
+class ShardedCache : public CacheBase {
+private:
+    struct Shard {
+        std::mutex mtx;
+        Policy policy;
+        Shard(size_t limit, size_t width) : policy(limit, width) {
+        }
+    };
+    vector<std::unique_ptr<Shard>> shards_;
+
+    size_t _shardOf(cache_key_t k) const {
+        return ((k * 0x9E3779B97F4A7C15ULL) >> 32) % shards_.size();
+    }
+
+    // indices of keys grouped by shard, in order within a shard
+    void _groupByShard(const cache_key_t *keys, size_t len,
+                       vector<size_t> &offsets, vector<size_t> &order) {
+        size_t n = shards_.size();
+        vector<size_t> shard_of(len);
+        offsets.assign(n + 1, 0);
+        for (size_t i = 0; i < len; i++) {
+            shard_of[i] = _shardOf(keys[i]);
+            offsets[shard_of[i] + 1]++;
+        }
+        for (size_t s = 0; s < n; s++)
+            offsets[s + 1] += offsets[s];
+        order.resize(len);
+        vector<size_t> cur(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < len; i++)
+            order[cur[shard_of[i]]++] = i;
+    }
+
+    int _numThreads() const {
+        return std::min<int>(getCacheThreads(), shards_.size());
+    }
+
+public:
+    ShardedCache(size_t limit, size_t len, size_t width, int node_id,
+                 size_t num_shards = 1) :
+        CacheBase(limit, len, width, node_id) {
+        num_shards = std::max<size_t>(1, std::min(num_shards, limit));
+        for (size_t i = 0; i < num_shards; i++)
+            shards_.emplace_back(new Shard(
+                limit / num_shards + (i < limit % num_shards), width));
+    }
+
+    size_t numShards() final {
+        return shards_.size();
+    }
+    size_t size() final {
+        size_t result = 0;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            result += shard->policy.size();
+        }
+        return result;
+    }
+    int count(cache_key_t k) final {
+        Shard &shard = *shards_[_shardOf(k)];
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        return shard.policy.count(k);
+    }
+    void insert(EmbeddingPT e) final {
+        Shard &shard = *shards_[_shardOf(e->key())];
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.policy.insert(e);
+    }
+    EmbeddingPT lookup(cache_key_t k) final {
+        Shard &shard = *shards_[_shardOf(k)];
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        return shard.policy.lookup(k);
+    }
+
+    vector<EmbeddingPT> batchedLookup(const cache_key_t *keys,
+                                      size_t len) final {
+        vector<EmbeddingPT> result(len);
+        if (bypass_cache_)
+            return result;
+        vector<size_t> offsets, order;
+        _groupByShard(keys, len, offsets, order);
+#pragma omp parallel for num_threads(_numThreads()) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards_.size(); s++) {
+            std::lock_guard<std::mutex> lock(shards_[s]->mtx);
+            for (size_t j = offsets[s]; j < offsets[s + 1]; j++)
+                result[order[j]] = shards_[s]->policy.lookup(keys[order[j]]);
+        }
+        return result;
+    }
+
+    void batchedInsert(vector<EmbeddingPT> &ptrs) final {
+        if (bypass_cache_)
+            return;
+        vector<cache_key_t> keys(ptrs.size());
+        for (size_t i = 0; i < ptrs.size(); i++)
+            keys[i] = ptrs[i]->key();
+        vector<size_t> offsets, order;
+        _groupByShard(keys.data(), keys.size(), offsets, order);
+#pragma omp parallel for num_threads(_numThreads()) schedule(dynamic, 1)
+        for (size_t s = 0; s < shards_.size(); s++) {
+            std::lock_guard<std::mutex> lock(shards_[s]->mtx);
+            for (size_t j = offsets[s]; j < offsets[s + 1]; j++)
+                shards_[s]->policy.insert(ptrs[order[j]]);
+        }
+    }
+
+    vector<EmbeddingPT> takeEvicted() final {
+        vector<EmbeddingPT> result;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            auto evicted = shard->policy.takeEvicted();
+            result.insert(result.end(), evicted.begin(), evicted.end());
+        }
+        std::sort(result.begin(), result.end(),
+                  [](const EmbeddingPT &a, const EmbeddingPT &b) {
+                      return a->key() < b->key();
+                  });
+        return result;
+    }
+
+    // python debug function
+    py::array_t<cache_key_t> PyAPI_keys() {
+        std::vector<cache_key_t> keys;
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            shard->policy.keys(keys);
+        }
+        std::sort(keys.begin(), keys.end());
+        return bind::vec(keys);
+    }
+}; // class ShardedCache
+
+} // namespace hetu
@@ -12,9 +12,10 @@ std::vector<size_t> argsort(const T *array, size_t num) {
     for (size_t i = 0; i < num; ++i)
         array_index[i] = i;
 
-    std::sort(
-        array_index.begin(), array_index.end(),
-        [array](int pos1, int pos2) { return (array[pos1] < array[pos2]); });
+    std::stable_sort(array_index.begin(), array_index.end(),
+                     [array](size_t pos1, size_t pos2) {
+                         return (array[pos1] < array[pos2]);
+                     });
 
     return array_index;
 }
@@ -22,7 +23,8 @@ std::vector<size_t> argsort(const T *array, size_t num) {
 /*
   Unique is used to handle key duplicate in sparse pull operation
   Unique itself is a vector that contains sorted unique data
-  also has a mapping from old indices to new unique indices
+  also has a mapping from old indices to new unique indices, and the old
+  indices of each unique data in ascending order
 */
 template <typename T>
 class Unique : public std::vector<T> {
@@ -30,21 +32,33 @@ public:
     Unique(const T *data, size_t num) {
         map_indices_.resize(num);
         this->reserve(num);
-        auto args = argsort(data, num);
+        order_ = argsort(data, num);
         for (size_t i = 0; i < num; i++) {
-            if (i == 0 || data[args[i]] != data[args[i - 1]]) {
-                this->push_back(data[args[i]]);
+            if (i == 0 || data[order_[i]] != data[order_[i - 1]]) {
+                this->push_back(data[order_[i]]);
+                offsets_.push_back(i);
             }
-            map_indices_[args[i]] = this->size() - 1;
+            map_indices_[order_[i]] = this->size() - 1;
         }
+        offsets_.push_back(num);
     }
 
     inline size_t map(size_t idx) {
         return map_indices_[idx];
     }
 
+    // old indices of the i-th unique data are [positionsBegin, positionsEnd)
+    inline const size_t *positionsBegin(size_t i) const {
+        return order_.data() + offsets_[i];
+    }
+    inline const size_t *positionsEnd(size_t i) const {
+        return order_.data() + offsets_[i + 1];
+    }
+
 private:
     std::vector<size_t> map_indices_;
+    std::vector<size_t> order_;
+    std::vector<size_t> offsets_;
 };
 
 } // namespace hetu
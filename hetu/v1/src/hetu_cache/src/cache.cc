@@ -7,30 +7,54 @@
 
 namespace hetu {
 
-CacheBase::CacheBase(size_t limit, size_t len, size_t width, int node_id) :
-    limit_(limit), width_(width), node_id_(node_id) {
+namespace {
+
+// Threads to copy or accumulate `rows` x `width` embeddings, one per 64K
+// elements
+int rowThreads(size_t rows, size_t width) {
+    return std::max<int>(
+        1, std::min<size_t>(getCacheThreads(), rows * width >> 16));
 }
 
-vector<EmbeddingPT> CacheBase::batchedLookup(const cache_key_t *keys,
-                                             size_t len) {
-    std::lock_guard<std::mutex> lock(mtx);
-    if (bypass_cache_)
-        return vector<EmbeddingPT>(len, nullptr);
-    vector<EmbeddingPT> result(len);
-    for (size_t i = 0; i < len; i++) {
-        EmbeddingPT ptr = lookup(keys[i]);
-        result[i] = ptr;
+// Copy the rows of the unique keys to all their positions in dest
+void copyOut(Unique<cache_key_t> &unique_keys, vector<EmbeddingPT> &embeds,
+             size_t num_keys, size_t width, embed_t *dest) {
+#pragma omp parallel for num_threads(rowThreads(num_keys, width))
+    for (size_t _i = 0; _i < num_keys; _i++) {
+        auto i = unique_keys.map(_i);
+        std::copy(embeds[i]->data(), embeds[i]->data() + width,
+                  dest + _i * width);
     }
-    return result;
 }
 
-void CacheBase::batchedInsert(vector<EmbeddingPT> &ptrs) {
-    std::lock_guard<std::mutex> lock(mtx);
-    if (bypass_cache_)
-        return;
-    for (auto &ptr : ptrs) {
-        insert(ptr);
+// Accumulate the gradients of each unique key, creating the missed ones
+// without data. Returns the number of misses.
+size_t accumulateGrads(Unique<cache_key_t> &unique_keys,
+                       vector<EmbeddingPT> &embeds, const embed_t *grads,
+                       size_t num_keys, size_t width,
+                       const shared_ptr<EmbeddingArena> &arena) {
+    size_t miss_cnt = 0;
+#pragma omp parallel for num_threads(rowThreads(num_keys, width)) \
+    schedule(dynamic, 64) reduction(+ : miss_cnt)
+    for (size_t i = 0; i < unique_keys.size(); i++) {
+        if (!embeds[i]) {
+            // !! This is not likely to happen, newly pulled embedding should be
+            // in cache
+            embeds[i].reset(new Embedding(unique_keys[i], arena, false));
+            miss_cnt++;
+        }
+        for (auto p = unique_keys.positionsBegin(i);
+             p != unique_keys.positionsEnd(i); ++p)
+            embeds[i]->accumulate(grads + *p * width);
     }
+    return miss_cnt;
+}
+
+} // namespace
+
+CacheBase::CacheBase(size_t limit, size_t len, size_t width, int node_id) :
+    limit_(limit), width_(width), node_id_(node_id),
+    arena_(make_shared<EmbeddingArena>(width)) {
 }
 
 wait_t CacheBase::embeddingLookup(py::array_t<cache_key_t> _keys,
@@ -56,6 +80,23 @@ wait_t CacheBase::embeddingLookupRaw(uint64_t _keys, uint64_t dest,
                                       reinterpret_cast<embed_t *>(dest));
 }
 
+wait_t CacheBase::embeddingPrefetch(py::array_t<cache_key_t> _keys) {
+    PYTHON_CHECK_ARRAY(_keys);
+    SArray<cache_key_t> keys(_keys.mutable_data(), _keys.size());
+    return ThreadPool::Get()->Enqueue(&CacheBase::_embeddingLookup, this, keys,
+                                      static_cast<embed_t *>(nullptr));
+}
+
+wait_t CacheBase::embeddingPrefetchRaw(uint64_t _keys, size_t num_keys) {
+    float *keys = reinterpret_cast<float *>(_keys);
+    SArray<cache_key_t> intkeys(num_keys);
+    for (size_t i = 0; i < num_keys; i++)
+        intkeys[i] = (cache_key_t)keys[i];
+    return ThreadPool::Get()->Enqueue(&CacheBase::_embeddingLookup, this,
+                                      intkeys,
+                                      static_cast<embed_t *>(nullptr));
+}
+
 void CacheBase::_embeddingLookup(SArray<cache_key_t> keys, embed_t *dest) {
     auto start_time = std::chrono::system_clock::now();
     // Unique operation
@@ -69,7 +110,7 @@ void CacheBase::_embeddingLookup(SArray<cache_key_t> keys, embed_t *dest) {
     vector<EmbeddingPT> should_insert;
     for (size_t i = 0; i < unique_keys.size(); i++) {
         if (!embeds[i]) {
-            embeds[i].reset(new Embedding(unique_keys[i], width_));
+            embeds[i].reset(new Embedding(unique_keys[i], arena_));
             should_insert.push_back(embeds[i]);
         }
     }
@@ -77,18 +118,15 @@ void CacheBase::_embeddingLookup(SArray<cache_key_t> keys, embed_t *dest) {
     size_t pulled = syncEmbedding(node_id_, embeds, pull_bound_);
     auto trans_time = std::chrono::system_clock::now();
     // Copy embedding to destination
-    for (size_t _i = 0; _i < keys.size(); _i++) {
-        auto i = unique_keys.map(_i);
-        std::copy(embeds[i]->data(), embeds[i]->data() + embeds[i]->size(),
-                  dest + _i * embeds[i]->size());
-    }
+    if (dest)
+        copyOut(unique_keys, embeds, keys.size(), width_, dest);
     auto copy_time = std::chrono::system_clock::now();
     batchedInsert(should_insert);
     auto end_time = std::chrono::system_clock::now();
     if (perf_enabled_) {
         py::gil_scoped_acquire acquire;
         py::dict performance;
-        performance["type"] = "Pull";
+        performance["type"] = dest ? "Pull" : "Prefetch";
         performance["is_full"] = size() == limit_;
         performance["num_all"] = keys.size();
         performance["num_unique"] = unique_keys.size();
@@ -138,19 +176,11 @@ void CacheBase::_embeddingUpdate(SArray<cache_key_t> keys,
     auto embeds = batchedLookup(unique_keys.data(), unique_keys.size());
     auto lookup_time = std::chrono::system_clock::now();
     // Do local updates
-    size_t miss_cnt = 0, evict_cnt = evict_.size();
     vector<EmbeddingPT> should_push;
-    vector<EmbeddingPT> evict = std::move(evict_);
-    for (size_t _i = 0; _i < keys.size(); _i++) {
-        auto i = unique_keys.map(_i);
-        if (!embeds[i]) {
-            // !! This is not likely to happen, newly pulled embedding should be
-            // in cache
-            embeds[i].reset(new Embedding(unique_keys[i], width_, false));
-            miss_cnt++;
-        }
-        embeds[i]->accumulate(grads + _i * width_);
-    }
+    vector<EmbeddingPT> evict = takeEvicted();
+    size_t evict_cnt = evict.size();
+    size_t miss_cnt = accumulateGrads(unique_keys, embeds, grads, keys.size(),
+                                      width_, arena_);
     auto evict_iter = evict.begin();
     for (size_t i = 0; i < unique_keys.size(); i++) {
         if (embeds[i]->getUpdates() > push_bound_ || !embeds[i]->data()) {
@@ -224,7 +254,7 @@ void CacheBase::_embeddingPushPull(SArray<cache_key_t> keys, embed_t *dest,
     vector<EmbeddingPT> should_insert;
     for (size_t i = 0; i < unique_keys.size(); i++) {
         if (!embeds[i]) {
-            embeds[i].reset(new Embedding(unique_keys[i], width_));
+            embeds[i].reset(new Embedding(unique_keys[i], arena_));
             should_insert.push_back(embeds[i]);
         }
     }
@@ -233,21 +263,10 @@ void CacheBase::_embeddingPushPull(SArray<cache_key_t> keys, embed_t *dest,
         Unique<cache_key_t>(push_keys.data(), push_keys.size());
     auto push_embeds =
         batchedLookup(push_unique_keys.data(), push_unique_keys.size());
-    size_t miss_cnt = 0;
-    // size_t evict_cnt = evict_.size();
     vector<EmbeddingPT> should_push;
-    vector<EmbeddingPT> evict = std::move(evict_);
-    for (size_t _i = 0; _i < push_keys.size(); _i++) {
-        auto i = push_unique_keys.map(_i);
-        if (!push_embeds[i]) {
-            // !! This is not likely to happen, newly pulled embedding should be
-            // in cache
-            push_embeds[i].reset(
-                new Embedding(push_unique_keys[i], width_, false));
-            miss_cnt++;
-        }
-        push_embeds[i]->accumulate(grads + _i * width_);
-    }
+    vector<EmbeddingPT> evict = takeEvicted();
+    accumulateGrads(push_unique_keys, push_embeds, grads, push_keys.size(),
+                    width_, arena_);
     auto evict_iter = evict.begin();
     for (size_t i = 0; i < push_unique_keys.size(); i++) {
         if (push_embeds[i]->getUpdates() > push_bound_
@@ -265,11 +284,7 @@ void CacheBase::_embeddingPushPull(SArray<cache_key_t> keys, embed_t *dest,
     pushSyncEmbedding(node_id_, embeds, pull_bound_, should_push);
 
     // Copy embedding to destination
-    for (size_t _i = 0; _i < keys.size(); _i++) {
-        auto i = unique_keys.map(_i);
-        std::copy(embeds[i]->data(), embeds[i]->data() + embeds[i]->size(),
-                  dest + _i * embeds[i]->size());
-    }
+    copyOut(unique_keys, embeds, keys.size(), width_, dest);
     batchedInsert(should_insert);
 
     for (size_t i = 0; i < push_unique_keys.size(); i++) {
@@ -287,7 +302,9 @@ std::string CacheBase::__repr__() {
     ss << "<Cache : ";
     ss << size() << "/" << limit_;
     ss << " , id:" << node_id_;
+    ss << " , shards:" << numShards();
     ss << " , width:" << width_;
+    ss << " , memory:" << getMemoryUsage() << "/" << getMemoryReserved();
     ss << " , bound:" << pull_bound_ << " " << push_bound_;
     ss << ">";
     return ss.str();
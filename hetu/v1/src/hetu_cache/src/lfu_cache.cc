@@ -2,33 +2,33 @@
 
 namespace hetu {
 
-int LFUCache::count(cache_key_t k) {
+int LFUPolicy::count(cache_key_t k) {
     return hash_.count(k);
 }
 
-void LFUCache::insert(EmbeddingPT e) {
+void LFUPolicy::insert(EmbeddingPT e) {
     assert(e->size() == width_);
     auto iter = hash_.find(e->key());
-    if (iter == hash_.end()) {
+    if (!iter) {
         if (hash_.size() == limit_)
             _evict();
         hash_[e->key()] = _create(e);
     } else {
-        iter->second->ptr = e;
-        hash_[e->key()] = _increase(iter->second);
+        (*iter)->ptr = e;
+        *iter = _increase(*iter);
     }
 }
 
-EmbeddingPT LFUCache::lookup(cache_key_t k) {
+EmbeddingPT LFUPolicy::lookup(cache_key_t k) {
     auto iter = hash_.find(k);
-    if (iter == hash_.end())
+    if (!iter)
         return nullptr;
-    hash_[k] = _increase(iter->second);
-    auto result = iter->second->ptr;
+    *iter = _increase(*iter);
+    auto result = (*iter)->ptr;
     return result;
 }
 
-void LFUCache::_evict() {
+void LFUPolicy::_evict() {
     auto clist = list_.begin();
     auto embed = clist->list.back().ptr;
     auto key = embed->key();
@@ -40,7 +40,7 @@ void LFUCache::_evict() {
         list_.erase(clist);
 }
 
-std::list<LFUCache::Block>::iterator LFUCache::_create(EmbeddingPT embed) {
+std::list<LFUPolicy::Block>::iterator LFUPolicy::_create(EmbeddingPT embed) {
     if (list_.empty() || list_.begin()->use > 1) {
         list_.push_front({std::list<Block>(), 1});
     }
@@ -48,8 +48,8 @@ std::list<LFUCache::Block>::iterator LFUCache::_create(EmbeddingPT embed) {
     return list_.begin()->list.begin();
 }
 
-std::list<LFUCache::Block>::iterator
-LFUCache::_increase(std::list<Block>::iterator iter) {
+std::list<LFUPolicy::Block>::iterator
+LFUPolicy::_increase(std::list<Block>::iterator iter) {
     std::list<Block>::iterator result;
     auto clist = iter->head;
     auto clist_nxt = ++iter->head;
@@ -69,13 +69,10 @@ LFUCache::_increase(std::list<Block>::iterator iter) {
     return result;
 }
 
-py::array_t<cache_key_t> LFUCache::PyAPI_keys() {
-    std::vector<cache_key_t> keys;
-    for (auto &iter : hash_) {
-        keys.push_back(iter.first);
-    }
-    std::sort(keys.begin(), keys.end());
-    return bind::vec(keys);
+void LFUPolicy::keys(vector<cache_key_t> &keys) {
+    hash_.forEach([&keys](cache_key_t k, const std::list<Block>::iterator &) {
+        keys.push_back(k);
+    });
 }
 
 } // namespace hetu
@@ -2,18 +2,19 @@
 
 namespace hetu {
 
-int LFUOptCache::count(cache_key_t k) {
+int LFUOptPolicy::count(cache_key_t k) {
     return store_.count(k) + hash_.count(k);
 }
 
-void LFUOptCache::insert(EmbeddingPT e) {
-    if (store_.count(e->key())) {
-        store_[e->key()] = e;
+void LFUOptPolicy::insert(EmbeddingPT e) {
+    auto stored = store_.find(e->key());
+    if (stored) {
+        *stored = e;
         return;
     }
     auto iter = hash_.find(e->key());
-    if (iter != hash_.end()) {
-        iter->second->ptr = e;
+    if (iter) {
+        (*iter)->ptr = e;
     } else {
         if (size() == limit_) {
             if (hash_.size() > 0)
@@ -25,31 +26,31 @@ void LFUOptCache::insert(EmbeddingPT e) {
     }
 }
 
-EmbeddingPT LFUOptCache::lookup(cache_key_t k) {
+EmbeddingPT LFUOptPolicy::lookup(cache_key_t k) {
     auto ptr = store_.find(k);
-    if (ptr != store_.end())
-        return ptr->second;
+    if (ptr)
+        return *ptr;
     auto iter = hash_.find(k);
-    if (iter == hash_.end())
+    if (!iter)
         return nullptr;
-    auto result = iter->second->ptr;
-    if (iter->second->use + 1 < kUseCntMax)
-        hash_[k] = _increase(iter->second);
+    auto result = (*iter)->ptr;
+    if ((*iter)->use + 1 < kUseCntMax)
+        *iter = _increase(*iter);
     else {
-        store_[k] = iter->second->ptr;
-        clist[kUseCntMax - 1].erase(iter->second);
+        clist[kUseCntMax - 1].erase(*iter);
         hash_.erase(k);
+        store_[k] = result;
     }
     return result;
 }
 
-std::list<LFUOptCache::Block>::iterator
-LFUOptCache::_create(EmbeddingPT embed) {
+std::list<LFUOptPolicy::Block>::iterator
+LFUOptPolicy::_create(EmbeddingPT embed) {
     clist[0].push_front({embed, 0});
     return clist[0].begin();
 }
 
-void LFUOptCache::_evict() {
+void LFUOptPolicy::_evict() {
     for (int i = 0; i < kUseCntMax; i++) {
         if (!clist[i].empty()) {
             auto embed = clist[i].back().ptr;
@@ -62,22 +63,20 @@ void LFUOptCache::_evict() {
     }
 }
 
-std::list<LFUOptCache::Block>::iterator
-LFUOptCache::_increase(std::list<Block>::iterator iter) {
+std::list<LFUOptPolicy::Block>::iterator
+LFUOptPolicy::_increase(std::list<Block>::iterator iter) {
     size_t use = iter->use;
     clist[use + 1].push_front({iter->ptr, iter->use + 1});
     clist[use].erase(iter);
     return clist[use + 1].begin();
 }
 
-py::array_t<cache_key_t> LFUOptCache::PyAPI_keys() {
-    std::vector<cache_key_t> keys;
-    for (auto &iter : store_)
-        keys.push_back(iter.first);
-    for (auto &iter : hash_)
-        keys.push_back(iter.first);
-    std::sort(keys.begin(), keys.end());
-    return bind::vec(keys);
+void LFUOptPolicy::keys(vector<cache_key_t> &keys) {
+    store_.forEach(
+        [&keys](cache_key_t k, const EmbeddingPT &) { keys.push_back(k); });
+    hash_.forEach([&keys](cache_key_t k, const std::list<Block>::iterator &) {
+        keys.push_back(k);
+    });
 }
 
 } // namespace hetu
@@ -2,49 +2,78 @@
 
 namespace hetu {
 
-int LRUCache::count(cache_key_t k) {
+LRUPolicy::LRUPolicy(size_t limit, size_t width) :
+    CachePolicy(limit, width), hash_(limit + 1) {
+    nodes_.reserve(limit + 2);
+    nodes_.push_back({nullptr, 0, 0});
+}
+
+void LRUPolicy::_unlink(node_t n) {
+    nodes_[nodes_[n].prev].next = nodes_[n].next;
+    nodes_[nodes_[n].next].prev = nodes_[n].prev;
+}
+
+void LRUPolicy::_pushFront(node_t n) {
+    nodes_[n].prev = 0;
+    nodes_[n].next = nodes_[0].next;
+    nodes_[nodes_[0].next].prev = n;
+    nodes_[0].next = n;
+}
+
+LRUPolicy::node_t LRUPolicy::_newNode(EmbeddingPT e) {
+    if (!free_nodes_.empty()) {
+        node_t n = free_nodes_.back();
+        free_nodes_.pop_back();
+        nodes_[n].ptr = e;
+        return n;
+    }
+    nodes_.push_back({e, 0, 0});
+    return nodes_.size() - 1;
+}
+
+int LRUPolicy::count(cache_key_t k) {
     return hash_.count(k);
 }
 
-void LRUCache::insert(EmbeddingPT e) {
+void LRUPolicy::insert(EmbeddingPT e) {
     assert(e->size() == width_);
-    if (hash_.count(e->key())) {
-        auto embed = hash_[e->key()];
-        list_.erase(embed);
+    auto iter = hash_.find(e->key());
+    if (iter) {
+        node_t n = *iter;
+        _unlink(n);
+        nodes_[n].ptr = e;
+        _pushFront(n);
+        return;
     }
-    list_.push_front(e);
-    hash_[e->key()] = list_.begin();
+    node_t n = _newNode(e);
+    _pushFront(n);
+    hash_[e->key()] = n;
     // Evict the least resently used if exceeds
     if (hash_.size() > limit_) {
-        auto embed = list_.back();
+        node_t last = nodes_[0].prev;
+        auto embed = std::move(nodes_[last].ptr);
+        _unlink(last);
+        free_nodes_.push_back(last);
         hash_.erase(embed->key());
         if (embed->getUpdates() != 0)
             evict_.push_back(embed);
-        list_.pop_back();
     }
 }
 
-EmbeddingPT LRUCache::lookup(cache_key_t k) {
+EmbeddingPT LRUPolicy::lookup(cache_key_t k) {
     auto iter = hash_.find(k);
-    if (iter == hash_.end()) {
+    if (!iter) {
         return nullptr;
     }
-    auto list_iterator = iter->second;
-    auto result = *list_iterator;
     // Move the recently used cache line to the front of the list
-    list_.erase(list_iterator);
-    list_.push_front(result);
-    hash_[k] = list_.begin();
-    return result;
+    node_t n = *iter;
+    _unlink(n);
+    _pushFront(n);
+    return nodes_[n].ptr;
 }
 
-py::array_t<cache_key_t> LRUCache::PyAPI_keys() {
-    std::vector<cache_key_t> keys;
-    for (auto &iter : hash_) {
-        keys.push_back(iter.first);
-    }
-    std::sort(keys.begin(), keys.end());
-    return bind::vec(keys);
+void LRUPolicy::keys(vector<cache_key_t> &keys) {
+    hash_.forEach([&keys](cache_key_t k, node_t) { keys.push_back(k); });
 }
 
 } // namespace hetu
@@ -32,7 +32,11 @@ PYBIND11_MODULE(hetu_cache, m) {
     py::class_<CacheBase>(m, "CacheBase")
         .def_property_readonly("limit", &CacheBase::getLimit)
         .def_property_readonly("width", &CacheBase::getWidth)
+        .def_property_readonly("num_shards", &CacheBase::numShards)
         .def_property_readonly("perf", &CacheBase::getPerf)
+        .def_property_readonly("memory_usage", &CacheBase::getMemoryUsage)
+        .def_property_readonly("memory_reserved",
+                               &CacheBase::getMemoryReserved)
         .def_property("pull_bound", &CacheBase::getPullBound,
                       &CacheBase::setPullBound)
         .def_property("push_bound", &CacheBase::getPushBound,
@@ -45,11 +49,14 @@ PYBIND11_MODULE(hetu_cache, m) {
         .def("embedding_update", &CacheBase::embeddingUpdate)
         .def("embedding_lookup_raw", &CacheBase::embeddingLookupRaw)
         .def("embedding_update_raw", &CacheBase::embeddingUpdateRaw)
+        .def("embedding_prefetch", &CacheBase::embeddingPrefetch)
+        .def("embedding_prefetch_raw", &CacheBase::embeddingPrefetchRaw)
         .def("embedding_push_pull_raw", &CacheBase::embeddingPushPullRaw)
         .def("__repr__", &CacheBase::__repr__);
 
     py::class_<LRUCache, CacheBase>(m, "LRUCache")
         .def(py::init<size_t, size_t, size_t, int>())
+        .def(py::init<size_t, size_t, size_t, int, size_t>())
         .def("count", &LRUCache::count)
         .def("lookup", &LRUCache::lookup)
         .def("insert", &LRUCache::insert)
@@ -58,6 +65,7 @@ PYBIND11_MODULE(hetu_cache, m) {
 
     py::class_<LFUCache, CacheBase>(m, "LFUCache")
         .def(py::init<size_t, size_t, size_t, int>())
+        .def(py::init<size_t, size_t, size_t, int, size_t>())
         .def("count", &LFUCache::count)
         .def("lookup", &LFUCache::lookup)
         .def("insert", &LFUCache::insert)
@@ -66,6 +74,7 @@ PYBIND11_MODULE(hetu_cache, m) {
 
     py::class_<LFUOptCache, CacheBase>(m, "LFUOptCache")
         .def(py::init<size_t, size_t, size_t, int>())
+        .def(py::init<size_t, size_t, size_t, int, size_t>())
         .def("count", &LFUOptCache::count)
         .def("lookup", &LFUOptCache::lookup)
         .def("insert", &LFUOptCache::insert)
@@ -8,14 +8,116 @@ import numpy as np
 from tqdm import tqdm
 
 
-def test(args):
-    comm = get_worker_communicate()
+def init_table(comm, node_id, length, width):
+    comm.InitTensor(ctypes.c_int(node_id), ctypes.c_int(2), ctypes.c_int(length), ctypes.c_int(width), ctypes.c_int(2), ctypes.c_double(0), ctypes.c_double(0.1), ctypes.c_ulonglong(123),
+                    ctypes.c_int(0), (ctypes.c_float * 1)(0.1), ctypes.c_int(1))
+
+
+def lookup(cache, keys):
+    value = np.empty((keys.size, cache.width), np.float32)
+    cache.embedding_lookup(keys, value, sync=True)
+    return value
+
+
+def test_shard_counts(comm):
+    # one shard against several on the same requests: while the keys fit in
+    # every shard, and when a scan larger than the cache evicts everything,
+    # the hits, misses and evictions must not depend on the sharding
+    limit, length, width = 1000, 100000, 16
+    for node_id, num_shards in [(1, 1), (2, 4)]:
+        init_table(comm, node_id, length, width)
+        cache = CacheSparseTable(limit, length, width,
+                                 node_id, "LRU", num_shards=num_shards)
+        assert cache.num_shards == num_shards
+        cache.perf_enabled()
+
+        hot = np.arange(400).astype(np.uint64)
+        lookup(cache, hot)
+        lookup(cache, hot)
+        assert [x["num_miss"] for x in cache.perf] == [400, 0], num_shards
+        assert sorted(cache.keys()) == list(range(400)), num_shards
+
+        # pending updates are pushed when their rows are evicted
+        grad = np.ones((hot.size, width), np.float32)
+        cache.embedding_update(hot, grad, sync=True)
+        assert cache.perf[-1]["num_evict"] == 0, num_shards
+        for begin in range(1000, 6000, 1000):
+            lookup(cache, np.arange(begin, begin + 1000).astype(np.uint64))
+        assert [x["num_miss"] for x in cache.perf[3:]] == [1000] * 5, \
+            num_shards
+        keys = cache.keys()
+        assert len(keys) == limit and min(keys) >= 1000, num_shards
+        cache.embedding_update(hot[:1], grad[:1], sync=True)
+        assert cache.perf[-1]["num_evict"] == 400, num_shards
+        assert cache.perf[-1]["num_miss"] == 1, num_shards
+
+
+def test_concurrent(comm):
+    # async lookups and updates of disjoint keys spread over the shards; no
+    # update may be lost and the rows that are only read must not change.
+    # The limit is twice the table so that no shard evicts.
+    limit, length, width = 20000, 10000, 16
+    node_id, num_groups, repeat = 3, 8, 3
+    init_table(comm, node_id, length, width)
+    cache = CacheSparseTable(limit, length, width, node_id, "LRU",
+                             num_shards=8)
+    keys = np.random.permutation(length).astype(np.uint64)
+    groups = np.split(keys, 2 * num_groups)
+    before = lookup(cache, keys)
+    grads = [np.random.rand(g.size * repeat, width).astype(np.float32)
+             for g in groups[:num_groups]]
+    update_keys = [np.tile(g, repeat) for g in groups[:num_groups]]
+    dests = [np.empty((g.size, width), np.float32)
+             for g in groups[num_groups:]]
+    waits = []
+    for i in range(num_groups):
+        waits.append(cache.embedding_update(update_keys[i], grads[i]))
+        waits.append(cache.embedding_lookup(groups[num_groups + i], dests[i]))
+    for wait in waits:
+        wait.wait()
+
+    row = {int(k): i for i, k in enumerate(keys)}
+    for g, grad in zip(groups, grads):
+        summed = np.zeros((g.size, width), np.float32)
+        for r in range(repeat):
+            summed += grad[r * g.size:(r + 1) * g.size]
+        for j, k in enumerate(g):
+            embed = cache.lookup(int(k))
+            assert np.allclose(embed.grad, summed[j], rtol=1e-5)
+            assert np.allclose(embed.data, before[row[int(k)]] + summed[j],
+                               rtol=1e-5)
+    for g, dest in zip(groups[num_groups:], dests):
+        expected = before[[row[int(k)] for k in g]]
+        assert np.array_equal(dest.view(np.uint32), expected.view(np.uint32))
+    assert len(cache.keys()) == length
+
+
+def test_copy_out(comm):
+    # the rows copied out in parallel, duplicates included, must be the bytes
+    # of the cached rows, whatever the sharding
+    limit, length, width = 20000, 10000, 128
+    node_id = 4
+    init_table(comm, node_id, length, width)
+    caches = [CacheSparseTable(limit, length, width, node_id, "LRU",
+                               num_shards=num_shards)
+              for num_shards in (1, 8)]
+    key = np.random.randint(length, size=20000).astype(np.uint64)
+    values = [lookup(cache, key) for cache in caches]
+    expected = np.stack([caches[0].lookup(int(k)).data for k in key])
+    for value in values:
+        assert np.array_equal(value.view(np.uint32), expected.view(np.uint32))
+    # once more from the cache, without pulling
+    for cache in caches:
+        value = lookup(cache, key)
+        assert np.array_equal(value.view(np.uint32), expected.view(np.uint32))
+
+
+def test_stress(comm):
     node_id = 0
     limit = 10000
     length = 10000
     width = 128
-    comm.InitTensor(ctypes.c_int(node_id), ctypes.c_int(2), ctypes.c_int(length), ctypes.c_int(width), ctypes.c_int(2), ctypes.c_double(0), ctypes.c_double(0.1), ctypes.c_ulonglong(123),
-                    ctypes.c_int(0), (ctypes.c_float * 1)(0.1), ctypes.c_int(1))
+    init_table(comm, node_id, length, width)
     cache = CacheSparseTable(limit, length, width, node_id, "LFUOpt")
     for i in tqdm(range(10000)):
         key = np.random.randint(10000, size=1000).astype(np.uint64)
@@ -27,6 +129,15 @@ def test(args):
         ts.wait()
 
 
+def test(args):
+    comm = get_worker_communicate()
+    np.random.seed(123)
+    test_shard_counts(comm)
+    test_concurrent(comm)
+    test_copy_out(comm)
+    test_stress(comm)
+
+
 if __name__ == '__main__':
     parser = argparse.ArgumentParser()
     parser.add_argument("config")
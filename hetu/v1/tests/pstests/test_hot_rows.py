@@ -0,0 +1,176 @@
+import hetu as ht
+
+import time
+import os
+import multiprocessing
+import argparse
+import signal
+import numpy as np
+import ctypes
+
+
+# One worker pushes and pulls Zipf distributed rows of a sparse table held by
+# two servers, with each partitioner and with hot row replication, and prints
+# the requests and bytes sent to each server. The pushes add one to each row
+# per occurrence, so the table must end up holding the counts of the ids.
+# The hot rows crowd the first server under the average partitioner, so the
+# traffic of the busiest server over that of the idlest must be clearly lower
+# when hashing, with or without replication.
+PARTITIONS = {
+    'average': dict(PS_PARTITIONER='average'),
+    'hash': dict(PS_PARTITIONER='hash'),
+    'hash+hot': dict(PS_PARTITIONER='hash'),
+}
+
+
+def make_settings(partition, args):
+    port = args.port
+    shared = dict(PARTITIONS[partition],
+                  DMLC_PS_ROOT_URI='127.0.0.1',
+                  DMLC_PS_ROOT_PORT=port,
+                  DMLC_NUM_WORKER=1,
+                  DMLC_NUM_SERVER=2,
+                  DMLC_PS_VAN_TYPE='zmq')
+    if partition == 'hash+hot':
+        shared.update(PS_HOT_ROWS=args.hot_rows,
+                      PS_HOT_SYNC_STEPS=args.sync_steps)
+    settings = {
+        'sched': dict(shared, DMLC_ROLE='scheduler'),
+        'w0': dict(shared, DMLC_ROLE='worker', WORKER_ID=0,
+                   DMLC_PS_WORKER_URI='127.0.0.1',
+                   DMLC_PS_WORKER_PORT=port + 1),
+    }
+    for i in range(2):
+        settings['s%d' % i] = dict(shared, DMLC_ROLE='server', SERVER_ID=i,
+                                   DMLC_PS_SERVER_URI='127.0.0.1',
+                                   DMLC_PS_SERVER_PORT=port + 2 + i)
+    return settings
+
+
+def zipf_indices(args):
+    ind = np.random.zipf(args.zipf, size=(args.ind_len,)) - 1
+    return (ind % args.nitem).astype(np.float32)
+
+
+def test(args, result):
+    ctx = ht.cpu(0)
+    comm = ht.get_worker_communicate()
+
+    name = 0
+    # zero init, the optimizer is not used as pushes are added
+    comm.InitTensor(name, ctypes.c_int(1), ctypes.c_int(args.nitem),
+                    ctypes.c_int(args.width), ctypes.c_int(0),
+                    ctypes.c_double(0), ctypes.c_double(1),
+                    ctypes.c_ulonglong(123), ctypes.c_int(0),
+                    (ctypes.c_float * 1)(0.1), ctypes.c_int(1))
+
+    np.random.seed(123)
+    inarr = ht.array(np.ones((args.ind_len, args.width)), ctx=ctx)
+    outarr = ht.array(np.zeros((args.ind_len, args.width)), ctx=ctx)
+    indices = [zipf_indices(args) for _ in range(16)]
+    handles = [ht.array(ind, ctx=ctx) for ind in indices]
+
+    start = time.time()
+    for i in range(args.iters):
+        ind = handles[i % len(handles)]
+        comm.SparsePush(name, ind.handle, inarr.handle, None)
+        comm.Wait(name)
+        comm.SparsePull(name, ind.handle, outarr.handle)
+        comm.Wait(name)
+    elapsed = time.time() - start
+    # the loads of the steps, before the checks add to them
+    loads = (ctypes.c_longlong * 6)()
+    comm.GetServerLoads(loads)
+
+    # rows of the same id must be pulled identically
+    ind = indices[(args.iters - 1) % len(indices)].astype(np.int64)
+    out = outarr.asnumpy()
+    _, first = np.unique(ind, return_index=True)
+    assert np.array_equal(out, out[first[np.searchsorted(ind[first], ind)]])
+
+    # the full pull flushes the replicas and undoes the permutation
+    counts = np.zeros((args.nitem,), dtype=np.float32)
+    for i in range(args.iters):
+        np.add.at(counts, indices[i % len(indices)].astype(np.int64), 1)
+    table = ht.array(np.zeros((args.nitem, args.width)), ctx=ctx)
+    comm.Pull(name, table.handle)
+    comm.Wait(name)
+    assert np.allclose(table.asnumpy(), counts[:, None]), \
+        "the table does not hold the counts of the pushed ids"
+
+    result.put((args.iters * args.ind_len / elapsed, list(loads)))
+    comm.ClearOnServer(name)
+    comm.Clear(name)
+
+
+def imbalance(loads):
+    # max / min over the servers of the bytes sent and received
+    traffic = [loads[3 * i + 1] + loads[3 * i + 2] for i in range(2)]
+    return max(traffic) / max(min(traffic), 1)
+
+
+def start_process(settings, args, result):
+    for key, value in settings.items():
+        os.environ[key] = str(value)
+    if os.environ['DMLC_ROLE'] == "server":
+        ht.server_init()
+        ht.server_finish()
+    elif os.environ['DMLC_ROLE'] == "worker":
+        ht.worker_init()
+        test(args, result)
+        ht.worker_finish()
+    elif os.environ['DMLC_ROLE'] == "scheduler":
+        ht.scheduler_init()
+        ht.scheduler_finish()
+    else:
+        raise ValueError("Unknown role", os.environ['DMLC_ROLE'])
+
+
+def signal_handler(signal, frame):
+    print("SIGINT signal caught, stop Training")
+    for proc in process_list:
+        proc.kill()
+    exit(0)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--partition", nargs='+',
+                        default=['average', 'hash', 'hash+hot'],
+                        choices=list(PARTITIONS))
+    parser.add_argument("--nitem", type=int, default=1000000)
+    parser.add_argument("--width", type=int, default=16)
+    parser.add_argument("--ind-len", type=int, default=100000)
+    parser.add_argument("--zipf", type=float, default=1.1)
+    parser.add_argument("--hot-rows", type=int, default=1024)
+    parser.add_argument("--sync-steps", type=int, default=20)
+    parser.add_argument("--iters", type=int, default=100)
+    parser.add_argument("--port", type=int, default=13600)
+    args = parser.parse_args()
+    signal.signal(signal.SIGINT, signal_handler)
+    ratios = {}
+    for partition in args.partition:
+        settings = make_settings(partition, args)
+        result = multiprocessing.Queue()
+        process_list = []
+        for value in settings.values():
+            proc = multiprocessing.Process(
+                target=start_process, args=[value, args, result])
+            process_list.append(proc)
+            proc.start()
+        for proc in process_list:
+            proc.join()
+        speed, loads = result.get()
+        print("{}: {:.0f} rows/s".format(partition, speed))
+        for i in range(2):
+            print("  server {}: {} requests, {:.1f} MB sent, {:.1f} MB "
+                  "received".format(i, loads[3 * i], loads[3 * i + 1] / 2**20,
+                                    loads[3 * i + 2] / 2**20))
+        ratios[partition] = imbalance(loads)
+        print("  imbalance {:.2f}".format(ratios[partition]))
+    if 'average' in ratios:
+        for partition in ('hash', 'hash+hot'):
+            if partition in ratios:
+                assert ratios[partition] < 0.8 * ratios['average'], \
+                    "{} does not balance the servers: {:.2f} vs {:.2f}".format(
+                        partition, ratios[partition], ratios['average'])
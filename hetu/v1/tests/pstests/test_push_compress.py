@@ -0,0 +1,179 @@
+import hetu as ht
+
+import time
+import os
+import multiprocessing
+import argparse
+import signal
+import numpy as np
+import ctypes
+
+
+# One worker trains a sparse and a dense linear regression on the PS with
+# each wire compression of pushes, and checks that the final loss stays within
+# a fraction of the initial loss of the uncompressed run. The worker pushes
+# -lr * grad, which the server adds to the parameters.
+COMPRESS_TYPES = {'none': 0, 'fp16': 1, 'bf16': 2, 'int8': 3, 'topk': 4}
+
+
+def make_settings(port):
+    shared = {
+        'DMLC_PS_ROOT_URI': '127.0.0.1',
+        'DMLC_PS_ROOT_PORT': port,
+        'DMLC_NUM_WORKER': 1,
+        'DMLC_NUM_SERVER': 1,
+        'DMLC_PS_VAN_TYPE': 'zmq',
+    }
+    return {
+        'sched': dict(shared, DMLC_ROLE='scheduler'),
+        's0': dict(shared, DMLC_ROLE='server', SERVER_ID=0,
+                   DMLC_PS_SERVER_URI='127.0.0.1',
+                   DMLC_PS_SERVER_PORT=port + 1),
+        'w0': dict(shared, DMLC_ROLE='worker', WORKER_ID=0,
+                   DMLC_PS_WORKER_URI='127.0.0.1',
+                   DMLC_PS_WORKER_PORT=port + 2),
+    }
+
+
+def init_tensor(comm, name, ptype, length, width):
+    # zero init, the optimizer is not used as pushes are added
+    comm.InitTensor(name, ctypes.c_int(ptype), ctypes.c_int(length),
+                    ctypes.c_int(width), ctypes.c_int(0),
+                    ctypes.c_double(0), ctypes.c_double(1),
+                    ctypes.c_ulonglong(123), ctypes.c_int(0),
+                    (ctypes.c_float * 1)(0.1), ctypes.c_int(1))
+
+
+def train(comm, args, sparse, dense, compress):
+    ctx = ht.cpu(0)
+    init_tensor(comm, sparse, 1, args.nitem, args.width)
+    init_tensor(comm, dense, 0, args.dense_dim, 1)
+    comm.SetPushCompression(sparse, ctypes.c_int(COMPRESS_TYPES[compress]),
+                            ctypes.c_float(args.topk_ratio))
+    comm.SetPushCompression(dense, ctypes.c_int(COMPRESS_TYPES[compress]),
+                            ctypes.c_float(args.topk_ratio))
+
+    # the same data for every compression
+    rng = np.random.RandomState(123)
+    emb_true = rng.normal(size=(args.nitem, args.width)).astype(np.float32)
+    w_true = rng.normal(size=(args.dense_dim,)).astype(np.float32)
+    batch, fields = args.batch, args.fields
+
+    rows = ht.array(np.zeros((batch * fields, args.width)), ctx=ctx)
+    weight = ht.array(np.zeros((args.dense_dim,)), ctx=ctx)
+
+    def sparse_loss(ids):
+        comm.SparsePull(sparse, ht.array(ids, ctx=ctx).handle, rows.handle)
+        comm.Wait(sparse)
+        pred = rows.asnumpy().reshape(batch, fields, args.width).sum(1)
+        label = emb_true[ids.astype(np.int64)].reshape(
+            batch, fields, args.width).sum(1)
+        return pred, label
+
+    def dense_loss(x, w):
+        return x.dot(w) - x.dot(w_true)
+
+    eval_ids = rng.randint(0, args.nitem, batch * fields).astype(np.float32)
+    eval_x = rng.normal(size=(batch, args.dense_dim)).astype(np.float32)
+    pred, label = sparse_loss(eval_ids)
+    init_loss = (np.mean((pred - label) ** 2),
+                 np.mean(dense_loss(eval_x, weight.asnumpy()) ** 2))
+
+    start = time.time()
+    for _ in range(args.iters):
+        ids = rng.randint(0, args.nitem, batch * fields).astype(np.float32)
+        pred, label = sparse_loss(ids)
+        # per sample steps, each row is only in a few samples of a batch
+        grad = np.repeat(2 * (pred - label), fields, axis=0)
+        comm.SparsePush(sparse, ht.array(ids, ctx=ctx).handle,
+                        ht.array(-args.sparse_lr * grad, ctx=ctx).handle,
+                        None)
+        comm.Wait(sparse)
+
+        x = rng.normal(size=(batch, args.dense_dim)).astype(np.float32)
+        grad = 2 * x.T.dot(dense_loss(x, weight.asnumpy())) / batch
+        comm.DDPushPull(dense, ht.array(-args.lr * grad, ctx=ctx).handle,
+                        weight.handle, None)
+        comm.Wait(dense)
+    elapsed = time.time() - start
+
+    pred, label = sparse_loss(eval_ids)
+    loss = (np.mean((pred - label) ** 2),
+            np.mean(dense_loss(eval_x, weight.asnumpy()) ** 2))
+    comm.ClearOnServer(sparse)
+    comm.Clear(sparse)
+    comm.ClearOnServer(dense)
+    comm.Clear(dense)
+    return init_loss, loss, elapsed / args.iters
+
+
+def test(args):
+    comm = ht.get_worker_communicate()
+    results = {}
+    for i, compress in enumerate(args.compress):
+        results[compress] = train(comm, args, 2 * i, 2 * i + 1, compress)
+        init_loss, loss, cost = results[compress]
+        print("{}: sparse loss {:.3e} -> {:.3e}, dense loss {:.3e} -> {:.3e}, "
+              "{:.2f} ms/iter".format(compress, init_loss[0], loss[0],
+                                      init_loss[1], loss[1], cost * 1000))
+    base_init, base_loss, _ = results['none']
+    for compress, (_, loss, _) in results.items():
+        for j, part in enumerate(('sparse', 'dense')):
+            assert loss[j] <= base_loss[j] + args.tol * base_init[j], \
+                "{} {} loss {} vs {} uncompressed".format(
+                    compress, part, loss[j], base_loss[j])
+    print("Push compression converged within tolerance.")
+
+
+def start_process(settings, args):
+    for key, value in settings.items():
+        os.environ[key] = str(value)
+    if os.environ['DMLC_ROLE'] == "server":
+        ht.server_init()
+        ht.server_finish()
+    elif os.environ['DMLC_ROLE'] == "worker":
+        ht.worker_init()
+        test(args)
+        ht.worker_finish()
+    elif os.environ['DMLC_ROLE'] == "scheduler":
+        ht.scheduler_init()
+        ht.scheduler_finish()
+    else:
+        raise ValueError("Unknown role", os.environ['DMLC_ROLE'])
+
+
+def signal_handler(signal, frame):
+    print("SIGINT signal caught, stop Training")
+    for proc in process_list:
+        proc.kill()
+    exit(0)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--compress", nargs='+',
+                        default=['none', 'fp16', 'bf16', 'int8', 'topk'],
+                        choices=list(COMPRESS_TYPES))
+    parser.add_argument("--topk-ratio", type=float, default=0.1)
+    parser.add_argument("--nitem", type=int, default=1000)
+    parser.add_argument("--width", type=int, default=8)
+    parser.add_argument("--fields", type=int, default=4)
+    parser.add_argument("--dense-dim", type=int, default=512)
+    parser.add_argument("--batch", type=int, default=256)
+    parser.add_argument("--lr", type=float, default=0.05)
+    parser.add_argument("--sparse-lr", type=float, default=0.02)
+    parser.add_argument("--iters", type=int, default=500)
+    # allowed excess of the final loss, relative to the initial loss
+    parser.add_argument("--tol", type=float, default=0.02)
+    parser.add_argument("--port", type=int, default=13500)
+    args = parser.parse_args()
+    if 'none' not in args.compress:
+        args.compress.insert(0, 'none')
+    signal.signal(signal.SIGINT, signal_handler)
+    process_list = []
+    for value in make_settings(args.port).values():
+        proc = multiprocessing.Process(target=start_process, args=[value, args])
+        process_list.append(proc)
+        proc.start()
+    for proc in process_list:
+        proc.join()
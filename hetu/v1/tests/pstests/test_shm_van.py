@@ -0,0 +1,109 @@
+import hetu as ht
+
+import time
+import os
+import multiprocessing
+import argparse
+import signal
+import numpy as np
+import ctypes
+
+
+# One worker and one server on localhost push and pull a dense tensor, once
+# with a large tensor for the throughput and once with a small one for the
+# round trip latency. Compare DMLC_PS_VAN_TYPE=shm with zmq.
+def make_settings(van, port):
+    shared = {
+        'DMLC_PS_ROOT_URI': '127.0.0.1',
+        'DMLC_PS_ROOT_PORT': port,
+        'DMLC_NUM_WORKER': 1,
+        'DMLC_NUM_SERVER': 1,
+        'DMLC_PS_VAN_TYPE': van,
+    }
+    return {
+        'sched': dict(shared, DMLC_ROLE='scheduler'),
+        's0': dict(shared, DMLC_ROLE='server', SERVER_ID=0,
+                   DMLC_PS_SERVER_URI='127.0.0.1',
+                   DMLC_PS_SERVER_PORT=port + 1),
+        'w0': dict(shared, DMLC_ROLE='worker', WORKER_ID=0,
+                   DMLC_PS_WORKER_URI='127.0.0.1',
+                   DMLC_PS_WORKER_PORT=port + 2),
+    }
+
+
+def push_pull(comm, name, length, iters):
+    ctx = ht.cpu(0)
+    comm.InitTensor(name, ctypes.c_int(0), ctypes.c_int(length),
+                    ctypes.c_int(1), ctypes.c_int(0),
+                    ctypes.c_double(0), ctypes.c_double(1),
+                    ctypes.c_ulonglong(123), ctypes.c_int(0),
+                    (ctypes.c_float * 1)(0.1), ctypes.c_int(1))
+    inarr = ht.array(np.random.rand(length), ctx=ctx)
+    outarr = ht.array(np.zeros(length), ctx=ctx)
+    start = time.time()
+    for _ in range(iters):
+        comm.DDPushPull(name, inarr.handle, outarr.handle, None)
+        comm.Wait(name)
+    elapsed = time.time() - start
+    comm.ClearOnServer(name)
+    comm.Clear(name)
+    return elapsed
+
+
+def test(args, result):
+    comm = ht.get_worker_communicate()
+    elapsed = push_pull(comm, 0, args.large, args.iters)
+    throughput = args.iters * args.large * 4 * 2 / elapsed / 2 ** 20
+    elapsed = push_pull(comm, 1, args.small, args.iters * 10)
+    latency = elapsed / (args.iters * 10) * 1e6
+    result.put((throughput, latency))
+
+
+def start_process(settings, args, result):
+    for key, value in settings.items():
+        os.environ[key] = str(value)
+    if os.environ['DMLC_ROLE'] == "server":
+        ht.server_init()
+        ht.server_finish()
+    elif os.environ['DMLC_ROLE'] == "worker":
+        ht.worker_init()
+        test(args, result)
+        ht.worker_finish()
+    elif os.environ['DMLC_ROLE'] == "scheduler":
+        ht.scheduler_init()
+        ht.scheduler_finish()
+    else:
+        raise ValueError("Unknown role", os.environ['DMLC_ROLE'])
+
+
+def signal_handler(signal, frame):
+    print("SIGINT signal caught, stop Training")
+    for proc in process_list:
+        proc.kill()
+    exit(0)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--vans", nargs='+', default=['zmq', 'shm'],
+                        choices=['zmq', 'p3', 'shm'])
+    parser.add_argument("--large", type=int, default=16 * 2 ** 20)
+    parser.add_argument("--small", type=int, default=256)
+    parser.add_argument("--iters", type=int, default=50)
+    parser.add_argument("--port", type=int, default=13500)
+    args = parser.parse_args()
+    signal.signal(signal.SIGINT, signal_handler)
+    for van in args.vans:
+        settings = make_settings(van, args.port)
+        result = multiprocessing.Queue()
+        process_list = []
+        for value in settings.values():
+            proc = multiprocessing.Process(
+                target=start_process, args=[value, args, result])
+            process_list.append(proc)
+            proc.start()
+        for proc in process_list:
+            proc.join()
+        throughput, latency = result.get()
+        print("{} van: {:.0f} MB/s, {:.1f} us per round trip".format(
+            van, throughput, latency))
@@ -0,0 +1,126 @@
+import hetu as ht
+
+import time
+import os
+import multiprocessing
+import argparse
+import signal
+import numpy as np
+import ctypes
+
+
+# One worker pushes and pulls Zipf distributed rows of a sparse table, so that
+# the batches are dominated by a few hot rows as in CTR models. The worker
+# deduplicates the indices with a parallel radix sort by default, compare
+# with PS_SPARSE_DEDUP=map for the former std::map grouping.
+def make_settings(dedup, worker_threads, port):
+    shared = {
+        'DMLC_PS_ROOT_URI': '127.0.0.1',
+        'DMLC_PS_ROOT_PORT': port,
+        'DMLC_NUM_WORKER': 1,
+        'DMLC_NUM_SERVER': 1,
+        'DMLC_PS_VAN_TYPE': 'zmq',
+        'PS_SPARSE_DEDUP': dedup,
+        'PS_WORKER_THREADS': worker_threads,
+    }
+    return {
+        'sched': dict(shared, DMLC_ROLE='scheduler'),
+        's0': dict(shared, DMLC_ROLE='server', SERVER_ID=0,
+                   DMLC_PS_SERVER_URI='127.0.0.1',
+                   DMLC_PS_SERVER_PORT=port + 1),
+        'w0': dict(shared, DMLC_ROLE='worker', WORKER_ID=0,
+                   DMLC_PS_WORKER_URI='127.0.0.1',
+                   DMLC_PS_WORKER_PORT=port + 2),
+    }
+
+
+def zipf_indices(args):
+    ind = np.random.zipf(args.zipf, size=(args.ind_len,)) - 1
+    return (ind % args.nitem).astype(np.float32)
+
+
+def test(args, result):
+    ctx = ht.cpu(0)
+    comm = ht.get_worker_communicate()
+
+    name = 0
+    comm.InitTensor(name, ctypes.c_int(1), ctypes.c_int(args.nitem),
+                    ctypes.c_int(args.width), ctypes.c_int(0),
+                    ctypes.c_double(0), ctypes.c_double(1),
+                    ctypes.c_ulonglong(123), ctypes.c_int(0),
+                    (ctypes.c_float * 1)(0.1), ctypes.c_int(1))
+
+    np.random.seed(123)
+    inarr = ht.array(np.random.rand(args.ind_len, args.width), ctx=ctx)
+    outarr = ht.array(np.zeros((args.ind_len, args.width)), ctx=ctx)
+    indices = [ht.array(zipf_indices(args), ctx=ctx) for _ in range(16)]
+
+    start = time.time()
+    for i in range(args.iters):
+        ind = indices[i % len(indices)]
+        comm.SparsePush(name, ind.handle, inarr.handle, None)
+        comm.Wait(name)
+        comm.SparsePull(name, ind.handle, outarr.handle)
+        comm.Wait(name)
+    elapsed = time.time() - start
+
+    # rows of the same id must be pulled identically
+    ind = indices[(args.iters - 1) % len(indices)].asnumpy().astype(np.int64)
+    out = outarr.asnumpy()
+    _, first = np.unique(ind, return_index=True)
+    assert np.array_equal(out, out[first[np.searchsorted(ind[first], ind)]])
+    result.put(args.iters * args.ind_len / elapsed)
+    comm.ClearOnServer(name)
+    comm.Clear(name)
+
+
+def start_process(settings, args, result):
+    for key, value in settings.items():
+        os.environ[key] = str(value)
+    if os.environ['DMLC_ROLE'] == "server":
+        ht.server_init()
+        ht.server_finish()
+    elif os.environ['DMLC_ROLE'] == "worker":
+        ht.worker_init()
+        test(args, result)
+        ht.worker_finish()
+    elif os.environ['DMLC_ROLE'] == "scheduler":
+        ht.scheduler_init()
+        ht.scheduler_finish()
+    else:
+        raise ValueError("Unknown role", os.environ['DMLC_ROLE'])
+
+
+def signal_handler(signal, frame):
+    print("SIGINT signal caught, stop Training")
+    for proc in process_list:
+        proc.kill()
+    exit(0)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--dedup", nargs='+', default=['map', 'radix'],
+                        choices=['map', 'radix'])
+    parser.add_argument("--worker-threads", type=int, default=4)
+    parser.add_argument("--nitem", type=int, default=10000000)
+    parser.add_argument("--width", type=int, default=16)
+    parser.add_argument("--ind-len", type=int, default=1000000)
+    parser.add_argument("--zipf", type=float, default=1.1)
+    parser.add_argument("--iters", type=int, default=20)
+    parser.add_argument("--port", type=int, default=13400)
+    args = parser.parse_args()
+    signal.signal(signal.SIGINT, signal_handler)
+    for dedup in args.dedup:
+        settings = make_settings(dedup, args.worker_threads, args.port)
+        result = multiprocessing.Queue()
+        process_list = []
+        for value in settings.values():
+            proc = multiprocessing.Process(
+                target=start_process, args=[value, args, result])
+            process_list.append(proc)
+            proc.start()
+        for proc in process_list:
+            proc.join()
+        print("{} dedup, {} worker threads: {:.0f} rows/s".format(
+            dedup, args.worker_threads, result.get()))
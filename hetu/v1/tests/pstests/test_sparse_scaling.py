@@ -0,0 +1,124 @@
+import hetu as ht
+
+import time
+import os
+import multiprocessing
+import argparse
+import signal
+import numpy as np
+import ctypes
+
+
+# Several workers push (and pull) disjoint rows of one sparse table on a
+# single server, using the zmq van on localhost. With row locks on the server
+# the throughput should grow with the number of workers and PS_SERVER_THREADS.
+def make_settings(num_workers, server_threads, port):
+    shared = {
+        'DMLC_PS_ROOT_URI': '127.0.0.1',
+        'DMLC_PS_ROOT_PORT': port,
+        'DMLC_NUM_WORKER': num_workers,
+        'DMLC_NUM_SERVER': 1,
+        'DMLC_PS_VAN_TYPE': 'zmq',
+        'PS_SERVER_THREADS': server_threads,
+    }
+    settings = {'sched': dict(shared, DMLC_ROLE='scheduler')}
+    settings['s0'] = dict(shared, DMLC_ROLE='server', SERVER_ID=0,
+                          DMLC_PS_SERVER_URI='127.0.0.1',
+                          DMLC_PS_SERVER_PORT=port + 1)
+    for i in range(num_workers):
+        settings['w%d' % i] = dict(shared, DMLC_ROLE='worker', WORKER_ID=i,
+                                   DMLC_PS_WORKER_URI='127.0.0.1',
+                                   DMLC_PS_WORKER_PORT=port + 10 + i)
+    return settings
+
+
+def test(args, result):
+    ctx = ht.cpu(0)
+    rank = int(os.environ["WORKER_ID"])
+    nrank = int(os.environ["DMLC_NUM_WORKER"])
+    comm = ht.get_worker_communicate()
+
+    name = 0
+    comm.InitTensor(name, ctypes.c_int(1), ctypes.c_int(args.nitem),
+                    ctypes.c_int(args.width), ctypes.c_int(0),
+                    ctypes.c_double(0), ctypes.c_double(1),
+                    ctypes.c_ulonglong(123), ctypes.c_int(0),
+                    (ctypes.c_float * 1)(0.1), ctypes.c_int(1))
+    comm.BarrierWorker()
+
+    # each worker owns a contiguous block of rows
+    rows_per_worker = args.nitem // nrank
+    low = rank * rows_per_worker
+    inarr = ht.array(np.random.rand(args.ind_len, args.width), ctx=ctx)
+    outarr = ht.array(np.zeros((args.ind_len, args.width)), ctx=ctx)
+    indices = [ht.array(np.random.randint(
+        low=low, high=low + rows_per_worker,
+        size=(args.ind_len,)).astype(np.float32), ctx=ctx) for _ in range(16)]
+
+    start = time.time()
+    for i in range(args.iters):
+        ind = indices[i % len(indices)]
+        if args.func == 'sparsepush':
+            comm.SparsePush(name, ind.handle, inarr.handle, None)
+        else:
+            comm.SSPushPull(name, ind.handle, inarr.handle,
+                            ind.handle, outarr.handle, None)
+        comm.Wait(name)
+    elapsed = time.time() - start
+    comm.BarrierWorker()
+    result.put(args.iters * args.ind_len / elapsed)
+    comm.ClearOnServer(name)
+    comm.Clear(name)
+
+
+def start_process(settings, args, result):
+    for key, value in settings.items():
+        os.environ[key] = str(value)
+    if os.environ['DMLC_ROLE'] == "server":
+        ht.server_init()
+        ht.server_finish()
+    elif os.environ['DMLC_ROLE'] == "worker":
+        ht.worker_init()
+        test(args, result)
+        ht.worker_finish()
+    elif os.environ['DMLC_ROLE'] == "scheduler":
+        ht.scheduler_init()
+        ht.scheduler_finish()
+    else:
+        raise ValueError("Unknown role", os.environ['DMLC_ROLE'])
+
+
+def signal_handler(signal, frame):
+    print("SIGINT signal caught, stop Training")
+    for proc in process_list:
+        proc.kill()
+    exit(0)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--workers", type=int, nargs='+', default=[1, 2, 4])
+    parser.add_argument("--server-threads", type=int, default=4)
+    parser.add_argument("--func", default='sparsepush',
+                        choices=['sparsepush', 'sspushpull'])
+    parser.add_argument("--nitem", type=int, default=1000000)
+    parser.add_argument("--width", type=int, default=128)
+    parser.add_argument("--ind-len", type=int, default=10000)
+    parser.add_argument("--iters", type=int, default=100)
+    parser.add_argument("--port", type=int, default=13300)
+    args = parser.parse_args()
+    signal.signal(signal.SIGINT, signal_handler)
+    for num_workers in args.workers:
+        settings = make_settings(num_workers, args.server_threads, args.port)
+        result = multiprocessing.Queue()
+        process_list = []
+        for value in settings.values():
+            proc = multiprocessing.Process(
+                target=start_process, args=[value, args, result])
+            process_list.append(proc)
+            proc.start()
+        for proc in process_list:
+            proc.join()
+        speeds = [result.get() for _ in range(num_workers)]
+        print("{} workers, {} server threads: {:.0f} rows/s".format(
+            num_workers, args.server_threads, sum(speeds)))
@@ -138,10 +138,8 @@ class _AutocastContext(object):
     def __exit__(self, e_type, e_value, e_trace):
         _hetu_core._internal_context.pop_autocast_ctx()
 
-def autocast():
-    return _AutocastContext()
-
-def autocast(dtype):
+def autocast(dtype = None):
+    # without a dtype, ops placed on CPU run in bfloat16
     return _AutocastContext(dtype)
 
 class _RunLevel(object):
@@ -6,6 +6,7 @@
 #include "hetu/_binding/utils/decl_utils.h"
 #include "hetu/_binding/utils/arg_parser.h"
 #include "hetu/graph/ops/kernel_links.h"
+#include "hetu/core/safetensors.h"
 
 namespace hetu {
 
@@ -341,6 +342,64 @@ PyObject* PyNDArray_view(PyNDArray* self, PyObject* args, PyObject* kwargs) {
   HT_PY_FUNC_END
 }
 
+PyObject* PyNDArray_save_safetensors(PyObject*, PyObject* args,
+                                     PyObject* kwargs) {
+  HT_PY_FUNC_BEGIN
+  static PyArgParser parser({
+    "save_safetensors(std::string path, List[str] names, List[NDArray] arrays, bool non_blocking=false)",
+  });
+  auto parsed_args = parser.parse(args, kwargs);
+  if (parsed_args.signature_index() == 0) {
+    auto names = parsed_args.get_string_list(1);
+    auto arrays = parsed_args.get_ndarray_list(2);
+    HT_VALUE_ERROR_IF(names.size() != arrays.size())
+      << "Got " << names.size() << " names but " << arrays.size()
+      << " arrays";
+    SafeTensorsWriter writer;
+    for (size_t i = 0; i < names.size(); i++)
+      writer.Add(names[i], arrays[i]);
+    if (parsed_args.get_bool_or_default(3))
+      writer.SaveAsync(parsed_args.get_string(0));
+    else
+      writer.Save(parsed_args.get_string(0));
+    Py_RETURN_NONE;
+  } else {
+    HT_PY_PARSER_INCORRECT_SIGNATURE(parsed_args);
+    __builtin_unreachable();
+  }
+  HT_PY_FUNC_END
+}
+
+PyObject* PyNDArray_sync_safetensors(PyObject*, PyObject* args) {
+  HT_PY_FUNC_BEGIN
+  Stream(Device(kCPU), kSafeTensorsStream).Sync();
+  Py_RETURN_NONE;
+  HT_PY_FUNC_END
+}
+
+PyObject* PyNDArray_load_safetensors(PyObject*, PyObject* args,
+                                     PyObject* kwargs) {
+  HT_PY_FUNC_BEGIN
+  static PyArgParser parser({
+    "load_safetensors(std::string path)",
+  });
+  auto parsed_args = parser.parse(args, kwargs);
+  if (parsed_args.signature_index() == 0) {
+    SafeTensorsReader reader(parsed_args.get_string(0));
+    PyObject* ret = PyDict_New();
+    for (const auto& name : reader.names()) {
+      PyObject* array = PyNDArray_New(reader.Get(name));
+      PyDict_SetItemString(ret, name.c_str(), array);
+      Py_DECREF(array);
+    }
+    return ret;
+  } else {
+    HT_PY_PARSER_INCORRECT_SIGNATURE(parsed_args);
+    __builtin_unreachable();
+  }
+  HT_PY_FUNC_END
+}
+
 // NOLINTNEXTLINE
 PyGetSetDef PyNDArray_properties[] = {
   {PY_GET_SET_DEF_NAME("device"), (getter) PyNDArray_device, nullptr, nullptr, nullptr}, 
@@ -414,6 +473,9 @@ std::vector<PyMethodDef> InitNDArrayPyClassMethodDefs() {
   AddPyMethodDefs(ret, {
     // TODO: wrap from_numpy of NDArray in a capsule
     {"numpy_to_NDArray", (PyCFunction) PyNDArray_from_numpy, METH_VARARGS | METH_KEYWORDS, nullptr }, 
+    {"save_safetensors", (PyCFunction) PyNDArray_save_safetensors, METH_VARARGS | METH_KEYWORDS, nullptr }, 
+    {"load_safetensors", (PyCFunction) PyNDArray_load_safetensors, METH_VARARGS | METH_KEYWORDS, nullptr }, 
+    {"sync_safetensors", (PyCFunction) PyNDArray_sync_safetensors, METH_NOARGS, nullptr }, 
     {nullptr}
   });
   AddPyMethodDefs(ret, hetu::impl::get_registered_ndarray_class_methods());
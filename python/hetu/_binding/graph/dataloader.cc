@@ -40,6 +40,7 @@ inline PyObject* PyDataloader_pynew(PyTypeObject* type, PyObject* args,
   static PyArgParser parser({
     "Dataloader(numpy.array raw_data, int batch_size, int num_workers=0, std::string name='default', bool shuffle=false, bool drop_last=true)", 
     "Dataloader(NDArray raw_data, int batch_size, int num_workers=0, std::string name='default', bool shuffle=false, bool drop_last=true)", 
+    "Dataloader(List[str] shard_paths, int batch_size, int num_workers=0, std::string name='default', bool shuffle=false, bool drop_last=true, int prefetch=4, bool pin_memory=true, int seed=0)", 
   });
   auto parsed_args = parser.parse(args, kwargs);
   
@@ -63,6 +64,17 @@ inline PyObject* PyDataloader_pynew(PyTypeObject* type, PyObject* args,
                                   parsed_args.get_string_or_default(3), 
                                   parsed_args.get_bool_or_default(4), 
                                   parsed_args.get_bool_or_default(5));
+  } else if (parsed_args.signature_index() == 2) {
+    new(&self->dataloader) Dataloader();
+    self->dataloader = Dataloader(parsed_args.get_string_list(0),
+                                  parsed_args.get_int64(1),
+                                  parsed_args.get_int64_or_default(2), 
+                                  parsed_args.get_string_or_default(3), 
+                                  parsed_args.get_bool_or_default(4), 
+                                  parsed_args.get_bool_or_default(5), 
+                                  parsed_args.get_int64_or_default(6), 
+                                  parsed_args.get_bool_or_default(7), 
+                                  parsed_args.get_int64_or_default(8));
   } else {
     Py_TYPE(self)->tp_free(self);
     HT_PY_PARSER_INCORRECT_SIGNATURE(parsed_args);
@@ -207,6 +219,28 @@ PyObject* PyDataloader_get_next_data(PyDataloader* self, PyObject* args, PyObjec
 //   HT_PY_FUNC_END
 // }
 
+PyObject* PyDataloader_write_mmap_shard(PyObject*, PyObject* args,
+                                        PyObject* kwargs) {
+  HT_PY_FUNC_BEGIN
+  static PyArgParser parser({
+    "write_mmap_shard(std::string path, numpy.array data)", 
+    "write_mmap_shard(std::string path, NDArray data)", 
+  });
+  auto parsed_args = parser.parse(args, kwargs);
+  if (parsed_args.signature_index() == 0) {
+    MmapDataset::WriteShard(parsed_args.get_string(0),
+                            NDArrayFromNumpy(parsed_args.get_numpy_array(1)));
+  } else if (parsed_args.signature_index() == 1) {
+    MmapDataset::WriteShard(parsed_args.get_string(0),
+                            parsed_args.get_ndarray(1));
+  } else {
+    HT_PY_PARSER_INCORRECT_SIGNATURE(parsed_args);
+    __builtin_unreachable();
+  }
+  Py_RETURN_NONE;
+  HT_PY_FUNC_END
+}
+
 // NOLINTNEXTLINE
 PyGetSetDef PyDataloader_properties[] = {
   {PY_GET_SET_DEF_NAME("num_workers"), (getter) PyDataloader_num_workers, nullptr, nullptr, nullptr}, 
@@ -277,6 +311,7 @@ std::vector<PyMethodDef> InitDataloaderPyClassMethodDefs() {
   std::vector<PyMethodDef> ret = {{nullptr}};
   AddPyMethodDefs(ret, {
     // {"from_numpy", (PyCFunction) PyDataloader_from_numpy, METH_VARARGS | METH_KEYWORDS, nullptr }, 
+    {"write_mmap_shard", (PyCFunction) PyDataloader_write_mmap_shard, METH_VARARGS | METH_KEYWORDS, nullptr }, 
     {nullptr}
   });
   AddPyMethodDefs(ret, hetu::graph::get_registered_dataloader_class_methods());
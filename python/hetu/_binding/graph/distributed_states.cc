@@ -1,9 +1,11 @@
 #include "hetu/_binding/graph/distributed_states.h"
 #include "hetu/_binding/core/device.h"
+#include "hetu/_binding/core/ndarray.h"
 #include "hetu/_binding/utils/except.h"
 #include "hetu/_binding/utils/arg_parser.h"
 #include "hetu/_binding/utils/decl_utils.h"
 #include "hetu/_binding/utils/function_registry.h"
+#include "hetu/graph/checkpoint/sharded_safetensors.h"
 
 namespace hetu {
 namespace graph {
@@ -230,6 +232,64 @@ PyObject* PyDistributedStates_get_dup_group_index(PyDistributedStates* self, PyO
   HT_PY_FUNC_END
 }
 
+PyObject* PyDistributedStates_save_sharded_safetensors(PyObject*,
+                                                       PyObject* args,
+                                                       PyObject* kwargs) {
+  HT_PY_FUNC_BEGIN
+  static PyArgParser parser({
+    "save_sharded_safetensors(std::string dir, int rank, int num_ranks, List[str] names, List[NDArray] shards, List[DistributedStates] ds_list, bool non_blocking=false)",
+  });
+  auto parsed_args = parser.parse(args, kwargs);
+  if (parsed_args.signature_index() == 0) {
+    SaveShardedSafeTensors(parsed_args.get_string(0),
+                           parsed_args.get_int64(1),
+                           parsed_args.get_int64(2),
+                           parsed_args.get_string_list(3),
+                           parsed_args.get_ndarray_list(4),
+                           parsed_args.get_distributed_states_list(5),
+                           parsed_args.get_bool_or_default(6));
+    Py_RETURN_NONE;
+  } else {
+    HT_PY_PARSER_INCORRECT_SIGNATURE(parsed_args);
+    __builtin_unreachable();
+  }
+  HT_PY_FUNC_END
+}
+
+PyObject* PyDistributedStates_load_sharded_safetensors(PyObject*,
+                                                       PyObject* args,
+                                                       PyObject* kwargs) {
+  HT_PY_FUNC_BEGIN
+  static PyArgParser parser({
+    "load_sharded_safetensors(std::string dir, int rank, int num_ranks)",
+  });
+  auto parsed_args = parser.parse(args, kwargs);
+  if (parsed_args.signature_index() == 0) {
+    auto tensors = LoadShardedSafeTensors(parsed_args.get_string(0),
+                                          parsed_args.get_int64(1),
+                                          parsed_args.get_int64(2));
+    // Returns {name: (shard, distributed states)}
+    PyObject* ret = PyDict_New();
+    for (const auto& kv : tensors) {
+      PyObject* item = PyTuple_New(2);
+      PyTuple_SET_ITEM(item, 0, PyNDArray_New(kv.second.shard));
+      if (kv.second.ds.is_valid()) {
+        PyTuple_SET_ITEM(item, 1, PyDistributedStates_New(kv.second.ds));
+      } else {
+        Py_INCREF(Py_None);
+        PyTuple_SET_ITEM(item, 1, Py_None);
+      }
+      PyDict_SetItemString(ret, kv.first.c_str(), item);
+      Py_DECREF(item);
+    }
+    return ret;
+  } else {
+    HT_PY_PARSER_INCORRECT_SIGNATURE(parsed_args);
+    __builtin_unreachable();
+  }
+  HT_PY_FUNC_END
+}
+
 // NOLINTNEXTLINE
 PyGetSetDef PyDistributedStates_properties[] = {
   {PY_GET_SET_DEF_NAME("device_num"), (getter) PyDistributedStates_device_num, nullptr, nullptr, nullptr},
@@ -391,6 +451,8 @@ std::vector<PyMethodDef> InitDistributedStatesPyClassMethodDefs() {
   std::vector<PyMethodDef> ret = {{nullptr}};
   AddPyMethodDefs(ret, {
     {"map_to_local_data", (PyCFunction) PyDistributedStates_map_to_local_data, METH_VARARGS | METH_KEYWORDS, nullptr },
+    {"save_sharded_safetensors", (PyCFunction) PyDistributedStates_save_sharded_safetensors, METH_VARARGS | METH_KEYWORDS, nullptr },
+    {"load_sharded_safetensors", (PyCFunction) PyDistributedStates_load_sharded_safetensors, METH_VARARGS | METH_KEYWORDS, nullptr },
     {nullptr}
   });
   AddPyMethodDefs(ret, hetu::graph::get_registered_tensor_class_methods()); // TODO: register distributed states class methods
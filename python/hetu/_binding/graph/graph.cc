@@ -105,6 +105,83 @@ PyObject* PyGraph_merge_strategy(PyGraph* self, PyObject* args, PyObject* kwargs
   HT_PY_FUNC_END
 }
 
+PyObject* PyGraph_set_shape_buckets(PyGraph* self, PyObject* args, PyObject* kwargs) {
+  HT_PY_FUNC_BEGIN
+  static PyArgParser parser({
+    "set_shape_buckets(Tensor tensor, int dim, List[int] buckets, double pad_value=0)", 
+    "set_shape_buckets()"
+  });
+  auto parsed_args = parser.parse(args, kwargs);
+  auto& graph = Graph::GetGraph(self->graph_id);
+  HT_ASSERT(graph.type() == GraphType::DEFINE_AND_RUN)
+    << "Shape buckets are only supported by define graphs";
+  if (parsed_args.signature_index() == 0) {
+    dynamic_cast<DefineAndRunGraph&>(graph).SetShapeBuckets(
+      parsed_args.get_tensor(0), 
+      parsed_args.get_int64(1), 
+      parsed_args.get_int64_list(2), 
+      parsed_args.get_float64_or_default(3));
+    Py_RETURN_NONE;
+  } else if (parsed_args.signature_index() == 1) {
+    // clear all buckets
+    dynamic_cast<DefineAndRunGraph&>(graph).ClearShapeBuckets();
+    Py_RETURN_NONE;
+  } else {
+    HT_PY_PARSER_INCORRECT_SIGNATURE(parsed_args);
+    __builtin_unreachable();
+  }  
+  HT_PY_FUNC_END
+}
+
+PyObject* PyGraph_plan_cache_stats(PyGraph* self) {
+  HT_PY_FUNC_BEGIN
+  auto& graph = Graph::GetGraph(self->graph_id);
+  HT_ASSERT(graph.type() == GraphType::DEFINE_AND_RUN)
+    << "Plan caches are only used by define graphs";
+  const auto& stats = dynamic_cast<DefineAndRunGraph&>(graph).plan_cache_stats();
+  PyObject* ret = PyDict_New();
+  auto set_item = [&](const char* key, PyObject* value) {
+    PyDict_SetItemString(ret, key, value);
+    Py_DECREF(value);
+  };
+  set_item("exec_plan_hits", PyLong_FromInteger(stats.exec_plan_hits));
+  set_item("exec_plan_misses", PyLong_FromInteger(stats.exec_plan_misses));
+  set_item("shape_plan_hits", PyLong_FromInteger(stats.shape_plan_hits));
+  set_item("shape_plan_misses", PyLong_FromInteger(stats.shape_plan_misses));
+  set_item("compile_time_ms", PyFloat_FromDouble(stats.compile_time_ms));
+  return ret;
+  HT_PY_FUNC_END
+}
+
+PyObject* PyGraph_num_elided_events(PyGraph* self) {
+  HT_PY_FUNC_BEGIN
+  auto& graph = Graph::GetGraph(self->graph_id);
+  HT_ASSERT(graph.type() == GraphType::DEFINE_AND_RUN)
+    << "Events are only elided by define graphs";
+  return PyLong_FromInteger(
+    dynamic_cast<DefineAndRunGraph&>(graph).num_elided_events());
+  HT_PY_FUNC_END
+}
+
+PyObject* PyGraph_memory_plan_stats(PyGraph* self) {
+  HT_PY_FUNC_BEGIN
+  auto& graph = Graph::GetGraph(self->graph_id);
+  HT_ASSERT(graph.type() == GraphType::DEFINE_AND_RUN)
+    << "Memory plans are only made by define graphs";
+  auto stats = dynamic_cast<DefineAndRunGraph&>(graph).memory_plan_stats();
+  PyObject* ret = PyDict_New();
+  auto set_item = [&](const char* key, PyObject* value) {
+    PyDict_SetItemString(ret, key, value);
+    Py_DECREF(value);
+  };
+  set_item("num_tensors", PyLong_FromInteger(stats.num_tensors));
+  set_item("peak_size", PyLong_FromInteger(stats.peak_size));
+  set_item("live_size", PyLong_FromInteger(stats.live_size));
+  set_item("total_size", PyLong_FromInteger(stats.total_size));
+  return ret;
+  HT_PY_FUNC_END
+}
+
 PyObject* PyGraph_run(PyGraph* self, PyObject* args, PyObject* kwargs) {
   HT_PY_FUNC_BEGIN
   static PyArgParser parser({
@@ -302,6 +379,9 @@ PyGetSetDef PyGraph_properties[] = {
   {PY_GET_SET_DEF_NAME("cur_strategy_id"), (getter) PyGraph_cur_strategy_id, nullptr, nullptr, nullptr}, 
   {PY_GET_SET_DEF_NAME("use_hetero_id"), (getter) PyGraph_use_hetero_id, nullptr, nullptr, nullptr}, 
   {PY_GET_SET_DEF_NAME("cur_hetero_id"), (getter) PyGraph_cur_hetero_id, nullptr, nullptr, nullptr}, 
+  {PY_GET_SET_DEF_NAME("plan_cache_stats"), (getter) PyGraph_plan_cache_stats, nullptr, nullptr, nullptr}, 
+  {PY_GET_SET_DEF_NAME("num_elided_events"), (getter) PyGraph_num_elided_events, nullptr, nullptr, nullptr}, 
+  {PY_GET_SET_DEF_NAME("memory_plan_stats"), (getter) PyGraph_memory_plan_stats, nullptr, nullptr, nullptr}, 
   {nullptr}
 };
 
@@ -310,6 +390,7 @@ PyMethodDef PyGraph_methods[] = {
   {"run", (PyCFunction) PyGraph_run, METH_VARARGS | METH_KEYWORDS, nullptr }, 
   {"set_num_strategy", (PyCFunction) PyGraph_set_num_strategy, METH_VARARGS | METH_KEYWORDS, nullptr },
   {"merge_strategy", (PyCFunction) PyGraph_merge_strategy, METH_VARARGS | METH_KEYWORDS, nullptr },  
+  {"set_shape_buckets", (PyCFunction) PyGraph_set_shape_buckets, METH_VARARGS | METH_KEYWORDS, nullptr },  
   {nullptr}
 };
 
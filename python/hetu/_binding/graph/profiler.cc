@@ -6,6 +6,7 @@
 #include "hetu/_binding/utils/decl_utils.h"
 #include "hetu/_binding/utils/arg_parser.h"
 #include "hetu/impl/profiler/profiler.h"
+#include "hetu/impl/utils/dnnl_utils.h"
 
 namespace hetu {
 namespace impl {
@@ -179,6 +180,22 @@ PyObject* PyProfileSummary(PyProfile* self, PyObject* args, PyObject* kwargs) {
       PyDict_SetItemString(py_dict, "optype_with_inputs_view", py_list_optype_with_inputs_view);
       Py_DECREF(py_list_optype_with_inputs_view);
     }
+    // the process-wide oneDNN primitive cache shared by all CPU kernels
+    auto cache_stats = hetu::cpu::DNNLPrimitiveCache::GetInstance().GetStats();
+    PyObject* py_dict_dnnl_cache = PyDict_New();
+    for (const auto& field :
+         {std::make_pair("hits", cache_stats.hits),
+          std::make_pair("misses", cache_stats.misses),
+          std::make_pair("evictions", cache_stats.evictions),
+          std::make_pair("size", static_cast<uint64_t>(cache_stats.size)),
+          std::make_pair("capacity",
+                         static_cast<uint64_t>(cache_stats.capacity))}) {
+      PyObject* value = PyLong_FromUnsignedLongLong(field.second);
+      PyDict_SetItemString(py_dict_dnnl_cache, field.first, value);
+      Py_DECREF(value);
+    }
+    PyDict_SetItemString(py_dict, "dnnl_primitive_cache", py_dict_dnnl_cache);
+    Py_DECREF(py_dict_dnnl_cache);
     auto graph_view = profiler->get_graph_view();
     if (graph_view.size() == 0)
       return py_dict;
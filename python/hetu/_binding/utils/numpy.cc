@@ -181,8 +181,11 @@ NDArray NDArrayFromNumpy(PyObject* obj, const HTShape& dynamic_shape, DataType d
                         : meta.numel() * element_size;
   auto storage = std::make_shared<NDArrayStorage>(BorrowToMemoryPool(
     Device(kCPU), ptr, borrow_size, [obj](DataPtr ptr) {
-      py::call_guard<py::gil_scoped_acquire>();
-      // py::gil_scoped_acquire gil;
+      // The last reference may be dropped by any thread, e.g., a CPU stream
+      // worker. Nothing can be released once the interpreter is gone.
+      if (!Py_IsInitialized())
+        return;
+      py::gil_scoped_acquire gil;
       Py_DECREF(obj);
     }));
 
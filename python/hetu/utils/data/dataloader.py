@@ -22,7 +22,8 @@ class DataLoader():
 
     def __init__(self, dataset, batch_size: Optional[int] = 1,
                  shuffle: bool = False, num_workers: int = 0, 
-                 pin_memory: bool = False, drop_last: bool = False):
+                 pin_memory: bool = False, drop_last: bool = False,
+                 prefetch: int = 4, seed: int = 0):
         if num_workers < 0:
             raise ValueError('num_workers option should be non-negative; '
                              'use num_workers=0 to disable multiprocessing.')
@@ -30,8 +31,16 @@ class DataLoader():
         self.dataset = dataset
         self.num_workers = num_workers
         self.pin_memory = pin_memory
-        self.dataloader_c = hetu.Dataloader(dataset, batch_size, num_workers,
-                                            "default", shuffle, drop_last)
+        if isinstance(dataset, (list, tuple)) and \
+                all(isinstance(path, str) for path in dataset):
+            # paths of shards written by `hetu.write_mmap_shard`
+            self.dataloader_c = hetu.Dataloader(list(dataset), batch_size,
+                                                num_workers, "default", shuffle,
+                                                drop_last, prefetch, pin_memory,
+                                                seed)
+        else:
+            self.dataloader_c = hetu.Dataloader(dataset, batch_size, num_workers,
+                                                "default", shuffle, drop_last)
         print(self.dataloader_c.batch_num)
 
         # Arg-check dataset related before checking samplers because we want to
@@ -0,0 +1,225 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/graph/ops/kernel_links.h"
+#include "test_utils.h"
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace hetu;
+
+// Unfused attention of one sequence and head: materializes the scores, the
+// way separate matmul and softmax ops would. Rows are tokens, [len, dim].
+struct NaiveAttention {
+  int64_t len_q, len_k, dim;
+  float scale;
+  bool is_causal;
+  std::vector<float> probs; // [len_q, len_k]
+
+  bool visible(int64_t i, int64_t j) const {
+    return !is_causal || j <= i + len_k - len_q;
+  }
+
+  void Forward(const float* q, const float* k, const float* v, float* out) {
+    probs.assign(len_q * len_k, 0.f);
+    for (int64_t i = 0; i < len_q; i++) {
+      float max_score = -std::numeric_limits<float>::infinity();
+      for (int64_t j = 0; j < len_k; j++) {
+        if (!visible(i, j))
+          continue;
+        float score = 0;
+        for (int64_t d = 0; d < dim; d++)
+          score += q[i * dim + d] * k[j * dim + d];
+        probs[i * len_k + j] = score * scale;
+        max_score = std::max(max_score, score * scale);
+      }
+      float sum = 0;
+      for (int64_t j = 0; j < len_k; j++) {
+        float p = visible(i, j) ? std::exp(probs[i * len_k + j] - max_score) : 0;
+        probs[i * len_k + j] = p;
+        sum += p;
+      }
+      for (int64_t j = 0; j < len_k; j++)
+        probs[i * len_k + j] = sum > 0 ? probs[i * len_k + j] / sum : 0;
+      for (int64_t d = 0; d < dim; d++) {
+        float o = 0;
+        for (int64_t j = 0; j < len_k; j++)
+          o += probs[i * len_k + j] * v[j * dim + d];
+        out[i * dim + d] = o;
+      }
+    }
+  }
+
+  // Accumulates into dq, dk and dv.
+  void Backward(const float* dout, const float* q, const float* k,
+                const float* v, float* dq, float* dk, float* dv) {
+    for (int64_t i = 0; i < len_q; i++) {
+      std::vector<float> dp(len_k, 0);
+      float row = 0;
+      for (int64_t j = 0; j < len_k; j++) {
+        for (int64_t d = 0; d < dim; d++)
+          dp[j] += dout[i * dim + d] * v[j * dim + d];
+        row += dp[j] * probs[i * len_k + j];
+      }
+      for (int64_t j = 0; j < len_k; j++) {
+        float p = probs[i * len_k + j];
+        float ds = p * (dp[j] - row) * scale;
+        for (int64_t d = 0; d < dim; d++) {
+          dv[j * dim + d] += p * dout[i * dim + d];
+          dq[i * dim + d] += ds * k[j * dim + d];
+          dk[j * dim + d] += ds * q[i * dim + d];
+        }
+      }
+    }
+  }
+};
+
+// Copies the rows [begin, begin + len) of one head out of [total, heads, dim].
+std::vector<float> GatherHead(const float* src, int64_t begin, int64_t len,
+                              int64_t heads, int64_t h, int64_t dim) {
+  std::vector<float> dst(len * dim);
+  for (int64_t i = 0; i < len; i++)
+    for (int64_t d = 0; d < dim; d++)
+      dst[i * dim + d] = src[((begin + i) * heads + h) * dim + d];
+  return dst;
+}
+
+void ScatterHead(const std::vector<float>& src, float* dst, int64_t begin,
+                 int64_t len, int64_t heads, int64_t h, int64_t dim) {
+  for (int64_t i = 0; i < len; i++)
+    for (int64_t d = 0; d < dim; d++)
+      dst[((begin + i) * heads + h) * dim + d] += src[i * dim + d];
+}
+
+void CheckClose(const std::string& name, const NDArray& actual,
+                const std::vector<float>& expected, float tol) {
+  const float* ptr = actual->data_ptr<float>();
+  for (size_t i = 0; i < expected.size(); i++)
+    HT_ASSERT(std::abs(ptr[i] - expected[i]) <=
+              tol * std::max(1.0f, std::abs(expected[i])))
+      << name << " mismatched on position " << i << ": expected "
+      << expected[i] << ", got " << ptr[i];
+}
+
+// Runs packed sequences of the given lengths through the varlen kernels (or
+// the dense ones when all lengths are equal and `dense` is set) and compares
+// them with the unfused reference.
+void TestAttention(const std::vector<int>& seqlens_q,
+                   const std::vector<int>& seqlens_k, int64_t num_heads,
+                   int64_t num_heads_k, int64_t dim, bool is_causal,
+                   bool dense) {
+  HT_LOG_INFO << "Testing Attention (" << (dense ? "dense" : "varlen")
+              << ", " << seqlens_q.size() << " sequences of up to "
+              << *std::max_element(seqlens_q.begin(), seqlens_q.end())
+              << " x " << *std::max_element(seqlens_k.begin(), seqlens_k.end())
+              << ", heads " << num_heads << "/" << num_heads_k << ", dim "
+              << dim << (is_causal ? ", causal)..." : ")...");
+  Stream stream(Device(kCPU), kBlockingStream);
+  const int64_t batch_size = seqlens_q.size();
+  std::vector<int> cu_q(batch_size + 1, 0), cu_k(batch_size + 1, 0);
+  for (int64_t b = 0; b < batch_size; b++) {
+    cu_q[b + 1] = cu_q[b] + seqlens_q[b];
+    cu_k[b + 1] = cu_k[b] + seqlens_k[b];
+  }
+  const int max_q = *std::max_element(seqlens_q.begin(), seqlens_q.end());
+  const int max_k = *std::max_element(seqlens_k.begin(), seqlens_k.end());
+  const int64_t total_q = cu_q.back(), total_k = cu_k.back();
+  const float scale = 1.0 / std::sqrt(dim);
+
+  HTShape q_shape = {total_q, num_heads, dim},
+          k_shape = {total_k, num_heads_k, dim};
+  if (dense) {
+    q_shape = {batch_size, max_q, num_heads, dim};
+    k_shape = {batch_size, max_k, num_heads_k, dim};
+  }
+  auto q = NDArray::randn(q_shape, Device(kCPU), kFloat32, 0, 1, 1,
+                          kBlockingStream);
+  auto k = NDArray::randn(k_shape, Device(kCPU), kFloat32, 0, 1, 2,
+                          kBlockingStream);
+  auto v = NDArray::randn(k_shape, Device(kCPU), kFloat32, 0, 1, 3,
+                          kBlockingStream);
+  auto dout = NDArray::randn(q_shape, Device(kCPU), kFloat32, 0, 1, 4,
+                             kBlockingStream);
+
+  // reference
+  auto start = std::chrono::steady_clock::now();
+  std::vector<float> out_ref(total_q * num_heads * dim, 0),
+    dq_ref(total_q * num_heads * dim, 0), dk_ref(total_k * num_heads_k * dim, 0),
+    dv_ref(total_k * num_heads_k * dim, 0);
+  for (int64_t b = 0; b < batch_size; b++) {
+    for (int64_t h = 0; h < num_heads; h++) {
+      int64_t hk = h / (num_heads / num_heads_k);
+      NaiveAttention attn{seqlens_q[b], seqlens_k[b], dim, scale, is_causal};
+      auto qh = GatherHead(q->data_ptr<float>(), cu_q[b], seqlens_q[b],
+                           num_heads, h, dim);
+      auto kh = GatherHead(k->data_ptr<float>(), cu_k[b], seqlens_k[b],
+                           num_heads_k, hk, dim);
+      auto vh = GatherHead(v->data_ptr<float>(), cu_k[b], seqlens_k[b],
+                           num_heads_k, hk, dim);
+      auto gh = GatherHead(dout->data_ptr<float>(), cu_q[b], seqlens_q[b],
+                           num_heads, h, dim);
+      std::vector<float> oh(qh.size()), dqh(qh.size(), 0), dkh(kh.size(), 0),
+        dvh(vh.size(), 0);
+      attn.Forward(qh.data(), kh.data(), vh.data(), oh.data());
+      attn.Backward(gh.data(), qh.data(), kh.data(), vh.data(), dqh.data(),
+                    dkh.data(), dvh.data());
+      ScatterHead(oh, out_ref.data(), cu_q[b], seqlens_q[b], num_heads, h, dim);
+      ScatterHead(dqh, dq_ref.data(), cu_q[b], seqlens_q[b], num_heads, h, dim);
+      ScatterHead(dkh, dk_ref.data(), cu_k[b], seqlens_k[b], num_heads_k, hk,
+                  dim);
+      ScatterHead(dvh, dv_ref.data(), cu_k[b], seqlens_k[b], num_heads_k, hk,
+                  dim);
+    }
+  }
+  auto naive_time = std::chrono::steady_clock::now() - start;
+
+  auto out = NDArray::empty(q_shape, Device(kCPU), kFloat32);
+  auto lse = NDArray::empty({batch_size, num_heads, max_q}, Device(kCPU),
+                            kFloat32);
+  auto dq = NDArray::empty(q_shape, Device(kCPU), kFloat32);
+  auto dk = NDArray::empty(k_shape, Device(kCPU), kFloat32);
+  auto dv = NDArray::empty(k_shape, Device(kCPU), kFloat32);
+  NDArray q_padded, k_padded, v_padded, out_padded, p, rng_state;
+  auto cu_q_arr = NDArray::empty({batch_size + 1}, Device(kCPU), kInt32);
+  auto cu_k_arr = NDArray::empty({batch_size + 1}, Device(kCPU), kInt32);
+  std::copy(cu_q.begin(), cu_q.end(), cu_q_arr->data_ptr<int>());
+  std::copy(cu_k.begin(), cu_k.end(), cu_k_arr->data_ptr<int>());
+
+  start = std::chrono::steady_clock::now();
+  if (dense) {
+    impl::FlashAttnCpu(q, k, v, out, q_padded, k_padded, v_padded, out_padded,
+                       lse, p, rng_state, 0, scale, is_causal, false, stream);
+    impl::FlashAttnGradientCpu(dout, q, k, v, out, lse, rng_state, dq, dk, dv,
+                               0, scale, is_causal, stream);
+  } else {
+    impl::FlashAttnVarlenCpu(q, k, v, cu_q_arr, cu_k_arr, out, q_padded,
+                             k_padded, v_padded, out_padded, lse, p,
+                             rng_state, max_q, max_k, 0, scale, false,
+                             is_causal, false, stream);
+    impl::FlashAttnVarlenGradientCpu(dout, q, k, v, cu_q_arr, cu_k_arr, out,
+                                     lse, rng_state, dq, dk, dv, max_q, max_k,
+                                     0, scale, false, is_causal, stream);
+  }
+  auto fused_time = std::chrono::steady_clock::now() - start;
+
+  CheckClose("Attention out", out, out_ref, 1e-4);
+  CheckClose("Attention dq", dq, dq_ref, 1e-3);
+  CheckClose("Attention dk", dk, dk_ref, 1e-3);
+  CheckClose("Attention dv", dv, dv_ref, 1e-3);
+  HT_LOG_INFO << "Testing Attention done, fwd + bwd unfused (serial): "
+              << std::chrono::duration<double, std::milli>(naive_time).count()
+              << " ms, tiled: "
+              << std::chrono::duration<double, std::milli>(fused_time).count()
+              << " ms";
+}
+
+int main(int argc, char** argv) {
+  for (bool is_causal : {false, true}) {
+    TestAttention({100, 100}, {100, 100}, 4, 4, 32, is_causal, true);
+    TestAttention({70, 70}, {130, 130}, 4, 2, 24, is_causal, true);
+    TestAttention({1, 65, 200, 17}, {1, 65, 200, 40}, 6, 2, 64, is_causal,
+                  false);
+  }
+  TestAttention({1024, 1024}, {1024, 1024}, 8, 8, 64, true, true);
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include "hetu/impl/memory/CPUMemoryPool.h"
+#include "hetu/impl/stream/CPUStream.h"
+#include "test_utils.h"
+#include <atomic>
+#include <cstdlib>
+#include <future>
+
+using namespace hetu;
+using namespace hetu::impl;
+
+const Stream kCPUBlocking(Device(kCPU), kBlockingStream);
+const Stream kCPUComputing(Device(kCPU), kComputingStream);
+constexpr size_t kMiB = 1024 * 1024;
+
+void TestBorrowedDeleter() {
+  HT_LOG_INFO << "Testing deleters of borrowed data...";
+  CPUMemoryPool pool;
+  std::atomic<int> num_deleted{0};
+  auto deleter = [&num_deleted](DataPtr ptr) {
+    free(ptr.ptr);
+    num_deleted++;
+  };
+
+  // freed without being used by other streams: deleted right away
+  auto borrowed = pool.BorrowDataSpace(malloc(256), 256, deleter);
+  pool.FreeDataSpace(borrowed);
+  HT_ASSERT_EQ(num_deleted.load(), 1) << "The deleter was not called";
+
+  // used by a CPU stream: deleted by the join stream after the stream
+  borrowed = pool.BorrowDataSpace(malloc(256), 256, deleter);
+  pool.MarkDataSpaceUsedByStream(borrowed, kCPUComputing);
+  pool.FreeDataSpace(borrowed);
+  CPUStream(Stream(Device(kCPU), kJoinStream)).Sync();
+  HT_ASSERT_EQ(num_deleted.load(), 2) << "The deleter was not called";
+
+  // a deleter freeing other data of the same pool must not deadlock
+  auto owned = pool.AllocDataSpace(1024, kCPUBlocking);
+  borrowed = pool.BorrowDataSpace(
+    malloc(256), 256, [&pool, &num_deleted, owned](DataPtr ptr) {
+      pool.FreeDataSpace(owned);
+      free(ptr.ptr);
+      num_deleted++;
+    });
+  pool.FreeDataSpace(borrowed);
+  HT_ASSERT_EQ(num_deleted.load(), 3) << "The deleter was not called";
+  HT_LOG_INFO << "Testing deleters of borrowed data done";
+}
+
+void TestBinReuse() {
+  HT_LOG_INFO << "Testing reuse of small bins...";
+  CPUMemoryPool pool(true);
+  auto a = pool.AllocDataSpace(1000, kCPUBlocking);
+  HT_ASSERT(a.is_new_malloc) << "The first allocation must malloc";
+  pool.FreeDataSpace(a);
+  // 900 bytes fall into the same 1 KiB bin
+  auto b = pool.AllocDataSpace(900, kCPUBlocking);
+  HT_ASSERT(!b.is_new_malloc && b.ptr == a.ptr)
+    << "The freed block was not reused";
+  // 3000 bytes fall into the 4 KiB bin, which is empty
+  auto c = pool.AllocDataSpace(3000, kCPUBlocking);
+  HT_ASSERT(c.is_new_malloc && c.ptr != b.ptr)
+    << "A block of another bin was reused";
+  auto stats = pool.GetStats();
+  HT_ASSERT_EQ(stats.malloc_cnt, 2);
+  HT_ASSERT_EQ(stats.reuse_cnt, 1);
+  HT_ASSERT_EQ(stats.reserved, 1024 + 4096);
+  HT_ASSERT_EQ(stats.allocated, 1024 + 4096);
+  pool.FreeDataSpace(b);
+  pool.FreeDataSpace(c);
+  HT_ASSERT_EQ(pool.GetStats().allocated, 0);
+  HT_LOG_INFO << "Testing reuse of small bins done";
+}
+
+void TestCoalescing() {
+  HT_LOG_INFO << "Testing coalescing of large blocks...";
+  CPUMemoryPool pool(true);
+  auto seg = pool.AllocDataSpace(6 * kMiB, kCPUBlocking);
+  pool.FreeDataSpace(seg);
+  // carve three adjacent blocks out of the cached 6 MiB segment
+  auto a = pool.AllocDataSpace(2 * kMiB, kCPUBlocking);
+  auto b = pool.AllocDataSpace(2 * kMiB, kCPUBlocking);
+  auto c = pool.AllocDataSpace(2 * kMiB, kCPUBlocking);
+  HT_ASSERT(a.ptr == seg.ptr &&
+            b.ptr == static_cast<char*>(a.ptr) + 2 * kMiB &&
+            c.ptr == static_cast<char*>(b.ptr) + 2 * kMiB)
+    << "The blocks were not split from the cached segment";
+  auto stats = pool.GetStats();
+  HT_ASSERT_EQ(stats.malloc_cnt, 1);
+  HT_ASSERT_EQ(stats.split_cnt, 2);
+
+  // the free blocks on both sides of b are not adjacent
+  pool.FreeDataSpace(a);
+  pool.FreeDataSpace(c);
+  auto d = pool.AllocDataSpace(4 * kMiB, kCPUBlocking);
+  HT_ASSERT(d.is_new_malloc) << "Non-adjacent blocks were merged";
+  pool.FreeDataSpace(d);
+
+  // freeing b merges all three back into one block
+  pool.FreeDataSpace(b);
+  auto e = pool.AllocDataSpace(6 * kMiB, kCPUBlocking);
+  HT_ASSERT(!e.is_new_malloc && e.ptr == seg.ptr)
+    << "The adjacent free blocks were not coalesced";
+  stats = pool.GetStats();
+  HT_ASSERT_EQ(stats.malloc_cnt, 2);
+  HT_ASSERT_EQ(stats.reserved, 10 * kMiB);
+  pool.FreeDataSpace(e);
+  HT_LOG_INFO << "Testing coalescing of large blocks done";
+}
+
+void TestCrossStreamStash() {
+  HT_LOG_INFO << "Testing stashing of blocks freed on CPU streams...";
+  CPUMemoryPool pool(true);
+  // hold the computing stream so that the stashed blocks stay stashed
+  std::promise<void> gate;
+  auto gate_future = gate.get_future().share();
+  CPUStream(kCPUComputing).PostTask([gate_future]() { gate_future.wait(); });
+
+  auto a = pool.AllocDataSpace(1000, kCPUComputing);
+  pool.FreeDataSpace(a);
+  HT_ASSERT_EQ(pool.GetStats().num_stashed_blocks, 1);
+  // later work on the same stream is ordered after the free
+  auto b = pool.AllocDataSpace(1000, kCPUComputing);
+  HT_ASSERT(b.ptr == a.ptr) << "The stashed block was not reused";
+  auto stats = pool.GetStats();
+  HT_ASSERT_EQ(stats.stream_reuse_cnt, 1);
+  HT_ASSERT_EQ(stats.num_stashed_blocks, 0);
+
+  // but other streams must wait until the stream reaches the free
+  pool.FreeDataSpace(b);
+  auto c = pool.AllocDataSpace(1000, kCPUBlocking);
+  HT_ASSERT(c.is_new_malloc && c.ptr != b.ptr)
+    << "A stashed block was handed to another stream";
+  HT_ASSERT_EQ(pool.GetStats().num_stashed_blocks, 1);
+
+  gate.set_value();
+  CPUStream(kCPUComputing).Sync();
+  HT_ASSERT_EQ(pool.GetStats().num_stashed_blocks, 0);
+  auto d = pool.AllocDataSpace(1000, kCPUBlocking);
+  HT_ASSERT(!d.is_new_malloc && d.ptr == b.ptr)
+    << "The unstashed block was not reused";
+  pool.FreeDataSpace(c);
+  pool.FreeDataSpace(d);
+  HT_LOG_INFO << "Testing stashing of blocks freed on CPU streams done";
+}
+
+void TestEmptyCache() {
+  HT_LOG_INFO << "Testing emptying the cache...";
+  CPUMemoryPool pool(true);
+  auto small = pool.AllocDataSpace(1000, kCPUBlocking);
+  auto large = pool.AllocDataSpace(3 * kMiB, kCPUBlocking);
+  auto stashed = pool.AllocDataSpace(4096, kCPUComputing);
+  auto live = pool.AllocDataSpace(2000, kCPUBlocking);
+  pool.FreeDataSpace(small);
+  pool.FreeDataSpace(large);
+  pool.FreeDataSpace(stashed);
+  HT_ASSERT_EQ(pool.GetStats().reserved, 1024 + 4 * kMiB + 4096 + 2048);
+
+  // everything but the live block goes back to the system
+  pool.EmptyCache();
+  auto stats = pool.GetStats();
+  HT_ASSERT_EQ(stats.reserved, 2048);
+  HT_ASSERT_EQ(stats.num_segments, 1);
+  HT_ASSERT_EQ(stats.num_stashed_blocks, 0);
+  HT_ASSERT_EQ(stats.release_cnt, 3);
+
+  pool.FreeDataSpace(live);
+  pool.EmptyCache();
+  HT_ASSERT_EQ(pool.GetStats().reserved, 0);
+  HT_LOG_INFO << "Testing emptying the cache done";
+}
+
+int main(int argc, char** argv) {
+  TestBorrowedDeleter();
+  TestBinReuse();
+  TestCoalescing();
+  TestCrossStreamStash();
+  TestEmptyCache();
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "hetu/impl/stream/CPUStream.h"
+#include "test_utils.h"
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+using namespace hetu;
+using namespace hetu::impl;
+
+void TestStreamOrder() {
+  HT_LOG_INFO << "Testing order of tasks on CPU streams...";
+  const int num_tasks = 10000;
+  std::vector<CPUStream> streams = {GetCPUStream(kComputingStream),
+                                    GetCPUStream(kH2DStream),
+                                    GetCPUStream(kD2HStream)};
+  std::vector<std::vector<int>> orders(streams.size());
+  // interleave the streams and both kinds of submission
+  for (int i = 0; i < num_tasks; i++) {
+    for (size_t j = 0; j < streams.size(); j++) {
+      auto* order = &orders[j];
+      if (i % 2 == 0)
+        streams[j].PostTask([order, i]() { order->push_back(i); });
+      else
+        streams[j].EnqueueTask([order, i]() { order->push_back(i); });
+    }
+  }
+  for (auto& stream : streams)
+    stream.Sync();
+  for (auto& order : orders) {
+    HT_ASSERT_EQ(order.size(), num_tasks) << "Tasks are missing";
+    for (int i = 0; i < num_tasks; i++)
+      HT_ASSERT_EQ(order[i], i) << "Tasks on a stream are out of order";
+  }
+  HT_LOG_INFO << "Testing order of tasks on CPU streams done";
+}
+
+void TestParallelForCoverage() {
+  HT_LOG_INFO << "Testing coverage of CPUParallelFor...";
+  std::vector<std::pair<int64_t, int64_t>> cases = {
+    {0, 1}, {1, 1}, {7, 100}, {1000, 1}, {1000, 7}, {100003, 1024}};
+  for (auto& c : cases) {
+    int64_t n = c.first, grain_size = c.second;
+    std::vector<std::atomic<int>> hits(n + 2);
+    for (auto& hit : hits)
+      hit = 0;
+    CPUParallelFor(1, n + 1, grain_size, [&](int64_t begin, int64_t end) {
+      HT_ASSERT(begin < end) << "Empty chunk [" << begin << ", " << end << ")";
+      for (int64_t i = begin; i < end; i++)
+        hits[i]++;
+    });
+    HT_ASSERT(hits[0] == 0 && hits[n + 1] == 0)
+      << "Iterations out of range were run";
+    for (int64_t i = 1; i <= n; i++)
+      HT_ASSERT_EQ(hits[i].load(), 1)
+        << "Iteration " << i << " of " << n << " was run " << hits[i].load()
+        << " times with grain size " << grain_size;
+  }
+  HT_LOG_INFO << "Testing coverage of CPUParallelFor done";
+}
+
+void TestNestedParallelFor() {
+  HT_LOG_INFO << "Testing nested CPUParallelFor in CPU streams...";
+  const int64_t rows = 64, cols = 4096;
+  const std::vector<StreamIndex> stream_ids = {kComputingStream, kH2DStream,
+                                               kD2HStream};
+  const int num_streams = stream_ids.size();
+  std::vector<std::vector<std::atomic<int>>> hits(num_streams);
+  std::vector<std::future<void>> futures;
+  // Each stream task runs a parallel loop whose chunks run parallel loops
+  // themselves, so that all pool workers are busy with outer chunks.
+  for (int s = 0; s < num_streams; s++) {
+    hits[s] = std::vector<std::atomic<int>>(rows * cols);
+    for (auto& hit : hits[s])
+      hit = 0;
+    auto* stream_hits = &hits[s];
+    futures.push_back(GetCPUStream(stream_ids[s]).EnqueueTask(
+      [stream_hits, rows, cols]() {
+        CPUParallelFor(0, rows, 1, [&](int64_t row_begin, int64_t row_end) {
+          for (int64_t r = row_begin; r < row_end; r++) {
+            CPUParallelFor(0, cols, 64, [&](int64_t begin, int64_t end) {
+              for (int64_t c = begin; c < end; c++)
+                (*stream_hits)[r * cols + c]++;
+            });
+          }
+        });
+      }));
+  }
+  for (auto& future : futures)
+    future.get();
+  for (int s = 0; s < num_streams; s++)
+    for (int64_t i = 0; i < rows * cols; i++)
+      HT_ASSERT_EQ(hits[s][i].load(), 1)
+        << "Iteration " << i << " of stream " << s << " was run "
+        << hits[s][i].load() << " times";
+  HT_LOG_INFO << "Testing nested CPUParallelFor in CPU streams done";
+}
+
+void TestFailingTask() {
+  HT_LOG_INFO << "Testing failing tasks on CPU streams...";
+  auto stream = GetCPUStream(kComputingStream);
+  int num_done = 0;
+  stream.PostTask([]() { throw std::runtime_error("posted task failed"); });
+  stream.PostTask([&num_done]() { num_done++; });
+  stream.Sync();
+  HT_ASSERT_EQ(num_done, 1) << "The stream stopped after a failing task";
+  HT_LOG_INFO << "Testing failing tasks on CPU streams done";
+}
+
+int main(int argc, char** argv) {
+  // Run the streams as serial executors on the shared thread pool. The
+  // executor is chosen once, before the first stream is used.
+  setenv("HETU_CPU_STREAM_EXECUTOR", "pool", 1);
+  TestStreamOrder();
+  TestParallelForCoverage();
+  TestNestedParallelFor();
+  TestFailingTask();
+  return 0;
+}
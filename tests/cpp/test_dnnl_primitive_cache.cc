@@ -0,0 +1,77 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/impl/utils/dnnl_utils.h"
+#include "test_utils.h"
+#include <cstdlib>
+
+using namespace hetu;
+using hetu::cpu::DNNLPrimitiveCache;
+using hetu::cpu::DNNLPrimitiveCacheStats;
+
+// Must match the capacity set in main before the cache is created.
+constexpr size_t kTestCapacity = 2;
+
+void RunSigmoid(const HTShape& shape) {
+  auto input = NDArray::full(shape, 0.0, Device(kCPU), kFloat32);
+  auto output = NDArray::sigmoid(input);
+  SynchronizeAllStreams();
+  assert_fuzzy_eq(output, 0.5);
+}
+
+void CheckStats(uint64_t hits, uint64_t misses, uint64_t evictions,
+                size_t size) {
+  DNNLPrimitiveCacheStats stats = DNNLPrimitiveCache::GetInstance().GetStats();
+  HT_ASSERT(stats.hits == hits && stats.misses == misses &&
+            stats.evictions == evictions && stats.size == size)
+    << "Expected hits=" << hits << ", misses=" << misses
+    << ", evictions=" << evictions << ", size=" << size << ", got hits="
+    << stats.hits << ", misses=" << stats.misses
+    << ", evictions=" << stats.evictions << ", size=" << stats.size;
+}
+
+void TestHitsAndMisses() {
+  HT_LOG_INFO << "Testing DNNL primitive cache hits and misses...";
+  auto& cache = DNNLPrimitiveCache::GetInstance();
+  cache.Clear();
+  cache.ResetStats();
+  HT_ASSERT_EQ(cache.GetStats().capacity, kTestCapacity);
+  RunSigmoid({4, 8});
+  CheckStats(0, 1, 0, 1);
+  // the same primitive is compiled only once
+  RunSigmoid({4, 8});
+  RunSigmoid({4, 8});
+  CheckStats(2, 1, 0, 1);
+  // a different shape is a different primitive
+  RunSigmoid({4, 16});
+  CheckStats(2, 2, 0, 2);
+  cache.PrintSummary();
+  HT_LOG_INFO << "Testing DNNL primitive cache hits and misses done";
+}
+
+void TestEviction() {
+  HT_LOG_INFO << "Testing DNNL primitive cache eviction...";
+  auto& cache = DNNLPrimitiveCache::GetInstance();
+  cache.Clear();
+  cache.ResetStats();
+  RunSigmoid({2, 8});
+  RunSigmoid({2, 16});
+  // touch {2, 8} so that {2, 16} is the least recently used
+  RunSigmoid({2, 8});
+  RunSigmoid({2, 32});
+  CheckStats(1, 3, 1, 2);
+  // {2, 8} survived, {2, 16} was evicted and is compiled again
+  RunSigmoid({2, 8});
+  CheckStats(2, 3, 1, 2);
+  RunSigmoid({2, 16});
+  CheckStats(2, 4, 2, 2);
+  cache.PrintSummary();
+  HT_LOG_INFO << "Testing DNNL primitive cache eviction done";
+}
+
+int main(int argc, char** argv) {
+  // read once, when the cache is first used
+  setenv("HETU_DNNL_PRIMITIVE_CACHE_CAPACITY",
+         std::to_string(kTestCapacity).c_str(), 1);
+  TestHitsAndMisses();
+  TestEviction();
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/graph/ops/kernel_links.h"
+#include "test_utils.h"
+#include <chrono>
+#include <random>
+
+using namespace hetu;
+
+// Ids following a power law over the rows, as in recommendation workloads.
+NDArray MakeZipfIds(size_t num_ids, size_t num_rows, double alpha,
+                    uint64_t seed) {
+  std::vector<double> weights(num_rows);
+  for (size_t i = 0; i < num_rows; i++)
+    weights[i] = 1.0 / std::pow(i + 1, alpha);
+  std::discrete_distribution<int64_t> dist(weights.begin(), weights.end());
+  std::mt19937_64 engine(seed);
+  auto ids = NDArray::empty({static_cast<int64_t>(num_ids)}, Device(kCPU),
+                            kInt64);
+  auto* ptr = ids->data_ptr<int64_t>();
+  for (size_t i = 0; i < num_ids; i++)
+    ptr[i] = dist(engine);
+  return ids;
+}
+
+void TestEmbeddingLookupGradient(size_t num_ids, size_t num_rows,
+                                 size_t length, double alpha) {
+  HT_LOG_INFO << "Testing EmbeddingLookupGradient with " << num_ids
+              << " ids over " << num_rows << " rows (alpha = " << alpha
+              << ")...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  auto ids = MakeZipfIds(num_ids, num_rows, alpha, 42);
+  auto output_grad = NDArray::rand({static_cast<int64_t>(num_ids),
+                                    static_cast<int64_t>(length)},
+                                   Device(kCPU), kFloat32, 0.0, 1.0, 0,
+                                   kBlockingStream);
+  auto* ids_ptr = ids->data_ptr<int64_t>();
+  auto* grad_ptr = output_grad->data_ptr<float>();
+
+  // serial reference, rows are added in the order of the ids
+  auto expected = NDArray::full({static_cast<int64_t>(num_rows),
+                                 static_cast<int64_t>(length)},
+                                0, Device(kCPU), kFloat32, kBlockingStream);
+  auto* expected_ptr = expected->data_ptr<float>();
+  for (size_t i = 0; i < num_ids; i++)
+    for (size_t j = 0; j < length; j++)
+      expected_ptr[ids_ptr[i] * length + j] += grad_ptr[i * length + j];
+
+  auto input_grad = NDArray::full(expected->shape(), 1, Device(kCPU),
+                                  kFloat32, kBlockingStream);
+  auto start = std::chrono::steady_clock::now();
+  impl::EmbeddingLookupGradientCpu(output_grad, ids, input_grad, stream);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  auto* input_grad_ptr = input_grad->data_ptr<float>();
+  for (size_t i = 0; i < num_rows * length; i++)
+    HT_ASSERT_EQ(input_grad_ptr[i], expected_ptr[i])
+      << "Mismatched on position " << i;
+
+  HT_LOG_INFO << "Testing EmbeddingLookupGradient done, "
+              << std::chrono::duration<double, std::milli>(elapsed).count()
+              << " ms";
+}
+
+int main(int argc, char** argv) {
+  TestEmbeddingLookupGradient(1 << 16, 1 << 20, 64, 1.05);
+  TestEmbeddingLookupGradient(1 << 16, 1 << 20, 64, 1.5);
+  TestEmbeddingLookupGradient(1 << 14, 1 << 10, 16, 0.5);
+  return 0;
+}
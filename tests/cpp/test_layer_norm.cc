@@ -0,0 +1,255 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/graph/ops/kernel_links.h"
+#include "test_utils.h"
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+
+using namespace hetu;
+
+NDArray MakeArray(const HTShape& shape, DataType dtype,
+                  const std::vector<double>& values) {
+  auto arr = NDArray::empty(shape, Device(kCPU), dtype);
+  HT_DISPATCH_FLOATING_TYPES(dtype, spec_t, "MakeArray", [&]() {
+    auto* ptr = arr->data_ptr<spec_t>();
+    for (size_t i = 0; i < values.size(); i++)
+      ptr[i] = spec_t(values[i]);
+  });
+  return arr;
+}
+
+std::vector<double> ToVector(const NDArray& arr) {
+  std::vector<double> values(arr->numel());
+  HT_DISPATCH_FLOATING_TYPES(arr->dtype(), spec_t, "ToVector", [&]() {
+    auto* ptr = arr->data_ptr<spec_t>();
+    for (size_t i = 0; i < values.size(); i++)
+      values[i] = static_cast<double>(static_cast<float>(ptr[i]));
+  });
+  return values;
+}
+
+std::vector<double> RandomValues(size_t size, double low, double high,
+                                 uint64_t seed) {
+  std::mt19937 engine(seed);
+  std::uniform_real_distribution<double> dist(low, high);
+  std::vector<double> values(size);
+  for (auto& v : values)
+    v = dist(engine);
+  return values;
+}
+
+void CheckClose(const std::string& name, const std::vector<double>& actual,
+                const std::vector<double>& expected, double tol) {
+  HT_ASSERT(actual.size() == expected.size());
+  for (size_t i = 0; i < actual.size(); i++)
+    HT_ASSERT(std::abs(actual[i] - expected[i]) <=
+              tol * std::max(1.0, std::abs(expected[i])))
+      << name << " mismatched on position " << i << ": expected "
+      << expected[i] << ", got " << actual[i];
+}
+
+// Checks the gradient of sum(f(inputs) * weights) w.r.t. inputs[index] by
+// central differences.
+void CheckGradient(const std::string& name, std::vector<double> inputs,
+                   const std::vector<double>& weights,
+                   const std::function<std::vector<double>(
+                     const std::vector<double>&)>& f,
+                   const std::vector<double>& grad, double tol) {
+  const double h = 1e-4;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    double saved = inputs[i];
+    inputs[i] = saved + h;
+    auto plus = f(inputs);
+    inputs[i] = saved - h;
+    auto minus = f(inputs);
+    inputs[i] = saved;
+    double expected = 0;
+    for (size_t j = 0; j < weights.size(); j++)
+      expected += (plus[j] - minus[j]) * weights[j] / (2 * h);
+    HT_ASSERT(std::abs(grad[i] - expected) <=
+              tol * std::max(1.0, std::abs(expected)))
+      << name << " gradient mismatched on position " << i << ": expected "
+      << expected << ", got " << grad[i];
+  }
+}
+
+void TestLayerNorm(const HTShape& shape, int64_t reduce_dims, DataType dtype) {
+  HT_LOG_INFO << "Testing LayerNorm of " << shape << " over the last "
+              << reduce_dims << " dims (" << dtype << ")...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  const double eps = 1e-5;
+  int64_t cols = 1;
+  HTShape stat_shape = shape, param_shape;
+  for (size_t i = shape.size() - reduce_dims; i < shape.size(); i++) {
+    cols *= shape[i];
+    stat_shape[i] = 1;
+    param_shape.push_back(shape[i]);
+  }
+  int64_t rows = NumEl(shape) / cols;
+  auto x = RandomValues(NumEl(shape), -2, 6, 1);
+  auto scale = RandomValues(cols, 0.5, 1.5, 2);
+  auto bias = RandomValues(cols, -1, 1, 3);
+  auto weights = RandomValues(NumEl(shape), -1, 1, 4);
+
+  auto forward = [&](const std::vector<double>& x) {
+    std::vector<double> y(x.size());
+    for (int64_t r = 0; r < rows; r++) {
+      double mean = 0, var = 0;
+      for (int64_t c = 0; c < cols; c++)
+        mean += x[r * cols + c] / cols;
+      for (int64_t c = 0; c < cols; c++)
+        var += (x[r * cols + c] - mean) * (x[r * cols + c] - mean) / cols;
+      for (int64_t c = 0; c < cols; c++)
+        y[r * cols + c] =
+          (x[r * cols + c] - mean) / std::sqrt(var + eps) * scale[c] + bias[c];
+    }
+    return y;
+  };
+
+  auto input = MakeArray(shape, dtype, x);
+  auto x_rounded = ToVector(input);
+  auto output = NDArray::empty(shape, Device(kCPU), dtype);
+  auto mean = NDArray::empty(stat_shape, Device(kCPU), dtype);
+  auto var = NDArray::empty(stat_shape, Device(kCPU), dtype);
+  auto scale_arr = MakeArray(param_shape, dtype, scale);
+  auto bias_arr = MakeArray(param_shape, dtype, bias);
+  auto start = std::chrono::steady_clock::now();
+  impl::LayerNormCpu(input, scale_arr, bias_arr, mean, var, output,
+                     reduce_dims, eps, stream);
+  auto forward_time = std::chrono::steady_clock::now() - start;
+  double tol = dtype == kFloat64 ? 1e-9 : (dtype == kFloat32 ? 1e-4 : 3e-2);
+  // scale and bias are rounded as well
+  scale = ToVector(scale_arr);
+  bias = ToVector(bias_arr);
+  CheckClose("LayerNorm", ToVector(output), forward(x_rounded), tol);
+
+  auto output_grad = MakeArray(shape, dtype, weights);
+  weights = ToVector(output_grad);
+  auto input_grad = NDArray::empty(shape, Device(kCPU), dtype);
+  auto scale_grad = NDArray::empty(param_shape, Device(kCPU), dtype);
+  auto bias_grad = NDArray::empty(param_shape, Device(kCPU), dtype);
+  start = std::chrono::steady_clock::now();
+  impl::LayerNormGradientCpu(output_grad, input, scale_arr, input_grad,
+                             scale_grad, bias_grad, mean, var, reduce_dims,
+                             eps, stream);
+  auto backward_time = std::chrono::steady_clock::now() - start;
+  if (dtype == kFloat64 && rows * cols <= 4096) {
+    CheckGradient("LayerNorm", x_rounded, weights, forward,
+                  ToVector(input_grad), 1e-5);
+    auto with_scale = [&](const std::vector<double>& s) {
+      auto saved = scale;
+      scale = s;
+      auto y = forward(x_rounded);
+      scale = saved;
+      return y;
+    };
+    CheckGradient("LayerNorm scale", scale, weights, with_scale,
+                  ToVector(scale_grad), 1e-5);
+  }
+  std::vector<double> expected_bias_grad(cols, 0);
+  for (int64_t r = 0; r < rows; r++)
+    for (int64_t c = 0; c < cols; c++)
+      expected_bias_grad[c] += weights[r * cols + c];
+  CheckClose("LayerNorm bias", ToVector(bias_grad), expected_bias_grad,
+             dtype == kBFloat16 ? 3e-2 : 1e-4);
+
+  HT_LOG_INFO << "Testing LayerNorm done, forward: "
+              << std::chrono::duration<double, std::milli>(forward_time).count()
+              << " ms, backward: "
+              << std::chrono::duration<double, std::milli>(backward_time).count()
+              << " ms";
+}
+
+void TestDropoutAddLn(int64_t rows, int64_t cols, bool is_rms_norm,
+                      bool has_residual) {
+  HT_LOG_INFO << "Testing DropoutAddLn with " << rows << " x " << cols
+              << (is_rms_norm ? " (RMSNorm" : " (LayerNorm")
+              << (has_residual ? ", residual)..." : ")...");
+  Stream stream(Device(kCPU), kBlockingStream);
+  const float eps = 1e-5;
+  auto x0 = RandomValues(rows * cols, -2, 3, 5);
+  auto residual = RandomValues(rows * cols, -1, 1, 6);
+  auto gamma = RandomValues(cols, 0.5, 1.5, 7);
+  auto beta = RandomValues(cols, -1, 1, 8);
+  auto weights = RandomValues(rows * cols, -1, 1, 9);
+
+  auto forward = [&](const std::vector<double>& x0) {
+    std::vector<double> z(x0.size());
+    for (int64_t r = 0; r < rows; r++) {
+      double mean = 0, square = 0;
+      for (int64_t c = 0; c < cols; c++) {
+        double v = x0[r * cols + c] + (has_residual ? residual[r * cols + c] : 0);
+        mean += v / cols;
+        square += v * v / cols;
+      }
+      double rs = 1 / std::sqrt(square - (is_rms_norm ? 0 : mean * mean) + eps);
+      for (int64_t c = 0; c < cols; c++) {
+        double v = x0[r * cols + c] + (has_residual ? residual[r * cols + c] : 0);
+        z[r * cols + c] =
+          (v - (is_rms_norm ? 0 : mean)) * rs * gamma[c] + beta[c];
+      }
+    }
+    return z;
+  };
+
+  NDArray x0_arr = MakeArray({rows, cols}, kFloat32, x0);
+  NDArray residual_arr =
+    has_residual ? MakeArray({rows, cols}, kFloat32, residual) : NDArray();
+  NDArray gamma_arr = MakeArray({cols}, kFloat32, gamma);
+  NDArray beta_arr = MakeArray({cols}, kFloat32, beta);
+  NDArray z = NDArray::empty({rows, cols}, Device(kCPU), kFloat32);
+  NDArray x = has_residual ? NDArray::empty({rows, cols}, Device(kCPU), kFloat32)
+                           : x0_arr;
+  NDArray x_out = has_residual ? x : NDArray();
+  NDArray dmask, mu = NDArray::empty({rows}, Device(kCPU), kFloat32);
+  NDArray rsigma = NDArray::empty({rows}, Device(kCPU), kFloat32);
+  impl::DropoutAddLnFwdCpu(x0_arr, residual_arr, gamma_arr, beta_arr, NDArray(),
+                           NDArray(), NDArray(), NDArray(), z, x_out, dmask, mu,
+                           rsigma, 0.f, eps, 1.f, 0, false, is_rms_norm,
+                           stream);
+  CheckClose("DropoutAddLn", ToVector(z), forward(x0), 1e-4);
+
+  NDArray dz = MakeArray({rows, cols}, kFloat32, weights);
+  NDArray dx0 = NDArray::empty({rows, cols}, Device(kCPU), kFloat32);
+  NDArray dresidual =
+    has_residual ? NDArray::empty({rows, cols}, Device(kCPU), kFloat32)
+                 : NDArray();
+  NDArray dgamma = NDArray::empty({cols}, Device(kCPU), kFloat32);
+  NDArray dbeta = NDArray::empty({cols}, Device(kCPU), kFloat32);
+  NDArray dgamma_part, dbeta_part, dcolscale, dcolscale_part;
+  impl::DropoutAddLnBwdCpu(dz, NDArray(), x, NDArray(), NDArray(), mu, rsigma,
+                           gamma_arr, NDArray(), NDArray(), NDArray(),
+                           NDArray(), dx0, dresidual, dgamma, dbeta,
+                           dgamma_part, dbeta_part, dcolscale, dcolscale_part,
+                           0.f, 1.f, 0, has_residual, is_rms_norm, stream);
+  CheckGradient("DropoutAddLn", x0, weights, forward, ToVector(dx0), 1e-3);
+  if (has_residual)
+    CheckClose("DropoutAddLn residual", ToVector(dresidual), ToVector(dx0),
+               1e-6);
+  auto with_gamma = [&](const std::vector<double>& g) {
+    auto saved = gamma;
+    gamma = g;
+    auto z = forward(x0);
+    gamma = saved;
+    return z;
+  };
+  CheckGradient("DropoutAddLn gamma", gamma, weights, with_gamma,
+                ToVector(dgamma), 1e-3);
+  HT_LOG_INFO << "Testing DropoutAddLn done";
+}
+
+int main(int argc, char** argv) {
+  for (auto dtype : {kFloat64, kFloat32, kBFloat16}) {
+    TestLayerNorm({3, 5, 7}, 1, dtype);
+    TestLayerNorm({2, 3, 4, 5, 6}, 2, dtype);
+    TestLayerNorm({37}, 1, dtype);
+  }
+  TestLayerNorm({4096, 1024}, 1, kFloat32);
+  TestLayerNorm({4096, 1024}, 1, kBFloat16);
+  for (bool is_rms_norm : {true, false}) {
+    TestDropoutAddLn(6, 40, is_rms_norm, false);
+    TestDropoutAddLn(6, 40, is_rms_norm, true);
+  }
+  return 0;
+}
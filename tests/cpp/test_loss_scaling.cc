@@ -0,0 +1,98 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/graph/ops/kernel_links.h"
+#include "test_utils.h"
+#include <cmath>
+#include <limits>
+
+using namespace hetu;
+
+void TestCheckFinite() {
+  HT_LOG_INFO << "Testing CheckFinite and CheckNumeric...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  auto input = NDArray::full({1000, 100}, 1, Device(kCPU), kFloat32,
+                             kBlockingStream);
+  auto found = NDArray::empty({1}, Device(kCPU), kFloat32);
+  auto numeric = NDArray::empty({3}, Device(kCPU), kFloat32);
+  auto check = [&](float expected_found, std::vector<float> expected_numeric) {
+    impl::CheckFiniteCpu(input, found, stream);
+    HT_ASSERT(found->data_ptr<float>()[0] == expected_found)
+      << "CheckFinite got " << found->data_ptr<float>()[0];
+    impl::CheckNumericCpu(input, numeric, stream);
+    for (int i = 0; i < 3; i++)
+      HT_ASSERT(numeric->data_ptr<float>()[i] == expected_numeric[i])
+        << "CheckNumeric got " << numeric->data_ptr<float>()[i]
+        << " on position " << i;
+  };
+  check(0, {0, 0, 0});
+  // a non-finite value in the middle of the last chunk
+  float* ptr = input->data_ptr<float>();
+  ptr[99999] = std::numeric_limits<float>::infinity();
+  check(1, {0, 0, 1});
+  ptr[12345] = -std::numeric_limits<float>::infinity();
+  ptr[54321] = std::numeric_limits<float>::quiet_NaN();
+  check(1, {1, 1, 1});
+
+  // a strided view skipping the non-finite values
+  auto view = NDArray::slice(input, {0, 0}, {100, 100}, kBlockingStream);
+  impl::CheckFiniteCpu(view, found, stream);
+  HT_ASSERT(found->data_ptr<float>()[0] == 0)
+    << "CheckFinite read outside of the view";
+  HT_LOG_INFO << "Testing CheckFinite and CheckNumeric done";
+}
+
+void TestUpdateScale() {
+  HT_LOG_INFO << "Testing UpdateScale...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  auto scale = NDArray::full({1}, 1024, Device(kCPU), kFloat32,
+                             kBlockingStream);
+  auto tracker = NDArray::full({1}, 0, Device(kCPU), kInt32, kBlockingStream);
+  auto found_inf = NDArray::full({1}, 0, Device(kCPU), kFloat32,
+                                 kBlockingStream);
+  // grows after 3 successful steps
+  for (int i = 0; i < 3; i++)
+    impl::UpdateScaleCpu(scale, tracker, found_inf, 2.0, 0.5, 3, stream);
+  HT_ASSERT(scale->data_ptr<float>()[0] == 2048 &&
+            tracker->data_ptr<int>()[0] == 0)
+    << "UpdateScale should grow the scale, got "
+    << scale->data_ptr<float>()[0];
+  impl::UpdateScaleCpu(scale, tracker, found_inf, 2.0, 0.5, 3, stream);
+  found_inf->data_ptr<float>()[0] = 2;
+  impl::UpdateScaleCpu(scale, tracker, found_inf, 2.0, 0.5, 3, stream);
+  HT_ASSERT(scale->data_ptr<float>()[0] == 1024 &&
+            tracker->data_ptr<int>()[0] == 0)
+    << "UpdateScale should back off the scale, got "
+    << scale->data_ptr<float>()[0];
+  HT_LOG_INFO << "Testing UpdateScale done";
+}
+
+void TestSGDUpdateWithGradScaler() {
+  HT_LOG_INFO << "Testing SGDUpdateWithGradScaler...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  // fp32 master parameters with bf16 gradients
+  auto param = NDArray::full({4096}, 1, Device(kCPU), kFloat32,
+                             kBlockingStream);
+  auto grad = NDArray::full({4096}, 0.5, Device(kCPU), kBFloat16,
+                            kBlockingStream);
+  auto infinite_count = NDArray::full({1}, 1, Device(kCPU), kFloat32,
+                                      kBlockingStream);
+  NDArray velocity;
+  impl::SGDUpdateWithGradScalerCpu(grad, infinite_count, param, velocity, 0.1,
+                                   0, false, stream);
+  HT_ASSERT(param->data_ptr<float>()[0] == 1)
+    << "SGDUpdateWithGradScaler should skip steps with overflows";
+  infinite_count->data_ptr<float>()[0] = 0;
+  impl::SGDUpdateWithGradScalerCpu(grad, infinite_count, param, velocity, 0.1,
+                                   0, false, stream);
+  for (int i = 0; i < 4096; i++)
+    HT_ASSERT(std::abs(param->data_ptr<float>()[i] - 0.95f) < 1e-6)
+      << "SGDUpdateWithGradScaler got " << param->data_ptr<float>()[i]
+      << " on position " << i;
+  HT_LOG_INFO << "Testing SGDUpdateWithGradScaler done";
+}
+
+int main(int argc, char** argv) {
+  TestCheckFinite();
+  TestUpdateScale();
+  TestSGDUpdateWithGradScaler();
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include "hetu/graph/memory/memory_planner.h"
+#include "test_utils.h"
+#include <random>
+
+using namespace hetu;
+using namespace hetu::graph;
+
+void CheckNoOverlap(const MemoryPlanner& planner) {
+  for (size_t a = 0; a < planner.num_buffers(); a++) {
+    for (size_t b = a + 1; b < planner.num_buffers(); b++) {
+      if (!planner.Conflict(a, b))
+        continue;
+      size_t a_begin = planner.offset(a), a_end = a_begin + planner.range(a).size;
+      size_t b_begin = planner.offset(b), b_end = b_begin + planner.range(b).size;
+      HT_ASSERT(a_end <= b_begin || b_end <= a_begin)
+        << "Buffers " << a << " and " << b << " are alive at the same time "
+        << "but overlap: [" << a_begin << ", " << a_end << ") and ["
+        << b_begin << ", " << b_end << ")";
+    }
+  }
+  HT_ASSERT(planner.live_size() <= planner.peak_size() &&
+            planner.peak_size() <= planner.total_size())
+    << "Planned peak " << planner.peak_size() << " should be between "
+    << planner.live_size() << " and " << planner.total_size();
+}
+
+void TestChain() {
+  HT_LOG_INFO << "Testing memory plan of a chain...";
+  // x0 -> x1 -> ... -> x9, each tensor is read by the next op only
+  MemoryPlanner planner;
+  for (int i = 0; i < 10; i++)
+    planner.AddBuffer(1024, i, i + 1, i + 1, kComputingStream);
+  planner.Plan();
+  CheckNoOverlap(planner);
+  HT_ASSERT(planner.peak_size() == 2048 && planner.total_size() == 10240)
+    << "A chain should only need two buffers, got " << planner.peak_size();
+  HT_LOG_INFO << "Testing memory plan of a chain done";
+}
+
+void TestCrossStream() {
+  HT_LOG_INFO << "Testing memory plan across streams...";
+  // the second buffer starts after the first one ends, but on another
+  // stream it may only reuse the first one after its sync point
+  MemoryPlanner planner;
+  planner.AddBuffer(1024, 0, 1, 5, kComputingStream);
+  planner.AddBuffer(1024, 2, 3, 5, kCollectiveStream);
+  planner.AddBuffer(1024, 6, 7, 7, kCollectiveStream);
+  planner.Plan();
+  CheckNoOverlap(planner);
+  HT_ASSERT(planner.peak_size() == 2048 && planner.live_size() == 1024)
+    << "Got a planned peak of " << planner.peak_size() << " and a live peak of "
+    << planner.live_size();
+  HT_LOG_INFO << "Testing memory plan across streams done";
+}
+
+void TestRandom(int num_buffers) {
+  HT_LOG_INFO << "Testing memory plan of " << num_buffers
+              << " random buffers...";
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<size_t> size_dist(1, 64);
+  std::uniform_int_distribution<int64_t> step_dist(0, 200);
+  std::uniform_int_distribution<int64_t> length_dist(0, 30);
+  std::uniform_int_distribution<int> stream_dist(0, 2);
+  MemoryPlanner planner;
+  for (int i = 0; i < num_buffers; i++) {
+    int64_t begin = step_dist(gen);
+    int64_t end = begin + length_dist(gen);
+    planner.AddBuffer(size_dist(gen) * 256, begin, end,
+                      end + length_dist(gen), stream_dist(gen));
+  }
+  planner.Plan();
+  CheckNoOverlap(planner);
+  HT_LOG_INFO << "Planned peak = " << planner.peak_size()
+              << ", live peak = " << planner.live_size()
+              << ", sum of sizes = " << planner.total_size();
+  HT_LOG_INFO << "Testing memory plan of random buffers done";
+}
+
+int main(int argc, char** argv) {
+  TestChain();
+  TestCrossStream();
+  TestRandom(1000);
+  return 0;
+}
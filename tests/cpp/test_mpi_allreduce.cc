@@ -0,0 +1,111 @@
+// Benchmark of AllReduce on CPU with MPI. Launch it with local processes:
+//   mpirun -np 4 ./test_mpi_allreduce
+// The bucket size of AllReduceCoalesce is set by HETU_MPI_BUCKET_SIZE_MB.
+#include "hetu/impl/communication/mpi_comm_group.h"
+#include "test_utils.h"
+#include <chrono>
+#include <cmath>
+
+using namespace hetu;
+using namespace hetu::impl;
+using namespace hetu::impl::comm;
+
+constexpr auto TEST_DATA_TYPES = {kFloat32, kFloat16, kBFloat16};
+constexpr int WARM_STEP = 2;
+constexpr int TEST_STEP = 10;
+
+// gradients of a small transformer-like model, i.e., a few large matrices
+// and plenty of small vectors that are latency bound when reduced one by one
+std::vector<HTShape> GradShapes(int num_layers = 12, int64_t hidden = 512) {
+  std::vector<HTShape> shapes = {{8000, hidden}};
+  for (int i = 0; i < num_layers; i++) {
+    std::vector<HTShape> layer_shapes = {
+      {hidden},         {hidden},     {3 * hidden, hidden}, {3 * hidden},
+      {hidden, hidden}, {hidden},     {hidden},             {hidden},
+      {4 * hidden, hidden}, {4 * hidden}, {hidden, 4 * hidden}, {hidden}};
+    shapes.insert(shapes.end(), layer_shapes.begin(), layer_shapes.end());
+  }
+  return shapes;
+}
+
+template <typename spec_t>
+void CheckReduced(const NDArray& array, double value, double rtol) {
+  auto* ptr = array->data_ptr<spec_t>();
+  for (size_t i = 0; i < array->numel(); i++) {
+    double x = static_cast<float>(ptr[i]);
+    HT_ASSERT(std::abs(x - value) <= rtol * std::abs(value))
+      << "Mismatched on position " << i << ": " << x << ", " << value;
+  }
+}
+
+void CheckReduced(const NDArray& array, double value) {
+  switch (array->dtype()) {
+    case kFloat32: CheckReduced<float>(array, value, 1e-5); break;
+    case kFloat16: CheckReduced<hetu::float16>(array, value, 1e-2); break;
+    case kBFloat16: CheckReduced<hetu::bfloat16>(array, value, 1e-1); break;
+    default: HT_NOT_IMPLEMENTED << "Unexpected data type " << array->dtype();
+  }
+}
+
+template <typename Fn>
+double TimeIt(MPICommunicationGroup& group, Fn fn) {
+  for (int i = 0; i < WARM_STEP; i++)
+    fn();
+  group->Sync();
+  group->Barrier(true);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < TEST_STEP; i++)
+    fn();
+  group->Sync();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+    TEST_STEP;
+}
+
+void TestAndBenchmark(DataType dtype) {
+  auto& group = MPICommunicationGroup::GetOrCreateWorldwide();
+  const double scalar = 0.125;
+  const double reduced_scalar =
+    ((group->size() + 1) * group->size() / 2) * scalar;
+  HT_LOG_INFO << "Testing AllReduce for type " << dtype << " on "
+              << group->size() << " processes...";
+
+  NDArrayList grads, reduced_grads;
+  size_t numel = 0;
+  for (const auto& shape : GradShapes()) {
+    grads.push_back(
+      NDArray::full(shape, (group->rank() + 1) * scalar, kCPU, dtype));
+    reduced_grads.push_back(NDArray::empty(shape, kCPU, dtype));
+    numel += grads.back()->numel();
+  }
+  auto buffer = NDArray::empty({static_cast<int64_t>(numel)}, kCPU, dtype);
+  SynchronizeAllStreams();
+
+  // correctness
+  group->AllReduce(grads[0], reduced_grads[0]);
+  group->AllReduceCoalesce(grads, reduced_grads, buffer);
+  group->Sync();
+  for (auto& reduced_grad : reduced_grads)
+    CheckReduced(reduced_grad, reduced_scalar);
+
+  // performance
+  double separate_cost = TimeIt(group, [&]() {
+    for (size_t i = 0; i < grads.size(); i++)
+      group->AllReduce(grads[i], reduced_grads[i]);
+  });
+  double bucketed_cost = TimeIt(
+    group, [&]() { group->AllReduceCoalesce(grads, reduced_grads, buffer); });
+  if (group->rank() == 0)
+    HT_LOG_INFO << grads.size() << " tensors with "
+                << (numel * DataType2Size(dtype) >> 20) << " MiB in " << dtype
+                << ": " << separate_cost << " ms with separate AllReduce, "
+                << bucketed_cost << " ms with bucketed AllReduce";
+  group->Barrier(true);
+  HT_LOG_INFO << "Testing AllReduce for type " << dtype << " done";
+}
+
+int main(int argc, char** argv) {
+  for (const auto& dtype : TEST_DATA_TYPES)
+    TestAndBenchmark(dtype);
+  return 0;
+}
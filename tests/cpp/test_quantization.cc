@@ -0,0 +1,133 @@
+#include "hetu/core/ndarray.h"
+#include "test_utils.h"
+#include <chrono>
+#include <cmath>
+
+using namespace hetu;
+
+constexpr int64_t BLOCKSIZE = 64;
+constexpr int TEST_STEP = 10;
+
+// A linear 8-bit code over [-1, 1], sorted by value.
+NDArray LinearCode() {
+  auto code = NDArray::empty({256}, Device(kCPU), kFloat32);
+  for (int i = 0; i < 256; i++)
+    code->data_ptr<float>()[i] = -1.0f + 2.0f * i / 255;
+  return code;
+}
+
+// Max distance between two neighbouring values of each data type, relative
+// to the absmax of the block.
+double MaxGap(DataType qtype) {
+  switch (qtype) {
+    case kInt8: return 2.0 / 255;
+    case kFloat4: return 1.0 / 3;
+    case kNFloat4: return 0.32;
+    default: HT_NOT_IMPLEMENTED << "Unexpected data type " << qtype;
+  }
+  __builtin_unreachable();
+}
+
+void TestRoundTrip(DataType qtype, DataType dtype, bool stochastic) {
+  HT_LOG_INFO << "Testing quantization round trip of " << dtype << " to "
+              << qtype << (stochastic ? " (stochastic)..." : "...");
+  const int64_t numel = 1000 * BLOCKSIZE + 30;
+  auto code = qtype == kInt8 ? LinearCode() : NDArray();
+  auto input = NDArray::randn({numel}, Device(kCPU), dtype, 0, 1, 1,
+                              kBlockingStream);
+  auto quantized = NDArray::quantization(input, qtype, BLOCKSIZE, stochastic,
+                                         kBlockingStream, code);
+  auto absmax = quantized[0];
+  HT_ASSERT(absmax->numel() == (numel + BLOCKSIZE - 1) / BLOCKSIZE);
+  auto output = NDArray::dequantization(quantized[1], absmax, dtype, BLOCKSIZE,
+                                        kBlockingStream, code);
+  HT_DISPATCH_FLOATING_TYPES(dtype, spec_t, "TestRoundTrip", [&]() {
+    const spec_t* x = input->data_ptr<spec_t>();
+    const spec_t* y = output->data_ptr<spec_t>();
+    const float* scale = absmax->data_ptr<float>();
+    // stochastic rounding may pick either neighbour
+    double tol = (stochastic ? 1.0 : 0.5) * MaxGap(qtype) + 1e-2;
+    for (int64_t i = 0; i < numel; i++) {
+      double diff =
+        std::abs(static_cast<double>(x[i]) - static_cast<double>(y[i]));
+      HT_ASSERT(diff <= tol * scale[i / BLOCKSIZE])
+        << "Mismatched on position " << i << ": " << x[i] << ", " << y[i]
+        << " with absmax " << scale[i / BLOCKSIZE];
+    }
+  });
+  HT_LOG_INFO << "Testing quantization round trip done";
+}
+
+template <typename Fn>
+double TimeIt(Fn fn) {
+  fn();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < TEST_STEP; i++)
+    fn();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+    TEST_STEP;
+}
+
+// Compares MatMul4Bit with the fp32 MatMul on the dequantized weights, which
+// the fused kernel must reproduce up to the order of summation.
+void TestMatMul(DataType qtype, DataType dtype, int64_t m, int64_t n,
+                int64_t k, bool trans_a, bool trans_b) {
+  HT_LOG_INFO << "Testing MatMul4Bit of " << dtype << " x " << qtype << " ("
+              << m << " x " << k << " x " << n << ", trans " << trans_a << "/"
+              << trans_b << ")...";
+  auto code = qtype == kInt8 ? LinearCode() : NDArray();
+  HTShape a_shape = trans_a ? HTShape{k, m} : HTShape{m, k};
+  HTShape w_shape = trans_b ? HTShape{n, k} : HTShape{k, n};
+  auto a = NDArray::randn(a_shape, Device(kCPU), dtype, 0, 1, 1,
+                          kBlockingStream);
+  auto w = NDArray::randn(w_shape, Device(kCPU), kFloat32, 0, 0.02, 2,
+                          kBlockingStream);
+  auto quantized = NDArray::quantization(w, qtype, BLOCKSIZE, false,
+                                         kBlockingStream, code);
+  auto dequantized = NDArray::dequantization(
+    quantized[1], quantized[0], kFloat32, BLOCKSIZE, kBlockingStream, code);
+  auto a_fp32 = NDArray::to(a, Device(kCPU), kFloat32, kBlockingStream);
+
+  NDArray expected, actual;
+  double fp32_cost = TimeIt([&]() {
+    expected = NDArray::matmul(a_fp32, dequantized, trans_a, trans_b,
+                               kBlockingStream, expected);
+  });
+  double quantized_cost = TimeIt([&]() {
+    actual = NDArray::matmul4bit(a, quantized[1], quantized[0], code, trans_a,
+                                 trans_b, BLOCKSIZE, kBlockingStream, actual);
+  });
+
+  double rtol = dtype == kFloat32 ? 1e-4 : (dtype == kFloat16 ? 1e-2 : 5e-2);
+  HT_DISPATCH_FLOATING_TYPES(dtype, spec_t, "TestMatMul", [&]() {
+    const float* x = expected->data_ptr<float>();
+    const spec_t* y = actual->data_ptr<spec_t>();
+    for (int64_t i = 0; i < m * n; i++)
+      HT_ASSERT(std::abs(x[i] - static_cast<float>(y[i])) <=
+                rtol * std::max(1.0f, std::abs(x[i])))
+        << "Mismatched on position " << i << ": " << x[i] << ", " << y[i];
+  });
+  HT_LOG_INFO << "Testing MatMul4Bit done, fp32 MatMul: " << fp32_cost
+              << " ms, quantized: " << quantized_cost << " ms";
+}
+
+int main(int argc, char** argv) {
+  for (auto qtype : {kInt8, kFloat4, kNFloat4}) {
+    for (auto dtype : {kFloat32, kFloat16, kBFloat16})
+      TestRoundTrip(qtype, dtype, false);
+    TestRoundTrip(qtype, kFloat32, true);
+    for (bool trans_b : {true, false}) {
+      TestMatMul(qtype, kFloat32, 1, 200, 320, false, trans_b);
+      TestMatMul(qtype, kFloat32, 5, 300, 130, true, trans_b);
+      // compute bound, goes through the dequantized fp32 MatMul
+      TestMatMul(qtype, kFloat32, 64, 96, 128, false, trans_b);
+    }
+    TestMatMul(qtype, kFloat16, 3, 128, 256, false, true);
+    TestMatMul(qtype, kBFloat16, 3, 128, 256, false, true);
+  }
+  // memory bound decoding, where the compressed weights pay off
+  for (auto qtype : {kInt8, kNFloat4})
+    TestMatMul(qtype, kFloat32, 1, 4096, 4096, false, true);
+  return 0;
+}
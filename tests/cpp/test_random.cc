@@ -0,0 +1,131 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/graph/ops/kernel_links.h"
+#include "test_utils.h"
+#include <cmath>
+
+using namespace hetu;
+
+std::vector<float> ToVector(const NDArray& arr) {
+  auto contiguous = NDArray::contiguous(arr, kBlockingStream);
+  const float* ptr = contiguous->data_ptr<float>();
+  return std::vector<float>(ptr, ptr + contiguous->numel());
+}
+
+void TestInitShard(const HTShape& global_shape, const HTShape& begin,
+                   const HTShape& shape) {
+  HT_LOG_INFO << "Testing random inits of " << shape << " at " << begin
+              << " within " << global_shape << "...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  const uint64_t seed = 1234;
+  auto full = NDArray::empty(global_shape, Device(kCPU), kFloat32);
+  auto shard = NDArray::empty(shape, Device(kCPU), kFloat32);
+  auto check = [&](const std::string& name) {
+    auto expected =
+      ToVector(NDArray::slice(full, begin, shape, kBlockingStream));
+    auto values = ToVector(shard);
+    for (size_t i = 0; i < values.size(); i++)
+      HT_ASSERT(values[i] == expected[i])
+        << name << " of the shard mismatched on position " << i
+        << ": expected " << expected[i] << ", got " << values[i];
+  };
+
+  impl::NormalInitsCpu(full, 1, 2, seed, stream);
+  impl::NormalInitsCpu(shard, 1, 2, seed, global_shape, begin, stream);
+  check("NormalInits");
+  auto values = ToVector(full);
+  double mean = 0, var = 0;
+  for (auto v : values)
+    mean += v;
+  mean /= values.size();
+  for (auto v : values)
+    var += (v - mean) * (v - mean);
+  var /= values.size();
+  HT_ASSERT(std::abs(mean - 1) < 0.05 && std::abs(std::sqrt(var) - 2) < 0.05)
+    << "NormalInits got mean " << mean << " and stddev " << std::sqrt(var);
+
+  impl::UniformInitsCpu(full, -1, 3, seed, stream);
+  impl::UniformInitsCpu(shard, -1, 3, seed, global_shape, begin, stream);
+  check("UniformInits");
+  for (auto v : ToVector(full))
+    HT_ASSERT(v >= -1 && v <= 3) << "UniformInits got " << v;
+
+  impl::TruncatedNormalInitsCpu(full, 0, 1, -0.5, 0.5, seed, stream);
+  impl::TruncatedNormalInitsCpu(shard, 0, 1, -0.5, 0.5, seed, global_shape,
+                                begin, stream);
+  check("TruncatedNormalInits");
+  for (auto v : ToVector(full))
+    HT_ASSERT(v >= -0.5 && v <= 0.5) << "TruncatedNormalInits got " << v;
+
+  // the same seed always gives the same values
+  auto again = NDArray::empty(global_shape, Device(kCPU), kFloat32);
+  impl::TruncatedNormalInitsCpu(again, 0, 1, -0.5, 0.5, seed, stream);
+  HT_ASSERT(ToVector(again) == ToVector(full))
+    << "TruncatedNormalInits is not deterministic";
+  HT_LOG_INFO << "Testing random inits done";
+}
+
+void TestDropout(const HTShape& shape, double drop_rate) {
+  HT_LOG_INFO << "Testing Dropout of " << shape << " with drop rate "
+              << drop_rate << "...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  const uint64_t seed = 4321;
+  const float scale = 1 / (1 - drop_rate);
+  auto input = NDArray::full(shape, 1, Device(kCPU), kFloat32, kBlockingStream);
+  auto output = NDArray::empty(shape, Device(kCPU), kFloat32);
+  auto mask = NDArray::empty(shape, Device(kCPU), kBool);
+  impl::DropoutCpu(input, drop_rate, seed, output, mask, stream);
+  const bool* mask_ptr = mask->data_ptr<bool>();
+  auto values = ToVector(output);
+  int64_t kept = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    HT_ASSERT(values[i] == (mask_ptr[i] ? scale : 0.f))
+      << "Dropout mismatched with its mask on position " << i;
+    kept += mask_ptr[i];
+  }
+  double keep_ratio = static_cast<double>(kept) / values.size();
+  HT_ASSERT(std::abs(keep_ratio - (1 - drop_rate)) < 0.01)
+    << "Dropout kept " << keep_ratio << " of the elements";
+
+  // the gradient of ones equals the output
+  auto grad = NDArray::empty(shape, Device(kCPU), kFloat32);
+  impl::DropoutGradientCpu(input, mask, drop_rate, grad, stream);
+  HT_ASSERT(ToVector(grad) == values) << "DropoutGradient mismatched";
+  auto recomputed = NDArray::empty(shape, Device(kCPU), kFloat32);
+  impl::DropoutGradientWithRecomputationCpu(input, drop_rate, seed, recomputed,
+                                            stream);
+  HT_ASSERT(ToVector(recomputed) == values)
+    << "DropoutGradientWithRecomputation mismatched";
+  HT_LOG_INFO << "Testing Dropout done";
+}
+
+void TestDropout2d(const HTShape& shape, double drop_rate) {
+  HT_LOG_INFO << "Testing Dropout2d of " << shape << " with drop rate "
+              << drop_rate << "...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  const float scale = 1 / (1 - drop_rate);
+  auto input = NDArray::full(shape, 1, Device(kCPU), kFloat32, kBlockingStream);
+  auto output = NDArray::empty(shape, Device(kCPU), kFloat32);
+  auto mask = NDArray::empty(shape, Device(kCPU), kBool);
+  impl::Dropout2dCpu(input, drop_rate, 4321, output, mask, stream);
+  auto values = ToVector(output);
+  const int64_t channel_size = shape[2] * shape[3];
+  for (size_t i = 0; i < values.size(); i++) {
+    size_t leader = i / channel_size * channel_size;
+    HT_ASSERT(values[i] == values[leader] &&
+              (values[i] == 0 || values[i] == scale))
+      << "Dropout2d should drop whole channels, got " << values[i]
+      << " on position " << i;
+  }
+  auto grad = NDArray::empty(shape, Device(kCPU), kFloat32);
+  impl::Dropout2dGradientCpu(input, mask, drop_rate, grad, stream);
+  HT_ASSERT(ToVector(grad) == values) << "Dropout2dGradient mismatched";
+  HT_LOG_INFO << "Testing Dropout2d done";
+}
+
+int main(int argc, char** argv) {
+  TestInitShard({64, 53, 31}, {8, 10, 3}, {16, 20, 25});
+  TestInitShard({100003}, {777}, {4096});
+  TestDropout({64, 1000}, 0.3);
+  TestDropout2d({4, 16, 5, 6}, 0.5);
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "hetu/core/ndarray.h"
+#include "hetu/graph/ops/kernel_links.h"
+#include "test_utils.h"
+#include <chrono>
+#include <numeric>
+
+using namespace hetu;
+
+NDArray Iota(const HTShape& shape) {
+  auto arr = NDArray::empty(shape, Device(kCPU), kFloat32);
+  auto* ptr = arr->data_ptr<float>();
+  std::iota(ptr, ptr + arr->numel(), 0.f);
+  return arr;
+}
+
+// Reads a (possibly strided) array element by element in logical order.
+std::vector<float> NaiveRead(const NDArray& arr) {
+  std::vector<float> values(arr->numel());
+  const float* ptr = arr->data_ptr<float>();
+  for (int64_t idx = 0; idx < arr->numel(); idx++) {
+    int64_t t = idx, offset = 0;
+    for (int64_t i = arr->ndim() - 1; i >= 0; i--) {
+      offset += (t % arr->shape(i)) * arr->stride(i);
+      t /= arr->shape(i);
+    }
+    values[idx] = ptr[offset];
+  }
+  return values;
+}
+
+void CheckEqual(const std::string& name, const NDArray& actual,
+                const std::vector<float>& expected) {
+  auto values = NaiveRead(actual);
+  HT_ASSERT(values.size() == expected.size());
+  for (size_t i = 0; i < values.size(); i++)
+    HT_ASSERT(values[i] == expected[i])
+      << name << " mismatched on position " << i << ": expected "
+      << expected[i] << ", got " << values[i];
+}
+
+void TestPermute(const HTShape& shape, const HTAxes& perm) {
+  HT_LOG_INFO << "Testing Transpose and Contiguous of " << shape
+              << " with perm " << perm << "...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  auto input = Iota(shape);
+  auto view = NDArray::permute(input, perm, kBlockingStream);
+  auto expected = NaiveRead(view);
+
+  auto transposed = NDArray::empty(view->shape(), Device(kCPU), kFloat32);
+  impl::TransposeCpu(input, transposed, perm, stream);
+  CheckEqual("Transpose", transposed, expected);
+
+  auto contiguous = NDArray::empty(view->shape(), Device(kCPU), kFloat32);
+  impl::ContiguousCpu(view, contiguous, stream);
+  CheckEqual("Contiguous", contiguous, expected);
+  CheckEqual("DataTransfer",
+             NDArray::contiguous(view, kBlockingStream), expected);
+
+  // back into the strided layout
+  auto restored = NDArray::zeros(shape, Device(kCPU), kFloat32,
+                                 kBlockingStream);
+  auto restored_view = NDArray::permute(restored, perm, kBlockingStream);
+  impl::ContiguousGradientCpu(contiguous, restored_view, stream);
+  CheckEqual("ContiguousGradient", restored, NaiveRead(input));
+  HT_LOG_INFO << "Testing Transpose and Contiguous done";
+}
+
+void TestSlice(const HTShape& shape, const HTShape& begin_pos,
+               const HTShape& slice_shape) {
+  HT_LOG_INFO << "Testing Slice of " << shape << " at " << begin_pos
+              << " with shape " << slice_shape << "...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  auto input = Iota(shape);
+  auto view = NDArray::slice(input, begin_pos, slice_shape, kBlockingStream);
+  auto expected = NaiveRead(view);
+
+  auto output = NDArray::empty(slice_shape, Device(kCPU), kFloat32);
+  impl::SliceCpu(input, output, begin_pos, stream);
+  CheckEqual("Slice", output, expected);
+
+  auto grad = NDArray::full(shape, 1, Device(kCPU), kFloat32, kBlockingStream);
+  impl::SliceGradientCpu(output, grad, begin_pos, stream);
+  auto grad_view = NDArray::slice(grad, begin_pos, slice_shape,
+                                  kBlockingStream);
+  CheckEqual("SliceGradient", grad_view, expected);
+  auto values = NaiveRead(grad);
+  double sum = std::accumulate(values.begin(), values.end(), 0.0);
+  double slice_sum = std::accumulate(expected.begin(), expected.end(), 0.0);
+  HT_ASSERT(sum == slice_sum)
+    << "SliceGradient should be zero outside of the slice";
+  HT_LOG_INFO << "Testing Slice done";
+}
+
+void TestAsStrided() {
+  HT_LOG_INFO << "Testing AsStrided...";
+  Stream stream(Device(kCPU), kBlockingStream);
+  // overlapping windows of length 4 with step 2
+  auto input = Iota({10});
+  auto output = NDArray::empty({4, 4}, Device(kCPU), kFloat32);
+  impl::AsStridedCpu(input, output, {2, 1}, stream);
+  std::vector<float> expected;
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      expected.push_back(2 * i + j);
+  CheckEqual("AsStrided", output, expected);
+
+  auto grad = NDArray::empty({10}, Device(kCPU), kFloat32);
+  impl::AsStridedGradientCpu(output, grad, {2, 1}, stream);
+  std::vector<float> grad_expected(10, 0);
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      grad_expected[2 * i + j] += 2 * i + j;
+  CheckEqual("AsStridedGradient", grad, grad_expected);
+  HT_LOG_INFO << "Testing AsStrided done";
+}
+
+void BenchmarkTranspose(int64_t rows, int64_t cols) {
+  Stream stream(Device(kCPU), kBlockingStream);
+  auto input = Iota({rows, cols});
+  auto view = NDArray::permute(input, {1, 0}, kBlockingStream);
+  auto start = std::chrono::steady_clock::now();
+  auto expected = NaiveRead(view);
+  auto naive_time = std::chrono::steady_clock::now() - start;
+  auto output = NDArray::empty({cols, rows}, Device(kCPU), kFloat32);
+  start = std::chrono::steady_clock::now();
+  impl::ContiguousCpu(view, output, stream);
+  auto copy_time = std::chrono::steady_clock::now() - start;
+  CheckEqual("Contiguous", output, expected);
+  HT_LOG_INFO << "Transposing " << rows << " x " << cols
+              << " floats, per-element indexing: "
+              << std::chrono::duration<double, std::milli>(naive_time).count()
+              << " ms, tiled: "
+              << std::chrono::duration<double, std::milli>(copy_time).count()
+              << " ms";
+}
+
+int main(int argc, char** argv) {
+  TestPermute({37, 53}, {1, 0});
+  TestPermute({4, 33, 5, 70}, {0, 2, 1, 3});
+  TestPermute({4, 33, 5, 70}, {3, 1, 0, 2});
+  TestPermute({2, 1, 65, 3, 40}, {4, 1, 3, 0, 2});
+  TestSlice({9, 70, 33}, {2, 5, 0}, {5, 60, 33});
+  TestSlice({9, 70, 33}, {0, 0, 7}, {9, 70, 20});
+  TestAsStrided();
+  BenchmarkTranspose(2048, 2048);
+  return 0;
+}
@@ -0,0 +1,208 @@
+#include "hetu/utils/task_queue.h"
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+using namespace hetu;
+
+// The mutex-based task queue used before the ring buffer, kept here as the
+// baseline of the micro-benchmarks.
+class LockedTaskQueue final {
+ public:
+  LockedTaskQueue(size_t num_workers) {
+    for (size_t i = 0; i < num_workers; i++)
+      _workers.emplace_back([this]() { _RunWorker(); });
+  }
+
+  ~LockedTaskQueue() {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _shutdowned = true;
+      _enqueue_signal.notify_all();
+    }
+    for (auto& worker : _workers)
+      worker.join();
+  }
+
+  std::future<void> Enqueue(std::function<void()> f,
+                            const std::string& name = "") {
+    auto task_f = std::make_shared<std::packaged_task<void()>>(std::move(f));
+    auto future = task_f->get_future();
+    std::unique_lock<std::mutex> lock(_mutex);
+    _tasks.push_back({[task_f] { (*task_f)(); }, name});
+    _enqueue_signal.notify_one();
+    return future;
+  }
+
+ private:
+  void _RunWorker() {
+    while (true) {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _enqueue_signal.wait(lock,
+                           [this] { return _shutdowned || !_tasks.empty(); });
+      if (_tasks.empty())
+        break;
+      auto task = std::move(_tasks.front());
+      _tasks.pop_front();
+      lock.unlock();
+      task.first();
+    }
+  }
+
+  std::deque<std::pair<std::function<void()>, std::string>> _tasks;
+  std::mutex _mutex;
+  std::condition_variable _enqueue_signal;
+  std::vector<std::thread> _workers;
+  bool _shutdowned{false};
+};
+
+using bench_clock_t = std::chrono::steady_clock;
+
+inline double elapsed_ns(bench_clock_t::time_point start,
+                         bench_clock_t::time_point end) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+    .count();
+}
+
+void TestOrdering() {
+  HT_LOG_INFO << "Testing TaskQueue ordering...";
+  const int num_tasks = 100000;
+  std::vector<int> order;
+  order.reserve(num_tasks);
+  {
+    TaskQueue queue("test", 1, 1024);
+    for (int i = 0; i < num_tasks; i++)
+      queue.Post([&order, i]() { order.push_back(i); });
+    queue.Enqueue([]() {}).wait();
+  }
+  HT_ASSERT_EQ(order.size(), num_tasks);
+  for (int i = 0; i < num_tasks; i++)
+    HT_ASSERT_EQ(order[i], i) << "Task " << i << " is out of order";
+  HT_LOG_INFO << "Testing TaskQueue ordering done";
+}
+
+void TestMultiProducers(size_t num_workers) {
+  HT_LOG_INFO << "Testing TaskQueue with " << num_workers
+              << " worker(s) and multiple producers...";
+  const int num_producers = 4, num_tasks = 50000;
+  std::atomic<int64_t> sum{0};
+  {
+    TaskQueue queue("test", num_workers, 256);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; p++) {
+      producers.emplace_back([&queue, &sum]() {
+        for (int i = 0; i < num_tasks; i++)
+          queue.Post([&sum, i]() { sum += i; });
+      });
+    }
+    for (auto& producer : producers)
+      producer.join();
+  }
+  int64_t expected = int64_t(num_producers) * num_tasks * (num_tasks - 1) / 2;
+  HT_ASSERT_EQ(sum.load(), expected);
+  HT_LOG_INFO << "Testing TaskQueue with " << num_workers
+              << " worker(s) and multiple producers done";
+}
+
+void TestPostedException() {
+  HT_LOG_INFO << "Testing TaskQueue with failing tasks...";
+  TaskQueue queue("test", 1);
+  int num_done = 0;
+  queue.Post([]() { throw std::runtime_error("posted task failed"); });
+  queue.Post([&num_done]() { num_done++; });
+  // enqueued tasks report their exceptions through the futures
+  auto future =
+    queue.Enqueue([]() { throw std::runtime_error("enqueued task failed"); });
+  bool thrown = false;
+  try {
+    future.get();
+  } catch (const std::runtime_error& e) {
+    thrown = true;
+  }
+  HT_ASSERT(thrown) << "The exception of the enqueued task was lost";
+  queue.Enqueue([&num_done]() { num_done++; }).wait();
+  HT_ASSERT_EQ(num_done, 2) << "The worker stopped after a failing task";
+  HT_LOG_INFO << "Testing TaskQueue with failing tasks done";
+}
+
+// Average delay between enqueueing a task and the start of its execution,
+// with one task in flight at a time.
+template <typename Queue>
+double BenchLatency(Queue& queue, int num_tasks) {
+  double total_ns = 0;
+  for (int i = 0; i < num_tasks; i++) {
+    bench_clock_t::time_point started;
+    auto enqueued = bench_clock_t::now();
+    queue.Enqueue([&started]() { started = bench_clock_t::now(); }).wait();
+    total_ns += elapsed_ns(enqueued, started);
+  }
+  return total_ns / num_tasks;
+}
+
+// Tasks processed per second with `num_producers` threads enqueueing
+// empty tasks concurrently.
+template <typename Queue>
+double BenchThroughput(Queue& queue, int num_producers, int num_tasks) {
+  auto start = bench_clock_t::now();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < num_producers; p++) {
+    producers.emplace_back([&queue, num_tasks]() {
+      for (int i = 0; i < num_tasks; i++)
+        queue.Enqueue([]() {});
+    });
+  }
+  for (auto& producer : producers)
+    producer.join();
+  queue.Enqueue([]() {}).wait();
+  auto end = bench_clock_t::now();
+  return num_producers * num_tasks * 1e9 / elapsed_ns(start, end);
+}
+
+void BenchTaskQueue() {
+  const int num_latency_tasks = 20000, num_throughput_tasks = 200000;
+  for (int num_producers : {1, 4}) {
+    double locked_latency, locked_throughput;
+    double ring_latency, ring_throughput, post_throughput;
+    {
+      LockedTaskQueue queue(1);
+      locked_latency = BenchLatency(queue, num_latency_tasks);
+      locked_throughput =
+        BenchThroughput(queue, num_producers, num_throughput_tasks);
+    }
+    {
+      TaskQueue queue("bench", 1);
+      ring_latency = BenchLatency(queue, num_latency_tasks);
+      ring_throughput =
+        BenchThroughput(queue, num_producers, num_throughput_tasks);
+      auto start = bench_clock_t::now();
+      std::vector<std::thread> producers;
+      for (int p = 0; p < num_producers; p++) {
+        producers.emplace_back([&queue, num_throughput_tasks]() {
+          for (int i = 0; i < num_throughput_tasks; i++)
+            queue.Post([]() {});
+        });
+      }
+      for (auto& producer : producers)
+        producer.join();
+      queue.Enqueue([]() {}).wait();
+      post_throughput = num_producers * num_throughput_tasks * 1e9 /
+        elapsed_ns(start, bench_clock_t::now());
+    }
+    HT_LOG_INFO << "Producers: " << num_producers
+                << " | LockedTaskQueue: latency " << locked_latency
+                << " ns, throughput " << locked_throughput << " tasks/s"
+                << " | TaskQueue: latency " << ring_latency
+                << " ns, throughput " << ring_throughput << " tasks/s"
+                << " (" << post_throughput << " tasks/s without futures)";
+  }
+}
+
+int main(int argc, char** argv) {
+  TestOrdering();
+  TestMultiProducers(1);
+  TestMultiProducers(4);
+  TestPostedException();
+  BenchTaskQueue();
+  return 0;
+}
@@ -0,0 +1,216 @@
+#include "hetu/impl/kernel/cpu/VectorizedKernels.h"
+#include "hetu/common/logging.h"
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace hetu;
+using namespace hetu::impl;
+
+// A buffer of `size` elements of a floating type, filled in float.
+struct Buffer {
+  DataType dtype;
+  std::vector<uint16_t> half;
+  std::vector<float> full;
+
+  Buffer(DataType dtype, const std::vector<float>& values) : dtype(dtype) {
+    if (dtype == kFloat32) {
+      full = values;
+      return;
+    }
+    half.resize(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+      half[i] = dtype == kFloat16 ? float16(values[i]).val
+                                  : bfloat16(values[i]).val;
+  }
+
+  void* data() {
+    return dtype == kFloat32 ? static_cast<void*>(full.data())
+                             : static_cast<void*>(half.data());
+  }
+
+  float get(size_t i) const {
+    if (dtype == kFloat32)
+      return full[i];
+    if (dtype == kFloat16)
+      return float(float16(half[i], float16::from_bits()));
+    return float(bfloat16(half[i], bfloat16::from_bits()));
+  }
+
+  // the reference value rounded to this dtype
+  float round(float value) const {
+    if (dtype == kFloat32)
+      return value;
+    if (dtype == kFloat16)
+      return float(float16(value));
+    return float(bfloat16(value));
+  }
+};
+
+std::vector<float> RandomValues(size_t size, float low, float high,
+                                uint64_t seed) {
+  std::mt19937 engine(seed);
+  std::uniform_real_distribution<float> dist(low, high);
+  std::vector<float> values(size);
+  for (auto& v : values)
+    v = dist(engine);
+  return values;
+}
+
+// Runs `kernel` on buffers holding `values` (the last `num_outputs` being
+// outputs), checks every output element against `reference`, which computes the
+// outputs of one position from the (rounded) inputs, and reports the
+// bandwidth of large runs.
+void CheckKernel(
+  const std::string& name, CPUCapability capability, DataType dtype,
+  size_t size, std::vector<std::vector<float>> values, size_t num_outputs,
+  const std::function<void(std::vector<Buffer>&)>& kernel,
+  const std::function<void(std::vector<float>&)>& reference) {
+  std::vector<Buffer> buffers;
+  for (auto& v : values)
+    buffers.emplace_back(dtype, v);
+  std::vector<std::vector<float>> inputs(size);
+  for (size_t i = 0; i < size; i++)
+    for (auto& b : buffers)
+      inputs[i].push_back(b.get(i));
+
+  kernel(buffers); // warm up and check
+  // allow one rounding step of the output dtype
+  float tol = dtype == kFloat32 ? 1e-5 : (dtype == kFloat16 ? 2e-3 : 1.6e-2);
+  for (size_t i = 0; i < size; i++) {
+    std::vector<float> expected = inputs[i];
+    reference(expected);
+    for (size_t j = buffers.size() - num_outputs; j < buffers.size(); j++) {
+      float e = buffers[j].round(expected[j]), a = buffers[j].get(i);
+      HT_ASSERT(std::abs(a - e) <= tol * std::max(1.0f, std::abs(e)))
+        << name << " (" << capability << ", " << dtype
+        << ") mismatched on position " << i << ", output " << j
+        << ": expected " << e << ", got " << a;
+    }
+  }
+
+  if (size < (1 << 16))
+    return;
+  const int iters = 10;
+  buffers.clear();
+  for (auto& v : values)
+    buffers.emplace_back(dtype, v);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; i++)
+    kernel(buffers);
+  double seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+      .count() / iters;
+  size_t bytes = (values.size() + num_outputs) * size * DataType2Size(dtype);
+  HT_LOG_INFO << name << " [" << capability << ", " << dtype
+              << "]: " << bytes / seconds / 1e9 << " GB/s";
+}
+
+void TestVectorizedKernels(CPUCapability capability, DataType dtype,
+                           size_t size) {
+  const VectorizedKernels* kernels = GetVectorizedKernels(capability);
+  if (kernels == nullptr)
+    return;
+  auto x = RandomValues(size, -4, 4, 1);
+  auto y = RandomValues(size, -1, 1, 2);
+  auto z = RandomValues(size, 0, 1, 3);
+  auto out = std::vector<float>(size, 0);
+
+  CheckKernel("AddConst", capability, dtype, size, {x, out}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->add_const(dtype, b[0].data(), 0.5f, b[1].data(), size);
+    },
+    [](std::vector<float>& v) { v[1] = v[0] + 0.5f; });
+  CheckKernel("MulConst", capability, dtype, size, {x, out}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->mul_const(dtype, b[0].data(), 3.0f, b[1].data(), size);
+    },
+    [](std::vector<float>& v) { v[1] = v[0] * 3.0f; });
+  CheckKernel("DivConst", capability, dtype, size, {x, out}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->div_const(dtype, b[0].data(), 3.0f, b[1].data(), size);
+    },
+    [](std::vector<float>& v) { v[1] = v[0] / 3.0f; });
+  CheckKernel("Gelu", capability, dtype, size, {x, out}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->gelu(dtype, b[0].data(), b[1].data(), size);
+    },
+    [](std::vector<float>& v) {
+      v[1] = v[0] * 0.5f * (1.0f + std::erf(v[0] * M_SQRT1_2));
+    });
+  CheckKernel("GeluGradient", capability, dtype, size, {x, y, out}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->gelu_gradient(dtype, b[0].data(), b[1].data(), b[2].data(),
+                             size);
+    },
+    [](std::vector<float>& v) {
+      float cdf = 0.5f * (1.0f + std::erf(v[0] * M_SQRT1_2));
+      float pdf = std::exp(-0.5f * v[0] * v[0]) * 0.5f * M_2_SQRTPI * M_SQRT1_2;
+      v[2] = v[1] * (cdf + v[0] * pdf);
+    });
+  CheckKernel("SigmoidGradient", capability, dtype, size, {z, y, out}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->sigmoid_gradient(dtype, b[0].data(), b[1].data(), b[2].data(),
+                                size);
+    },
+    [](std::vector<float>& v) { v[2] = v[1] * v[0] * (1 - v[0]); });
+  CheckKernel("TanhGradient", capability, dtype, size, {y, z, out}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->tanh_gradient(dtype, b[0].data(), b[1].data(), b[2].data(),
+                             size);
+    },
+    [](std::vector<float>& v) { v[2] = (1 - v[0] * v[0]) * v[1]; });
+  CheckKernel("SGDUpdate", capability, dtype, size, {y, x}, 1,
+    [&](std::vector<Buffer>& b) {
+      kernels->sgd_update(dtype, b[0].data(), b[1].data(), nullptr, 0.1f, 0,
+                          false, size);
+    },
+    [](std::vector<float>& v) { v[1] -= 0.1f * v[0]; });
+  CheckKernel("MomentumUpdate", capability, dtype, size, {y, x, z}, 2,
+    [&](std::vector<Buffer>& b) {
+      kernels->sgd_update(dtype, b[0].data(), b[1].data(), b[2].data(), 0.1f,
+                          0.9f, false, size);
+    },
+    [](std::vector<float>& v) {
+      v[2] = 0.9f * v[2] - 0.1f * v[0];
+      v[1] += v[2];
+    });
+  CheckKernel("NesterovUpdate", capability, dtype, size, {y, x, z}, 2,
+    [&](std::vector<Buffer>& b) {
+      kernels->sgd_update(dtype, b[0].data(), b[1].data(), b[2].data(), 0.1f,
+                          0.9f, true, size);
+    },
+    [](std::vector<float>& v) {
+      float temp = 0.1f * v[0];
+      v[2] = 0.9f * (v[2] - temp);
+      v[1] += v[2] - temp;
+    });
+  float bias1 = 1 - std::pow(0.9f, 3.0f);
+  float bias2 = std::sqrt(1 - std::pow(0.999f, 3.0f));
+  CheckKernel("AdamUpdate", capability, dtype, size, {y, x, y, z}, 3,
+    [&](std::vector<Buffer>& b) {
+      kernels->adam_update(dtype, b[0].data(), b[1].data(), b[2].data(),
+                           b[3].data(), 1e-3f, 0.9f, 0.999f, 1e-8f, bias1,
+                           bias2, size);
+    },
+    [&](std::vector<float>& v) {
+      v[2] = v[2] * 0.9f + v[0] * 0.1f;
+      v[3] = v[3] * 0.999f + v[0] * v[0] * 0.001f;
+      v[1] -= 1e-3f * (v[2] / bias1) / (std::sqrt(v[3]) / bias2 + 1e-8f);
+    });
+}
+
+int main(int argc, char** argv) {
+  HT_LOG_INFO << "Detected CPU capability: " << GetCPUCapability();
+  for (int c = 0; c <= static_cast<int>(GetCPUCapability()); c++) {
+    auto capability = static_cast<CPUCapability>(c);
+    for (auto dtype : {kFloat32, kFloat16, kBFloat16}) {
+      // odd sizes exercise the partial vectors at the tail
+      TestVectorizedKernels(capability, dtype, 1000003);
+      TestVectorizedKernels(capability, dtype, 13);
+    }
+  }
+  return 0;
+}
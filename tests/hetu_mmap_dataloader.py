@@ -0,0 +1,37 @@
+import hetu
+import numpy as np
+import os
+import tempfile
+
+if __name__ == "__main__":
+    tmp_dir = tempfile.mkdtemp()
+    shards = []
+    records = []
+    for i in range(3):
+        a = np.arange(i * 100, i * 100 + 10 * 4, dtype=np.float32).reshape(10, 4)
+        path = os.path.join(tmp_dir, "shard_{}.bin".format(i))
+        hetu.write_mmap_shard(path, a)
+        shards.append(path)
+        records.append(a)
+    records = np.concatenate(records)
+    b = np.random.rand(4, 2).astype(np.float32)
+    with hetu.graph("eager"):
+        with hetu.context(eager_device="cpu"):
+            x = hetu.from_numpy(b)
+            mm = hetu.utils.data.DataLoader(shards, batch_size=4, shuffle=True,
+                                            num_workers=2, drop_last=False)
+    print(len(mm))
+    with hetu.graph("eager"):
+        with hetu.context(eager_device="cpu"):
+            for epoch in range(2):
+                seen = []
+                for u in mm:
+                    seen.append(u.numpy(force=True))
+                    out = hetu.matmul(u, x)
+                    print(out.numpy(force=True))
+                seen = np.concatenate(seen)
+                # every record is visited exactly once per epoch
+                assert np.array_equal(np.sort(seen[:, 0]), records[:, 0])
+                print("Epoch {}: {} records".format(epoch, seen.shape[0]))
+
+    print("Thank you")
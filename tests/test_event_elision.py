@@ -0,0 +1,63 @@
+import hetu
+import numpy as np
+import unittest
+from test_utils import allclose
+import os
+import time
+
+# A deep chain of tiny ops spends most of its time queueing tasks,
+# so the start/stop events of every op dominate the run time.
+NUM_LAYERS = 1000
+WARM_STEP = 5
+TEST_STEP = 20
+
+class TestEventElision(unittest.TestCase):
+
+    _test_shapes = [
+        (16,),
+        (64, 64),
+    ]
+
+    def _run_chain(self, shape, elision):
+        os.environ["HETU_EVENT_ELISION"] = "ON" if elision else "OFF"
+        x_np = np.random.randn(*shape).astype(np.float32)
+        with hetu.graph("define_and_run"):
+            x = hetu.placeholder(hetu.float32, shape=list(shape), name="x")
+            y = x
+            for i in range(NUM_LAYERS):
+                y = hetu.relu(y + 0.5) if i % 2 == 0 else y - 0.5
+            for i in range(WARM_STEP):
+                y.graph.run(y, [y], feed_dict={x: x_np})
+            start = time.time()
+            for i in range(TEST_STEP):
+                out = y.graph.run(y, [y], feed_dict={x: x_np})
+            cost = (time.time() - start) * 1000.0 / TEST_STEP
+            num_elided = y.graph.num_elided_events
+        if elision:
+            self.assertGreater(num_elided, 0)
+        else:
+            self.assertEqual(num_elided, 0)
+        gt = x_np
+        for i in range(NUM_LAYERS):
+            gt = np.maximum(gt + 0.5, 0) if i % 2 == 0 else gt - 0.5
+        self.assertTrue(allclose(out[0], gt))
+        return cost
+
+    def setUp(self):
+        saved = os.environ.get("HETU_EVENT_ELISION")
+        if saved is None:
+            self.addCleanup(os.environ.pop, "HETU_EVENT_ELISION", None)
+        else:
+            self.addCleanup(os.environ.__setitem__, "HETU_EVENT_ELISION",
+                            saved)
+
+    def test_deep_small_op_chain(self):
+        for shape in TestEventElision._test_shapes:
+            cost_with = self._run_chain(shape, True)
+            cost_without = self._run_chain(shape, False)
+            print(f"{NUM_LAYERS} ops of shape {shape}: "
+                  f"{cost_without:.3f} ms with all events, "
+                  f"{cost_with:.3f} ms with elided events")
+
+if __name__ == '__main__':
+    unittest.main()
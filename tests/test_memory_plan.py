@@ -0,0 +1,56 @@
+import hetu
+import numpy as np
+import unittest
+from test_utils import allclose
+import os
+
+NUM_LAYERS = 200
+
+class TestMemoryPlan(unittest.TestCase):
+
+    _test_shapes = [
+        (16,),
+        (64, 64),
+    ]
+
+    def _run_chain(self, shape, memory_plan):
+        os.environ["HETU_MEMORY_PLAN"] = "ON" if memory_plan else "OFF"
+        x_np = np.random.randn(*shape).astype(np.float32)
+        with hetu.graph("define_and_run", create_new=True):
+            x = hetu.placeholder(hetu.float32, shape=list(shape), name="x")
+            y = x
+            for i in range(NUM_LAYERS):
+                y = hetu.relu(y + 0.5) if i % 2 == 0 else y - 0.5
+            out = y.graph.run(y, [y], feed_dict={x: x_np})
+            stats = y.graph.memory_plan_stats
+        gt = x_np
+        for i in range(NUM_LAYERS):
+            gt = np.maximum(gt + 0.5, 0) if i % 2 == 0 else gt - 0.5
+        self.assertTrue(allclose(out[0], gt))
+        return stats
+
+    def setUp(self):
+        saved = os.environ.get("HETU_MEMORY_PLAN")
+        if saved is None:
+            self.addCleanup(os.environ.pop, "HETU_MEMORY_PLAN", None)
+        else:
+            self.addCleanup(os.environ.__setitem__, "HETU_MEMORY_PLAN", saved)
+
+    def test_chain(self):
+        for shape in TestMemoryPlan._test_shapes:
+            stats = self._run_chain(shape, True)
+            # every op of the chain produces one tensor that is only read by
+            # the next op, so a handful of slots are reused along the chain
+            self.assertGreaterEqual(stats["num_tensors"], NUM_LAYERS)
+            self.assertLessEqual(stats["live_size"], stats["peak_size"])
+            self.assertLessEqual(stats["peak_size"], stats["total_size"])
+            self.assertLess(stats["peak_size"] * 10, stats["total_size"])
+            print(f"{NUM_LAYERS} ops of shape {shape}: planned peak "
+                  f"{stats['peak_size']} bytes, live peak "
+                  f"{stats['live_size']} bytes, sum of tensor sizes "
+                  f"{stats['total_size']} bytes")
+            stats = self._run_chain(shape, False)
+            self.assertEqual(stats["num_tensors"], 0)
+
+if __name__ == '__main__':
+    unittest.main()
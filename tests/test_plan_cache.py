@@ -0,0 +1,51 @@
+import hetu
+import numpy as np
+import unittest
+from test_utils import allclose
+
+class TestPlanCache(unittest.TestCase):
+
+    _test_seq_lens = [5, 17, 3, 30, 64, 9, 33, 50, 17, 1]
+    _test_buckets = [16, 32, 64]
+
+    def _build(self):
+        x = hetu.placeholder(hetu.float32, shape=[4, -1], name="x")
+        y = hetu.relu(x * 2 + 1)
+        return x, y
+
+    def test_exec_plan_cache(self):
+        with hetu.graph("define_and_run", create_new=True) as ctx:
+            graph = ctx.graph
+            x, y = self._build()
+            for seq_len in TestPlanCache._test_seq_lens:
+                x_np = np.random.randn(4, seq_len).astype(np.float32)
+                out = graph.run(y, [y], feed_dict={x: x_np})
+                self.assertTrue(allclose(out[0], np.maximum(x_np * 2 + 1, 0)))
+            stats = graph.plan_cache_stats
+            num_runs = len(TestPlanCache._test_seq_lens)
+            num_seq_lens = len(set(TestPlanCache._test_seq_lens))
+            self.assertEqual(stats["exec_plan_misses"], 1)
+            self.assertEqual(stats["exec_plan_hits"], num_runs - 1)
+            self.assertEqual(stats["shape_plan_misses"], num_seq_lens - 1)
+
+    def test_shape_buckets(self):
+        with hetu.graph("define_and_run", create_new=True) as ctx:
+            graph = ctx.graph
+            x, y = self._build()
+            graph.set_shape_buckets(x, 1, TestPlanCache._test_buckets, pad_value=-1)
+            for seq_len in TestPlanCache._test_seq_lens:
+                x_np = np.random.randn(4, seq_len).astype(np.float32)
+                out = graph.run(y, [y], feed_dict={x: x_np})[0].numpy(force=True)
+                bucket = min(b for b in TestPlanCache._test_buckets if b >= seq_len)
+                self.assertEqual(out.shape, (4, bucket))
+                self.assertTrue(allclose(out[:, :seq_len], np.maximum(x_np * 2 + 1, 0)))
+                # padded values go through the graph as well
+                self.assertTrue((out[:, seq_len:] == 0).all())
+            stats = graph.plan_cache_stats
+            self.assertEqual(stats["exec_plan_misses"], 1)
+            self.assertLessEqual(stats["shape_plan_misses"],
+                                 len(TestPlanCache._test_buckets) - 1)
+            graph.set_shape_buckets()
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,100 @@
+import hetu
+import json
+import numpy as np
+import os
+import struct
+import tempfile
+import unittest
+
+class TestSafeTensors(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.arrays = {
+            "w": np.random.rand(16, 8).astype(np.float32),
+            "b": np.random.rand(8).astype(np.float32),
+            "idx": np.arange(10, dtype=np.int64),
+        }
+
+    def test_save_and_load(self):
+        path = os.path.join(self.tmp_dir, "model.safetensors")
+        names = list(self.arrays.keys())
+        ndarrays = [hetu.NDArray(self.arrays[k], device="cpu") for k in names]
+        hetu.save_safetensors(path, names, ndarrays)
+        loaded = hetu.load_safetensors(path)
+        self.assertEqual(sorted(loaded.keys()), sorted(names))
+        for k in names:
+            np.testing.assert_array_equal(loaded[k].numpy(), self.arrays[k])
+
+    def test_save_async(self):
+        path = os.path.join(self.tmp_dir, "model_async.safetensors")
+        names = list(self.arrays.keys())
+        ndarrays = [hetu.NDArray(self.arrays[k], device="cpu") for k in names]
+        hetu.save_safetensors(path, names, ndarrays, non_blocking=True)
+        hetu.sync_safetensors()
+        loaded = hetu.load_safetensors(path)
+        for k in names:
+            np.testing.assert_array_equal(loaded[k].numpy(), self.arrays[k])
+
+    def test_mixed_dtypes(self):
+        # a 1-byte tensor first would misalign the following ones if the
+        # tensors were stored in order
+        path = os.path.join(self.tmp_dir, "mixed.safetensors")
+        arrays = {
+            "mask": np.arange(3, dtype=np.int8),
+            "w": np.random.rand(5, 3).astype(np.float32),
+            "idx": np.arange(7, dtype=np.int64),
+        }
+        names = list(arrays.keys())
+        ndarrays = [hetu.NDArray(arrays[k], device="cpu") for k in names]
+        hetu.save_safetensors(path, names, ndarrays)
+        with open(path, "rb") as f:
+            header_size, = struct.unpack("<Q", f.read(8))
+            header = json.loads(f.read(header_size))
+        for k in names:
+            begin = header[k]["data_offsets"][0]
+            self.assertEqual(begin % arrays[k].itemsize, 0)
+        loaded = hetu.load_safetensors(path)
+        for k in names:
+            np.testing.assert_array_equal(loaded[k].numpy(), arrays[k])
+
+    def test_load_misaligned(self):
+        # other writers may pack tensors back to back
+        path = os.path.join(self.tmp_dir, "packed.safetensors")
+        mask = np.arange(3, dtype=np.int8)
+        w = np.random.rand(4, 2).astype(np.float32)
+        header = {
+            "mask": {"dtype": "I8", "shape": [3], "data_offsets": [0, 3]},
+            "w": {"dtype": "F32", "shape": [4, 2],
+                  "data_offsets": [3, 3 + w.nbytes]},
+        }
+        header_bytes = json.dumps(header).encode()
+        header_bytes += b" " * ((8 - len(header_bytes) % 8) % 8)
+        with open(path, "wb") as f:
+            f.write(struct.pack("<Q", len(header_bytes)))
+            f.write(header_bytes)
+            f.write(mask.tobytes())
+            f.write(w.tobytes())
+        loaded = hetu.load_safetensors(path)
+        np.testing.assert_array_equal(loaded["mask"].numpy(), mask)
+        np.testing.assert_array_equal(loaded["w"].numpy(), w)
+
+    def test_sharded(self):
+        num_ranks = 2
+        ds = hetu.DistributedStates(num_ranks, {0: num_ranks}, [0])
+        w = self.arrays["w"]
+        for rank in range(num_ranks):
+            shard = np.split(w, num_ranks)[rank]
+            hetu.save_sharded_safetensors(self.tmp_dir, rank, num_ranks, ["w"],
+                                          [hetu.NDArray(shard, device="cpu")],
+                                          [ds])
+        for rank in range(num_ranks):
+            loaded = hetu.load_sharded_safetensors(self.tmp_dir, rank, num_ranks)
+            shard, shard_ds = loaded["w"]
+            np.testing.assert_array_equal(shard.numpy(),
+                                          np.split(w, num_ranks)[rank])
+            self.assertEqual(shard_ds.states, ds.states)
+            self.assertEqual(shard_ds.order, ds.order)
+
+if __name__ == "__main__":
+    unittest.main()